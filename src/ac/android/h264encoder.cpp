@@ -25,11 +25,16 @@
 
 #include <boost/concept_check.hpp>
 #include <hybris/properties/properties.h>
+#include <dlfcn.h>
 #include <unistd.h>
 
 #include "ac/logger.h"
+#include "ac/report/dispatch.h"
+#include "ac/report/metrics/metricsregistry.h"
 #include "ac/keep_alive.h"
 
+#include "ac/common/workstealingexecutor.h"
+
 #include "ac/android/h264encoder.h"
 
 namespace {
@@ -170,6 +175,24 @@ static constexpr const char *kFormatKeyProfileIdc{"profile-idc"};
 static constexpr const char *kFormatKeyLevelIdc{"level-idc"};
 static constexpr const char *kFormatKeyConstraintSet{"constraint-set"};
 static constexpr const char *kFormatKeyPrependSpsPpstoIdrFrames{"prepend-sps-pps-to-idr-frames"};
+// Maps to OMX nSliceHeaderSpacing (macroblocks per slice); codecs
+// without slice control simply ignore the key.
+static constexpr const char *kFormatKeySliceHeaderSpacing{"slice-header-spacing"};
+// From frameworks/av/include/media/stagefright/MediaCodecSource.h;
+// makes MediaCodecSource create and own its input surface instead of
+// pulling frames from a MediaSource.
+static constexpr int32_t kFlagUseSurfaceInput = 1;
+static constexpr const char *kSurfaceInputProperty{"ubuntu.widi.surfaceinput"};
+// Optional hybris entry point handing out the codec's input surface as
+// a native window; only newer media layers carry it.
+static constexpr const char *kGetNativeWindowHandleSymbol{"media_codec_source_get_native_window_handle"};
+typedef void *(*GetNativeWindowHandleFunc)(MediaCodecSourceWrapper *source);
+// Opt-in for wrapping codec output buffers without a copy. The copy
+// stays the default because keeping a reference on the codec buffer
+// trips a reference counting bug in the Halium 9.0 media layer;
+// devices with a fixed media stack save one full-bitstream copy per
+// frame by setting this.
+static constexpr const char *kZeroCopyOutputEnvName{"AETHERCAST_ZERO_COPY_CODEC_BUFFERS"};
 }
 
 namespace ac {
@@ -181,30 +204,22 @@ public:
     typedef std::shared_ptr<MediaSourceBuffer> Ptr;
 
     ~MediaSourceBuffer() {
-        if (!buffer_)
+        if (media_buffer_) {
+            // Hands the read reference back to the codec; everything
+            // downstream has finished with the frame once we get here.
+            media_buffer_release(media_buffer_);
             return;
+        }
 
         delete[] buffer_;
-        buffer_ = nullptr;
-
-        /*const auto ref_count = media_buffer_get_refcount(buffer_);
-        AC_DEBUG("ref count: %d", ref_count);
-
-        // If someone has set a reference on the buffer we just have to
-        // release it here and the other one will take care about actually
-        // destroying it.
-        if (ref_count > 0)
-            media_buffer_release(buffer_);
-        else
-            media_buffer_destroy(buffer_);*/
     }
 
+    // Copies the bitstream out of the codec buffer. This is the safe
+    // default: keeping a reference instead trips a reference counting
+    // bug in the Halium 9.0 media layer.
     static MediaSourceBuffer::Ptr Create(MediaBufferWrapper *buffer) {
         const auto sp = std::shared_ptr<MediaSourceBuffer>(new MediaSourceBuffer);
-        
-        // Copy contents rather than keeping reference of the MediaSourceBuffer,
-        // since on Halium 9.0 there is a Reference Counting bug that causes
-        // trouble otherwise.
+
         uint32_t size = media_buffer_get_size(buffer);
         uint8_t *pixels = new uint8_t[size];
         memcpy(pixels, media_buffer_get_data(buffer), size);
@@ -215,18 +230,29 @@ public:
         return sp;
     }
 
+    // Wraps the codec buffer directly, taking over the caller's read
+    // reference. It goes back to the codec when the last holder of the
+    // video::Buffer lets go, so the full bitstream never gets copied
+    // between the codec and the packetizer.
+    static MediaSourceBuffer::Ptr CreateWrapped(MediaBufferWrapper *buffer) {
+        const auto sp = std::shared_ptr<MediaSourceBuffer>(new MediaSourceBuffer);
+        sp->media_buffer_ = buffer;
+        sp->ExtractTimestamp(buffer);
+        return sp;
+    }
+
     virtual uint32_t Length() const {
-        //return media_buffer_get_size(buffer_);
-        return size_;
+        return media_buffer_ ? media_buffer_get_size(media_buffer_) : size_;
     }
 
     virtual uint8_t* Data() {
-        //return static_cast<uint8_t*>(media_buffer_get_data(buffer_));
-        return buffer_;
+        return media_buffer_
+                ? static_cast<uint8_t*>(media_buffer_get_data(media_buffer_))
+                : buffer_;
     }
 
     virtual bool IsValid() const {
-        return buffer_ != nullptr;
+        return media_buffer_ != nullptr || buffer_ != nullptr;
     }
 
 private:
@@ -243,8 +269,9 @@ private:
     }
 
 private:
-    uint8_t *buffer_;
-    uint32_t size_;
+    uint8_t *buffer_ = nullptr;
+    uint32_t size_ = 0;
+    MediaBufferWrapper *media_buffer_ = nullptr;
 };
 
 video::BaseEncoder::Config H264Encoder::DefaultConfiguration() {
@@ -265,11 +292,16 @@ H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report, bool readout)
     format_(nullptr),
     source_format_(nullptr),
     encoder_(nullptr),
+    input_surface_(nullptr),
     running_(false),
     readout_(readout),
-    input_queue_(ac::video::BufferQueue::Create()),
+    zero_copy_output_(ac::Utils::GetEnvValue(kZeroCopyOutputEnvName) == "1"),
+    recover_requested_(false),
+    input_queue_(ac::video::BufferQueue::CreateSPSC()),
     start_time_(-1ll),
-    frame_count_(0) {
+    frame_count_(0),
+    analyzer_(video::H264AnalyzerSidecar::Create()) {
+    analyzer_executor_ = common::WorkStealingExecutor::SharedInstance()->CreateExecutor(analyzer_);
 }
 
 H264Encoder::~H264Encoder() {
@@ -323,17 +355,28 @@ bool H264Encoder::Configure(const Config &config) {
     media_message_set_int32(format, kFormatKeyBitrateMode, kOMXVideoControlRateConstant);
     media_message_set_int32(format, kFormatKeyFramerate, config.framerate);
 
-    media_message_set_int32(format, kFormatKeyIntraRefreshMode, 0);
+    media_message_set_int32(format, kFormatKeyIntraRefreshMode, config.intra_refresh_mode);
 
-    // Update macroblocks in a cyclic fashion with 10% of all MBs within
-    // frame gets updated at one time. It takes about 10 frames to
-    // completely update a whole video frame. If the frame rate is 30,
-    // it takes about 333 ms in the best case (if next frame is not an IDR)
-    // to recover from a lost/corrupted packet.
-    const int32_t mbs = (((config.width + 15) / 16) * ((config.height + 15) / 16) * 10) / 100;
+    const int32_t total_mbs = ((config.width + 15) / 16) * ((config.height + 15) / 16);
+    int32_t mbs = 0;
+    if (config.intra_refresh_frames > 0) {
+        // Gradual decoder refresh: walk the intra update across the
+        // frame so that after intra_refresh_frames frames every MB got
+        // refreshed and the stream never needs an IDR burst.
+        mbs = (total_mbs + config.intra_refresh_frames - 1) / config.intra_refresh_frames;
+    } else {
+        // Update macroblocks in a cyclic fashion with 10% of all MBs within
+        // frame gets updated at one time. It takes about 10 frames to
+        // completely update a whole video frame. If the frame rate is 30,
+        // it takes about 333 ms in the best case (if next frame is not an IDR)
+        // to recover from a lost/corrupted packet.
+        mbs = (total_mbs * 10) / 100;
+    }
     media_message_set_int32(format, kFormatKeyIntraRefreshCIRMbs, mbs);
 
-    if (config.i_frame_interval > 0)
+    // A refreshing session recovers through the rolling intra MBs;
+    // periodic IDR frames would just reintroduce the size bursts.
+    if (config.i_frame_interval > 0 && config.intra_refresh_frames == 0)
         media_message_set_int32(format, kFormatKeyIFrameInterval, config.i_frame_interval);
 
     if (config.profile_idc > 0)
@@ -345,12 +388,62 @@ bool H264Encoder::Configure(const Config &config) {
     if (config.constraint_set > 0)
         media_message_set_int32(format, kFormatKeyConstraintSet, config.constraint_set);
 
+    // Splitting a frame into multiple slices lets encoder and sink
+    // decoder parallelize within the frame; expressed towards OMX as
+    // macroblocks per slice.
+    if (config.slices > 1) {
+        const int32_t mbs_per_slice =
+            (total_mbs + config.slices - 1) / config.slices;
+        media_message_set_int32(format, kFormatKeySliceHeaderSpacing, mbs_per_slice);
+    }
+
     // FIXME we need to find a way to check if the encoder supports prepending
     // SPS/PPS to the buffers it is producing or if we have to manually do that
     media_message_set_int32(format, kFormatKeyPrependSpsPpstoIdrFrames, 1);
 
     //media_message_set_int32(format, "max-input-size", config.width * config.height * 4);
 
+    // MediaCodecSource can own its input as a gralloc surface which
+    // the producer renders into directly (createInputSurface under the
+    // hood); raw frames then never cross a CPU-visible queue. Opt-in
+    // by property as it needs a capture path which can target the
+    // surface, and only possible when we don't read out pixels anyway.
+    char surface_prop[PROP_VALUE_MAX];
+    property_get(kSurfaceInputProperty, surface_prop, "");
+    if (!readout_ && !strcmp(surface_prop, "true")) {
+        // Not every hybris media layer exposes the input surface
+        // handle; resolve the entry point dynamically so we degrade to
+        // the queued path instead of failing to link on older layers.
+        const auto get_native_window_handle =
+            reinterpret_cast<GetNativeWindowHandleFunc>(::dlsym(
+                RTLD_DEFAULT, kGetNativeWindowHandleSymbol));
+
+        if (get_native_window_handle) {
+            // With surface input the codec pulls frames from its own
+            // input surface and there is no MediaSource to wire up.
+            encoder_ = media_codec_source_create(format, nullptr, kFlagUseSurfaceInput);
+            if (encoder_)
+                input_surface_ = get_native_window_handle(encoder_);
+
+            if (encoder_ && !input_surface_) {
+                media_codec_source_release(encoder_);
+                encoder_ = nullptr;
+            }
+        }
+
+        if (!input_surface_)
+            AC_WARNING("Surface input requested but not available; using queued input");
+    }
+
+    if (encoder_) {
+        config_ = config;
+        format_ = format;
+
+        AC_DEBUG("Configured encoder with surface input succesfully");
+
+        return true;
+    }
+
     auto source = media_source_create();
     if (!source) {
         AC_ERROR("Failed to create media input source for encoder");
@@ -436,6 +529,8 @@ bool H264Encoder::Start() {
         return false;
     }
 
+    analyzer_executor_->Start();
+
     report_->Started();
 
     return true;
@@ -567,7 +662,12 @@ int H264Encoder::OnSourceRead(MediaBufferWrapper **buffer, void *user_data) {
 
     *buffer = next_buffer;
 
-    thiz->report_->BeganFrame(input_buffer->Timestamp());
+    {
+        std::lock_guard<std::mutex> lock(thiz->pending_frame_ids_mutex_);
+        thiz->pending_frame_ids_.push_back(input_buffer->FrameId());
+    }
+
+    AC_REPORT(thiz->report_->BeganFrame(input_buffer->Timestamp()));
 
     return 0;
 }
@@ -626,13 +726,34 @@ bool H264Encoder::Execute() {
 
     MediaBufferWrapper *buffer = nullptr;
     if (!media_codec_source_read(encoder_, &buffer)) {
+        if (recover_requested_.exchange(false))
+            return RecoverFromHang();
+
         AC_ERROR("Failed to read a new buffer from encoder");
         return false;
     }
 
     AC_DEBUG("creating mbuf");
-    auto mbuf = MediaSourceBuffer::Create(buffer);
-    report_->FinishedFrame(mbuf->Timestamp());
+    auto mbuf = zero_copy_output_
+            ? MediaSourceBuffer::CreateWrapped(buffer)
+            : MediaSourceBuffer::Create(buffer);
+
+    // Codec config buffers are synthesized by the codec and don't
+    // correspond to a frame we fed in
+    if (!DoesBufferContainCodecConfig(buffer)) {
+        std::lock_guard<std::mutex> lock(pending_frame_ids_mutex_);
+        if (!pending_frame_ids_.empty()) {
+            mbuf->SetFrameId(pending_frame_ids_.front());
+            pending_frame_ids_.pop_front();
+        }
+    }
+
+    AC_REPORT(report_->FinishedFrame(mbuf->Timestamp(), mbuf->FrameId()));
+
+    // Classification must never delay delivery; this peeks at the
+    // first NAL header and samples the rest onto the pool
+    if (!DoesBufferContainCodecConfig(buffer))
+        analyzer_->Submit(mbuf);
 
     if (DoesBufferContainCodecConfig(buffer)) {
         if (auto sp = delegate_.lock())
@@ -656,6 +777,8 @@ bool H264Encoder::Stop() {
 
     running_ = false;
 
+    analyzer_executor_->Stop();
+
     report_->Stopped();
 
     return true;
@@ -665,9 +788,17 @@ void H264Encoder::QueueBuffer(const video::Buffer::Ptr &buffer) {
     if (!running_)
         return;
 
+    // With surface input raw frames reach the codec through the shared
+    // gralloc surface; anything queued here would never be read.
+    if (input_surface_)
+        return;
+
+    if (ConsumeIDRRequest())
+        SendIDRFrame();
+
     input_queue_->Push(buffer);
 
-    report_->ReceivedInputBuffer(buffer->Timestamp());
+    AC_REPORT(report_->ReceivedInputBuffer(buffer->Timestamp()));
 }
 
 video::BaseEncoder::Config H264Encoder::Configuration() const {
@@ -683,6 +814,89 @@ void H264Encoder::SendIDRFrame() {
     media_codec_source_request_idr_frame(encoder_);
 }
 
+bool H264Encoder::RecoverFromStall() {
+    if (!running_ || !encoder_)
+        return false;
+
+    // In surface-input mode the producer renders into the codec's own
+    // surface which dies with the instance; only a session rebuild can
+    // rewire that, so leave the stall to the pipeline handler.
+    if (input_surface_)
+        return false;
+
+    AC_WARNING("Codec stopped making progress; unblocking the dequeue for a rebuild");
+
+    // Runs on the watchdog thread while Execute() sits inside the
+    // blocked dequeue. Stopping the codec makes the read come back
+    // with an error and the codec thread takes it from there.
+    recover_requested_.store(true);
+    media_codec_source_stop(encoder_);
+
+    return true;
+}
+
+bool H264Encoder::RecoverFromHang() {
+    AC_WARNING("Rebuilding the codec from the cached configuration");
+
+    // The watchdog already stopped the wedged instance, so don't route
+    // through Stop(); just bring our own state down for the rebuild.
+    running_ = false;
+    analyzer_executor_->Stop();
+    report_->Stopped();
+
+    if (!Reconfigure(config_) || !Start()) {
+        AC_ERROR("Failed to rebuild the codec after a hang; giving up");
+        return false;
+    }
+
+    // The fresh instance emits new CSD as its first output buffer and
+    // that travels through OnBufferWithCodecConfig as usual; the
+    // forced IDR right behind it gives the sink a clean resync point
+    // instead of a wait for the next refresh cycle.
+    SendIDRFrame();
+
+    report::metrics::MetricsRegistry::Instance().Increment("codec_recoveries");
+
+    return true;
+}
+
+bool H264Encoder::Reconfigure(const Config &config) {
+    if (!encoder_)
+        return Configure(config);
+
+    AC_DEBUG("reconfiguring with %dx%d@%d", config.width, config.height, config.framerate);
+
+    Stop();
+
+    // MediaCodecSource cannot change the frame size once created so
+    // the codec instance gets rebuilt; our delegates and queues stay
+    // in place.
+    media_codec_source_release(encoder_);
+    encoder_ = nullptr;
+    // The input surface died with the codec instance
+    input_surface_ = nullptr;
+
+    if (format_) {
+        media_message_release(format_);
+        format_ = nullptr;
+    }
+
+    if (source_format_) {
+        media_meta_data_release(source_format_);
+        source_format_ = nullptr;
+    }
+
+    // Frames captured at the old resolution are useless now and the
+    // codec which owned the pending media buffers is gone
+    input_queue_->PopAll();
+    pending_buffers_.clear();
+
+    start_time_ = -1ll;
+    frame_count_ = 0;
+
+    return Configure(config);
+}
+
 std::string H264Encoder::Name() const {
     return kEncoderThreadName;
 }
@@ -18,7 +18,10 @@
 #ifndef AC_ANDORID_ENCODER_H_
 #define AC_ANDORID_ENCODER_H_
 
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include <hybris/media/media_codec_source_layer.h>
@@ -27,10 +30,12 @@
 #include "ac/utils.h"
 
 #include "ac/common/executable.h"
+#include "ac/common/executor.h"
 
 #include "ac/video/baseencoder.h"
 #include "ac/video/encoderreport.h"
 #include "ac/video/bufferqueue.h"
+#include "ac/video/h264analyzersidecar.h"
 
 namespace ac {
 namespace android {
@@ -49,21 +54,35 @@ public:
 
     void QueueBuffer(const ac::video::Buffer::Ptr &buffer) override;
 
+    void* InputSurface() const override { return input_surface_; }
+
     bool Running() const override { return running_; }
     BaseEncoder::Config Configuration() const override;
 
     void SendIDRFrame() override;
 
+    bool Reconfigure(const BaseEncoder::Config &config) override;
+
     // From ac::common::Executable
     bool Start() override;
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    // Execute() blocks inside the codec until the next encoded frame
+    // and cannot share an executor loop
+    bool PrefersDedicatedThread() const override { return true; }
+    // Kicks a wedged codec from the watchdog thread: stopping it makes
+    // the blocked dequeue return an error and the codec thread rebuilds
+    // the instance from the cached configuration.
+    bool RecoverFromStall() override;
 
 private:
     H264Encoder(const video::EncoderReport::Ptr &report, bool readout);
 
     bool DoesBufferContainCodecConfig(MediaBufferWrapper *buffer);
+    // Rebuild-and-resume after a hang; runs on the codec thread once
+    // the watchdog unblocked it.
+    bool RecoverFromHang();
 
     MediaBufferWrapper* PackBuffer(const ac::video::Buffer::Ptr &input_buffer, const ac::TimestampUs &timestamp);
 
@@ -87,12 +106,28 @@ private:
     MediaMessageWrapper *format_;
     MediaMetaDataWrapper *source_format_;
     MediaCodecSourceWrapper *encoder_;
+    // Native window of the codec's own input surface when running in
+    // surface-input mode; nullptr on the queued path.
+    void *input_surface_;
     bool running_;
     bool readout_;
+    bool zero_copy_output_;
+    // Set from the watchdog thread once it kicked a wedged codec; the
+    // codec thread consumes it when the unblocked dequeue fails.
+    std::atomic<bool> recover_requested_;
     ac::video::BufferQueue::Ptr input_queue_;
     std::vector<BufferItem> pending_buffers_;
     ac::TimestampUs start_time_;
     uint32_t frame_count_;
+    // Frame ids of buffers the codec holds; it emits frames in
+    // submission order so readouts claim ids front to back. Source
+    // reads and readouts happen on different threads.
+    std::mutex pending_frame_ids_mutex_;
+    std::deque<ac::FrameId> pending_frame_ids_;
+    // Bitstream classification runs sampled on the shared pool so
+    // delivery never waits for it
+    ac::video::H264AnalyzerSidecar::Ptr analyzer_;
+    ac::common::Executor::Ptr analyzer_executor_;
 };
 
 } // namespace android
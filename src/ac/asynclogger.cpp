@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2015 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/asynclogger.h"
+#include "ac/utils.h"
+
+namespace {
+// Must be a power of two so slot lookup stays a simple mask. 1024
+// in-flight records outlast any realistic sink hiccup; beyond that we
+// prefer dropping over buffering unbounded amounts of text.
+constexpr std::uint64_t kQueueSize{1024};
+constexpr std::uint64_t kQueueMask{kQueueSize - 1};
+}
+
+namespace ac {
+
+AsyncLogger::AsyncLogger(const std::shared_ptr<Logger> &target) :
+    target_(target),
+    ring_(kQueueSize),
+    head_(0),
+    tail_(0),
+    dropped_(0),
+    running_(true),
+    worker_idle_(false) {
+
+    for (std::uint64_t n = 0; n < kQueueSize; n++)
+        ring_[n].sequence.store(n, std::memory_order_relaxed);
+
+    worker_ = std::thread(&AsyncLogger::Worker, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    running_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(wake_lock_);
+        wake_cv_.notify_one();
+    }
+    if (worker_.joinable())
+        worker_.join();
+}
+
+void AsyncLogger::Init(const ac::Logger::Severity &severity) {
+    target_->Init(severity);
+}
+
+void AsyncLogger::Log(Severity severity, const std::string &message, const boost::optional<Location> &location) {
+    if (!Enqueue(severity, message, location))
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t AsyncLogger::DroppedRecords() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+bool AsyncLogger::Enqueue(const Severity &severity, const std::string &message, const boost::optional<Location> &location) {
+    auto pos = head_.load(std::memory_order_relaxed);
+
+    while (true) {
+        auto &record = ring_[pos & kQueueMask];
+        const auto sequence = record.sequence.load(std::memory_order_acquire);
+
+        // The slot is free exactly when its sequence has caught up
+        // with our ticket; a smaller value means the consumer hasn't
+        // released it yet and the ring is full.
+        if (sequence == pos) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                record.severity = severity;
+                record.message = message;
+                record.location = location;
+                record.sequence.store(pos + 1, std::memory_order_release);
+                // Pairs with the fence in Worker(): without it the
+                // publish above and the idle check below could be
+                // reordered against the writer raising its flag and
+                // this record would sit until the next one arrives.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (worker_idle_.load(std::memory_order_relaxed)) {
+                    std::lock_guard<std::mutex> lock(wake_lock_);
+                    wake_cv_.notify_one();
+                }
+                return true;
+            }
+        } else if (sequence < pos) {
+            return false;
+        } else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogger::Worker() {
+    while (running_.load() || tail_ != head_.load()) {
+        auto &record = ring_[tail_ & kQueueMask];
+
+        if (record.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+            if (!running_.load() && tail_ == head_.load())
+                break;
+
+            // Park until a producer publishes the next record instead
+            // of polling so an idle daemon causes no wakeups at all.
+            std::unique_lock<std::mutex> lock(wake_lock_);
+            worker_idle_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wake_cv_.wait(lock, [&] {
+                return record.sequence.load(std::memory_order_acquire) == tail_ + 1 ||
+                       !running_.load();
+            });
+            worker_idle_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        target_->Log(record.severity, record.message, record.location);
+        record.message.clear();
+        record.location = boost::optional<Location>{};
+        record.sequence.store(tail_ + kQueueSize, std::memory_order_release);
+        tail_++;
+
+        // Caught up with the producers again; if anything was thrown
+        // away in between let the sink know once instead of spamming.
+        const auto dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped > 0 && tail_ == head_.load()) {
+            target_->Log(Severity::kWarning,
+                         Utils::Sprintf("Dropped %lld log records as the writer could not keep up", dropped),
+                         boost::optional<Location>{});
+            dropped_.fetch_sub(dropped, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace ac
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_ASYNCLOGGER_H_
+#define AC_ASYNCLOGGER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ac/logger.h"
+
+namespace ac {
+// Decorates another logger so that callers only enqueue records into a
+// bounded multi-producer ring; a dedicated writer thread hands them to
+// the wrapped logger. When the ring is full records are dropped and
+// counted instead of blocking the caller, so a slow sink can never
+// stall the threads doing the actual streaming work.
+class AsyncLogger : public Logger {
+public:
+    AsyncLogger(const std::shared_ptr<Logger> &target);
+    ~AsyncLogger();
+
+    void Init(const ac::Logger::Severity &severity = ac::Logger::Severity::kWarning) override;
+    void Log(Severity severity, const std::string &message, const boost::optional<Location> &location) override;
+
+    // Number of records dropped so far because the ring was full at
+    // enqueue time; the writer also reports the count on the wrapped
+    // logger whenever it catches up.
+    std::uint64_t DroppedRecords() const;
+
+private:
+    struct Record {
+        // Producers bump the sequence to claim the slot, the consumer
+        // bumps it by ring size on release; see the Enqueue/Worker
+        // pair for the exact protocol.
+        std::atomic<std::uint64_t> sequence;
+        Severity severity;
+        std::string message;
+        boost::optional<Location> location;
+    };
+
+    bool Enqueue(const Severity &severity, const std::string &message, const boost::optional<Location> &location);
+    void Worker();
+
+private:
+    std::shared_ptr<Logger> target_;
+    std::vector<Record> ring_;
+    std::atomic<std::uint64_t> head_;
+    std::uint64_t tail_;
+    std::atomic<std::uint64_t> dropped_;
+    std::atomic<bool> running_;
+    // The writer parks itself on the condition variable when the ring
+    // runs empty so an idle daemon causes no periodic wakeups; the
+    // flag tells producers whether a notify is needed at all.
+    std::atomic<bool> worker_idle_;
+    std::mutex wake_lock_;
+    std::condition_variable wake_cv_;
+    std::thread worker_;
+};
+}
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>
+
+#include <pulse/pulseaudio.h>
+
+#include "ac/logger.h"
+
+#include "ac/audio/pulseaudiocapture.h"
+
+#include "ac/common/clock.h"
+
+namespace {
+static constexpr const char *kAudioCaptureThreadName{"PulseAudioCapture"};
+// WFD LPCM is 16 bit big-endian stereo at 48 kHz; capture runs in the
+// machine's little-endian layout and the copy out of the shared memory
+// segment doubles as the byte swap.
+static constexpr unsigned int kChannels{2};
+static constexpr unsigned int kSampleRate{48000};
+static constexpr unsigned int kBytesPerFrame{kChannels * 2};
+// 10ms periods keep the mux interleave tight against the video frames
+// without waking the pipeline for tiny fragments.
+static constexpr unsigned int kPeriodFrames{480};
+}
+
+namespace ac {
+namespace audio {
+
+PulseAudioCapture::Ptr PulseAudioCapture::Create() {
+    return std::shared_ptr<PulseAudioCapture>(new PulseAudioCapture);
+}
+
+PulseAudioCapture::PulseAudioCapture() :
+    mainloop_(nullptr),
+    context_(nullptr),
+    stream_(nullptr),
+    pool_(video::BufferPool::Create()),
+    running_(false) {
+}
+
+PulseAudioCapture::~PulseAudioCapture() {
+    Stop();
+
+    if (stream_) {
+        pa_stream_disconnect(stream_);
+        pa_stream_unref(stream_);
+    }
+
+    if (context_) {
+        pa_context_disconnect(context_);
+        pa_context_unref(context_);
+    }
+
+    if (mainloop_)
+        pa_mainloop_free(mainloop_);
+}
+
+void PulseAudioCapture::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
+    delegate_ = delegate;
+}
+
+bool PulseAudioCapture::Start() {
+    if (running_)
+        return true;
+
+    // All callbacks below dispatch from pa_mainloop_iterate inside our
+    // own Execute() and therefore cannot outlive this instance; a
+    // plain pointer as user data is safe here.
+    mainloop_ = pa_mainloop_new();
+    if (!mainloop_)
+        return false;
+
+    context_ = pa_context_new(pa_mainloop_get_api(mainloop_), "aethercast");
+    if (!context_) {
+        pa_mainloop_free(mainloop_);
+        mainloop_ = nullptr;
+        return false;
+    }
+
+    pa_context_set_state_callback(context_, [](pa_context*, void *user_data) {
+        static_cast<PulseAudioCapture*>(user_data)->OnContextStateChanged();
+    }, this);
+
+    if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0) {
+        AC_ERROR("Failed to connect to PulseAudio: %s",
+                 pa_strerror(pa_context_errno(context_)));
+        pa_context_unref(context_);
+        context_ = nullptr;
+        pa_mainloop_free(mainloop_);
+        mainloop_ = nullptr;
+        return false;
+    }
+
+    running_ = true;
+
+    return true;
+}
+
+bool PulseAudioCapture::Stop() {
+    if (!running_)
+        return true;
+
+    running_ = false;
+
+    // Execute() may sit in a blocking dispatch on another thread
+    if (mainloop_)
+        pa_mainloop_wakeup(mainloop_);
+
+    return true;
+}
+
+bool PulseAudioCapture::Execute() {
+    if (!running_)
+        return false;
+
+    // One blocking dispatch per call; the period cadence wakes us
+    // often enough and Stop() interrupts the wait for teardown.
+    if (pa_mainloop_iterate(mainloop_, 1, nullptr) < 0)
+        return false;
+
+    return running_;
+}
+
+std::string PulseAudioCapture::Name() const {
+    return kAudioCaptureThreadName;
+}
+
+void PulseAudioCapture::OnContextStateChanged() {
+    switch (pa_context_get_state(context_)) {
+    case PA_CONTEXT_READY: {
+        // The monitor of the default sink carries exactly what the
+        // user hears, mixed and at playback volume.
+        const auto op = pa_context_get_server_info(context_,
+            [](pa_context*, const pa_server_info *info, void *user_data) {
+                static_cast<PulseAudioCapture*>(user_data)->OnServerInfo(
+                    info ? info->default_sink_name : nullptr);
+            }, this);
+        if (op)
+            pa_operation_unref(op);
+        break;
+    }
+    case PA_CONTEXT_FAILED:
+    case PA_CONTEXT_TERMINATED:
+        AC_ERROR("Lost connection to PulseAudio: %s",
+                 pa_strerror(pa_context_errno(context_)));
+        running_ = false;
+        break;
+    default:
+        break;
+    }
+}
+
+void PulseAudioCapture::OnServerInfo(const char *default_sink_name) {
+    if (!default_sink_name) {
+        AC_ERROR("PulseAudio reported no default sink to monitor");
+        running_ = false;
+        return;
+    }
+
+    ConnectStream(std::string(default_sink_name) + ".monitor");
+}
+
+bool PulseAudioCapture::ConnectStream(const std::string &source_name) {
+    pa_sample_spec spec;
+    spec.format = PA_SAMPLE_S16LE;
+    spec.rate = kSampleRate;
+    spec.channels = kChannels;
+
+    stream_ = pa_stream_new(context_, "screencast audio", &spec, nullptr);
+    if (!stream_) {
+        AC_ERROR("Failed to create PulseAudio stream: %s",
+                 pa_strerror(pa_context_errno(context_)));
+        running_ = false;
+        return false;
+    }
+
+    pa_stream_set_read_callback(stream_, [](pa_stream*, size_t, void *user_data) {
+        static_cast<PulseAudioCapture*>(user_data)->OnStreamReadable();
+    }, this);
+
+    // A fixed fragment size makes every delivery one muxable access
+    // unit; adjust-latency keeps the server-side buffering down to
+    // what the fragment needs.
+    pa_buffer_attr attr;
+    memset(&attr, 0xff, sizeof(attr));
+    attr.fragsize = kPeriodFrames * kBytesPerFrame;
+
+    if (pa_stream_connect_record(stream_, source_name.c_str(), &attr,
+                                 PA_STREAM_ADJUST_LATENCY) < 0) {
+        AC_ERROR("Failed to record from %s: %s", source_name,
+                 pa_strerror(pa_context_errno(context_)));
+        pa_stream_unref(stream_);
+        stream_ = nullptr;
+        running_ = false;
+        return false;
+    }
+
+    AC_INFO("Capturing audio from %s", source_name);
+
+    return true;
+}
+
+void PulseAudioCapture::OnStreamReadable() {
+    while (pa_stream_readable_size(stream_) > 0) {
+        const void *data = nullptr;
+        size_t nbytes = 0;
+
+        if (pa_stream_peek(stream_, &data, &nbytes) < 0) {
+            AC_ERROR("Failed to read from capture stream: %s",
+                     pa_strerror(pa_context_errno(context_)));
+            return;
+        }
+
+        if (nbytes == 0)
+            return;
+
+        // A hole in the stream (data == nullptr) is consumed like any
+        // other chunk but produces nothing.
+        if (data) {
+            // Stamp with the time the period actually played rather
+            // than when it reached us, so the mux interleaves against
+            // the video capture timestamps.
+            pa_usec_t latency = 0;
+            int negative = 0;
+            pa_stream_get_latency(stream_, &latency, &negative);
+
+            auto timestamp = ac::common::Clock::NowUs();
+            if (!negative)
+                timestamp -= static_cast<ac::TimestampUs>(latency);
+
+            auto buffer = pool_->Acquire(nbytes, timestamp);
+
+            // The one copy out of the shared memory segment converts
+            // the samples to the big-endian layout LPCM mandates.
+            const auto *src = static_cast<const uint8_t*>(data);
+            auto *dst = buffer->Data();
+            for (size_t n = 0; n + 1 < nbytes; n += 2) {
+                dst[n] = src[n + 1];
+                dst[n + 1] = src[n];
+            }
+
+            if (auto sp = delegate_.lock())
+                sp->OnAudioBufferAvailable(buffer);
+        }
+
+        pa_stream_drop(stream_);
+    }
+}
+
+} // namespace audio
+} // namespace ac
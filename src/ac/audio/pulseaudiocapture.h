@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_AUDIO_PULSEAUDIOCAPTURE_H_
+#define AC_AUDIO_PULSEAUDIOCAPTURE_H_
+
+#include <memory>
+#include <string>
+
+#include "ac/non_copyable.h"
+
+#include "ac/common/executable.h"
+
+#include "ac/video/buffer.h"
+#include "ac/video/bufferpool.h"
+
+// Keeps the PulseAudio headers out of everything which only needs the
+// delegate interface below
+struct pa_context;
+struct pa_mainloop;
+struct pa_stream;
+
+namespace ac {
+namespace audio {
+
+// Captures what the system plays back by recording from the default
+// sink's monitor source. Periods arrive through PulseAudio's shared
+// memory transport and get copied exactly once into pooled buffers
+// (converted to the big-endian LPCM sample layout on the way), so an
+// enabled audio track adds no allocations and no further copies ahead
+// of the mux. Runs as one more executable on the pipeline's executor
+// pool next to the stream renderer.
+class PulseAudioCapture : public ac::common::Executable {
+public:
+    typedef std::shared_ptr<PulseAudioCapture> Ptr;
+
+    class Delegate : public ac::NonCopyable {
+    public:
+        virtual void OnAudioBufferAvailable(const video::Buffer::Ptr &buffer) = 0;
+    };
+
+    static Ptr Create();
+
+    ~PulseAudioCapture();
+
+    void SetDelegate(const std::weak_ptr<Delegate> &delegate);
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+
+private:
+    PulseAudioCapture();
+
+    void OnContextStateChanged();
+    void OnServerInfo(const char *default_sink_name);
+    bool ConnectStream(const std::string &source_name);
+    void OnStreamReadable();
+
+private:
+    std::weak_ptr<Delegate> delegate_;
+    pa_mainloop *mainloop_;
+    pa_context *context_;
+    pa_stream *stream_;
+    video::BufferPool::Ptr pool_;
+    bool running_;
+};
+
+} // namespace audio
+} // namespace ac
+
+#endif
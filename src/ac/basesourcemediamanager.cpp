@@ -15,14 +15,57 @@
  *
  */
 
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <sstream>
+
+#include <boost/concept_check.hpp>
 
 #include "ac/logger.h"
 #include "ac/basesourcemediamanager.h"
+#include "ac/utils.h"
 #include "ac/video/videoformat.h"
 
 namespace {
 static unsigned int next_session_id = 0;
+
+// What the encoder sustains in pixels per second; the default matches
+// 720p30 which every backend handles. Deployments which measured more
+// with the encoder benchmark suite raise it through the environment
+// and thereby unlock the 60 Hz and 1080p modes below.
+static constexpr double kDefaultMaxEncodePixelRate{1280 * 720 * 30};
+static constexpr const char *kMaxEncodePixelRateEnvName{"AETHERCAST_MAX_ENCODE_PIXEL_RATE"};
+
+// Set to 1 on deployments whose sinks decode H.265; roughly halves the
+// bitrate at equal quality which is what marginal WiFi links need.
+static constexpr const char *kEnableHEVCEnvName{"AETHERCAST_ENABLE_HEVC"};
+
+// Set to 1 on deployments with 2160p displays behind their sinks;
+// upgrades the encode resolution past what WFD 1.x can negotiate,
+// provided the measured encode pixel rate covers at least 2160p30.
+static constexpr const char *kEnable4KEnvName{"AETHERCAST_ENABLE_4K"};
+
+double MaxEncodePixelRate() {
+    const auto env_value = ac::Utils::GetEnvValue(kMaxEncodePixelRateEnvName);
+    if (!env_value.empty() && std::atof(env_value.c_str()) > 0)
+        return std::atof(env_value.c_str());
+    return kDefaultMaxEncodePixelRate;
+}
+
+// Fingerprint of everything format selection depends on; two sinks
+// advertising identical capabilities are interchangeable here, so the
+// per-sink decision cache is keyed by this.
+std::string SinkCapabilityFingerprint(const wds::NativeVideoFormat &native,
+                                      const std::vector<wds::H264VideoCodec> &codecs) {
+    std::ostringstream fingerprint;
+    fingerprint << native.type << ":" << native.rate_resolution;
+    for (const auto &codec : codecs)
+        fingerprint << "|" << codec.profile << ":" << codec.level << ":"
+                    << codec.cea_rr.to_ulong() << ":" << codec.vesa_rr.to_ulong()
+                    << ":" << codec.hh_rr.to_ulong();
+    return fingerprint.str();
+}
 }
 
 namespace ac {
@@ -47,6 +90,11 @@ wds::SessionType BaseSourceMediaManager::GetSessionType() const {
     return wds::AudioVideoSession;
 }
 
+bool BaseSourceMediaManager::RetargetPeer(const std::string &address) {
+    boost::ignore_unused_variable_warning(address);
+    return false;
+}
+
 void BaseSourceMediaManager::SetSinkRtpPorts(int port1, int port2) {
     sink_port1_ = port1;
     sink_port2_ = port2;
@@ -63,16 +111,33 @@ int BaseSourceMediaManager::GetLocalRtpPort() const {
 std::vector<wds::H264VideoCodec> BaseSourceMediaManager::GetH264VideoCodecs() {
     static std::vector<wds::H264VideoCodec> codecs;
     if (codecs.empty()) {
+        // Everything we are willing to offer; what actually gets
+        // advertised is gated below by the encode pixel rate the
+        // device sustains, so a sink never negotiates a mode our
+        // encoder cannot keep up with.
+        static const wds::CEARatesAndResolutions kCandidateModes[] = {
+            wds::CEA1280x720p24,
+            wds::CEA1280x720p25,
+            wds::CEA1280x720p30,
+            wds::CEA1280x720p60,
+            wds::CEA1920x1080p24,
+            wds::CEA1920x1080p25,
+            wds::CEA1920x1080p30,
+            wds::CEA1920x1080p60,
+        };
+
+        const auto max_pixel_rate = MaxEncodePixelRate();
+
         wds::RateAndResolutionsBitmap cea_rr;
         wds::RateAndResolutionsBitmap vesa_rr;
         wds::RateAndResolutionsBitmap hh_rr;
 
-        // We only support 720p here for now as that is our best performing
-        // resolution with regard of all other bits in the pipeline. Eventually
-        // we will add 60 Hz here too but for now only everything up to 30 Hz.
-        cea_rr.set(wds::CEA1280x720p30);
-        cea_rr.set(wds::CEA1280x720p25);
-        cea_rr.set(wds::CEA1280x720p24);
+        for (const auto mode : kCandidateModes) {
+            const auto rr = ac::video::ExtractRateAndResolution(
+                wds::H264VideoFormat(wds::CBP, wds::k3_1, mode));
+            if (rr.width * rr.height * rr.framerate <= max_pixel_rate)
+                cea_rr.set(mode);
+        }
 
         // FIXME which profiles and formats we support highly depends on what
         // android supports. But for now we just consider CBP with level 3.1
@@ -99,22 +164,38 @@ bool BaseSourceMediaManager::InitOptimalVideoFormat(const wds::NativeVideoFormat
         ac::video::DumpVideoCodec(sink_codec);
     }
 
-    bool success = false;
+    // A sink reconnecting with unchanged capabilities gets its
+    // previous decision back without rescoring anything.
+    static std::map<std::string, wds::H264VideoFormat> format_cache;
+    const auto fingerprint = SinkCapabilityFingerprint(sink_native_format,
+                                                       sink_supported_codecs);
 
-    format_ = wds::FindOptimalVideoFormat(sink_native_format,
-                                         GetH264VideoCodecs(),
-                                         sink_supported_codecs,
-                                         &success);
+    const auto cached = format_cache.find(fingerprint);
+    if (cached != format_cache.end()) {
+        format_ = cached->second;
+        AC_DEBUG("Reusing cached video format for known sink:");
+        ac::video::DumpVideoFormat(format_);
+        return Configure();
+    }
 
-    // Workaround buggy wds code ..
-    if (format_.rate_resolution == wds::CEA1280x720p60)
-        format_.rate_resolution = wds::CEA1280x720p30;
+    bool success = false;
+
+    // Selection runs over our constexpr mode tables instead of
+    // wds::FindOptimalVideoFormat; that keeps the result inside the
+    // modes we actually advertise (the old path needed a workaround
+    // for wds occasionally answering with 720p60).
+    format_ = ac::video::FindOptimalVideoFormat(sink_native_format,
+                                                GetH264VideoCodecs(),
+                                                sink_supported_codecs,
+                                                &success);
 
     if (!success) {
         AC_ERROR("Failed to select proper video format");
         return false;
     }
 
+    format_cache[fingerprint] = format_;
+
     AC_DEBUG("Found optimal video format:");
     ac::video::DumpVideoFormat(format_);
 
@@ -125,6 +206,48 @@ wds::H264VideoFormat BaseSourceMediaManager::GetOptimalVideoFormat() const {
     return format_;
 }
 
+video::CodecType BaseSourceMediaManager::SelectedVideoCodec() const {
+    // Sinks announce H.265 through the WFD 2.0 wfd2_video_formats
+    // parameter which the RTSP layer (libwds) cannot transport; the
+    // H.264 negotiation above can therefore not tell us whether the
+    // sink decodes HEVC. Until that gap closes, HEVC is enabled per
+    // deployment for sinks known to support it and only the resolution
+    // and rate come out of the negotiation.
+    if (ac::Utils::IsEnvSet(kEnableHEVCEnvName)
+            && std::atoi(ac::Utils::GetEnvValue(kEnableHEVCEnvName).c_str()) > 0)
+        return video::CodecType::kHEVC;
+
+    return video::CodecType::kH264;
+}
+
+video::RateAndResolution BaseSourceMediaManager::SelectedRateAndResolution() const {
+    auto rr = ac::video::ExtractRateAndResolution(format_);
+
+    // WFD 1.x defines no 2160p rate-resolution values, so a 4K sink
+    // negotiates a 1080p mode and visibly upscales it. Deployments
+    // which know their sinks decode 2160p opt in here and the stream
+    // then runs at 2160p with the negotiated rate while RTSP still
+    // speaks 1080p. Devices whose measured encode pixel rate cannot
+    // sustain 2160p30 keep the negotiated mode.
+    if (!ac::Utils::IsEnvSet(kEnable4KEnvName)
+            || std::atoi(ac::Utils::GetEnvValue(kEnable4KEnvName).c_str()) <= 0)
+        return rr;
+
+    const auto max_pixel_rate = MaxEncodePixelRate();
+    if (max_pixel_rate < 3840 * 2160 * 30.0)
+        return rr;
+
+    ac::video::RateAndResolution upgraded;
+    if (ac::video::FindBest2160pMode(max_pixel_rate, rr.framerate, &upgraded)) {
+        AC_INFO("Upgrading negotiated %dx%d@%d session to %dx%d@%d",
+                rr.width, rr.height, rr.framerate,
+                upgraded.width, upgraded.height, upgraded.framerate);
+        rr = upgraded;
+    }
+
+    return rr;
+}
+
 bool BaseSourceMediaManager::InitOptimalAudioFormat(const std::vector<wds::AudioCodec>& sink_codecs) {
     if (sink_codecs.empty())
         return false;
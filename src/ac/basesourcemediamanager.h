@@ -23,6 +23,8 @@
 #include <wds/media_manager.h>
 
 #include "ac/non_copyable.h"
+#include "ac/video/codectype.h"
+#include "ac/video/videoformat.h"
 
 namespace ac {
 class BaseSourceMediaManager : public wds::SourceMediaManager
@@ -38,6 +40,12 @@ public:
     void SetDelegate(const std::weak_ptr<Delegate> &delegate);
     void ResetDelegate();
 
+    // Re-points the media transport at a new sink address mid-session
+    // so the stream survives a P2P group renegotiation; managers which
+    // cannot resume in place return false and the session tears down
+    // as before.
+    virtual bool RetargetPeer(const std::string &address);
+
     void SetSinkRtpPorts(int port1, int port2) override;
     std::pair<int,int> GetSinkRtpPorts() const override;
     virtual int GetLocalRtpPort() const override;
@@ -46,6 +54,15 @@ public:
     bool InitOptimalVideoFormat(const wds::NativeVideoFormat& sink_native_format,
                                 const std::vector<wds::H264VideoCodec>& sink_supported_codecs) override;
     wds::H264VideoFormat GetOptimalVideoFormat() const override;
+
+    // Codec the session should be encoded with; see the implementation
+    // for why HEVC is an opt-in rather than negotiated.
+    video::CodecType SelectedVideoCodec() const;
+
+    // Resolution and rate the session should run at: the negotiated
+    // mode, or the 2160p override on top of it when enabled and the
+    // encoder sustains the pixel rate.
+    video::RateAndResolution SelectedRateAndResolution() const;
     bool InitOptimalAudioFormat(const std::vector<wds::AudioCodec>& sink_supported_codecs) override;
     wds::AudioCodec GetOptimalAudioFormat() const override;
     virtual void SendIDRPicture() override;
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2015 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BORROWED_GOBJECT_H_
+#define BORROWED_GOBJECT_H_
+
+#include "ac/scoped_gobject.h"
+#include "ac/shared_gobject.h"
+
+namespace ac {
+// A non-owning view of a GObject for downward call chains. A callee
+// which only uses the object for the duration of a call (or whose
+// owner provably outlives it) has no business touching the reference
+// count; passing one of these around costs a raw pointer copy instead
+// of the ref/unref pair a full wrapper would add. The borrower must
+// never outlive the owning ScopedGObject/SharedGObject.
+template<typename T>
+class BorrowedGObject {
+public:
+    BorrowedGObject() = default;
+    BorrowedGObject(const ScopedGObject<T> &owner) : object_(owner.get()) {}
+    BorrowedGObject(const SharedGObject<T> &owner) : object_(owner.get()) {}
+
+    T* get() const { return object_; }
+    explicit operator bool() const { return object_ != nullptr; }
+
+private:
+    T *object_ = nullptr;
+};
+}
+
+#endif // BORROWED_GOBJECT_H_
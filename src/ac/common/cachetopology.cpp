@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+#include <sys/stat.h>
+
+#include "ac/logger.h"
+
+#include "ac/common/cachetopology.h"
+
+namespace {
+constexpr const char *kSysfsCpuRoot{"/sys/devices/system/cpu"};
+// More cache levels than any real part exposes
+constexpr int kMaxCacheIndex{16};
+
+std::string ReadFirstLine(const std::string &path) {
+    std::ifstream file(path);
+    std::string line;
+    if (!std::getline(file, line))
+        return "";
+    return line;
+}
+
+bool DirectoryExists(const std::string &path) {
+    struct stat info;
+    return ::stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// Parses sysfs cpu lists like "0-3" or "0,2" or "0-1,4"
+std::vector<int> ParseCpuList(const std::string &value) {
+    std::vector<int> cpus;
+
+    std::size_t pos = 0;
+    while (pos < value.size()) {
+        auto end = value.find(',', pos);
+        if (end == std::string::npos)
+            end = value.size();
+
+        const auto entry = value.substr(pos, end - pos);
+        const auto dash = entry.find('-');
+        if (dash == std::string::npos) {
+            if (!entry.empty())
+                cpus.push_back(std::atoi(entry.c_str()));
+        } else {
+            const auto first = std::atoi(entry.substr(0, dash).c_str());
+            const auto last = std::atoi(entry.substr(dash + 1).c_str());
+            for (int cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+        }
+
+        pos = end + 1;
+    }
+
+    return cpus;
+}
+
+// The shared_cpu_list of the CPU's L2 data or unified cache, or an
+// empty string when the kernel exposes no cache hierarchy
+std::string SharedL2List(const std::string &cpu_dir) {
+    for (int index = 0; index < kMaxCacheIndex; index++) {
+        const auto cache_dir = cpu_dir + "/cache/index" + std::to_string(index);
+
+        const auto level = ReadFirstLine(cache_dir + "/level");
+        if (level.empty())
+            break;
+
+        if (std::atoi(level.c_str()) != 2)
+            continue;
+
+        if (ReadFirstLine(cache_dir + "/type") == "Instruction")
+            continue;
+
+        return ReadFirstLine(cache_dir + "/shared_cpu_list");
+    }
+
+    return "";
+}
+
+unsigned long MaxFrequency(const std::string &cpu_dir) {
+    return std::strtoul(ReadFirstLine(cpu_dir + "/cpufreq/cpuinfo_max_freq").c_str(),
+                        nullptr, 10);
+}
+}
+
+namespace ac {
+namespace common {
+
+CacheTopology& CacheTopology::Instance() {
+    static CacheTopology instance;
+    return instance;
+}
+
+CacheTopology::CacheTopology() :
+    groups_(ReadGroups(kSysfsCpuRoot)) {
+
+    for (const auto &group : groups_) {
+        std::string cpus;
+        for (const auto cpu : group)
+            cpus += (cpus.empty() ? "" : "+") + std::to_string(cpu);
+        AC_DEBUG("Shared L2 CPU group: %s", cpus.c_str());
+    }
+}
+
+std::vector<std::vector<int>> CacheTopology::ReadGroups(const std::string &sysfs_cpu_root) {
+    struct Group {
+        std::vector<int> cpus;
+        unsigned long max_freq = 0;
+    };
+
+    // Keyed by the L2 shared_cpu_list so every cluster collapses
+    // into one entry no matter from which member we saw it
+    std::map<std::string, Group> by_cache;
+    std::vector<int> all_cpus;
+
+    for (int cpu = 0; ; cpu++) {
+        const auto cpu_dir = sysfs_cpu_root + "/cpu" + std::to_string(cpu);
+        if (!DirectoryExists(cpu_dir))
+            break;
+
+        all_cpus.push_back(cpu);
+
+        const auto shared = SharedL2List(cpu_dir);
+        if (shared.empty())
+            continue;
+
+        auto &group = by_cache[shared];
+        if (group.cpus.empty())
+            group.cpus = ParseCpuList(shared);
+        group.max_freq = std::max(group.max_freq, MaxFrequency(cpu_dir));
+    }
+
+    // Without cache information (or CPUs at all) placement can't do
+    // better than treating the machine as one flat group
+    if (by_cache.empty()) {
+        if (all_cpus.empty())
+            return {};
+        return {all_cpus};
+    }
+
+    std::vector<Group> groups;
+    for (const auto &iter : by_cache)
+        groups.push_back(iter.second);
+
+    // Fastest cluster first so policies can hand the heavy stages out
+    // front to back
+    std::sort(groups.begin(), groups.end(), [](const Group &lhs, const Group &rhs) {
+        if (lhs.max_freq != rhs.max_freq)
+            return lhs.max_freq > rhs.max_freq;
+        return lhs.cpus.front() < rhs.cpus.front();
+    });
+
+    std::vector<std::vector<int>> result;
+    for (const auto &group : groups)
+        result.push_back(group.cpus);
+
+    return result;
+}
+
+const std::vector<std::vector<int>>& CacheTopology::Groups() const {
+    return groups_;
+}
+
+bool CacheTopology::IsHeterogeneous() const {
+    return groups_.size() > 1;
+}
+
+} // namespace common
+} // namespace ac
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_CACHETOPOLOGY_H_
+#define AC_COMMON_CACHETOPOLOGY_H_
+
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief CPU groups sharing an L2 cache, read once from sysfs.
+ *
+ * On big.LITTLE parts each cluster has its own L2, so two pipeline
+ * threads landing on different clusters pay cross-cluster cache
+ * traffic for every buffer handoff. The groups here let placement
+ * policies keep adjacent pipeline stages on cores which actually
+ * share a cache; the fastest cluster (by cpuinfo_max_freq) comes
+ * first. Homogeneous machines collapse into a single group.
+ */
+class CacheTopology : public ac::NonCopyable {
+public:
+    static CacheTopology& Instance();
+
+    const std::vector<std::vector<int>>& Groups() const;
+
+    bool IsHeterogeneous() const;
+
+    // Reads the topology below the given sysfs cpu directory;
+    // exposed separately for tests which bring their own tree.
+    static std::vector<std::vector<int>> ReadGroups(const std::string &sysfs_cpu_root);
+
+private:
+    CacheTopology();
+
+private:
+    std::vector<std::vector<int>> groups_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+
+#include "ac/common/clock.h"
+
+namespace {
+static std::atomic<ac::TimestampUs> cached_now_us{0};
+}
+
+namespace ac {
+namespace common {
+
+ac::TimestampUs Clock::NowUs() {
+    return static_cast<ac::TimestampUs>(Utils::GetNowUs());
+}
+
+ac::TimestampUs Clock::CoarseNowUs() {
+    const auto cached = cached_now_us.load(std::memory_order_relaxed);
+    if (cached == 0)
+        return Update();
+
+    return cached;
+}
+
+ac::TimestampUs Clock::Update() {
+    const auto now = NowUs();
+    cached_now_us.store(now, std::memory_order_relaxed);
+    return now;
+}
+
+} // namespace common
+} // namespace ac
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_CLOCK_H_
+#define AC_COMMON_CLOCK_H_
+
+#include "ac/utils.h"
+
+namespace ac {
+namespace common {
+
+// Process-wide monotonic clock with a cached coarse value for hot
+// paths. The pipeline refreshes the cache once per iteration via
+// Update(); code which only needs iteration granularity (like the
+// 100ms PAT/PMT cadence) reads it with CoarseNowUs() as a single
+// atomic load instead of going through the vDSO each time.
+struct Clock
+{
+    // Merely used as a namespace.
+    Clock() = delete;
+
+    // Precise monotonic timestamp; always performs a fresh clock read.
+    static ac::TimestampUs NowUs();
+
+    // Last value published through Update(). Falls back to a precise
+    // read until the first Update() happened.
+    static ac::TimestampUs CoarseNowUs();
+
+    // Refreshes the cached coarse value and returns the fresh reading.
+    static ac::TimestampUs Update();
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -39,6 +39,18 @@ public:
 
     virtual std::string Name() const = 0;
 
+    // Executables whose Execute() blocks indefinitely (running a main
+    // loop or waiting on external hardware) must keep their own thread
+    // and cannot be multiplexed onto a shared executor loop.
+    virtual bool PrefersDedicatedThread() const { return false; }
+
+    // Called from the pool watchdog when this stage has been stuck
+    // inside a single Execute() iteration past the stall threshold.
+    // A stage which can unwedge itself (kicking a hung hardware codec,
+    // say) returns true to hold off the pipeline-wide stall handler;
+    // the default leaves recovery to the session.
+    virtual bool RecoverFromStall() { return false; }
+
 protected:
     Executable() = default;
 };
@@ -15,15 +15,102 @@
  *
  */
 
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#include "ac/logger.h"
+#include "ac/utils.h"
+
 #include "ac/common/executorpool.h"
 
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace {
+// How often the watchdog looks at the stage heartbeats
+const std::chrono::milliseconds kWatchdogInterval{100};
+// A stage sitting inside a single Execute() iteration for this long
+// counts as stalled; every queue wait in the pipeline is orders of
+// magnitude shorter. Overridable (in milliseconds) or switched off
+// entirely through the environment.
+const std::chrono::milliseconds kDefaultStallThreshold{500};
+static constexpr const char *kWatchdogEnvName{"AETHERCAST_PIPELINE_WATCHDOG"};
+static constexpr const char *kWatchdogThreadName{"PoolWatchdog"};
+}
+
 namespace ac {
 namespace common {
 
+// Forwards to the real executable and timestamps every iteration so
+// the watchdog can tell a stage blocked inside Execute() from one
+// which is simply between iterations.
+class ExecutorPool::MonitoredExecutable : public Executable {
+public:
+    MonitoredExecutable(const Executable::Ptr &executable) :
+        executable_(executable),
+        in_execute_(false),
+        entered_at_us_(0) {
+    }
+
+    bool Start() override { return executable_->Start(); }
+    bool Stop() override { return executable_->Stop(); }
+
+    bool Execute() override {
+        entered_at_us_.store(ac::Utils::GetNowUs(), std::memory_order_relaxed);
+        in_execute_.store(true, std::memory_order_release);
+        const auto result = executable_->Execute();
+        in_execute_.store(false, std::memory_order_release);
+        return result;
+    }
+
+    std::string Name() const override { return executable_->Name(); }
+
+    bool PrefersDedicatedThread() const override {
+        return executable_->PrefersDedicatedThread();
+    }
+
+    bool RecoverFromStall() override {
+        return executable_->RecoverFromStall();
+    }
+
+    // Microseconds the current iteration has been running for, or
+    // zero when the stage sits between iterations.
+    std::int64_t BusyForUs(const std::int64_t &now_us) const {
+        if (!in_execute_.load(std::memory_order_acquire))
+            return 0;
+        return now_us - entered_at_us_.load(std::memory_order_relaxed);
+    }
+
+    // Gives the stage one recovery attempt per stuck iteration; an
+    // accepted attempt holds off the session-wide handler for grace_us
+    // so the recovery has time to actually unblock the stage. Only
+    // called from the watchdog thread.
+    bool TryRecover(const std::int64_t &now_us, const std::int64_t &grace_us) {
+        const auto entered = entered_at_us_.load(std::memory_order_relaxed);
+        if (recover_attempted_for_us_ != entered) {
+            recover_attempted_for_us_ = entered;
+            recover_attempted_at_us_ = now_us;
+            recover_accepted_ = executable_->RecoverFromStall();
+        }
+
+        return recover_accepted_ && now_us - recover_attempted_at_us_ < grace_us;
+    }
+
+private:
+    Executable::Ptr executable_;
+    std::atomic<bool> in_execute_;
+    std::atomic<std::int64_t> entered_at_us_;
+    std::int64_t recover_attempted_for_us_ = 0;
+    std::int64_t recover_attempted_at_us_ = 0;
+    bool recover_accepted_ = false;
+};
+
 ExecutorPool::ExecutorPool(const ExecutorFactory::Ptr &factory, const size_t &size) :
     size_(size),
     running_(false),
-    factory_(factory) {
+    factory_(factory),
+    stall_threshold_us_(kDefaultStallThreshold.count() * 1000ll),
+    watchdog_running_(false) {
 }
 
 ExecutorPool::~ExecutorPool() {
@@ -34,12 +121,17 @@ bool ExecutorPool::Add(const Executable::Ptr &executable) {
     if (items_.size() == size_ || running_)
         return false;
 
-    auto executor = factory_->Create(executable);
-    items_.emplace_back(Item{executable, executor});
+    auto monitor = std::make_shared<MonitoredExecutable>(executable);
+    auto executor = factory_->Create(monitor);
+    items_.emplace_back(Item{executable, monitor, executor});
 
     return true;
 }
 
+void ExecutorPool::SetStallHandler(const StallHandler &handler) {
+    stall_handler_ = handler;
+}
+
 bool ExecutorPool::Start() {
     if (running_)
         return false;
@@ -62,6 +154,9 @@ bool ExecutorPool::Start() {
 
     running_ = result;
 
+    if (running_)
+        StartWatchdog();
+
     return result;
 }
 
@@ -69,6 +164,10 @@ bool ExecutorPool::Stop() {
     if (!running_)
         return false;
 
+    // The watchdog goes first so a slow executor shutdown is never
+    // mistaken for a pipeline stall.
+    StopWatchdog();
+
     bool result = true;
     for (auto &item : items_)
         result &= item.executor->Stop();
@@ -83,5 +182,96 @@ bool ExecutorPool::Running() const {
     return running_;
 }
 
+void ExecutorPool::StartWatchdog() {
+    const auto env = Utils::GetEnvValue(kWatchdogEnvName);
+    if (env == "off")
+        return;
+
+    if (!env.empty() && std::atoi(env.c_str()) > 0)
+        stall_threshold_us_ = std::atoi(env.c_str()) * 1000ll;
+
+    watchdog_running_ = true;
+    watchdog_thread_ = std::thread(&ExecutorPool::WatchdogLoop, this);
+}
+
+void ExecutorPool::StopWatchdog() {
+    {
+        std::unique_lock<std::mutex> lock(watchdog_lock_);
+        if (!watchdog_running_)
+            return;
+        watchdog_running_ = false;
+    }
+
+    watchdog_wait_.notify_all();
+    watchdog_thread_.join();
+}
+
+void ExecutorPool::WatchdogLoop() {
+    Utils::SetThreadName(kWatchdogThreadName);
+
+    std::unique_lock<std::mutex> lock(watchdog_lock_);
+
+    // One report per stall; a recovering pipeline arms the watchdog
+    // again once every stage made progress.
+    bool reported = false;
+
+    while (watchdog_running_) {
+        watchdog_wait_.wait_for(lock, kWatchdogInterval);
+        if (!watchdog_running_)
+            break;
+
+        const auto now = static_cast<std::int64_t>(Utils::GetNowUs());
+
+        bool stalled = false;
+        for (const auto &item : items_) {
+            const auto busy_us = item.monitor->BusyForUs(now);
+            if (busy_us < stall_threshold_us_)
+                continue;
+
+            // A stage which can unwedge itself gets one attempt per
+            // stuck iteration, with a stall threshold worth of grace
+            // for it to take effect, before the whole session pays;
+            // only a recovery which itself goes nowhere escalates.
+            if (item.monitor->TryRecover(now, stall_threshold_us_))
+                continue;
+
+            stalled = true;
+        }
+
+        if (!stalled) {
+            reported = false;
+            continue;
+        }
+
+        if (reported)
+            continue;
+        reported = true;
+
+        AC_ERROR("Pipeline stalled; stage liveness:");
+        for (const auto &item : items_) {
+            const auto busy_us = item.monitor->BusyForUs(now);
+            AC_ERROR("  %s: %s for %lld ms",
+                     item.executable->Name().c_str(),
+                     busy_us > 0 ? "inside Execute()" : "between iterations",
+                     busy_us / 1000ll);
+        }
+
+        // The queue depth gauges and per-stage counters all live in
+        // the metrics registry; one snapshot shows where the data
+        // stopped flowing.
+        AC_ERROR("Runtime metrics at stall:\n%s",
+                 report::metrics::MetricsRegistry::Instance().SnapshotText().c_str());
+        report::metrics::MetricsRegistry::Instance().Increment("pipeline_stalls");
+
+        if (stall_handler_) {
+            // The handler typically schedules session teardown on the
+            // main loop; don't make it run under our lock.
+            lock.unlock();
+            stall_handler_();
+            lock.lock();
+        }
+    }
+}
+
 } // namespace common
 } // namespace ac
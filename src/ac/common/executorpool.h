@@ -19,7 +19,12 @@
 #define AC_COMMON_EXECUTORPOOL_H_
 
 #include <cstddef>
+#include <cstdint>
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "ac/non_copyable.h"
@@ -34,6 +39,10 @@ namespace common {
 
 class ExecutorPool : public ac::NonCopyable {
 public:
+    // Invoked once from the watchdog thread when a stage stops making
+    // progress; wire this up to the session recovery path.
+    typedef std::function<void()> StallHandler;
+
     ExecutorPool(const ExecutorFactory::Ptr &factory, const size_t &size);
     ~ExecutorPool();
 
@@ -44,16 +53,31 @@ public:
 
     bool Running() const;
 
+    void SetStallHandler(const StallHandler &handler);
+
 private:
+    class MonitoredExecutable;
+
     struct Item {
         Executable::Ptr executable;
+        std::shared_ptr<MonitoredExecutable> monitor;
         Executor::Ptr executor;
     };
 
+    void StartWatchdog();
+    void StopWatchdog();
+    void WatchdogLoop();
+
     std::uint32_t size_;
     bool running_;
     ExecutorFactory::Ptr factory_;
     std::vector<Item> items_;
+    StallHandler stall_handler_;
+    std::int64_t stall_threshold_us_;
+    bool watchdog_running_;
+    std::thread watchdog_thread_;
+    std::mutex watchdog_lock_;
+    std::condition_variable watchdog_wait_;
 };
 
 } // namespace common
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "ac/utils.h"
+#include "ac/logger.h"
+
+#include "ac/common/sharedthreadexecutor.h"
+#include "ac/common/threadscheduling.h"
+
+namespace {
+static constexpr const char *kSharedExecutorThreadName{"SharedExecutor"};
+}
+
+namespace ac {
+namespace common {
+
+class SharedThreadExecutor::Handle : public Executor {
+public:
+    Handle(const SharedThreadExecutor::Ptr &parent, const Executable::Ptr &executable) :
+        parent_(parent),
+        executable_(executable),
+        running_(false) {
+    }
+
+    ~Handle() {
+        Stop();
+    }
+
+    bool Start() override {
+        if (running_)
+            return false;
+
+        if (!parent_->Add(executable_))
+            return false;
+
+        running_ = true;
+        return true;
+    }
+
+    bool Stop() override {
+        if (!running_)
+            return false;
+
+        parent_->Remove(executable_);
+
+        running_ = false;
+        return true;
+    }
+
+    bool Running() const override {
+        return running_;
+    }
+
+private:
+    SharedThreadExecutor::Ptr parent_;
+    Executable::Ptr executable_;
+    std::atomic<bool> running_;
+};
+
+SharedThreadExecutor::Ptr SharedThreadExecutor::Create() {
+    return std::shared_ptr<SharedThreadExecutor>(new SharedThreadExecutor);
+}
+
+SharedThreadExecutor::SharedThreadExecutor() :
+    running_(true),
+    thread_(&SharedThreadExecutor::ThreadWorker, this) {
+}
+
+SharedThreadExecutor::~SharedThreadExecutor() {
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        running_.exchange(false);
+    }
+    wait_.notify_one();
+    thread_.join();
+}
+
+Executor::Ptr SharedThreadExecutor::CreateExecutor(const Executable::Ptr &executable) {
+    return std::make_shared<Handle>(shared_from_this(), executable);
+}
+
+bool SharedThreadExecutor::Add(const Executable::Ptr &executable) {
+    if (!executable->Start())
+        return false;
+
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        executables_.push_back(executable);
+    }
+    wait_.notify_one();
+
+    return true;
+}
+
+bool SharedThreadExecutor::Remove(const Executable::Ptr &executable) {
+    if (!executable->Stop())
+        AC_ERROR("Failed to stop executable %s", executable->Name().c_str());
+
+    std::unique_lock<std::mutex> l(mutex_);
+
+    auto it = std::find(executables_.begin(), executables_.end(), executable);
+    if (it == executables_.end())
+        return false;
+
+    executables_.erase(it);
+    return true;
+}
+
+void SharedThreadExecutor::ThreadWorker() {
+    ac::Utils::SetThreadName(kSharedExecutorThreadName);
+    ThreadScheduling::Apply(kSharedExecutorThreadName);
+
+    while (running_) {
+        std::vector<Executable::Ptr> current;
+
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            wait_.wait(l, [&]() { return !executables_.empty() || !running_; });
+            current = executables_;
+        }
+
+        // Every executable waits a short bounded time inside Execute()
+        // when it has nothing to do, so the round trip over all of
+        // them never spins hot.
+        for (const auto &executable : current) {
+            if (!running_)
+                break;
+
+            if (executable->Execute())
+                continue;
+
+            // Drop it from the loop but leave stopping the executable
+            // to whoever owns the executor handle, matching what
+            // ThreadedExecutor does when Execute() returns false.
+            std::unique_lock<std::mutex> l(mutex_);
+            auto it = std::find(executables_.begin(), executables_.end(), executable);
+            if (it != executables_.end())
+                executables_.erase(it);
+        }
+    }
+}
+
+} // namespace common
+} // namespace ac
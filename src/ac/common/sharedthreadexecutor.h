@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_SHAREDTHREADEXECUTOR_H_
+#define AC_COMMON_SHAREDTHREADEXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ac/common/executor.h"
+#include "ac/common/executable.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Runs multiple Executables round-robin on one worker thread.
+ *
+ * All executables whose Execute() returns after a bounded short wait
+ * can share a single thread instead of paying one thread plus the
+ * context switches per pipeline stage. Executables which block
+ * indefinitely inside Execute() (see
+ * Executable::PrefersDedicatedThread()) must not be multiplexed.
+ */
+class SharedThreadExecutor : public std::enable_shared_from_this<SharedThreadExecutor>,
+                             public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<SharedThreadExecutor> Ptr;
+
+    static Ptr Create();
+
+    ~SharedThreadExecutor();
+
+    // Returns an executor handle which adds the executable to the
+    // shared loop on Start() and removes it again on Stop().
+    Executor::Ptr CreateExecutor(const Executable::Ptr &executable);
+
+private:
+    class Handle;
+
+    SharedThreadExecutor();
+
+    bool Add(const Executable::Ptr &executable);
+    bool Remove(const Executable::Ptr &executable);
+
+    void ThreadWorker();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wait_;
+    std::vector<Executable::Ptr> executables_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/common/sharedthreadexecutorfactory.h"
+#include "ac/common/threadedexecutor.h"
+
+namespace ac {
+namespace common {
+
+SharedThreadExecutorFactory::SharedThreadExecutorFactory() :
+    shared_executor_(SharedThreadExecutor::Create()) {
+}
+
+Executor::Ptr SharedThreadExecutorFactory::Create(const Executable::Ptr &executable) {
+    if (executable->PrefersDedicatedThread())
+        return std::make_shared<ThreadedExecutor>(executable);
+
+    return shared_executor_->CreateExecutor(executable);
+}
+
+} // namespace common
+} // namespace ac
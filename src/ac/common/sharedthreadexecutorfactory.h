@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_SHAREDTHREADEXECUTORFACTORY_H_
+#define AC_COMMON_SHAREDTHREADEXECUTORFACTORY_H_
+
+#include "ac/common/executorfactory.h"
+#include "ac/common/sharedthreadexecutor.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Multiplexes all created executables onto one shared worker
+ * thread.
+ *
+ * Executables which need to block indefinitely inside Execute() still
+ * get their own thread; everything else shares a single loop which
+ * trades stage parallelism for fewer threads and context switches on
+ * small single-stream targets.
+ */
+class SharedThreadExecutorFactory : public ExecutorFactory {
+public:
+    SharedThreadExecutorFactory();
+
+    Executor::Ptr Create(const Executable::Ptr &executable) override;
+
+private:
+    SharedThreadExecutor::Ptr shared_executor_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ac/common/statistics.h"
+
+namespace ac {
+namespace common {
+
+PercentileEstimator::PercentileEstimator(double quantile) :
+    quantile_(quantile),
+    count_(0) {
+    for (int n = 0; n < 5; n++) {
+        heights_[n] = 0.0;
+        positions_[n] = n + 1;
+    }
+
+    desired_[0] = 1.0;
+    desired_[1] = 1.0 + 2.0 * quantile_;
+    desired_[2] = 1.0 + 4.0 * quantile_;
+    desired_[3] = 3.0 + 2.0 * quantile_;
+    desired_[4] = 5.0;
+
+    desired_increments_[0] = 0.0;
+    desired_increments_[1] = quantile_ / 2.0;
+    desired_increments_[2] = quantile_;
+    desired_increments_[3] = (1.0 + quantile_) / 2.0;
+    desired_increments_[4] = 1.0;
+}
+
+void PercentileEstimator::Add(double value) {
+    count_++;
+
+    // The first five observations seed the markers directly
+    if (count_ <= 5) {
+        heights_[count_ - 1] = value;
+        if (count_ == 5)
+            std::sort(heights_, heights_ + 5);
+        return;
+    }
+
+    int cell = 0;
+    if (value < heights_[0]) {
+        heights_[0] = value;
+        cell = 0;
+    } else if (value >= heights_[4]) {
+        heights_[4] = value;
+        cell = 3;
+    } else {
+        while (cell < 3 && value >= heights_[cell + 1])
+            cell++;
+    }
+
+    for (int n = cell + 1; n < 5; n++)
+        positions_[n] += 1.0;
+    for (int n = 0; n < 5; n++)
+        desired_[n] += desired_increments_[n];
+
+    // Nudge the inner markers towards their desired positions,
+    // adjusting the height estimates with a piecewise-parabolic
+    // (hence P squared) prediction, falling back to linear when the
+    // parabolic step would push a marker past its neighbour.
+    for (int n = 1; n < 4; n++) {
+        const double delta = desired_[n] - positions_[n];
+
+        if ((delta >= 1.0 && positions_[n + 1] - positions_[n] > 1.0) ||
+                (delta <= -1.0 && positions_[n - 1] - positions_[n] < -1.0)) {
+            const double direction = delta >= 0 ? 1.0 : -1.0;
+
+            const double parabolic = heights_[n] + direction / (positions_[n + 1] - positions_[n - 1]) *
+                ((positions_[n] - positions_[n - 1] + direction) * (heights_[n + 1] - heights_[n]) /
+                    (positions_[n + 1] - positions_[n]) +
+                 (positions_[n + 1] - positions_[n] - direction) * (heights_[n] - heights_[n - 1]) /
+                    (positions_[n] - positions_[n - 1]));
+
+            if (heights_[n - 1] < parabolic && parabolic < heights_[n + 1])
+                heights_[n] = parabolic;
+            else
+                heights_[n] = heights_[n] + direction * (heights_[n + static_cast<int>(direction)] - heights_[n]) /
+                    (positions_[n + static_cast<int>(direction)] - positions_[n]);
+
+            positions_[n] += direction;
+        }
+    }
+}
+
+double PercentileEstimator::Estimate() const {
+    if (count_ == 0)
+        return 0.0;
+
+    // Exact until the markers are seeded
+    if (count_ < 5) {
+        double sorted[5];
+        std::copy(heights_, heights_ + count_, sorted);
+        std::sort(sorted, sorted + count_);
+        auto index = static_cast<int>(std::ceil(quantile_ * count_)) - 1;
+        if (index < 0)
+            index = 0;
+        return sorted[index];
+    }
+
+    return heights_[2];
+}
+
+namespace {
+const std::vector<double> kDefaultQuantiles{0.5, 0.9, 0.99};
+}
+
+Statistics::Statistics() :
+    Statistics(kDefaultQuantiles) {
+}
+
+Statistics::Statistics(const std::vector<double> &quantiles) :
+    count_(0),
+    min_(std::numeric_limits<double>::max()),
+    max_(std::numeric_limits<double>::lowest()),
+    mean_(0.0),
+    m2_(0.0),
+    quantiles_(quantiles) {
+    for (const auto quantile : quantiles_)
+        estimators_.push_back(PercentileEstimator(quantile));
+}
+
+void Statistics::Add(double value) {
+    count_++;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+
+    const double delta = value - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (value - mean_);
+
+    for (auto &estimator : estimators_)
+        estimator.Add(value);
+}
+
+double Statistics::StdDev() const {
+    if (count_ < 2)
+        return 0.0;
+    return std::sqrt(m2_ / (count_ - 1));
+}
+
+double Statistics::Quantile(double quantile) const {
+    for (std::size_t n = 0; n < quantiles_.size(); n++) {
+        if (quantiles_[n] == quantile)
+            return estimators_[n].Estimate();
+    }
+    return 0.0;
+}
+
+} // namespace common
+} // namespace ac
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_STATISTICS_H_
+#define AC_COMMON_STATISTICS_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace ac {
+namespace common {
+
+// Estimates a single quantile of a stream of observations in O(1)
+// memory with the P² algorithm (Jain & Chlamtac 1985). Good enough
+// for live latency percentiles in the daemon where keeping the raw
+// samples around is not an option.
+class PercentileEstimator {
+public:
+    // quantile is in (0, 1), e.g. 0.99 for the 99th percentile.
+    explicit PercentileEstimator(double quantile);
+
+    void Add(double value);
+
+    // Current estimate; exact while fewer than five observations
+    // have been seen.
+    double Estimate() const;
+
+    std::uint64_t Count() const { return count_; }
+
+private:
+    double quantile_;
+    std::uint64_t count_;
+    // The five P² markers: their heights (estimates), actual
+    // positions and the positions they should ideally be at.
+    double heights_[5];
+    double positions_[5];
+    double desired_[5];
+    double desired_increments_[5];
+};
+
+// Streaming summary over a series of observations: count, min, max,
+// mean and standard deviation (Welford's method) plus a configurable
+// set of percentiles, all in fixed memory. Not thread-safe; callers
+// either own it from a single thread or guard it themselves.
+class Statistics {
+public:
+    // Tracks the median, 90th and 99th percentile by default.
+    Statistics();
+    explicit Statistics(const std::vector<double> &quantiles);
+
+    void Add(double value);
+
+    std::uint64_t Count() const { return count_; }
+    double Min() const { return min_; }
+    double Max() const { return max_; }
+    double Mean() const { return mean_; }
+    double StdDev() const;
+
+    // Estimate for one of the quantiles handed to the constructor;
+    // returns 0 for a quantile that is not tracked.
+    double Quantile(double quantile) const;
+
+private:
+    std::uint64_t count_;
+    double min_;
+    double max_;
+    double mean_;
+    double m2_;
+    std::vector<double> quantiles_;
+    std::vector<PercentileEstimator> estimators_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
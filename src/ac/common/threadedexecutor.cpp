@@ -19,6 +19,7 @@
 #include "ac/logger.h"
 
 #include "ac/common/threadedexecutor.h"
+#include "ac/common/threadscheduling.h"
 
 namespace ac {
 namespace common {
@@ -36,6 +37,7 @@ ThreadedExecutor::~ThreadedExecutor() {
 void ThreadedExecutor::ThreadWorker() {
     if (executable_->Name().length() > 0) {
         ac::Utils::SetThreadName(executable_->Name());
+        ThreadScheduling::Apply(executable_->Name());
         AC_DEBUG("Started threaded executor %s", executable_->Name());
     }
 
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "ac/utils.h"
+#include "ac/logger.h"
+
+#include "ac/common/cachetopology.h"
+#include "ac/common/threadscheduling.h"
+
+namespace {
+static constexpr const char *kSchedEnvName{"AETHERCAST_THREAD_SCHED"};
+static constexpr const char *kAffinityEnvName{"AETHERCAST_THREAD_AFFINITY"};
+static constexpr const char *kTopologyEnvName{"AETHERCAST_THREAD_TOPOLOGY"};
+
+bool ApplySchedEntry(const std::string &name, const std::string &entry) {
+    const auto fields = ac::Utils::StringSplit(entry, ':');
+    if (fields.size() != 3 || fields.at(0) != name)
+        return false;
+
+    int policy = SCHED_OTHER;
+    if (fields.at(1) == "fifo")
+        policy = SCHED_FIFO;
+    else if (fields.at(1) == "rr")
+        policy = SCHED_RR;
+    else if (fields.at(1) != "other") {
+        AC_WARNING("Unknown scheduling class '%s' for thread %s",
+                   fields.at(1).c_str(), name.c_str());
+        return true;
+    }
+
+    struct sched_param param;
+    ::memset(&param, 0, sizeof(param));
+    param.sched_priority = std::atoi(fields.at(2).c_str());
+
+    if (::pthread_setschedparam(::pthread_self(), policy, &param) != 0)
+        AC_WARNING("Failed to apply scheduling class %s priority %d to thread %s; missing CAP_SYS_NICE?",
+                   fields.at(1).c_str(), param.sched_priority, name.c_str());
+    else
+        AC_DEBUG("Thread %s now runs with scheduling class %s priority %d",
+                 name.c_str(), fields.at(1).c_str(), param.sched_priority);
+
+    return true;
+}
+
+bool ApplyAffinityEntry(const std::string &name, const std::string &entry) {
+    const auto fields = ac::Utils::StringSplit(entry, ':');
+    if (fields.size() != 2 || fields.at(0) != name)
+        return false;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+
+    for (const auto &cpu : ac::Utils::StringSplit(fields.at(1), '+'))
+        CPU_SET(std::atoi(cpu.c_str()), &cpus);
+
+    if (::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus) != 0)
+        AC_WARNING("Failed to apply CPU affinity '%s' to thread %s",
+                   fields.at(1).c_str(), name.c_str());
+    else
+        AC_DEBUG("Thread %s now pinned to CPUs %s", name.c_str(), fields.at(1).c_str());
+
+    return true;
+}
+
+bool EndsWith(const std::string &str, const std::string &suffix) {
+    return str.size() >= suffix.size()
+            && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Pipeline stages whose threads trade buffers every iteration and
+// therefore want to share a cache; -1 means no placement policy
+int PipelineStage(const std::string &name) {
+    // Capture hands raw frames to the encoder
+    if (name == "StreamRenderer" || EndsWith(name, "H264Encoder"))
+        return 0;
+
+    // Packetizing passes the transport packets on to the sender
+    if (name == "MediaSender" || name == "RTPSender" || name == "RTCPReceiver")
+        return 1;
+
+    return -1;
+}
+
+// Default placement from the cache topology: both stages get pinned
+// to a whole shared-L2 cluster each so the scheduler can't split a
+// buffer handoff across clusters. Explicit affinity entries and
+// AETHERCAST_THREAD_TOPOLOGY=off win over this.
+void ApplyTopologyPlacement(const std::string &name) {
+    if (ac::Utils::GetEnvValue(kTopologyEnvName) == "off")
+        return;
+
+    const auto stage = PipelineStage(name);
+    if (stage < 0)
+        return;
+
+    const auto &groups = ac::common::CacheTopology::Instance().Groups();
+    // On a flat topology every core already shares the L2
+    if (groups.size() < 2)
+        return;
+
+    // The heavy capture/encode stage takes the fastest cluster, the
+    // transport stage the next one so the two handoff domains don't
+    // compete for the same cache
+    const auto &group = groups.at(std::min<std::size_t>(stage, groups.size() - 1));
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (const auto cpu : group)
+        CPU_SET(cpu, &cpus);
+
+    if (::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus) != 0) {
+        AC_WARNING("Failed to place thread %s on its shared cache CPU group", name.c_str());
+        return;
+    }
+
+    std::string cpu_list;
+    for (const auto cpu : group)
+        cpu_list += (cpu_list.empty() ? "" : "+") + std::to_string(cpu);
+    AC_DEBUG("Thread %s placed on shared L2 CPUs %s", name.c_str(), cpu_list.c_str());
+}
+}
+
+namespace ac {
+namespace common {
+
+void ThreadScheduling::Apply(const std::string &name) {
+    if (name.empty())
+        return;
+
+    for (const auto &entry : Utils::StringSplit(Utils::GetEnvValue(kSchedEnvName), ',')) {
+        if (ApplySchedEntry(name, entry))
+            break;
+    }
+
+    bool affinity_configured = false;
+    for (const auto &entry : Utils::StringSplit(Utils::GetEnvValue(kAffinityEnvName), ',')) {
+        if (ApplyAffinityEntry(name, entry)) {
+            affinity_configured = true;
+            break;
+        }
+    }
+
+    if (!affinity_configured)
+        ApplyTopologyPlacement(name);
+}
+
+} // namespace common
+} // namespace ac
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_THREADSCHEDULING_H_
+#define AC_COMMON_THREADSCHEDULING_H_
+
+#include <string>
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Applies per-thread scheduling class, priority and CPU
+ * affinity configured through the environment.
+ *
+ * Threads are looked up by their Executable::Name(). The format is a
+ * comma separated list of entries:
+ *
+ *   AETHERCAST_THREAD_SCHED=RTPSender:fifo:20,MediaSender:rr:10
+ *   AETHERCAST_THREAD_AFFINITY=RTPSender:2+3,MediaSender:1
+ *
+ * where the scheduling class is one of fifo/rr/other and CPUs in the
+ * affinity mask are joined with '+'. Threads without an entry keep
+ * the default scheduling. Raising the scheduling class usually needs
+ * CAP_SYS_NICE; failures are logged and otherwise ignored.
+ */
+class ThreadScheduling {
+public:
+    // Applies the configuration matching name to the calling thread
+    static void Apply(const std::string &name);
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "ac/utils.h"
+#include "ac/logger.h"
+
+#include "ac/common/threadscheduling.h"
+#include "ac/common/workstealingexecutor.h"
+
+namespace {
+static constexpr const char *kPoolWorkerThreadName{"PoolWorker"};
+static constexpr const char *kPoolSizeEnvName{"AETHERCAST_EXECUTOR_POOL_SIZE"};
+
+std::uint32_t DefaultWorkerCount() {
+    const auto env_value = ac::Utils::GetEnvValue(kPoolSizeEnvName);
+    if (!env_value.empty() && std::atoi(env_value.c_str()) > 0)
+        return std::atoi(env_value.c_str());
+
+    // Half the online cores approximates the big cluster on the
+    // big.LITTLE devices we care about; never less than two so one
+    // stalled task cannot freeze the whole pool.
+    return std::max(2u, std::thread::hardware_concurrency() / 2);
+}
+}
+
+namespace ac {
+namespace common {
+
+class WorkStealingExecutor::Handle : public Executor {
+public:
+    Handle(const WorkStealingExecutor::Ptr &parent, const Executable::Ptr &executable) :
+        parent_(parent),
+        executable_(executable),
+        running_(false) {
+    }
+
+    ~Handle() {
+        Stop();
+    }
+
+    bool Start() override {
+        if (running_)
+            return false;
+
+        if (!parent_->Add(executable_))
+            return false;
+
+        running_ = true;
+        return true;
+    }
+
+    bool Stop() override {
+        if (!running_)
+            return false;
+
+        parent_->Remove(executable_);
+
+        running_ = false;
+        return true;
+    }
+
+    bool Running() const override {
+        return running_;
+    }
+
+private:
+    WorkStealingExecutor::Ptr parent_;
+    Executable::Ptr executable_;
+    std::atomic<bool> running_;
+};
+
+WorkStealingExecutor::Ptr WorkStealingExecutor::Create(std::uint32_t worker_count) {
+    if (worker_count == 0)
+        worker_count = DefaultWorkerCount();
+    return std::shared_ptr<WorkStealingExecutor>(new WorkStealingExecutor(worker_count));
+}
+
+WorkStealingExecutor::Ptr WorkStealingExecutor::SharedInstance() {
+    static std::mutex instance_mutex;
+    static std::weak_ptr<WorkStealingExecutor> instance;
+
+    std::lock_guard<std::mutex> guard(instance_mutex);
+    auto sp = instance.lock();
+    if (!sp) {
+        sp = Create();
+        instance = sp;
+    }
+    return sp;
+}
+
+WorkStealingExecutor::WorkStealingExecutor(std::uint32_t worker_count) :
+    pending_(0),
+    next_worker_(0),
+    running_(true) {
+    for (std::uint32_t n = 0; n < worker_count; n++)
+        workers_.push_back(std::unique_ptr<Worker>(new Worker));
+
+    // Threads only start once all workers exist as everyone may
+    // steal from everyone.
+    for (std::uint32_t n = 0; n < worker_count; n++)
+        workers_[n]->thread = std::thread(&WorkStealingExecutor::ThreadWorker, this, n);
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    {
+        std::unique_lock<std::mutex> l(members_mutex_);
+        running_.exchange(false);
+    }
+    wait_.notify_all();
+
+    for (auto &worker : workers_)
+        worker->thread.join();
+}
+
+Executor::Ptr WorkStealingExecutor::CreateExecutor(const Executable::Ptr &executable) {
+    return std::make_shared<Handle>(shared_from_this(), executable);
+}
+
+std::uint32_t WorkStealingExecutor::WorkerCount() const {
+    return workers_.size();
+}
+
+bool WorkStealingExecutor::Add(const Executable::Ptr &executable) {
+    if (!executable->Start())
+        return false;
+
+    bool needs_enqueue = false;
+
+    {
+        std::unique_lock<std::mutex> l(members_mutex_);
+
+        if (std::find(members_.begin(), members_.end(), executable) != members_.end())
+            return false;
+
+        members_.push_back(executable);
+
+        // A leftover in-flight entry from a previous membership keeps
+        // cycling on its own; a second one would let two workers run
+        // the same executable concurrently.
+        if (std::find(inflight_.begin(), inflight_.end(), executable) == inflight_.end()) {
+            inflight_.push_back(executable);
+            needs_enqueue = true;
+        }
+    }
+
+    if (needs_enqueue)
+        Enqueue(next_worker_++ % workers_.size(), executable);
+
+    return true;
+}
+
+bool WorkStealingExecutor::Remove(const Executable::Ptr &executable) {
+    if (!executable->Stop())
+        AC_ERROR("Failed to stop executable %s", executable->Name().c_str());
+
+    std::unique_lock<std::mutex> l(members_mutex_);
+
+    auto it = std::find(members_.begin(), members_.end(), executable);
+    if (it == members_.end())
+        return false;
+
+    // The queue entry (or running task) drains on its own once the
+    // owning worker notices the membership is gone.
+    members_.erase(it);
+    return true;
+}
+
+void WorkStealingExecutor::Enqueue(std::uint32_t index, const Executable::Ptr &executable) {
+    {
+        std::lock_guard<std::mutex> guard(workers_[index]->mutex);
+        workers_[index]->queue.push_back(executable);
+    }
+    ++pending_;
+    wait_.notify_one();
+}
+
+Executable::Ptr WorkStealingExecutor::TakeTask(std::uint32_t index) {
+    {
+        std::lock_guard<std::mutex> guard(workers_[index]->mutex);
+        auto &queue = workers_[index]->queue;
+        if (!queue.empty()) {
+            const auto task = queue.front();
+            queue.pop_front();
+            --pending_;
+            return task;
+        }
+    }
+
+    // Steal from the back so the victim keeps the tasks it touched
+    // most recently and their still-warm cache lines.
+    for (std::uint32_t offset = 1; offset < workers_.size(); offset++) {
+        const auto victim = (index + offset) % workers_.size();
+        std::lock_guard<std::mutex> guard(workers_[victim]->mutex);
+        auto &queue = workers_[victim]->queue;
+        if (queue.empty())
+            continue;
+
+        const auto task = queue.back();
+        queue.pop_back();
+        --pending_;
+        return task;
+    }
+
+    return nullptr;
+}
+
+void WorkStealingExecutor::ThreadWorker(std::uint32_t index) {
+    ac::Utils::SetThreadName(kPoolWorkerThreadName);
+    ThreadScheduling::Apply(kPoolWorkerThreadName);
+
+    while (running_) {
+        const auto task = TakeTask(index);
+        if (!task) {
+            std::unique_lock<std::mutex> l(members_mutex_);
+            wait_.wait(l, [&]() { return pending_ > 0 || !running_; });
+            continue;
+        }
+
+        // Every pooled executable waits a short bounded time inside
+        // Execute() when it has nothing to do, so cycling over them
+        // never spins hot.
+        const auto keep = task->Execute();
+
+        std::unique_lock<std::mutex> l(members_mutex_);
+
+        const auto member = std::find(members_.begin(), members_.end(), task) != members_.end();
+        if (keep && member && running_) {
+            l.unlock();
+            Enqueue(index, task);
+            continue;
+        }
+
+        // Either the executable asked to stop or its handle removed
+        // it; stopping the executable is left to whoever owns the
+        // handle, matching ThreadedExecutor.
+        if (!keep && member)
+            members_.erase(std::find(members_.begin(), members_.end(), task));
+
+        inflight_.erase(std::find(inflight_.begin(), inflight_.end(), task));
+    }
+}
+
+} // namespace common
+} // namespace ac
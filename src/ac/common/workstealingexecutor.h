@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_WORKSTEALINGEXECUTOR_H_
+#define AC_COMMON_WORKSTEALINGEXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ac/common/executor.h"
+#include "ac/common/executable.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Runs Executables as cooperative tasks on a fixed set of
+ * worker threads with work-stealing between them.
+ *
+ * Where SharedThreadExecutor trades all parallelism for a single
+ * thread, this keeps M workers for N executables: each worker owns a
+ * queue, an executable goes back on the queue of whichever worker ran
+ * it last and idle workers steal from the opposite end of their
+ * neighbours' queues. Thread count therefore stays constant as
+ * sessions come and go, and concurrent sessions get balanced over the
+ * same few (ideally big) cores instead of one thread per pipeline
+ * stage getting scattered across the whole topology.
+ *
+ * An executable is represented by exactly one queue entry at any
+ * time, so Execute() is never entered concurrently for the same
+ * executable. Executables which block indefinitely inside Execute()
+ * (see Executable::PrefersDedicatedThread()) must not be pooled as
+ * they would starve every other task on their worker.
+ */
+class WorkStealingExecutor : public std::enable_shared_from_this<WorkStealingExecutor>,
+                             public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<WorkStealingExecutor> Ptr;
+
+    // A worker_count of zero picks the AETHERCAST_EXECUTOR_POOL_SIZE
+    // environment value or, failing that, half the online cores which
+    // on big.LITTLE targets roughly matches the big cluster.
+    static Ptr Create(std::uint32_t worker_count = 0);
+
+    // Process-wide pool shared by everyone who does not bring their
+    // own; it is created on first use and torn down again once the
+    // last user lets go of it.
+    static Ptr SharedInstance();
+
+    ~WorkStealingExecutor();
+
+    // Returns an executor handle which schedules the executable on
+    // the pool on Start() and removes it again on Stop().
+    Executor::Ptr CreateExecutor(const Executable::Ptr &executable);
+
+    std::uint32_t WorkerCount() const;
+
+private:
+    class Handle;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Executable::Ptr> queue;
+        std::thread thread;
+    };
+
+    explicit WorkStealingExecutor(std::uint32_t worker_count);
+
+    bool Add(const Executable::Ptr &executable);
+    bool Remove(const Executable::Ptr &executable);
+
+    void Enqueue(std::uint32_t index, const Executable::Ptr &executable);
+    Executable::Ptr TakeTask(std::uint32_t index);
+
+    void ThreadWorker(std::uint32_t index);
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex members_mutex_;
+    std::condition_variable wait_;
+    // Everything currently scheduled on the pool ..
+    std::vector<Executable::Ptr> members_;
+    // .. and everything still represented by a queue entry or a
+    // running Execute(); the two drift apart while a removal waits
+    // for its in-flight task to drain.
+    std::vector<Executable::Ptr> inflight_;
+    std::atomic<std::uint32_t> pending_;
+    std::atomic<std::uint32_t> next_worker_;
+    std::atomic<bool> running_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_WORKSTEALINGEXECUTORFACTORY_H_
+#define AC_COMMON_WORKSTEALINGEXECUTORFACTORY_H_
+
+#include "ac/common/executorfactory.h"
+#include "ac/common/workstealingexecutor.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Schedules all created executables onto the process-wide
+ * work-stealing worker pool.
+ *
+ * Unlike SharedThreadExecutorFactory every factory instance refers to
+ * the same pool, so the pipelines of concurrent sessions balance over
+ * one fixed set of worker threads instead of each session growing its
+ * own. Executables which need to block indefinitely inside Execute()
+ * still get their own thread.
+ */
+class WorkStealingExecutorFactory : public ExecutorFactory {
+public:
+    WorkStealingExecutorFactory();
+
+    Executor::Ptr Create(const Executable::Ptr &executable) override;
+
+private:
+    WorkStealingExecutor::Ptr pool_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -19,6 +19,8 @@
 #define AC_CONTROLLER_H_
 
 #include <chrono>
+#include <cstdint>
+#include <map>
 #include <memory>
 
 #include "networkmanager.h"
@@ -26,6 +28,8 @@
 #include "non_copyable.h"
 #include "types.h"
 
+#include "video/snapshottap.h"
+
 namespace ac {
 class Controller : private ac::NonCopyable
 {
@@ -58,6 +62,19 @@ public:
 
     virtual NetworkDeviceState State() const = 0;
     virtual std::vector<NetworkManager::Capability> Capabilities() const = 0;
+    virtual std::vector<std::string> ConnectionTrace() const = 0;
+    virtual std::map<std::string, std::uint64_t> RuntimeMetrics() const = 0;
+    // Returns a read-only descriptor for the shared memory ring the
+    // encoded video frames are published through, or -1 when the tap
+    // cannot be set up.
+    virtual int OpenFrameTap() = 0;
+    // Grabs a downscaled copy of the frame currently being cast from
+    // the live capture path; false while nothing is streaming.
+    virtual bool TakeSnapshot(std::uint32_t max_width, video::SnapshotTap::Image *image) = 0;
+    // Whether the network backend finished its bring-up; the service
+    // is on the bus before that happens so clients can watch this
+    // property instead of polling for the daemon.
+    virtual bool Ready() const = 0;
     virtual bool Scanning() const = 0;
     virtual bool Enabled() const = 0;
 
@@ -17,13 +17,18 @@
 
 #include <algorithm>
 
+#include <unistd.h>
+
 #include <boost/concept_check.hpp>
 
+#include <gio/gunixfdlist.h>
+
 #include "ac/glib_wrapper.h"
 
 #include "ac/keep_alive.h"
 #include "ac/utils.h"
 #include "ac/logger.h"
+#include "ac/report/startuptrace.h"
 
 #include "ac/dbus/controllerskeleton.h"
 #include "ac/dbus/errors.h"
@@ -44,7 +49,8 @@ ControllerSkeleton::ControllerSkeleton(const std::shared_ptr<Controller> &contro
     manager_obj_(nullptr),
     bus_connection_(nullptr),
     bus_id_(0),
-    object_manager_(nullptr) {
+    object_manager_(nullptr),
+    last_state_(nullptr) {
 }
 
 ControllerSkeleton::~ControllerSkeleton() {
@@ -58,25 +64,72 @@ ControllerSkeleton::~ControllerSkeleton() {
 }
 
 void ControllerSkeleton::SyncProperties() {
-    aethercast_interface_manager_set_state(manager_obj_.get(),
-                                           NetworkDevice::StateToStr(State()).c_str());
-
-    auto capabilities = Helpers::GenerateCapabilities(Capabilities());
-
-    aethercast_interface_manager_set_capabilities(manager_obj_.get(), capabilities);
+    // Batch the updates below so listeners see one PropertiesChanged
+    // per main loop iteration instead of a wakeup per property.
+    g_object_freeze_notify(G_OBJECT(manager_obj_.get()));
+
+    const auto state = Helpers::InternedDeviceStateStr(State());
+    if (state != last_state_) {
+        aethercast_interface_manager_set_state(manager_obj_.get(), state);
+        last_state_ = state;
+    }
 
-    g_strfreev(capabilities);
+    const auto current_capabilities = Capabilities();
+    if (current_capabilities != last_capabilities_) {
+        auto capabilities = Helpers::GenerateCapabilities(current_capabilities);
+        aethercast_interface_manager_set_capabilities(manager_obj_.get(), capabilities);
+        g_free(capabilities);
+        last_capabilities_ = current_capabilities;
+    }
 
+    // The boolean properties are cheap to set; the generated property
+    // cache already swallows unchanged values for those.
     aethercast_interface_manager_set_scanning(manager_obj_.get(), Scanning());
     aethercast_interface_manager_set_enabled(manager_obj_.get(), Enabled());
+    aethercast_interface_manager_set_ready(manager_obj_.get(), Ready());
+
+    SyncConnectionTrace();
+
+    g_object_thaw_notify(G_OBJECT(manager_obj_.get()));
+}
+
+void ControllerSkeleton::SyncConnectionTrace() {
+    const auto trace = ConnectionTrace();
+    if (trace == last_trace_)
+        return;
+
+    // The stage strings stay alive inside the trace vector for the
+    // duration of the set call so only the array has to be built.
+    auto stages = g_new0(const gchar*, trace.size() + 1);
+    int n = 0;
+    for (const auto &stage : trace)
+        stages[n++] = stage.c_str();
+    stages[n] = nullptr;
+
+    aethercast_interface_manager_set_connection_trace(manager_obj_.get(), stages);
+
+    g_free(stages);
+
+    last_trace_ = trace;
 }
 
 void ControllerSkeleton::OnStateChanged(NetworkDeviceState state) {
     if (!manager_obj_)
         return;
 
-    aethercast_interface_manager_set_state(manager_obj_.get(),
-                                           NetworkDevice::StateToStr(State()).c_str());
+    g_object_freeze_notify(G_OBJECT(manager_obj_.get()));
+
+    const auto state_str = Helpers::InternedDeviceStateStr(state);
+    if (state_str != last_state_) {
+        aethercast_interface_manager_set_state(manager_obj_.get(), state_str);
+        last_state_ = state_str;
+    }
+
+    // Every state transition appends to the trace so republish it
+    // alongside the state itself.
+    SyncConnectionTrace();
+
+    g_object_thaw_notify(G_OBJECT(manager_obj_.get()));
 }
 
 std::string ControllerSkeleton::GenerateDevicePath(const NetworkDevice::Ptr &device) const {
@@ -91,27 +144,30 @@ void ControllerSkeleton::OnDeviceFound(const NetworkDevice::Ptr &device) {
 
     auto path = GenerateDevicePath(device);
     auto adapter = NetworkDeviceSkeleton::Create(bus_connection_, path , device, shared_from_this());
-    devices_.insert(std::pair<std::string,NetworkDeviceSkeleton::Ptr>(device->Address(), adapter));
+    devices_.Insert(device->Address(), adapter);
 
-    g_dbus_object_manager_server_export(object_manager_.get(), adapter->DBusObject());
+    // If the bus name isn't acquired yet the object manager doesn't
+    // exist; the device gets exported with all others once it does so
+    // a GetManagedObjects call always sees the full inventory.
+    if (object_manager_)
+        g_dbus_object_manager_server_export(object_manager_.get(), adapter->DBusObject());
 }
 
 void ControllerSkeleton::OnDeviceLost(const NetworkDevice::Ptr &device) {
-    auto iter = devices_.find(device->Address());
-    if (iter == devices_.end())
+    const auto adapter = devices_.Take(device->Address());
+    if (!adapter)
         return;
 
-    g_dbus_object_manager_server_unexport(object_manager_.get(), iter->second->Path().c_str());
-
-    devices_.erase(iter);
+    if (object_manager_)
+        g_dbus_object_manager_server_unexport(object_manager_.get(), adapter->Path().c_str());
 }
 
 void ControllerSkeleton::OnDeviceChanged(const NetworkDevice::Ptr &peer) {
-    auto iter = devices_.find(peer->Address());
-    if (iter == devices_.end())
+    const auto adapter = devices_.Find(peer->Address());
+    if (!adapter)
         return;
 
-    iter->second->SyncProperties();
+    adapter->SyncProperties();
 }
 
 void ControllerSkeleton::OnChanged() {
@@ -175,6 +231,9 @@ gboolean ControllerSkeleton::OnSetProperty(GDBusConnection *connection, const gc
 void ControllerSkeleton::OnNameAcquired(GDBusConnection *connection, const gchar *name, gpointer user_data) {
     auto inst = static_cast<SharedKeepAlive<ControllerSkeleton>*>(user_data)->ShouldDie();
 
+    // Activation-blocked clients are unblocked from this point on.
+    report::StartupTrace::Instance().Mark(report::kStartupMilestoneNameAcquired);
+
     inst->manager_obj_.reset(aethercast_interface_manager_skeleton_new());
     g_object_set_data(G_OBJECT(inst->manager_obj_.get()), kManagerSkeletonInstanceKey,
                       new WeakKeepAlive<ControllerSkeleton>(inst));
@@ -197,6 +256,24 @@ void ControllerSkeleton::OnNameAcquired(GDBusConnection *connection, const gchar
                      [](gpointer data, GClosure *) { delete static_cast<WeakKeepAlive<ControllerSkeleton>*>(data); },
                      GConnectFlags(0));
 
+    g_signal_connect_data(inst->manager_obj_.get(), "handle-get-runtime-metrics",
+                     G_CALLBACK(&ControllerSkeleton::OnHandleGetRuntimeMetrics),
+                     new WeakKeepAlive<ControllerSkeleton>(inst),
+                     [](gpointer data, GClosure *) { delete static_cast<WeakKeepAlive<ControllerSkeleton>*>(data); },
+                     GConnectFlags(0));
+
+    g_signal_connect_data(inst->manager_obj_.get(), "handle-open-frame-tap",
+                     G_CALLBACK(&ControllerSkeleton::OnHandleOpenFrameTap),
+                     new WeakKeepAlive<ControllerSkeleton>(inst),
+                     [](gpointer data, GClosure *) { delete static_cast<WeakKeepAlive<ControllerSkeleton>*>(data); },
+                     GConnectFlags(0));
+
+    g_signal_connect_data(inst->manager_obj_.get(), "handle-take-snapshot",
+                     G_CALLBACK(&ControllerSkeleton::OnHandleTakeSnapshot),
+                     new WeakKeepAlive<ControllerSkeleton>(inst),
+                     [](gpointer data, GClosure *) { delete static_cast<WeakKeepAlive<ControllerSkeleton>*>(data); },
+                     GConnectFlags(0));
+
     inst->SyncProperties();
 
     g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(inst->manager_obj_.get()),
@@ -205,6 +282,13 @@ void ControllerSkeleton::OnNameAcquired(GDBusConnection *connection, const gchar
     inst->object_manager_.reset(g_dbus_object_manager_server_new(kManagerPath));
     g_dbus_object_manager_server_set_connection(inst->object_manager_.get(), connection);
 
+    // Export everything we found before the name was acquired so
+    // clients enumerating through GetManagedObjects get the complete
+    // device inventory in that one round-trip.
+    inst->devices_.ForEach([&inst](const std::string&, const NetworkDeviceSkeleton::Ptr &adapter) {
+        g_dbus_object_manager_server_export(inst->object_manager_.get(), adapter->DBusObject());
+    });
+
     AC_INFO("Registered bus name %s", name);
 }
 
@@ -247,7 +331,7 @@ gboolean ControllerSkeleton::OnHandleDisconnectAll(AethercastInterfaceManager *s
     g_object_ref(invocation);
     auto inv = make_shared_gobject(invocation);
 
-    inst->DisconnectAll([inv](ac::Error error) {
+    inst->DisconnectAll([inv = std::move(inv)](ac::Error error) {
         if (error != Error::kNone) {
             g_dbus_method_invocation_return_error(inv.get(), AETHERCAST_ERROR,
                 AethercastErrorFromError(error), "%s", ac::ErrorToString(error).c_str());
@@ -260,6 +344,94 @@ gboolean ControllerSkeleton::OnHandleDisconnectAll(AethercastInterfaceManager *s
     return TRUE;
 }
 
+gboolean ControllerSkeleton::OnHandleGetRuntimeMetrics(AethercastInterfaceManager *skeleton,
+                                                       GDBusMethodInvocation *invocation, gpointer user_data) {
+    const auto inst = static_cast<WeakKeepAlive<ControllerSkeleton>*>(user_data)->GetInstance().lock();
+
+    if (not inst) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_INVALID_STATE, "Invalid state");
+        return TRUE;
+    }
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{st}"));
+    for (const auto &metric : inst->RuntimeMetrics())
+        g_variant_builder_add(&builder, "{st}", metric.first.c_str(), metric.second);
+
+    aethercast_interface_manager_complete_get_runtime_metrics(skeleton, invocation,
+                                                              g_variant_builder_end(&builder));
+
+    return TRUE;
+}
+
+gboolean ControllerSkeleton::OnHandleOpenFrameTap(AethercastInterfaceManager *skeleton,
+                                                  GDBusMethodInvocation *invocation,
+                                                  GUnixFDList *fd_list, gpointer user_data) {
+    boost::ignore_unused_variable_warning(fd_list);
+    const auto inst = static_cast<WeakKeepAlive<ControllerSkeleton>*>(user_data)->GetInstance().lock();
+
+    if (not inst) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_INVALID_STATE, "Invalid state");
+        return TRUE;
+    }
+
+    const auto fd = inst->OpenFrameTap();
+    if (fd < 0) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_FAILED, "Failed to open frame tap");
+        return TRUE;
+    }
+
+    auto out_fd_list = g_unix_fd_list_new();
+    GError *error = nullptr;
+    // The list takes a duplicate, so our descriptor goes away again
+    // right after regardless of the outcome.
+    const auto handle = g_unix_fd_list_append(out_fd_list, fd, &error);
+    ::close(fd);
+
+    if (handle < 0) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_FAILED, "Failed to pass frame tap descriptor: %s", error->message);
+        g_error_free(error);
+        g_object_unref(out_fd_list);
+        return TRUE;
+    }
+
+    aethercast_interface_manager_complete_open_frame_tap(skeleton, invocation, out_fd_list,
+                                                         g_variant_new_handle(handle));
+    g_object_unref(out_fd_list);
+
+    return TRUE;
+}
+
+gboolean ControllerSkeleton::OnHandleTakeSnapshot(AethercastInterfaceManager *skeleton,
+                                                  GDBusMethodInvocation *invocation,
+                                                  guint max_width, gpointer user_data) {
+    const auto inst = static_cast<WeakKeepAlive<ControllerSkeleton>*>(user_data)->GetInstance().lock();
+
+    if (not inst) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_INVALID_STATE, "Invalid state");
+        return TRUE;
+    }
+
+    video::SnapshotTap::Image image;
+    if (!inst->TakeSnapshot(max_width, &image)) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_FAILED, "No frame available; is a session streaming?");
+        return TRUE;
+    }
+
+    aethercast_interface_manager_complete_take_snapshot(skeleton, invocation,
+        image.width, image.height, image.format.c_str(),
+        g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, image.data.data(),
+                                  image.data.size(), sizeof(std::uint8_t)));
+
+    return TRUE;
+}
+
 std::shared_ptr<ControllerSkeleton> ControllerSkeleton::FinalizeConstruction() {
     auto sp = shared_from_this();
 
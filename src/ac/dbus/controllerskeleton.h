@@ -29,8 +29,8 @@ extern "C" {
 }
 
 #include <memory>
-#include <unordered_map>
 
+#include "ac/deviceregistry.h"
 #include "ac/scoped_gobject.h"
 #include "ac/forwardingcontroller.h"
 
@@ -65,6 +65,12 @@ private:
                                  gpointer user_data);
     static gboolean OnHandleDisconnectAll(AethercastInterfaceManager *skeleton, GDBusMethodInvocation *invocation,
                                           gpointer user_data);
+    static gboolean OnHandleGetRuntimeMetrics(AethercastInterfaceManager *skeleton, GDBusMethodInvocation *invocation,
+                                              gpointer user_data);
+    static gboolean OnHandleOpenFrameTap(AethercastInterfaceManager *skeleton, GDBusMethodInvocation *invocation,
+                                         GUnixFDList *fd_list, gpointer user_data);
+    static gboolean OnHandleTakeSnapshot(AethercastInterfaceManager *skeleton, GDBusMethodInvocation *invocation,
+                                         guint max_width, gpointer user_data);
 
     static gboolean OnSetProperty(GDBusConnection *connection, const gchar *sender,
                                   const gchar *object_path,const gchar *interface_name,
@@ -75,6 +81,7 @@ private:
     std::shared_ptr<ControllerSkeleton> FinalizeConstruction();
 
     void SyncProperties();
+    void SyncConnectionTrace();
 
     std::string GenerateDevicePath(const NetworkDevice::Ptr &device) const;
 
@@ -83,7 +90,13 @@ private:
     SharedGObject<GDBusConnection> bus_connection_;
     guint bus_id_;
     ScopedGObject<GDBusObjectManagerServer> object_manager_;
-    std::unordered_map<std::string,NetworkDeviceSkeleton::Ptr> devices_;
+    DeviceRegistry<NetworkDeviceSkeleton::Ptr> devices_;
+    // Values already pushed into the property cache so a sync only
+    // touches the properties which actually changed; the state is an
+    // interned string and compares by pointer.
+    const gchar *last_state_;
+    std::vector<NetworkManager::Capability> last_capabilities_;
+    std::vector<std::string> last_trace_;
 };
 } // namespace dbus
 } // namespace ac
@@ -20,22 +20,62 @@
 namespace ac {
 namespace dbus {
 
-gchar** Helpers::GenerateDeviceCapabilities(const std::vector<NetworkDeviceRole> &roles) {
-    gchar **capabilities = g_new0(gchar*, roles.size() + 1);
+const gchar* Helpers::InternedDeviceStateStr(NetworkDeviceState state) {
+    switch (state) {
+    case kIdle:
+        return "idle";
+    case kFailure:
+        return "failure";
+    case kAssociation:
+        return "association";
+    case kConfiguration:
+        return "configuration";
+    case kConnected:
+        return "connected";
+    case kDisconnected:
+        return "disconnected";
+    default:
+        break;
+    }
+
+    return "unknown";
+}
+
+const gchar* Helpers::InternedRoleStr(NetworkDeviceRole role) {
+    switch (role) {
+    case kSource:
+        return "source";
+    case kSink:
+        return "sink";
+    default:
+        break;
+    }
+
+    return "unknown";
+}
+
+const gchar* Helpers::InternedCapabilityStr(NetworkManager::Capability capability) {
+    if (capability == NetworkManager::Capability::kSink)
+        return "sink";
+    else if (capability == NetworkManager::Capability::kSource)
+        return "source";
+    return "";
+}
+
+const gchar** Helpers::GenerateDeviceCapabilities(const std::vector<NetworkDeviceRole> &roles) {
+    auto capabilities = g_new0(const gchar*, roles.size() + 1);
     int n = 0;
     for (auto role : roles)
-        capabilities[n] = g_strdup(NetworkDevice::RoleToStr(role).c_str());
+        capabilities[n++] = InternedRoleStr(role);
     capabilities[n] = nullptr;
     return capabilities;
 }
 
-gchar** Helpers::GenerateCapabilities(const std::vector<NetworkManager::Capability> &capabilities) {
-    gchar** out_capabilities = g_new0(gchar*, capabilities.size() + 1);
+const gchar** Helpers::GenerateCapabilities(const std::vector<NetworkManager::Capability> &capabilities) {
+    auto out_capabilities = g_new0(const gchar*, capabilities.size() + 1);
     int n = 0;
-    for (auto capability : capabilities) {
-        auto value = NetworkManager::CapabilityToStr(capability);
-        out_capabilities[n++] = g_strdup(value.c_str());
-    }
+    for (auto capability : capabilities)
+        out_capabilities[n++] = InternedCapabilityStr(capability);
     out_capabilities[n] = nullptr;
     return out_capabilities;
 }
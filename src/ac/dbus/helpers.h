@@ -28,8 +28,17 @@
 namespace ac {
 namespace dbus {
 struct Helpers {
-    static gchar** GenerateCapabilities(const std::vector<NetworkManager::Capability> &capabilities);
-    static gchar** GenerateDeviceCapabilities(const std::vector<NetworkDeviceRole> &roles);
+    // Interned protocol strings with static storage; never free them.
+    // They keep property syncs during discovery bursts free of string
+    // allocations and let callers compare values by pointer.
+    static const gchar* InternedDeviceStateStr(NetworkDeviceState state);
+    static const gchar* InternedRoleStr(NetworkDeviceRole role);
+    static const gchar* InternedCapabilityStr(NetworkManager::Capability capability);
+
+    // The returned arrays hold interned strings so only the array
+    // itself is allocated; release it with g_free, not g_strfreev.
+    static const gchar** GenerateCapabilities(const std::vector<NetworkManager::Capability> &capabilities);
+    static const gchar** GenerateDeviceCapabilities(const std::vector<NetworkDeviceRole> &roles);
     static void ParseDictionary(GVariant *properties, std::function<void(std::string, GVariant*)> callback, const std::string &key_filter = "");
     static void ParseArray(GVariant *array, std::function<void(GVariant*)> callback);
 };
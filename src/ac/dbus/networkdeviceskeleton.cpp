@@ -26,19 +26,39 @@
 #include "ac/dbus/helpers.h"
 #include "ac/dbus/errors.h"
 
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace {
+constexpr unsigned int kSessionStatsIntervalSeconds{1};
+
+std::uint64_t ValueOrZero(const std::map<std::string, std::uint64_t> &snapshot, const std::string &name) {
+    const auto iter = snapshot.find(name);
+    return iter != snapshot.end() ? iter->second : 0;
+}
+} // namespace
+
 namespace ac {
 namespace dbus {
-NetworkDeviceSkeleton::Ptr NetworkDeviceSkeleton::Create(const SharedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &controller) {
+NetworkDeviceSkeleton::Ptr NetworkDeviceSkeleton::Create(const BorrowedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &controller) {
     return std::shared_ptr<NetworkDeviceSkeleton>(new NetworkDeviceSkeleton(connection, path, device, controller))->FinalizeConstruction();
 }
 
-NetworkDeviceSkeleton::NetworkDeviceSkeleton(const SharedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &controller) :
+NetworkDeviceSkeleton::NetworkDeviceSkeleton(const BorrowedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &controller) :
     ForwardingNetworkDevice(device),
     connection_(connection),
     object_(make_shared_gobject(aethercast_interface_object_skeleton_new(path.c_str()))),
     path_(path),
     controller_(controller),
-    device_iface_(aethercast_interface_device_skeleton_new()) {
+    device_iface_(aethercast_interface_device_skeleton_new()),
+    last_state_(nullptr),
+    stats_source_(0),
+    last_frames_encoded_(0),
+    last_bytes_sent_(0) {
+}
+
+NetworkDeviceSkeleton::~NetworkDeviceSkeleton() {
+    if (stats_source_ > 0)
+        g_source_remove(stats_source_);
 }
 
 std::shared_ptr<NetworkDeviceSkeleton> NetworkDeviceSkeleton::FinalizeConstruction() {
@@ -62,13 +82,115 @@ std::shared_ptr<NetworkDeviceSkeleton> NetworkDeviceSkeleton::FinalizeConstructi
 }
 
 void NetworkDeviceSkeleton::SyncProperties() {
-    aethercast_interface_device_set_address(device_iface_.get(), Address().c_str());
-    aethercast_interface_device_set_name(device_iface_.get(), Name().c_str());
-    aethercast_interface_device_set_state(device_iface_.get(), NetworkDevice::StateToStr(State()).c_str());
+    // Freeze notifications so the whole batch collapses into a single
+    // queued PropertiesChanged emission on the next main loop iteration
+    // rather than one wakeup of every listener per property.
+    g_object_freeze_notify(G_OBJECT(device_iface_.get()));
+
+    // Discovery bursts resync every device on each change signal but
+    // mostly a single property moved; skipping the unchanged ones
+    // keeps the property cache from copying the same values over and
+    // over again.
+    const auto address = Address();
+    if (address != last_address_) {
+        aethercast_interface_device_set_address(device_iface_.get(), address.c_str());
+        last_address_ = address;
+    }
+
+    const auto name = Name();
+    if (name != last_name_) {
+        aethercast_interface_device_set_name(device_iface_.get(), name.c_str());
+        last_name_ = name;
+    }
+
+    const auto state = Helpers::InternedDeviceStateStr(State());
+    if (state != last_state_) {
+        aethercast_interface_device_set_state(device_iface_.get(), state);
+        last_state_ = state;
+
+        if (State() == kConnected)
+            StartSessionStats();
+        else
+            StopSessionStats();
+    }
+
+    const auto roles = SupportedRoles();
+    if (roles != last_roles_) {
+        auto capabilities = Helpers::GenerateDeviceCapabilities(*roles);
+        aethercast_interface_device_set_capabilities(device_iface_.get(), capabilities);
+        g_free(capabilities);
+        last_roles_ = roles;
+    }
+
+    g_object_thaw_notify(G_OBJECT(device_iface_.get()));
+}
+
+void NetworkDeviceSkeleton::StartSessionStats() {
+    if (stats_source_ > 0)
+        return;
+
+    // The registry counters span the process lifetime; remember where
+    // they stand now so the first tick publishes this session only.
+    const auto snapshot = report::metrics::MetricsRegistry::Instance().Snapshot();
+    last_frames_encoded_ = ValueOrZero(snapshot, "frames_encoded");
+    last_bytes_sent_ = ValueOrZero(snapshot, "bytes_sent");
+
+    // The source carries a destroy notify as disconnecting removes it
+    // while armed.
+    stats_source_ = g_timeout_add_seconds_full(G_PRIORITY_DEFAULT, kSessionStatsIntervalSeconds, [](gpointer user_data) -> gboolean {
+        auto thiz = static_cast<WeakKeepAlive<NetworkDeviceSkeleton>*>(user_data)->GetInstance().lock();
+
+        if (!thiz)
+            return FALSE;
+
+        thiz->UpdateSessionStats();
+
+        return TRUE;
+    }, new WeakKeepAlive<NetworkDeviceSkeleton>(shared_from_this()),
+    [](gpointer data) { delete static_cast<WeakKeepAlive<NetworkDeviceSkeleton>*>(data); });
+}
+
+void NetworkDeviceSkeleton::StopSessionStats() {
+    if (stats_source_ == 0)
+        return;
+
+    g_source_remove(stats_source_);
+    stats_source_ = 0;
+
+    // Don't leave the numbers of a finished session dangling on the
+    // bus; a notify freeze is already active when we get here from
+    // SyncProperties.
+    aethercast_interface_device_set_session_framerate(device_iface_.get(), 0);
+    aethercast_interface_device_set_session_bitrate(device_iface_.get(), 0);
+    aethercast_interface_device_set_session_loss_fraction(device_iface_.get(), 0.0);
+    aethercast_interface_device_set_session_latency(device_iface_.get(), 0);
+}
+
+void NetworkDeviceSkeleton::UpdateSessionStats() {
+    const auto snapshot = report::metrics::MetricsRegistry::Instance().Snapshot();
+
+    const auto frames_encoded = ValueOrZero(snapshot, "frames_encoded");
+    const auto bytes_sent = ValueOrZero(snapshot, "bytes_sent");
+
+    // With a one second tick the counter deltas directly are the rates.
+    const auto framerate = static_cast<guint>(frames_encoded - last_frames_encoded_);
+    const auto bitrate = static_cast<guint>((bytes_sent - last_bytes_sent_) * 8);
+    last_frames_encoded_ = frames_encoded;
+    last_bytes_sent_ = bytes_sent;
+
+    // RTCP reports loss as a fraction of 256; capture to wire is the
+    // closest end-to-end estimate we have on the source side.
+    const auto loss_fraction = ValueOrZero(snapshot, "rtcp_fraction_lost") / 256.;
+    const auto latency = ValueOrZero(snapshot, "send_latency_p90_us");
 
-    auto capabilities = Helpers::GenerateDeviceCapabilities(SupportedRoles());
-    aethercast_interface_device_set_capabilities(device_iface_.get(), capabilities);
-    g_strfreev(capabilities);
+    // Collapse the batch into a single PropertiesChanged emission just
+    // like a regular property sync.
+    g_object_freeze_notify(G_OBJECT(device_iface_.get()));
+    aethercast_interface_device_set_session_framerate(device_iface_.get(), framerate);
+    aethercast_interface_device_set_session_bitrate(device_iface_.get(), bitrate);
+    aethercast_interface_device_set_session_loss_fraction(device_iface_.get(), loss_fraction);
+    aethercast_interface_device_set_session_latency(device_iface_.get(), latency);
+    g_object_thaw_notify(G_OBJECT(device_iface_.get()));
 }
 
 GDBusObjectSkeleton* NetworkDeviceSkeleton::DBusObject() const {
@@ -101,7 +223,7 @@ gboolean NetworkDeviceSkeleton::OnHandleConnect(AethercastInterfaceDevice *skele
     g_object_ref(invocation);
     auto inv = make_shared_gobject(invocation);
 
-    inst->controller_->Connect(inst->Fwd(), [inv](ac::Error error) {
+    inst->controller_->Connect(inst->Fwd(), [inv = std::move(inv)](ac::Error error) {
         if (error != Error::kNone) {
             g_dbus_method_invocation_return_error(inv.get(), AETHERCAST_ERROR,
                 AethercastErrorFromError(error), "%s", ac::ErrorToString(error).c_str());
@@ -130,7 +252,7 @@ gboolean NetworkDeviceSkeleton::OnHandleDisconnect(AethercastInterfaceDevice *sk
     g_object_ref(invocation);
     auto inv = make_shared_gobject(invocation);
 
-    inst->controller_->Disconnect(inst->Fwd(), [inv](ac::Error error) {
+    inst->controller_->Disconnect(inst->Fwd(), [inv = std::move(inv)](ac::Error error) {
         if (error != Error::kNone) {
             g_dbus_method_invocation_return_error(inv.get(), AETHERCAST_ERROR,
                 AethercastErrorFromError(error), "%s", ac::ErrorToString(error).c_str());
@@ -28,8 +28,11 @@ extern "C" {
 #pragma GCC diagnostic pop
 }
 
+#include <cstdint>
+
 #include "ac/forwardingnetworkdevice.h"
 #include "ac/controller.h"
+#include "ac/borrowed_gobject.h"
 #include "ac/scoped_gobject.h"
 #include "ac/shared_gobject.h"
 
@@ -40,7 +43,9 @@ class NetworkDeviceSkeleton : public std::enable_shared_from_this<NetworkDeviceS
 public:
     typedef std::shared_ptr<NetworkDeviceSkeleton> Ptr;
 
-    static NetworkDeviceSkeleton::Ptr Create(const SharedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &controller);
+    static NetworkDeviceSkeleton::Ptr Create(const BorrowedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &controller);
+
+    ~NetworkDeviceSkeleton();
 
     GDBusObjectSkeleton* DBusObject() const;
     std::string Path() const;
@@ -54,16 +59,38 @@ private:
                                    gpointer user_data);
 
 private:
-    NetworkDeviceSkeleton(const SharedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &service);
+    NetworkDeviceSkeleton(const BorrowedGObject<GDBusConnection> &connection, const std::string &path, const NetworkDevice::Ptr &device, const Controller::Ptr &service);
 
     std::shared_ptr<NetworkDeviceSkeleton> FinalizeConstruction();
 
+    void StartSessionStats();
+    void StopSessionStats();
+    void UpdateSessionStats();
+
 private:
-    SharedGObject<GDBusConnection> connection_;
+    // The controller skeleton creating us owns the bus connection and
+    // every adapter it registers, so a borrowed view is safe here and
+    // spares one shared ref per discovered device.
+    BorrowedGObject<GDBusConnection> connection_;
     SharedGObject<AethercastInterfaceObjectSkeleton> object_;
     std::string path_;
     Controller::Ptr controller_;
     ScopedGObject<AethercastInterfaceDevice> device_iface_;
+    // Values already pushed into the property cache so a sync only
+    // touches the properties which actually changed; the state is an
+    // interned string and compares by pointer.
+    const gchar *last_state_;
+    std::string last_address_;
+    std::string last_name_;
+    // Snapshots are immutable so comparing the handle is enough.
+    RoleList last_roles_;
+    // Live session statistics timer; armed only while the device is
+    // connected so idle devices cost nothing.
+    guint stats_source_;
+    // Where the session-spanning metrics counters stood on the last
+    // tick; the published rates are deltas against these.
+    std::uint64_t last_frames_encoded_;
+    std::uint64_t last_bytes_sent_;
 };
 } // namespace dbus
 } // namespace ac
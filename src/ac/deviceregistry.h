@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_DEVICEREGISTRY_H_
+#define AC_DEVICEREGISTRY_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ac {
+
+// Holds the device tables which used to be plain string-keyed maps.
+// Entries live in contiguous slots so the loops that run for every
+// peer of a scan burst (signal emission, property sync, the stale
+// peer sweep) walk an array instead of chasing map nodes; the string
+// key only matters at the D-Bus boundary and is resolved through a
+// side index there. Slots keep their position for the lifetime of an
+// entry and carry a generation counter which bumps on reuse, so a
+// Handle taken for an entry can be revalidated later without pinning
+// the entry itself.
+//
+// T is expected to be a shared_ptr-like type: an empty T{} doubles as
+// the miss result.
+template<typename T>
+class DeviceRegistry {
+public:
+    struct Handle {
+        std::uint32_t index;
+        std::uint32_t generation;
+    };
+
+    // Inserts value under key, replacing an existing entry in place
+    void Insert(const std::string &key, const T &value) {
+        const auto iter = index_.find(key);
+        if (iter != index_.end()) {
+            slots_[iter->second].value = value;
+            return;
+        }
+
+        std::size_t n;
+        if (!free_.empty()) {
+            n = free_.back();
+            free_.pop_back();
+            slots_[n].generation++;
+            slots_[n].occupied = true;
+            slots_[n].key = key;
+            slots_[n].value = value;
+        } else {
+            n = slots_.size();
+            slots_.push_back(Slot{0, true, key, value});
+        }
+
+        index_[key] = n;
+    }
+
+    // Returns the entry for key or an empty T
+    T Find(const std::string &key) const {
+        const auto iter = index_.find(key);
+        return iter == index_.end() ? T{} : slots_[iter->second].value;
+    }
+
+    // Removes the entry for key and hands it back; returns an empty T
+    // when there was none. The slot is kept for reuse.
+    T Take(const std::string &key) {
+        const auto iter = index_.find(key);
+        if (iter == index_.end())
+            return T{};
+
+        const auto n = iter->second;
+        auto value = slots_[n].value;
+
+        slots_[n].occupied = false;
+        slots_[n].key.clear();
+        slots_[n].value = T{};
+        free_.push_back(n);
+        index_.erase(iter);
+
+        return value;
+    }
+
+    Handle HandleOf(const std::string &key) const {
+        const auto iter = index_.find(key);
+        if (iter == index_.end())
+            return Handle{0, 0};
+        return Handle{static_cast<std::uint32_t>(iter->second),
+                      slots_[iter->second].generation};
+    }
+
+    // Returns the entry behind handle, or an empty T when the slot was
+    // reused for another device in the meantime
+    T Get(const Handle &handle) const {
+        if (handle.index >= slots_.size())
+            return T{};
+
+        const auto &slot = slots_[handle.index];
+        if (!slot.occupied || slot.generation != handle.generation)
+            return T{};
+
+        return slot.value;
+    }
+
+    void Clear() {
+        slots_.clear();
+        free_.clear();
+        index_.clear();
+    }
+
+    std::size_t Size() const { return index_.size(); }
+
+    // Visits every live entry in slot order; func gets the key and the
+    // value. Mutating the registry from within func is not allowed,
+    // collect first and modify afterwards.
+    template<typename Func>
+    void ForEach(Func func) const {
+        for (const auto &slot : slots_) {
+            if (slot.occupied)
+                func(slot.key, slot.value);
+        }
+    }
+
+    // First entry satisfying pred, or an empty T
+    template<typename Pred>
+    T FindIf(Pred pred) const {
+        for (const auto &slot : slots_) {
+            if (slot.occupied && pred(slot.value))
+                return slot.value;
+        }
+        return T{};
+    }
+
+private:
+    struct Slot {
+        std::uint32_t generation;
+        bool occupied;
+        std::string key;
+        T value;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<std::size_t> free_;
+    std::unordered_map<std::string, std::size_t> index_;
+};
+
+} // namespace ac
+
+#endif
@@ -31,6 +31,7 @@
 #include <boost/concept_check.hpp>
 
 #include "ac/logger.h"
+#include "ac/report/dispatch.h"
 #include "ac/keep_alive.h"
 
 #include "ac/droidmedia/h264encoder.h"
@@ -189,20 +190,20 @@ static void signal_error(void *data, int err) {
     encoder->Stop();
 }
 
-static void signal_release(void *data)
+static void signal_release_capture(void *data)
 {
-    AC_DEBUG("Release");
-    //delete[] data;
-    DroidMediaBuffer* buffer = static_cast<DroidMediaBuffer*>(data);
-    droid_media_buffer_unlock(buffer);
-    droid_media_buffer_destroy(buffer);
+    // Dropping the reference hands the capture buffer back to the
+    // producer once the codec finished reading from it; that return is
+    // the only synchronization droidmedia offers for queued frames.
+    delete static_cast<ac::video::Buffer::Ptr*>(data);
 }
 
 static void signal_release_readout(void *data)
 {
     AC_DEBUG("Release pixels");
-    char* buffer = static_cast<char*>(data);
-    delete[] buffer;
+    // Dropping the last reference sends the storage back to the
+    // encoder's buffer pool instead of the allocator
+    delete static_cast<ac::video::Buffer::Ptr*>(data);
 }
 
 static void data_available(void *data, DroidMediaCodecData *encoded)
@@ -212,6 +213,7 @@ static void data_available(void *data, DroidMediaCodecData *encoded)
 
     // Create sendable video buffer out of output buffer
     video::Buffer::Ptr send_buffer = DroidmediaH264Buffer::Create(encoded);
+    send_buffer->SetFrameId(encoder->NextPendingFrameId());
     AC_DEBUG("send_buffer length: %lu", (unsigned long) send_buffer->Length());
 
     /*if (encoded) {
@@ -222,7 +224,7 @@ static void data_available(void *data, DroidMediaCodecData *encoded)
     if (auto sp = encoder->Delegate().lock())
         sp->OnBufferAvailable(send_buffer);
 
-    encoder->Report()->FinishedFrame(send_buffer->Timestamp());
+    AC_REPORT(encoder->Report()->FinishedFrame(send_buffer->Timestamp(), send_buffer->FrameId()));
 }
 
 video::BaseEncoder::Config H264Encoder::DefaultConfiguration() {
@@ -233,14 +235,16 @@ video::BaseEncoder::Config H264Encoder::DefaultConfiguration() {
     return config;
 }
 
-video::BaseEncoder::Ptr H264Encoder::Create(const video::EncoderReport::Ptr &report) {
-    return std::shared_ptr<H264Encoder>(new H264Encoder(report));
+video::BaseEncoder::Ptr H264Encoder::Create(const video::EncoderReport::Ptr &report, bool readout) {
+    return std::shared_ptr<H264Encoder>(new H264Encoder(report, readout));
 }
 
-H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report) :
+H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report, bool readout) :
     report_(report),
     running_(false),
-    input_queue_(ac::video::BufferQueue::Create()),
+    readout_(readout),
+    input_queue_(ac::video::BufferQueue::CreateSPSC()),
+    input_pool_(ac::video::BufferPool::Create()),
     start_time_(-1ll),
     frame_count_(0)
 {
@@ -279,7 +283,10 @@ bool H264Encoder::Configure(const Config &config) {
     metadata.slice_height = config.height;
     metadata.color_format = 0x7F000789;
     metadata.max_input_size = maxInputSize;
-    metadata.meta_data = kMetadataBufferTypeInvalid;
+    // Without readout the frames arrive as gralloc handles and go to
+    // the codec as ANWBuffer metadata; only the readout path feeds
+    // actual pixel data.
+    metadata.meta_data = readout_ ? kMetadataBufferTypeInvalid : kMetadataBufferTypeANWBuffer;
 
     codec_ = droid_media_codec_create_encoder(&metadata);
     if (!codec_) {
@@ -376,50 +383,50 @@ void H264Encoder::QueueBuffer(const video::Buffer::Ptr &input_buffer) {
     if (!running_)
         return;
 
-    report_->ReceivedInputBuffer(input_buffer->Timestamp());
+    if (ConsumeIDRRequest())
+        SendIDRFrame();
+
+    AC_REPORT(report_->ReceivedInputBuffer(input_buffer->Timestamp()));
     AC_DEBUG("Queueing buffer");
 
     void* pixels = nullptr;
     uint32_t size = 0;
     DroidMediaBufferCallbacks cb;
+    VideoNativeMetadata meta;
 
-    if (!input_buffer->NativeHandle() && input_buffer->Length() > 0) {
+    if (readout_ && !input_buffer->NativeHandle() && input_buffer->Length() > 0) {
         size = (config_.width * config_.height * 3 / 2);
-        pixels = new char[size];
-        rgb2yuv420p((char*)input_buffer->Data(), (char*)pixels, config_.width, config_.height);
+        // The conversion target comes out of a recycling pool tied to
+        // the codec's ownership cycle: once the codec calls the unref
+        // callback the last reference goes away and the array returns
+        // to the freelist instead of being freed, so a 30fps session
+        // stops allocating 3MB+ frames on the hot path.
+        auto conversion_buffer = input_pool_->Acquire(size);
+        rgb2yuv420p((char*)input_buffer->Data(), (char*)conversion_buffer->Data(),
+                    config_.width, config_.height);
+        pixels = conversion_buffer->Data();
 
         cb.unref = signal_release_readout;
-        cb.data = pixels;
-    } else if (input_buffer->NativeHandle()) {
-        // Import native handle into Droidmedia buffer
-        AC_DEBUG("Importing buffer");
+        cb.data = new video::Buffer::Ptr(conversion_buffer);
+    } else if (!readout_ && input_buffer->NativeHandle()) {
+        // Metadata passthrough: the codec receives the gralloc handle
+        // and reads the pixels straight out of graphics memory; nothing
+        // gets locked, mapped or copied on the CPU.
         const auto anwb = reinterpret_cast<ANativeWindowBuffer*>(input_buffer->NativeHandle());
 
-        DroidMediaBuffer *imported_media_buffer =
-            droid_media_buffer_import(anwb->handle, anwb->width, anwb->height, anwb->format,
-                                      1, anwb->usage, anwb->stride);
-        if (!imported_media_buffer) {
-            AC_WARNING("Failed to import media buffer");
-            return;
-        }
-
-        // Lock media buffer for readout
-        uint32_t width = 0;
-        uint32_t height = 0;
-        //char* pixel_data = nullptr;
-
-        pixels = droid_media_buffer_lock(imported_media_buffer, DROID_MEDIA_BUFFER_LOCK_READ);
-        if (pixels) {
-            width = droid_media_buffer_get_width(imported_media_buffer);
-            height = droid_media_buffer_get_height(imported_media_buffer);
-            size = width * height;
-        } else {
-            AC_WARNING("Buffer couldn't be locked");
-            return;
-        }
+        meta.eType = kMetadataBufferTypeANWBuffer;
+        meta.pBuffer = anwb;
+        // The producer hands the buffer over only after its swap
+        // completed, so there is no pending write fence to wait on.
+        meta.nFenceFd = -1;
+
+        pixels = &meta;
+        size = sizeof(meta);
 
-        cb.unref = signal_release;
-        cb.data = imported_media_buffer;
+        // Keep the capture buffer (and with it the gralloc handle)
+        // alive until the codec released the frame
+        cb.unref = signal_release_capture;
+        cb.data = new video::Buffer::Ptr(input_buffer);
     } else {
         AC_WARNING("Failed to queue input buffer");
         return;
@@ -432,24 +439,31 @@ void H264Encoder::QueueBuffer(const video::Buffer::Ptr &input_buffer) {
     data.data.size = size;
     data.data.data = pixels;
     data.ts = input_buffer->Timestamp();
+    // A synchronous queue copies the payload during the call; for the
+    // passthrough path that is the 16 byte metadata struct, not the
+    // frame.
     data.sync = true;
 
-    /*VideoNativeMetadata* native_md = new VideoNativeMetadata;
-    native_md->eType = kMetadataBufferTypeANWBuffer;
-    native_md->pBuffer = anwb;
-    native_md->nFenceFd = -1;
-
-    DroidMediaCodecData data;
-    data.data.size = sizeof(VideoNativeMetadata);
-    data.data.data = *native_md;
-    data.ts = input_buffer->Timestamp();
-    data.sync = false;*/
-
     AC_DEBUG("Enqueueing");
+    {
+        std::lock_guard<std::mutex> lock(pending_frame_ids_mutex_);
+        pending_frame_ids_.push_back(input_buffer->FrameId());
+    }
     droid_media_codec_queue(codec_, &data, &cb);
     AC_DEBUG("Enqueued");
 
-    report_->BeganFrame(input_buffer->Timestamp());
+    AC_REPORT(report_->BeganFrame(input_buffer->Timestamp()));
+}
+
+ac::FrameId H264Encoder::NextPendingFrameId() {
+    std::lock_guard<std::mutex> lock(pending_frame_ids_mutex_);
+
+    if (pending_frame_ids_.empty())
+        return 0;
+
+    const auto frame_id = pending_frame_ids_.front();
+    pending_frame_ids_.pop_front();
+    return frame_id;
 }
 
 video::BaseEncoder::Config H264Encoder::Configuration() const {
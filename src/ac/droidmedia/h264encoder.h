@@ -19,7 +19,9 @@
 #ifndef AC_DROIDMEDIA_ENCODER_H_
 #define AC_DROIDMEDIA_ENCODER_H_
 
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include <droidmediacodec.h>
@@ -31,6 +33,7 @@
 
 #include "ac/video/baseencoder.h"
 #include "ac/video/encoderreport.h"
+#include "ac/video/bufferpool.h"
 #include "ac/video/bufferqueue.h"
 
 namespace ac {
@@ -40,7 +43,7 @@ class H264Encoder : public video::BaseEncoder {
 public:
     typedef std::shared_ptr<H264Encoder> Ptr;
 
-    static BaseEncoder::Ptr Create(const video::EncoderReport::Ptr &report);
+    static BaseEncoder::Ptr Create(const video::EncoderReport::Ptr &report, bool readout);
 
     ~H264Encoder();
 
@@ -60,22 +63,39 @@ public:
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    // Execute() blocks inside the codec until the next encoded frame
+    // and cannot share an executor loop
+    bool PrefersDedicatedThread() const override { return true; }
 
 private:
-    H264Encoder(const video::EncoderReport::Ptr &report);
+    H264Encoder(const video::EncoderReport::Ptr &report, bool readout);
 
 public:
     std::weak_ptr<video::BaseEncoder::Delegate> Delegate();
     video::EncoderReport::Ptr Report();
+    // Frame id of the oldest frame still inside the codec; it emits
+    // frames in submission order so the output callback claims ids
+    // front to back. Returns 0 when drained.
+    ac::FrameId NextPendingFrameId();
 
 private:
     DroidMediaCodec *codec_ = nullptr;
     video::EncoderReport::Ptr report_;
     BaseEncoder::Config config_;
     bool running_;
+    // Whether frames arrive as CPU pixels (readout) or as gralloc
+    // handles passed through to the codec as metadata buffers
+    bool readout_;
     ac::video::BufferQueue::Ptr input_queue_;
+    // Recycles the YUV conversion targets handed to the codec so a
+    // steady session reuses the same small set of arrays
+    ac::video::BufferPool::Ptr input_pool_;
     ac::TimestampUs start_time_;
     uint32_t frame_count_;
+    // Queueing and the data_available callback run on different
+    // threads
+    std::mutex pending_frame_ids_mutex_;
+    std::deque<ac::FrameId> pending_frame_ids_;
 };
 
 } // namespace droidmedia
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <sstream>
+
+#include <hybris/properties/properties.h>
+
+#include "ac/config.h"
+#include "ac/encodercapabilitycache.h"
+#include "ac/logger.h"
+#include "ac/utils.h"
+
+namespace {
+static const std::string kCacheFile{std::string(ac::kStateDir) + "/encoder-capabilities"};
+
+std::string SystemImageFingerprint() {
+    char fingerprint[PROP_VALUE_MAX] = { };
+    property_get("ro.build.fingerprint", fingerprint, "");
+    if (strlen(fingerprint) > 0)
+        return std::string(fingerprint);
+
+    // Not every image carries a fingerprint; the build date is the
+    // next best thing which still changes with every update.
+    property_get("ro.build.date.utc", fingerprint, "");
+    if (strlen(fingerprint) > 0)
+        return std::string(fingerprint);
+
+    return "unknown";
+}
+}
+
+namespace ac {
+
+EncoderCapabilityCache& EncoderCapabilityCache::Instance() {
+    static EncoderCapabilityCache instance;
+    return instance;
+}
+
+EncoderCapabilityCache::EncoderCapabilityCache() :
+    fingerprint_(SystemImageFingerprint()) {
+    Load();
+}
+
+std::string EncoderCapabilityCache::Lookup(const std::string &key) {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    const auto it = entries_.find(key);
+    if (it == entries_.end())
+        return "";
+
+    return it->second;
+}
+
+void EncoderCapabilityCache::Store(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    entries_[key] = value;
+    Save();
+}
+
+void EncoderCapabilityCache::Load() {
+    const auto contents = Utils::ReadFileContents(kCacheFile);
+    if (contents.empty())
+        return;
+
+    const auto lines = Utils::StringSplit(contents, '\n');
+    if (lines.empty())
+        return;
+
+    // First line names the system image the table was probed on;
+    // everything below it is stale once that changes.
+    if (lines[0] != fingerprint_) {
+        AC_DEBUG("Dropping encoder capability cache from other system image");
+        return;
+    }
+
+    for (std::size_t n = 1; n < lines.size(); n++) {
+        const auto pos = lines[n].find('=');
+        if (pos == std::string::npos || pos == 0)
+            continue;
+        entries_[lines[n].substr(0, pos)] = lines[n].substr(pos + 1);
+    }
+}
+
+void EncoderCapabilityCache::Save() {
+    std::ostringstream contents;
+    contents << fingerprint_ << "\n";
+    for (const auto &entry : entries_)
+        contents << entry.first << "=" << entry.second << "\n";
+
+    if (!Utils::WriteFileContents(kCacheFile, contents.str()))
+        AC_WARNING("Failed to persist encoder capability cache");
+}
+
+} // namespace ac
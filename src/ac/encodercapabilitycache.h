@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_ENCODERCAPABILITYCACHE_H_
+#define AC_ENCODERCAPABILITYCACHE_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+
+// Persists what encoder probing learned about this device so a new
+// session consults a plain table instead of walking device nodes or
+// asking drivers again. Entries are keyed by free-form strings per
+// backend and kept in one file under the state directory; the whole
+// table is dropped when the system image fingerprint changes as an
+// update can swap drivers and device topology underneath us.
+class EncoderCapabilityCache : public ac::NonCopyable {
+public:
+    static EncoderCapabilityCache& Instance();
+
+    // Returns the stored value for key or an empty string
+    std::string Lookup(const std::string &key);
+
+    // Stores value for key and persists the table right away; probe
+    // results are rare and precious enough that we never batch this.
+    void Store(const std::string &key, const std::string &value);
+
+private:
+    EncoderCapabilityCache();
+
+    void Load();
+    void Save();
+
+private:
+    std::mutex mutex_;
+    std::string fingerprint_;
+    std::map<std::string, std::string> entries_;
+};
+
+} // namespace ac
+
+#endif
@@ -58,6 +58,26 @@ std::vector<NetworkManager::Capability> ForwardingController::Capabilities() con
     return fwd_->Capabilities();
 }
 
+std::vector<std::string> ForwardingController::ConnectionTrace() const {
+    return fwd_->ConnectionTrace();
+}
+
+std::map<std::string, std::uint64_t> ForwardingController::RuntimeMetrics() const {
+    return fwd_->RuntimeMetrics();
+}
+
+int ForwardingController::OpenFrameTap() {
+    return fwd_->OpenFrameTap();
+}
+
+bool ForwardingController::TakeSnapshot(std::uint32_t max_width, video::SnapshotTap::Image *image) {
+    return fwd_->TakeSnapshot(max_width, image);
+}
+
+bool ForwardingController::Ready() const {
+    return fwd_->Ready();
+}
+
 bool ForwardingController::Scanning() const {
     return fwd_->Scanning();
 }
@@ -38,6 +38,11 @@ public:
 
     virtual NetworkDeviceState State() const override;
     virtual std::vector<NetworkManager::Capability> Capabilities() const override;
+    virtual std::vector<std::string> ConnectionTrace() const override;
+    virtual std::map<std::string, std::uint64_t> RuntimeMetrics() const override;
+    virtual int OpenFrameTap() override;
+    virtual bool TakeSnapshot(std::uint32_t max_width, video::SnapshotTap::Image *image) override;
+    virtual bool Ready() const override;
     virtual bool Scanning() const override;
     virtual bool Enabled() const override;
 
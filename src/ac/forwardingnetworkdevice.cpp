@@ -41,7 +41,9 @@ NetworkDeviceState ForwardingNetworkDevice::State() const {
     return fwd_->State();
 }
 
-std::vector<NetworkDeviceRole> ForwardingNetworkDevice::SupportedRoles() const {
+NetworkDevice::RoleList ForwardingNetworkDevice::SupportedRoles() const {
+    // Hands the snapshot through unchanged; the roles are only copied
+    // when the underlying device publishes a new set.
     return fwd_->SupportedRoles();
 }
 
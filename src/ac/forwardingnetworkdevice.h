@@ -30,7 +30,7 @@ public:
     IpV4Address IPv4Address() const override;
     std::string Name() const override;
     NetworkDeviceState State() const override;
-    std::vector<NetworkDeviceRole> SupportedRoles() const override;
+    RoleList SupportedRoles() const override;
 
 protected:
     const NetworkDevice::Ptr& Fwd() const;
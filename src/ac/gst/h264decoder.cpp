@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+
+#include "ac/logger.h"
+
+#include "ac/gst/h264decoder.h"
+
+namespace {
+static constexpr const char *kRawMimeType{"video/x-raw"};
+// Match the layout the capture side produces so decoded frames can be
+// compared against retained source frames byte for byte.
+static constexpr const char *kRawFormat{"RGBx"};
+// Software decoders in rough order of how common they are; the droid
+// element last as a hardware fallback on devices without either.
+static constexpr const char *kDecoderElements[] = {
+    "avdec_h264",
+    "openh264dec",
+    "droidvdec",
+};
+}
+
+namespace ac {
+namespace gst {
+
+H264Decoder::Ptr H264Decoder::Create() {
+    const auto sp = std::shared_ptr<H264Decoder>(new H264Decoder);
+    if (!sp->pipeline_)
+        return nullptr;
+    return sp;
+}
+
+H264Decoder::H264Decoder() {
+    gst_init(nullptr, nullptr);
+
+    appsource_ = gst_element_factory_make("appsrc", nullptr);
+    if (!appsource_) {
+        AC_WARNING("Failed to set up appsrc");
+        return;
+    }
+    // An offline stream, not a live one: the decoder is allowed to
+    // take as long as it takes.
+    g_object_set(G_OBJECT(appsource_),
+        "stream-type", 0,
+        "is-live", FALSE,
+        "format", GST_FORMAT_TIME,
+        nullptr);
+
+    parser_ = gst_element_factory_make("h264parse", nullptr);
+    if (!parser_) {
+        AC_WARNING("Failed to set up H.264 parser");
+        return;
+    }
+
+    for (const auto element : kDecoderElements) {
+        decoder_ = gst_element_factory_make(element, nullptr);
+        if (decoder_)
+            break;
+    }
+    if (!decoder_) {
+        AC_WARNING("No H.264 decoder element available");
+        return;
+    }
+
+    converter_ = gst_element_factory_make("videoconvert", nullptr);
+    if (!converter_) {
+        AC_WARNING("Failed to set up converter");
+        return;
+    }
+
+    appsink_ = gst_element_factory_make("appsink", nullptr);
+    if (!appsink_) {
+        AC_WARNING("Failed to set up appsink");
+        return;
+    }
+    // Frames are pulled as fast as they decode; there is no clock to
+    // pace an offline run against.
+    g_object_set(G_OBJECT(appsink_), "sync", FALSE, nullptr);
+
+    pipeline_ = gst_pipeline_new(nullptr);
+    if (!pipeline_) {
+        AC_WARNING("Failed to set up pipeline");
+        return;
+    }
+
+    gst_bin_add_many(GST_BIN(pipeline_), appsource_, parser_, decoder_,
+                     converter_, appsink_, NULL);
+
+    auto caps = gst_caps_new_simple(kRawMimeType,
+        "format", G_TYPE_STRING, kRawFormat, NULL);
+    const auto linked =
+            gst_element_link_many(appsource_, parser_, decoder_, converter_, NULL)
+            && gst_element_link_filtered(converter_, appsink_, caps);
+    gst_caps_unref(caps);
+
+    if (!linked) {
+        AC_WARNING("Failed to link decoder pipeline");
+        gst_object_unref(pipeline_);
+        pipeline_ = nullptr;
+        return;
+    }
+
+    AC_DEBUG("GstH264Decoder created");
+}
+
+H264Decoder::~H264Decoder() {
+    if (pipeline_) {
+        gst_element_set_state(pipeline_, GST_STATE_NULL);
+        gst_object_unref(pipeline_);
+    } else {
+        if (appsource_)
+            gst_object_unref(appsource_);
+        if (parser_)
+            gst_object_unref(parser_);
+        if (decoder_)
+            gst_object_unref(decoder_);
+        if (converter_)
+            gst_object_unref(converter_);
+        if (appsink_)
+            gst_object_unref(appsink_);
+    }
+
+    gst_deinit();
+}
+
+std::vector<video::Buffer::Ptr> H264Decoder::DecodeAll(
+        const std::vector<video::Buffer::Ptr> &stream) {
+    std::vector<video::Buffer::Ptr> frames;
+
+    if (!pipeline_)
+        return frames;
+
+    if (gst_element_set_state(pipeline_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        AC_WARNING("Failed to start decoder pipeline");
+        return frames;
+    }
+
+    // This is tooling on a finished stream, so unlike the encode path
+    // every buffer is simply copied across the GStreamer boundary;
+    // nobody holds the source alive and nothing is latency sensitive.
+    for (const auto &buffer : stream) {
+        auto fed = gst_buffer_new_allocate(nullptr, buffer->Length(), nullptr);
+        gst_buffer_fill(fed, 0, buffer->Data(), buffer->Length());
+
+        // The timestamps ride through the decoder untouched; they are
+        // what lets the caller match a decoded frame back to the
+        // retained source frame it came from.
+        GST_BUFFER_PTS(fed) = buffer->Timestamp() >= 0
+                ? static_cast<GstClockTime>(buffer->Timestamp()) * GST_USECOND
+                : GST_CLOCK_TIME_NONE;
+
+        if (gst_app_src_push_buffer(GST_APP_SRC(appsource_), fed) != GST_FLOW_OK) {
+            AC_WARNING("Decoder refused buffer; stopping early");
+            break;
+        }
+    }
+
+    gst_app_src_end_of_stream(GST_APP_SRC(appsource_));
+
+    // Pull until the EOS worked its way through; a null sample marks
+    // the drained pipeline.
+    while (true) {
+        const auto sample = gst_app_sink_pull_sample(GST_APP_SINK(appsink_));
+        if (!sample)
+            break;
+
+        const auto decoded = gst_sample_get_buffer(sample);
+        if (!decoded) {
+            gst_sample_unref(sample);
+            continue;
+        }
+
+        GstMapInfo mapinfo;
+        if (gst_buffer_map(decoded, &mapinfo, GST_MAP_READ)) {
+            const auto frame = video::Buffer::Create(mapinfo.data, mapinfo.size);
+            if (GST_BUFFER_PTS_IS_VALID(decoded))
+                frame->SetTimestamp(static_cast<ac::TimestampUs>(
+                        GST_BUFFER_PTS(decoded) / GST_USECOND));
+            frames.push_back(frame);
+            gst_buffer_unmap(decoded, &mapinfo);
+        }
+
+        gst_sample_unref(sample);
+    }
+
+    gst_element_set_state(pipeline_, GST_STATE_NULL);
+
+    AC_DEBUG("Decoded %d frames from %d stream buffers",
+             frames.size(), stream.size());
+
+    return frames;
+}
+
+} // namespace gst
+} // namespace ac
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_GST_DECODER_H_
+#define AC_GST_DECODER_H_
+
+#include <memory>
+#include <vector>
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "ac/non_copyable.h"
+
+#include "ac/video/buffer.h"
+
+namespace ac {
+namespace gst {
+
+// Offline H.264 decode helper for the benchmark and measurement
+// tooling: turns an encoder's Annex B output back into raw RGBX
+// frames so they can be scored against the source. Runs the whole
+// stream through in one blocking call - nothing here is meant for
+// the live streaming path.
+class H264Decoder : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<H264Decoder> Ptr;
+
+    // Returns nullptr when no usable decoder element is installed
+    static Ptr Create();
+
+    ~H264Decoder();
+
+    // Feeds the stream buffers in order - codec config included - and
+    // blocks until the decoder drained. Decoded frames come back in
+    // display order carrying the timestamps of the encoded frames
+    // they were reconstructed from.
+    std::vector<video::Buffer::Ptr> DecodeAll(
+            const std::vector<video::Buffer::Ptr> &stream);
+
+private:
+    H264Decoder();
+
+private:
+    GstElement *appsource_ = nullptr;
+    GstElement *parser_ = nullptr;
+    GstElement *decoder_ = nullptr;
+    GstElement *converter_ = nullptr;
+    GstElement *appsink_ = nullptr;
+    GstElement *pipeline_ = nullptr;
+};
+
+} // namespace gst
+} // namespace ac
+
+#endif
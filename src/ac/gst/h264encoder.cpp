@@ -24,13 +24,16 @@
 #include <system/window.h>
 #pragma GCC diagnostic pop
 
-#include <cstring>
+#include <algorithm>
+#include <thread>
+
 #include <gst/app/gstappsink.h>
 #include <gst/app/gstappsrc.h>
 
 #include <boost/concept_check.hpp>
 
 #include "ac/logger.h"
+#include "ac/report/dispatch.h"
 #include "ac/keep_alive.h"
 
 #include "ac/gst/h264encoder.h"
@@ -38,10 +41,16 @@
 namespace {
 static constexpr const char *kEncoderThreadName{"GstH264Encoder"};
 static constexpr const char *kH264MimeType{"video/x-h264"};
+static constexpr const char *kHEVCMimeType{"video/x-h265"};
 static constexpr const char *kRawMimeType{"video/x-raw"};
 // Supplying -1 as framerate means the encoder decides on which framerate
 // it provides.
 static constexpr int32_t kAnyFramerate = 30;
+// GstX264EncTune/Preset/Pass values from gstx264enc; set numerically
+// so no build time dependency on the plugin headers is needed.
+static constexpr guint kX264TuneZeroLatency{0x00000004};
+static constexpr gint kX264PresetVeryFast{3};
+static constexpr gint kX264PassCBR{0};
 // Default is a bitrate of 5 MBit/s
 static constexpr int32_t kDefaultBitrate = 5000000;
 // By default send an I frame every 15 seconds which is the
@@ -52,21 +61,28 @@ static constexpr std::chrono::seconds kDefaultIFrameInterval{15};
 namespace ac {
 namespace gst {
 
+// Hands the encoded bitstream to the packetizer straight out of the
+// mapped GstBuffer. The wrapper owns the sample reference and only
+// releases it when the last holder of the video::Buffer lets go, so
+// frames queued downstream stay valid without ever copying the
+// 10-500KB of encoded data out of GStreamer's memory.
 class GstH264Buffer : public video::Buffer
 {
 public:
     typedef std::shared_ptr<GstH264Buffer> Ptr;
 
     ~GstH264Buffer() {
-        if (!buffer_)
+        if (!sample_)
             return;
         gst_buffer_unmap(buffer_, &mapinfo_);
-        gst_buffer_unref(buffer_);
+        gst_sample_unref(sample_);
     }
 
-    static GstH264Buffer::Ptr Create(GstBuffer *buffer) {
+    // Takes ownership of the caller's sample reference
+    static GstH264Buffer::Ptr Create(GstSample *sample) {
         const auto sp = std::shared_ptr<GstH264Buffer>(new GstH264Buffer);
-        sp->buffer_ = buffer;
+        sp->sample_ = sample;
+        sp->buffer_ = gst_sample_get_buffer(sample);
         sp->ExtractTimestamp();
 
         gst_buffer_map(sp->buffer_, &sp->mapinfo_, GST_MAP_READ);
@@ -95,6 +111,7 @@ private:
 
 private:
     GstMapInfo mapinfo_;
+    GstSample *sample_;
     GstBuffer *buffer_;
 };
 
@@ -115,22 +132,21 @@ static GstFlowReturn new_sample(GstElement* sink, H264Encoder *data) {
         return GST_FLOW_EOS;
     }
 
-    GstBuffer* output_buffer = gst_sample_get_buffer(sample);
-    if (!output_buffer) {
+    if (!gst_sample_get_buffer(sample)) {
         gst_sample_unref(sample);
         AC_WARNING("Failed to get output buffer");
         return GST_FLOW_EOS;
     }
 
-    // Create sendable video buffer out of gstreamer output buffer
-    video::Buffer::Ptr send_buffer = GstH264Buffer::Create(output_buffer);
+    // The wrapper takes over our sample reference and keeps it until
+    // everything downstream finished with the frame.
+    video::Buffer::Ptr send_buffer = GstH264Buffer::Create(sample);
+    send_buffer->SetFrameId(data->NextPendingFrameId());
 
     if (auto sp = data->Delegate().lock())
         sp->OnBufferAvailable(send_buffer);
 
-    data->Report()->FinishedFrame(send_buffer->Timestamp());
-
-    gst_sample_unref(sample);
+    AC_REPORT(data->Report()->FinishedFrame(send_buffer->Timestamp(), send_buffer->FrameId()));
 
     return GST_FLOW_OK;
 }
@@ -150,7 +166,7 @@ video::BaseEncoder::Ptr H264Encoder::Create(const video::EncoderReport::Ptr &rep
 H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report) :
     report_(report),
     running_(false),
-    input_queue_(ac::video::BufferQueue::Create()),
+    input_queue_(ac::video::BufferQueue::CreateSPSC()),
     start_time_(-1ll),
     frame_count_(0)
 {
@@ -180,13 +196,42 @@ H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report) :
         "format", GST_FORMAT_TIME,
         nullptr);
 
-    converter_ = gst_element_factory_make("videoconvert", nullptr);
-    if (!converter_) {
-        AC_WARNING("Failed to set up converter");
-        return;
+    // Colorspace conversion to the encoder's YUV format is the most
+    // expensive CPU stage of the pipeline; prefer the GL elements which
+    // run the conversion matrix on the GPU and only fall back to the
+    // software videoconvert when they aren't available.
+    gl_upload_ = gst_element_factory_make("glupload", nullptr);
+    gl_convert_ = gst_element_factory_make("glcolorconvert", nullptr);
+    gl_download_ = gst_element_factory_make("gldownload", nullptr);
+
+    if (!gl_upload_ || !gl_convert_ || !gl_download_) {
+        AC_WARNING("GL conversion elements not available; converting on the CPU");
+
+        if (gl_upload_)
+            gst_object_unref(gl_upload_);
+        if (gl_convert_)
+            gst_object_unref(gl_convert_);
+        if (gl_download_)
+            gst_object_unref(gl_download_);
+        gl_upload_ = gl_convert_ = gl_download_ = nullptr;
+
+        converter_ = gst_element_factory_make("videoconvert", nullptr);
+        if (!converter_) {
+            AC_WARNING("Failed to set up converter");
+            return;
+        }
     }
 
     encoder_ = gst_element_factory_make("droidvenc", nullptr);
+    if (!encoder_) {
+        // Dev boards and containers have no hardware codec element;
+        // x264 gets the session going there and Configure() tunes it
+        // below so the fallback is actually watchable.
+        encoder_ = gst_element_factory_make("x264enc", nullptr);
+        software_encoder_ = encoder_ != nullptr;
+        if (software_encoder_)
+            AC_INFO("No hardware encoder element available; falling back to software x264");
+    }
     if (!encoder_) {
         AC_WARNING("Failed to set up encoder");
         return;
@@ -204,8 +249,15 @@ H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report) :
         return;
     }
 
-    gst_bin_add_many(GST_BIN(pipeline_), appsource_, converter_, encoder_, appsink_, NULL);
-    gst_element_link_many(appsource_, converter_, encoder_, appsink_, NULL);
+    if (gl_convert_) {
+        gst_bin_add_many(GST_BIN(pipeline_), appsource_, gl_upload_, gl_convert_,
+                         gl_download_, encoder_, appsink_, NULL);
+        gst_element_link_many(appsource_, gl_upload_, gl_convert_, gl_download_,
+                              encoder_, appsink_, NULL);
+    } else {
+        gst_bin_add_many(GST_BIN(pipeline_), appsource_, converter_, encoder_, appsink_, NULL);
+        gst_element_link_many(appsource_, converter_, encoder_, appsink_, NULL);
+    }
 
     /* Connect to the pad-added signal */
     g_signal_connect(appsource_, "need-data", G_CALLBACK(start_feed), this);
@@ -224,6 +276,12 @@ H264Encoder::~H264Encoder() {
     } else {
         if (converter_)
             gst_object_unref(converter_);
+        if (gl_upload_)
+            gst_object_unref(gl_upload_);
+        if (gl_convert_)
+            gst_object_unref(gl_convert_);
+        if (gl_download_)
+            gst_object_unref(gl_download_);
         if (encoder_)
             gst_object_unref(encoder_);
         if (appsink_)
@@ -235,11 +293,80 @@ H264Encoder::~H264Encoder() {
     gst_deinit();
 }
 
+bool H264Encoder::SupportsCodec(video::CodecType codec) const {
+    if (codec == video::CodecType::kH264)
+        return true;
+
+    if (codec != video::CodecType::kHEVC || !encoder_)
+        return false;
+
+    // The droid encoder element picks its codec from the downstream
+    // caps, so whether HEVC works is a question to its src pad.
+    const auto pad = gst_element_get_static_pad(encoder_, "src");
+    if (!pad)
+        return false;
+
+    auto caps = gst_pad_query_caps(pad, nullptr);
+    auto hevc = gst_caps_new_empty_simple(kHEVCMimeType);
+
+    const auto supported = gst_caps_can_intersect(caps, hevc);
+
+    gst_caps_unref(hevc);
+    gst_caps_unref(caps);
+    gst_object_unref(pad);
+
+    return supported == TRUE;
+}
+
 bool H264Encoder::Configure(const Config &config) {
     if (!encoder_)
         return false;
 
-    AC_DEBUG("configuring with %dx%d@%d", config.width, config.height, config.framerate);
+    AC_DEBUG("configuring with %dx%d@%d (%s)", config.width, config.height,
+             config.framerate, video::CodecTypeToString(config.codec));
+
+    if (config.codec == video::CodecType::kHEVC) {
+        if (!SupportsCodec(config.codec)) {
+            AC_ERROR("Encoder element cannot produce HEVC");
+            return false;
+        }
+
+        // Pin the encoder/appsink link to H.265 so caps negotiation
+        // switches the codec; without a filter the element stays on
+        // its H.264 default.
+        gst_element_unlink(encoder_, appsink_);
+
+        auto caps = gst_caps_new_empty_simple(kHEVCMimeType);
+        const auto linked = gst_element_link_filtered(encoder_, appsink_, caps);
+        gst_caps_unref(caps);
+
+        if (!linked) {
+            AC_ERROR("Failed to link encoder for HEVC output");
+            return false;
+        }
+    }
+
+    if (config.intra_refresh_frames > 0) {
+        // Plugins which support gradual refresh expose it as a simple
+        // toggle; the refresh period then follows the keyframe interval.
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(encoder_), "intra-refresh"))
+            g_object_set(G_OBJECT(encoder_), "intra-refresh", TRUE, nullptr);
+        else
+            AC_WARNING("Encoder element does not support intra refresh; keeping periodic IDR frames");
+    }
+
+    if (config.slices > 1) {
+        // Multi-slice frames let encoder and sink decoder spread one
+        // frame over several cores; probe for the property as not all
+        // elements expose slice control.
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(encoder_), "slices"))
+            g_object_set(G_OBJECT(encoder_), "slices", config.slices, nullptr);
+        else
+            AC_WARNING("Encoder element does not support slice control; encoding one slice per frame");
+    }
+
+    if (software_encoder_)
+        ConfigureSoftwareEncoder(config);
 
     config_ = config;
 
@@ -248,6 +375,44 @@ bool H264Encoder::Configure(const Config &config) {
     return true;
 }
 
+void H264Encoder::ConfigureSoftwareEncoder(const Config &config) {
+    // x264's defaults are built for offline quality: lookahead, frame
+    // threading and a generous VBV buffer add the best part of a
+    // second of delay and serialize on one core. The zerolatency tune
+    // drops the lookahead, sliced threading spreads every single
+    // frame across the cores without the frame-thread latency, and a
+    // VBV of two frame intervals keeps rate overshoot from queueing
+    // up in the radio. Together this makes 720p30 feasible on a
+    // quad-core instead of a slideshow.
+    auto threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    const gint framerate = config.framerate > 0 ? config.framerate : kAnyFramerate;
+    const guint vbv_ms = std::max(2 * 1000 / framerate, 33);
+    // x264 counts in kbit/s
+    const guint bitrate_kbit = std::max(config.bitrate / 1000, 1u);
+    const gint i_frame_interval = config.i_frame_interval > 0
+            ? config.i_frame_interval : 1;
+
+    g_object_set(G_OBJECT(encoder_),
+                 "tune", kX264TuneZeroLatency,
+                 "speed-preset", kX264PresetVeryFast,
+                 "pass", kX264PassCBR,
+                 "threads", static_cast<guint>(threads),
+                 "sliced-threads", TRUE,
+                 "bitrate", bitrate_kbit,
+                 "vbv-buf-capacity", vbv_ms,
+                 "key-int-max", framerate * i_frame_interval,
+                 // The packetizer expects Annex B access units like
+                 // the hardware elements produce
+                 "byte-stream", TRUE,
+                 nullptr);
+
+    AC_INFO("Software encoder: %u threads (sliced), CBR %u kbit/s, VBV %u ms",
+            threads, bitrate_kbit, vbv_ms);
+}
+
 bool H264Encoder::ApplyConfiguration() {
     GstCaps *caps;
 
@@ -330,31 +495,52 @@ void H264Encoder::QueueBuffer(const video::Buffer::Ptr &buffer) {
     if (!running_)
         return;
 
+    if (ConsumeIDRRequest())
+        SendIDRFrame();
+
     input_queue_->Push(buffer);
 
-    report_->ReceivedInputBuffer(buffer->Timestamp());
+    AC_REPORT(report_->ReceivedInputBuffer(buffer->Timestamp()));
 }
 
 void H264Encoder::PushBuffer() {
-    GstMapInfo map;
-
     // Get new frame from Mir first
     AC_DEBUG("Getting next frame from input queue");
     video::Buffer::Ptr input_buffer = input_queue_->Next();
 
-    report_->BeganFrame(input_buffer->Timestamp());
+    AC_REPORT(report_->BeganFrame(input_buffer->Timestamp()));
 
-    // Feed frame into GStreamer for encoding with our prefered encoder
-    GstBuffer* feed_buffer = gst_buffer_new_and_alloc (input_buffer->Length());
-    gst_buffer_map(feed_buffer, &map, GST_MAP_WRITE);
-    std::memcpy(map.data, input_buffer->Data(), input_buffer->Length());
-    gst_buffer_unmap(feed_buffer, &map);
+    // Hand the frame memory to GStreamer without copying it. The
+    // wrapped buffer holds a reference on the input buffer and only
+    // releases it back to the capture path once the whole pipeline is
+    // done reading, so the producer can't recycle it underneath us.
+    const auto keep_alive = new video::Buffer::Ptr(input_buffer);
+    GstBuffer *feed_buffer = gst_buffer_new_wrapped_full(
+        GST_MEMORY_FLAG_READONLY,
+        input_buffer->Data(), input_buffer->Length(),
+        0, input_buffer->Length(),
+        keep_alive,
+        [](gpointer data) { delete static_cast<video::Buffer::Ptr*>(data); });
 
     GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(appsource_), feed_buffer);
     if (ret != GST_FLOW_OK) {
         AC_DEBUG("Flow not okay, trying next iteration");
         return;
     }
+
+    std::lock_guard<std::mutex> lock(pending_frame_ids_mutex_);
+    pending_frame_ids_.push_back(input_buffer->FrameId());
+}
+
+ac::FrameId H264Encoder::NextPendingFrameId() {
+    std::lock_guard<std::mutex> lock(pending_frame_ids_mutex_);
+
+    if (pending_frame_ids_.empty())
+        return 0;
+
+    const auto frame_id = pending_frame_ids_.front();
+    pending_frame_ids_.pop_front();
+    return frame_id;
 }
 
 video::BaseEncoder::Config H264Encoder::Configuration() const {
@@ -369,10 +555,72 @@ video::EncoderReport::Ptr H264Encoder::Report() {
     return report_;
 }
 
+bool H264Encoder::SetTargetBitrate(unsigned int bitrate) {
+    if (!encoder_)
+        return false;
+
+    // Encoder elements disagree on the property name; probe the two
+    // common ones before giving up.
+    const char *property = nullptr;
+    if (g_object_class_find_property(G_OBJECT_GET_CLASS(encoder_), "bitrate"))
+        property = "bitrate";
+    else if (g_object_class_find_property(G_OBJECT_GET_CLASS(encoder_), "target-bitrate"))
+        property = "target-bitrate";
+
+    if (!property) {
+        AC_WARNING("Encoder element does not allow changing the bitrate");
+        return false;
+    }
+
+    // x264 counts its bitrate in kbit/s, the hardware elements in
+    // bit/s
+    const guint value = software_encoder_
+            ? std::max(bitrate / 1000, 1u) : bitrate;
+    g_object_set(G_OBJECT(encoder_), property, value, nullptr);
+    config_.bitrate = bitrate;
+
+    AC_DEBUG("Changed encoder target bitrate to %d bit/s", bitrate);
+
+    return true;
+}
+
+bool H264Encoder::SetTargetFramerate(int framerate) {
+    if (!encoder_ || framerate <= 0)
+        return false;
+
+    if (!g_object_class_find_property(G_OBJECT_GET_CLASS(encoder_), "framerate")) {
+        AC_WARNING("Encoder element does not allow changing the framerate");
+        return false;
+    }
+
+    g_object_set(G_OBJECT(encoder_), "framerate", framerate, nullptr);
+    config_.framerate = framerate;
+
+    AC_DEBUG("Changed encoder target framerate to %d fps", framerate);
+
+    return true;
+}
+
 void H264Encoder::SendIDRFrame() {
     // Not supported for now
 }
 
+bool H264Encoder::Reconfigure(const Config &config) {
+    AC_DEBUG("reconfiguring with %dx%d@%d", config.width, config.height, config.framerate);
+
+    // The elements stay linked; the pipeline just has to leave PLAYING
+    // while the new caps take effect.
+    Stop();
+
+    // Frames captured at the old resolution are useless now
+    input_queue_->PopAll();
+
+    start_time_ = -1ll;
+    frame_count_ = 0;
+
+    return Configure(config);
+}
+
 std::string H264Encoder::Name() const {
     return kEncoderThreadName;
 }
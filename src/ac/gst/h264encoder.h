@@ -19,7 +19,9 @@
 #ifndef AC_GST_ENCODER_H_
 #define AC_GST_ENCODER_H_
 
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include <glib.h>
@@ -49,6 +51,8 @@ public:
 
     bool Configure(const BaseEncoder::Config &config) override;
 
+    bool SupportsCodec(video::CodecType codec) const override;
+
     void QueueBuffer(const ac::video::Buffer::Ptr &buffer) override;
 
     bool Running() const override { return running_; }
@@ -56,15 +60,28 @@ public:
 
     void SendIDRFrame() override;
 
+    bool Reconfigure(const BaseEncoder::Config &config) override;
+
+    bool SetTargetBitrate(unsigned int bitrate) override;
+    bool SetTargetFramerate(int framerate) override;
+
     // From ac::common::Executable
     bool Start() override;
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    // Execute() runs the GLib main loop until the encoder stops and
+    // cannot share an executor loop
+    bool PrefersDedicatedThread() const override { return true; }
 
 private:
     H264Encoder(const video::EncoderReport::Ptr &report);
 
+    // Applies the low-latency x264 preset (zerolatency tune, sliced
+    // threading across all cores, CBR with a tight VBV) which makes
+    // the software fallback usable for live streaming.
+    void ConfigureSoftwareEncoder(const Config &config);
+
 private:
     GMainContext *context_ = nullptr;
     GMainLoop *loop_ = nullptr;
@@ -74,13 +91,25 @@ public:
     GstElement *appsink_ = nullptr;
     GstElement *encoder_ = nullptr;
     GstElement *converter_ = nullptr;
+    // GPU colorspace conversion stage; only set when the GL elements
+    // are available, otherwise converter_ does the work on the CPU.
+    GstElement *gl_upload_ = nullptr;
+    GstElement *gl_convert_ = nullptr;
+    GstElement *gl_download_ = nullptr;
     GstElement *pipeline_ = nullptr;
+    // Whether encoder_ is the x264 fallback rather than a hardware
+    // element; x264 counts bitrate in kbit/s and needs its own tuning.
+    bool software_encoder_ = false;
 
 public:
     bool ApplyConfiguration();
     void PushBuffer();
     std::weak_ptr<video::BaseEncoder::Delegate> Delegate();
     video::EncoderReport::Ptr Report();
+    // Frame id of the oldest frame still inside the pipeline; the
+    // encoder emits frames in submission order so the output sample
+    // callback claims ids front to back. Returns 0 when drained.
+    ac::FrameId NextPendingFrameId();
 
 private:
     video::EncoderReport::Ptr report_;
@@ -89,6 +118,10 @@ private:
     ac::video::BufferQueue::Ptr input_queue_;
     ac::TimestampUs start_time_;
     uint32_t frame_count_;
+    // Feeding and sample retrieval happen on different streaming
+    // threads
+    std::mutex pending_frame_ids_mutex_;
+    std::deque<ac::FrameId> pending_frame_ids_;
 };
 
 } // namespace gst
@@ -17,10 +17,85 @@
 #ifndef KEEP_ALIVE_H_
 #define KEEP_ALIVE_H_
 
+#include <cstddef>
 #include <memory>
+#include <mutex>
 
 namespace ac {
 namespace detail {
+
+// Backs every KeepAlive<> trampoline with recycled fixed-size slots.
+// Each GLib timeout/idle/io/dbus callback we schedule wraps its context
+// in a KeepAlive<>, and during discovery the w11tng stubs and the dbus
+// skeletons go through thousands of them, so one-shot trampolines used
+// to dominate the main loop's allocation churn. Every instantiation is
+// the size of a shared_ptr no matter what it points at, which makes a
+// single slot size cover them all. Slots come out of chunk-allocated
+// blocks which live for the process lifetime; at peak we keep a few
+// hundred trampolines in flight so the retained memory is a handful of
+// blocks.
+class TrampolinePool {
+public:
+    static constexpr std::size_t kSlotSize{sizeof(std::shared_ptr<void>)};
+
+    static TrampolinePool& Instance() {
+        static TrampolinePool pool;
+        return pool;
+    }
+
+    void* Allocate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!free_)
+            Grow();
+
+        const auto slot = free_;
+        free_ = slot->next;
+        return slot;
+    }
+
+    void Release(void *memory) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const auto slot = static_cast<Slot*>(memory);
+        slot->next = free_;
+        free_ = slot;
+    }
+
+private:
+    // Large enough that a steady discovery round stays within one block,
+    // small enough that the first callback ever scheduled doesn't buy a
+    // page of slots it will never use.
+    static constexpr std::size_t kSlotsPerBlock{64};
+
+    union Slot {
+        Slot *next;
+        unsigned char storage[kSlotSize];
+    };
+
+    struct Block {
+        Block *next;
+        Slot slots[kSlotsPerBlock];
+    };
+
+    TrampolinePool() = default;
+
+    void Grow() {
+        const auto block = new Block;
+        block->next = blocks_;
+        blocks_ = block;
+
+        for (std::size_t n = 0; n < kSlotsPerBlock; n++) {
+            block->slots[n].next = free_;
+            free_ = &block->slots[n];
+        }
+    }
+
+    std::mutex mutex_;
+    Slot *free_ = nullptr;
+    Block *blocks_ = nullptr;
+};
+
 template<typename T, template<typename> class Ptr>
 class KeepAlive {
 public:
@@ -37,6 +112,17 @@ public:
         return inst;
     }
 
+    static void* operator new(std::size_t size) {
+        static_assert(sizeof(KeepAlive) <= TrampolinePool::kSlotSize,
+                      "KeepAlive must fit a trampoline pool slot");
+        (void) size;
+        return TrampolinePool::Instance().Allocate();
+    }
+
+    static void operator delete(void *memory) {
+        TrampolinePool::Instance().Release(memory);
+    }
+
 private:
     Ptr<T> inst_;
 };
@@ -53,7 +139,9 @@ using SharedKeepAlive = detail::KeepAlive<T, std::shared_ptr>;
 // system that takes context as a void* (e.g., the glib calls in this class).
 // A WeekKeepAlive<T> instance simply wraps a weak managed ptr to an instance of T and keeps
 // it alive while an async operation is in progress. It is specifically meant for pub-sub
-// setups, with the callback staying alive across invocations.
+// setups, with the callback staying alive across invocations; prefer it over
+// repeatedly scheduling one-shot SharedKeepAlive<T> trampolines when the
+// target is known to outlive the event source.
 template<typename T>
 using WeakKeepAlive = detail::KeepAlive<T, std::weak_ptr>;
 }
@@ -15,8 +15,10 @@
  *
  */
 
+#include <algorithm>
 #include <thread>
 
+#include "asynclogger.h"
 #include "logger.h"
 
 #define BOOST_LOG_DYN_LINK
@@ -101,7 +103,50 @@ void SetInstance(const std::shared_ptr<ac::Logger>& logger) {
     MutableInstance() = logger;
 }
 }
+namespace {
+// Enough burst for a handful of distinct one-off errors in quick
+// succession, then one message per second until the storm subsides
+constexpr std::int32_t kRateLimiterBurst{5};
+constexpr ac::TimestampUs kRateLimiterRefillIntervalUs{1000000ll};
+}
+
 namespace ac {
+
+LogRateLimiter::LogRateLimiter() :
+    tokens_(kRateLimiterBurst),
+    last_refill_us_(static_cast<ac::TimestampUs>(Utils::GetNowUs())),
+    suppressed_(0) {
+}
+
+bool LogRateLimiter::Allow(std::uint64_t *suppressed) {
+    const auto now = static_cast<ac::TimestampUs>(Utils::GetNowUs());
+
+    // Whoever wins the exchange refills for the elapsed time; the
+    // losers simply see the updated bucket. A race costs at most one
+    // extra or one missing line, never a blocked packet path.
+    auto last = last_refill_us_.load(std::memory_order_relaxed);
+    if (now - last >= kRateLimiterRefillIntervalUs
+            && last_refill_us_.compare_exchange_strong(last, now)) {
+        const auto earned = (now - last) / kRateLimiterRefillIntervalUs;
+        const auto tokens = static_cast<std::int64_t>(tokens_.load(std::memory_order_relaxed));
+        tokens_.store(static_cast<std::int32_t>(
+                          std::min<std::int64_t>(kRateLimiterBurst, tokens + earned)),
+                      std::memory_order_relaxed);
+    }
+
+    if (tokens_.fetch_sub(1, std::memory_order_relaxed) > 0) {
+        *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Hand the token back so a long storm cannot drive the bucket
+    // arbitrarily far negative
+    tokens_.fetch_add(1, std::memory_order_relaxed);
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+
+    return false;
+}
+
 void Logger::Trace(const std::string& message, const boost::optional<Location>& location) {
     Log(Severity::kTrace, message, location);
 }
@@ -149,4 +194,11 @@ Logger& Log() {
 void SetLogger(const std::shared_ptr<Logger>& logger) {
     SetInstance(logger);
 }
+
+void EnableAsyncLogging() {
+    if (std::dynamic_pointer_cast<AsyncLogger>(MutableInstance()))
+        return;
+
+    SetInstance(std::make_shared<AsyncLogger>(MutableInstance()));
+}
 }
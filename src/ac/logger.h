@@ -23,8 +23,24 @@
 
 #include <boost/optional.hpp>
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
+// The minimum severity compiled into the binary, as a numeric
+// Logger::Severity value. Statements below it collapse into a dead
+// branch the compiler removes entirely -- no Location, no argument
+// evaluation, no call into the logger -- while the call sites stay in
+// the source. Release builds drop the per-packet trace and debug
+// output by default; pass -DAC_MIN_LOG_SEVERITY=<n> to override.
+#ifndef AC_MIN_LOG_SEVERITY
+#ifdef NDEBUG
+#define AC_MIN_LOG_SEVERITY 2
+#else
+#define AC_MIN_LOG_SEVERITY 0
+#endif
+#endif
+
 namespace ac {
 // A Logger enables persisting of messages describing & explaining the
 // state of the system.
@@ -50,6 +66,12 @@ public:
 
     virtual void Init(const ac::Logger::Severity &severity = ac::Logger::Severity::kWarning) = 0;
 
+    // Messages below the threshold are dropped before their format
+    // string is ever expanded; defaults to kTrace so everything goes
+    // through unless a threshold is explicitly configured.
+    void SetThreshold(const Severity &severity) { threshold_.store(severity, std::memory_order_relaxed); }
+    bool IsEnabledFor(const Severity &severity) const { return severity >= threshold_.load(std::memory_order_relaxed); }
+
     virtual void Log(Severity severity, const std::string &message, const boost::optional<Location>& location) = 0;
 
     virtual void Trace(const std::string& message, const boost::optional<Location>& location = boost::optional<Location>{});
@@ -62,38 +84,80 @@ public:
 
     template<typename... T>
     void Tracef(const boost::optional<Location>& location, const std::string& pattern, T&&...args) {
+        if (!IsEnabledFor(Severity::kTrace))
+            return;
         Trace(Utils::Sprintf(pattern, std::forward<T>(args)...), location);
     }
 
     template<typename... T>
     void Debugf(const boost::optional<Location>& location, const std::string& pattern, T&&...args) {
+        if (!IsEnabledFor(Severity::kDebug))
+            return;
         Debug(Utils::Sprintf(pattern, std::forward<T>(args)...), location);
     }
 
     template<typename... T>
     void Infof(const boost::optional<Location>& location, const std::string& pattern, T&&...args) {
+        if (!IsEnabledFor(Severity::kInfo))
+            return;
         Info(Utils::Sprintf(pattern, std::forward<T>(args)...), location);
     }
 
     template<typename... T>
     void Warningf(const boost::optional<Location>& location, const std::string& pattern, T&&...args) {
+        if (!IsEnabledFor(Severity::kWarning))
+            return;
         Warning(Utils::Sprintf(pattern, std::forward<T>(args)...), location);
     }
 
     template<typename... T>
     void Errorf(const boost::optional<Location>& location, const std::string& pattern, T&&...args) {
+        if (!IsEnabledFor(Severity::kError))
+            return;
         Error(Utils::Sprintf(pattern, std::forward<T>(args)...), location);
     }
 
     template<typename... T>
     void Fatalf(const boost::optional<Location>& location, const std::string& pattern, T&&...args) {
+        if (!IsEnabledFor(Severity::kFatal))
+            return;
         Fatal(Utils::Sprintf(pattern, std::forward<T>(args)...), location);
     }
 
 protected:
     Logger() = default;
+
+private:
+    std::atomic<Severity> threshold_{Severity::kTrace};
 };
 
+// Guards one logging call site against message storms: a small token
+// bucket lets occasional messages through untouched while a flood --
+// say a network outage failing every datagram -- collapses into a few
+// lines per second plus a count of what was dropped. Lock-free so it
+// can sit on packet hot paths; used via the *_RATE_LIMITED macros
+// below which keep one limiter per call site.
+class LogRateLimiter {
+public:
+    LogRateLimiter();
+
+    // Returns true when the call site may log. *suppressed carries
+    // the number of messages dropped since the last one let through
+    // so the caller can surface them in a summary line.
+    bool Allow(std::uint64_t *suppressed);
+
+private:
+    std::atomic<std::int32_t> tokens_;
+    std::atomic<ac::TimestampUs> last_refill_us_;
+    std::atomic<std::uint64_t> suppressed_;
+};
+
+// The compiled minimum severity; see AC_MIN_LOG_SEVERITY above. The
+// runtime threshold can only raise the bar further, never lower it
+// below what is compiled in.
+constexpr Logger::Severity kMinCompiledSeverity{
+    static_cast<Logger::Severity>(AC_MIN_LOG_SEVERITY)};
+
 // operator<< inserts severity into out.
 std::ostream& operator<<(std::ostream& out, Logger::Severity severity);
 
@@ -105,13 +169,45 @@ std::ostream& operator<<(std::ostream& out, const Logger::Location &location);
 Logger& Log();
 // SetLog installs the given logger as ac-wide default logger.
 void SetLogger(const std::shared_ptr<Logger>& logger);
+// EnableAsyncLogging wraps the currently installed logger so that all
+// records travel through a bounded queue serviced by a dedicated
+// writer thread and callers never block on the sink. Idempotent.
+void EnableAsyncLogging();
 }
 
-#define AC_TRACE(...) ac::Log().Tracef(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define AC_DEBUG(...) ac::Log().Debugf(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define AC_INFO(...) ac::Log().Infof(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define AC_WARNING(...) ac::Log().Warningf(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define AC_ERROR(...) ac::Log().Errorf(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define AC_FATAL(...) ac::Log().Fatalf(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
+// The constant severity comparison lets the compiler drop statements
+// below the compiled minimum as dead code.
+#define AC_LOG_AT(severity_, method_, ...) \
+    do { \
+        if (ac::Logger::Severity::severity_ >= ac::kMinCompiledSeverity) \
+            ac::Log().method_(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__); \
+    } while (0)
+
+// Rate-limited variant for per-packet paths where an error condition
+// repeats thousands of times per second; the suppressed messages show
+// up as a count the next time the call site gets to log.
+#define AC_LOG_AT_RATE_LIMITED(severity_, method_, ...) \
+    do { \
+        if (ac::Logger::Severity::severity_ >= ac::kMinCompiledSeverity) { \
+            static ac::LogRateLimiter ac_log_rate_limiter_; \
+            std::uint64_t ac_log_suppressed_ = 0; \
+            if (ac_log_rate_limiter_.Allow(&ac_log_suppressed_)) { \
+                if (ac_log_suppressed_ > 0) \
+                    ac::Log().method_(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, \
+                                      "%d similar messages suppressed", ac_log_suppressed_); \
+                ac::Log().method_(ac::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define AC_TRACE(...) AC_LOG_AT(kTrace, Tracef, __VA_ARGS__)
+#define AC_DEBUG(...) AC_LOG_AT(kDebug, Debugf, __VA_ARGS__)
+#define AC_INFO(...) AC_LOG_AT(kInfo, Infof, __VA_ARGS__)
+#define AC_WARNING(...) AC_LOG_AT(kWarning, Warningf, __VA_ARGS__)
+#define AC_ERROR(...) AC_LOG_AT(kError, Errorf, __VA_ARGS__)
+#define AC_FATAL(...) AC_LOG_AT(kFatal, Fatalf, __VA_ARGS__)
+
+#define AC_WARNING_RATE_LIMITED(...) AC_LOG_AT_RATE_LIMITED(kWarning, Warningf, __VA_ARGS__)
+#define AC_ERROR_RATE_LIMITED(...) AC_LOG_AT_RATE_LIMITED(kError, Errorf, __VA_ARGS__)
 
 #endif
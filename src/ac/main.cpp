@@ -15,8 +15,12 @@
  *
  */
 
+#include "ac/report/startuptrace.h"
+
 #include "service.h"
 
 int main(int argc, char **argv) {
+    ac::report::StartupTrace::Instance().Mark(ac::report::kStartupMilestoneMainEntry);
+
     return ac::Service::Main(ac::Service::MainOptions::FromCommandLine(argc, argv));
 }
@@ -19,21 +19,29 @@
 
 #include <hybris/properties/properties.h>
 
+#include "ac/encodercapabilitycache.h"
 #include "ac/logger.h"
 #include "ac/mediamanagerfactory.h"
 #include "ac/utils.h"
 #include "ac/logger.h"
 
+#include "ac/mir/connectioncache.h"
 #include "ac/mir/sourcemediamanager.h"
 
+#include "ac/common/sharedthreadexecutorfactory.h"
 #include "ac/common/threadedexecutorfactory.h"
+#include "ac/common/workstealingexecutorfactory.h"
 
 #include "ac/report/reportfactory.h"
 
 #include "ac/network/udpstream.h"
 
+#include "ac/video/syntheticbufferproducer.h"
+
 #include "ac/android/h264encoder.h"
 #include "ac/gst/h264encoder.h"
+#include "ac/v4l2/h264encoder.h"
+#include "ac/vaapi/h264encoder.h"
 
 namespace ac {
 
@@ -59,6 +67,23 @@ bool NullSourceMediaManager::Configure() {
     return false;
 }
 
+void MediaManagerFactory::PrewarmSources() {
+    std::string type = Utils::GetEnvValue("MIRACAST_SOURCE_TYPE");
+    if (type.length() == 0)
+        type = "mir";
+
+    // Connecting to the display server and enumerating its outputs
+    // takes long enough to be visible in the time to first frame, so
+    // it happens once at startup instead of on the session setup path.
+    if (type == "mir")
+        ac::mir::ConnectionCache::Instance().Prewarm();
+
+    // Same for the encoder capability table: loading it (and asking
+    // the property service for the image fingerprint it is keyed by)
+    // happens now so session setup only does map lookups.
+    EncoderCapabilityCache::Instance();
+}
+
 std::shared_ptr<BaseSourceMediaManager> MediaManagerFactory::CreateSource(const std::string &remote_address,
                                                                           const ac::network::Stream::Ptr &output_stream) {
     std::string type = Utils::GetEnvValue("MIRACAST_SOURCE_TYPE");
@@ -68,7 +93,7 @@ std::shared_ptr<BaseSourceMediaManager> MediaManagerFactory::CreateSource(const
     AC_DEBUG("Creating source media manager of type %s", type.c_str());
 
     if (type == "mir") {
-        // Shipped encoders: "", "gst"
+        // Shipped encoders: "", "gst", "v4l2", "vaapi"
         // Effectively only the legacy one is tested
         std::string encoder_name = "";
         char encoder_prop[PROP_VALUE_MAX];
@@ -85,17 +110,42 @@ std::shared_ptr<BaseSourceMediaManager> MediaManagerFactory::CreateSource(const
             readout = true;
         }
 
-        const auto executor_factory = std::make_shared<common::ThreadedExecutorFactory>();
+        // On small single-stream targets one shared loop for the
+        // lightweight pipeline stages saves threads and context
+        // switches; encoder and renderer keep their own threads. The
+        // pooled mode goes one step further and balances the stages
+        // of all concurrent sessions over one fixed set of workers
+        // so a second sink does not double the thread count.
+        common::ExecutorFactory::Ptr executor_factory;
+        if (Utils::IsEnvSet("AETHERCAST_POOLED_EXECUTOR"))
+            executor_factory = std::make_shared<common::WorkStealingExecutorFactory>();
+        else if (Utils::IsEnvSet("AETHERCAST_SHARED_EXECUTOR"))
+            executor_factory = std::make_shared<common::SharedThreadExecutorFactory>();
+        else
+            executor_factory = std::make_shared<common::ThreadedExecutorFactory>();
+        // The synthetic source swaps the display capture for generated
+        // frames so benchmark and soak runs can saturate the pipeline
+        // without a compositor; those frames live in main memory, so
+        // the encoder has to run in readout mode to ingest them.
+        ac::video::BufferProducer::Ptr producer;
+        if (Utils::IsEnvSet("AETHERCAST_SYNTHETIC_SOURCE")) {
+            producer = ac::video::SyntheticBufferProducer::Create();
+            readout = true;
+        } else {
+            producer = std::make_shared<ac::mir::Screencast>(readout);
+        }
+
         const auto report_factory = report::ReportFactory::Create();
-        const auto screencast = std::make_shared<ac::mir::Screencast>(readout);
-        const auto encoder = 
+        const auto encoder =
             (encoder_name == "gst") ? ac::gst::H264Encoder::Create(report_factory->CreateEncoderReport()) :
+            (encoder_name == "v4l2") ? ac::v4l2::H264Encoder::Create(report_factory->CreateEncoderReport()) :
+            (encoder_name == "vaapi") ? ac::vaapi::H264Encoder::Create(report_factory->CreateEncoderReport()) :
             ac::android::H264Encoder::Create(report_factory->CreateEncoderReport(), readout);
 
         return std::make_shared<ac::mir::SourceMediaManager>(
                     remote_address,
                     executor_factory,
-                    screencast,
+                    producer,
                     encoder,
                     output_stream,
                     report_factory);
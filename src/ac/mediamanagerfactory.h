@@ -43,6 +43,10 @@ class MediaManagerFactory {
 public:
     static std::shared_ptr<BaseSourceMediaManager> CreateSource(const std::string &remote_address,
                                                                 const ac::network::Stream::Ptr &output_stream);
+
+    // Warms up whatever the configured source type needs to hand out
+    // its first frame quickly. Called once at service startup.
+    static void PrewarmSources();
 };
 } // namespace ac
 #endif
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/mir/connectioncache.h"
+
+namespace {
+static constexpr const char *kMirSocket{"/run/mir_socket"};
+static constexpr const char *kMirConnectionName{"aethercast screencast client"};
+}
+
+namespace ac {
+namespace mir {
+
+ConnectionCache& ConnectionCache::Instance() {
+    static ConnectionCache instance;
+    return instance;
+}
+
+ConnectionCache::~ConnectionCache() {
+    Reset();
+}
+
+void ConnectionCache::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (pending_connection_.valid())
+        connection_ = pending_connection_.get();
+
+    if (display_config_) {
+        mir_display_config_destroy(display_config_);
+        display_config_ = nullptr;
+    }
+
+    if (connection_) {
+        mir_connection_release(connection_);
+        connection_ = nullptr;
+    }
+
+    display_config_dirty_ = true;
+}
+
+void ConnectionCache::Prewarm() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (connection_ || pending_connection_.valid())
+        return;
+
+    AC_DEBUG("Pre-warming Mir connection");
+
+    pending_connection_ = std::async(std::launch::async, []() {
+        return mir_connect_sync(kMirSocket, kMirConnectionName);
+    });
+}
+
+MirConnection* ConnectionCache::ConnectLocked() {
+    if (pending_connection_.valid())
+        connection_ = pending_connection_.get();
+
+    if (!connection_)
+        connection_ = mir_connect_sync(kMirSocket, kMirConnectionName);
+
+    if (!mir_connection_is_valid(connection_)) {
+        AC_ERROR("Failed to connect to Mir server: %s",
+                  mir_connection_get_error_message(connection_));
+        if (connection_)
+            mir_connection_release(connection_);
+        connection_ = nullptr;
+        return nullptr;
+    }
+
+    // From here on the server tells us when outputs come and go and
+    // the cached configuration only has to be rebuilt on demand.
+    mir_connection_set_display_config_change_callback(connection_,
+        [](MirConnection*, void *context) {
+            auto thiz = static_cast<ConnectionCache*>(context);
+            AC_DEBUG("Display configuration changed; invalidating cache");
+            thiz->display_config_dirty_ = true;
+            thiz->display_config_generation_++;
+        }, this);
+
+    return connection_;
+}
+
+MirConnection* ConnectionCache::Connection() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (connection_)
+        return connection_;
+
+    return ConnectLocked();
+}
+
+MirDisplayConfiguration* ConnectionCache::DisplayConfiguration() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!connection_ && !ConnectLocked())
+        return nullptr;
+
+    if (display_config_ && !display_config_dirty_)
+        return display_config_;
+
+    if (display_config_)
+        mir_display_config_destroy(display_config_);
+
+    display_config_dirty_ = false;
+    display_config_ = mir_connection_create_display_config(connection_);
+    if (!display_config_)
+        AC_ERROR("Failed to create display configuration: %s",
+                  mir_connection_get_error_message(connection_));
+
+    return display_config_;
+}
+
+} // namespace mir
+} // namespace ac
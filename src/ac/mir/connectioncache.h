@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_MIR_CONNECTIONCACHE_H_
+#define AC_MIR_CONNECTIONCACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <mutex>
+
+#include <mir_toolkit/mir_client_library.h>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace mir {
+
+// Keeps one Mir connection and the current display configuration
+// alive for the whole process so a session setup doesn't have to pay
+// for connecting and enumerating outputs between the WFD negotiation
+// finishing and the first frame going out. The connection is pre-warmed
+// in the background at service start and the cached configuration is
+// invalidated through Mir's display configuration change callback.
+class ConnectionCache : public ac::NonCopyable {
+public:
+    static ConnectionCache& Instance();
+
+    // Starts connecting to the Mir server in the background. Safe to
+    // call multiple times; only the first call does any work.
+    void Prewarm();
+
+    // The process-wide connection, connecting on demand when no
+    // pre-warm happened yet. Returns nullptr when the server is not
+    // reachable; ownership stays with the cache.
+    MirConnection* Connection();
+
+    // The current display configuration, refreshed after the server
+    // signalled a change. Valid until the next call; owned by the
+    // cache.
+    MirDisplayConfiguration* DisplayConfiguration();
+
+    // Bumped on every display configuration change signalled by the
+    // server. Lock-free so per-frame code can poll it cheaply and only
+    // reach for DisplayConfiguration() when the number moved.
+    std::uint64_t DisplayConfigurationGeneration() const { return display_config_generation_; }
+
+    // Drops all cached state so the next use reconnects from scratch.
+    // Lets us recover after the display server went away and gives
+    // tests a clean slate between cases.
+    void Reset();
+
+private:
+    ConnectionCache() = default;
+    ~ConnectionCache();
+
+    MirConnection* ConnectLocked();
+
+    std::mutex mutex_;
+    std::future<MirConnection*> pending_connection_;
+    MirConnection *connection_ = nullptr;
+    MirDisplayConfiguration *display_config_ = nullptr;
+    // Set from the connection's callback thread, consumed under mutex_
+    std::atomic<bool> display_config_dirty_{true};
+    std::atomic<std::uint64_t> display_config_generation_{1};
+};
+
+} // namespace mir
+} // namespace ac
+
+#endif
@@ -17,6 +17,7 @@
 
 #include <boost/concept_check.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <future>
 
@@ -25,11 +26,52 @@
 #include <GLES2/gl2ext.h>
 
 #include "ac/logger.h"
+
+#include "ac/common/clock.h"
+
+#include "ac/mir/connectioncache.h"
 #include "ac/mir/screencast.h"
 
+#include "ac/video/damagetracker.h"
+
 namespace {
-static constexpr const char *kMirSocket{"/run/mir_socket"};
-static constexpr const char *kMirConnectionName{"aethercast screencast client"};
+// GLES2 only exposes buffer readback through extensions; define the
+// tokens locally so we don't depend on a particular gl2ext.h revision.
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+
+typedef void *(GL_APIENTRYP MapBufferRangeProc)(GLenum target, GLintptr offset,
+                                                GLsizeiptr length, GLbitfield access);
+typedef GLboolean (GL_APIENTRYP UnmapBufferProc)(GLenum target);
+
+bool HasGLExtension(const char *extensions, const char *name) {
+    return extensions && std::strstr(extensions, name);
+}
+
+GLuint CompileShader(GLenum type, const char *source) {
+    const auto shader = glCreateShader(type);
+    if (!shader)
+        return 0;
+
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
 }
 
 namespace ac {
@@ -63,6 +105,23 @@ std::string mir_pixel_format_to_string(MirPixelFormat format)
     }
 }
 
+namespace {
+// Inverse of mir_pixel_format_to_string for the formats a fetcher can
+// actually hand out; everything else is not negotiable.
+MirPixelFormat mir_pixel_format_from_string(const std::string &name)
+{
+    if (name == "RGBA")
+        return mir_pixel_format_abgr_8888;
+    if (name == "RGBX")
+        return mir_pixel_format_xbgr_8888;
+    if (name == "BGRA")
+        return mir_pixel_format_argb_8888;
+    if (name == "BGRX")
+        return mir_pixel_format_xrgb_8888;
+    return mir_pixel_format_invalid;
+}
+}
+
 class BufferStreamScreencast : public ScreencastFetcher
 {
 public:
@@ -71,7 +130,9 @@ public:
                            bool readout)
         : ScreencastFetcher(readout),
           buffer_stream{buffer_stream},
-          pixel_format_{mir_pixel_format_to_string(config->pixel_format)}
+          pixel_format_{mir_pixel_format_to_string(config->pixel_format)},
+          frame_height{0},
+          damaged{true}
     {
         // Don't complete construction unless this is going to work later!
         MirGraphicsRegion const region{graphics_region_for(buffer_stream)};
@@ -87,9 +148,20 @@ public:
 
     void Capture() override
     {
+        // The frame we read out now finished compositing when the swap
+        // at the end of the previous call returned
+        last_capture_time_ = pending_capture_time_;
+
+        MirGraphicsRegion const region{graphics_region_for(buffer_stream)};
+        int const line_size{region.width * MIR_BYTES_PER_PIXEL(region.pixel_format)};
+
+        damaged = damage_tracker.Update(
+            reinterpret_cast<const uint8_t*>(region.vaddr),
+            region.width, region.height, region.stride,
+            MIR_BYTES_PER_PIXEL(region.pixel_format));
+        frame_height = region.height;
+
         if (readout_) {
-            MirGraphicsRegion const region{graphics_region_for(buffer_stream)};
-            int const line_size{region.width * MIR_BYTES_PER_PIXEL(region.pixel_format)};
             // Contents are rendered up-side down, read them bottom to top
             auto addr = region.vaddr + (region.height - 1)*region.stride;
             auto write_addr = buffer->Data();
@@ -101,12 +173,26 @@ public:
             }
         }
         mir_buffer_stream_swap_buffers_sync(buffer_stream);
+        pending_capture_time_ = ac::common::Clock::NowUs();
     }
 
     video::Buffer::Ptr CurrentReadout() override {
         return buffer;
     }
 
+    bool LastCaptureDamaged() const override {
+        return damaged;
+    }
+
+    ac::video::Rect LastDamageRegion() const override {
+        // The readout flips the frame upright, so mirror the tracked
+        // row range into the delivered frame's coordinates
+        auto region = damage_tracker.LastDamageRegion();
+        if (!region.Empty())
+            region.y = frame_height - (region.y + region.height);
+        return region;
+    }
+
 private:
     MirGraphicsRegion graphics_region_for(MirBufferStream* buffer_stream)
     {
@@ -122,6 +208,9 @@ private:
     MirBufferStream* const buffer_stream;
     std::string const pixel_format_;
     video::Buffer::Ptr buffer;
+    ac::video::DamageTracker damage_tracker;
+    unsigned int frame_height;
+    bool damaged;
 };
 
 class EGLScreencast : public ScreencastFetcher
@@ -133,7 +222,21 @@ public:
           x{0},
           y{0},
           width{config->width},
-          height{config->height}
+          height{config->height},
+          damaged{true},
+          pbos{0, 0},
+          pbo_filled{false, false},
+          pbo_time{0, 0},
+          pbo_index{0},
+          use_pbo_readback{false},
+          map_buffer_range{nullptr},
+          unmap_buffer{nullptr},
+          rotation_turns{0},
+          rotate_program{0},
+          rotate_texture{0},
+          rotate_position_attrib{-1},
+          rotate_texcoord_attrib{-1},
+          rotate_pass_broken{false}
     {
         static EGLint const attribs[] = {
             EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
@@ -212,10 +315,23 @@ public:
         int const rgba_pixel_size{4};
         auto const frame_size_bytes = rgba_pixel_size * width * height;
         buffer = video::Buffer::Create(frame_size_bytes);
+
+        if (readout_)
+            SetupPixelBuffers(static_cast<GLsizeiptr>(frame_size_bytes));
     }
 
     ~EGLScreencast()
     {
+        if (use_pbo_readback || rotate_program || rotate_texture) {
+            eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context);
+            if (use_pbo_readback)
+                glDeleteBuffers(2, pbos);
+            if (rotate_program)
+                glDeleteProgram(rotate_program);
+            if (rotate_texture)
+                glDeleteTextures(1, &rotate_texture);
+        }
+
         eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         eglDestroySurface(egl_display, egl_surface);
         eglDestroyContext(egl_display, egl_context);
@@ -230,22 +346,21 @@ public:
             AC_WARNING("Failed to make screencast surface current");
         }
 
-        if (readout_) {
-            void* data = buffer->Data();
-            glReadPixels(x, y, width, height, read_pixel_format, GL_UNSIGNED_BYTE, data);
-            /*auto write_out_future = std::async(
-                std::launch::async,
-                [this] {
-                stream.write(buffer.data(), buffer.size());
-                });*/
-        }
+        // The composited frame sits in the window surface now; rotate
+        // it in place before the readout so downstream never notices
+        // the display turned.
+        if (readout_ && rotation_turns != 0)
+            RotateFrameInPlace();
+
+        if (readout_ && use_pbo_readback)
+            CaptureThroughPixelBuffers();
+        else
+            CaptureSynchronously();
 
         if (eglSwapBuffers(egl_display, egl_surface) != EGL_TRUE)
             AC_WARNING("Failed to swap screencast surface buffers");
 
-        /*if (readout_) {
-            write_out_future.wait();
-        }*/
+        pending_capture_time_ = ac::common::Clock::NowUs();
 
         if (eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT) != EGL_TRUE)
         {
@@ -257,12 +372,256 @@ public:
         return buffer;
     }
 
+    bool LastCaptureDamaged() const override {
+        // Without a readout we never see the pixels and have to treat
+        // every frame as changed.
+        return readout_ ? damaged : true;
+    }
+
+    ac::video::Rect LastDamageRegion() const override {
+        // Without a readout the extent of the change is unknown
+        return readout_ ? damage_tracker.LastDamageRegion() : ac::video::Rect{};
+    }
+
     std::string pixel_format() override
     {
         return read_pixel_format == GL_BGRA_EXT ? "BGRA" : "RGBA";
-    }    
+    }
+
+    bool SetDisplayRotation(unsigned int quarter_turns) override
+    {
+        // Without a readout the native buffer goes to the encoder
+        // untouched and there is no stage to blit in.
+        if (!readout_)
+            return quarter_turns == 0;
+
+        rotation_turns = quarter_turns % 4;
+        return true;
+    }
 
 private:
+    void CaptureSynchronously()
+    {
+        // The frame we read out now finished compositing when the swap
+        // at the end of the previous call returned
+        last_capture_time_ = pending_capture_time_;
+
+        if (!readout_)
+            return;
+
+        void* data = buffer->Data();
+        glReadPixels(x, y, width, height, read_pixel_format, GL_UNSIGNED_BYTE, data);
+
+        UpdateDamage();
+    }
+
+    // Packs the frame just composited into one PBO and maps the other
+    // one holding the previous frame, so the copy out of GPU memory
+    // overlaps with compositing the next frame instead of stalling the
+    // pipeline each call. Trades one frame of extra latency for that.
+    void CaptureThroughPixelBuffers()
+    {
+        int const line_size{static_cast<int>(width) * 4};
+        int const frame_size{line_size * static_cast<int>(height)};
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[pbo_index]);
+        glReadPixels(x, y, width, height, read_pixel_format, GL_UNSIGNED_BYTE, nullptr);
+        // The frame going into this PBO finished compositing when the
+        // swap at the end of the previous call returned
+        pbo_time[pbo_index] = pending_capture_time_;
+        pbo_filled[pbo_index] = true;
+
+        auto const previous = 1 - pbo_index;
+        if (pbo_filled[previous]) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[previous]);
+            const auto data = map_buffer_range(GL_PIXEL_PACK_BUFFER, 0,
+                                               frame_size, GL_MAP_READ_BIT);
+            if (data) {
+                std::memcpy(buffer->Data(), data, frame_size);
+                unmap_buffer(GL_PIXEL_PACK_BUFFER);
+                last_capture_time_ = pbo_time[previous];
+            }
+        } else {
+            // The pipeline isn't primed yet; read the first frame
+            // synchronously rather than handing out an empty buffer.
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glReadPixels(x, y, width, height, read_pixel_format,
+                         GL_UNSIGNED_BYTE, buffer->Data());
+            last_capture_time_ = pending_capture_time_;
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        pbo_index = previous;
+
+        UpdateDamage();
+    }
+
+    // Copies the composited frame into a texture and draws it back
+    // into the window surface counter-rotated, scaled to fit and
+    // letterboxed, so the readout keeps producing frames at the
+    // negotiated stream size with upright content. Costs one extra
+    // GPU blit per frame and only while the display is turned.
+    void RotateFrameInPlace()
+    {
+        if (rotate_pass_broken)
+            return;
+
+        if (!rotate_program && !SetupRotatePass()) {
+            rotate_pass_broken = true;
+            AC_WARNING("Failed to set up the rotation blit; handing out frames unrotated");
+            return;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, rotate_texture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, x, y, width, height);
+
+        // A quarter turn swaps the content's sides; fit the rotated
+        // frame into the unchanged stream size so the encoder never
+        // sees a new resolution.
+        auto content_width = width;
+        auto content_height = height;
+        if (rotation_turns % 2)
+            std::swap(content_width, content_height);
+
+        const auto scale = std::min(
+            static_cast<double>(width) / content_width,
+            static_cast<double>(height) / content_height);
+        const auto dst_width = static_cast<GLsizei>(content_width * scale);
+        const auto dst_height = static_cast<GLsizei>(content_height * scale);
+
+        glClearColor(0.f, 0.f, 0.f, 1.f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glViewport((width - dst_width) / 2, (height - dst_height) / 2,
+                   dst_width, dst_height);
+
+        static GLfloat const positions[] = {
+            -1.f, -1.f,  1.f, -1.f,  -1.f, 1.f,  1.f, 1.f,
+        };
+        // Texture coordinates per quad corner for 0/90/180/270 degree
+        // counter-rotations of the sampled frame.
+        static GLfloat const texcoords[4][8] = {
+            {0.f, 0.f,  1.f, 0.f,  0.f, 1.f,  1.f, 1.f},
+            {1.f, 0.f,  1.f, 1.f,  0.f, 0.f,  0.f, 1.f},
+            {1.f, 1.f,  0.f, 1.f,  1.f, 0.f,  0.f, 0.f},
+            {0.f, 1.f,  0.f, 0.f,  1.f, 1.f,  1.f, 0.f},
+        };
+
+        glUseProgram(rotate_program);
+        glVertexAttribPointer(rotate_position_attrib, 2, GL_FLOAT, GL_FALSE, 0, positions);
+        glVertexAttribPointer(rotate_texcoord_attrib, 2, GL_FLOAT, GL_FALSE, 0, texcoords[rotation_turns]);
+        glEnableVertexAttribArray(rotate_position_attrib);
+        glEnableVertexAttribArray(rotate_texcoord_attrib);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glDisableVertexAttribArray(rotate_texcoord_attrib);
+        glDisableVertexAttribArray(rotate_position_attrib);
+        glUseProgram(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glViewport(0, 0, width, height);
+    }
+
+    bool SetupRotatePass()
+    {
+        static char const *const vertex_shader_source =
+            "attribute vec2 position;\n"
+            "attribute vec2 texcoord;\n"
+            "varying vec2 v_texcoord;\n"
+            "void main() {\n"
+            "    gl_Position = vec4(position, 0.0, 1.0);\n"
+            "    v_texcoord = texcoord;\n"
+            "}\n";
+        static char const *const fragment_shader_source =
+            "precision mediump float;\n"
+            "varying vec2 v_texcoord;\n"
+            "uniform sampler2D frame;\n"
+            "void main() {\n"
+            "    gl_FragColor = texture2D(frame, v_texcoord);\n"
+            "}\n";
+
+        const auto vertex_shader = CompileShader(GL_VERTEX_SHADER, vertex_shader_source);
+        const auto fragment_shader = CompileShader(GL_FRAGMENT_SHADER, fragment_shader_source);
+        if (!vertex_shader || !fragment_shader) {
+            glDeleteShader(vertex_shader);
+            glDeleteShader(fragment_shader);
+            return false;
+        }
+
+        rotate_program = glCreateProgram();
+        glAttachShader(rotate_program, vertex_shader);
+        glAttachShader(rotate_program, fragment_shader);
+        glLinkProgram(rotate_program);
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(rotate_program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            glDeleteProgram(rotate_program);
+            rotate_program = 0;
+            return false;
+        }
+
+        rotate_position_attrib = glGetAttribLocation(rotate_program, "position");
+        rotate_texcoord_attrib = glGetAttribLocation(rotate_program, "texcoord");
+        glUseProgram(rotate_program);
+        glUniform1i(glGetUniformLocation(rotate_program, "frame"), 0);
+        glUseProgram(0);
+
+        glGenTextures(1, &rotate_texture);
+        glBindTexture(GL_TEXTURE_2D, rotate_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return glGetError() == GL_NO_ERROR;
+    }
+
+    void UpdateDamage()
+    {
+        damaged = damage_tracker.Update(
+            static_cast<const uint8_t*>(buffer->Data()),
+            width, height, width * 4, 4);
+    }
+
+    // Double-buffered readback needs the pack buffer target plus a way
+    // to map it; all of that lives behind extensions on GLES2. When
+    // anything is missing we keep the synchronous glReadPixels path.
+    void SetupPixelBuffers(GLsizeiptr size)
+    {
+        const auto extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        if (!HasGLExtension(extensions, "GL_NV_pixel_buffer_object") ||
+            !HasGLExtension(extensions, "GL_EXT_map_buffer_range") ||
+            !HasGLExtension(extensions, "GL_OES_mapbuffer")) {
+            AC_DEBUG("PBO readback not available; keeping synchronous readout");
+            return;
+        }
+
+        map_buffer_range = reinterpret_cast<MapBufferRangeProc>(
+            eglGetProcAddress("glMapBufferRangeEXT"));
+        unmap_buffer = reinterpret_cast<UnmapBufferProc>(
+            eglGetProcAddress("glUnmapBufferOES"));
+        if (!map_buffer_range || !unmap_buffer)
+            return;
+
+        glGenBuffers(2, pbos);
+        for (int n = 0; n < 2; n++) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[n]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (glGetError() != GL_NO_ERROR) {
+            glDeleteBuffers(2, pbos);
+            return;
+        }
+
+        use_pbo_readback = true;
+        AC_INFO("Using double-buffered PBO readback for the screencast");
+    }
+
     unsigned int const x;
     unsigned int const y;
     unsigned int const width;
@@ -273,6 +632,21 @@ private:
     EGLSurface egl_surface;
     EGLConfig egl_config;
     GLenum read_pixel_format;
+    ac::video::DamageTracker damage_tracker;
+    bool damaged;
+    GLuint pbos[2];
+    bool pbo_filled[2];
+    ac::TimestampUs pbo_time[2];
+    int pbo_index;
+    bool use_pbo_readback;
+    MapBufferRangeProc map_buffer_range;
+    UnmapBufferProc unmap_buffer;
+    unsigned int rotation_turns;
+    GLuint rotate_program;
+    GLuint rotate_texture;
+    GLint rotate_position_attrib;
+    GLint rotate_texcoord_attrib;
+    bool rotate_pass_broken;
 };
 
 #if 1
@@ -307,45 +681,63 @@ Screencast::Screencast(bool readout) :
     connection_(nullptr),
     screencast_(nullptr),
     buffer_stream_(nullptr),
-    readout_(readout) {
+    readout_(readout),
+    base_orientation_(mir_orientation_normal),
+    active_output_id_(0),
+    config_generation_(0),
+    rotation_unsupported_logged_(false) {
 }
 
 Screencast::~Screencast() {
     AC_DEBUG("");
 
+    // Setup() may have launched a creation we never picked up
+    if (pending_screencast_.valid())
+        screencast_ = pending_screencast_.get();
+
     if (screencast_)
         mir_screencast_release_sync(screencast_);
 
-    if (connection_)
-        mir_connection_release(connection_);
+    // connection_ is owned by the ConnectionCache and stays alive for
+    // the next session
+}
+
+void Screencast::SetPreferredPixelFormats(const std::vector<std::string> &formats) {
+    preferred_formats_ = formats;
 }
 
-#if 1
 bool Screencast::Setup(const video::DisplayOutput &output) {
-    if (screencast_ || connection_ || buffer_stream_)
-        return false;
+    // A second Setup() renegotiates the screencast: the old one is
+    // given back to the server and a fresh one created at the new
+    // size. The cached connection makes this cheap.
+    if (pending_screencast_.valid())
+        screencast_ = pending_screencast_.get();
 
-    if (output.mode != video::DisplayOutput::Mode::kExtend) {
-        AC_ERROR("Unsupported display output mode specified '%s'", output.mode);
-        return false;
+    if (screencast_) {
+        mir_screencast_release_sync(screencast_);
+        screencast_ = nullptr;
     }
 
+    buffer_stream_ = nullptr;
+    fetcher_.reset();
+
     AC_DEBUG("Setting up screencast [%s %dx%d]", output.mode,
               output.width, output.height);
 
-    connection_ = mir_connect_sync(kMirSocket, kMirConnectionName);
-    if (!mir_connection_is_valid(connection_)) {
-        AC_ERROR("Failed to connect to Mir server: %s",
-                  mir_connection_get_error_message(connection_));
+    // Both the connection and the display configuration come out of
+    // the process-wide cache and are typically ready before the sink
+    // even connects.
+    connection_ = ConnectionCache::Instance().Connection();
+    if (!connection_)
         return false;
-    }
 
-    const auto config = mir_connection_create_display_config(connection_);
-    if (!config) {
-        AC_ERROR("Failed to create display configuration: %s",
-                  mir_connection_get_error_message(connection_));
+    // Read the generation before the configuration so a change racing
+    // the setup gets noticed again on the first captured frame.
+    config_generation_ = ConnectionCache::Instance().DisplayConfigurationGeneration();
+
+    const auto config = ConnectionCache::Instance().DisplayConfiguration();
+    if (!config)
         return false;
-    }
 
     MirDisplayOutput *active_output = nullptr;
     unsigned int output_index = 0;
@@ -377,17 +769,31 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
     const MirDisplayMode *display_mode = &active_output->modes[active_output->current_mode];
 
     MirRectangle region;
-    // If we request a screen region outside the available screen area
-    // mir will create a mir output which is then available for everyone
-    // as just another display.
-    //region.left = display_mode->horizontal_resolution / 2;
-    //region.top = display_mode->vertical_resolution / 2;
-    region.width = output.width;
-    region.height = output.height;
-    //region.left = 0;
-    //region.top = 0;
-    region.left = display_mode->horizontal_resolution;
-    region.top = 0;
+    if (output.mode == video::DisplayOutput::Mode::kMirror) {
+        // Capture the panel at its native mode and let the compositor
+        // downscale into the screencast buffers on the GPU. The spec
+        // below still requests buffers at the negotiated stream size,
+        // so the sink gets its resolution without the panel ever
+        // switching modes.
+        region.left = 0;
+        region.top = 0;
+        region.width = display_mode->horizontal_resolution;
+        region.height = display_mode->vertical_resolution;
+    } else {
+        // If we request a screen region outside the available screen
+        // area mir will create a mir output which is then available
+        // for everyone as just another display.
+        // A stream larger than the panel (the 2160p override) still
+        // renders at the panel's mode; the compositor scales the
+        // region up into the full-size screencast buffers exactly as
+        // it scales down for mirroring.
+        region.width = std::min(output.width,
+            static_cast<unsigned int>(display_mode->horizontal_resolution));
+        region.height = std::min(output.height,
+            static_cast<unsigned int>(display_mode->vertical_resolution));
+        region.left = display_mode->horizontal_resolution;
+        region.top = 0;
+    }
 
     AC_INFO("Selected output ID %i [(%ix%i)+(%ix%i)] orientation %d",
              output_index,
@@ -396,16 +802,42 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
              region.left, region.top,
              active_output->orientation);
 
+    // Later orientation changes are handled relative to this baseline
+    // as a live transform on the fetcher instead of tearing down the
+    // session; see RefreshOrientation().
+    base_orientation_ = active_output->orientation;
+    active_output_id_ = active_output->output_id;
+    rotation_unsupported_logged_ = false;
+
+    MirPixelFormat available_formats[mir_pixel_formats];
     unsigned int num_pixel_formats = 0;
-    MirPixelFormat pixel_format;
-    mir_connection_get_available_surface_formats(connection_, &pixel_format,
-                                                 1, &num_pixel_formats);
+    mir_connection_get_available_surface_formats(connection_, available_formats,
+                                                 mir_pixel_formats, &num_pixel_formats);
     if (num_pixel_formats == 0) {
         AC_ERROR("Failed to find suitable pixel format: %s",
                   mir_connection_get_error_message(connection_));
         return false;
     }
-    pixel_format = mir_pixel_format_xbgr_8888;
+
+    // The first format the encoder prefers which the compositor can
+    // render to wins; without an agreement we keep the historic
+    // xbgr_8888 and leave the conversion to the downstream stages.
+    MirPixelFormat pixel_format = mir_pixel_format_xbgr_8888;
+    for (const auto &name : preferred_formats_) {
+        const auto candidate = mir_pixel_format_from_string(name);
+        if (candidate == mir_pixel_format_invalid)
+            continue;
+
+        bool found = false;
+        for (unsigned int i = 0; i < num_pixel_formats && !found; ++i)
+            found = available_formats[i] == candidate;
+
+        if (found) {
+            AC_DEBUG("Negotiated screencast pixel format %s", name.c_str());
+            pixel_format = candidate;
+            break;
+        }
+    }
 
     auto spec = mir_create_screencast_spec(connection_);
     if (!spec) {
@@ -421,19 +853,15 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
     mir_screencast_spec_set_mirror_mode(spec, mir_mirror_mode_none);
     mir_screencast_spec_set_number_of_buffers(spec, 2);
 
-    screencast_ = mir_screencast_create_sync(spec);
-    mir_screencast_spec_release(spec);
-    if (!mir_screencast_is_valid(screencast_)) {
-        AC_ERROR("Failed to create Mir screencast: %s",
-              mir_screencast_get_error_message(screencast_));
-        return false;
-    }
-
-    buffer_stream_ = mir_screencast_get_buffer_stream(screencast_);
-    if (!buffer_stream_) {
-        AC_ERROR("Failed to setup Mir buffer stream");
-        return false;
-    }
+    // Creating the screencast makes the server allocate buffers and
+    // redo its compositing setup which takes a while. Running it in
+    // the background lets the remaining session negotiation continue
+    // in parallel; the first SwapBuffers() joins the result.
+    pending_screencast_ = std::async(std::launch::async, [spec]() {
+        const auto screencast = mir_screencast_create_sync(spec);
+        mir_screencast_spec_release(spec);
+        return screencast;
+    });
 
     output_ = output;
     output_.refresh_rate = display_mode->refresh_rate;
@@ -444,133 +872,112 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
 
     return true;
 }
-#else
-bool Screencast::Setup(const video::DisplayOutput &output) {
-    if (screencast_ || connection_ || buffer_stream_)
-        return false;
 
-    if (output.mode != video::DisplayOutput::Mode::kExtend) {
-        AC_ERROR("Unsupported display output mode specified '%s'", output.mode);
+bool Screencast::FinishSetup() {
+    if (!pending_screencast_.valid())
         return false;
-    }
 
-    AC_DEBUG("Setting up screencast [%s %dx%d]", output.mode,
-              output.width, output.height);
-
-    connection_ = mir_connect_sync(kMirSocket, kMirConnectionName);
-    if (!mir_connection_is_valid(connection_)) {
-        AC_ERROR("Failed to connect to Mir server: %s",
-                  mir_connection_get_error_message(connection_));
+    screencast_ = pending_screencast_.get();
+    if (!mir_screencast_is_valid(screencast_)) {
+        AC_ERROR("Failed to create Mir screencast: %s",
+              mir_screencast_get_error_message(screencast_));
+        if (screencast_)
+            mir_screencast_release_sync(screencast_);
+        screencast_ = nullptr;
         return false;
     }
 
-    const auto config = mir_connection_create_display_config(connection_);
-    if (!config) {
-        AC_ERROR("Failed to create display configuration: %s",
-                  mir_connection_get_error_message(connection_));
+    buffer_stream_ = mir_screencast_get_buffer_stream(screencast_);
+    if (!buffer_stream_) {
+        AC_ERROR("Failed to setup Mir buffer stream");
         return false;
     }
 
-    MirDisplayOutput *active_output = nullptr;
-    unsigned int output_index = 0;
-
-    for (unsigned int i = 0; i < config->num_outputs; ++i) {
-        if (config->outputs[i].connected &&
-            config->outputs[i].used &&
-            config->outputs[i].current_mode < config->outputs[i].num_modes) {
-            // Found an active connection we can just use for our purpose
-            active_output = &config->outputs[i];
-            output_index = i;
-            break;
-        }
-    }
+    return true;
+}
 
-    if (!active_output) {
-        AC_ERROR("Failed to find a suitable display output");
-        return false;
-    }
+void Screencast::SwapBuffers() {
+    if (!buffer_stream_ && !FinishSetup())
+        return;
 
-    const MirDisplayMode *display_mode = &active_output->modes[active_output->current_mode];
+    if (!fetcher_)
+        fetcher_ = CreateFetcher(connection_, &fetcher_config_, buffer_stream_, readout_);
 
-    auto spec = mir_create_screencast_spec(connection_);
-    if (!spec) {
-        AC_ERROR("Failed to create Mir screencast specification: %s",
-              mir_screencast_get_error_message(screencast_));
-        return false;
+    // Rotating the device mid-cast must not cost a renegotiation; the
+    // generation counter is a lock-free poll and only a real change
+    // pays for digging into the configuration.
+    const auto generation = ConnectionCache::Instance().DisplayConfigurationGeneration();
+    if (generation != config_generation_) {
+        config_generation_ = generation;
+        RefreshOrientation();
     }
 
-    mir_screencast_spec_set_width(spec, output.width);
-    mir_screencast_spec_set_height(spec, output.height);
+    fetcher_->Capture();
+}
 
-    MirRectangle region;
-    // If we request a screen region outside the available screen area
-    // mir will create a mir output which is then available for everyone
-    // as just another display.
-    region.left = display_mode->horizontal_resolution;
-    region.top = 0;
-    region.width = display_mode->vertical_resolution;
-    region.height = display_mode->horizontal_resolution;
+void Screencast::RefreshOrientation() {
+    const auto config = ConnectionCache::Instance().DisplayConfiguration();
+    if (!config)
+        return;
 
-    mir_screencast_spec_set_capture_region(spec, &region);
+    const MirDisplayOutput *output = nullptr;
+    for (unsigned int i = 0; i < config->num_outputs; ++i) {
+        if (config->outputs[i].output_id == active_output_id_) {
+            output = &config->outputs[i];
+            break;
+        }
+    }
 
-    output_.refresh_rate = display_mode->refresh_rate;
+    // The captured output going away entirely is a job for the full
+    // renegotiation path, not for a transform.
+    if (!output || !output->connected || !output->used)
+        return;
 
-    AC_INFO("Selected output ID %i [(%ix%i)+(%ix%i)] orientation %d",
-             output_index,
-             display_mode->vertical_resolution,
-             display_mode->horizontal_resolution,
-             region.left, region.top,
-             active_output->orientation);
+    // MirOrientation counts degrees, so the difference to the baseline
+    // directly gives the turns the fetcher has to counter-rotate by
+    // for the sink to keep seeing upright content.
+    const int relative = (output->orientation - base_orientation_ + 360) % 360;
+    const auto quarter_turns = static_cast<unsigned int>(relative / 90);
 
-    unsigned int num_pixel_formats = 0;
-    MirPixelFormat pixel_format;
-    mir_connection_get_available_surface_formats(connection_, &pixel_format,
-                                                 1, &num_pixel_formats);
-    if (num_pixel_formats == 0) {
-        AC_ERROR("Failed to find suitable pixel format: %s",
-                  mir_connection_get_error_message(connection_));
-        return false;
+    if (fetcher_->SetDisplayRotation(quarter_turns)) {
+        AC_INFO("Display orientation changed; counter-rotating captures by %d degrees in place",
+                relative);
+        return;
     }
 
-    mir_screencast_spec_set_pixel_format(spec, pixel_format);
-    mir_screencast_spec_set_mirror_mode(spec, mir_mirror_mode_vertical);
-    mir_screencast_spec_set_number_of_buffers(spec, 2);
-
-    screencast_ = mir_screencast_create_sync(spec);
-    mir_screencast_spec_release(spec);
-    if (!mir_screencast_is_valid(screencast_)) {
-        AC_ERROR("Failed to create Mir screencast: %s",
-              mir_screencast_get_error_message(screencast_));
-        return false;
+    if (!rotation_unsupported_logged_) {
+        rotation_unsupported_logged_ = true;
+        AC_WARNING("Capture path cannot transform frames; casting continues with the display's orientation");
     }
+}
 
-    buffer_stream_ = mir_screencast_get_buffer_stream(screencast_);
-    if (!buffer_stream_) {
-        AC_ERROR("Failed to setup Mir buffer stream");
-        return false;
-    }
+bool Screencast::LastFrameDamaged() const {
+    // Before the first capture there is nothing to compare against
+    if (!fetcher_)
+        return true;
 
-    output_ = output;
-    fetcher_config_.width = region.width;
-    fetcher_config_.height = region.height;
-    fetcher_config_.region.width = region.width;
-    fetcher_config_.region.height = region.height;
-    fetcher_config_.region.top = 0;
-    fetcher_config_.region.left = 0;
-    fetcher_config_.pixel_format = pixel_format;
+    return fetcher_->LastCaptureDamaged();
+}
 
-    return true;
+video::Rect Screencast::LastFrameDamageRegion() const {
+    if (!fetcher_)
+        return video::Rect{};
+
+    return fetcher_->LastDamageRegion();
 }
-#endif
 
-void Screencast::SwapBuffers() {
-    if (!buffer_stream_)
-        return;
+ac::TimestampUs Screencast::LastFrameTimestamp() const {
+    if (!fetcher_)
+        return 0ll;
+
+    return fetcher_->LastCaptureTimestamp();
+}
 
+std::string Screencast::PixelFormat() const {
     if (!fetcher_)
-        fetcher_ = CreateFetcher(connection_, &fetcher_config_, buffer_stream_, readout_);
+        return "RGBA";
 
-    fetcher_->Capture();
+    return fetcher_->pixel_format();
 }
 
 video::DisplayOutput Screencast::OutputMode() const {
@@ -18,6 +18,7 @@
 #ifndef AC_MIR_CONNECTOR_H_
 #define AC_MIR_CONNECTOR_H_
 
+#include <future>
 #include <memory>
 
 #include <mir_toolkit/mir_client_library.h>
@@ -47,6 +48,26 @@ public:
     virtual void Capture() = 0;
     virtual ac::video::Buffer::Ptr CurrentReadout() = 0;
 
+    // Fetchers without access to the pixel data keep the conservative
+    // default and mark every capture as damaged.
+    virtual bool LastCaptureDamaged() const { return true; }
+
+    // Coarse bounding box of what the last capture changed; empty when
+    // the fetcher cannot tell where the change happened.
+    virtual ac::video::Rect LastDamageRegion() const { return ac::video::Rect{}; }
+
+    // Counter-rotate every following capture by the given number of
+    // quarter turns so the sink keeps seeing upright content after the
+    // display orientation changed. Returns false when the fetcher
+    // cannot transform the frames it hands out.
+    virtual bool SetDisplayRotation(unsigned int quarter_turns) {
+        return quarter_turns == 0;
+    }
+
+    // Time the compositor finished the frame delivered by the last
+    // Capture() call; 0 before the first full swap cycle.
+    ac::TimestampUs LastCaptureTimestamp() const { return last_capture_time_; }
+
 protected:
     ScreencastFetcher(bool readout) :
         readout_(readout)
@@ -54,6 +75,11 @@ protected:
     }
 
     bool readout_;
+    // The frame read out by a Capture() call finished compositing when
+    // the swap of the previous call returned; fetchers record that
+    // instant in pending_capture_time_ and promote it on delivery.
+    ac::TimestampUs last_capture_time_ = 0ll;
+    ac::TimestampUs pending_capture_time_ = 0ll;
 
 private:
     ScreencastFetcher(ScreencastFetcher const&) = delete;
@@ -68,18 +94,46 @@ public:
     bool Setup(const video::DisplayOutput &output) override;
 
     // From ac::video::BufferProducer
+    void SetPreferredPixelFormats(const std::vector<std::string> &formats) override;
     void SwapBuffers() override;
+    bool LastFrameDamaged() const override;
+    video::Rect LastFrameDamageRegion() const override;
+    ac::TimestampUs LastFrameTimestamp() const override;
     video::Buffer::Ptr CurrentBuffer() const override;
+    std::string PixelFormat() const override;
     video::DisplayOutput OutputMode() const override;
 
 private:
+    // Joins an in-flight screencast creation started by Setup() and
+    // takes over its buffer stream; false when creation failed.
+    bool FinishSetup();
+
+    // Re-reads the display configuration after the server signalled a
+    // change and turns an orientation difference into a live transform
+    // on the fetcher instead of a session renegotiation.
+    void RefreshOrientation();
+
+    // Borrowed from the process-wide ConnectionCache; never released
+    // here.
     MirConnection *connection_;
     MirScreencast *screencast_;
+    std::future<MirScreencast*> pending_screencast_;
     ScreencastConfiguration fetcher_config_;
     std::unique_ptr<ScreencastFetcher> fetcher_;
     MirBufferStream *buffer_stream_;
     video::DisplayOutput output_;
     bool readout_;
+    // What the encoder ingests best; empty means no negotiation and
+    // the historic default format.
+    std::vector<std::string> preferred_formats_;
+    // Orientation of the captured output when Setup() ran; later
+    // changes are handled relative to this as a live transform.
+    MirOrientation base_orientation_;
+    uint32_t active_output_id_;
+    // Display configuration generation the orientation was last
+    // derived from; polled once per frame.
+    uint64_t config_generation_;
+    bool rotation_unsupported_logged_;
 };
 
 } // namespace mir
@@ -15,8 +15,14 @@
  *
  */
 
+#include <time.h>
+
+#include <algorithm>
+#include <thread>
+
 #include "ac/logger.h"
 #include "ac/keep_alive.h"
+#include "ac/utils.h"
 
 #include "ac/common/threadedexecutor.h"
 #include "ac/common/threadedexecutorfactory.h"
@@ -24,10 +30,13 @@
 #include "ac/network/udpstream.h"
 
 #include "ac/report/reportfactory.h"
+#include "ac/report/metrics/metricsregistry.h"
 
 #include "ac/video/videoformat.h"
 #include "ac/video/displayoutput.h"
 
+#include "ac/streaming/bandwidthprober.h"
+#include "ac/streaming/fecsender.h"
 #include "ac/streaming/mpegtspacketizer.h"
 #include "ac/streaming/rtpsender.h"
 
@@ -36,6 +45,53 @@
 namespace {
 // Number of milliseconds was choosen by measurement
 static constexpr std::chrono::milliseconds kStreamDelayOnPlay{300};
+static constexpr const char *kSessionProfileEnvName{"AETHERCAST_SESSION_PROFILE"};
+static constexpr const char *kIntraRefreshFramesEnvName{"AETHERCAST_INTRA_REFRESH_FRAMES"};
+static constexpr const char *kEncoderSlicesEnvName{"AETHERCAST_ENCODER_SLICES"};
+// More slices than this buys no further decode parallelism on the
+// sinks we see but keeps adding slice header overhead.
+static constexpr unsigned int kMaxEncoderSlices{4};
+static constexpr const char *kDisplayModeEnvName{"AETHERCAST_DISPLAY_MODE"};
+static constexpr const char *kFECEnvName{"AETHERCAST_FEC"};
+static constexpr const char *kTightPackingEnvName{"AETHERCAST_TIGHT_PACKING"};
+// Opt-in while the fleet's sinks are verified to accept a second
+// elementary stream in the program.
+static constexpr const char *kEnableAudioEnvName{"AETHERCAST_ENABLE_AUDIO"};
+// Opt-in as not every sink sends receiver reports on padding-only
+// traffic before PLAY; without the report the probe only delays
+// pipeline construction by its timeout.
+static constexpr const char *kBandwidthProbeEnvName{"AETHERCAST_BANDWIDTH_PROBE"};
+// Forces the fused packetize-and-send stage regardless of profile and
+// core count, mainly for measuring the two layouts against each other.
+static constexpr const char *kFusedSenderEnvName{"AETHERCAST_FUSED_SENDER"};
+// RTSP gives us no way to discover whether the sink understands RTP
+// header extensions, so abs-send-time stays an explicit opt-in.
+static constexpr const char *kAbsSendTimeEnvName{"AETHERCAST_ABS_SEND_TIME"};
+// The nl80211 link monitor only reads station statistics, so it is
+// on by default; "off" is for debugging the bitrate controller
+// without its proactive caps.
+static constexpr const char *kLinkMonitorEnvName{"AETHERCAST_LINK_MONITOR"};
+// Compliance deployments point this at a directory and every session
+// leaves its transport stream behind as a file there.
+static constexpr const char *kRecordDirEnvName{"AETHERCAST_RECORD_DIR"};
+
+ac::video::DisplayOutput::Mode DisplayModeFromString(const std::string &name) {
+    if (name == "mirror")
+        return ac::video::DisplayOutput::Mode::kMirror;
+    if (name.length() > 0 && name != "extend")
+        AC_WARNING("Unknown display mode '%s'; falling back to extend", name);
+    return ac::video::DisplayOutput::Mode::kExtend;
+}
+
+ac::mir::SessionProfile SessionProfileFromString(const std::string &name) {
+    if (name == "balanced")
+        return ac::mir::SessionProfile::kBalanced;
+    if (name == "throughput")
+        return ac::mir::SessionProfile::kThroughput;
+    if (name.length() > 0 && name != "low-latency")
+        AC_WARNING("Unknown session profile '%s'; falling back to low-latency", name);
+    return ac::mir::SessionProfile::kLowLatency;
+}
 }
 
 namespace ac {
@@ -53,8 +109,16 @@ SourceMediaManager::SourceMediaManager(const std::string &remote_address,
     encoder_(encoder),
     output_stream_(output_stream),
     report_factory_(report_factory),
-    pipeline_(executor_factory, 4),
+    pipeline_(executor_factory, 6),
     delay_timeout_(0) {
+
+    // A deadlocked stage looks exactly like a dead network to the
+    // sink, so recover it the same way; the watchdog fires well before
+    // the sink's own 10s timeout would.
+    pipeline_.SetStallHandler([this]() {
+        AC_ERROR("Pipeline stalled; triggering session recovery");
+        OnTransportNetworkError();
+    });
 }
 
 SourceMediaManager::~SourceMediaManager() {
@@ -62,58 +126,382 @@ SourceMediaManager::~SourceMediaManager() {
         pipeline_.Stop();
 }
 
+video::BaseEncoder::Config SourceMediaManager::BuildEncoderConfig(
+        const ac::video::RateAndResolution &rr) {
+    int profile = 0, level = 0, constraint = 0;
+    ac::video::ExtractProfileLevel(format_, &profile, &level, &constraint);
+
+    auto config = encoder_->DefaultConfiguration();
+    config.width = rr.width;
+    config.height = rr.height;
+    config.framerate = rr.framerate;
+    config.profile_idc = profile;
+    config.level_idc = level;
+    config.constraint_set = constraint;
+
+    // A 2160p override exceeds every level the WFD exchange can
+    // negotiate; announce the one the actual dimensions require so the
+    // sink's decoder does not reject the stream over it.
+    if (rr.width * rr.height > 1920 * 1080)
+        config.level_idc = rr.framerate > 30 ? 52 : 51;
+
+    config.codec = SelectedVideoCodec();
+    if (config.codec != video::CodecType::kH264
+            && !encoder_->SupportsCodec(config.codec)) {
+        AC_WARNING("%s requested but the encoder backend does not support it; staying on H.264",
+                   video::CodecTypeToString(config.codec));
+        config.codec = video::CodecType::kH264;
+    }
+
+    // Gradual decoder refresh flattens the frame size distribution and
+    // with it the latency spikes from IDR bursts, but costs slower
+    // stream entry; opt-in until all sinks are known to cope.
+    const auto intra_refresh = Utils::GetEnvValue(kIntraRefreshFramesEnvName);
+    if (!intra_refresh.empty())
+        config.intra_refresh_frames = std::atoi(intra_refresh.c_str());
+
+    // One slice per core (capped) so encode and sink-side decode can
+    // work a frame in parallel instead of serializing per frame.
+    config.slices = std::min(kMaxEncoderSlices,
+                             std::max(1u, std::thread::hardware_concurrency()));
+    const auto slices = Utils::GetEnvValue(kEncoderSlicesEnvName);
+    if (!slices.empty() && std::atoi(slices.c_str()) > 0)
+        config.slices = std::atoi(slices.c_str());
+
+    return config;
+}
+
 bool SourceMediaManager::Configure() {
-    auto rr = ac::video::ExtractRateAndResolution(format_);
+    // A renegotiation reuses the existing stages instead of stacking a
+    // second set of executables into the pipeline; a speculative build
+    // still in flight has to settle before it gets rewired.
+    if (renderer_ || configure_future_.valid()) {
+        if (!EnsureConfigured())
+            return false;
+        return Reconfigure();
+    }
 
-    if (!output_stream_->Connect(remote_address_, sink_port1_))
+    // Codec and capture init are the longest parts of session setup
+    // and none of it needs the not-yet-exchanged RTSP messages, so it
+    // runs concurrently with them; whoever first needs the pipeline
+    // joins through EnsureConfigured(). The port is snapshotted as the
+    // sink may still move it along with a later message.
+    const auto rtp_port = sink_port1_;
+    auto sp = shared_from_this();
+    configure_future_ = std::async(std::launch::async, [sp, rtp_port]() {
+        return sp->ConfigurePipeline(rtp_port);
+    });
+
+    return true;
+}
+
+bool SourceMediaManager::EnsureConfigured() {
+    if (!configure_future_.valid())
+        return renderer_ != nullptr;
+
+    const auto configured = configure_future_.get();
+    if (!configured)
+        AC_ERROR("Speculative pipeline construction failed");
+
+    return configured;
+}
+
+bool SourceMediaManager::ConfigurePipeline(int rtp_port) {
+    auto rr = SelectedRateAndResolution();
+
+    if (!output_stream_->Connect(remote_address_, rtp_port))
         return false;
 
     AC_DEBUG("dimensions: %dx%d@%d", rr.width, rr.height, rr.framerate);
 
-    video::DisplayOutput output{video::DisplayOutput::Mode::kExtend, rr.width, rr.height, rr.framerate};
+    // Mirroring captures the panel at its native mode and has the
+    // producer downscale to the negotiated stream size, so the display
+    // never has to switch modes for a session.
+    video::DisplayOutput output{
+        DisplayModeFromString(Utils::GetEnvValue(kDisplayModeEnvName)),
+        rr.width, rr.height, rr.framerate};
+
+    // When producer and encoder agree on a capture format the
+    // conversion pass between them disappears entirely.
+    producer_->SetPreferredPixelFormats(encoder_->SupportedInputFormats());
 
     if (!producer_->Setup(output)) {
         AC_ERROR("Failed to setup buffer producer");
         return false;
     }
 
-    int profile = 0, level = 0, constraint = 0;
-    ac::video::ExtractProfileLevel(format_, &profile, &level, &constraint);
-
-    auto config = encoder_->DefaultConfiguration();
-    config.width = rr.width;
-    config.height = rr.height;
-    config.framerate = rr.framerate;
-    config.profile_idc = profile;
-    config.level_idc = level;
-    config.constraint_set = constraint;
+    auto config = BuildEncoderConfig(rr);
+    const auto max_bitrate = config.bitrate;
+
+    // A short padding burst at the rate we are about to use tells us
+    // up front whether the link can carry it; on a weak link the
+    // session then starts at the measured rate instead of spending
+    // its first minute ramping down from the default through visible
+    // artifacts. Runs inside the speculative pipeline construction so
+    // the burst and its feedback overlap the RTSP exchange.
+    unsigned int probed_bitrate = 0;
+    if (Utils::IsEnvSet(kBandwidthProbeEnvName)) {
+        ac::streaming::BandwidthProber prober(output_stream_);
+        const auto probe = prober.Probe(config.bitrate);
+        if (probe.valid && probe.bitrate < config.bitrate) {
+            AC_INFO("Link probe saw %d of %d bit/s delivered; starting there",
+                    probe.bitrate, config.bitrate);
+            config.bitrate = probe.bitrate;
+            probed_bitrate = probe.bitrate;
+        }
+    }
 
     if (!encoder_->Configure(config)) {
         AC_ERROR("Failed to configure encoder");
         return false;
     }
 
+    // The connect-time send buffer suits the default rate only; with
+    // the bitrate settled (probe included) the kernel-side queueing
+    // gets bounded to match.
+    output_stream_->AdjustSendBufferForBitrate(config.bitrate);
+
+    // The session profile decides how deep the pipeline queues are;
+    // game streaming wants them shallow, movie playback can spend
+    // buffering on smoothness.
+    const auto session_profile = SessionProfileFromString(
+                Utils::GetEnvValue(kSessionProfileEnvName));
+
     renderer_ = std::make_shared<ac::mir::StreamRenderer>(
-                producer_, encoder_, report_factory_->CreateRendererReport());
+                producer_, encoder_, report_factory_->CreateRendererReport(),
+                session_profile);
 
     auto rtp_sender = std::make_shared<ac::streaming::RTPSender>(
                 output_stream_, report_factory_->CreateSenderReport());
     rtp_sender->SetDelegate(shared_from_this());
+    rtp_sender->SetPacingRate(config.send_pacing_rate);
+    if (Utils::IsEnvSet(kAbsSendTimeEnvName)) {
+        rtp_sender->EnableSendTimeExtension();
+        AC_INFO("Stamping outgoing RTP packets with an abs-send-time extension");
+    }
+    rtp_sender_ = rtp_sender;
+
+    // On a single core the sender's own thread buys no overlap - the
+    // packetize and send stages time-slice against each other anyway
+    // and the queue between them only adds a traversal and a handoff
+    // to every frame's latency. Fuse them there for the low-latency
+    // profile: packets leave the socket on the media sender thread.
+    const bool fused_sender = Utils::IsEnvSet(kFusedSenderEnvName)
+            || (session_profile == ac::mir::SessionProfile::kLowLatency
+                && std::thread::hardware_concurrency() == 1);
+    if (fused_sender) {
+        rtp_sender->EnableSynchronousSend();
+        AC_INFO("Fused the packetize and send stages into one thread");
+    }
+
+    // Sinks send their feedback to the port right above our RTP port;
+    // NACKed packets get answered from the retransmission cache.
+    rtcp_receiver_ = std::make_shared<ac::streaming::RTCPReceiver>(rtp_sender->LocalPort() + 1);
+    rtcp_receiver_->SetDelegate(shared_from_this());
+    // Sender reports from the RTP stream's live counters give the sink
+    // the NTP/RTP clock mapping it needs to size its jitter buffer
+    // tightly; until its feedback reveals the real RTCP address they
+    // go to the port right above the sink's RTP port by convention.
+    rtcp_receiver_->SetSenderStatsSource(rtp_sender);
+    rtcp_receiver_->SetSenderReportDestination(remote_address_, rtp_port + 1);
+
+    // The negotiated rate stays the ceiling; a probe estimate only
+    // moves the point the AIMD loop continues from, so clean reports
+    // can still ramp the session past it.
+    bitrate_controller_ = std::make_shared<ac::streaming::BitrateController>(
+                encoder_, max_bitrate);
+    if (probed_bitrate > 0)
+        bitrate_controller_->SetStartingBitrate(probed_bitrate);
+
+    // The local radio sees a degrading link seconds before the sink's
+    // receiver reports reflect it; the monitor's capacity estimates
+    // cap the controller proactively. Simply absent on wired links.
+    if (Utils::GetEnvValue(kLinkMonitorEnvName) != "off")
+        link_monitor_ = ac::network::LinkMonitor::Create(
+                    remote_address_, shared_from_this());
 
     const auto mpegts_packetizer = ac::streaming::MPEGTSPacketizer::Create(
                 report_factory_->CreatePacketizerReport());
+    packetizer_ = mpegts_packetizer;
+
+    // At low negotiated bitrates the per-PES stuffing bytes eat a
+    // measurable share of the budget; tight packing coalesces audio
+    // PES boundaries and lets the bitrate controller deduct the
+    // remaining overhead. Opt-in as it may hold audio units back for
+    // a few milliseconds.
+    if (Utils::IsEnvSet(kTightPackingEnvName))
+        mpegts_packetizer->SetTightPacking(true);
+
+    // On lossy 2.4GHz links an XOR parity flow recovers what the
+    // retransmission path cannot answer in time; opt-in as it trades
+    // bitrate and needs a sink which understands the second flow.
+    ac::streaming::TransportSender::Ptr transport = rtp_sender;
+    if (Utils::IsEnvSet(kFECEnvName)) {
+        const auto parity_stream = std::make_shared<ac::network::UdpStream>();
+        if (parity_stream->Connect(remote_address_, rtp_port + 2)) {
+            transport = ac::streaming::FECSender::Create(rtp_sender, parity_stream);
+            AC_INFO("FEC parity flow enabled towards %s:%d",
+                    remote_address_.c_str(), rtp_port + 2);
+        } else {
+            AC_WARNING("Failed to connect FEC parity stream; continuing without");
+        }
+    }
 
     sender_ = std::make_shared<ac::streaming::MediaSender>(
                 mpegts_packetizer,
-                rtp_sender,
+                transport,
                 config);
 
     encoder_->SetDelegate(sender_);
 
+    // The recorder tees the finished transport stream off the media
+    // sender, so the recording costs no second encode and at most one
+    // queue push on the hot path.
+    const auto record_dir = Utils::GetEnvValue(kRecordDirEnvName);
+    if (record_dir.length() > 0) {
+        char timestamp[32];
+        const auto now = ::time(nullptr);
+        struct tm tm;
+        ::localtime_r(&now, &tm);
+        ::strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &tm);
+
+        const auto path = Utils::Sprintf("%s/cast-%s.ts", record_dir, timestamp);
+        recorder_ = ac::streaming::StreamRecorder::Create(path);
+        if (recorder_) {
+            sender_->SetRecorder(recorder_);
+            AC_INFO("Recording session to %s", path);
+        } else {
+            AC_WARNING("Failed to set up session recording in %s; continuing without",
+                       record_dir);
+        }
+    }
+
+    // The capture stage pushes LPCM periods straight into the sender's
+    // audio queue, so enabling audio never touches the video path or
+    // its frame pacing.
+    if (Utils::IsEnvSet(kEnableAudioEnvName)) {
+        if (sender_->EnableAudioTrack(ac::streaming::Packetizer::TrackFormat{"audio/lpcm"})) {
+            audio_capture_ = ac::audio::PulseAudioCapture::Create();
+            audio_capture_->SetDelegate(sender_);
+        } else {
+            AC_WARNING("Failed to enable audio track; continuing with video only");
+        }
+    }
+
+    // All pipeline queues share one report instance; events carry the
+    // owning queue's name so the backends can tell them apart.
+    const auto queue_report = report_factory_->CreateBufferQueueReport();
+    renderer_->SetQueueReport(queue_report);
+    rtp_sender->SetQueueReport(queue_report);
+    sender_->SetQueueReport(queue_report);
+
     pipeline_.Add(encoder_);
     pipeline_.Add(renderer_);
-    pipeline_.Add(rtp_sender);
+    // A fused sender has no work loop of its own; everything happens
+    // inside the media sender's Queue() calls.
+    if (!fused_sender)
+        pipeline_.Add(rtp_sender);
     pipeline_.Add(sender_);
+    pipeline_.Add(rtcp_receiver_);
+
+    if (recorder_)
+        pipeline_.Add(recorder_);
+
+    if (link_monitor_)
+        pipeline_.Add(link_monitor_);
+
+    if (audio_capture_)
+        pipeline_.Add(audio_capture_);
+
+    return true;
+}
+
+bool SourceMediaManager::Reconfigure() {
+    const auto rr = SelectedRateAndResolution();
+
+    AC_INFO("Renegotiating running session to %dx%d@%d in place",
+            rr.width, rr.height, rr.framerate);
+
+    const bool was_playing = state_ == State::Playing;
+
+    CancelDelayTimeout();
+
+    // Drain the pipeline; every stage keeps its wiring and just gets a
+    // fresh format below.
+    pipeline_.Stop();
+
+    // The sink may move its RTP port along with the new format
+    if (!output_stream_->Connect(remote_address_, sink_port1_))
+        return false;
+
+    video::DisplayOutput output{
+        DisplayModeFromString(Utils::GetEnvValue(kDisplayModeEnvName)),
+        rr.width, rr.height, rr.framerate};
+
+    if (!producer_->Setup(output)) {
+        AC_ERROR("Failed to reconfigure buffer producer");
+        return false;
+    }
+
+    const auto config = BuildEncoderConfig(rr);
+
+    if (!encoder_->Reconfigure(config)) {
+        AC_ERROR("Failed to reconfigure encoder");
+        return false;
+    }
+
+    // A fresh packetizer starts the new format with clean continuity
+    // counters and stream state; the RTP sender and RTCP receiver stay
+    // untouched so the transport never drops.
+    const auto mpegts_packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                report_factory_->CreatePacketizerReport());
+    packetizer_ = mpegts_packetizer;
+
+    if (Utils::IsEnvSet(kTightPackingEnvName))
+        mpegts_packetizer->SetTightPacking(true);
+
+    if (!sender_->Reconfigure(mpegts_packetizer, config)) {
+        AC_ERROR("Failed to reconfigure media sender");
+        return false;
+    }
+
+    renderer_->Reconfigure();
+
+    // Not an executable, so simply recreated around the new base bitrate
+    bitrate_controller_ = std::make_shared<ac::streaming::BitrateController>(
+                encoder_, config.bitrate);
+
+    output_stream_->AdjustSendBufferForBitrate(config.bitrate);
+
+    rtp_sender_->SetPacingRate(config.send_pacing_rate);
+
+    if (was_playing)
+        pipeline_.Start();
+
+    return true;
+}
+
+bool SourceMediaManager::RetargetPeer(const std::string &address) {
+    if (state_ == State::Stopped || !output_stream_)
+        return false;
+
+    if (!output_stream_->Retarget(address, sink_port1_))
+        return false;
+
+    remote_address_ = address;
+
+    // Feedback replies and sender reports follow the media flow; the
+    // receiver keeps updating the destination from live feedback
+    // packets once they arrive from the new address.
+    if (rtcp_receiver_)
+        rtcp_receiver_->SetSenderReportDestination(address, sink_port1_ + 1);
+
+    // The sender keeps its sequence and timestamp state across the
+    // retarget; clearing the latched error resumes the same stream.
+    // The opt-in FEC parity flow stays on its old socket - losses
+    // during the blip fall back to the retransmission path.
+    if (rtp_sender_)
+        rtp_sender_->ResumeTransport();
 
     return true;
 }
@@ -123,6 +511,60 @@ void SourceMediaManager::OnTransportNetworkError() {
         sp->OnSourceNetworkError();
 }
 
+void SourceMediaManager::OnRetransmitRequested(uint16_t first_sequence_number, uint16_t bitmask) {
+    if (!rtp_sender_)
+        return;
+
+    rtp_sender_->Retransmit(first_sequence_number, bitmask);
+}
+
+void SourceMediaManager::OnReceiverReport(uint8_t fraction_lost, uint32_t jitter) {
+    // Unlike the per-frame counters this arrives already aggregated at
+    // RTCP cadence, so it goes straight into the registry regardless of
+    // which report backend is selected; the live session statistics on
+    // the device object read it from there.
+    auto &registry = report::metrics::MetricsRegistry::Instance();
+    registry.SetGauge("rtcp_fraction_lost", fraction_lost);
+    registry.SetGauge("rtcp_jitter", jitter);
+
+    if (!bitrate_controller_)
+        return;
+
+    // Keep the rate budget aware of what the mux currently spends on
+    // stuffing; two relaxed loads, so fine on the RTCP thread.
+    if (packetizer_)
+        bitrate_controller_->SetMuxOverhead(packetizer_->MuxOverhead());
+
+    bitrate_controller_->ProcessFeedback(fraction_lost, jitter);
+
+    // The send buffer follows the operating point so a low-rate
+    // stretch is not sitting behind hundreds of milliseconds of
+    // transport stream the kernel queued at the old size. A no-op
+    // whenever the controller left the rate alone.
+    if (output_stream_)
+        output_stream_->AdjustSendBufferForBitrate(
+                    bitrate_controller_->CurrentBitrate());
+}
+
+void SourceMediaManager::OnLinkCapacityEstimate(std::uint32_t bits_per_second) {
+    // Runs on the link monitor's executor thread; the controller
+    // guards its own state.
+    if (!bitrate_controller_)
+        return;
+
+    bitrate_controller_->SetLinkCeiling(bits_per_second);
+}
+
+void SourceMediaManager::OnSinkRequestedIDRFrame() {
+    if (!encoder_)
+        return;
+
+    // Runs on the RTCP receiver thread; only flip the encoder's
+    // atomic flag here so the refresh lands in the very next queued
+    // frame without a trip through the main loop.
+    encoder_->RequestIDRFrame();
+}
+
 void SourceMediaManager::CancelDelayTimeout() {
     if (delay_timeout_ == 0)
         return;
@@ -146,6 +588,12 @@ void SourceMediaManager::Play() {
     if (!IsPaused())
         return;
 
+    if (!EnsureConfigured()) {
+        if (auto sp = delegate_.lock())
+            sp->OnSourceNetworkError();
+        return;
+    }
+
     AC_DEBUG("");
 
     CancelDelayTimeout();
@@ -172,6 +620,10 @@ void SourceMediaManager::Pause() {
     if (IsPaused())
         return;
 
+    // Construction may still be in flight; let it settle so there is
+    // nothing left adding stages underneath the stop.
+    EnsureConfigured();
+
     CancelDelayTimeout();
 
     AC_DEBUG("");
@@ -187,6 +639,8 @@ void SourceMediaManager::Teardown() {
 
     AC_DEBUG("");
 
+    EnsureConfigured();
+
     CancelDelayTimeout();
 
     pipeline_.Stop();
@@ -207,6 +661,11 @@ void SourceMediaManager::SendIDRPicture() {
 }
 
 int SourceMediaManager::GetLocalRtpPort() const {
+    // First caller is the SETUP reply, which bounds how far pipeline
+    // construction can lag behind the handshake.
+    if (!const_cast<SourceMediaManager*>(this)->EnsureConfigured())
+        return 0;
+
     return sender_->LocalRTPPort();
 }
 
@@ -18,23 +18,31 @@
 #ifndef AC_MIR_SOURCEMEDIAMANAGERNEXT_H_
 #define AC_MIR_SOURCEMEDIAMANAGERNEXT_H_
 
+#include <future>
 #include <memory>
 
 #include "ac/glib_wrapper.h"
 
 #include "ac/basesourcemediamanager.h"
 
+#include "ac/audio/pulseaudiocapture.h"
+
 #include "ac/common/executor.h"
 #include "ac/common/threadedexecutor.h"
 #include "ac/common/executorpool.h"
 
 #include "ac/report/reportfactory.h"
 
+#include "ac/network/linkmonitor.h"
 #include "ac/network/stream.h"
 
 #include "ac/video/baseencoder.h"
+#include "ac/video/videoformat.h"
 
+#include "ac/streaming/bitratecontroller.h"
 #include "ac/streaming/mediasender.h"
+#include "ac/streaming/rtcpreceiver.h"
+#include "ac/streaming/rtpsender.h"
 
 #include "ac/mir/screencast.h"
 #include "ac/mir/streamrenderer.h"
@@ -44,7 +52,9 @@ namespace mir {
 
 class SourceMediaManager : public std::enable_shared_from_this<SourceMediaManager>,
                            public ac::BaseSourceMediaManager,
-                           public ac::streaming::TransportSender::Delegate {
+                           public ac::streaming::TransportSender::Delegate,
+                           public ac::streaming::RTCPReceiver::Delegate,
+                           public ac::network::LinkMonitor::Delegate {
 public:
     typedef std::shared_ptr<SourceMediaManager> Ptr;
 
@@ -72,13 +82,40 @@ public:
 
     int GetLocalRtpPort() const override;
 
+    bool RetargetPeer(const std::string &address) override;
+
     void OnTransportNetworkError() override;
 
+    void OnRetransmitRequested(uint16_t first_sequence_number, uint16_t bitmask) override;
+    void OnReceiverReport(uint8_t fraction_lost, uint32_t jitter) override;
+    void OnSinkRequestedIDRFrame() override;
+
+    // From ac::network::LinkMonitor::Delegate
+    void OnLinkCapacityEstimate(std::uint32_t bits_per_second) override;
+
 private:
     static gboolean OnStartPipeline(gpointer user_data);
 
     void CancelDelayTimeout();
 
+    // Renegotiates the running session in place: the pipeline stages
+    // are drained and reconfigured for the new format instead of being
+    // torn down and rebuilt, so a format change costs a GOP rather
+    // than a reconnect.
+    bool Reconfigure();
+
+    // Builds the whole pipeline for the negotiated format; runs on a
+    // worker so encoder and capture init overlap the rest of the RTSP
+    // handshake instead of stalling it.
+    bool ConfigurePipeline(int rtp_port);
+
+    // Joins a construction still in flight; everything that hands out
+    // pipeline state or starts it goes through here first.
+    bool EnsureConfigured();
+
+    ac::video::BaseEncoder::Config BuildEncoderConfig(
+            const ac::video::RateAndResolution &rr);
+
 protected:
     bool Configure() override;
 
@@ -91,8 +128,16 @@ private:
     ac::report::ReportFactory::Ptr report_factory_;
     ac::mir::StreamRenderer::Ptr renderer_;
     ac::streaming::MediaSender::Ptr sender_;
+    ac::streaming::Packetizer::Ptr packetizer_;
+    std::shared_ptr<ac::streaming::RTPSender> rtp_sender_;
+    ac::streaming::RTCPReceiver::Ptr rtcp_receiver_;
+    ac::streaming::BitrateController::Ptr bitrate_controller_;
+    ac::network::LinkMonitor::Ptr link_monitor_;
+    ac::streaming::StreamRecorder::Ptr recorder_;
+    ac::audio::PulseAudioCapture::Ptr audio_capture_;
     ac::common::ExecutorPool pipeline_;
     guint delay_timeout_;
+    std::future<bool> configure_future_;
 };
 
 } // namespace mir
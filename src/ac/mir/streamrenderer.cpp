@@ -21,13 +21,50 @@
 #include <boost/concept_check.hpp>
 
 #include "ac/logger.h"
+#include "ac/report/dispatch.h"
+
+#include "ac/common/clock.h"
 
 #include "ac/mir/screencast.h"
 #include "ac/mir/streamrenderer.h"
 
+#include "ac/video/snapshottap.h"
+
 namespace {
 static constexpr const char *kStreamRendererThreadName{"StreamRenderer"};
-static constexpr unsigned int kNumBufferSlots{2};
+// Queue depths per session profile: shallow queues keep the capture to
+// send latency low, deeper ones ride out encoder iterations which take
+// longer than a frame interval.
+static constexpr std::uint32_t kLowLatencyBufferSlots{2};
+static constexpr std::uint32_t kBalancedBufferSlots{4};
+static constexpr std::uint32_t kThroughputBufferSlots{8};
+
+// Rate governor: saturation and headroom are judged over windows of
+// this many iterations, roughly half a second at 60fps.
+static constexpr std::uint32_t kGovernorWindow{30};
+// An iteration saturates the pipeline when its work time eats this
+// share of the current frame interval.
+static constexpr double kSaturationShare{0.9};
+// To count as headroom an iteration has to fit into this share of the
+// interval at the next faster rate.
+static constexpr double kHeadroomShare{0.75};
+// Consecutive headroom windows required before stepping the rate back
+// up; keeps the governor from oscillating around the saturation point.
+static constexpr std::uint32_t kStepUpWindows{4};
+// Lowest effective rate is a quarter of the negotiated one (60->30->15).
+static constexpr std::uint32_t kMaxRateDivisor{4};
+
+std::uint32_t BufferSlotsForProfile(ac::mir::SessionProfile profile) {
+    switch (profile) {
+    case ac::mir::SessionProfile::kThroughput:
+        return kThroughputBufferSlots;
+    case ac::mir::SessionProfile::kBalanced:
+        return kBalancedBufferSlots;
+    case ac::mir::SessionProfile::kLowLatency:
+    default:
+        return kLowLatencyBufferSlots;
+    }
+}
 }
 
 namespace ac {
@@ -35,14 +72,28 @@ namespace mir {
 
 StreamRenderer::StreamRenderer(const video::BufferProducer::Ptr &buffer_producer,
                                const video::BaseEncoder::Ptr &encoder,
-                               const video::RendererReport::Ptr &report) :
+                               const video::RendererReport::Ptr &report,
+                               SessionProfile profile) :
     report_(report),
     buffer_producer_(buffer_producer),
     encoder_(encoder),
     width_(buffer_producer->OutputMode().width),
     height_(buffer_producer->OutputMode().height),
+    buffer_slots_(BufferSlotsForProfile(profile)),
     input_buffers_(ac::video::BufferQueue::Create(BufferSlots())),
-    target_iteration_time_((1. / encoder_->Configuration().framerate) * std::micro::den) {
+    target_iteration_time_((1. / encoder_->Configuration().framerate) * std::micro::den),
+    next_capture_time_(0ll),
+    skipped_frames_(0),
+    // Force at least one frame per second through the pipeline even
+    // when the screen content doesn't change at all.
+    max_skipped_frames_(encoder_->Configuration().framerate),
+    stall_start_time_(0ll),
+    last_frame_id_(0),
+    rate_divisor_(1),
+    window_iterations_(0),
+    saturated_iterations_(0),
+    headroom_iterations_(0),
+    headroom_windows_(0) {
 }
 
 StreamRenderer::~StreamRenderer() {
@@ -50,43 +101,211 @@ StreamRenderer::~StreamRenderer() {
 }
 
 bool StreamRenderer::Execute() {
-    ac::TimestampUs iteration_start_time = ac::Utils::GetNowUs();
+    // The renderer runs at frame rate and is the natural place to
+    // refresh the process-wide coarse clock once per iteration.
+    const ac::TimestampUs iteration_start_time = ac::common::Clock::Update();
+
+    // Frames are scheduled against absolute deadlines spaced exactly
+    // one frame interval apart so that the per-iteration cost of
+    // compositing and encoding never accumulates into cadence drift.
+    if (next_capture_time_ == 0)
+        next_capture_time_ = iteration_start_time;
 
     // Wait until we have free slots again and all buffers we produced
     // went through the pipeline.
-    if (!input_buffers_->WaitForSlots())
+    if (!input_buffers_->WaitForSlots()) {
+        // The encoder is not keeping up. A short stall is scheduling
+        // noise, but a sustained one turns into session latency which
+        // never drains again, so once the backlog persisted for a full
+        // queue's worth of frame intervals the oldest in-flight frame
+        // is abandoned: bounded latency with an occasional dropped
+        // frame beats unbounded latency for interactive casting.
+        const ac::TimestampUs now = ac::common::Clock::NowUs();
+        if (stall_start_time_ == 0)
+            stall_start_time_ = now;
+
+        if (now - stall_start_time_ >= buffer_slots_ * target_iteration_time_) {
+            if (const auto dropped = input_buffers_->RemoveOldest()) {
+                // Detach the buffer so its eventual return doesn't
+                // free a slot which now belongs to a live frame
+                dropped->SetDelegate(std::weak_ptr<video::Buffer::Delegate>());
+                AC_REPORT(report_->DroppedFrame(dropped->Timestamp()));
+            }
+            // The next drop needs a fresh backlog window
+            stall_start_time_ = now;
+        }
+
+        // A full queue means the encoder eats more than a frame
+        // interval per frame; that's a fully saturated iteration.
+        UpdateRateGovernor(target_iteration_time_);
+
         return true;
+    }
+
+    stall_start_time_ = 0;
 
-    report_->BeganFrame();
+    AC_REPORT(report_->BeganFrame());
 
     // This will trigger the rendering/compositing process inside mir
     // and will block until that is done and we received a new buffer
     buffer_producer_->SwapBuffers();
 
-    auto buffer = buffer_producer_->CurrentBuffer();
-    buffer->SetDelegate(shared_from_this());
+    // A waiting preview request gets a copy of the very same readout
+    // the encoder consumes; while nobody asks this is one relaxed
+    // atomic load per frame.
+    auto &snapshots = video::SnapshotTap::Instance();
+    if (snapshots.Requested()) {
+        const auto readout = buffer_producer_->CurrentBuffer();
+        if (readout && readout->Data())
+            snapshots.Publish(readout->Data(), width_, height_,
+                              buffer_producer_->PixelFormat());
+        else
+            snapshots.MarkUnavailable();
+    }
 
-    // FIXME: at optimum we would get the timestamp directly supplied
-    // from our producer but as long as that isn't available we don't
-    // have any other chance and need to do it here.
-    buffer->SetTimestamp(ac::Utils::GetNowUs());
+    if (!buffer_producer_->LastFrameDamaged() && skipped_frames_ < max_skipped_frames_) {
+        // Nothing changed on screen so running the frame through the
+        // encoder again would just burn CPU and radio time. Static
+        // content then costs us close to nothing.
+        skipped_frames_++;
+        AC_REPORT(report_->FinishedFrame(ac::common::Clock::NowUs()));
+    } else {
+        skipped_frames_ = 0;
 
-    input_buffers_->Push(buffer);
+        auto buffer = buffer_producer_->CurrentBuffer();
 
-    encoder_->QueueBuffer(buffer);
+        // Prefer the producer's own notion of when the frame finished
+        // compositing so encode side jitter never leaks into the
+        // presentation clock; the capture time ends up in the RTP
+        // timestamps. Producers without a precise source report 0 and
+        // the current time stays the best remaining guess.
+        auto capture_time = buffer_producer_->LastFrameTimestamp();
+        if (capture_time == 0)
+            capture_time = ac::common::Clock::NowUs();
+        buffer->SetTimestamp(capture_time);
+        buffer->SetFrameId(++last_frame_id_);
 
-    report_->FinishedFrame(buffer->Timestamp());
+        // Backends which can steer their rate control by region get
+        // told what actually changed; everyone else keeps spending
+        // the bit budget uniformly.
+        encoder_->SetDamageHint(buffer_producer_->LastFrameDamageRegion());
 
-    // Calculate how long we have to wait until we can render the next
-    // frame to keep our framerate constant.
-    ac::TimestampUs iteration_time = ac::Utils::GetNowUs() - iteration_start_time;
-    ac::TimestampUs sleep_time = target_iteration_time_ - iteration_time;
+        // A surface-input encoder already received the raw frame
+        // through its shared gralloc surface during the swap; pushing
+        // it through the queue as well would just add a dead CPU hop.
+        if (!encoder_->InputSurface()) {
+            buffer->SetDelegate(shared_from_this());
+            input_buffers_->Push(buffer);
+            encoder_->QueueBuffer(buffer);
+        }
+
+        AC_REPORT(report_->FinishedFrame(buffer->Timestamp(), buffer->FrameId()));
+    }
+
+    // How long the actual work took decides whether the governor
+    // retunes the capture rate for the following deadlines.
+    UpdateRateGovernor(ac::common::Clock::NowUs() - iteration_start_time);
+
+    // Advance to the next absolute deadline. If we already ran past it
+    // we skip ahead to the next full interval instead of capturing in a
+    // burst to catch up; the skipped deadlines are reported so missed
+    // frames show up in the telemetry.
+    next_capture_time_ += target_iteration_time_;
+
+    const ac::TimestampUs now = ac::common::Clock::NowUs();
+    if (now >= next_capture_time_) {
+        AC_REPORT(report_->MissedFrameDeadline(next_capture_time_));
+        const ac::TimestampUs behind = now - next_capture_time_;
+        next_capture_time_ +=
+            ((behind / target_iteration_time_) + 1) * target_iteration_time_;
+    }
+
+    const ac::TimestampUs sleep_time = next_capture_time_ - now;
     if (sleep_time > 0)
         std::this_thread::sleep_for(std::chrono::microseconds(sleep_time));
 
     return true;
 }
 
+void StreamRenderer::UpdateRateGovernor(const ac::TimestampUs &busy_time) {
+    window_iterations_++;
+
+    if (busy_time >= kSaturationShare * target_iteration_time_)
+        saturated_iterations_++;
+    else if (rate_divisor_ > 1 &&
+             busy_time <= kHeadroomShare * (target_iteration_time_ / 2))
+        headroom_iterations_++;
+
+    if (window_iterations_ < kGovernorWindow)
+        return;
+
+    const bool saturated = saturated_iterations_ * 2 > kGovernorWindow;
+    const bool headroom = headroom_iterations_ * 10 >= kGovernorWindow * 9;
+
+    window_iterations_ = 0;
+    saturated_iterations_ = 0;
+    headroom_iterations_ = 0;
+
+    if (saturated && rate_divisor_ < kMaxRateDivisor) {
+        headroom_windows_ = 0;
+        ApplyRateDivisor(rate_divisor_ * 2);
+        return;
+    }
+
+    if (headroom && rate_divisor_ > 1) {
+        if (++headroom_windows_ >= kStepUpWindows) {
+            headroom_windows_ = 0;
+            ApplyRateDivisor(rate_divisor_ / 2);
+        }
+        return;
+    }
+
+    headroom_windows_ = 0;
+}
+
+void StreamRenderer::ApplyRateDivisor(std::uint32_t divisor) {
+    rate_divisor_ = divisor;
+
+    const int negotiated = encoder_->Configuration().framerate;
+    const int effective = negotiated / static_cast<int>(divisor);
+
+    target_iteration_time_ = (1. / effective) * std::micro::den;
+    // Still force at least one frame per second through the pipeline
+    max_skipped_frames_ = effective;
+
+    // Tell the encoder so its rate control spends the bit budget on
+    // the frames which actually come; backends without mid-session
+    // framerate changes keep running with the negotiated one.
+    encoder_->SetTargetFramerate(effective);
+
+    AC_INFO("Capture rate governor: running at %d fps now (negotiated %d)",
+            effective, negotiated);
+}
+
+void StreamRenderer::Reconfigure() {
+    width_ = buffer_producer_->OutputMode().width;
+    height_ = buffer_producer_->OutputMode().height;
+    target_iteration_time_ = (1. / encoder_->Configuration().framerate) * std::micro::den;
+    max_skipped_frames_ = encoder_->Configuration().framerate;
+
+    // The new format starts at full rate with a clean governor slate
+    rate_divisor_ = 1;
+    window_iterations_ = 0;
+    saturated_iterations_ = 0;
+    headroom_iterations_ = 0;
+    headroom_windows_ = 0;
+
+    // Frames captured for the old format never reach the encoder;
+    // detach them so their eventual return doesn't pop a slot which
+    // belongs to a live frame of the new session.
+    for (const auto &buffer : input_buffers_->PopAll())
+        buffer->SetDelegate(std::weak_ptr<video::Buffer::Delegate>());
+
+    next_capture_time_ = 0ll;
+    skipped_frames_ = 0;
+    stall_start_time_ = 0ll;
+}
+
 void StreamRenderer::OnBufferFinished(const video::Buffer::Ptr &buffer) {
     boost::ignore_unused_variable_warning(buffer);
 
@@ -113,7 +332,11 @@ std::string StreamRenderer::Name() const {
 }
 
 std::uint32_t StreamRenderer::BufferSlots() const {
-    return kNumBufferSlots;
+    return buffer_slots_;
+}
+
+void StreamRenderer::SetQueueReport(const video::BufferQueueReport::Ptr &report) {
+    input_buffers_->SetReport(Name(), report);
 }
 
 } // namespace mir
@@ -35,6 +35,15 @@
 
 namespace ac {
 namespace mir {
+
+// Trades pipeline buffering against capture-to-send latency for a
+// whole streaming session.
+enum class SessionProfile {
+    kLowLatency,
+    kBalanced,
+    kThroughput
+};
+
 class StreamRenderer : public std::enable_shared_from_this<StreamRenderer>,
                        public ac::common::Executable,
                        public ac::video::Buffer::Delegate {
@@ -45,11 +54,20 @@ public:
 
     StreamRenderer(const video::BufferProducer::Ptr &buffer_producer,
                    const video::BaseEncoder::Ptr &encoder,
-                   const video::RendererReport::Ptr  &report);
+                   const video::RendererReport::Ptr  &report,
+                   SessionProfile profile = SessionProfile::kLowLatency);
     ~StreamRenderer();
 
     std::uint32_t BufferSlots() const;
 
+    // Picks up a new output mode from the producer and encoder after a
+    // mid-session renegotiation; in-flight frames from the old format
+    // are dropped. Only call while the renderer is stopped.
+    void Reconfigure();
+
+    // Enables depth/stall/drop telemetry on the input buffer queue
+    void SetQueueReport(const video::BufferQueueReport::Ptr &report);
+
     // From ac::video::Buffer::Delegate
     void OnBufferFinished(const ac::video::Buffer::Ptr &buffer);
 
@@ -58,6 +76,16 @@ public:
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    // Execute() blocks inside the compositor for up to a frame
+    // interval and cannot share an executor loop
+    bool PrefersDedicatedThread() const override { return true; }
+
+private:
+    // Feeds one iteration's work time into the rate governor; steps
+    // the effective capture rate down when the pipeline is saturated
+    // and back up once sustained headroom returns.
+    void UpdateRateGovernor(const ac::TimestampUs &busy_time);
+    void ApplyRateDivisor(std::uint32_t divisor);
 
 private:
     video::RendererReport::Ptr report_;
@@ -65,8 +93,31 @@ private:
     video::BaseEncoder::Ptr encoder_;
     unsigned int width_;
     unsigned int height_;
+    std::uint32_t buffer_slots_;
     ac::video::BufferQueue::Ptr input_buffers_;
     ac::TimestampUs target_iteration_time_;
+    // Absolute deadline the next frame capture is due at; advanced by
+    // one frame interval per iteration so the cadence never drifts.
+    ac::TimestampUs next_capture_time_;
+    // Frames dropped in a row because the screen content didn't change.
+    // Capped so the sink still receives a recent reference frame.
+    unsigned int skipped_frames_;
+    unsigned int max_skipped_frames_;
+    // When the encoder stopped keeping up; 0 while the pipeline flows.
+    // Once the stall outlives the whole queue the oldest in-flight
+    // frame gets dropped to keep the session latency bounded.
+    ac::TimestampUs stall_start_time_;
+    // Last frame id handed out; every captured frame gets the next one
+    // so its journey through the pipeline can be correlated in traces.
+    ac::FrameId last_frame_id_;
+    // Rate governor state: the divisor scales the negotiated rate in
+    // powers of two (60->30->15) while the pipeline cannot sustain it;
+    // the counters judge saturation and headroom per window.
+    std::uint32_t rate_divisor_;
+    std::uint32_t window_iterations_;
+    std::uint32_t saturated_iterations_;
+    std::uint32_t headroom_iterations_;
+    std::uint32_t headroom_windows_;
 };
 } // namespace mir
 } // namespace ac
@@ -0,0 +1,421 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/nl80211.h>
+
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ac/logger.h"
+
+#include "ac/report/metrics/metricsregistry.h"
+
+#include "ac/network/linkmonitor.h"
+
+namespace {
+static constexpr const char *kLinkMonitorThreadName{"LinkMonitor"};
+// One station dump per second is plenty; link collapse from someone
+// walking away happens over seconds, not milliseconds.
+static constexpr ac::TimestampUs kPollIntervalUs = 1000000ll;
+// Execute() sleeps in short slices so the executor stays responsive
+// to Stop() and the pool watchdog never mistakes us for a stall.
+static const std::chrono::milliseconds kExecuteSlice{250};
+// Netlink reads must come back well under the watchdog threshold too.
+static const timeval kReceiveTimeout{0, 300000};
+// Share of the PHY rate real MPEG-TS/UDP payload can use at best; the
+// rest goes to WiFi MAC overhead, ACKs and contention.
+static constexpr double kMacEfficiency = 0.65;
+// Even a link spending most airtime on retries still carries a bit;
+// derating beyond this just makes the estimate jumpy.
+static constexpr double kMaxRetryDerate = 0.75;
+// Publish only when the estimate moved by more than this fraction so
+// the bitrate controller is not chased around by measurement noise.
+static constexpr double kPublishHysteresis = 0.1;
+
+// Appends one attribute, padded to netlink alignment, to a request
+void AppendAttribute(std::vector<uint8_t> &msg, uint16_t type,
+                     const void *data, uint16_t length) {
+    nlattr attr{};
+    attr.nla_type = type;
+    attr.nla_len = NLA_HDRLEN + length;
+
+    const auto offset = msg.size();
+    msg.resize(offset + NLA_ALIGN(attr.nla_len), 0);
+    ::memcpy(msg.data() + offset, &attr, sizeof(attr));
+    ::memcpy(msg.data() + offset + NLA_HDRLEN, data, length);
+}
+
+// Walks a run of attributes looking for one type; nullptr when absent
+const nlattr* FindAttribute(const nlattr *head, int length, uint16_t type) {
+    auto attr = head;
+    while (length >= static_cast<int>(sizeof(nlattr)) &&
+           attr->nla_len >= sizeof(nlattr) &&
+           static_cast<int>(attr->nla_len) <= length) {
+        if ((attr->nla_type & NLA_TYPE_MASK) == type)
+            return attr;
+
+        length -= NLA_ALIGN(attr->nla_len);
+        attr = reinterpret_cast<const nlattr*>(
+            reinterpret_cast<const uint8_t*>(attr) + NLA_ALIGN(attr->nla_len));
+    }
+    return nullptr;
+}
+
+const void* AttributeData(const nlattr *attr) {
+    return reinterpret_cast<const uint8_t*>(attr) + NLA_HDRLEN;
+}
+
+template<typename T>
+T AttributeValue(const nlattr *attr) {
+    T value;
+    ::memcpy(&value, AttributeData(attr), sizeof(value));
+    return value;
+}
+}
+
+namespace ac {
+namespace network {
+
+LinkMonitor::Ptr LinkMonitor::Create(const std::string &remote_address,
+                                     const std::weak_ptr<Delegate> &delegate) {
+    auto monitor = std::shared_ptr<LinkMonitor>(new LinkMonitor(delegate));
+
+    if (!monitor->ResolveInterface(remote_address))
+        return nullptr;
+
+    if (!monitor->SetupSocket())
+        return nullptr;
+
+    AC_INFO("Watching link quality towards %s on %s",
+            remote_address.c_str(), monitor->ifname_.c_str());
+
+    return monitor;
+}
+
+LinkMonitor::LinkMonitor(const std::weak_ptr<Delegate> &delegate) :
+    delegate_(delegate),
+    fd_(-1),
+    family_id_(0),
+    ifindex_(0),
+    sequence_(1),
+    last_poll_us_(0),
+    last_estimate_bps_(0),
+    last_packets_(0),
+    last_retries_(0),
+    last_failed_(0) {
+}
+
+LinkMonitor::~LinkMonitor() {
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool LinkMonitor::ResolveInterface(const std::string &remote_address) {
+    // A connected UDP socket picks the same route the RTP stream
+    // takes; its local address then maps back to an interface name.
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return false;
+
+    sockaddr_in remote{};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(1);
+    if (::inet_aton(remote_address.c_str(), &remote.sin_addr) == 0 ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    sockaddr_in local{};
+    socklen_t local_length = sizeof(local);
+    if (::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &local_length) < 0) {
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+
+    ifaddrs *addrs = nullptr;
+    if (::getifaddrs(&addrs) < 0)
+        return false;
+
+    for (auto entry = addrs; entry; entry = entry->ifa_next) {
+        if (!entry->ifa_addr || entry->ifa_addr->sa_family != AF_INET)
+            continue;
+
+        const auto addr = reinterpret_cast<sockaddr_in*>(entry->ifa_addr);
+        if (addr->sin_addr.s_addr != local.sin_addr.s_addr)
+            continue;
+
+        ifname_ = entry->ifa_name;
+        break;
+    }
+    ::freeifaddrs(addrs);
+
+    if (ifname_.empty())
+        return false;
+
+    ifindex_ = ::if_nametoindex(ifname_.c_str());
+    if (ifindex_ == 0)
+        return false;
+
+    // Only mac80211 devices carry a phy80211 link in sysfs; anything
+    // else (ethernet, tunnels) has no station info to poll.
+    const auto phy_path = "/sys/class/net/" + ifname_ + "/phy80211";
+    if (::access(phy_path.c_str(), F_OK) != 0) {
+        AC_DEBUG("%s is not a wireless interface; not monitoring link quality",
+                 ifname_.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool LinkMonitor::SetupSocket() {
+    fd_ = ::socket(AF_NETLINK, SOCK_RAW, NETLINK_GENERIC);
+    if (fd_ < 0)
+        return false;
+
+    ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &kReceiveTimeout, sizeof(kReceiveTimeout));
+
+    sockaddr_nl local{};
+    local.nl_family = AF_NETLINK;
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+        return false;
+
+    // Resolve the nl80211 family id through the generic netlink
+    // controller; it differs between kernels.
+    std::vector<uint8_t> request(NLMSG_HDRLEN + GENL_HDRLEN, 0);
+
+    genlmsghdr genl{};
+    genl.cmd = CTRL_CMD_GETFAMILY;
+    genl.version = 1;
+    ::memcpy(request.data() + NLMSG_HDRLEN, &genl, sizeof(genl));
+
+    AppendAttribute(request, CTRL_ATTR_FAMILY_NAME,
+                    NL80211_GENL_NAME, ::strlen(NL80211_GENL_NAME) + 1);
+
+    nlmsghdr nlh{};
+    nlh.nlmsg_len = request.size();
+    nlh.nlmsg_type = GENL_ID_CTRL;
+    nlh.nlmsg_flags = NLM_F_REQUEST;
+    nlh.nlmsg_seq = sequence_++;
+    ::memcpy(request.data(), &nlh, sizeof(nlh));
+
+    if (::send(fd_, request.data(), request.size(), 0) < 0)
+        return false;
+
+    uint8_t buffer[4096];
+    const auto received = ::recv(fd_, buffer, sizeof(buffer), 0);
+    if (received <= 0)
+        return false;
+
+    auto msg = reinterpret_cast<nlmsghdr*>(buffer);
+    if (!NLMSG_OK(msg, static_cast<unsigned int>(received)) ||
+        msg->nlmsg_type == NLMSG_ERROR)
+        return false;
+
+    const auto attrs = reinterpret_cast<const nlattr*>(
+        reinterpret_cast<uint8_t*>(NLMSG_DATA(msg)) + GENL_HDRLEN);
+    const auto attrs_length = msg->nlmsg_len - NLMSG_HDRLEN - GENL_HDRLEN;
+
+    const auto family = FindAttribute(attrs, attrs_length, CTRL_ATTR_FAMILY_ID);
+    if (!family)
+        return false;
+
+    family_id_ = AttributeValue<uint16_t>(family);
+    return family_id_ != 0;
+}
+
+bool LinkMonitor::PollStation() {
+    std::vector<uint8_t> request(NLMSG_HDRLEN + GENL_HDRLEN, 0);
+
+    genlmsghdr genl{};
+    genl.cmd = NL80211_CMD_GET_STATION;
+    genl.version = 0;
+    ::memcpy(request.data() + NLMSG_HDRLEN, &genl, sizeof(genl));
+
+    const uint32_t ifindex = ifindex_;
+    AppendAttribute(request, NL80211_ATTR_IFINDEX, &ifindex, sizeof(ifindex));
+
+    nlmsghdr nlh{};
+    nlh.nlmsg_len = request.size();
+    nlh.nlmsg_type = family_id_;
+    // A dump covers the single peer of a P2P group just as well and
+    // saves us from tracking its MAC address.
+    nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    nlh.nlmsg_seq = sequence_++;
+    ::memcpy(request.data(), &nlh, sizeof(nlh));
+
+    if (::send(fd_, request.data(), request.size(), 0) < 0)
+        return false;
+
+    bool parsed = false;
+    bool done = false;
+
+    while (!done) {
+        uint8_t buffer[8192];
+        const auto received = ::recv(fd_, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+            return parsed;
+
+        auto remaining = static_cast<int>(received);
+        for (auto msg = reinterpret_cast<nlmsghdr*>(buffer);
+             NLMSG_OK(msg, remaining);
+             msg = NLMSG_NEXT(msg, remaining)) {
+            if (msg->nlmsg_type == NLMSG_DONE) {
+                done = true;
+                break;
+            }
+            if (msg->nlmsg_type == NLMSG_ERROR)
+                return parsed;
+            if (msg->nlmsg_type != family_id_)
+                continue;
+
+            const auto attrs = reinterpret_cast<const nlattr*>(
+                reinterpret_cast<uint8_t*>(NLMSG_DATA(msg)) + GENL_HDRLEN);
+            const auto attrs_length = msg->nlmsg_len - NLMSG_HDRLEN - GENL_HDRLEN;
+
+            const auto sta_info = FindAttribute(attrs, attrs_length, NL80211_ATTR_STA_INFO);
+            if (!sta_info)
+                continue;
+
+            const auto info = reinterpret_cast<const nlattr*>(AttributeData(sta_info));
+            const auto info_length = sta_info->nla_len - NLA_HDRLEN;
+
+            uint32_t phy_kbps = 0;
+            if (const auto tx_rate = FindAttribute(info, info_length, NL80211_STA_INFO_TX_BITRATE)) {
+                const auto rate = reinterpret_cast<const nlattr*>(AttributeData(tx_rate));
+                const auto rate_length = tx_rate->nla_len - NLA_HDRLEN;
+
+                // The 32 bit field covers VHT and beyond; older
+                // drivers only fill the legacy 16 bit one. Both count
+                // in 100 kbit/s.
+                if (const auto bitrate = FindAttribute(rate, rate_length, NL80211_RATE_INFO_BITRATE32))
+                    phy_kbps = AttributeValue<uint32_t>(bitrate) * 100;
+                else if (const auto bitrate16 = FindAttribute(rate, rate_length, NL80211_RATE_INFO_BITRATE))
+                    phy_kbps = AttributeValue<uint16_t>(bitrate16) * 100;
+            }
+
+            int8_t signal_dbm = 0;
+            if (const auto signal = FindAttribute(info, info_length, NL80211_STA_INFO_SIGNAL))
+                signal_dbm = AttributeValue<int8_t>(signal);
+
+            uint32_t packets = 0, retries = 0, failed = 0;
+            if (const auto attr = FindAttribute(info, info_length, NL80211_STA_INFO_TX_PACKETS))
+                packets = AttributeValue<uint32_t>(attr);
+            if (const auto attr = FindAttribute(info, info_length, NL80211_STA_INFO_TX_RETRIES))
+                retries = AttributeValue<uint32_t>(attr);
+            if (const auto attr = FindAttribute(info, info_length, NL80211_STA_INFO_TX_FAILED))
+                failed = AttributeValue<uint32_t>(attr);
+
+            if (phy_kbps > 0) {
+                PublishEstimate(phy_kbps, signal_dbm, packets, retries, failed);
+                parsed = true;
+            }
+        }
+    }
+
+    return parsed;
+}
+
+void LinkMonitor::PublishEstimate(std::uint32_t phy_kbps, std::int8_t signal_dbm,
+                                  std::uint32_t packets, std::uint32_t retries,
+                                  std::uint32_t failed) {
+    // Retry ratio over just the last interval; the session totals
+    // would smear a sudden collapse over minutes of history.
+    const auto delta_packets = packets - last_packets_;
+    const auto delta_retries = (retries - last_retries_) + (failed - last_failed_);
+    last_packets_ = packets;
+    last_retries_ = retries;
+    last_failed_ = failed;
+
+    double retry_ratio = 0.0;
+    if (delta_packets + delta_retries > 0)
+        retry_ratio = static_cast<double>(delta_retries) /
+                      static_cast<double>(delta_packets + delta_retries);
+
+    const auto capacity = static_cast<uint32_t>(
+        phy_kbps * 1000.0 * kMacEfficiency *
+        (1.0 - std::min(retry_ratio, kMaxRetryDerate)));
+
+    auto &registry = report::metrics::MetricsRegistry::Instance();
+    registry.SetGauge("link_tx_phy_kbps", phy_kbps);
+    registry.SetGauge("link_capacity_bps", capacity);
+    // Stored negated; the registry only takes unsigned gauges and
+    // WiFi signal is always below zero dBm.
+    registry.SetGauge("link_signal_mdbm", static_cast<std::uint64_t>(-signal_dbm));
+
+    if (last_estimate_bps_ > 0) {
+        const auto moved = capacity > last_estimate_bps_
+            ? capacity - last_estimate_bps_
+            : last_estimate_bps_ - capacity;
+        if (moved < static_cast<uint32_t>(last_estimate_bps_ * kPublishHysteresis))
+            return;
+    }
+
+    AC_DEBUG("Link towards the sink now runs at %u kbit/s PHY, %d dBm, "
+             "retry ratio %.2f; capacity estimate %u bit/s",
+             phy_kbps, signal_dbm, retry_ratio, capacity);
+
+    last_estimate_bps_ = capacity;
+
+    if (auto sp = delegate_.lock())
+        sp->OnLinkCapacityEstimate(capacity);
+}
+
+bool LinkMonitor::Start() {
+    return true;
+}
+
+bool LinkMonitor::Stop() {
+    return true;
+}
+
+bool LinkMonitor::Execute() {
+    // Sleeping in one short slice per iteration keeps Stop() quick
+    // and stays well under the pool watchdog's stall threshold.
+    std::this_thread::sleep_for(kExecuteSlice);
+
+    const auto now = static_cast<ac::TimestampUs>(ac::Utils::GetNowUs());
+    if (now - last_poll_us_ < kPollIntervalUs)
+        return true;
+    last_poll_us_ = now;
+
+    if (!PollStation())
+        AC_WARNING_RATE_LIMITED("Failed to poll station info on %s", ifname_.c_str());
+
+    return true;
+}
+
+std::string LinkMonitor::Name() const {
+    return kLinkMonitorThreadName;
+}
+
+} // namespace network
+} // namespace ac
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_NETWORK_LINKMONITOR_H_
+#define AC_NETWORK_LINKMONITOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/common/executable.h"
+
+namespace ac {
+namespace network {
+
+/**
+ * @brief Polls nl80211 station statistics for the wireless link the
+ * session runs over and turns them into a capacity estimate.
+ *
+ * RTCP only reports loss after it happened; the local WiFi stack
+ * knows the negotiated TX rate, signal and retry counts before
+ * quality collapses. The monitor resolves the interface routing
+ * towards the sink, asks the kernel for its station info once a
+ * second over a plain generic netlink socket and hands a derated
+ * throughput estimate to the delegate whenever it moves, so the
+ * bitrate controller can back off while the link degrades instead of
+ * after the sink complained.
+ */
+class LinkMonitor : public common::Executable {
+public:
+    typedef std::shared_ptr<LinkMonitor> Ptr;
+
+    class Delegate : public ac::NonCopyable {
+    public:
+        // Rough number of payload bits per second the link can carry
+        // right now; derived from the PHY rate and the recent retry
+        // ratio, so treat it as a ceiling rather than a measurement.
+        virtual void OnLinkCapacityEstimate(std::uint32_t bits_per_second) = 0;
+    };
+
+    // Returns nullptr when the route towards the remote address does
+    // not cross a wireless interface or the nl80211 socket cannot be
+    // set up; sessions over ethernet or in tests simply run without
+    // the monitor.
+    static Ptr Create(const std::string &remote_address,
+                      const std::weak_ptr<Delegate> &delegate);
+
+    ~LinkMonitor();
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+
+private:
+    explicit LinkMonitor(const std::weak_ptr<Delegate> &delegate);
+
+    // Maps the remote address to the local interface the kernel
+    // routes it through; fails for anything without a phy80211.
+    bool ResolveInterface(const std::string &remote_address);
+    // Opens the generic netlink socket and resolves the nl80211
+    // family id.
+    bool SetupSocket();
+    // One station dump round; parses the peer's entry and publishes
+    // a fresh estimate when it moved enough to matter.
+    bool PollStation();
+    void PublishEstimate(std::uint32_t phy_kbps, std::int8_t signal_dbm,
+                         std::uint32_t packets, std::uint32_t retries,
+                         std::uint32_t failed);
+
+private:
+    std::weak_ptr<Delegate> delegate_;
+    int fd_;
+    std::uint16_t family_id_;
+    unsigned int ifindex_;
+    std::string ifname_;
+    std::uint32_t sequence_;
+    ac::TimestampUs last_poll_us_;
+    std::uint32_t last_estimate_bps_;
+    // Counter snapshots from the previous poll so the retry ratio
+    // covers just the last interval instead of the whole session.
+    std::uint32_t last_packets_;
+    std::uint32_t last_retries_;
+    std::uint32_t last_failed_;
+};
+
+} // namespace network
+} // namespace ac
+
+#endif
@@ -15,4 +15,56 @@
  *
  */
 
+#include <memory.h>
+
+#include <algorithm>
+
 #include "ac/network/stream.h"
+
+namespace ac {
+namespace network {
+
+Stream::Error Stream::WriteBatch(const std::vector<Datagram> &datagrams) {
+    std::vector<uint8_t> assembled;
+
+    for (const auto &datagram : datagrams) {
+        Error error = Error::kNone;
+
+        if (datagram.header && datagram.header_size > 0) {
+            // Streams without scatter-gather support still need the
+            // header and payload in one contiguous piece of memory.
+            assembled.resize(datagram.header_size + datagram.size);
+            ::memcpy(assembled.data(), datagram.header, datagram.header_size);
+            ::memcpy(assembled.data() + datagram.header_size, datagram.data, datagram.size);
+            error = Write(assembled.data(), assembled.size(), datagram.timestamp);
+        } else {
+            error = Write(datagram.data, datagram.size, datagram.timestamp);
+        }
+
+        if (error != Error::kNone)
+            return error;
+    }
+
+    return Error::kNone;
+}
+
+Stream::Error Stream::WriteSegmented(const uint8_t *data, unsigned int size,
+                                     unsigned int segment_size,
+                                     const ac::TimestampUs &timestamp) {
+    if (segment_size == 0)
+        return Error::kFailed;
+
+    unsigned int offset = 0;
+    while (offset < size) {
+        const auto length = std::min(size - offset, segment_size);
+        const auto error = Write(data + offset, length, timestamp);
+        if (error != Error::kNone)
+            return error;
+        offset += length;
+    }
+
+    return Error::kNone;
+}
+
+} // namespace network
+} // namespace ac
@@ -19,6 +19,9 @@
 #define AC_NETWORK_STREAM_H_
 
 #include <memory>
+#include <vector>
+
+#include <boost/concept_check.hpp>
 
 #include "ac/non_copyable.h"
 #include "ac/utils.h"
@@ -38,11 +41,133 @@ public:
         kRemoteClosedConnection,
     };
 
+    /**
+     * @brief A single send unit handed over to WriteBatch
+     *
+     * The data is only referenced and must stay valid until the
+     * WriteBatch call returns. An optional header fragment can be
+     * supplied which implementations send out in front of the payload
+     * without requiring both to live in contiguous memory.
+     */
+    struct Datagram {
+        Datagram(const uint8_t *data, unsigned int size,
+                 const ac::TimestampUs &timestamp = 0) :
+            header(nullptr),
+            header_size(0),
+            data(data),
+            size(size),
+            timestamp(timestamp) {
+        }
+
+        Datagram(const uint8_t *header, unsigned int header_size,
+                 const uint8_t *data, unsigned int size,
+                 const ac::TimestampUs &timestamp = 0) :
+            header(header),
+            header_size(header_size),
+            data(data),
+            size(size),
+            timestamp(timestamp) {
+        }
+
+        const uint8_t *header;
+        unsigned int header_size;
+        const uint8_t *data;
+        unsigned int size;
+        ac::TimestampUs timestamp;
+        // Id of the captured frame the payload belongs to; travels
+        // alongside the datagram so senders can attribute the final
+        // network write back to the frame in their reports.
+        ac::FrameId frame_id = 0;
+        // Earliest time (CLOCK_MONOTONIC, microseconds) the datagram
+        // should leave the host; 0 means immediately. Only honoured
+        // when the stream reports SupportsScheduledSend().
+        ac::TimestampUs launch_time_us = 0;
+        // Opaque guard the stream holds on to until the data has
+        // really left the system. Only needed when the stream reports
+        // RequiresCompletionTracking().
+        std::shared_ptr<void> completion = nullptr;
+    };
+
     virtual bool Connect(const std::string &address, const Port &port) = 0;
 
+    /**
+     * @brief Re-points an already connected stream at a new peer
+     * address without disturbing any other state.
+     *
+     * Used for session resume when the peer renegotiates its link and
+     * comes back, possibly under a different address; the local port
+     * and all negotiated socket features stay as they are so the
+     * session continues in place. Streams which cannot retarget return
+     * false and the caller falls back to a full reconnect.
+     */
+    virtual bool Retarget(const std::string &address, const Port &port) {
+        boost::ignore_unused_variable_warning(address);
+        boost::ignore_unused_variable_warning(port);
+        return false;
+    }
+
+    /**
+     * @brief Sizes the transport's send buffering for the given
+     * payload bitrate.
+     *
+     * A buffer sized for one rate misbehaves at another: at low
+     * bitrates it holds hundreds of milliseconds of queued transport
+     * stream which the receiver sees as latency, at high ones it is
+     * too small for a burst of large frames. Called once when the
+     * encoder is configured and again whenever the bitrate controller
+     * moves the operating point; the default implementation ignores
+     * it.
+     */
+    virtual void AdjustSendBufferForBitrate(unsigned int bits_per_second) {
+        boost::ignore_unused_variable_warning(bits_per_second);
+    }
+
     virtual Error Write(const uint8_t *data, unsigned int size,
                         const ac::TimestampUs &timestamp = 0) = 0;
 
+    /**
+     * @brief Sends out a batch of datagrams with as few syscalls as the
+     * implementation allows.
+     *
+     * The default implementation simply calls Write() once per datagram
+     * and stops at the first error.
+     */
+    virtual Error WriteBatch(const std::vector<Datagram> &datagrams);
+
+    /**
+     * @brief Sends out one large buffer which the stream splits into
+     * units of segment_size bytes (the last one may be shorter).
+     *
+     * The default implementation performs one Write() per segment;
+     * implementations with real segmentation offload submit the whole
+     * buffer at once.
+     */
+    virtual Error WriteSegmented(const uint8_t *data, unsigned int size,
+                                 unsigned int segment_size,
+                                 const ac::TimestampUs &timestamp = 0);
+
+    /**
+     * @brief Whether WriteSegmented() can hand the whole buffer to the
+     * kernel in one go instead of sending per-segment.
+     */
+    virtual bool SupportsSegmentedWrite() const { return false; }
+
+    /**
+     * @brief Whether the stream honours per-datagram launch times so
+     * callers can delegate packet pacing to the kernel.
+     */
+    virtual bool SupportsScheduledSend() const { return false; }
+
+    /**
+     * @brief Whether the stream may reference the datagram's memory
+     * after WriteBatch has returned.
+     *
+     * Callers must attach a completion guard to each datagram when
+     * this returns true; the guard is dropped once the data has been
+     * fully handed off.
+     */
+    virtual bool RequiresCompletionTracking() const { return false; }
+
     virtual Port LocalPort() const = 0;
 
     /**
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <memory.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <boost/concept_check.hpp>
+
+#include "ac/logger.h"
+#include "ac/networkutils.h"
+
+#include "ac/network/tcpstream.h"
+
+namespace {
+static constexpr unsigned int kTcpTxBufferSize = 256 * 1024;
+/* Keep RTP packets at the same size as on the UDP path so one framed
+ * unit still fits a single TCP segment with typical MSS values. */
+static constexpr unsigned int kMaxUnitSize = 1472;
+/* Unsent-data threshold; once crossed the socket stops accepting
+ * writes which surfaces congestion here instead of deep kernel
+ * buffers adding latency. */
+static constexpr unsigned int kNotSentLowat = 128 * 1024;
+/* How long a single poll for writability may take */
+static constexpr int kWritePollTimeoutMs = 100;
+/* Overall deadline for one framed unit before we declare the
+ * connection stalled */
+static constexpr int kWriteStallLimitMs = 1000;
+/* DSCP AF41 (interactive video) as recommended for WFD sessions */
+static constexpr int kVideoTos = 0x88;
+/* 802.1d user priority "video"; the wireless stack maps it to the
+ * WMM video access category */
+static constexpr int kVideoSocketPriority = 5;
+}
+
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+
+namespace ac {
+namespace network {
+
+TcpStream::TcpStream() :
+    socket_(-1),
+    local_port_(0) {
+}
+
+TcpStream::~TcpStream() {
+    if (socket_ >= 0)
+        ::close(socket_);
+}
+
+bool TcpStream::Connect(const std::string &address, const Port &port) {
+    socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (socket_ < 0) {
+        AC_ERROR("Failed to create socket: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    int value = kTcpTxBufferSize;
+    if (::setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &value, sizeof(value)) < 0) {
+        AC_ERROR("Failed to set socket transmit buffer size: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    // Every framed RTP packet should leave as its own segment right
+    // away instead of being Nagle-delayed.
+    int one = 1;
+    if (::setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0)
+        AC_WARNING("Failed to disable Nagle algorithm: %s (%d)", ::strerror(errno), errno);
+
+    int lowat = kNotSentLowat;
+    if (::setsockopt(socket_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) < 0)
+        AC_WARNING("Kernel does not support TCP_NOTSENT_LOWAT: %s (%d)", ::strerror(errno), errno);
+
+    // The TCP transport carries the same video payload as the UDP one
+    // and gets the same WMM video marking; non-fatal when refused.
+    int tos = kVideoTos;
+    if (::setsockopt(socket_, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0)
+        AC_WARNING("Failed to set video ToS marking: %s (%d)", ::strerror(errno), errno);
+
+    int priority = kVideoSocketPriority;
+    if (::setsockopt(socket_, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority)) < 0)
+        AC_WARNING("Failed to set video socket priority: %s (%d)", ::strerror(errno), errno);
+
+    struct sockaddr_in remote_addr;
+    ::memset(&remote_addr, 0, sizeof(remote_addr));
+    remote_addr.sin_family = AF_INET;
+    remote_addr.sin_port = htons(port);
+
+    if (!NetworkUtils::ResolveIPv4Address(address, &remote_addr.sin_addr)) {
+        AC_ERROR("Failed to resolve remote address %s", address.c_str());
+        return false;
+    }
+
+    if (::connect(socket_, reinterpret_cast<const struct sockaddr*>(&remote_addr), sizeof(remote_addr)) < 0) {
+        AC_ERROR("Failed to connect to remote: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    struct sockaddr_in local_addr;
+    socklen_t local_addr_len = sizeof(local_addr);
+    if (::getsockname(socket_, reinterpret_cast<struct sockaddr*>(&local_addr), &local_addr_len) == 0)
+        local_port_ = ntohs(local_addr.sin_port);
+
+    // All writes go through the non-blocking path with bounded waits
+    // so a congested connection can never stall the pipeline forever.
+    const auto flags = ::fcntl(socket_, F_GETFL, 0);
+    if (::fcntl(socket_, F_SETFL, flags | O_NONBLOCK) < 0) {
+        AC_ERROR("Failed to make socket non-blocking: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    AC_DEBUG("Connected with remote on %s:%d", address.c_str(), port);
+
+    return true;
+}
+
+bool TcpStream::WaitForSocketWritable() {
+    struct pollfd fd;
+    fd.fd = socket_;
+    fd.events = POLLOUT;
+    fd.revents = 0;
+
+    const auto ret = ::poll(&fd, 1, kWritePollTimeoutMs);
+    if (ret < 0) {
+        AC_ERROR("Failed to wait for socket to become writable: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    return ret > 0 && (fd.revents & POLLOUT);
+}
+
+Stream::Error TcpStream::WriteFramed(const uint8_t *header, unsigned int header_size,
+                                     const uint8_t *data, unsigned int size) {
+    // RFC 4571 framing: a two byte length prefix in front of every
+    // RTP packet so the sink can find packet boundaries in the byte
+    // stream.
+    const uint16_t total = header_size + size;
+    uint8_t prefix[2] = { static_cast<uint8_t>(total >> 8),
+                          static_cast<uint8_t>(total & 0xff) };
+
+    struct iovec iov[3];
+    unsigned int num_iovecs = 0;
+
+    iov[num_iovecs].iov_base = prefix;
+    iov[num_iovecs].iov_len = sizeof(prefix);
+    num_iovecs++;
+
+    if (header && header_size > 0) {
+        iov[num_iovecs].iov_base = const_cast<uint8_t*>(header);
+        iov[num_iovecs].iov_len = header_size;
+        num_iovecs++;
+    }
+
+    iov[num_iovecs].iov_base = const_cast<uint8_t*>(data);
+    iov[num_iovecs].iov_len = size;
+    num_iovecs++;
+
+    int waited_ms = 0;
+    unsigned int current = 0;
+
+    while (current < num_iovecs) {
+        const auto bytes_sent = ::writev(socket_, &iov[current], num_iovecs - current);
+
+        if (bytes_sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (waited_ms >= kWriteStallLimitMs) {
+                    AC_ERROR("Connection stalled for more than %d ms; giving up", kWriteStallLimitMs);
+                    return Error::kFailed;
+                }
+                if (!WaitForSocketWritable())
+                    waited_ms += kWritePollTimeoutMs;
+                continue;
+            }
+
+            if (errno == EPIPE || errno == ECONNRESET) {
+                AC_ERROR("Remote has closed connection: %s (%d)", ::strerror(errno), errno);
+                return Error::kRemoteClosedConnection;
+            }
+
+            AC_ERROR("Failed to send packet to remote: %s (%d)", ::strerror(errno), errno);
+            return Error::kFailed;
+        }
+
+        // Skip over fully written fragments and adjust a partially
+        // written one so the next writev continues where we stopped.
+        auto remaining = static_cast<size_t>(bytes_sent);
+        while (current < num_iovecs && remaining >= iov[current].iov_len) {
+            remaining -= iov[current].iov_len;
+            current++;
+        }
+        if (current < num_iovecs && remaining > 0) {
+            iov[current].iov_base = static_cast<uint8_t*>(iov[current].iov_base) + remaining;
+            iov[current].iov_len -= remaining;
+        }
+    }
+
+    return Error::kNone;
+}
+
+Stream::Error TcpStream::Write(const uint8_t *data, unsigned int size,
+                               const ac::TimestampUs &timestamp) {
+    boost::ignore_unused_variable_warning(timestamp);
+    return WriteFramed(nullptr, 0, data, size);
+}
+
+Stream::Error TcpStream::WriteBatch(const std::vector<Datagram> &datagrams) {
+    for (const auto &datagram : datagrams) {
+        const auto error = WriteFramed(datagram.header, datagram.header_size,
+                                       datagram.data, datagram.size);
+        if (error != Error::kNone)
+            return error;
+    }
+
+    return Error::kNone;
+}
+
+Port TcpStream::LocalPort() const {
+    return local_port_;
+}
+
+std::uint32_t TcpStream::MaxUnitSize() const {
+    return kMaxUnitSize;
+}
+
+} // namespace network
+} // namespace ac
@@ -18,8 +18,10 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <net/if.h>
-#include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <memory.h>
@@ -27,6 +29,7 @@
 #include <error.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <random>
 
 #include <boost/concept_check.hpp>
@@ -37,17 +40,70 @@
 #include "ac/network/udpstream.h"
 
 namespace {
+/* Default send buffer until the session bitrate is known */
 static constexpr unsigned int kUdpTxBufferSize = 256 * 1024;
+/* Transmit latency budget the send buffer is sized for; together with
+ * the bitrate it bounds how much transport stream the kernel may queue
+ * ahead of the radio */
+static constexpr unsigned int kTxBufferLatencyMs = 100;
+/* Bounds for the bitrate-derived send buffer: the floor keeps a burst
+ * of large frames sendable at low rates, the ceiling limits what an
+ * overestimated bitrate can cost in queueing delay */
+static constexpr unsigned int kMinUdpTxBufferSize = 64 * 1024;
+static constexpr unsigned int kMaxUdpTxBufferSize = 1024 * 1024;
 /* Value below configured MTU so that we don't require any further splits */
 static constexpr unsigned int kMaxUDPPacketSize = 1472;
+/* Bytes the IP and UDP headers take away from the path MTU */
+static constexpr unsigned int kIPUdpHeaderSize = 28;
+/* DSCP AF41 (interactive video) as recommended for WFD sessions */
+static constexpr int kVideoTos = 0x88;
+/* 802.1d user priority "video"; the wireless stack maps it to the
+ * WMM video access category */
+static constexpr int kVideoSocketPriority = 5;
+/* Maximum number of datagrams we hand to the kernel with one sendmmsg() call */
+static constexpr unsigned int kMaxBatchedMessages = 64;
 }
 
+/* Not all kernel headers we build against know about zero-copy
+ * transmission yet; the values are part of the kernel ABI. */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+struct sock_txtime {
+    clockid_t clockid;
+    uint32_t flags;
+};
+#endif
+#ifndef SCM_TXTIME
+#define SCM_TXTIME SO_TXTIME
+#endif
+
 namespace ac {
 namespace network {
 
 UdpStream::UdpStream() :
     socket_(0),
-    local_port_(NetworkUtils::PickRandomPort()) {
+    local_port_(NetworkUtils::PickRandomPort()),
+    max_unit_size_(kMaxUDPPacketSize),
+    gso_enabled_(false),
+    txtime_enabled_(false),
+    zero_copy_enabled_(false),
+    send_buffer_size_(0),
+    zero_copy_sequence_(0) {
 }
 
 UdpStream::~UdpStream() {
@@ -56,7 +112,7 @@ UdpStream::~UdpStream() {
 }
 
 bool UdpStream::Connect(const std::string &address, const Port &port) {
-    AC_DEBUG("Connected with remote on %s:%d", address, port);
+    AC_DEBUG("Connected with remote on %s:%d", address.c_str(), port);
 
     socket_ = ::socket(AF_INET, SOCK_DGRAM, 0);
     if (socket_ < 0) {
@@ -69,6 +125,67 @@ bool UdpStream::Connect(const std::string &address, const Port &port) {
         AC_ERROR("Failed to set socket transmit buffer size: %s (%d)", ::strerror(errno), errno);
         return false;
     }
+    send_buffer_size_ = kUdpTxBufferSize;
+
+    // Mark the stream as interactive video so it queues in the WMM
+    // video access category instead of behind bulk best-effort
+    // traffic on congested airtime; both failures are non-fatal as
+    // the session still works with default markings.
+    int tos = kVideoTos;
+    if (::setsockopt(socket_, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0)
+        AC_WARNING("Failed to set video ToS marking: %s (%d)", ::strerror(errno), errno);
+
+    int priority = kVideoSocketPriority;
+    if (::setsockopt(socket_, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority)) < 0)
+        AC_WARNING("Failed to set video socket priority: %s (%d)", ::strerror(errno), errno);
+
+    // Failed deliveries then land on the error queue with their ICMP
+    // details attached instead of only poisoning a later send with a
+    // bare errno; Write() inspects the queue to tell a gone sink from
+    // a transient hiccup.
+    int recv_err = 1;
+    if (::setsockopt(socket_, IPPROTO_IP, IP_RECVERR, &recv_err, sizeof(recv_err)) < 0)
+        AC_WARNING("Failed to enable socket error queueing: %s (%d)", ::strerror(errno), errno);
+
+    // Let the kernel segment one large buffer per frame into MTU
+    // sized datagrams instead of us submitting them one by one. We
+    // probe support by configuring a disabled segment size; older
+    // kernels reject the option entirely.
+    if (Utils::IsEnvSet("AETHERCAST_UDP_GSO")) {
+        int segment_size = 0;
+        if (::setsockopt(socket_, SOL_UDP, UDP_SEGMENT, &segment_size, sizeof(segment_size)) < 0)
+            AC_WARNING("Kernel does not support UDP segmentation offload: %s (%d)",
+                       ::strerror(errno), errno);
+        else
+            gso_enabled_ = true;
+    }
+
+    // With launch time scheduling the kernel (via the ETF qdisc)
+    // releases each datagram at its deadline which gives us pacing
+    // without user-space sleeps.
+    if (Utils::IsEnvSet("AETHERCAST_UDP_TXTIME")) {
+        struct sock_txtime txtime_config;
+        ::memset(&txtime_config, 0, sizeof(txtime_config));
+        txtime_config.clockid = CLOCK_MONOTONIC;
+
+        if (::setsockopt(socket_, SOL_SOCKET, SO_TXTIME, &txtime_config, sizeof(txtime_config)) < 0)
+            AC_WARNING("Kernel does not support transmit time scheduling: %s (%d)",
+                       ::strerror(errno), errno);
+        else
+            txtime_enabled_ = true;
+    }
+
+    // Zero-copy transmission is strictly opt-in as it only pays off
+    // for the larger datagrams of high-bitrate sessions and needs a
+    // kernel which supports it for UDP.
+    if (Utils::IsEnvSet("AETHERCAST_UDP_ZEROCOPY")) {
+        int one = 1;
+        if (::setsockopt(socket_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0)
+            AC_WARNING("Kernel does not support zero-copy UDP transmission: %s (%d)",
+                       ::strerror(errno), errno);
+        else
+            zero_copy_enabled_ = true;
+    }
 
     struct sockaddr_in addr;
     memset(addr.sin_zero, 0, sizeof(addr.sin_zero));
@@ -86,22 +203,115 @@ bool UdpStream::Connect(const std::string &address, const Port &port) {
     remote_addr.sin_family = AF_INET;
     remote_addr.sin_port = htons(port);
 
-    struct hostent *ent = gethostbyname(address.c_str());
-    if (!ent) {
-        AC_ERROR("Failed to resolve remote address");
+    if (!NetworkUtils::ResolveIPv4Address(address, &remote_addr.sin_addr)) {
+        AC_ERROR("Failed to resolve remote address %s", address.c_str());
         return false;
     }
 
-    remote_addr.sin_addr.s_addr = *(in_addr_t*) ent->h_addr;
-
     if (::connect(socket_, reinterpret_cast<const struct sockaddr*>(&remote_addr), sizeof(remote_addr)) < 0) {
         AC_ERROR("Failed to connect to remote: %s (%d)", ::strerror(errno), errno);
         return false;
     }
 
+    // With the don't-fragment bit set the kernel keeps a path MTU
+    // estimate for the connected socket which we size our datagrams
+    // to; on links with VLAN or tunnel encapsulation the real MTU is
+    // below the ethernet default and fragmenting every packet would
+    // double our loss sensitivity.
+    int pmtu_mode = IP_PMTUDISC_DO;
+    if (::setsockopt(socket_, IPPROTO_IP, IP_MTU_DISCOVER, &pmtu_mode, sizeof(pmtu_mode)) < 0)
+        AC_WARNING("Failed to enable path MTU discovery: %s (%d)", ::strerror(errno), errno);
+
+    RefreshPathMtu();
+
     return true;
 }
 
+bool UdpStream::Retarget(const std::string &address, const Port &port) {
+    if (socket_ <= 0)
+        return false;
+
+    struct sockaddr_in remote_addr;
+    memset(remote_addr.sin_zero, 0, sizeof(remote_addr.sin_zero));
+    remote_addr.sin_family = AF_INET;
+    remote_addr.sin_port = htons(port);
+
+    if (!NetworkUtils::ResolveIPv4Address(address, &remote_addr.sin_addr)) {
+        AC_ERROR("Failed to resolve remote address %s", address.c_str());
+        return false;
+    }
+
+    // A second connect() on a datagram socket merely replaces the
+    // default destination; the local port, the negotiated offloads
+    // and the send buffer all stay untouched so the session continues
+    // in place.
+    if (::connect(socket_, reinterpret_cast<const struct sockaddr*>(&remote_addr), sizeof(remote_addr)) < 0) {
+        AC_ERROR("Failed to retarget to new remote: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    // Stale ICMP errors queued while the old path was down must not
+    // poison the first sends towards the new destination.
+    DrainErrorQueue();
+
+    // The new path may well have a different MTU.
+    RefreshPathMtu();
+
+    AC_INFO("Retargeted stream to %s:%d keeping local port %d", address.c_str(), port, local_port_);
+
+    return true;
+}
+
+void UdpStream::AdjustSendBufferForBitrate(unsigned int bits_per_second) {
+    if (socket_ <= 0 || bits_per_second == 0)
+        return;
+
+    // At the configured bitrate the buffer holds kTxBufferLatencyMs
+    // worth of payload; anything beyond that is queueing delay which
+    // masks our pacing, anything below risks send() blocking
+    // mid-frame on bursts.
+    const auto wanted = static_cast<std::uint64_t>(bits_per_second) / 8
+            * kTxBufferLatencyMs / 1000;
+    const auto size = static_cast<unsigned int>(std::min<std::uint64_t>(
+        kMaxUdpTxBufferSize, std::max<std::uint64_t>(kMinUdpTxBufferSize, wanted)));
+
+    if (size == send_buffer_size_)
+        return;
+
+    int value = size;
+    if (::setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &value, sizeof(value)) < 0) {
+        // The session keeps working with the old size
+        AC_WARNING("Failed to adjust socket transmit buffer size: %s (%d)",
+                   ::strerror(errno), errno);
+        return;
+    }
+
+    AC_DEBUG("Sized transmit buffer to %u bytes for %u bit/s", size, bits_per_second);
+    send_buffer_size_ = size;
+}
+
+void UdpStream::RefreshPathMtu() {
+    int mtu = 0;
+    socklen_t length = sizeof(mtu);
+    if (::getsockopt(socket_, IPPROTO_IP, IP_MTU, &mtu, &length) < 0)
+        return;
+
+    if (mtu <= static_cast<int>(kIPUdpHeaderSize))
+        return;
+
+    // The usable payload excludes the IP and UDP headers; we never
+    // grow beyond the ethernet-sized default the rest of the pipeline
+    // is tuned for.
+    const auto unit_size = std::min<std::uint32_t>(
+        kMaxUDPPacketSize, static_cast<std::uint32_t>(mtu) - kIPUdpHeaderSize);
+
+    if (unit_size == max_unit_size_.load())
+        return;
+
+    AC_INFO("Path MTU is %d bytes; sizing datagrams to %u bytes", mtu, unit_size);
+    max_unit_size_ = unit_size;
+}
+
 Stream::Error UdpStream::Write(const uint8_t *data, unsigned int size,
                                const ac::TimestampUs &timestamp) {
 
@@ -117,13 +327,28 @@ Stream::Error UdpStream::Write(const uint8_t *data, unsigned int size,
     // error handling.
     if (bytes_sent < 0) {
         switch (errno) {
+        case EMSGSIZE:
+            // The path MTU shrank under us; this datagram is lost (the
+            // retransmission cache covers it) but refreshing the unit
+            // size lets the sender repack everything that follows.
+            RefreshPathMtu();
+            break;
         case ECONNREFUSED:
         case ENOPROTOOPT:
         case EPROTO:
         case EHOSTUNREACH:
         case ENETUNREACH:
         case ENETDOWN:
-            AC_DEBUG("Trying to resend due to a possible congested socket (errno %d)", errno);
+            // With error queueing enabled these errnos are fed from
+            // queued ICMP errors; inspecting the queue tells a sink
+            // which stopped listening apart from a transient hiccup
+            // worth one resend.
+            if (DrainErrorQueue() == Error::kRemoteClosedConnection) {
+                AC_ERROR_RATE_LIMITED("Remote is no longer listening on its RTP port");
+                return Error::kRemoteClosedConnection;
+            }
+
+            AC_DEBUG("Trying to resend after a transient socket error (errno %d)", errno);
             bytes_sent = ::send(socket_, data, size, 0);
            break;
         default:
@@ -132,23 +357,241 @@ Stream::Error UdpStream::Write(const uint8_t *data, unsigned int size,
     }
 
     if (bytes_sent < 0) {
-        AC_ERROR("Failed to send packet to remote: %s (%d)", ::strerror(-errno), errno);
+        AC_ERROR_RATE_LIMITED("Failed to send packet to remote: %s (%d)", ::strerror(-errno), errno);
         return Error::kFailed;
     }
     else if (bytes_sent == 0) {
-        AC_ERROR("Remote has closed connection: %s (%d)", ::strerror(-errno), errno);
+        AC_ERROR_RATE_LIMITED("Remote has closed connection: %s (%d)", ::strerror(-errno), errno);
         return Error::kRemoteClosedConnection;
     }
 
     return Error::kNone;
 }
 
+bool UdpStream::SupportsSegmentedWrite() const {
+    return gso_enabled_;
+}
+
+Stream::Error UdpStream::WriteSegmented(const uint8_t *data, unsigned int size,
+                                        unsigned int segment_size,
+                                        const ac::TimestampUs &timestamp) {
+    if (!gso_enabled_)
+        return Stream::WriteSegmented(data, size, segment_size, timestamp);
+
+    struct iovec iov;
+    iov.iov_base = const_cast<uint8_t*>(data);
+    iov.iov_len = size;
+
+    uint8_t control[CMSG_SPACE(sizeof(uint16_t))] = {0};
+
+    struct msghdr message;
+    ::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    auto cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    *reinterpret_cast<uint16_t*>(CMSG_DATA(cmsg)) = segment_size;
+
+    auto bytes_sent = ::sendmsg(socket_, &message, 0);
+    if (bytes_sent < 0) {
+        AC_ERROR_RATE_LIMITED("Failed to send segmented packet to remote: %s (%d)", ::strerror(errno), errno);
+        return Error::kFailed;
+    }
+
+    return Error::kNone;
+}
+
+bool UdpStream::RequiresCompletionTracking() const {
+    return zero_copy_enabled_;
+}
+
+bool UdpStream::SupportsScheduledSend() const {
+    return txtime_enabled_;
+}
+
+void UdpStream::ProcessZeroCopyCompletions() {
+    while (!pending_completions_.empty()) {
+        uint8_t control[128];
+
+        struct msghdr message;
+        ::memset(&message, 0, sizeof(message));
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        if (::recvmsg(socket_, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+
+        for (auto cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+                continue;
+
+            const auto error = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cmsg));
+            if (error->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            // The kernel reports a range of completed send calls;
+            // dropping the guards hands the buffers back to their
+            // owners.
+            pending_completions_.erase(
+                pending_completions_.lower_bound(error->ee_info),
+                pending_completions_.upper_bound(error->ee_data));
+        }
+    }
+}
+
+Stream::Error UdpStream::DrainErrorQueue() {
+    auto result = Error::kNone;
+
+    while (true) {
+        uint8_t control[128];
+
+        struct msghdr message;
+        ::memset(&message, 0, sizeof(message));
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        if (::recvmsg(socket_, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+
+        for (auto cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+                continue;
+
+            const auto error = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cmsg));
+
+            // Zero-copy completions share the error queue; dispatch
+            // them here so draining after a failed send cannot lose
+            // buffer guards.
+            if (error->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                pending_completions_.erase(
+                    pending_completions_.lower_bound(error->ee_info),
+                    pending_completions_.upper_bound(error->ee_data));
+                continue;
+            }
+
+            if (error->ee_origin != SO_EE_ORIGIN_ICMP)
+                continue;
+
+            AC_WARNING_RATE_LIMITED("Remote signalled ICMP type %u code %u (%s)",
+                                    error->ee_type, error->ee_code, ::strerror(error->ee_errno));
+
+            // Port unreachable means nothing is listening on the sink
+            // side anymore; everything else counts as transient.
+            if (error->ee_type == ICMP_DEST_UNREACH && error->ee_code == ICMP_PORT_UNREACH)
+                result = Error::kRemoteClosedConnection;
+            else if (result == Error::kNone)
+                result = Error::kFailed;
+        }
+    }
+
+    return result;
+}
+
+Stream::Error UdpStream::WriteBatch(const std::vector<Datagram> &datagrams) {
+    struct mmsghdr messages[kMaxBatchedMessages];
+    // Two iovec entries per message so an out-of-line header fragment
+    // can go in front of the payload without any copying.
+    struct iovec iovecs[kMaxBatchedMessages][2];
+    uint8_t control[kMaxBatchedMessages][CMSG_SPACE(sizeof(uint64_t))];
+
+    if (zero_copy_enabled_)
+        ProcessZeroCopyCompletions();
+
+    const int send_flags = zero_copy_enabled_ ? MSG_ZEROCOPY : 0;
+
+    size_t offset = 0;
+    while (offset < datagrams.size()) {
+        const auto count = std::min<size_t>(datagrams.size() - offset, kMaxBatchedMessages);
+
+        ::memset(messages, 0, count * sizeof(messages[0]));
+
+        for (size_t n = 0; n < count; n++) {
+            const auto &datagram = datagrams.at(offset + n);
+            unsigned int num_iovecs = 0;
+
+            if (datagram.header && datagram.header_size > 0) {
+                iovecs[n][num_iovecs].iov_base = const_cast<uint8_t*>(datagram.header);
+                iovecs[n][num_iovecs].iov_len = datagram.header_size;
+                num_iovecs++;
+            }
+
+            iovecs[n][num_iovecs].iov_base = const_cast<uint8_t*>(datagram.data);
+            iovecs[n][num_iovecs].iov_len = datagram.size;
+            num_iovecs++;
+
+            messages[n].msg_hdr.msg_iov = iovecs[n];
+            messages[n].msg_hdr.msg_iovlen = num_iovecs;
+
+            if (txtime_enabled_ && datagram.launch_time_us > 0) {
+                ::memset(control[n], 0, sizeof(control[n]));
+                messages[n].msg_hdr.msg_control = control[n];
+                messages[n].msg_hdr.msg_controllen = sizeof(control[n]);
+
+                auto cmsg = CMSG_FIRSTHDR(&messages[n].msg_hdr);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_TXTIME;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+                *reinterpret_cast<uint64_t*>(CMSG_DATA(cmsg)) =
+                        static_cast<uint64_t>(datagram.launch_time_us) * 1000ull;
+            }
+        }
+
+        auto messages_sent = ::sendmmsg(socket_, messages, count, send_flags);
+
+        // Same as in Write() we retry once when the error indicates a
+        // possibly congested socket before giving up.
+        if (messages_sent < 0) {
+            switch (errno) {
+            case ECONNREFUSED:
+            case ENOPROTOOPT:
+            case EPROTO:
+            case EHOSTUNREACH:
+            case ENETUNREACH:
+            case ENETDOWN:
+                AC_DEBUG("Trying to resend due to a possible congested socket (errno %d)", errno);
+                messages_sent = ::sendmmsg(socket_, messages, count, send_flags);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (messages_sent < 0) {
+            AC_ERROR_RATE_LIMITED("Failed to send packet batch to remote: %s (%d)", ::strerror(errno), errno);
+            return Error::kFailed;
+        }
+
+        if (zero_copy_enabled_) {
+            // Each zero-copy send call gets a sequence number assigned
+            // by the kernel; hold on to the completion guards until the
+            // matching completion arrives on the error queue.
+            for (ssize_t n = 0; n < messages_sent; n++) {
+                const auto &datagram = datagrams.at(offset + n);
+                if (datagram.completion)
+                    pending_completions_.emplace(zero_copy_sequence_, datagram.completion);
+                zero_copy_sequence_++;
+            }
+        }
+
+        // The kernel sends messages in order and stops at the first
+        // failure so we simply continue with the first unsent one.
+        offset += messages_sent;
+    }
+
+    return Error::kNone;
+}
+
 Port UdpStream::LocalPort() const {
     return local_port_;
 }
 
 std::uint32_t UdpStream::MaxUnitSize() const {
-    return kMaxUDPPacketSize;
+    return max_unit_size_;
 }
 
 } // namespace network
@@ -18,6 +18,8 @@
 #ifndef AC_NETWORK_UDPSTREAM_H_
 #define AC_NETWORK_UDPSTREAM_H_
 
+#include <atomic>
+#include <map>
 #include <memory>
 
 #include "ac/non_copyable.h"
@@ -34,16 +36,64 @@ public:
 
     bool Connect(const std::string &address, const Port &port) override;
 
+    bool Retarget(const std::string &address, const Port &port) override;
+
+    void AdjustSendBufferForBitrate(unsigned int bits_per_second) override;
+
     Error Write(const uint8_t *data, unsigned int size,
                 const ac::TimestampUs &timestamp = 0) override;
 
+    Error WriteBatch(const std::vector<Datagram> &datagrams) override;
+
     Port LocalPort() const override;
 
     std::uint32_t MaxUnitSize() const override;
 
-private:
+    Error WriteSegmented(const uint8_t *data, unsigned int size,
+                         unsigned int segment_size,
+                         const ac::TimestampUs &timestamp = 0) override;
+
+    bool SupportsSegmentedWrite() const override;
+
+    bool RequiresCompletionTracking() const override;
+
+    bool SupportsScheduledSend() const override;
+
+protected:
     int socket_;
+
+private:
+    void ProcessZeroCopyCompletions();
+    // Rereads the kernel's path MTU estimate for the connected socket
+    // and adjusts the unit size; called after connect and whenever a
+    // send bounces with EMSGSIZE.
+    void RefreshPathMtu();
+    // Drains the socket error queue, dispatching zero-copy send
+    // completions and classifying queued ICMP errors; returns
+    // kRemoteClosedConnection when the sink stopped listening on its
+    // port and kFailed for transient delivery errors.
+    Error DrainErrorQueue();
+
+private:
     Port local_port_;
+    // Largest datagram payload which still fits the discovered path
+    // MTU; senders poll this to size their packets. Atomic as the
+    // sender thread reads it while Write() may refresh it.
+    std::atomic<std::uint32_t> max_unit_size_;
+    // Opt-in UDP generalized segmentation offload; see Connect()
+    bool gso_enabled_;
+    // Opt-in SO_TXTIME launch time scheduling; see Connect()
+    bool txtime_enabled_;
+    // Opt-in MSG_ZEROCOPY send mode; see Connect()
+    bool zero_copy_enabled_;
+    // SO_SNDBUF value currently configured on the socket; redundant
+    // adjustments are skipped. Only touched from Connect() and the
+    // bitrate controller's feedback path.
+    unsigned int send_buffer_size_;
+    uint32_t zero_copy_sequence_;
+    // Completion guards for in-flight zero-copy sends keyed by the
+    // kernel's per-send sequence number
+    std::map<uint32_t, std::shared_ptr<void>> pending_completions_;
 };
 
 } // namespace network
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <memory.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "ac/logger.h"
+
+#include "ac/network/uringstream.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define AC_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace {
+// Number of submission queue entries; also bounds the number of sends
+// which can be in flight at any time.
+static constexpr unsigned int kRingEntries = 128;
+}
+
+namespace ac {
+namespace network {
+
+#ifdef AC_HAVE_IO_URING
+
+namespace {
+int io_uring_setup(unsigned int entries, struct io_uring_params *params) {
+    return ::syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                   unsigned int flags) {
+    return ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+}
+
+bool UringStream::IsSupported() {
+    struct io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+
+    const auto fd = io_uring_setup(4, &params);
+    if (fd < 0)
+        return false;
+
+    ::close(fd);
+    return true;
+}
+
+bool UringStream::SetupRing() {
+    struct io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+
+    ring_fd_ = io_uring_setup(kRingEntries, &params);
+    if (ring_fd_ < 0) {
+        AC_WARNING("Kernel does not support io_uring; falling back to plain sends");
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        AC_ERROR("Failed to map io_uring rings: %s (%d)", ::strerror(errno), errno);
+        TeardownRing();
+        return false;
+    }
+
+    auto sq_base = static_cast<uint8_t*>(sq_ring_);
+    sq_head_ = reinterpret_cast<uint32_t*>(sq_base + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq_base + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(sq_base + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32_t*>(sq_base + params.sq_off.array);
+
+    auto cq_base = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq_base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq_base + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(cq_base + params.cq_off.ring_mask);
+    cqes_ = cq_base + params.cq_off.cqes;
+
+    pending_.resize(kRingEntries);
+
+    return true;
+}
+
+void UringStream::TeardownRing() {
+    if (sq_ring_ && sq_ring_ != MAP_FAILED)
+        ::munmap(sq_ring_, sq_ring_size_);
+    if (cq_ring_ && cq_ring_ != MAP_FAILED)
+        ::munmap(cq_ring_, cq_ring_size_);
+    if (sqes_ && sqes_ != MAP_FAILED)
+        ::munmap(sqes_, sqes_size_);
+
+    sq_ring_ = cq_ring_ = sqes_ = nullptr;
+
+    if (ring_fd_ >= 0)
+        ::close(ring_fd_);
+
+    ring_fd_ = -1;
+}
+
+void UringStream::ReapCompletions() {
+    auto head = __atomic_load_n(cq_head_, __ATOMIC_ACQUIRE);
+    const auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        const auto cqe = reinterpret_cast<struct io_uring_cqe*>(cqes_) + (head & cq_mask_);
+
+        if (cqe->res < 0)
+            AC_WARNING("Asynchronous send failed: %s (%d)", ::strerror(-cqe->res), -cqe->res);
+
+        auto &slot = pending_.at(cqe->user_data);
+        slot.completion.reset();
+        slot.in_use = false;
+
+        head++;
+    }
+
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+int UringStream::FindFreeSlot() {
+    for (size_t n = 0; n < pending_.size(); n++) {
+        if (!pending_.at(n).in_use)
+            return n;
+    }
+    return -1;
+}
+
+Stream::Error UringStream::WriteBatch(const std::vector<Datagram> &datagrams) {
+    if (!ring_setup_attempted_) {
+        ring_setup_attempted_ = true;
+        ring_available_ = SetupRing();
+    }
+
+    if (!ring_available_)
+        return UdpStream::WriteBatch(datagrams);
+
+    ReapCompletions();
+
+    unsigned int to_submit = 0;
+
+    for (const auto &datagram : datagrams) {
+        auto slot_index = FindFreeSlot();
+        if (slot_index < 0) {
+            // All slots are in flight; submit what we have and wait
+            // for at least one completion before continuing.
+            if (to_submit > 0) {
+                io_uring_enter(ring_fd_, to_submit, 0, 0);
+                to_submit = 0;
+            }
+            if (io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+                AC_ERROR("Failed to wait for send completions: %s (%d)", ::strerror(errno), errno);
+                return Error::kFailed;
+            }
+            ReapCompletions();
+            slot_index = FindFreeSlot();
+            if (slot_index < 0)
+                return Error::kFailed;
+        }
+
+        auto &slot = pending_.at(slot_index);
+        slot.in_use = true;
+        slot.completion = datagram.completion;
+
+        unsigned int num_iovecs = 0;
+        if (datagram.header && datagram.header_size > 0) {
+            slot.iov[num_iovecs].iov_base = const_cast<uint8_t*>(datagram.header);
+            slot.iov[num_iovecs].iov_len = datagram.header_size;
+            num_iovecs++;
+        }
+        slot.iov[num_iovecs].iov_base = const_cast<uint8_t*>(datagram.data);
+        slot.iov[num_iovecs].iov_len = datagram.size;
+        num_iovecs++;
+
+        ::memset(&slot.message, 0, sizeof(slot.message));
+        slot.message.msg_iov = slot.iov;
+        slot.message.msg_iovlen = num_iovecs;
+
+        const auto tail = *sq_tail_;
+        const auto index = tail & sq_mask_;
+
+        auto sqe = reinterpret_cast<struct io_uring_sqe*>(sqes_) + index;
+        ::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = socket_;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot.message);
+        sqe->len = 1;
+        sqe->user_data = slot_index;
+
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+        to_submit++;
+    }
+
+    if (to_submit > 0 && io_uring_enter(ring_fd_, to_submit, 0, 0) < 0) {
+        AC_ERROR("Failed to submit sends to io_uring: %s (%d)", ::strerror(errno), errno);
+        return Error::kFailed;
+    }
+
+    return Error::kNone;
+}
+
+bool UringStream::RequiresCompletionTracking() const {
+    // Submitted data stays referenced until the matching completion
+    // arrives on the ring.
+    return true;
+}
+
+#else // AC_HAVE_IO_URING
+
+bool UringStream::IsSupported() {
+    return false;
+}
+
+bool UringStream::SetupRing() {
+    return false;
+}
+
+void UringStream::TeardownRing() {
+}
+
+void UringStream::ReapCompletions() {
+}
+
+int UringStream::FindFreeSlot() {
+    return -1;
+}
+
+Stream::Error UringStream::WriteBatch(const std::vector<Datagram> &datagrams) {
+    return UdpStream::WriteBatch(datagrams);
+}
+
+bool UringStream::RequiresCompletionTracking() const {
+    return UdpStream::RequiresCompletionTracking();
+}
+
+#endif // AC_HAVE_IO_URING
+
+UringStream::UringStream() :
+    ring_setup_attempted_(false),
+    ring_available_(false),
+    ring_fd_(-1),
+    sq_ring_(nullptr),
+    sq_ring_size_(0),
+    cq_ring_(nullptr),
+    cq_ring_size_(0),
+    sqes_(nullptr),
+    sqes_size_(0),
+    sq_head_(nullptr),
+    sq_tail_(nullptr),
+    sq_mask_(0),
+    sq_array_(nullptr),
+    cq_head_(nullptr),
+    cq_tail_(nullptr),
+    cq_mask_(0),
+    cqes_(nullptr) {
+}
+
+UringStream::~UringStream() {
+    TeardownRing();
+}
+
+} // namespace network
+} // namespace ac
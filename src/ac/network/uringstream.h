@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_NETWORK_URINGSTREAM_H_
+#define AC_NETWORK_URINGSTREAM_H_
+
+#include <sys/socket.h>
+
+#include <memory>
+
+#include "ac/network/udpstream.h"
+
+namespace ac {
+namespace network {
+
+/**
+ * @brief UDP stream which submits sends through an io_uring
+ * submission queue instead of per-packet syscalls.
+ *
+ * The ring is driven directly through the io_uring syscalls so no
+ * extra library dependency is needed. When the kernel does not
+ * support io_uring all operations transparently fall back to the
+ * plain UdpStream behaviour.
+ */
+class UringStream : public UdpStream {
+public:
+    UringStream();
+    ~UringStream();
+
+    Error WriteBatch(const std::vector<Datagram> &datagrams) override;
+
+    bool RequiresCompletionTracking() const override;
+
+    // Probes once whether the running kernel offers io_uring
+    static bool IsSupported();
+
+private:
+    struct PendingSend {
+        bool in_use = false;
+        struct msghdr message;
+        struct iovec iov[2];
+        std::shared_ptr<void> completion;
+    };
+
+    bool SetupRing();
+    void TeardownRing();
+    void ReapCompletions();
+    int FindFreeSlot();
+
+private:
+    bool ring_setup_attempted_;
+    bool ring_available_;
+    int ring_fd_;
+    // Mapped submission/completion ring state; see uringstream.cpp
+    void *sq_ring_;
+    size_t sq_ring_size_;
+    void *cq_ring_;
+    size_t cq_ring_size_;
+    void *sqes_;
+    size_t sqes_size_;
+    uint32_t *sq_head_;
+    uint32_t *sq_tail_;
+    uint32_t sq_mask_;
+    uint32_t *sq_array_;
+    uint32_t *cq_head_;
+    uint32_t *cq_tail_;
+    uint32_t cq_mask_;
+    void *cqes_;
+    std::vector<PendingSend> pending_;
+};
+
+} // namespace network
+} // namespace ac
+
+#endif
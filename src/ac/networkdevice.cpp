@@ -18,6 +18,10 @@
 #include "networkdevice.h"
 
 namespace ac {
+NetworkDevice::RoleList NetworkDevice::MakeRoleList(std::vector<NetworkDeviceRole> roles) {
+    return std::make_shared<const std::vector<NetworkDeviceRole>>(std::move(roles));
+}
+
 std::string NetworkDevice::StateToStr(NetworkDeviceState state) {
     switch (state) {
     case kIdle:
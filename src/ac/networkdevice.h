@@ -45,6 +45,15 @@ class NetworkDevice : public NonCopyable {
 public:
     typedef std::shared_ptr<NetworkDevice> Ptr;
 
+    // Immutable snapshot of the roles a device supports. Implementations
+    // publish a new snapshot when the set changes and everything between
+    // the device and the D-Bus skeletons passes the handle along instead
+    // of deep-copying the vector on every property read. Never null; an
+    // empty list stands for a device without any announced roles.
+    typedef std::shared_ptr<const std::vector<NetworkDeviceRole>> RoleList;
+
+    static RoleList MakeRoleList(std::vector<NetworkDeviceRole> roles);
+
     static std::string StateToStr(NetworkDeviceState state);
     static std::string RoleToStr(NetworkDeviceRole role);
 
@@ -52,7 +61,7 @@ public:
     virtual IpV4Address IPv4Address() const = 0;
     virtual std::string Name() const = 0;
     virtual NetworkDeviceState State() const = 0;
-    virtual std::vector<NetworkDeviceRole> SupportedRoles() const = 0;
+    virtual RoleList SupportedRoles() const = 0;
 
     bool IsConnecting() const;
 
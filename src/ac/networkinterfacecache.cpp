@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "ac/logger.h"
+#include "ac/networkinterfacecache.h"
+
+namespace {
+// A link message is an ifinfomsg plus a short attribute list; this
+// comfortably holds the handful the kernel batches into one read.
+constexpr std::size_t kMessageBufferSize{4096};
+}
+
+namespace ac {
+
+NetworkInterfaceCache& NetworkInterfaceCache::Instance() {
+    static NetworkInterfaceCache instance;
+    return instance;
+}
+
+NetworkInterfaceCache::NetworkInterfaceCache() {
+    // Subscribing before the dump means a change racing the dump sits
+    // in the socket buffer and gets replayed on top of it instead of
+    // being lost.
+    if (!StartListening())
+        return;
+
+    Prime();
+}
+
+NetworkInterfaceCache::~NetworkInterfaceCache() {
+    if (watch_)
+        g_source_remove(watch_);
+
+    if (channel_)
+        g_io_channel_unref(channel_);
+}
+
+bool NetworkInterfaceCache::StartListening() {
+    const auto fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                             NETLINK_ROUTE);
+    if (fd < 0) {
+        AC_WARNING("Failed to create rtnetlink socket: %s", ::strerror(errno));
+        return false;
+    }
+
+    struct sockaddr_nl addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+
+    if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_WARNING("Failed to subscribe to rtnetlink link events: %s", ::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    channel_ = g_io_channel_unix_new(fd);
+    g_io_channel_set_close_on_unref(channel_, TRUE);
+    g_io_channel_set_encoding(channel_, nullptr, nullptr);
+    g_io_channel_set_buffered(channel_, FALSE);
+
+    // The cache lives for the process lifetime so the watch carries a
+    // plain pointer instead of a KeepAlive<> trampoline.
+    watch_ = g_io_add_watch_full(channel_, G_PRIORITY_DEFAULT,
+                GIOCondition(G_IO_IN | G_IO_NVAL | G_IO_HUP | G_IO_ERR),
+                OnMessageReceived, this, nullptr);
+
+    return true;
+}
+
+void NetworkInterfaceCache::Prime() {
+    // glibc answers this with its own rtnetlink dump, so one kernel
+    // round-trip fills the whole table.
+    const auto interfaces = ::if_nameindex();
+    if (!interfaces) {
+        AC_WARNING("Failed to dump the interface table: %s", ::strerror(errno));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto entry = interfaces; entry->if_index != 0; entry++)
+        links_[static_cast<int>(entry->if_index)] = entry->if_name;
+
+    ::if_freenameindex(interfaces);
+}
+
+bool NetworkInterfaceCache::ProcessMessages() {
+    alignas(struct nlmsghdr) uint8_t buf[kMessageBufferSize];
+
+    const auto len = ::recv(g_io_channel_unix_get_fd(channel_), buf, sizeof(buf), 0);
+    if (len <= 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto remaining = static_cast<unsigned int>(len);
+    for (auto header = reinterpret_cast<struct nlmsghdr*>(static_cast<void*>(buf));
+            NLMSG_OK(header, remaining);
+            header = NLMSG_NEXT(header, remaining)) {
+
+        if (header->nlmsg_type != RTM_NEWLINK && header->nlmsg_type != RTM_DELLINK)
+            continue;
+
+        const auto info = static_cast<struct ifinfomsg*>(NLMSG_DATA(header));
+
+        if (header->nlmsg_type == RTM_DELLINK) {
+            links_.erase(info->ifi_index);
+            continue;
+        }
+
+        auto attr = IFLA_RTA(info);
+        auto attr_len = IFLA_PAYLOAD(header);
+        for (; RTA_OK(attr, attr_len); attr = RTA_NEXT(attr, attr_len)) {
+            if (attr->rta_type != IFLA_IFNAME)
+                continue;
+
+            links_[info->ifi_index] = static_cast<const char*>(RTA_DATA(attr));
+            break;
+        }
+    }
+
+    return true;
+}
+
+gboolean NetworkInterfaceCache::OnMessageReceived(GIOChannel *channel, GIOCondition cond, gpointer data) {
+    auto thiz = static_cast<NetworkInterfaceCache*>(data);
+
+    if (cond & (G_IO_NVAL | G_IO_HUP | G_IO_ERR))
+        return FALSE;
+
+    (void) channel;
+
+    return static_cast<gboolean>(thiz->ProcessMessages());
+}
+
+int NetworkInterfaceCache::LookupIndex(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto &link : links_) {
+        if (link.second == name)
+            return link.first;
+    }
+
+    return -1;
+}
+
+std::string NetworkInterfaceCache::LookupName(int index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto it = links_.find(index);
+    return it == links_.end() ? "" : it->second;
+}
+
+} // namespace ac
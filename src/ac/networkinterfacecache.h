@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_NETWORKINTERFACECACHE_H_
+#define AC_NETWORKINTERFACECACHE_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "ac/glib_wrapper.h"
+#include "ac/non_copyable.h"
+
+namespace ac {
+
+// Mirrors the kernel's link table so the repeated name/index queries
+// during connection setup are map reads instead of one serialized
+// ioctl round-trip each. The table is primed with a single rtnetlink
+// dump; afterwards the RTM_NEWLINK/RTM_DELLINK broadcasts keep it
+// current over a GLib io watch on a socket that stays quiet until an
+// interface actually comes or goes. Lookups return a miss when the
+// socket could not be set up or an interface is newer than the last
+// dispatched event, and NetworkUtils falls back to the kernel then.
+class NetworkInterfaceCache : public ac::NonCopyable {
+public:
+    static NetworkInterfaceCache& Instance();
+
+    // Returns -1 on a miss
+    int LookupIndex(const std::string &name);
+    // Returns an empty string on a miss
+    std::string LookupName(int index);
+
+private:
+    NetworkInterfaceCache();
+    ~NetworkInterfaceCache();
+
+    bool StartListening();
+    void Prime();
+    bool ProcessMessages();
+
+    static gboolean OnMessageReceived(GIOChannel *channel, GIOCondition cond, gpointer data);
+
+private:
+    std::mutex mutex_;
+    GIOChannel *channel_ = nullptr;
+    guint watch_ = 0;
+    std::map<int, std::string> links_;
+};
+
+} // namespace ac
+
+#endif
@@ -17,6 +17,7 @@
 
 #include <boost/concept_check.hpp>
 
+#include <infra/networkmanager.h>
 #include <w11tng/networkmanager.h>
 
 #include "networkmanagerfactory.h"
@@ -96,6 +97,12 @@ NetworkManager::Ptr NetworkManagerFactory::Create(const std::string &type) {
     if (final_type == "w11tng" || final_type.length() == 0)
         return w11tng::NetworkManager::Create();
 
+    // Streams over the regular (wired or infrastructure WiFi) network
+    // with mDNS sink discovery instead of the P2P link; see
+    // infra::NetworkManager for the trade-offs.
+    if (final_type == "infra")
+        return infra::NetworkManager::Create();
+
     return std::make_shared<NullNetworkManager>();
 }
 
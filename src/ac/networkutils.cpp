@@ -38,15 +38,24 @@
 #include <linux/if.h>
 #include <linux/wireless.h>
 
+#include <netdb.h>
+
+#include <chrono>
+#include <future>
 #include <random>
+#include <thread>
 
 #include "ac/glib_wrapper.h"
 #include "ac/logger.h"
+#include "ac/networkinterfacecache.h"
 #include "ac/networkutils.h"
 #include "ac/logger.h"
 
 namespace {
 static constexpr size_t kDriverCommandReplySize{1024};
+// Upper bound for a hostname lookup; a broken nsswitch or dead DNS
+// server otherwise keeps getaddrinfo busy for tens of seconds.
+static constexpr unsigned int kResolverTimeoutMs{2000};
 
 #define NLMSG_TAIL(nmsg)				\
     ((struct rtattr *) (((uint8_t*) (nmsg)) +	\
@@ -196,6 +205,12 @@ int NetworkUtils::RetrieveInterfaceIndex(const char *name)
     if (name == nullptr)
         return -1;
 
+    const auto cached = NetworkInterfaceCache::Instance().LookupIndex(name);
+    if (cached >= 0)
+        return cached;
+
+    // A miss can mean an interface newer than the last dispatched link
+    // event (a just-created P2P group), so ask the kernel directly.
     sk = socket(PF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
     if (sk < 0)
         return -1;
@@ -217,6 +232,10 @@ std::string NetworkUtils::RetrieveInterfaceName(int index) {
     if (index < 0)
         return "";
 
+    const auto cached = NetworkInterfaceCache::Instance().LookupName(index);
+    if (!cached.empty())
+        return cached;
+
     auto sock = ::socket(PF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
     if (sock < 0)
         return "";
@@ -327,4 +346,49 @@ ac::network::Port NetworkUtils::PickRandomPort() {
     return static_cast<ac::network::Port>(distribution(generator));
 }
 
+bool NetworkUtils::ResolveIPv4Address(const std::string &address, struct in_addr *addr) {
+    if (!addr)
+        return false;
+
+    // Peers always announce themselves with a dotted-quad address
+    // assigned over DHCP so the numeric path covers every production
+    // session without touching the system resolver at all.
+    if (::inet_pton(AF_INET, address.c_str(), addr) == 1)
+        return true;
+
+    // Everything else (mostly hand-typed hostnames during development)
+    // goes through getaddrinfo on a detached worker. The promise keeps
+    // the waiting side decoupled so we can give up after the deadline
+    // while the worker finishes on its own.
+    auto promise = std::make_shared<std::promise<in_addr_t>>();
+    auto result = promise->get_future();
+
+    std::thread([promise, address]() {
+        struct addrinfo hints;
+        ::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+
+        struct addrinfo *info = nullptr;
+        auto resolved = static_cast<in_addr_t>(INADDR_NONE);
+        if (::getaddrinfo(address.c_str(), nullptr, &hints, &info) == 0 && info) {
+            resolved = reinterpret_cast<struct sockaddr_in*>(info->ai_addr)->sin_addr.s_addr;
+            ::freeaddrinfo(info);
+        }
+
+        promise->set_value(resolved);
+    }).detach();
+
+    if (result.wait_for(std::chrono::milliseconds(kResolverTimeoutMs)) != std::future_status::ready) {
+        AC_WARNING("Resolver did not answer for %s within %u ms", address.c_str(), kResolverTimeoutMs);
+        return false;
+    }
+
+    const auto resolved = result.get();
+    if (resolved == INADDR_NONE)
+        return false;
+
+    addr->s_addr = resolved;
+    return true;
+}
+
 } // namespace ac
@@ -18,6 +18,8 @@
 #ifndef NETWORKUTILS_H_
 #define NETWORKUTILS_H_
 
+#include <netinet/in.h>
+
 #include <string>
 
 #include "ac/network/types.h"
@@ -38,6 +40,18 @@ public:
     static int BytesAvailableToRead(int fd);
     static int SendDriverPrivateCommand(const std::string &ifname, const std::string &cmd);
     static ac::network::Port PickRandomPort();
+    /**
+     * @brief Turns an address string into an IPv4 address without ever
+     * blocking on the system resolver.
+     *
+     * Dotted-quad addresses (the only thing peers hand us over the
+     * P2P link) are parsed directly with inet_pton. Anything else is
+     * resolved through getaddrinfo on a detached worker thread with a
+     * hard deadline so a misconfigured resolver stack fails the lookup
+     * quickly instead of stalling the caller for its full timeout.
+     * Returns false when the address cannot be resolved in time.
+     */
+    static bool ResolveIPv4Address(const std::string &address, struct in_addr *addr);
 };
 } // namespace ac
 #endif
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_DISPATCH_H_
+#define AC_REPORT_DISPATCH_H_
+
+// Per-packet and per-frame report calls go through this macro instead
+// of calling the report interface directly. By default the statement
+// runs unchanged and dispatches virtually through whatever backend the
+// runtime factory selected. Builds which fix the backend to the null
+// implementation for the process lifetime (the AETHERCAST_STATIC_NULL_REPORTS
+// cmake option, which defines AC_REPORT_STATIC_NULL)
+// compile these statements out entirely, the same way AC_TRACE/AC_DEBUG
+// disappear from release builds: a no-op behind a virtual call still
+// costs the dispatch and the argument setup on every RTP packet.
+//
+// Only the high-frequency calls are routed through here; session-level
+// events (Started/Stopped and friends) stay dynamic in every build.
+#ifdef AC_REPORT_STATIC_NULL
+#define AC_REPORT(statement) do {} while (0)
+#else
+#define AC_REPORT(statement) statement
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/report/logging/bufferqueuereport.h"
+
+namespace ac {
+namespace report {
+namespace logging {
+
+void BufferQueueReport::HighWaterMark(const std::string &queue_name, int depth) {
+    AC_TRACE("queue %s depth %d", queue_name.c_str(), depth);
+}
+
+void BufferQueueReport::Stalled(const std::string &queue_name, const ac::TimestampUs &duration) {
+    AC_TRACE("queue %s duration %lld", queue_name.c_str(), duration);
+}
+
+void BufferQueueReport::DroppedBuffer(const std::string &queue_name) {
+    // Drops were completely silent before and are the first thing to
+    // look for when a session glitches
+    AC_WARNING("queue %s dropped a buffer because it was full", queue_name.c_str());
+}
+
+} // namespace logging
+} // namespace report
+} // namespace ac
@@ -35,8 +35,8 @@ void EncoderReport::BeganFrame(const ac::TimestampUs &timestamp) {
     AC_TRACE("timestamp %lld", timestamp);
 }
 
-void EncoderReport::FinishedFrame(const ac::TimestampUs &timestamp) {
-    AC_TRACE("timestamp %lld", timestamp);
+void EncoderReport::FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    AC_TRACE("timestamp %lld frame %lld", timestamp, frame_id);
 }
 
 void EncoderReport::ReceivedInputBuffer(const ac::TimestampUs &timestamp) {
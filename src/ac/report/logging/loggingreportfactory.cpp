@@ -15,15 +15,25 @@
  *
  */
 
+#include "ac/logger.h"
+
 #include "ac/report/logging/loggingreportfactory.h"
 #include "ac/report/logging/encoderreport.h"
 #include "ac/report/logging/rendererreport.h"
 #include "ac/report/logging/packetizerreport.h"
 #include "ac/report/logging/senderreport.h"
+#include "ac/report/logging/bufferqueuereport.h"
+#include "ac/report/logging/connectionreport.h"
 
 namespace ac {
 namespace report {
 
+LoggingReportFactory::LoggingReportFactory() {
+    // Whoever opts into this backend wants to see the trace output no
+    // matter which threshold the service configured at startup.
+    ac::Log().SetThreshold(ac::Logger::Severity::kTrace);
+}
+
 std::shared_ptr<video::EncoderReport> LoggingReportFactory::CreateEncoderReport() {
     return std::make_shared<logging::EncoderReport>();
 }
@@ -40,5 +50,13 @@ std::shared_ptr<video::SenderReport> LoggingReportFactory::CreateSenderReport()
     return std::make_shared<logging::SenderReport>();
 }
 
+std::shared_ptr<video::BufferQueueReport> LoggingReportFactory::CreateBufferQueueReport() {
+    return std::make_shared<logging::BufferQueueReport>();
+}
+
+std::shared_ptr<ConnectionReport> LoggingReportFactory::CreateConnectionReport() {
+    return std::make_shared<logging::ConnectionReport>();
+}
+
 } // namespace report
 } // namespace ac
@@ -29,10 +29,14 @@ namespace report {
 
 class LoggingReportFactory : public ReportFactory {
 public:
+    LoggingReportFactory();
+
     std::shared_ptr<video::EncoderReport> CreateEncoderReport();
     std::shared_ptr<video::RendererReport> CreateRendererReport();
     std::shared_ptr<video::PacketizerReport> CreatePacketizerReport();
     std::shared_ptr<video::SenderReport> CreateSenderReport();
+    std::shared_ptr<video::BufferQueueReport> CreateBufferQueueReport();
+    std::shared_ptr<ConnectionReport> CreateConnectionReport();
 };
 
 } // namespace report
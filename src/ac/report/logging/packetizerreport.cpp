@@ -23,8 +23,8 @@ namespace ac {
 namespace report {
 namespace logging {
 
-void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp) {
-    AC_TRACE("timestamp %lld", timestamp);
+void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    AC_TRACE("timestamp %lld frame %lld", timestamp, frame_id);
 }
 
 } // namespace logging
@@ -31,7 +31,7 @@ namespace logging {
 
 class PacketizerReport : public video::PacketizerReport {
 public:
-     void PacketizedFrame(const ac::TimestampUs &timestamp);
+     void PacketizedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id);
 };
 
 } // namespace logging
@@ -26,8 +26,16 @@ namespace logging {
 void RendererReport::BeganFrame() {
 }
 
-void RendererReport::FinishedFrame(const TimestampUs &timestamp) {
-    AC_TRACE("timestamp %lld", timestamp);
+void RendererReport::FinishedFrame(const TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    AC_TRACE("timestamp %lld frame %lld", timestamp, frame_id);
+}
+
+void RendererReport::MissedFrameDeadline(const TimestampUs &deadline) {
+    AC_WARNING("Renderer missed frame deadline %lld", deadline);
+}
+
+void RendererReport::DroppedFrame(const TimestampUs &timestamp) {
+    AC_WARNING("Renderer dropped frame with timestamp %lld", timestamp);
 }
 
 } // namespace logging
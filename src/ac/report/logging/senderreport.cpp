@@ -15,16 +15,81 @@
  *
  */
 
+#include <algorithm>
+
 #include "ac/logger.h"
 
 #include "ac/report/logging/senderreport.h"
 
+namespace {
+// Upper bounds of the delay histogram buckets; the last bucket is
+// open-ended and catches everything at or above the highest bound.
+static constexpr int64_t kDelayBucketBoundsUs[] = {
+    1000, 2000, 5000, 10000, 20000, 50000
+};
+// How often a histogram summary goes to the log
+static constexpr int64_t kSummaryIntervalUs = 5 * 1000 * 1000;
+}
+
 namespace ac {
 namespace report {
 namespace logging {
 
-void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size) {
-    AC_TRACE("timestamp %lld size %d", timestamp, size);
+constexpr size_t SenderReport::kNumDelayBuckets;
+
+SenderReport::SenderReport() :
+    delay_buckets_{},
+    num_packets_(0),
+    total_delay_us_(0),
+    max_delay_us_(0),
+    last_summary_us_(0) {
+}
+
+void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id) {
+    AC_TRACE("timestamp %lld size %d frame %lld", timestamp, size, frame_id);
+
+    const auto now = static_cast<int64_t>(ac::Utils::GetNowUs());
+
+    // Packets which never got a queue timestamp (codec config data
+    // for example) carry nothing to measure.
+    const auto delay = now - timestamp;
+    if (timestamp <= 0 || delay < 0)
+        return;
+
+    size_t bucket = kNumDelayBuckets - 1;
+    for (size_t n = 0; n < kNumDelayBuckets - 1; n++) {
+        if (delay < kDelayBucketBoundsUs[n]) {
+            bucket = n;
+            break;
+        }
+    }
+
+    delay_buckets_[bucket]++;
+    num_packets_++;
+    total_delay_us_ += delay;
+    max_delay_us_ = std::max<int64_t>(max_delay_us_, delay);
+
+    if (last_summary_us_ == 0) {
+        last_summary_us_ = now;
+        return;
+    }
+
+    if (now - last_summary_us_ < kSummaryIntervalUs)
+        return;
+
+    AC_INFO("Queue-to-wire delay over %llu packets: mean %lld us max %lld us",
+            num_packets_, total_delay_us_ / static_cast<int64_t>(num_packets_),
+            max_delay_us_);
+    AC_INFO("  <1ms %llu <2ms %llu <5ms %llu <10ms %llu <20ms %llu <50ms %llu >=50ms %llu",
+            delay_buckets_[0], delay_buckets_[1], delay_buckets_[2],
+            delay_buckets_[3], delay_buckets_[4], delay_buckets_[5],
+            delay_buckets_[6]);
+
+    std::fill(delay_buckets_, delay_buckets_ + kNumDelayBuckets, 0);
+    num_packets_ = 0;
+    total_delay_us_ = 0;
+    max_delay_us_ = 0;
+    last_summary_us_ = now;
 }
 
 } // namespace logging
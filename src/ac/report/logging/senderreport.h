@@ -31,7 +31,21 @@ namespace logging {
 
 class SenderReport : public video::SenderReport {
 public:
-    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size);
+    SenderReport();
+
+    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id);
+
+private:
+    // Fixed-bucket histogram of the delay between a packet being
+    // queued (its buffer timestamp) and it hitting the wire; all
+    // fields are only touched from the sender thread. A summary is
+    // logged periodically and the counts restart.
+    static constexpr size_t kNumDelayBuckets{7};
+    uint64_t delay_buckets_[kNumDelayBuckets];
+    uint64_t num_packets_;
+    int64_t total_delay_us_;
+    int64_t max_delay_us_;
+    ac::TimestampUs last_summary_us_;
 };
 
 } // namespace logging
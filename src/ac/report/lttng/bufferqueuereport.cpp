@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/lttng/bufferqueuereport.h"
+
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#include "ac/report/lttng/bufferqueuereport_tp.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+void BufferQueueReport::HighWaterMark(const std::string &queue_name, int depth) {
+    ac_tracepoint(aethercast_bufferqueue, high_water_mark, queue_name.c_str(), depth);
+}
+
+void BufferQueueReport::Stalled(const std::string &queue_name, const ac::TimestampUs &duration) {
+    ac_tracepoint(aethercast_bufferqueue, stalled, queue_name.c_str(), duration);
+}
+
+void BufferQueueReport::DroppedBuffer(const std::string &queue_name) {
+    ac_tracepoint(aethercast_bufferqueue, dropped_buffer, queue_name.c_str());
+}
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
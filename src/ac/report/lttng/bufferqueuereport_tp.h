@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER aethercast_bufferqueue
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "ac/report/lttng/bufferqueuereport_tp.h"
+
+#if !defined(AC_REPORT_LTTNG_BUFFERQUEUEREPORT_TP_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define AC_REPORT_LTTNG_BUFFERQUEUEREPORT_TP_H_
+
+#include "ac/report/lttng/utils.h"
+
+AC_LTTNG_VOID_TRACE_CLASS(TRACEPOINT_PROVIDER)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    high_water_mark,
+    TP_ARGS(const char*, queue_name, int, depth),
+    TP_FIELDS(
+        ctf_string(queue_name, queue_name)
+        ctf_integer(int, depth, depth)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    stalled,
+    TP_ARGS(const char*, queue_name, int, duration),
+    TP_FIELDS(
+        ctf_string(queue_name, queue_name)
+        ctf_integer(int, duration, duration)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    dropped_buffer,
+    TP_ARGS(const char*, queue_name),
+    TP_FIELDS(
+        ctf_string(queue_name, queue_name)
+    )
+)
+
+#endif
+
+#include <lttng/tracepoint-event.h>
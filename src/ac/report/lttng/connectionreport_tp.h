@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER aethercast_connection
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "ac/report/lttng/connectionreport_tp.h"
+
+#if !defined(AC_REPORT_LTTNG_CONNECTIONREPORT_TP_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define AC_REPORT_LTTNG_CONNECTIONREPORT_TP_H_
+
+#include "ac/report/lttng/utils.h"
+
+AC_LTTNG_VOID_TRACE_CLASS(TRACEPOINT_PROVIDER)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    stage_reached,
+    TP_ARGS(const char*, stage, int, timestamp),
+    TP_FIELDS(
+        ctf_string(stage, stage)
+        ctf_integer(int, timestamp, timestamp)
+    )
+)
+
+#endif
+
+#include <lttng/tracepoint-event.h>
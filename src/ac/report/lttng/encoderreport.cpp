@@ -25,6 +25,10 @@ namespace ac {
 namespace report {
 namespace lttng {
 
+EncoderReport::EncoderReport(const FrameLifecycle::Ptr &lifecycle) :
+    lifecycle_(lifecycle) {
+}
+
 void EncoderReport::Started() {
     ac_tracepoint(aethercast_encoder, started, 0);
 }
@@ -37,8 +41,9 @@ void EncoderReport::BeganFrame(const ac::TimestampUs &timestamp) {
     ac_tracepoint(aethercast_encoder, began_frame, timestamp);
 }
 
-void EncoderReport::FinishedFrame(const ac::TimestampUs &timestamp) {
-    ac_tracepoint(aethercast_encoder, finished_frame, timestamp);
+void EncoderReport::FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    ac_tracepoint(aethercast_encoder, finished_frame, timestamp, frame_id);
+    lifecycle_->Encoded(frame_id, timestamp);
 }
 
 void EncoderReport::ReceivedInputBuffer(const ac::TimestampUs &timestamp) {
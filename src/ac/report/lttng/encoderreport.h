@@ -24,6 +24,7 @@
 
 #include "ac/video/encoderreport.h"
 
+#include "ac/report/lttng/framelifecycle.h"
 #include "ac/report/lttng/tracepointprovider.h"
 
 namespace ac {
@@ -32,14 +33,17 @@ namespace lttng {
 
 class EncoderReport : public video::EncoderReport {
 public:
+    explicit EncoderReport(const FrameLifecycle::Ptr &lifecycle);
+
     void Started();
     void Stopped();
     void BeganFrame(const ac::TimestampUs &timestamp);
-    void FinishedFrame(const ac::TimestampUs &timestamp);
+    void FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id);
     void ReceivedInputBuffer(const ac::TimestampUs &timestamp);
 
 private:
     TracepointProvider tp_;
+    FrameLifecycle::Ptr lifecycle_;
 };
 
 } // namespace lttng
@@ -45,9 +45,10 @@ TRACEPOINT_EVENT(
 TRACEPOINT_EVENT(
     TRACEPOINT_PROVIDER,
     finished_frame,
-    TP_ARGS(int, timestamp),
+    TP_ARGS(int, timestamp, int, frame_id),
     TP_FIELDS(
         ctf_integer(int, timestamp, timestamp)
+        ctf_integer(int, frame_id, frame_id)
     )
 )
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <limits>
+
+#include "ac/report/lttng/framelifecycle.h"
+
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#include "ac/report/lttng/framelifecycle_tp.h"
+
+namespace {
+// Marks a slot which currently tracks no frame
+constexpr ac::FrameId kInvalidFrameId{std::numeric_limits<ac::FrameId>::max()};
+}
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+constexpr std::size_t FrameLifecycle::kNumSlots;
+
+FrameLifecycle::FrameLifecycle() :
+    last_sent_frame_(kInvalidFrameId) {
+    for (auto &entry : slots_) {
+        entry = Entry{};
+        entry.frame_id = kInvalidFrameId;
+    }
+}
+
+FrameLifecycle::~FrameLifecycle() {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto &entry : slots_)
+        Flush(entry);
+}
+
+void FrameLifecycle::Rendered(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp) {
+    std::lock_guard<std::mutex> lock(lock_);
+    SlotFor(frame_id).rendered_us = timestamp;
+}
+
+void FrameLifecycle::Encoded(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp) {
+    std::lock_guard<std::mutex> lock(lock_);
+    SlotFor(frame_id).encoded_us = timestamp;
+}
+
+void FrameLifecycle::Packetized(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp) {
+    std::lock_guard<std::mutex> lock(lock_);
+    SlotFor(frame_id).packetized_us = timestamp;
+}
+
+void FrameLifecycle::Sent(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp, const std::uint32_t &size) {
+    std::lock_guard<std::mutex> lock(lock_);
+
+    // Retransmissions can momentarily step back to an earlier frame
+    // whose record may already be flushed; only account the packet if
+    // the slot still tracks that frame.
+    if (last_sent_frame_ != kInvalidFrameId && frame_id < last_sent_frame_) {
+        auto &entry = slots_[frame_id % kNumSlots];
+        if (entry.frame_id != frame_id)
+            return;
+        entry.last_sent_us = timestamp;
+        entry.bytes_sent += size;
+        entry.packets_sent++;
+        return;
+    }
+
+    // The sender moved on to a later frame which retires the previous
+    // one; its consolidated record is complete now.
+    if (last_sent_frame_ != kInvalidFrameId && frame_id != last_sent_frame_) {
+        auto &done = slots_[last_sent_frame_ % kNumSlots];
+        if (done.frame_id == last_sent_frame_)
+            Flush(done);
+    }
+    last_sent_frame_ = frame_id;
+
+    auto &entry = SlotFor(frame_id);
+    if (entry.packets_sent == 0)
+        entry.first_sent_us = timestamp;
+    entry.last_sent_us = timestamp;
+    entry.bytes_sent += size;
+    entry.packets_sent++;
+}
+
+FrameLifecycle::Entry& FrameLifecycle::SlotFor(const ac::FrameId &frame_id) {
+    auto &entry = slots_[frame_id % kNumSlots];
+    if (entry.frame_id != frame_id) {
+        // The slot still holds a frame which never reached the sender
+        // (dropped somewhere along the pipeline); emit what we know
+        // about it before reusing the slot.
+        Flush(entry);
+        entry.frame_id = frame_id;
+    }
+    return entry;
+}
+
+void FrameLifecycle::Flush(Entry &entry) {
+    if (entry.frame_id == kInvalidFrameId)
+        return;
+
+    ac_tracepoint(aethercast_frame, lifecycle, entry.frame_id,
+                  entry.rendered_us, entry.encoded_us, entry.packetized_us,
+                  entry.first_sent_us, entry.last_sent_us,
+                  entry.bytes_sent, entry.packets_sent);
+
+    entry = Entry{};
+    entry.frame_id = kInvalidFrameId;
+}
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
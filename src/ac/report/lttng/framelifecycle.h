@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_LTTNG_FRAMELIFECYCLE_H_
+#define AC_REPORT_LTTNG_FRAMELIFECYCLE_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+// Correlates the per-component report callbacks into one consolidated
+// aethercast_frame:lifecycle tracepoint per frame. The record carries
+// the stage timestamps and send totals so offline analysis is a linear
+// scan over one event stream instead of a join across the renderer,
+// encoder, packetizer and sender providers. A frame's record is
+// emitted once the sender moves on to a later frame; the individual
+// per-component tracepoints keep firing unchanged.
+class FrameLifecycle : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<FrameLifecycle> Ptr;
+
+    FrameLifecycle();
+    ~FrameLifecycle();
+
+    void Rendered(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp);
+    void Encoded(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp);
+    void Packetized(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp);
+    void Sent(const ac::FrameId &frame_id, const ac::TimestampUs &timestamp, const std::uint32_t &size);
+
+private:
+    struct Entry {
+        ac::FrameId frame_id;
+        ac::TimestampUs rendered_us;
+        ac::TimestampUs encoded_us;
+        ac::TimestampUs packetized_us;
+        ac::TimestampUs first_sent_us;
+        ac::TimestampUs last_sent_us;
+        std::uint32_t bytes_sent;
+        std::uint32_t packets_sent;
+    };
+
+    // Enough slots to cover every frame that can be in flight between
+    // the renderer and the sender at once.
+    static constexpr std::size_t kNumSlots{32};
+
+    // Both helpers expect lock_ to be held by the caller.
+    Entry& SlotFor(const ac::FrameId &frame_id);
+    void Flush(Entry &entry);
+
+private:
+    std::mutex lock_;
+    std::array<Entry, kNumSlots> slots_;
+    ac::FrameId last_sent_frame_;
+};
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
+
+#endif
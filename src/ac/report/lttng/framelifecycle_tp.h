@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER aethercast_frame
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "ac/report/lttng/framelifecycle_tp.h"
+
+#if !defined(AC_REPORT_LTTNG_FRAMELIFECYCLE_TP_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define AC_REPORT_LTTNG_FRAMELIFECYCLE_TP_H_
+
+#include "ac/report/lttng/utils.h"
+
+/* One consolidated record per frame carrying all stage timestamps so
+ * offline consumers can do a linear scan instead of joining the
+ * per-component events on frame_id. */
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    lifecycle,
+    TP_ARGS(uint64_t, frame_id, int64_t, rendered_us, int64_t, encoded_us,
+            int64_t, packetized_us, int64_t, first_sent_us, int64_t, last_sent_us,
+            uint32_t, bytes_sent, uint32_t, packets_sent),
+    TP_FIELDS(
+        ctf_integer(uint64_t, frame_id, frame_id)
+        ctf_integer(int64_t, rendered_us, rendered_us)
+        ctf_integer(int64_t, encoded_us, encoded_us)
+        ctf_integer(int64_t, packetized_us, packetized_us)
+        ctf_integer(int64_t, first_sent_us, first_sent_us)
+        ctf_integer(int64_t, last_sent_us, last_sent_us)
+        ctf_integer(uint32_t, bytes_sent, bytes_sent)
+        ctf_integer(uint32_t, packets_sent, packets_sent)
+    )
+)
+
+#endif
+
+#include <lttng/tracepoint-event.h>
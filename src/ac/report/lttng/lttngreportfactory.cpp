@@ -20,24 +20,38 @@
 #include "ac/report/lttng/rendererreport.h"
 #include "ac/report/lttng/packetizerreport.h"
 #include "ac/report/lttng/senderreport.h"
+#include "ac/report/lttng/bufferqueuereport.h"
+#include "ac/report/lttng/connectionreport.h"
 
 namespace ac {
 namespace report {
 
+LttngReportFactory::LttngReportFactory() :
+    lifecycle_(std::make_shared<lttng::FrameLifecycle>()) {
+}
+
 std::shared_ptr<video::EncoderReport> LttngReportFactory::CreateEncoderReport() {
-    return std::make_shared<lttng::EncoderReport>();
+    return std::make_shared<lttng::EncoderReport>(lifecycle_);
 }
 
 std::shared_ptr<video::RendererReport> LttngReportFactory::CreateRendererReport() {
-    return std::make_shared<lttng::RendererReport>();
+    return std::make_shared<lttng::RendererReport>(lifecycle_);
 }
 
 std::shared_ptr<video::PacketizerReport> LttngReportFactory::CreatePacketizerReport() {
-    return std::make_shared<lttng::PacketizerReport>();
+    return std::make_shared<lttng::PacketizerReport>(lifecycle_);
 }
 
 std::shared_ptr<video::SenderReport> LttngReportFactory::CreateSenderReport() {
-    return std::make_shared<lttng::SenderReport>();
+    return std::make_shared<lttng::SenderReport>(lifecycle_);
+}
+
+std::shared_ptr<video::BufferQueueReport> LttngReportFactory::CreateBufferQueueReport() {
+    return std::make_shared<lttng::BufferQueueReport>();
+}
+
+std::shared_ptr<ConnectionReport> LttngReportFactory::CreateConnectionReport() {
+    return std::make_shared<lttng::ConnectionReport>();
 }
 
 } // namespace report
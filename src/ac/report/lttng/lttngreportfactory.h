@@ -24,15 +24,26 @@
 
 #include "ac/report/reportfactory.h"
 
+#include "ac/report/lttng/framelifecycle.h"
+
 namespace ac {
 namespace report {
 
 class LttngReportFactory : public ReportFactory {
 public:
+    LttngReportFactory();
+
     std::shared_ptr<video::EncoderReport> CreateEncoderReport();
     std::shared_ptr<video::RendererReport> CreateRendererReport();
     std::shared_ptr<video::PacketizerReport> CreatePacketizerReport();
     std::shared_ptr<video::SenderReport> CreateSenderReport();
+    std::shared_ptr<video::BufferQueueReport> CreateBufferQueueReport();
+    std::shared_ptr<ConnectionReport> CreateConnectionReport();
+
+private:
+    // Shared between all per-component reports so their callbacks end
+    // up in one consolidated per-frame lifecycle event.
+    lttng::FrameLifecycle::Ptr lifecycle_;
 };
 
 } // namespace report
@@ -25,8 +25,13 @@ namespace ac {
 namespace report {
 namespace lttng {
 
-void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp) {
-    ac_tracepoint(aethercast_packetizer, packetized_frame, timestamp);
+PacketizerReport::PacketizerReport(const FrameLifecycle::Ptr &lifecycle) :
+    lifecycle_(lifecycle) {
+}
+
+void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    ac_tracepoint(aethercast_packetizer, packetized_frame, timestamp, frame_id);
+    lifecycle_->Packetized(frame_id, timestamp);
 }
 
 } // namespace lttng
@@ -25,13 +25,20 @@
 
 #include "ac/video/packetizerreport.h"
 
+#include "ac/report/lttng/framelifecycle.h"
+
 namespace ac {
 namespace report {
 namespace lttng {
 
 class PacketizerReport : public video::PacketizerReport {
 public:
-     void PacketizedFrame(const ac::TimestampUs &timestamp);
+     explicit PacketizerReport(const FrameLifecycle::Ptr &lifecycle);
+
+     void PacketizedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id);
+
+private:
+     FrameLifecycle::Ptr lifecycle_;
 };
 
 } // namespace lttng
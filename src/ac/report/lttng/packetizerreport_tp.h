@@ -33,9 +33,10 @@ AC_LTTNG_VOID_TRACE_CLASS(TRACEPOINT_PROVIDER)
 TRACEPOINT_EVENT(
     TRACEPOINT_PROVIDER,
     packetized_frame,
-    TP_ARGS(int, timestamp),
+    TP_ARGS(int, timestamp, int, frame_id),
     TP_FIELDS(
         ctf_integer(int, timestamp, timestamp)
+        ctf_integer(int, frame_id, frame_id)
     )
 )
 
@@ -25,12 +25,25 @@ namespace ac {
 namespace report {
 namespace lttng {
 
+RendererReport::RendererReport(const FrameLifecycle::Ptr &lifecycle) :
+    lifecycle_(lifecycle) {
+}
+
 void RendererReport::BeganFrame() {
     ac_tracepoint(aethercast_renderer, began_frame, 0);
 }
 
-void RendererReport::FinishedFrame(const TimestampUs &timestamp) {
-    ac_tracepoint(aethercast_renderer, finished_frame, timestamp);
+void RendererReport::FinishedFrame(const TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    ac_tracepoint(aethercast_renderer, finished_frame, timestamp, frame_id);
+    lifecycle_->Rendered(frame_id, timestamp);
+}
+
+void RendererReport::MissedFrameDeadline(const TimestampUs &deadline) {
+    ac_tracepoint(aethercast_renderer, missed_frame_deadline, deadline);
+}
+
+void RendererReport::DroppedFrame(const TimestampUs &timestamp) {
+    ac_tracepoint(aethercast_renderer, dropped_frame, timestamp);
 }
 
 } // namespace lttng
@@ -25,14 +25,23 @@
 
 #include "ac/video/rendererreport.h"
 
+#include "ac/report/lttng/framelifecycle.h"
+
 namespace ac {
 namespace report {
 namespace lttng {
 
 class RendererReport : public video::RendererReport {
 public:
+     explicit RendererReport(const FrameLifecycle::Ptr &lifecycle);
+
      void BeganFrame();
-     void FinishedFrame(const ac::TimestampUs &timestamp);
+     void FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id);
+     void MissedFrameDeadline(const ac::TimestampUs &deadline);
+     void DroppedFrame(const ac::TimestampUs &timestamp);
+
+private:
+     FrameLifecycle::Ptr lifecycle_;
 };
 
 } // namespace lttng
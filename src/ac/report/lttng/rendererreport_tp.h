@@ -35,6 +35,25 @@ ENCODER_TRACE_POINT(began_frame)
 TRACEPOINT_EVENT(
     TRACEPOINT_PROVIDER,
     finished_frame,
+    TP_ARGS(int, timestamp, int, frame_id),
+    TP_FIELDS(
+        ctf_integer(int, timestamp, timestamp)
+        ctf_integer(int, frame_id, frame_id)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    missed_frame_deadline,
+    TP_ARGS(int, deadline),
+    TP_FIELDS(
+        ctf_integer(int, deadline, deadline)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    dropped_frame,
     TP_ARGS(int, timestamp),
     TP_FIELDS(
         ctf_integer(int, timestamp, timestamp)
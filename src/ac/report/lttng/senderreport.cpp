@@ -25,8 +25,13 @@ namespace ac {
 namespace report {
 namespace lttng {
 
-void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size) {
-    ac_tracepoint(aethercast_sender, sent_packet, timestamp, size);
+SenderReport::SenderReport(const FrameLifecycle::Ptr &lifecycle) :
+    lifecycle_(lifecycle) {
+}
+
+void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id) {
+    ac_tracepoint(aethercast_sender, sent_packet, timestamp, size, frame_id);
+    lifecycle_->Sent(frame_id, timestamp, size);
 }
 
 } // namespace lttng
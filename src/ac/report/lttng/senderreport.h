@@ -25,13 +25,20 @@
 
 #include "ac/video/senderreport.h"
 
+#include "ac/report/lttng/framelifecycle.h"
+
 namespace ac {
 namespace report {
 namespace lttng {
 
 class SenderReport : public video::SenderReport {
 public:
-    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size);
+    explicit SenderReport(const FrameLifecycle::Ptr &lifecycle);
+
+    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id);
+
+private:
+    FrameLifecycle::Ptr lifecycle_;
 };
 
 } // namespace lttng
@@ -33,10 +33,11 @@ AC_LTTNG_VOID_TRACE_CLASS(TRACEPOINT_PROVIDER)
 TRACEPOINT_EVENT(
     TRACEPOINT_PROVIDER,
     sent_packet,
-    TP_ARGS(int, timestamp, int, size),
+    TP_ARGS(int, timestamp, int, size, int, frame_id),
     TP_FIELDS(
         ctf_integer(int, timestamp, timestamp)
         ctf_integer(int, size, size)
+        ctf_integer(int, frame_id, frame_id)
     )
 )
 
@@ -21,3 +21,6 @@
 #include "rendererreport_tp.h"
 #include "packetizerreport_tp.h"
 #include "senderreport_tp.h"
+#include "bufferqueuereport_tp.h"
+#include "connectionreport_tp.h"
+#include "framelifecycle_tp.h"
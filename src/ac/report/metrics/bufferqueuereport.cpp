@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/metrics/bufferqueuereport.h"
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+void BufferQueueReport::HighWaterMark(const std::string &queue_name, int depth) {
+    MetricsRegistry::Instance().UpdateMax("queue_" + queue_name + "_max_depth",
+                                          static_cast<std::uint64_t>(depth));
+}
+
+void BufferQueueReport::Stalled(const std::string &queue_name, const ac::TimestampUs &duration) {
+    auto &registry = MetricsRegistry::Instance();
+    registry.Increment("queue_" + queue_name + "_stalls");
+    registry.RecordLatency("queue_" + queue_name + "_stall_time",
+                           static_cast<std::uint64_t>(duration));
+}
+
+void BufferQueueReport::DroppedBuffer(const std::string &queue_name) {
+    MetricsRegistry::Instance().Increment("queue_" + queue_name + "_drops");
+}
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/concept_check.hpp>
+
+#include "ac/report/metrics/connectionreport.h"
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+void ConnectionReport::StageReached(const std::string &stage, const ac::TimestampUs &timestamp) {
+    boost::ignore_unused_variable_warning(timestamp);
+
+    // Every milestone is countable by name; the ones below additionally
+    // feed the success/failure totals the fleet dashboards key on.
+    auto &registry = MetricsRegistry::Instance();
+    registry.Increment("connection_stage_" + stage);
+
+    if (stage == "connect-requested")
+        registry.Increment("connect_attempts");
+    else if (stage == "rtsp-session-established")
+        registry.Increment("connects_established");
+    else if (stage == "failed")
+        registry.Increment("connect_failures");
+}
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace {
+unsigned int BucketForValue(std::uint64_t value_us) {
+    unsigned int bucket = 0;
+    while (value_us > 1 && bucket < 25) {
+        value_us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+} // namespace
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+MetricsRegistry& MetricsRegistry::Instance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+void MetricsRegistry::Histogram::Record(std::uint64_t value_us) {
+    count++;
+    buckets[BucketForValue(value_us)]++;
+}
+
+std::uint64_t MetricsRegistry::Histogram::Percentile(double percentile) const {
+    if (count == 0)
+        return 0;
+
+    const auto rank = static_cast<std::uint64_t>(percentile * count + 0.5);
+
+    std::uint64_t seen = 0;
+    for (unsigned int n = 0; n < buckets.size(); n++) {
+        seen += buckets[n];
+        if (seen >= rank)
+            // Upper bound of the bucket the requested rank falls in
+            return 1ull << (n + 1);
+    }
+
+    return 1ull << buckets.size();
+}
+
+void MetricsRegistry::Increment(const std::string &counter, std::uint64_t delta) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_[counter] += delta;
+}
+
+void MetricsRegistry::UpdateMax(const std::string &counter, std::uint64_t value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_[counter] = std::max(counters_[counter], value);
+}
+
+void MetricsRegistry::SetGauge(const std::string &gauge, std::uint64_t value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gauges_[gauge] = value;
+}
+
+void MetricsRegistry::RecordLatency(const std::string &histogram, std::uint64_t value_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    histograms_[histogram].Record(value_us);
+}
+
+std::map<std::string, std::uint64_t> MetricsRegistry::Snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::map<std::string, std::uint64_t> snapshot;
+
+    for (auto iter : counters_)
+        snapshot[iter.first] = iter.second;
+
+    for (auto iter : gauges_)
+        snapshot[iter.first] = iter.second;
+
+    for (auto iter : histograms_) {
+        snapshot[iter.first + "_count"] = iter.second.count;
+        snapshot[iter.first + "_p50_us"] = iter.second.Percentile(0.5);
+        snapshot[iter.first + "_p90_us"] = iter.second.Percentile(0.9);
+        snapshot[iter.first + "_p99_us"] = iter.second.Percentile(0.99);
+    }
+
+    return snapshot;
+}
+
+std::string MetricsRegistry::SnapshotText() const {
+    std::stringstream output;
+
+    for (auto iter : Snapshot())
+        output << iter.first << " " << iter.second << std::endl;
+
+    return output.str();
+}
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
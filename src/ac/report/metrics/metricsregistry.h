@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_METRICS_METRICSREGISTRY_H_
+#define AC_REPORT_METRICS_METRICSREGISTRY_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+// Process wide home of the live numbers the metrics report backend
+// produces. Counters, gauges and latency histograms are kept by name;
+// a snapshot flattens everything into name/value pairs with
+// p50/p90/p99 entries derived per histogram, ready to hand to the
+// D-Bus method or the scrape socket.
+class MetricsRegistry : public ac::NonCopyable {
+public:
+    static MetricsRegistry& Instance();
+
+    void Increment(const std::string &counter, std::uint64_t delta = 1);
+    void UpdateMax(const std::string &counter, std::uint64_t value);
+    // Last-value-wins; for numbers which already arrive aggregated
+    // (like RTCP feedback) where counting increments makes no sense.
+    void SetGauge(const std::string &gauge, std::uint64_t value);
+    void RecordLatency(const std::string &histogram, std::uint64_t value_us);
+
+    std::map<std::string, std::uint64_t> Snapshot() const;
+    // Snapshot as "name value" lines for text based consumers
+    std::string SnapshotText() const;
+
+private:
+    // Power-of-two microsecond buckets; the last one collects
+    // everything from ~half a minute upwards.
+    static constexpr unsigned int kNumBuckets{26};
+
+    struct Histogram {
+        std::uint64_t count{0};
+        std::array<std::uint64_t, kNumBuckets> buckets{};
+
+        void Record(std::uint64_t value_us);
+        std::uint64_t Percentile(double percentile) const;
+    };
+
+    MetricsRegistry() = default;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::uint64_t> counters_;
+    std::unordered_map<std::string, std::uint64_t> gauges_;
+    std::unordered_map<std::string, Histogram> histograms_;
+};
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/metrics/metricsreportfactory.h"
+#include "ac/report/metrics/metricssocket.h"
+#include "ac/report/metrics/encoderreport.h"
+#include "ac/report/metrics/rendererreport.h"
+#include "ac/report/metrics/packetizerreport.h"
+#include "ac/report/metrics/senderreport.h"
+#include "ac/report/metrics/bufferqueuereport.h"
+#include "ac/report/metrics/connectionreport.h"
+
+namespace ac {
+namespace report {
+
+MetricsReportFactory::MetricsReportFactory() {
+    metrics::MetricsSocket::Start();
+}
+
+std::shared_ptr<video::EncoderReport> MetricsReportFactory::CreateEncoderReport() {
+    return std::make_shared<metrics::EncoderReport>();
+}
+
+std::shared_ptr<video::RendererReport> MetricsReportFactory::CreateRendererReport() {
+    return std::make_shared<metrics::RendererReport>();
+}
+
+std::shared_ptr<video::PacketizerReport> MetricsReportFactory::CreatePacketizerReport() {
+    return std::make_shared<metrics::PacketizerReport>();
+}
+
+std::shared_ptr<video::SenderReport> MetricsReportFactory::CreateSenderReport() {
+    return std::make_shared<metrics::SenderReport>();
+}
+
+std::shared_ptr<video::BufferQueueReport> MetricsReportFactory::CreateBufferQueueReport() {
+    return std::make_shared<metrics::BufferQueueReport>();
+}
+
+std::shared_ptr<ConnectionReport> MetricsReportFactory::CreateConnectionReport() {
+    return std::make_shared<metrics::ConnectionReport>();
+}
+
+} // namespace report
+} // namespace ac
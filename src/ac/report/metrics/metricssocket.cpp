@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "ac/config.h"
+#include "ac/logger.h"
+
+#include "ac/report/metrics/metricssocket.h"
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace {
+static const std::string kSocketPath{std::string(ac::kRuntimePath) + "/metrics"};
+} // namespace
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+void MetricsSocket::Start() {
+    static int listen_fd = -1;
+    if (listen_fd >= 0)
+        return;
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        AC_ERROR("Failed to create metrics socket: %s", std::strerror(errno));
+        return;
+    }
+
+    struct sockaddr_un addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ::strncpy(addr.sun_path, kSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    // A previous run may have left its socket file behind
+    ::unlink(kSocketPath.c_str());
+
+    if (::bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd, 4) < 0) {
+        AC_ERROR("Failed to bind metrics socket at %s: %s",
+                 kSocketPath, std::strerror(errno));
+        ::close(listen_fd);
+        listen_fd = -1;
+        return;
+    }
+
+    auto channel = g_io_channel_unix_new(listen_fd);
+    g_io_add_watch(channel, GIOCondition(G_IO_IN),
+                   &MetricsSocket::OnIncomingConnection, nullptr);
+    g_io_channel_unref(channel);
+
+    AC_DEBUG("Serving metrics snapshots at %s", kSocketPath);
+}
+
+gboolean MetricsSocket::OnIncomingConnection(GIOChannel *channel, GIOCondition condition, gpointer user_data) {
+    if (!(condition & G_IO_IN))
+        return TRUE;
+
+    const int fd = ::accept(g_io_channel_unix_get_fd(channel), nullptr, nullptr);
+    if (fd < 0)
+        return TRUE;
+
+    // One snapshot per connection keeps the protocol trivial for
+    // scrapers: connect, read until EOF, done.
+    const auto snapshot = MetricsRegistry::Instance().SnapshotText();
+
+    size_t written = 0;
+    while (written < snapshot.length()) {
+        const auto n = ::write(fd, snapshot.data() + written, snapshot.length() - written);
+        if (n <= 0)
+            break;
+        written += n;
+    }
+
+    ::close(fd);
+
+    return TRUE;
+}
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
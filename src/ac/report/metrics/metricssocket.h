@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_METRICS_METRICSSOCKET_H_
+#define AC_REPORT_METRICS_METRICSSOCKET_H_
+
+#include "ac/glib_wrapper.h"
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+// Listens on a unix socket below the runtime directory and answers
+// every connection with a text snapshot of the metrics registry, so
+// fleet tooling can scrape live numbers without talking D-Bus.
+class MetricsSocket : public ac::NonCopyable {
+public:
+    // Brings the listener up once; subsequent calls are no-ops.
+    static void Start();
+
+private:
+    static gboolean OnIncomingConnection(GIOChannel *channel, GIOCondition condition, gpointer user_data);
+};
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/concept_check.hpp>
+
+#include "ac/utils.h"
+
+#include "ac/report/metrics/rendererreport.h"
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+void RendererReport::BeganFrame() {
+}
+
+void RendererReport::FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    boost::ignore_unused_variable_warning(frame_id);
+    auto &registry = MetricsRegistry::Instance();
+    registry.Increment("frames_rendered");
+    registry.RecordLatency("render_latency",
+                           static_cast<std::uint64_t>(Utils::GetNowUs()) - timestamp);
+}
+
+void RendererReport::MissedFrameDeadline(const ac::TimestampUs &deadline) {
+    boost::ignore_unused_variable_warning(deadline);
+    MetricsRegistry::Instance().Increment("render_deadline_misses");
+}
+
+void RendererReport::DroppedFrame(const ac::TimestampUs &timestamp) {
+    boost::ignore_unused_variable_warning(timestamp);
+    MetricsRegistry::Instance().Increment("frames_dropped");
+}
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/concept_check.hpp>
+
+#include "ac/utils.h"
+
+#include "ac/report/metrics/senderreport.h"
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace ac {
+namespace report {
+namespace metrics {
+
+void SenderReport::SentPacket(const ac::TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id) {
+    boost::ignore_unused_variable_warning(frame_id);
+    auto &registry = MetricsRegistry::Instance();
+    registry.Increment("packets_sent");
+    registry.Increment("bytes_sent", size);
+    registry.RecordLatency("send_latency",
+                           static_cast<std::uint64_t>(Utils::GetNowUs()) - timestamp);
+}
+
+} // namespace metrics
+} // namespace report
+} // namespace ac
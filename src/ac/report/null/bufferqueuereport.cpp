@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/concept_check.hpp>
+
+#include "ac/report/null/bufferqueuereport.h"
+
+namespace ac {
+namespace report {
+namespace null {
+
+void BufferQueueReport::HighWaterMark(const std::string &queue_name, int depth) {
+    boost::ignore_unused_variable_warning(queue_name);
+    boost::ignore_unused_variable_warning(depth);
+}
+
+void BufferQueueReport::Stalled(const std::string &queue_name, const ac::TimestampUs &duration) {
+    boost::ignore_unused_variable_warning(queue_name);
+    boost::ignore_unused_variable_warning(duration);
+}
+
+void BufferQueueReport::DroppedBuffer(const std::string &queue_name) {
+    boost::ignore_unused_variable_warning(queue_name);
+}
+
+} // namespace null
+} // namespace report
+} // namespace ac
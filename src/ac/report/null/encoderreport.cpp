@@ -33,8 +33,9 @@ void EncoderReport::BeganFrame(const ac::TimestampUs &timestamp) {
     boost::ignore_unused_variable_warning(timestamp);
 }
 
-void EncoderReport::FinishedFrame(const ac::TimestampUs &timestamp) {
+void EncoderReport::FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id) {
     boost::ignore_unused_variable_warning(timestamp);
+    boost::ignore_unused_variable_warning(frame_id);
 }
 
 void EncoderReport::ReceivedInputBuffer(const ac::TimestampUs &timestamp) {
@@ -33,7 +33,7 @@ public:
     void Started();
     void Stopped();
     void BeganFrame(const ac::TimestampUs &timestamp);
-    void FinishedFrame(const ac::TimestampUs &timestamp);
+    void FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id);
     void ReceivedInputBuffer(const ac::TimestampUs &timestamp);
 };
 
@@ -20,6 +20,8 @@
 #include "ac/report/null/rendererreport.h"
 #include "ac/report/null/packetizerreport.h"
 #include "ac/report/null/senderreport.h"
+#include "ac/report/null/bufferqueuereport.h"
+#include "ac/report/null/connectionreport.h"
 
 namespace ac {
 namespace report {
@@ -40,5 +42,13 @@ std::shared_ptr<video::SenderReport> NullReportFactory::CreateSenderReport() {
     return std::make_shared<null::SenderReport>();
 }
 
+std::shared_ptr<video::BufferQueueReport> NullReportFactory::CreateBufferQueueReport() {
+    return std::make_shared<null::BufferQueueReport>();
+}
+
+std::shared_ptr<ConnectionReport> NullReportFactory::CreateConnectionReport() {
+    return std::make_shared<null::ConnectionReport>();
+}
+
 } // namespace report
 } // namespace ac
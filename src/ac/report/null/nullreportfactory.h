@@ -33,6 +33,8 @@ public:
     std::shared_ptr<video::RendererReport> CreateRendererReport();
     std::shared_ptr<video::PacketizerReport> CreatePacketizerReport();
     std::shared_ptr<video::SenderReport> CreateSenderReport();
+    std::shared_ptr<video::BufferQueueReport> CreateBufferQueueReport();
+    std::shared_ptr<ConnectionReport> CreateConnectionReport();
 };
 
 } // namespace report
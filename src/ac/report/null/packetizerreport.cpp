@@ -23,8 +23,9 @@ namespace ac {
 namespace report {
 namespace null {
 
-void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp) {
+void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp, const ac::FrameId &frame_id) {
     boost::ignore_unused_variable_warning(timestamp);
+    boost::ignore_unused_variable_warning(frame_id);
 }
 
 } // namespace null
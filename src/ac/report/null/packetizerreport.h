@@ -31,7 +31,7 @@ namespace null {
 
 class PacketizerReport : public video::PacketizerReport {
 public:
-     void PacketizedFrame(const ac::TimestampUs &timestamp);
+     void PacketizedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id);
 };
 
 } // namespace null
@@ -26,7 +26,16 @@ namespace null {
 void RendererReport::BeganFrame() {
 }
 
-void RendererReport::FinishedFrame(const TimestampUs &timestamp) {
+void RendererReport::FinishedFrame(const TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    boost::ignore_unused_variable_warning(timestamp);
+    boost::ignore_unused_variable_warning(frame_id);
+}
+
+void RendererReport::MissedFrameDeadline(const TimestampUs &deadline) {
+    boost::ignore_unused_variable_warning(deadline);
+}
+
+void RendererReport::DroppedFrame(const TimestampUs &timestamp) {
     boost::ignore_unused_variable_warning(timestamp);
 }
 
@@ -32,7 +32,9 @@ namespace null {
 class RendererReport : public video::RendererReport {
 public:
      void BeganFrame();
-     void FinishedFrame(const ac::TimestampUs &timestamp);
+     void FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id);
+     void MissedFrameDeadline(const ac::TimestampUs &deadline);
+     void DroppedFrame(const ac::TimestampUs &timestamp);
 };
 
 } // namespace null
@@ -25,9 +25,10 @@ namespace ac {
 namespace report {
 namespace null {
 
-void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size) {
+void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id) {
     boost::ignore_unused_variable_warning(timestamp);
     boost::ignore_unused_variable_warning(size);
+    boost::ignore_unused_variable_warning(frame_id);
 }
 
 } // namespace null
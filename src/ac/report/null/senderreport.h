@@ -31,7 +31,7 @@ namespace null {
 
 class SenderReport : public video::SenderReport {
 public:
-    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size);
+    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id);
 };
 
 } // namespace null
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/recorder/bufferqueuereport.h"
+#include "ac/report/recorder/eventrecorder.h"
+
+namespace ac {
+namespace report {
+namespace recorder {
+
+// Queue events are rare compared to frame events so the name lookup
+// below staying off the lock-free fast path is fine.
+
+void BufferQueueReport::HighWaterMark(const std::string &name, int depth) {
+    auto &recorder = EventRecorder::Instance();
+    recorder.Record(EventRecorder::Event::kBufferQueueHighWaterMark,
+                    recorder.ChannelForName(name), static_cast<std::uint32_t>(depth), 0);
+}
+
+void BufferQueueReport::Stalled(const std::string &name, const ac::TimestampUs &duration) {
+    auto &recorder = EventRecorder::Instance();
+    recorder.Record(EventRecorder::Event::kBufferQueueStalled,
+                    recorder.ChannelForName(name), 0, duration);
+}
+
+void BufferQueueReport::DroppedBuffer(const std::string &name) {
+    auto &recorder = EventRecorder::Instance();
+    recorder.Record(EventRecorder::Event::kBufferQueueDroppedBuffer,
+                    recorder.ChannelForName(name), 0, 0);
+}
+
+} // namespace recorder
+} // namespace report
+} // namespace ac
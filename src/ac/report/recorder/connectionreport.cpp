@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/recorder/connectionreport.h"
+#include "ac/report/recorder/eventrecorder.h"
+
+namespace ac {
+namespace report {
+namespace recorder {
+
+void ConnectionReport::StageReached(const std::string &stage, const ac::TimestampUs &timestamp) {
+    auto &recorder = EventRecorder::Instance();
+    recorder.Record(EventRecorder::Event::kConnectionStageReached,
+                    recorder.ChannelForName(stage), 0, timestamp);
+
+    // A failed session is exactly the situation the flight recorder is
+    // for - preserve the ring before anything else happens.
+    if (stage == "failed")
+        recorder.Dump();
+}
+
+} // namespace recorder
+} // namespace report
+} // namespace ac
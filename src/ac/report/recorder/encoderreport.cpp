@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/recorder/encoderreport.h"
+#include "ac/report/recorder/eventrecorder.h"
+
+namespace ac {
+namespace report {
+namespace recorder {
+
+void EncoderReport::Started() {
+    EventRecorder::Instance().Record(EventRecorder::Event::kEncoderStarted, 0, 0, 0);
+}
+
+void EncoderReport::Stopped() {
+    EventRecorder::Instance().Record(EventRecorder::Event::kEncoderStopped, 0, 0, 0);
+}
+
+void EncoderReport::BeganFrame(const ac::TimestampUs &timestamp) {
+    EventRecorder::Instance().Record(EventRecorder::Event::kEncoderBeganFrame, 0, 0, timestamp);
+}
+
+void EncoderReport::FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    EventRecorder::Instance().Record(EventRecorder::Event::kEncoderFinishedFrame, 0,
+                                     static_cast<std::uint32_t>(frame_id), timestamp);
+}
+
+void EncoderReport::ReceivedInputBuffer(const ac::TimestampUs &timestamp) {
+    EventRecorder::Instance().Record(EventRecorder::Event::kEncoderReceivedInputBuffer, 0, 0, timestamp);
+}
+
+} // namespace recorder
+} // namespace report
+} // namespace ac
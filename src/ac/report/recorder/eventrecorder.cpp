@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "ac/config.h"
+#include "ac/logger.h"
+#include "ac/utils.h"
+
+#include "ac/report/recorder/eventrecorder.h"
+
+namespace {
+static constexpr const char *kDumpMagic{"ACFR"};
+static constexpr std::uint32_t kDumpVersion{1};
+} // namespace
+
+namespace ac {
+namespace report {
+namespace recorder {
+
+constexpr std::uint64_t EventRecorder::kRingSize;
+constexpr std::uint64_t EventRecorder::kRingMask;
+
+EventRecorder& EventRecorder::Instance() {
+    static EventRecorder instance;
+    return instance;
+}
+
+EventRecorder::EventRecorder() :
+    records_(kRingSize),
+    head_(0) {
+}
+
+void EventRecorder::Record(Event event, std::uint16_t channel, std::uint32_t value,
+                           const ac::TimestampUs &timestamp) {
+    // Claiming a slot is a single relaxed fetch-add; concurrent writers
+    // never touch the same slot and a dump racing a write at worst sees
+    // one torn record which the offline tooling can discard.
+    const auto slot = head_.fetch_add(1, std::memory_order_relaxed) & kRingMask;
+
+    auto &record = records_[slot];
+    record.recorded_at_us = static_cast<std::uint64_t>(ac::Utils::GetNowUs());
+    record.event = static_cast<std::uint16_t>(event);
+    record.channel = channel;
+    record.value = value;
+    record.timestamp_us = timestamp;
+}
+
+std::uint16_t EventRecorder::ChannelForName(const std::string &name) {
+    std::lock_guard<std::mutex> lock(channels_mutex_);
+
+    auto iter = channels_.find(name);
+    if (iter != channels_.end())
+        return iter->second;
+
+    const auto channel = static_cast<std::uint16_t>(channels_.size() + 1);
+    channels_[name] = channel;
+    return channel;
+}
+
+std::string EventRecorder::Dump() {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == 0)
+        return "";
+
+    boost::system::error_code err;
+    boost::filesystem::create_directories(boost::filesystem::path(ac::kStateDir), err);
+
+    const auto path = ac::Utils::Sprintf("%s/flight-recorder-%lld.bin",
+                                         ac::kStateDir,
+                                         ac::Utils::GetNowUs());
+
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        AC_WARNING("Failed to write flight recorder dump to %s", path);
+        return "";
+    }
+
+    const auto count = std::min(head, kRingSize);
+
+    output.write(kDumpMagic, 4);
+    output.write(reinterpret_cast<const char*>(&kDumpVersion), sizeof(kDumpVersion));
+    const std::uint64_t record_count = count;
+    output.write(reinterpret_cast<const char*>(&record_count), sizeof(record_count));
+
+    // Channel table so offline tooling can resolve the names we
+    // compressed away on the hot path
+    std::lock_guard<std::mutex> lock(channels_mutex_);
+    const std::uint32_t channel_count = channels_.size();
+    output.write(reinterpret_cast<const char*>(&channel_count), sizeof(channel_count));
+    for (const auto &entry : channels_) {
+        output.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+        const std::uint16_t length = entry.first.length();
+        output.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        output.write(entry.first.data(), length);
+    }
+
+    // Oldest record first
+    const auto start = head > kRingSize ? head - kRingSize : 0;
+    for (std::uint64_t n = start; n < head; n++) {
+        const auto &record = records_[n & kRingMask];
+        output.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+
+    AC_INFO("Wrote flight recorder dump with %lld events to %s", count, path);
+
+    return path;
+}
+
+} // namespace recorder
+} // namespace report
+} // namespace ac
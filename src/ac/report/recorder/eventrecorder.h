@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_RECORDER_EVENTRECORDER_H_
+#define AC_REPORT_RECORDER_EVENTRECORDER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+namespace ac {
+namespace report {
+namespace recorder {
+
+// Flight recorder for the streaming pipeline: every report callback
+// drops a fixed-size binary record into a preallocated ring which
+// overwrites its oldest entries once full. Recording is lock-free and
+// cheap enough to stay enabled in production; the ring only gets
+// written to disk when a session fails or when a dump is requested.
+class EventRecorder : public ac::NonCopyable {
+public:
+    enum class Event : std::uint16_t {
+        kEncoderStarted = 1,
+        kEncoderStopped,
+        kEncoderBeganFrame,
+        kEncoderFinishedFrame,
+        kEncoderReceivedInputBuffer,
+        kRendererBeganFrame,
+        kRendererFinishedFrame,
+        kRendererMissedFrameDeadline,
+        kRendererDroppedFrame,
+        kPacketizerPacketizedFrame,
+        kSenderSentPacket,
+        kBufferQueueHighWaterMark,
+        kBufferQueueStalled,
+        kBufferQueueDroppedBuffer,
+        kConnectionStageReached,
+    };
+
+    static EventRecorder& Instance();
+
+    void Record(Event event, std::uint16_t channel, std::uint32_t value,
+                const ac::TimestampUs &timestamp);
+
+    // Maps a name (buffer queue, connection stage) to a small id for
+    // use as the channel of a record. Takes a lock so this belongs on
+    // cold paths only; callers should cache the result where they can.
+    std::uint16_t ChannelForName(const std::string &name);
+
+    // Writes the ring contents to a timestamped file below the state
+    // directory and returns its path, or an empty string on failure or
+    // when nothing was recorded yet.
+    std::string Dump();
+
+private:
+    struct Record_ {
+        std::uint64_t recorded_at_us;
+        std::uint16_t event;
+        std::uint16_t channel;
+        std::uint32_t value;
+        std::int64_t timestamp_us;
+    };
+
+    // 64k records of 24 bytes; at a typical 60 frames per second with
+    // a handful of events per frame this covers several minutes.
+    static constexpr std::uint64_t kRingSize{1 << 16};
+    static constexpr std::uint64_t kRingMask{kRingSize - 1};
+
+    EventRecorder();
+
+private:
+    std::vector<Record_> records_;
+    std::atomic<std::uint64_t> head_;
+    std::mutex channels_mutex_;
+    std::map<std::string, std::uint16_t> channels_;
+};
+
+} // namespace recorder
+} // namespace report
+} // namespace ac
+
+#endif
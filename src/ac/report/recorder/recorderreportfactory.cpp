@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/recorder/recorderreportfactory.h"
+#include "ac/report/recorder/encoderreport.h"
+#include "ac/report/recorder/rendererreport.h"
+#include "ac/report/recorder/packetizerreport.h"
+#include "ac/report/recorder/senderreport.h"
+#include "ac/report/recorder/bufferqueuereport.h"
+#include "ac/report/recorder/connectionreport.h"
+
+namespace ac {
+namespace report {
+
+std::shared_ptr<video::EncoderReport> RecorderReportFactory::CreateEncoderReport() {
+    return std::make_shared<recorder::EncoderReport>();
+}
+
+std::shared_ptr<video::RendererReport> RecorderReportFactory::CreateRendererReport() {
+    return std::make_shared<recorder::RendererReport>();
+}
+
+std::shared_ptr<video::PacketizerReport> RecorderReportFactory::CreatePacketizerReport() {
+    return std::make_shared<recorder::PacketizerReport>();
+}
+
+std::shared_ptr<video::SenderReport> RecorderReportFactory::CreateSenderReport() {
+    return std::make_shared<recorder::SenderReport>();
+}
+
+std::shared_ptr<video::BufferQueueReport> RecorderReportFactory::CreateBufferQueueReport() {
+    return std::make_shared<recorder::BufferQueueReport>();
+}
+
+std::shared_ptr<ConnectionReport> RecorderReportFactory::CreateConnectionReport() {
+    return std::make_shared<recorder::ConnectionReport>();
+}
+
+} // namespace report
+} // namespace ac
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/recorder/rendererreport.h"
+#include "ac/report/recorder/eventrecorder.h"
+
+namespace ac {
+namespace report {
+namespace recorder {
+
+void RendererReport::BeganFrame() {
+    EventRecorder::Instance().Record(EventRecorder::Event::kRendererBeganFrame, 0, 0, 0);
+}
+
+void RendererReport::FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    EventRecorder::Instance().Record(EventRecorder::Event::kRendererFinishedFrame, 0,
+                                     static_cast<std::uint32_t>(frame_id), timestamp);
+}
+
+void RendererReport::MissedFrameDeadline(const ac::TimestampUs &timestamp) {
+    EventRecorder::Instance().Record(EventRecorder::Event::kRendererMissedFrameDeadline, 0, 0, timestamp);
+}
+
+void RendererReport::DroppedFrame(const ac::TimestampUs &timestamp) {
+    EventRecorder::Instance().Record(EventRecorder::Event::kRendererDroppedFrame, 0, 0, timestamp);
+}
+
+} // namespace recorder
+} // namespace report
+} // namespace ac
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/recorder/senderreport.h"
+#include "ac/report/recorder/eventrecorder.h"
+
+namespace ac {
+namespace report {
+namespace recorder {
+
+void SenderReport::SentPacket(const ac::TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id) {
+    EventRecorder::Instance().Record(EventRecorder::Event::kSenderSentPacket,
+                                     static_cast<std::uint16_t>(frame_id),
+                                     static_cast<std::uint32_t>(size), timestamp);
+}
+
+} // namespace recorder
+} // namespace report
+} // namespace ac
@@ -15,25 +15,56 @@
  *
  */
 
+#include <cstdlib>
+
 #include "ac/utils.h"
 
 #include "ac/report/reportfactory.h"
 #include "ac/report/null/nullreportfactory.h"
 #include "ac/report/logging/loggingreportfactory.h"
 #include "ac/report/lttng/lttngreportfactory.h"
+#include "ac/report/metrics/metricsreportfactory.h"
+#include "ac/report/recorder/recorderreportfactory.h"
+#include "ac/report/sampling/samplingreportfactory.h"
+#include "ac/report/sampling/samplingpolicy.h"
 
 namespace ac {
 namespace report {
 
 ReportFactory::Ptr ReportFactory::Create() {
+#ifdef AC_REPORT_STATIC_NULL
+    // The backend was fixed at build time and the per-packet/per-frame
+    // call sites are compiled out (see ac/report/dispatch.h), so the
+    // environment selection below has nothing left to switch.
+    return std::make_shared<NullReportFactory>();
+#else
     std::string type = ac::Utils::GetEnvValue("AETHERCAST_REPORT_TYPE");
 
+    ReportFactory::Ptr factory;
+
     if (type == "log")
-        return std::make_shared<LoggingReportFactory>();
+        factory = std::make_shared<LoggingReportFactory>();
     else if (type == "lttng")
-        return std::make_shared<LttngReportFactory>();
+        factory = std::make_shared<LttngReportFactory>();
+    else if (type == "metrics")
+        factory = std::make_shared<MetricsReportFactory>();
+    else if (type == "recorder")
+        factory = std::make_shared<RecorderReportFactory>();
+    else
+        return std::make_shared<NullReportFactory>();
 
-    return std::make_shared<NullReportFactory>();
+    // Reporting every single RTP packet is affordable for tracing
+    // sessions but not for production; with a sample interval set the
+    // per-packet reports only see every Nth call while the per-frame
+    // and per-event ones keep full fidelity.
+    const auto interval = ac::Utils::GetEnvValue("AETHERCAST_REPORT_SAMPLE_INTERVAL");
+    if (!interval.empty() && std::atoi(interval.c_str()) > 1) {
+        sampling::SamplingPolicy::SetInterval(std::atoi(interval.c_str()));
+        factory = std::make_shared<sampling::SamplingReportFactory>(factory);
+    }
+
+    return factory;
+#endif
 }
 
 } // namespace report
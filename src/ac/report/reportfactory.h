@@ -26,6 +26,8 @@
 #include "ac/video/rendererreport.h"
 #include "ac/video/packetizerreport.h"
 #include "ac/video/senderreport.h"
+#include "ac/video/bufferqueuereport.h"
+#include "ac/report/connectionreport.h"
 
 namespace ac {
 namespace report {
@@ -40,6 +42,8 @@ public:
     virtual video::RendererReport::Ptr CreateRendererReport() = 0;
     virtual video::PacketizerReport::Ptr CreatePacketizerReport() = 0;
     virtual video::SenderReport::Ptr CreateSenderReport() = 0;
+    virtual video::BufferQueueReport::Ptr CreateBufferQueueReport() = 0;
+    virtual ConnectionReport::Ptr CreateConnectionReport() = 0;
 };
 
 } // namespace report
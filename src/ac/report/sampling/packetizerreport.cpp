@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/sampling/packetizerreport.h"
+#include "ac/report/sampling/samplingpolicy.h"
+
+namespace ac {
+namespace report {
+namespace sampling {
+
+PacketizerReport::PacketizerReport(const video::PacketizerReport::Ptr &inner) :
+    inner_(inner),
+    counter_(0) {
+}
+
+void PacketizerReport::PacketizedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id) {
+    const auto interval = SamplingPolicy::Interval();
+    if (interval > 1 &&
+            counter_.fetch_add(1, std::memory_order_relaxed) % interval != 0)
+        return;
+
+    inner_->PacketizedFrame(timestamp, frame_id);
+}
+
+} // namespace sampling
+} // namespace report
+} // namespace ac
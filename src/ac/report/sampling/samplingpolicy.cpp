@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/sampling/samplingpolicy.h"
+
+namespace ac {
+namespace report {
+namespace sampling {
+
+std::atomic<std::uint32_t> SamplingPolicy::interval_{1};
+
+std::uint32_t SamplingPolicy::Interval() {
+    return interval_.load(std::memory_order_relaxed);
+}
+
+void SamplingPolicy::SetInterval(std::uint32_t interval) {
+    interval_.store(interval > 0 ? interval : 1, std::memory_order_relaxed);
+}
+
+} // namespace sampling
+} // namespace report
+} // namespace ac
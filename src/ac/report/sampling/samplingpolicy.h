@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_SAMPLING_SAMPLINGPOLICY_H_
+#define AC_REPORT_SAMPLING_SAMPLINGPOLICY_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace ac {
+namespace report {
+namespace sampling {
+
+// Process-wide 1-in-N rate applied by the sampling report decorators.
+// Kept adjustable at runtime so a running session can be switched
+// between cheap sampled reporting and full fidelity without a restart;
+// an interval of 1 forwards everything.
+class SamplingPolicy {
+public:
+    static std::uint32_t Interval();
+    static void SetInterval(std::uint32_t interval);
+
+private:
+    static std::atomic<std::uint32_t> interval_;
+};
+
+} // namespace sampling
+} // namespace report
+} // namespace ac
+
+#endif
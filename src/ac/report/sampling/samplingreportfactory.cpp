@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/sampling/samplingreportfactory.h"
+#include "ac/report/sampling/packetizerreport.h"
+#include "ac/report/sampling/senderreport.h"
+
+namespace ac {
+namespace report {
+namespace sampling {
+
+SamplingReportFactory::SamplingReportFactory(const ReportFactory::Ptr &inner) :
+    inner_(inner) {
+}
+
+video::EncoderReport::Ptr SamplingReportFactory::CreateEncoderReport() {
+    return inner_->CreateEncoderReport();
+}
+
+video::RendererReport::Ptr SamplingReportFactory::CreateRendererReport() {
+    return inner_->CreateRendererReport();
+}
+
+video::PacketizerReport::Ptr SamplingReportFactory::CreatePacketizerReport() {
+    return std::make_shared<PacketizerReport>(inner_->CreatePacketizerReport());
+}
+
+video::SenderReport::Ptr SamplingReportFactory::CreateSenderReport() {
+    return std::make_shared<SenderReport>(inner_->CreateSenderReport());
+}
+
+video::BufferQueueReport::Ptr SamplingReportFactory::CreateBufferQueueReport() {
+    return inner_->CreateBufferQueueReport();
+}
+
+ConnectionReport::Ptr SamplingReportFactory::CreateConnectionReport() {
+    return inner_->CreateConnectionReport();
+}
+
+} // namespace sampling
+} // namespace report
+} // namespace ac
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_SAMPLING_SENDERREPORT_H_
+#define AC_REPORT_SAMPLING_SENDERREPORT_H_
+
+#include <atomic>
+#include <memory>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/senderreport.h"
+
+namespace ac {
+namespace report {
+namespace sampling {
+
+// Forwards one in SamplingPolicy::Interval() calls to the wrapped
+// report and drops the rest; SentPacket fires for every RTP packet so
+// this is the hottest report call in the pipeline.
+class SenderReport : public video::SenderReport {
+public:
+    SenderReport(const video::SenderReport::Ptr &inner);
+
+    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id);
+
+private:
+    video::SenderReport::Ptr inner_;
+    std::atomic<std::uint64_t> counter_;
+};
+
+} // namespace sampling
+} // namespace report
+} // namespace ac
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "ac/logger.h"
+
+#include "ac/report/startuptrace.h"
+#include "ac/report/metrics/metricsregistry.h"
+
+namespace ac {
+namespace report {
+
+StartupTrace& StartupTrace::Instance() {
+    static StartupTrace instance;
+    return instance;
+}
+
+StartupTrace::StartupTrace() :
+    start_time_(Utils::GetNowUs()),
+    dump_on_completion_(false) {
+}
+
+void StartupTrace::Mark(const std::string &milestone) {
+    const ac::TimestampUs now = Utils::GetNowUs();
+
+    bool completed = false;
+
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+
+        const auto known = std::find_if(milestones_.begin(), milestones_.end(),
+            [&milestone](const Milestone &m) { return m.name == milestone; });
+        if (known != milestones_.end())
+            return;
+
+        milestones_.push_back(Milestone{milestone, now});
+
+        completed = dump_on_completion_ &&
+                milestone == kStartupMilestoneDiscoveryCapable;
+    }
+
+    // Gauge names use underscores like every other metric.
+    auto gauge = milestone;
+    std::replace(gauge.begin(), gauge.end(), '-', '_');
+    metrics::MetricsRegistry::Instance().SetGauge(
+        Utils::Sprintf("startup_%s_us", gauge), now - start_time_);
+
+    if (completed)
+        Dump();
+}
+
+void StartupTrace::Dump() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    AC_INFO("Startup timing (offsets from process start):");
+
+    auto last = start_time_;
+    for (const auto &milestone : milestones_) {
+        AC_INFO("  %-20s +%.1f ms (phase %.1f ms)",
+                milestone.name,
+                (milestone.at - start_time_) / 1000.,
+                (milestone.at - last) / 1000.);
+        last = milestone.at;
+    }
+}
+
+void StartupTrace::SetDumpOnCompletion(bool enabled) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    dump_on_completion_ = enabled;
+}
+
+} // namespace report
+} // namespace ac
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_STARTUPTRACE_H_
+#define AC_REPORT_STARTUPTRACE_H_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+namespace ac {
+namespace report {
+
+// Milestones of the daemon's startup path, in expected order.
+constexpr const char *kStartupMilestoneMainEntry{"main-entry"};
+constexpr const char *kStartupMilestoneMainLoopRunning{"main-loop-running"};
+constexpr const char *kStartupMilestoneStubChainReady{"stub-chain-ready"};
+constexpr const char *kStartupMilestoneNameAcquired{"name-acquired"};
+constexpr const char *kStartupMilestoneDiscoveryCapable{"discovery-capable"};
+
+// Collects one timestamp per startup milestone so "the daemon starts
+// slowly" becomes a list of phase durations instead of a feeling.
+// Every milestone also lands in the metrics registry as a gauge;
+// with --startup-timing the trace additionally prints itself once
+// the daemon is discovery capable. Marking costs a mutex and a
+// vector append, so call sites need no guards of their own.
+class StartupTrace : public ac::NonCopyable {
+public:
+    static StartupTrace& Instance();
+
+    // Records the milestone at the current monotonic clock; repeats
+    // are ignored so flapping readiness never rewrites history.
+    void Mark(const std::string &milestone);
+
+    // Logs every recorded milestone with its offset from process
+    // start; safe to call at any time (SIGUSR1 does).
+    void Dump() const;
+
+    // Makes the trace dump itself once the final milestone arrives;
+    // set from the --startup-timing command line flag.
+    void SetDumpOnCompletion(bool enabled);
+
+private:
+    struct Milestone {
+        std::string name;
+        ac::TimestampUs at;
+    };
+
+    StartupTrace();
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Milestone> milestones_;
+    ac::TimestampUs start_time_;
+    bool dump_on_completion_;
+};
+
+} // namespace report
+} // namespace ac
+
+#endif
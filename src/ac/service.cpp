@@ -34,19 +34,48 @@
 #include "ac/keep_alive.h"
 #include "ac/logger.h"
 #include "ac/service.h"
+#include "ac/mediamanagerfactory.h"
 #include "ac/networkmanagerfactory.h"
 #include "ac/types.h"
 #include "ac/logger.h"
+#include "ac/unixsignalsource.h"
+#include "ac/utils.h"
 
 #include "ac/dbus/controllerskeleton.h"
 
+#include "ac/report/reportfactory.h"
+#include "ac/report/metrics/metricsregistry.h"
+#include "ac/streaming/frametap.h"
+#include "ac/report/recorder/eventrecorder.h"
+#include "ac/report/startuptrace.h"
+
 namespace {
 // TODO(morphis, tvoss): Expose the port as a construction-time parameter.
 const std::uint16_t kMiracastDefaultRtspCtrlPort{7236};
+// Concurrent sink sessions the service will host; each session runs a
+// full capture/encode/send pipeline, so raising this only makes sense
+// on hardware with more than one encode engine.
+static constexpr const char *kMaxSessionsEnvName{"AETHERCAST_MAX_SESSIONS"};
+const unsigned int kDefaultMaxSessions{1};
 const std::chrono::milliseconds kStateIdleTimeout{5000};
+// How long the service may sit around disabled and without a session
+// before a bus-activated instance exits again; 0 (the default) keeps
+// the daemon resident forever, which is what the upstart job wants.
+static constexpr const char *kIdleExitTimeoutEnvName{"AETHERCAST_IDLE_EXIT_SECONDS"};
 const std::chrono::seconds kShutdownGracePreriod{1};
 const std::int16_t kProcessPriorityUrgentDisplay{-8};
 
+// Milestones of the connection setup path; each one ends up as an entry
+// in the ConnectionTrace D-Bus property and as a report event.
+const char *kStageConnectRequested{"connect-requested"};
+const char *kStageAssociation{"association"};
+const char *kStageConfiguration{"configuration"};
+const char *kStageConnected{"connected"};
+const char *kStageRtspListening{"rtsp-listening"};
+const char *kStageRtspSessionEstablished{"rtsp-session-established"};
+const char *kStageFailed{"failed"};
+const char *kStageDisconnected{"disconnected"};
+
 // SafeLog serves as integration point to the wds::LogSystem world.
 template <ac::Logger::Severity severity>
 void SafeLog (const char *format, ...)
@@ -65,10 +94,12 @@ namespace ac {
 Service::MainOptions Service::MainOptions::FromCommandLine(int argc, char** argv) {
     static gboolean option_debug{FALSE};
     static gboolean option_version{FALSE};
+    static gboolean option_startup_timing{FALSE};
 
     static GOptionEntry options[] = {
         { "debug", 'd', 0, G_OPTION_ARG_NONE, &option_debug, "Enable debugging mode", nullptr },
         { "version", 'v', 0, G_OPTION_ARG_NONE, &option_version, "Show version information and exit", nullptr },
+        { "startup-timing", 0, 0, G_OPTION_ARG_NONE, &option_startup_timing, "Print startup phase timing once discovery capable", nullptr },
         { NULL },
     };
 
@@ -86,7 +117,8 @@ Service::MainOptions Service::MainOptions::FromCommandLine(int argc, char** argv
         exit(1);
     }
 
-    return MainOptions{option_debug == TRUE, option_version == TRUE};
+    return MainOptions{option_debug == TRUE, option_version == TRUE,
+                       option_startup_timing == TRUE};
 }
 
 int Service::Main(const Service::MainOptions &options) {
@@ -95,16 +127,46 @@ int Service::Main(const Service::MainOptions &options) {
         return 0;
     }
 
+    // Hand all log records over to a dedicated writer thread before
+    // any subsystem starts logging from its own; an overloaded journald
+    // must never stall the packet or encoder threads behind a write.
+    ac::EnableAsyncLogging();
+
     if (options.debug)
         ac::Log().Init(ac::Logger::Severity::kDebug);
+    else
+        // Without --debug nobody consumes the trace/debug output so
+        // drop those messages before their format strings are ever
+        // expanded; the logging report backend lifts the threshold
+        // again when someone opts into it.
+        ac::Log().SetThreshold(ac::Logger::Severity::kInfo);
+
+    if (options.startup_timing)
+        report::StartupTrace::Instance().SetDumpOnCompletion(true);
 
     struct Runtime {
-        static gboolean OnSignalRaised(gpointer user_data) {
-            auto thiz = static_cast<Runtime*>(user_data);
+        void OnSignalRaised(int signal) {
+            // On-demand dump of the flight recorder ring; a no-op
+            // unless the recorder report backend is enabled and has
+            // recorded something.
+            if (signal == SIGUSR1) {
+                report::recorder::EventRecorder::Instance().Dump();
+                report::StartupTrace::Instance().Dump();
+                return;
+            }
+
+            // A second SIGINT/SIGTERM should really terminate us and
+            // also overlay the grace period for a proper shutdown
+            // we're performing.
+            if (shutting_down) {
+                ac::UnixSignalSource::RestoreDefaultAndRaise(signal);
+                return;
+            }
+            shutting_down = true;
 
             // This will bring down everything and the timeout below will give
             // things a small amount of time to perform their shutdown jobs.
-            thiz->service->Shutdown();
+            service->Shutdown();
 
             AC_DEBUG("Exiting");
 
@@ -112,19 +174,18 @@ int Service::Main(const Service::MainOptions &options) {
                 auto thiz = static_cast<Runtime*>(user_data);
                 g_main_loop_quit(thiz->ml);
                 return FALSE;
-            }, thiz);
-
-            // A second SIGTERM should really terminate us and also overlay
-            // the grace period for a proper shutdown we're performing.
-            return FALSE;
+            }, this);
         }
 
         Runtime() {
-            // We do not have to use a KeepAlive<Scope> here as
-            // a Runtime instance controls the lifetime of signal
-            // emissions.
-            g_unix_signal_add(SIGINT, OnSignalRaised, this);
-            g_unix_signal_add(SIGTERM, OnSignalRaised, this);
+            // One signalfd GSource covers all signals we care about;
+            // the handler runs in ordinary main loop context, so no
+            // async-signal-safety constraints and shutdown can never
+            // race signal delivery. The Runtime instance controls the
+            // lifetime of signal emissions, so no KeepAlive<> needed.
+            signal_source = ac::UnixSignalSource::Create(
+                        {SIGINT, SIGTERM, SIGUSR1},
+                        [this](int signal) { OnSignalRaised(signal); });
 
             // Redirect all wds logging to our own.
             wds::LogSystem::set_vlog_func(SafeLog<ac::Logger::Severity::kTrace>);
@@ -164,6 +225,21 @@ int Service::Main(const Service::MainOptions &options) {
             setpriority(PRIO_PROCESS, 0, kProcessPriorityUrgentDisplay);
 
             service = ac::Service::Create();
+
+            // A bus-activated instance goes away again once it has been
+            // idle long enough; D-Bus starts us anew on the next method
+            // call and LoadState restores the Enabled flag. Nothing is
+            // running at this point so no grace period is needed.
+            service->SetIdleExitHandler([this]() {
+                shutting_down = true;
+                g_main_loop_quit(ml);
+            });
+
+            // The skeleton export and the bus name request below are the
+            // activation critical path: a client calling us through D-Bus
+            // activation blocks until the name shows up on the bus, so
+            // everything expensive stays behind the deferred backend
+            // bring-up in Service::FinalizeConstruction.
             controller_skeleton = ac::dbus::ControllerSkeleton::Create(service);
         }
 
@@ -172,10 +248,20 @@ int Service::Main(const Service::MainOptions &options) {
         }
 
         void Run() {
+            // High priority so the mark wins against the deferred
+            // backend bring-up queued on the same loop; it records
+            // when the loop first dispatches, not when it idles.
+            g_idle_add_full(G_PRIORITY_HIGH, [](gpointer) -> gboolean {
+                report::StartupTrace::Instance().Mark(report::kStartupMilestoneMainLoopRunning);
+                return FALSE;
+            }, nullptr, nullptr);
+
             g_main_loop_run(ml);
         }
 
         GMainLoop *ml = g_main_loop_new(nullptr, FALSE);
+        ac::UnixSignalSource::Ptr signal_source;
+        bool shutting_down = false;
         ac::Service::Ptr service;
         ac::dbus::ControllerSkeleton::Ptr controller_skeleton;
     } rt;
@@ -193,8 +279,15 @@ std::shared_ptr<Service> Service::Create() {
 Service::Service() :
     current_state_(kIdle),
     scan_timeout_source_(0),
+    idle_exit_source_(0),
+    idle_exit_timeout_(0),
     supported_roles_({kSource}),
-    enabled_(false) {
+    enabled_(false),
+    connect_start_time_(0) {
+
+    const auto idle_exit = Utils::GetEnvValue(kIdleExitTimeoutEnvName);
+    if (!idle_exit.empty() && std::atoi(idle_exit.c_str()) > 0)
+        idle_exit_timeout_ = std::chrono::seconds{std::atoi(idle_exit.c_str())};
 
     CreateRuntimeDirectory();
 }
@@ -202,18 +295,42 @@ Service::Service() :
 std::shared_ptr<Service> Service::FinalizeConstruction() {
     system_controller_ = ac::SystemController::CreatePlatformDefault();
 
+    // The backend bring-up talks to wpa_supplicant, hostname1 and the
+    // display server and can take seconds on a slow boot. Defer it
+    // below everything already queued on the main loop so the skeleton
+    // export and bus name request go out first and clients can talk to
+    // us right away; they see the backend arrive through Ready.
+    g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, [](gpointer user_data) -> gboolean {
+        if (auto thiz = static_cast<WeakKeepAlive<Service>*>(user_data)->GetInstance().lock())
+            thiz->StartBackend();
+        return FALSE;
+    }, new WeakKeepAlive<Service>(shared_from_this()),
+    [](gpointer data) { delete static_cast<WeakKeepAlive<Service>*>(data); });
+
+    return shared_from_this();
+}
+
+void Service::StartBackend() {
+    // Get long-running session prerequisites (like the connection to
+    // the display server) out of the way before any sink shows up
+    MediaManagerFactory::PrewarmSources();
+
     network_manager_ = ac::NetworkManagerFactory::Create();
     network_manager_->SetDelegate(this);
     network_manager_->SetCapabilities({NetworkManager::Capability::kSource});
 
     LoadState();
 
-    return shared_from_this();
+    if (auto sp = delegate_.lock())
+        sp->OnChanged();
 }
 
 Service::~Service() {
     if (scan_timeout_source_ > 0)
         g_source_remove(scan_timeout_source_);
+
+    if (idle_exit_source_ > 0)
+        g_source_remove(idle_exit_source_);
 }
 
 void Service::CreateRuntimeDirectory() {
@@ -261,28 +378,53 @@ NetworkDeviceState Service::State() const {
 }
 
 std::vector<NetworkManager::Capability> Service::Capabilities() const {
-    if (!enabled_)
+    if (!enabled_ || !network_manager_)
         return std::vector<NetworkManager::Capability>{};
 
     return network_manager_->Capabilities();
 }
 
+std::vector<std::string> Service::ConnectionTrace() const {
+    return connection_trace_;
+}
+
+std::map<std::string, std::uint64_t> Service::RuntimeMetrics() const {
+    return report::metrics::MetricsRegistry::Instance().Snapshot();
+}
+
+int Service::OpenFrameTap() {
+    return streaming::FrameTap::Instance().OpenReader();
+}
+
+bool Service::TakeSnapshot(std::uint32_t max_width, video::SnapshotTap::Image *image) {
+    // The capture loop serves the request from its next frame; with no
+    // session streaming nobody answers and the wait runs out quickly.
+    return video::SnapshotTap::Instance().Take(max_width, image);
+}
+
+bool Service::Ready() const {
+    return network_manager_ && network_manager_->Ready();
+}
+
 bool Service::Scanning() const {
-    if (!enabled_)
+    if (!enabled_ || !network_manager_)
         return false;
 
     return network_manager_->Scanning();
 }
 
 bool Service::Enabled() const {
-    return network_manager_->Ready() && enabled_;
+    return Ready() && enabled_;
 }
 
 bool Service::SetupNetworkManager() {
-    return network_manager_->Setup();
+    return network_manager_ && network_manager_->Setup();
 }
 
 bool Service::ReleaseNetworkManager() {
+    if (!network_manager_)
+        return true;
+
     if (current_device_)
         network_manager_->Disconnect(current_device_);
 
@@ -294,7 +436,7 @@ bool Service::ReleaseNetworkManager() {
 }
 
 Error Service::SetEnabled(bool enabled) {
-    if (!network_manager_->Ready())
+    if (!Ready())
         return Error::kNotReady;
 
     return SetEnabledInternal(enabled, false);
@@ -311,6 +453,11 @@ Error Service::SetEnabledInternal(bool enabled, bool no_save) {
 
     enabled_ = enabled;
 
+    // Disabling is the only way into idle-exit eligibility; count the
+    // idle period from this moment, not from whenever the timer was
+    // last armed.
+    RescheduleIdleExit();
+
     if (!no_save)
         SaveState();
 
@@ -320,6 +467,10 @@ Error Service::SetEnabledInternal(bool enabled, bool no_save) {
     return Error::kNone;
 }
 
+void Service::OnRtspSessionEstablished() {
+    RecordConnectionStage(kStageRtspSessionEstablished);
+}
+
 void Service::OnClientDisconnected() {
     g_timeout_add(0, [](gpointer user_data) {
         auto thiz = static_cast<WeakKeepAlive<Service>*>(user_data)->GetInstance().lock();
@@ -333,31 +484,78 @@ void Service::OnClientDisconnected() {
     }, new WeakKeepAlive<Service>(shared_from_this()));
 }
 
+void Service::RecordConnectionStage(const std::string &stage) {
+    const auto now = static_cast<TimestampUs>(Utils::GetNowUs());
+
+    // Each connect attempt starts a fresh trace so the ConnectionTrace
+    // property always describes the most recent connection setup.
+    if (stage == kStageConnectRequested) {
+        connection_trace_.clear();
+        connect_start_time_ = now;
+    }
+
+    connection_trace_.push_back(Utils::Sprintf("%s +%lldus", stage, now - connect_start_time_));
+
+    // Created on first use; no connection milestone can happen before
+    // a connect attempt so the daemon start doesn't have to pay for it.
+    if (!connection_report_)
+        connection_report_ = report::ReportFactory::Create()->CreateConnectionReport();
+
+    connection_report_->StageReached(stage, now);
+}
+
 void Service::AdvanceState(NetworkDeviceState new_state) {
     AC_DEBUG("new state %s current state %s",
           ac::NetworkDevice::StateToStr(new_state),
           ac::NetworkDevice::StateToStr(current_state_));
 
+    const auto state_changed = new_state != current_state_;
+
     switch (new_state) {
     case kAssociation:
+        if (state_changed)
+            RecordConnectionStage(kStageAssociation);
         break;
 
     case kConfiguration:
+        if (state_changed)
+            RecordConnectionStage(kStageConfiguration);
         break;
 
-    case kConnected:
-        source_ = SourceManager::Create(network_manager_->LocalAddress(), kMiracastDefaultRtspCtrlPort);
+    case kConnected: {
+        if (state_changed)
+            RecordConnectionStage(kStageConnected);
+
+        auto max_sessions = kDefaultMaxSessions;
+        const auto env_sessions = Utils::GetEnvValue(kMaxSessionsEnvName);
+        if (!env_sessions.empty() && std::atoi(env_sessions.c_str()) > 0)
+            max_sessions = std::atoi(env_sessions.c_str());
+
+        source_ = SourceManager::Create(network_manager_->LocalAddress(),
+                                        kMiracastDefaultRtspCtrlPort,
+                                        max_sessions);
         source_->SetDelegate(shared_from_this());
+        RecordConnectionStage(kStageRtspListening);
         FinishConnectAttempt();
         break;
+    }
 
     case kFailure:
+        if (state_changed)
+            RecordConnectionStage(kStageFailed);
         FinishConnectAttempt(Error::kFailed);
 
     case kDisconnected:
+        if (state_changed)
+            RecordConnectionStage(kStageDisconnected);
         source_.reset();
         current_device_.reset();
 
+        // Everything session-scoped is gone now; without this the
+        // allocator keeps the freed pages cached and an always-on
+        // device idles at session-peak RSS until the next cast.
+        Utils::TrimMemory();
+
         system_controller_->DisplayStateLock()->Release(ac::DisplayState::On);
 
         StartIdleTimer();
@@ -425,8 +623,16 @@ void Service::OnReadyChanged() {
         // NetworkManager switch on its own to not ready so we avoid
         // storing the new 'Enabled' state as that
         SetEnabledInternal(false, true);
-    else
+    else {
+        // First flip to ready is the point where a Scan request could
+        // actually reach the radio.
+        report::StartupTrace::Instance().Mark(report::kStartupMilestoneDiscoveryCapable);
         LoadState();
+    }
+
+    // SetEnabledInternal only notifies when the enabled state actually
+    // changed but the Ready property always has to be republished.
+    OnChanged();
 }
 
 gboolean Service::OnIdleTimer(gpointer user_data) {
@@ -440,6 +646,55 @@ void Service::StartIdleTimer() {
                   new SharedKeepAlive<Service>{shared_from_this()});
 }
 
+void Service::SetIdleExitHandler(const std::function<void()> &handler) {
+    idle_exit_handler_ = handler;
+    RescheduleIdleExit();
+}
+
+bool Service::CanIdleExit() const {
+    // While enabled we stay discoverable as a Miracast source and have
+    // to keep listening for incoming P2P connections; only a disabled
+    // service with no session and no connect in flight is truly idle.
+    return !enabled_ && !current_device_ && !connect_callback_;
+}
+
+void Service::RescheduleIdleExit() {
+    if (idle_exit_source_ > 0) {
+        g_source_remove(idle_exit_source_);
+        idle_exit_source_ = 0;
+    }
+
+    if (!idle_exit_handler_ || idle_exit_timeout_.count() <= 0)
+        return;
+
+    // The source carries a destroy notify as rescheduling removes it
+    // long before it ever fired.
+    idle_exit_source_ = g_timeout_add_seconds_full(G_PRIORITY_DEFAULT, idle_exit_timeout_.count(), [](gpointer user_data) -> gboolean {
+        auto thiz = static_cast<WeakKeepAlive<Service>*>(user_data)->GetInstance().lock();
+
+        if (!thiz)
+            return FALSE;
+
+        thiz->idle_exit_source_ = 0;
+
+        // Something woke up since the timer was armed; count the idle
+        // period from scratch rather than exiting under its feet.
+        if (!thiz->CanIdleExit()) {
+            thiz->RescheduleIdleExit();
+            return FALSE;
+        }
+
+        AC_INFO("Idle for %d seconds, exiting; D-Bus activation brings us back on demand",
+                static_cast<int>(thiz->idle_exit_timeout_.count()));
+
+        thiz->SaveState();
+        thiz->idle_exit_handler_();
+
+        return FALSE;
+    }, new WeakKeepAlive<Service>(shared_from_this()),
+    [](gpointer data) { delete static_cast<WeakKeepAlive<Service>*>(data); });
+}
+
 void Service::FinishConnectAttempt(ac::Error error) {
     if (connect_callback_)
         connect_callback_(error);
@@ -482,6 +737,8 @@ void Service::Connect(const NetworkDevice::Ptr &device, ResultCallback callback)
 
     system_controller_->DisplayStateLock()->Acquire(ac::DisplayState::On);
 
+    RecordConnectionStage(kStageConnectRequested);
+
     connect_callback_ = callback;
 }
 
@@ -518,6 +775,11 @@ ac::Error Service::Scan(const std::chrono::seconds &timeout) {
     if (current_device_)
         return ac::Error::kNotReady;
 
+    // A scan means the user has the device picker open and a connect is
+    // likely to follow, so make sure the expensive source prerequisites
+    // are warm again in case they were dropped since startup.
+    MediaManagerFactory::PrewarmSources();
+
     network_manager_->Scan(timeout);
 
     return ac::Error::kNone;
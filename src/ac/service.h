@@ -32,6 +32,9 @@
 #include "ac/non_copyable.h"
 #include "ac/types.h"
 #include "ac/systemcontroller.h"
+#include "ac/utils.h"
+
+#include "ac/report/connectionreport.h"
 
 namespace ac {
 class Service : public Controller,
@@ -50,6 +53,9 @@ public:
 
         bool debug;
         bool print_version;
+        // Print the startup milestone trace once the daemon becomes
+        // discovery capable
+        bool startup_timing;
     };
 
     static int Main(const MainOptions &options);
@@ -69,12 +75,24 @@ public:
 
     NetworkDeviceState State() const;
     std::vector<NetworkManager::Capability> Capabilities() const;
+    std::vector<std::string> ConnectionTrace() const;
+    std::map<std::string, std::uint64_t> RuntimeMetrics() const;
+    int OpenFrameTap();
+    bool TakeSnapshot(std::uint32_t max_width, video::SnapshotTap::Image *image);
+    bool Ready() const;
     bool Scanning() const;
     bool Enabled() const;
 
     Error SetEnabled(bool enabled) override;
 
+    // Invoked on the main loop once the service has been disabled and
+    // without a session for the configured idle-exit period; the runtime
+    // uses it to leave the main loop so a bus-activated daemon does not
+    // stay resident between casts. Never set when idle exit is disabled.
+    void SetIdleExitHandler(const std::function<void()> &handler);
+
     void OnClientDisconnected();
+    void OnRtspSessionEstablished();
 
     bool SetupNetworkManager();
     bool ReleaseNetworkManager();
@@ -94,9 +112,14 @@ private:
     Service();
     std::shared_ptr<Service> FinalizeConstruction();
 
+    void StartBackend();
+
     void AdvanceState(NetworkDeviceState new_state);
+    void RecordConnectionStage(const std::string &stage);
     void FinishConnectAttempt(ac::Error error = ac::Error::kNone);
     void StartIdleTimer();
+    void RescheduleIdleExit();
+    bool CanIdleExit() const;
     void LoadWiFiFirmware();
 
     void Shutdown();
@@ -117,10 +140,16 @@ private:
     NetworkDevice::Ptr current_device_;
     ResultCallback connect_callback_;
     guint scan_timeout_source_;
+    guint idle_exit_source_;
+    std::chrono::seconds idle_exit_timeout_;
+    std::function<void()> idle_exit_handler_;
     ResultCallback current_scan_callback_;
     std::vector<NetworkDeviceRole> supported_roles_;
     ac::SystemController::Ptr system_controller_;
     bool enabled_;
+    report::ConnectionReport::Ptr connection_report_;
+    std::vector<std::string> connection_trace_;
+    TimestampUs connect_start_time_;
 };
 } // namespace ac
 #endif
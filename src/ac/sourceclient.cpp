@@ -15,6 +15,11 @@
  *
  */
 
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <poll.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -32,10 +37,26 @@
 
 #include "ac/mir/sourcemediamanager.h"
 
+#include "ac/network/tcpstream.h"
 #include "ac/network/udpstream.h"
+#include "ac/network/uringstream.h"
 
 namespace {
 static int send_cseq = 0;
+// Short enough to keep wds timer dispatch at sub-tick granularity
+// (they are specified in whole seconds) without busy-spinning.
+static constexpr int kRTSPPollTimeoutMs{50};
+// DSCP AF41 (interactive video) as recommended for WFD sessions
+static constexpr int kVideoTos = 0x88;
+// 802.1d user priority "video"; the wireless stack maps it to the
+// WMM video access category
+static constexpr int kVideoSocketPriority = 5;
+// How long transport errors are answered with retarget attempts
+// before the session really tears down; a GO renegotiation or channel
+// switch resettles well within this.
+static constexpr unsigned int kReconnectWindowMs{5000};
+// Spacing of the retarget attempts within the window
+static constexpr unsigned int kReconnectRetryMs{250};
 }
 
 namespace ac {
@@ -46,15 +67,28 @@ std::shared_ptr<SourceClient> SourceClient::Create(ScopedGObject<GSocket>&& sock
 
 SourceClient::SourceClient(ScopedGObject<GSocket>&& socket, const ac::IpV4Address &local_address) :
     socket_(std::move(socket)),
-    socket_source_(0),
-    local_address_(local_address) {
+    local_address_(local_address),
+    next_timer_id_(0),
+    reconnect_timeout_(0),
+    transport_failed_(false) {
 }
 
 SourceClient::~SourceClient() {
-    if (socket_source_ > 0)
-        g_source_remove(socket_source_);
+    if (rtsp_executor_)
+        rtsp_executor_->Stop();
+
+    if (reconnect_timeout_ > 0)
+        g_source_remove(reconnect_timeout_);
 
     ReleaseTimers();
+
+    // The wds source holds a raw pointer to the media manager, so it
+    // has to go first; default member order would destroy them the
+    // other way around. Dropping the manager here (rather than with
+    // the member) also makes sure encoder and renderer die with the
+    // session instead of lingering until the last stray reference.
+    source_.reset();
+    media_manager_.reset();
 }
 
 void SourceClient::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
@@ -75,15 +109,55 @@ void SourceClient::DumpRtsp(const std::string &prefix, const std::string &data)
         AC_WARNING("RTSP: %s: %s", prefix.c_str(), current.c_str());
 }
 
+// Only ever called on the session thread (construction-time sends
+// happen before the pump starts), so the pending buffer needs no
+// locking.
 void SourceClient::SendRTSPData(const std::string &data) {
     DumpRtsp("OUT", data);
+
+    // Ordering matters; once something is queued everything else has
+    // to line up behind it.
+    if (!send_buffer_.empty()) {
+        send_buffer_.insert(send_buffer_.end(), data.begin(), data.end());
+        return;
+    }
+
     GError *error = nullptr;
-    auto bytes_written = g_socket_send(socket_.get(), data.c_str(), data.length(), nullptr, &error);
+    const auto bytes_written = g_socket_send(socket_.get(), data.c_str(), data.length(), nullptr, &error);
+
     if (bytes_written < 0) {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+            g_error_free(error);
+            send_buffer_.assign(data.begin(), data.end());
+            return;
+        }
+
         AC_WARNING("Failed to write data to RTSP client: %s", error->message);
         g_error_free(error);
         return;
     }
+
+    if (static_cast<std::size_t>(bytes_written) < data.length())
+        send_buffer_.assign(data.begin() + bytes_written, data.end());
+}
+
+void SourceClient::FlushPendingSendData() {
+    if (send_buffer_.empty())
+        return;
+
+    GError *error = nullptr;
+    const auto bytes_written = g_socket_send(socket_.get(), send_buffer_.data(),
+                                             send_buffer_.size(), nullptr, &error);
+
+    if (bytes_written < 0) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+            AC_WARNING("Failed to write pending data to RTSP client: %s", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    // erase keeps the capacity for the next partial write
+    send_buffer_.erase(send_buffer_.begin(), send_buffer_.begin() + bytes_written);
 }
 
 std::string SourceClient::GetLocalIPAddress() const {
@@ -97,29 +171,13 @@ int SourceClient::GetNextCSeq(int *initial_peer_cseq) const {
     return send_cseq;
 }
 
-class TimerCallbackData {
-public:
-    TimerCallbackData(SourceClient *delegate) :
-        delegate_(delegate),
-        id_(0) {
-    }
-
-    guint id_;
-    SourceClient *delegate_;
-};
-
+// Timers live on the session thread like all other wds state; they
+// are one-shot, matching what the old GLib timeout sources did.
 uint SourceClient::CreateTimer(int seconds) {
-    auto data = new TimerCallbackData(this);
-    auto id = g_timeout_add_seconds_full(G_PRIORITY_DEFAULT, seconds,
-                                         &SourceClient::OnTimeout, data,
-                                         &SourceClient::OnTimeoutRemove);
-    if (id > 0) {
-        data->id_ = id;
-        timers_.push_back(id);
-    } else {
-        delete data;
-    }
-
+    std::lock_guard<std::mutex> guard(timers_mutex_);
+    const auto id = ++next_timer_id_;
+    timers_.push_back(Timer{id,
+        std::chrono::steady_clock::now() + std::chrono::seconds{seconds}});
     return id;
 }
 
@@ -127,56 +185,99 @@ void SourceClient::ReleaseTimer(uint timer_id) {
     if (timer_id <= 0)
         return;
 
-    auto it = std::find(timers_.begin(), timers_.end(), timer_id);
+    std::lock_guard<std::mutex> guard(timers_mutex_);
+    auto it = std::find_if(timers_.begin(), timers_.end(),
+        [timer_id](const Timer &timer) { return timer.id == timer_id; });
     if (it != timers_.end())
-        g_source_remove(*it);
+        timers_.erase(it);
 }
 
 void SourceClient::ReleaseTimers() {
-    for (auto timer : timers_)
-        g_source_remove(timer);
-
+    std::lock_guard<std::mutex> guard(timers_mutex_);
     timers_.clear();
 }
 
-gboolean SourceClient::OnTimeout(gpointer user_data) {
-    auto data = static_cast<TimerCallbackData*>(user_data);
-    data->delegate_->source_->OnTimerEvent(data->id_);
-    return FALSE;
-}
+void SourceClient::ProcessExpiredTimers() {
+    std::vector<guint> expired;
+
+    {
+        std::lock_guard<std::mutex> guard(timers_mutex_);
+        const auto now = std::chrono::steady_clock::now();
+        auto it = timers_.begin();
+        while (it != timers_.end()) {
+            if (it->deadline <= now) {
+                expired.push_back(it->id);
+                it = timers_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
 
-void SourceClient::OnTimeoutRemove(gpointer user_data) {
-    auto data = static_cast<TimerCallbackData*>(user_data);
-    auto& timers = data->delegate_->timers_;
-    auto it = std::find(timers.begin(), timers.end(), data->id_);
-    if (it != timers.end())
-        timers.erase(it);
-    delete data;
+    for (const auto id : expired)
+        source_->OnTimerEvent(id);
 }
 
-gboolean SourceClient::OnIncomingData(GSocket *socket, GIOCondition  cond, gpointer user_data) {
-    auto inst = static_cast<WeakKeepAlive<SourceClient>*>(user_data)->GetInstance().lock();
+bool SourceClient::PumpRTSPSession() {
+    struct pollfd fd;
+    fd.fd = g_socket_get_fd(socket_.get());
+    fd.events = POLLIN;
+    if (!send_buffer_.empty())
+        fd.events |= POLLOUT;
+    fd.revents = 0;
 
-    if (cond == G_IO_ERR || cond == G_IO_HUP) {
-        if (auto sp = inst->delegate_.lock())
-            sp->OnConnectionClosed();
-        return TRUE;
+    const auto ret = ::poll(&fd, 1, kRTSPPollTimeoutMs);
+
+    if (ret > 0 && (fd.revents & (POLLERR | POLLHUP))) {
+        NotifyConnectionClosed();
+        return false;
     }
 
-    int fd = g_socket_get_fd(inst->socket_.get());
-    while (g_socket_get_available_bytes(inst->socket_.get()) > 0) {
-        gchar buf[1024] = { };
-        gssize nbytes = g_socket_receive(inst->socket_.get(), buf, 1024, NULL, NULL);
-        if (nbytes <= 0)
-            break;
+    if (ret > 0 && (fd.revents & POLLIN)) {
+        while (g_socket_get_available_bytes(socket_.get()) > 0) {
+            gchar buf[1024] = { };
+            gssize nbytes = g_socket_receive(socket_.get(), buf, 1024, NULL, NULL);
+            if (nbytes <= 0)
+                break;
+
+            std::string data(buf);
+            DumpRtsp("IN", data);
+
+            source_->RTSPDataReceived(data);
+        }
+    }
+
+    FlushPendingSendData();
+
+    ProcessExpiredTimers();
+
+    return true;
+}
+
+namespace {
+// Drives one client's RTSP session from a dedicated thread. Holds
+// only a weak reference so the executor never keeps a closed client
+// alive; the pump stops itself once the client is gone.
+class RTSPPump : public common::Executable {
+public:
+    explicit RTSPPump(const std::weak_ptr<SourceClient> &client) :
+        client_(client) {
+    }
 
-        std::string data(buf);
-        inst->DumpRtsp("IN", data);
+    bool Start() override { return true; }
+    bool Stop() override { return true; }
 
-        inst->source_->RTSPDataReceived(data);
+    bool Execute() override {
+        if (auto sp = client_.lock())
+            return sp->PumpRTSPSession();
+        return false;
     }
 
-    return TRUE;
+    std::string Name() const override { return "RTSPSession"; }
+
+private:
+    std::weak_ptr<SourceClient> client_;
+};
 }
 
 std::shared_ptr<SourceClient> SourceClient::FinalizeConstruction() {
@@ -196,41 +297,145 @@ std::shared_ptr<SourceClient> SourceClient::FinalizeConstruction() {
         return sp;
     }
 
-    std::string peer_address = g_inet_address_to_string(G_INET_ADDRESS(inet_address));
-
-    auto source = g_socket_create_source(socket_.get(), static_cast<GIOCondition>((G_IO_IN | G_IO_HUP | G_IO_ERR)), nullptr);
-    if (!source) {
-        AC_WARNING("Failed to setup event listener for source client");
-        return sp;
-    }
-
-    g_source_set_callback(source, (GSourceFunc) &SourceClient::OnIncomingData,
-                          new WeakKeepAlive<SourceClient>{sp},
-                          [](gpointer data) { delete static_cast<WeakKeepAlive<SourceClient>*>(data); });
-    socket_source_ = g_source_attach(source, nullptr);
-    if (socket_source_ == 0) {
-        AC_WARNING("Failed to attach source to mainloop");
-        g_source_unref(source);
-        return sp;
-    }
-
-    auto udp_stream = std::make_shared<ac::network::UdpStream>();
-
-    media_manager_ = MediaManagerFactory::CreateSource(peer_address, udp_stream);
+    peer_address_ = g_inet_address_to_string(G_INET_ADDRESS(inet_address));
+
+    // A slow sink must stall neither the session thread nor (worse)
+    // a blocking send; partial writes land in send_buffer_ and get
+    // flushed by the pump.
+    g_socket_set_blocking(socket_.get(), FALSE);
+
+    // RTSP keep-alives share the airtime with the stream itself; with
+    // the same video-class marking as the media sockets a congested
+    // best-effort queue can no longer delay them into a session
+    // timeout. Both failures are non-fatal.
+    const int fd = g_socket_get_fd(socket_.get());
+    int tos = kVideoTos;
+    if (::setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0)
+        AC_WARNING("Failed to set ToS marking on RTSP socket: %s (%d)", ::strerror(errno), errno);
+
+    int priority = kVideoSocketPriority;
+    if (::setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority)) < 0)
+        AC_WARNING("Failed to set priority on RTSP socket: %s (%d)", ::strerror(errno), errno);
+
+    // The io_uring backed stream batches all sends through one
+    // submission queue; it is opt-in until we have enough mileage on
+    // the kernels we ship.
+    std::shared_ptr<ac::network::Stream> udp_stream;
+    if (Utils::GetEnvValue("AETHERCAST_RTP_TRANSPORT") == "tcp")
+        udp_stream = std::make_shared<ac::network::TcpStream>();
+    else if (Utils::IsEnvSet("AETHERCAST_UDP_IO_URING") && ac::network::UringStream::IsSupported())
+        udp_stream = std::make_shared<ac::network::UringStream>();
+    else
+        udp_stream = std::make_shared<ac::network::UdpStream>();
+
+    media_manager_ = MediaManagerFactory::CreateSource(peer_address_, udp_stream);
     media_manager_->SetDelegate(shared_from_this());
     source_.reset(wds::Source::Create(this, media_manager_.get(), this));
 
     source_->Start();
+
+    // From here on the session is driven from its own thread so
+    // keep-alive responses cannot fall behind D-Bus or discovery
+    // traffic on the main loop.
+    rtsp_executor_ = std::make_shared<common::ThreadedExecutor>(
+        std::make_shared<RTSPPump>(std::weak_ptr<SourceClient>{sp}));
+    rtsp_executor_->Start();
+
     return sp;
 }
 
 void SourceClient::NotifyConnectionClosed() {
-    if (auto sp = delegate_.lock())
-        sp->OnConnectionClosed();
+    // Delegates (and everything they tear down) live on the main
+    // loop; hop over instead of calling them from the RTSP thread.
+    g_idle_add([](gpointer user_data) -> gboolean {
+        const auto inst = static_cast<WeakKeepAlive<SourceClient>*>(user_data)->ShouldDie().lock();
+        if (!inst)
+            return FALSE;
+
+        if (auto sp = inst->delegate_.lock())
+            sp->OnConnectionClosed(inst);
+
+        return FALSE;
+    }, new WeakKeepAlive<SourceClient>{shared_from_this()});
 }
 
 void SourceClient::OnSourceNetworkError() {
-    NotifyConnectionClosed();
+    // A renegotiating P2P group (power-save glitch, channel switch)
+    // looks exactly like a dead network for well under a second, but
+    // tearing the session down turns it into a ~10s reconnect. Hold
+    // the session instead and keep re-validating the transport; only
+    // when the window passes without the sink coming back does the
+    // session close for real. Reconnect state lives on the main loop
+    // like the rest of the session teardown machinery, so hop over.
+    g_idle_add([](gpointer user_data) -> gboolean {
+        const auto inst = static_cast<WeakKeepAlive<SourceClient>*>(user_data)->ShouldDie().lock();
+        if (!inst)
+            return FALSE;
+
+        inst->StartReconnectWindow();
+        return FALSE;
+    }, new WeakKeepAlive<SourceClient>{shared_from_this()});
+}
+
+void SourceClient::StartReconnectWindow() {
+    // Errors arriving while recovery is already running just mark the
+    // last attempt as failed; the periodic source keeps retrying.
+    if (reconnect_timeout_ > 0) {
+        transport_failed_ = true;
+        return;
+    }
+
+    if (!media_manager_ || peer_address_.empty()) {
+        NotifyConnectionClosed();
+        return;
+    }
+
+    AC_WARNING("Transport to %s failed; holding session for up to %u ms while the link resettles",
+               peer_address_, kReconnectWindowMs);
+
+    reconnect_deadline_ = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds{kReconnectWindowMs};
+    transport_failed_ = true;
+
+    reconnect_timeout_ = g_timeout_add_full(G_PRIORITY_DEFAULT, kReconnectRetryMs,
+                                            [](gpointer user_data) -> gboolean {
+        // The source is periodic so the trampoline has to survive
+        // into the next tick; the destroy notify below owns it.
+        const auto inst = static_cast<WeakKeepAlive<SourceClient>*>(user_data)->GetInstance().lock();
+        if (!inst)
+            return FALSE;
+
+        return inst->TryReconnect() ? TRUE : FALSE;
+    }, new WeakKeepAlive<SourceClient>{shared_from_this()}, [](gpointer user_data) {
+        delete static_cast<WeakKeepAlive<SourceClient>*>(user_data);
+    });
+}
+
+bool SourceClient::TryReconnect() {
+    // A whole retry period without a new transport error means the
+    // sender is putting packets on the wire again; recovery is done.
+    if (!transport_failed_) {
+        AC_INFO("Session transport to %s recovered", peer_address_);
+        reconnect_timeout_ = 0;
+        return false;
+    }
+
+    if (std::chrono::steady_clock::now() >= reconnect_deadline_) {
+        AC_ERROR("Sink did not come back within the reconnect window; disconnecting");
+        reconnect_timeout_ = 0;
+        NotifyConnectionClosed();
+        return false;
+    }
+
+    // Re-point the transport (the address is re-resolved on the way)
+    // and un-latch the sender; whether the sink is really back shows
+    // up as the presence or absence of further errors before the next
+    // tick.
+    transport_failed_ = false;
+    if (!media_manager_->RetargetPeer(peer_address_))
+        transport_failed_ = true;
+
+    return true;
 }
 
 void SourceClient::ErrorOccurred(wds::ErrorType error) {
@@ -244,6 +449,17 @@ void SourceClient::ErrorOccurred(wds::ErrorType error) {
 
 void SourceClient::SessionCompleted() {
     AC_DEBUG("");
+
+    g_idle_add([](gpointer user_data) -> gboolean {
+        const auto inst = static_cast<WeakKeepAlive<SourceClient>*>(user_data)->ShouldDie().lock();
+        if (!inst)
+            return FALSE;
+
+        if (auto sp = inst->delegate_.lock())
+            sp->OnRtspSessionEstablished(inst);
+
+        return FALSE;
+    }, new WeakKeepAlive<SourceClient>{shared_from_this()});
 }
 
 } // namespace ac
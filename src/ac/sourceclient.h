@@ -20,14 +20,18 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <chrono>
 #include <string>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <vector>
 
 #include <wds/peer.h>
 #include <wds/source.h>
 #include <wds/media_manager.h>
 
+#include "ac/common/threadedexecutor.h"
 #include "ac/glib_wrapper.h"
 #include "ac/ip_v4_address.h"
 #include "ac/non_copyable.h"
@@ -35,8 +39,6 @@
 #include "ac/basesourcemediamanager.h"
 
 namespace ac {
-class TimerCallbackData;
-
 class SourceClient : public std::enable_shared_from_this<SourceClient>,
                      public wds::Peer::Delegate,
                      public wds::Peer::Observer,
@@ -44,7 +46,12 @@ class SourceClient : public std::enable_shared_from_this<SourceClient>,
 public:
     class Delegate : private ac::NonCopyable {
     public:
-        virtual void OnConnectionClosed() = 0;
+        // Carries the closing client so a delegate hosting several
+        // concurrent sessions can tell them apart.
+        virtual void OnConnectionClosed(const std::shared_ptr<SourceClient> &client) = 0;
+        // Fired once the RTSP negotiation with the sink finished and
+        // the media session is up and streaming.
+        virtual void OnRtspSessionEstablished(const std::shared_ptr<SourceClient> &client) = 0;
     };
 
     static std::shared_ptr<SourceClient> Create(ScopedGObject<GSocket>&& socket, const ac::IpV4Address &local_address);
@@ -68,30 +75,61 @@ public:
     void SessionCompleted() override;
 
 public:
-    static gboolean OnTimeout(gpointer user_data);
-    static void OnTimeoutRemove(gpointer user_data);
-    static gboolean OnIncomingData(GSocket *socket, GIOCondition condition,
-                                     gpointer user_data);
+    // Runs one iteration of RTSP socket I/O and timer dispatch on the
+    // dedicated session thread; only the pump executable calls this.
+    bool PumpRTSPSession();
 
 private:
     SourceClient(ScopedGObject<GSocket>&& socket, const ac::IpV4Address &local_address);
     std::shared_ptr<SourceClient> FinalizeConstruction();
 
     void DumpRtsp(const std::string &prefix, const std::string &data);
+    void FlushPendingSendData();
+    void ProcessExpiredTimers();
     void ReleaseTimers();
     void NotifyConnectionClosed();
+    // Opens the bounded window during which transport errors are
+    // answered with retarget attempts instead of session teardown;
+    // only ever called on the main loop.
+    void StartReconnectWindow();
+    // One periodic recovery attempt; returns false once the window is
+    // over (either recovered or given up).
+    bool TryReconnect();
+
+private:
+    // One-shot wds session timer, fired from the session thread once
+    // its deadline passed
+    struct Timer {
+        guint id;
+        std::chrono::steady_clock::time_point deadline;
+    };
 
 private:
     std::weak_ptr<Delegate> delegate_;
     ScopedGObject<GSocket> socket_;
-    guint socket_source_;
     ac::IpV4Address local_address_;
-    std::vector<guint> timers_;
+    std::mutex timers_mutex_;
+    std::vector<Timer> timers_;
+    // Outgoing bytes the non-blocking socket did not take yet; the
+    // capacity is kept across messages so steady-state sends do not
+    // allocate.
+    std::vector<char> send_buffer_;
+    guint next_timer_id_;
+    // Address the sink's RTSP connection came in from; the reconnect
+    // path retargets the media transport back at it.
+    std::string peer_address_;
+    // Non-zero while the reconnect window suppresses teardown; id of
+    // the periodic recovery source on the main loop.
+    guint reconnect_timeout_;
+    std::chrono::steady_clock::time_point reconnect_deadline_;
+    // Whether another transport error arrived since the last retarget
+    // attempt; cleared before each attempt, so a quiet period means
+    // the session recovered.
+    bool transport_failed_;
     std::unique_ptr<wds::Source> source_;
     std::shared_ptr<BaseSourceMediaManager> media_manager_;
+    std::shared_ptr<ac::common::ThreadedExecutor> rtsp_executor_;
     guint watch_;
-
-    friend class TimerCallbackData;
 };
 } // namespace ac
 #endif
@@ -15,6 +15,10 @@
  *
  */
 
+#include <algorithm>
+
+#include <boost/concept_check.hpp>
+
 #include "ac/keep_alive.h"
 #include "ac/logger.h"
 #include "ac/sourcemanager.h"
@@ -22,16 +26,17 @@
 #include "ac/logger.h"
 
 namespace ac {
-std::shared_ptr<SourceManager> SourceManager::Create(const ac::IpV4Address &address, unsigned short port) {
-    auto sp = std::shared_ptr<SourceManager>{new SourceManager{}};
+std::shared_ptr<SourceManager> SourceManager::Create(const ac::IpV4Address &address, unsigned short port,
+                                                     unsigned int max_sessions) {
+    auto sp = std::shared_ptr<SourceManager>{new SourceManager{max_sessions}};
     sp->Setup(address, port);
     return sp;
 }
 
-SourceManager::SourceManager() :
-    active_sink_(nullptr),
+SourceManager::SourceManager(unsigned int max_sessions) :
     socket_(nullptr),
-    socket_source_(0) {
+    socket_source_(0),
+    max_sessions_(max_sessions > 0 ? max_sessions : 1) {
 }
 
 SourceManager::~SourceManager() {
@@ -125,21 +130,48 @@ gboolean SourceManager::OnNewConnection(GSocket *socket, GIOCondition  cond, gpo
         return TRUE;
     }
 
-    // If we add support for a coupled sink some day we can allow
-    // more than one client to connect here.
-    if (inst->active_sink_) {
+    // Each session runs its own RTSP negotiation and media pipeline,
+    // so the only hard limit is what the encode hardware sustains;
+    // beyond that we refuse instead of degrading every running session.
+    if (inst->active_sinks_.size() >= inst->max_sessions_) {
+        AC_INFO("Refusing additional sink; all %d encode sessions are in use",
+                inst->max_sessions_);
         g_socket_close(client_socket, nullptr);
         g_object_unref(client_socket);
         return TRUE;
     }
 
-    inst->active_sink_ = SourceClient::Create(ScopedGObject<GSocket>{client_socket}, inst->local_address_);
-    inst->active_sink_->SetDelegate(inst->shared_from_this());
+    auto sink = SourceClient::Create(ScopedGObject<GSocket>{client_socket}, inst->local_address_);
+    sink->SetDelegate(inst->shared_from_this());
+    inst->active_sinks_.push_back(sink);
+
+    AC_DEBUG("Accepted sink connection; %d of %d sessions in use",
+             inst->active_sinks_.size(), inst->max_sessions_);
 
     return TRUE;
 }
 
-void SourceManager::OnConnectionClosed() {
+std::size_t SourceManager::SessionCount() const {
+    return active_sinks_.size();
+}
+
+void SourceManager::OnRtspSessionEstablished(const std::shared_ptr<SourceClient> &client) {
+    boost::ignore_unused_variable_warning(client);
+
+    if (auto sp = delegate_.lock())
+        sp->OnRtspSessionEstablished();
+}
+
+void SourceManager::OnConnectionClosed(const std::shared_ptr<SourceClient> &client) {
+    const auto it = std::find(active_sinks_.begin(), active_sinks_.end(), client);
+    if (it != active_sinks_.end())
+        active_sinks_.erase(it);
+
+    // The service only cares once the last session ended; a single
+    // sink dropping out must not tear down the remaining ones.
+    if (!active_sinks_.empty())
+        return;
+
     if (auto sp = delegate_.lock())
         sp->OnClientDisconnected();
 }
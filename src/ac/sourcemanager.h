@@ -19,6 +19,7 @@
 #define MIRACASTSOURCE_H_
 
 #include <memory>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 
@@ -34,25 +35,33 @@ public:
     class Delegate : private ac::NonCopyable {
     public:
         virtual void OnClientDisconnected() = 0;
+        virtual void OnRtspSessionEstablished() = 0;
 
     protected:
         Delegate() = default;
     };
 
-    static std::shared_ptr<SourceManager> Create(const ac::IpV4Address &address, unsigned short port);
+    // max_sessions caps the number of concurrent sinks; each session
+    // runs its own media pipeline so the cap has to match what the
+    // encode hardware can actually sustain.
+    static std::shared_ptr<SourceManager> Create(const ac::IpV4Address &address, unsigned short port,
+                                                 unsigned int max_sessions = 1);
 
     ~SourceManager();
 
     void SetDelegate(const std::weak_ptr<Delegate> &delegate);
     void ResetDelegate();
 
+    std::size_t SessionCount() const;
+
 public:
-    void OnConnectionClosed();
+    void OnConnectionClosed(const std::shared_ptr<SourceClient> &client);
+    void OnRtspSessionEstablished(const std::shared_ptr<SourceClient> &client);
 
 private:
     static gboolean OnNewConnection(GSocket *socket, GIOCondition  cond, gpointer user_data);
 
-    SourceManager();
+    SourceManager(unsigned int max_sessions);
 
     bool Setup(const ac::IpV4Address &address, unsigned short port);
 
@@ -60,7 +69,8 @@ private:
     std::weak_ptr<Delegate> delegate_;
     ScopedGObject<GSocket> socket_;
     guint socket_source_;
-    std::shared_ptr<SourceClient> active_sink_;
+    std::vector<std::shared_ptr<SourceClient>> active_sinks_;
+    unsigned int max_sessions_;
     ac::IpV4Address local_address_;
 };
 } // namespace ac
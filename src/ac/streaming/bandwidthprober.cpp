@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "ac/logger.h"
+
+#include "ac/streaming/bandwidthprober.h"
+
+namespace {
+static constexpr unsigned int kRTPHeaderSize{12};
+static constexpr unsigned int kRTPPayloadTypeMP2T = 33;
+// RTP signals the padding amount in a single trailing byte, so 255
+// octets is the biggest padding-only packet there is; the burst is
+// made of many of those rather than few MTU sized ones.
+static constexpr unsigned int kProbePaddingSize{255};
+// Distinct from the media stream's SSRC so the probe's sequence
+// numbers never register as loss against the actual session.
+static constexpr unsigned int kProbeSourceID = 0xfeedface;
+// Long enough to outgrow the sink's socket buffers and see real link
+// behaviour, short enough to hide inside the RTSP exchange.
+static constexpr ac::TimestampUs kProbeDurationUs = 250000ll;
+// Sinks schedule their receiver reports on the usual RTCP interval;
+// waiting out half a second covers one of them.
+static constexpr ac::TimestampUs kFeedbackTimeoutUs = 500000ll;
+static constexpr uint8_t kPacketTypeReceiverReport = 201;
+}
+
+namespace ac {
+namespace streaming {
+
+BandwidthProber::BandwidthProber(const network::Stream::Ptr &stream) :
+    stream_(stream),
+    feedback_socket_(-1) {
+}
+
+BandwidthProber::~BandwidthProber() {
+    CloseFeedbackSocket();
+}
+
+bool BandwidthProber::OpenFeedbackSocket() {
+    feedback_socket_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (feedback_socket_ < 0) {
+        AC_ERROR("Failed to create probe feedback socket: %s (%d)",
+                 ::strerror(errno), errno);
+        return false;
+    }
+
+    // By symmetric RTCP convention the sink reports to the port right
+    // above our RTP port; the session's RTCPReceiver binds the same
+    // port later, after the prober has closed it again.
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(stream_->LocalPort() + 1);
+
+    if (::bind(feedback_socket_, reinterpret_cast<struct sockaddr*>(&addr),
+               sizeof(addr)) < 0) {
+        AC_ERROR("Failed to bind probe feedback socket: %s (%d)",
+                 ::strerror(errno), errno);
+        CloseFeedbackSocket();
+        return false;
+    }
+
+    return true;
+}
+
+void BandwidthProber::CloseFeedbackSocket() {
+    if (feedback_socket_ < 0)
+        return;
+
+    ::close(feedback_socket_);
+    feedback_socket_ = -1;
+}
+
+BandwidthProber::Result BandwidthProber::Probe(unsigned int probe_bitrate) {
+    Result result;
+
+    if (!stream_ || probe_bitrate == 0)
+        return result;
+
+    if (!OpenFeedbackSocket())
+        return result;
+
+    // Padding-only RTP packet (RFC 3550 5.1): receivers count it in
+    // their reception statistics but discard the content, so nothing
+    // of the burst ever reaches the sink's TS demuxer.
+    uint8_t packet[kRTPHeaderSize + kProbePaddingSize];
+    std::memset(packet, 0, sizeof(packet));
+    packet[0] = 0x80 | 0x20; // version 2, padding bit
+    packet[1] = kRTPPayloadTypeMP2T;
+    packet[8] = kProbeSourceID >> 24;
+    packet[9] = (kProbeSourceID >> 16) & 0xff;
+    packet[10] = (kProbeSourceID >> 8) & 0xff;
+    packet[11] = kProbeSourceID & 0xff;
+    packet[sizeof(packet) - 1] = kProbePaddingSize;
+
+    const std::uint64_t interval_us =
+            (sizeof(packet) * 8 * 1000000ull) / probe_bitrate;
+    const auto start = static_cast<ac::TimestampUs>(ac::Utils::GetNowUs());
+    unsigned int sent = 0;
+
+    // Clock-driven pacing: each pass sends whatever the elapsed time
+    // says is due and then sleeps one packet interval, so scheduler
+    // hiccups shift packets within the burst without changing its
+    // overall rate.
+    while (true) {
+        const auto elapsed = static_cast<ac::TimestampUs>(ac::Utils::GetNowUs()) - start;
+        if (elapsed >= kProbeDurationUs)
+            break;
+
+        while (static_cast<std::uint64_t>(sent) * interval_us
+                    <= static_cast<std::uint64_t>(elapsed)) {
+            packet[2] = (sent >> 8) & 0xff;
+            packet[3] = sent & 0xff;
+
+            const uint32_t rtp_time = ((start + elapsed) * 9) / 100ll;
+            packet[4] = rtp_time >> 24;
+            packet[5] = (rtp_time >> 16) & 0xff;
+            packet[6] = (rtp_time >> 8) & 0xff;
+            packet[7] = rtp_time & 0xff;
+
+            if (stream_->Write(packet, sizeof(packet)) != network::Stream::Error::kNone) {
+                CloseFeedbackSocket();
+                return result;
+            }
+
+            sent++;
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+    }
+
+    if (sent == 0) {
+        CloseFeedbackSocket();
+        return result;
+    }
+
+    result = AwaitFeedback(sent, probe_bitrate);
+
+    CloseFeedbackSocket();
+    return result;
+}
+
+BandwidthProber::Result BandwidthProber::AwaitFeedback(unsigned int packets_sent,
+                                                       unsigned int probe_bitrate) {
+    Result result;
+
+    const auto deadline = static_cast<ac::TimestampUs>(ac::Utils::GetNowUs())
+            + kFeedbackTimeoutUs;
+
+    while (true) {
+        const auto remaining = deadline
+                - static_cast<ac::TimestampUs>(ac::Utils::GetNowUs());
+        if (remaining <= 0)
+            break;
+
+        struct pollfd fd;
+        fd.fd = feedback_socket_;
+        fd.events = POLLIN;
+
+        if (::poll(&fd, 1, remaining / 1000 + 1) <= 0)
+            continue;
+
+        uint8_t data[1024];
+        const auto bytes = ::recv(feedback_socket_, data, sizeof(data), 0);
+        if (bytes <= 0)
+            continue;
+
+        // Walk the compound packet for a receiver report; its first
+        // report block covers the whole burst as it is the first
+        // report of the session.
+        const auto size = static_cast<size_t>(bytes);
+        size_t offset = 0;
+        while (offset + 4 <= size) {
+            const uint8_t *chunk = data + offset;
+
+            if (chunk[0] >> 6 != 2)
+                break;
+
+            const auto format = chunk[0] & 0x1f;
+            const auto packet_type = chunk[1];
+            const size_t length = ((chunk[2] << 8 | chunk[3]) + 1) * 4;
+
+            if (offset + length > size)
+                break;
+
+            if (packet_type == kPacketTypeReceiverReport
+                    && format > 0 && 8 + 24 <= length) {
+                const uint32_t cumulative_lost = chunk[8 + 5] << 16 |
+                                                 chunk[8 + 6] << 8 |
+                                                 chunk[8 + 7];
+
+                const auto delivered = packets_sent
+                        - std::min(cumulative_lost, static_cast<uint32_t>(packets_sent));
+
+                result.valid = true;
+                result.bitrate = static_cast<unsigned int>(
+                            static_cast<std::uint64_t>(probe_bitrate) * delivered / packets_sent);
+
+                AC_DEBUG("Probe burst of %d packets came back with %d lost; estimating %d bit/s",
+                         packets_sent, cumulative_lost, result.bitrate);
+
+                return result;
+            }
+
+            offset += length;
+        }
+    }
+
+    AC_DEBUG("No receiver report for the probe burst within the timeout");
+
+    return result;
+}
+
+} // namespace streaming
+} // namespace ac
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_BANDWIDTHPROBER_H_
+#define AC_STREAMING_BANDWIDTHPROBER_H_
+
+#include <memory>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/network/stream.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Measures the usable link capacity before the stream starts.
+ *
+ * Sends a short paced burst of padding-only RTP packets at the rate
+ * the session is about to use and reads the sink's RTCP receiver
+ * report for how much of it actually arrived. The estimate seeds the
+ * initial encoder bitrate so a session on a weak link starts near its
+ * real operating point instead of ramping down from the static
+ * default over the first minute of visible artifacts.
+ *
+ * Strictly best-effort: a sink which has not bound its RTP port yet
+ * or never reports on padding-only traffic simply times the probe
+ * out and the session starts from the default as before.
+ */
+class BandwidthProber : public ac::NonCopyable {
+public:
+    struct Result {
+        // False when no receiver report arrived before the timeout;
+        // bitrate carries no information then.
+        bool valid = false;
+        // Estimated delivered rate in bit/s
+        unsigned int bitrate = 0;
+    };
+
+    explicit BandwidthProber(const network::Stream::Ptr &stream);
+    ~BandwidthProber();
+
+    // Sends the probe burst at probe_bitrate bit/s and blocks until
+    // the sink's feedback arrives or the timeout expires; bounded by
+    // probe duration plus feedback timeout, well under a second.
+    Result Probe(unsigned int probe_bitrate);
+
+private:
+    bool OpenFeedbackSocket();
+    void CloseFeedbackSocket();
+    Result AwaitFeedback(unsigned int packets_sent, unsigned int probe_bitrate);
+
+private:
+    network::Stream::Ptr stream_;
+    // Listens on the RTP port + 1 for the sink's report; closed again
+    // before the session's RTCPReceiver takes the same port over.
+    int feedback_socket_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
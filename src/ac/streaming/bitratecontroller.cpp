@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include <boost/concept_check.hpp>
+
+#include "ac/logger.h"
+
+#include "ac/streaming/bitratecontroller.h"
+
+namespace {
+// Loss above ~2% (in 1/256 units as RTCP reports it) triggers a ramp down
+static constexpr uint8_t kLossThreshold = 5;
+// Multiplicative decrease on loss, additive-ish increase when clean
+static constexpr double kDecreaseFactor = 0.75;
+static constexpr double kIncreaseFactor = 1.05;
+// Number of consecutive clean reports before we probe for more bandwidth
+static constexpr unsigned int kCleanReportsBeforeIncrease = 4;
+// Don't adjust more often than once a second to let the encoder settle
+static constexpr ac::TimestampUs kMinAdjustmentIntervalUs = 1000000ll;
+// Never go below this even on heavy loss; the stream becomes useless
+static constexpr unsigned int kMinBitrate = 512000;
+// A sane mux never wastes more than this on stuffing; anything above
+// points at a measurement glitch rather than real overhead
+static constexpr double kMaxMuxOverhead = 0.25;
+}
+
+namespace ac {
+namespace streaming {
+
+BitrateController::BitrateController(const video::BaseEncoder::Ptr &encoder,
+                                     unsigned int max_bitrate) :
+    encoder_(encoder),
+    max_bitrate_(max_bitrate),
+    mux_overhead_(0.0),
+    current_bitrate_(max_bitrate),
+    link_ceiling_(0),
+    clean_reports_(0),
+    last_change_us_(0),
+    supported_(true) {
+}
+
+void BitrateController::SetStartingBitrate(unsigned int bitrate) {
+    current_bitrate_ = std::max(kMinBitrate, std::min(bitrate, max_bitrate_));
+    clean_reports_ = 0;
+}
+
+void BitrateController::SetMuxOverhead(double fraction) {
+    mux_overhead_ = std::max(0.0, std::min(fraction, kMaxMuxOverhead));
+}
+
+void BitrateController::SetLinkCeiling(unsigned int bits_per_second) {
+    std::lock_guard<std::mutex> g(lock_);
+
+    link_ceiling_ = bits_per_second;
+
+    if (link_ceiling_ == 0 || !encoder_ || !supported_)
+        return;
+
+    const auto capped = std::max(kMinBitrate, std::min(current_bitrate_, link_ceiling_));
+    if (capped >= current_bitrate_)
+        return;
+
+    // The radio got worse before the sink could tell us; don't sit on
+    // the current rate until the loss shows up in a receiver report.
+    if (!encoder_->SetTargetBitrate(capped)) {
+        AC_WARNING("Encoder does not support mid-session bitrate changes");
+        supported_ = false;
+        return;
+    }
+
+    AC_DEBUG("Link capacity dropped; adjusted encoder bitrate %d -> %d bit/s",
+             current_bitrate_, capped);
+
+    current_bitrate_ = capped;
+    clean_reports_ = 0;
+    last_change_us_ = ac::Utils::GetNowUs();
+}
+
+void BitrateController::ProcessFeedback(uint8_t fraction_lost, uint32_t jitter) {
+    boost::ignore_unused_variable_warning(jitter);
+
+    std::lock_guard<std::mutex> g(lock_);
+
+    if (!encoder_ || !supported_)
+        return;
+
+    const auto now = ac::Utils::GetNowUs();
+    if (now - last_change_us_ < kMinAdjustmentIntervalUs)
+        return;
+
+    unsigned int target = current_bitrate_;
+
+    if (fraction_lost > kLossThreshold) {
+        clean_reports_ = 0;
+        target = std::max(kMinBitrate,
+                          static_cast<unsigned int>(current_bitrate_ * kDecreaseFactor));
+    } else {
+        clean_reports_++;
+        if (clean_reports_ < kCleanReportsBeforeIncrease)
+            return;
+
+        clean_reports_ = 0;
+        // The ceiling leaves room for the measured mux stuffing so
+        // payload plus padding stays within the negotiated rate, and
+        // never probes past what the radio currently carries
+        auto ceiling = static_cast<unsigned int>(
+                    max_bitrate_ * (1.0 - mux_overhead_));
+        if (link_ceiling_ > 0)
+            ceiling = std::min(ceiling, link_ceiling_);
+        target = std::min(std::max(ceiling, kMinBitrate),
+                          static_cast<unsigned int>(current_bitrate_ * kIncreaseFactor));
+    }
+
+    if (target == current_bitrate_)
+        return;
+
+    if (!encoder_->SetTargetBitrate(target)) {
+        // Backend can't do it; no point in trying again for every report
+        AC_WARNING("Encoder does not support mid-session bitrate changes");
+        supported_ = false;
+        return;
+    }
+
+    AC_DEBUG("Adjusted encoder bitrate %d -> %d bit/s (fraction lost %d/256)",
+             current_bitrate_, target, fraction_lost);
+
+    current_bitrate_ = target;
+    last_change_us_ = now;
+}
+
+} // namespace streaming
+} // namespace ac
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_BITRATECONTROLLER_H_
+#define AC_STREAMING_BITRATECONTROLLER_H_
+
+#include <memory>
+#include <mutex>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/baseencoder.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Drives the encoder target bitrate from RTCP receiver report
+ * feedback.
+ *
+ * Follows the usual additive-increase/multiplicative-decrease scheme:
+ * reported loss cuts the bitrate, a run of clean reports slowly ramps
+ * it back up towards the configured maximum. Does nothing when the
+ * encoder backend cannot reconfigure its bitrate mid-session.
+ */
+class BitrateController : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<BitrateController> Ptr;
+
+    BitrateController(const video::BaseEncoder::Ptr &encoder,
+                      unsigned int max_bitrate);
+
+    void ProcessFeedback(uint8_t fraction_lost, uint32_t jitter);
+
+    // Seeds the working point the AIMD loop continues from, e.g.
+    // with a session-start link probe's estimate. The ceiling stays
+    // at the configured maximum so clean reports can still ramp past
+    // the estimate; callers configure the encoder with the same value
+    // themselves.
+    void SetStartingBitrate(unsigned int bitrate);
+
+    // Fraction of the transport stream spent on mux stuffing; the
+    // controller deducts it from the bitrate ceiling so encoder
+    // payload plus padding stays within the negotiated rate.
+    void SetMuxOverhead(double fraction);
+
+    // Caps the working point at what the local radio currently
+    // carries (from the link monitor's station statistics); dropping
+    // it below the current bitrate ramps down right away instead of
+    // waiting for the resulting loss to show up in a receiver report
+    // seconds later. 0 removes the cap. Callable from any thread.
+    void SetLinkCeiling(unsigned int bits_per_second);
+
+    unsigned int CurrentBitrate() const { return current_bitrate_; }
+
+private:
+    video::BaseEncoder::Ptr encoder_;
+    unsigned int max_bitrate_;
+    double mux_overhead_;
+    unsigned int current_bitrate_;
+    unsigned int link_ceiling_;
+    unsigned int clean_reports_;
+    ac::TimestampUs last_change_us_;
+    bool supported_;
+    // RTCP feedback and link estimates arrive on different threads
+    std::mutex lock_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
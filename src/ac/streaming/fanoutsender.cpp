@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "ac/logger.h"
+
+#include "ac/streaming/fanoutsender.h"
+
+namespace ac {
+namespace streaming {
+
+FanoutSender::SinkErrorForwarder::SinkErrorForwarder(
+        const std::weak_ptr<FanoutSender> &parent,
+        const std::weak_ptr<TransportSender> &sender) :
+    parent_(parent),
+    sender_(sender) {
+}
+
+void FanoutSender::SinkErrorForwarder::OnTransportNetworkError() {
+    const auto parent = parent_.lock();
+    const auto sender = sender_.lock();
+    if (!parent || !sender)
+        return;
+
+    parent->HandleSinkError(sender);
+}
+
+FanoutSender::Ptr FanoutSender::Create() {
+    return std::shared_ptr<FanoutSender>(new FanoutSender);
+}
+
+FanoutSender::~FanoutSender() {
+}
+
+bool FanoutSender::AddSender(const TransportSender::Ptr &sender) {
+    if (!sender)
+        return false;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    for (const auto &sink : sinks_) {
+        if (sink.sender == sender)
+            return false;
+    }
+
+    auto forwarder = std::make_shared<SinkErrorForwarder>(
+                shared_from_this(), sender);
+    sender->SetDelegate(forwarder);
+
+    sinks_.push_back(Sink{sender, forwarder});
+
+    return true;
+}
+
+bool FanoutSender::RemoveSender(const TransportSender::Ptr &sender) {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    const auto it = std::find_if(sinks_.begin(), sinks_.end(),
+            [&](const Sink &sink) { return sink.sender == sender; });
+    if (it == sinks_.end())
+        return false;
+
+    it->sender->ResetDelegate();
+    sinks_.erase(it);
+
+    return true;
+}
+
+std::size_t FanoutSender::SenderCount() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return sinks_.size();
+}
+
+bool FanoutSender::Queue(const ac::video::Buffer::Ptr &packets) {
+    // Every sink gets the very same buffer; the senders only read from
+    // it so the fan-out never has to copy the payload.
+    std::vector<TransportSender::Ptr> senders;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto &sink : sinks_)
+            senders.push_back(sink.sender);
+    }
+
+    bool any_queued = false;
+    for (const auto &sender : senders)
+        any_queued |= sender->Queue(packets);
+
+    return any_queued;
+}
+
+int32_t FanoutSender::LocalPort() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    if (sinks_.empty())
+        return 0;
+
+    return sinks_.front().sender->LocalPort();
+}
+
+void FanoutSender::HandleSinkError(const TransportSender::Ptr &sender) {
+    std::size_t remaining = 0;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+
+        const auto it = std::find_if(sinks_.begin(), sinks_.end(),
+                [&](const Sink &sink) { return sink.sender == sender; });
+        if (it == sinks_.end())
+            return;
+
+        sinks_.erase(it);
+        remaining = sinks_.size();
+    }
+
+    AC_WARNING("Sink transport failed; %d sinks remaining", remaining);
+
+    // The session as a whole only failed once nobody is left listening
+    if (remaining == 0) {
+        if (auto sp = delegate_.lock())
+            sp->OnTransportNetworkError();
+    }
+}
+
+} // namespace streaming
+} // namespace ac
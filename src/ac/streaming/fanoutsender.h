@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_FANOUTSENDER_H_
+#define AC_STREAMING_FANOUTSENDER_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ac/streaming/transportsender.h"
+
+namespace ac {
+namespace streaming {
+
+// Shares one packetized transport stream across multiple sink
+// transports so mirroring to N displays costs one capture and encode
+// plus N sends. Each sink keeps its own sequence numbers, pacing and
+// retransmission state through its underlying sender; a failing sink
+// is dropped on its own and the session only errors out once the last
+// one is gone.
+class FanoutSender : public std::enable_shared_from_this<FanoutSender>,
+                     public TransportSender {
+public:
+    typedef std::shared_ptr<FanoutSender> Ptr;
+
+    static Ptr Create();
+
+    ~FanoutSender();
+
+    // Takes over error handling for the given sender; its previous
+    // delegate is replaced.
+    bool AddSender(const TransportSender::Ptr &sender);
+    bool RemoveSender(const TransportSender::Ptr &sender);
+
+    std::size_t SenderCount() const;
+
+    // From ac::streaming::TransportSender
+    bool Queue(const ac::video::Buffer::Ptr &packets) override;
+    // The port of the first sink added; per-sink ports come from the
+    // individual senders during session negotiation.
+    int32_t LocalPort() const override;
+
+private:
+    // Routes a child's anonymous network error back to the fan-out
+    // with the failing sink attached.
+    class SinkErrorForwarder : public TransportSender::Delegate {
+    public:
+        SinkErrorForwarder(const std::weak_ptr<FanoutSender> &parent,
+                           const std::weak_ptr<TransportSender> &sender);
+
+        void OnTransportNetworkError() override;
+
+    private:
+        std::weak_ptr<FanoutSender> parent_;
+        std::weak_ptr<TransportSender> sender_;
+    };
+
+    struct Sink {
+        TransportSender::Ptr sender;
+        std::shared_ptr<SinkErrorForwarder> forwarder;
+    };
+
+    FanoutSender() = default;
+
+    void HandleSinkError(const TransportSender::Ptr &sender);
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Sink> sinks_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
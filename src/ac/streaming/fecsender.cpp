@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "ac/logger.h"
+#include "ac/utils.h"
+
+#include "ac/streaming/fecsender.h"
+
+namespace {
+static constexpr unsigned int kRTPHeaderSize{12};
+// Distinct source id and a dynamic payload type keep the parity flow
+// trivially separable from the MP2T media flow.
+static constexpr unsigned int kParitySourceID{0xfec0fec0};
+static constexpr unsigned int kRTPPayloadTypeParity{127};
+// One parity packet per ten media packets costs ~10% extra bitrate
+// and rides out the 1-3% steady loss we see on 2.4GHz-only sinks.
+static constexpr unsigned int kDefaultGroupSize{10};
+static constexpr const char *kGroupSizeEnvName{"AETHERCAST_FEC_GROUP_SIZE"};
+// Follows the RTP header: group sequence (2), group size (1),
+// reserved (1), length recovery (2), reserved (2).
+static constexpr unsigned int kFECHeaderSize{8};
+
+// Word-wide XOR which the compiler turns into NEON/SSE on the targets
+// we build for; memcpy keeps it free of alignment assumptions.
+void XorInto(uint8_t *dst, const uint8_t *src, std::size_t size) {
+    std::size_t n = 0;
+    for (; n + sizeof(std::uint64_t) <= size; n += sizeof(std::uint64_t)) {
+        std::uint64_t lhs, rhs;
+        ::memcpy(&lhs, dst + n, sizeof(lhs));
+        ::memcpy(&rhs, src + n, sizeof(rhs));
+        lhs ^= rhs;
+        ::memcpy(dst + n, &lhs, sizeof(lhs));
+    }
+    for (; n < size; n++)
+        dst[n] ^= src[n];
+}
+}
+
+namespace ac {
+namespace streaming {
+
+FECSender::Ptr FECSender::Create(const TransportSender::Ptr &media_sender,
+                                 const network::Stream::Ptr &parity_stream,
+                                 unsigned int group_size) {
+    if (group_size == 0) {
+        group_size = kDefaultGroupSize;
+        const auto env_value = Utils::GetEnvValue(kGroupSizeEnvName);
+        if (!env_value.empty() && std::atoi(env_value.c_str()) > 0)
+            group_size = std::atoi(env_value.c_str());
+    }
+
+    return std::shared_ptr<FECSender>(new FECSender(media_sender, parity_stream, group_size));
+}
+
+FECSender::FECSender(const TransportSender::Ptr &media_sender,
+                     const network::Stream::Ptr &parity_stream,
+                     unsigned int group_size) :
+    media_sender_(media_sender),
+    parity_stream_(parity_stream),
+    group_size_(group_size),
+    group_count_(0),
+    parity_sequence_(0),
+    length_recovery_(0) {
+}
+
+bool FECSender::Queue(const ac::video::Buffer::Ptr &packets) {
+    // Media always goes out first; parity work must never hold a
+    // frame back.
+    const auto queued = media_sender_->Queue(packets);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    FoldIntoParity(packets);
+
+    if (++group_count_ >= group_size_)
+        SendParityPacket(packets->Timestamp());
+
+    return queued;
+}
+
+int32_t FECSender::LocalPort() const {
+    return media_sender_->LocalPort();
+}
+
+void FECSender::FoldIntoParity(const ac::video::Buffer::Ptr &packets) {
+    const auto size = packets->Length();
+
+    // Short members count as zero-padded to the longest one, so
+    // growing the accumulator (zero filled) is all the padding needed.
+    if (parity_.size() < kRTPHeaderSize + kFECHeaderSize + size)
+        parity_.resize(kRTPHeaderSize + kFECHeaderSize + size, 0);
+
+    XorInto(parity_.data() + kRTPHeaderSize + kFECHeaderSize,
+            packets->Data(), size);
+
+    length_recovery_ ^= static_cast<uint16_t>(size & 0xffff);
+}
+
+void FECSender::SendParityPacket(const ac::TimestampUs &timestamp) {
+    const auto ptr = parity_.data();
+
+    ptr[0] = 0x80;
+    ptr[1] = kRTPPayloadTypeParity;
+
+    ptr[2] = (parity_sequence_ >> 8) & 0xff;
+    ptr[3] = parity_sequence_ & 0xff;
+
+    // Same 90kHz capture-time base as the media flow so the receiver
+    // can associate the parity packet with its group.
+    uint32_t rtp_time = (timestamp * 9) / 100ll;
+
+    ptr[4] = rtp_time >> 24;
+    ptr[5] = (rtp_time >> 16) & 0xff;
+    ptr[6] = (rtp_time >> 8) & 0xff;
+    ptr[7] = rtp_time & 0xff;
+
+    ptr[8] = kParitySourceID >> 24;
+    ptr[9] = (kParitySourceID >> 16) & 0xff;
+    ptr[10] = (kParitySourceID >> 8) & 0xff;
+    ptr[11] = kParitySourceID & 0xff;
+
+    ptr[12] = (parity_sequence_ >> 8) & 0xff;
+    ptr[13] = parity_sequence_ & 0xff;
+    ptr[14] = group_size_ & 0xff;
+    ptr[15] = 0;
+    ptr[16] = (length_recovery_ >> 8) & 0xff;
+    ptr[17] = length_recovery_ & 0xff;
+    ptr[18] = 0;
+    ptr[19] = 0;
+
+    // Loss of a parity packet only loses the protection for its
+    // group; not worth surfacing as a transport error.
+    if (parity_stream_->Write(ptr, parity_.size(), timestamp) !=
+            network::Stream::Error::kNone)
+        AC_WARNING("Failed to send FEC parity packet");
+
+    parity_sequence_ = (parity_sequence_ + 1) & 0xffff;
+    group_count_ = 0;
+    length_recovery_ = 0;
+
+    // Keeps the capacity; the next group starts from clean zeroes.
+    std::fill(parity_.begin(), parity_.end(), 0);
+}
+
+} // namespace streaming
+} // namespace ac
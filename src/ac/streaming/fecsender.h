@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_FECSENDER_H_
+#define AC_STREAMING_FECSENDER_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ac/network/stream.h"
+
+#include "ac/streaming/transportsender.h"
+
+namespace ac {
+namespace streaming {
+
+// Adds SMPTE 2022-1 style forward error correction in front of a
+// transport sender: every packetizer output is forwarded unchanged to
+// the media flow and XOR-folded into a parity accumulator; once a
+// group is complete a single parity packet goes out over a second
+// stream. A receiver which buffered the rest of the group can rebuild
+// one lost member from the parity, hiding steady low-percentage loss
+// that retransmission cannot answer within the latency budget. Costs
+// roughly 1/group-size extra bitrate.
+//
+// The parity flow is our own extension rather than wire-exact SMPTE
+// 2022-1, so it stays opt-in for sinks known to support it.
+class FECSender : public TransportSender {
+public:
+    typedef std::shared_ptr<FECSender> Ptr;
+
+    // Group size 0 picks AETHERCAST_FEC_GROUP_SIZE or the default
+    static Ptr Create(const TransportSender::Ptr &media_sender,
+                      const network::Stream::Ptr &parity_stream,
+                      unsigned int group_size = 0);
+
+    // From ac::streaming::TransportSender
+    bool Queue(const ac::video::Buffer::Ptr &packets) override;
+    int32_t LocalPort() const override;
+
+private:
+    FECSender(const TransportSender::Ptr &media_sender,
+              const network::Stream::Ptr &parity_stream,
+              unsigned int group_size);
+
+    void FoldIntoParity(const ac::video::Buffer::Ptr &packets);
+    void SendParityPacket(const ac::TimestampUs &timestamp);
+
+private:
+    TransportSender::Ptr media_sender_;
+    network::Stream::Ptr parity_stream_;
+    unsigned int group_size_;
+    unsigned int group_count_;
+    uint16_t parity_sequence_;
+    uint16_t length_recovery_;
+    // Accumulator sized to the longest group member; capacity sticks
+    // around between groups so steady state stays allocation-free.
+    std::vector<uint8_t> parity_;
+    std::mutex mutex_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
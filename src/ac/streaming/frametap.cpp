@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ac/logger.h"
+
+#include "ac/streaming/frametap.h"
+
+namespace {
+// Roughly a second of stream at our highest bitrates; consumers which
+// fall further behind than this are overrun and resync to the head.
+constexpr std::uint64_t kRingSize{4 * 1024 * 1024};
+constexpr const char *kMemfdName{"aethercast-frame-tap"};
+}
+
+namespace ac {
+namespace streaming {
+
+constexpr std::uint32_t FrameTap::kMagic;
+constexpr std::uint32_t FrameTap::kVersion;
+constexpr std::uint32_t FrameTap::kRecordMarker;
+
+FrameTap& FrameTap::Instance() {
+    static FrameTap instance;
+    return instance;
+}
+
+FrameTap::~FrameTap() {
+    if (header_)
+        ::munmap(header_, sizeof(RingHeader) + kRingSize);
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool FrameTap::CreateRing() {
+    fd_ = ::memfd_create(kMemfdName, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd_ < 0) {
+        AC_ERROR("Failed to create frame tap memfd: %s", ::strerror(errno));
+        return false;
+    }
+
+    const auto total_size = sizeof(RingHeader) + kRingSize;
+
+    if (::ftruncate(fd_, total_size) < 0) {
+        AC_ERROR("Failed to size frame tap ring: %s", ::strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    // Consumers map the descriptor we hand out, so pin the size down;
+    // the write seal stays off as we keep producing into the ring.
+    if (::fcntl(fd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+        AC_WARNING("Failed to seal frame tap ring: %s", ::strerror(errno));
+
+    auto mapped = ::mmap(nullptr, total_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        AC_ERROR("Failed to map frame tap ring: %s", ::strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    header_ = static_cast<RingHeader*>(mapped);
+    data_ = static_cast<std::uint8_t*>(mapped) + sizeof(RingHeader);
+
+    // The header holds an atomic so it must not be cleared bytewise;
+    // every field gets stored individually instead.
+    header_->magic = kMagic;
+    header_->version = kVersion;
+    header_->ring_size = kRingSize;
+    header_->head.store(0, std::memory_order_relaxed);
+    ::memset(header_->reserved, 0, sizeof(header_->reserved));
+
+    return true;
+}
+
+int FrameTap::OpenReader() {
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if (fd_ < 0 && !CreateRing())
+        return -1;
+
+    // Reopening through procfs gives the consumer a descriptor which
+    // cannot write to the ring even though the write seal is off.
+    char path[32];
+    ::snprintf(path, sizeof(path), "/proc/self/fd/%d", fd_);
+    const auto reader_fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (reader_fd < 0) {
+        AC_ERROR("Failed to reopen frame tap ring read-only: %s", ::strerror(errno));
+        return -1;
+    }
+
+    active_.store(true, std::memory_order_release);
+
+    AC_DEBUG("Opened frame tap reader (fd %d)", reader_fd);
+
+    return reader_fd;
+}
+
+bool FrameTap::Active() const {
+    return active_.load(std::memory_order_relaxed);
+}
+
+void FrameTap::WriteBytes(const std::uint8_t *data, std::size_t size, std::uint64_t at) {
+    const auto offset = at % kRingSize;
+    const auto till_end = kRingSize - offset;
+
+    if (size <= till_end) {
+        ::memcpy(data_ + offset, data, size);
+        return;
+    }
+
+    ::memcpy(data_ + offset, data, till_end);
+    ::memcpy(data_, data + till_end, size - till_end);
+}
+
+void FrameTap::Push(const ac::video::Buffer::Ptr &buffer) {
+    if (!Active())
+        return;
+
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if (!header_)
+        return;
+
+    RecordHeader record{};
+    record.marker = kRecordMarker;
+    record.size = buffer->Length();
+    record.timestamp_us = buffer->Timestamp();
+
+    const auto total = sizeof(record) + buffer->Length();
+    if (total > kRingSize) {
+        AC_WARNING("Frame of %d bytes does not fit the tap ring; dropping", buffer->Length());
+        return;
+    }
+
+    const auto head = header_->head.load(std::memory_order_relaxed);
+
+    WriteBytes(reinterpret_cast<const std::uint8_t*>(&record), sizeof(record), head);
+    WriteBytes(buffer->Data(), buffer->Length(), head + sizeof(record));
+
+    // Publishes the record; readers pair this with an acquire load on
+    // the head counter.
+    header_->head.store(head + total, std::memory_order_release);
+}
+
+} // namespace streaming
+} // namespace ac
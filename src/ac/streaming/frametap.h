@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_FRAMETAP_H_
+#define AC_STREAMING_FRAMETAP_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "ac/non_copyable.h"
+#include "ac/video/buffer.h"
+
+namespace ac {
+namespace streaming {
+
+// Hands the encoded H.264 access units to local consumers through a
+// shared memory ring so a recorder or preview process gets the stream
+// without a second encode or a copy through the daemon. The ring is a
+// sealed memfd; consumers receive a read-only descriptor for it over
+// D-Bus (Manager.OpenFrameTap), map it and chase the head counter.
+//
+// The memory starts with a RingHeader followed by ring_size bytes of
+// data. Each frame is written as a RecordHeader plus payload, wrapping
+// at the end of the data region; head counts total bytes ever written
+// and is published with release semantics after the record is in
+// place. A reader whose position falls more than ring_size behind head
+// has been overrun and must resync to head. The writer never blocks on
+// readers.
+//
+// Nothing is allocated until the first consumer asks for the ring, and
+// an inactive tap costs the sender path a single relaxed atomic load
+// per frame.
+class FrameTap : public ac::NonCopyable {
+public:
+    struct RingHeader {
+        std::uint32_t magic;
+        std::uint32_t version;
+        // Size of the data region following this header in bytes
+        std::uint64_t ring_size;
+        // Total bytes written since the ring was created; the next
+        // record starts at head % ring_size within the data region
+        std::atomic<std::uint64_t> head;
+        std::uint8_t reserved[40];
+    };
+
+    struct RecordHeader {
+        std::uint32_t marker;
+        // Payload bytes following this header
+        std::uint32_t size;
+        ac::TimestampUs timestamp_us;
+    };
+
+    static constexpr std::uint32_t kMagic{0x41435454}; // "ACTT"
+    static constexpr std::uint32_t kVersion{1};
+    static constexpr std::uint32_t kRecordMarker{0xfeedf00d};
+
+    static FrameTap& Instance();
+
+    // Creates the ring on first use and returns a fresh read-only
+    // descriptor for it which the caller owns, or -1 on failure.
+    int OpenReader();
+
+    bool Active() const;
+
+    // Appends the buffer to the ring; a no-op while no consumer has
+    // ever opened the tap.
+    void Push(const ac::video::Buffer::Ptr &buffer);
+
+private:
+    FrameTap() = default;
+    ~FrameTap();
+
+    // Expects lock_ to be held
+    bool CreateRing();
+    void WriteBytes(const std::uint8_t *data, std::size_t size, std::uint64_t at);
+
+private:
+    std::atomic<bool> active_{false};
+    std::mutex lock_;
+    int fd_{-1};
+    RingHeader *header_{nullptr};
+    std::uint8_t *data_{nullptr};
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
@@ -19,6 +19,9 @@
 
 #include "ac/logger.h"
 
+#include "ac/common/clock.h"
+
+#include "ac/streaming/frametap.h"
 #include "ac/streaming/mediasender.h"
 #include "ac/streaming/mpegtspacketizer.h"
 #include "ac/streaming/rtpsender.h"
@@ -34,21 +37,25 @@ MediaSender::MediaSender(const Packetizer::Ptr &packetizer, const TransportSende
                          const ac::video::BaseEncoder::Config &config) :
     packetizer_(packetizer),
     sender_(sender),
+    audio_track_(-1),
+    gdr_session_(config.intra_refresh_frames > 0),
+    prev_csd_time_us_(-1ll),
     prev_time_us_(-1ll),
-    queue_(video::BufferQueue::Create()) {
+    // The encoder is the only producer and our Execute() loop the only
+    // consumer, so the lock-free ring applies.
+    queue_(video::BufferQueue::CreateSPSC()) {
 
     if (!packetizer_ || !sender_) {
         AC_WARNING("Sender not correct initialized. Missing packetizer or sender.");
         return;
     }
 
-    // FIXME once we add support for audio this can be only used for video
-    // and we need to differentiate here per track.
     Packetizer::TrackFormat format;
     format.profile_idc = config.profile_idc;
     format.level_idc = config.level_idc;
     format.constraint_set = config.constraint_set;
-    format.mime = "video/avc";
+    format.mime = config.codec == video::CodecType::kHEVC
+            ? "video/hevc" : "video/avc";
 
     video_track_ = packetizer_->AddTrack(format);
 }
@@ -65,32 +72,152 @@ bool MediaSender::Stop() {
     return true;
 }
 
-void MediaSender::ProcessBuffer(const ac::video::Buffer::Ptr &buffer) {
+bool MediaSender::EnableAudioTrack(const Packetizer::TrackFormat &format) {
+    if (!packetizer_)
+        return false;
+
+    if (audio_track_ >= 0) {
+        AC_WARNING("Audio track is already enabled");
+        return false;
+    }
+
+    const auto track = packetizer_->AddTrack(format);
+    if (track < 0)
+        return false;
+
+    audio_track_ = track;
+    audio_format_ = format;
+
+    // Like the video queue there is exactly one producer (the audio
+    // source) and one consumer (our Execute() loop).
+    audio_queue_ = video::BufferQueue::CreateSPSC();
+
+    return true;
+}
+
+bool MediaSender::Reconfigure(const Packetizer::Ptr &packetizer,
+                              const ac::video::BaseEncoder::Config &config) {
+    if (!packetizer || !sender_)
+        return false;
+
+    packetizer_ = packetizer;
+    gdr_session_ = config.intra_refresh_frames > 0;
+    prev_csd_time_us_ = -1ll;
+    prev_time_us_ = -1ll;
+
+    Packetizer::TrackFormat format;
+    format.profile_idc = config.profile_idc;
+    format.level_idc = config.level_idc;
+    format.constraint_set = config.constraint_set;
+    format.mime = config.codec == video::CodecType::kHEVC
+            ? "video/hevc" : "video/avc";
+
+    video_track_ = packetizer_->AddTrack(format);
+    if (video_track_ < 0)
+        return false;
+
+    if (audio_track_ >= 0) {
+        audio_track_ = packetizer_->AddTrack(audio_format_);
+        if (audio_track_ < 0)
+            return false;
+        audio_queue_->PopAll();
+    }
+
+    // Whatever the encoder produced for the old format never hits the wire
+    queue_->PopAll();
+
+    return true;
+}
+
+void MediaSender::OnAudioBufferAvailable(const video::Buffer::Ptr &buffer) {
+    if (!audio_queue_)
+        return;
+
+    audio_queue_->Push(buffer);
+}
+
+void MediaSender::ProcessBuffer(const ac::video::Buffer::Ptr &buffer, Packetizer::TrackId track) {
     ac::video::Buffer::Ptr packets;
 
     AC_DEBUG("ProcessBuffer");
 
+    // Local consumers get the encoded access units before they are
+    // wrapped into transport packets; while nobody has opened the tap
+    // this is a single atomic load.
+    if (track == video_track_ && FrameTap::Instance().Active())
+        FrameTap::Instance().Push(buffer);
+
     // FIXME: By default we're expecting the encoder to insert SPS and PPS
     // with each IDR frame but we need to handle also the case where the
     // encoder is not capable of doing this. For that we simply have to set
     // flags to Packetizer::kPrependSPSandPPStoIDRFrames.
     int flags = 0;
 
-    // Per spec we need to emit PAT/PMT and PCR updates atleast every 100ms
-    int64_t time_us = ac::Utils::GetNowUs();
+    // Per spec we need to emit PAT/PMT and PCR updates atleast every 100ms;
+    // the cached coarse clock is plenty accurate for that cadence.
+    int64_t time_us = ac::common::Clock::CoarseNowUs();
     if (prev_time_us_ < 0ll || prev_time_us_ + 100000ll <= time_us) {
         flags |= Packetizer::kEmitPATandPMT;
         flags |= Packetizer::kEmitPCR;
         prev_time_us_ = time_us;
     }
 
-    if (!packetizer_->Packetize(video_track_, buffer, &packets, flags)) {
+    // Without discrete IDR frames a late joining or recovering sink
+    // never sees SPS/PPS inside the stream, so gradual refresh
+    // sessions resend them with the video track once a second.
+    if (gdr_session_ && track == video_track_
+            && (prev_csd_time_us_ < 0ll || prev_csd_time_us_ + 1000000ll <= time_us)) {
+        flags |= Packetizer::kForcePrependSPSandPPS;
+        prev_csd_time_us_ = time_us;
+    }
+
+    if (!packetizer_->Packetize(track, buffer, &packets, flags)) {
         AC_ERROR("MPEGTS packetizing failed");
         return;
     }
     AC_DEBUG("Packetized");
 
-    packets->SetTimestamp(buffer->Timestamp());
+    // In tight packing mode the packetizer may hold small audio units
+    // back for a later coalesced PES; nothing to send then.
+    if (!packets)
+        return;
+
+    // The recording shares the very same transport stream buffers;
+    // its Queue() only pushes into a bounded queue and drops under
+    // I/O pressure rather than holding us up.
+    if (recorder_)
+        recorder_->Queue(packets);
+
+    // The packetizer stamps its output with the access unit's capture
+    // time and frame id so every downstream consumer sees them without
+    // us copying anything over here.
+    sender_->Queue(packets);
+}
+
+void MediaSender::MaybeEmitIdlePackets() {
+    // With capture gated on static content no buffers arrive, but the
+    // transport stream still has to carry PCR (and the tables) every
+    // 100ms or the sinks' clock recovery starves and the session
+    // times out. The queue timeout above wakes us often enough to
+    // keep that schedule.
+    if (!packetizer_ || !sender_)
+        return;
+
+    const int64_t time_us = ac::common::Clock::Update();
+    if (prev_time_us_ >= 0ll && time_us < prev_time_us_ + 100000ll)
+        return;
+
+    ac::video::Buffer::Ptr packets;
+    if (!packetizer_->PacketizeIdle(time_us, &packets,
+                                    Packetizer::kEmitPATandPMT | Packetizer::kEmitPCR))
+        return;
+
+    prev_time_us_ = time_us;
+
+    // Idle packets keep the recording's PCR schedule intact as well
+    if (recorder_)
+        recorder_->Queue(packets);
+
     sender_->Queue(packets);
 }
 
@@ -98,11 +225,42 @@ bool MediaSender::Execute() {
     // This will wait for a short time and then return back
     // so we can loop again and check if we have to exit or
     // not.
-    if (!queue_->WaitToBeFilled())
+    if (!queue_->WaitToBeFilled()) {
+        MaybeEmitIdlePackets();
+        return true;
+    }
+
+    // One precise clock read per wakeup; the buffers drained below all
+    // share it through the coarse clock.
+    ac::common::Clock::Update();
+
+    // Drain everything the encoder queued since our last wakeup in one
+    // go instead of taking one round trip per buffer.
+    const auto video_buffers = queue_->PopAll();
+
+    if (!audio_queue_) {
+        for (const auto &buffer : video_buffers)
+            ProcessBuffer(buffer, video_track_);
+
         return true;
+    }
 
-    const auto buffer = queue_->Pop();
-    ProcessBuffer(buffer);
+    // Audio gets muxed within the very same pass: both queues are
+    // drained and their buffers packetized in timestamp order so the
+    // elementary streams interleave in a single output sequence. Audio
+    // rides on the video wakeups which arrive at display rate.
+    const auto audio_buffers = audio_queue_->PopAll();
+
+    size_t video_index = 0, audio_index = 0;
+    while (video_index < video_buffers.size() || audio_index < audio_buffers.size()) {
+        if (audio_index == audio_buffers.size()
+                || (video_index < video_buffers.size()
+                    && video_buffers.at(video_index)->Timestamp()
+                        <= audio_buffers.at(audio_index)->Timestamp()))
+            ProcessBuffer(video_buffers.at(video_index++), video_track_);
+        else
+            ProcessBuffer(audio_buffers.at(audio_index++), audio_track_);
+    }
 
     return true;
 }
@@ -111,6 +269,14 @@ void MediaSender::OnBufferAvailable(const video::Buffer::Ptr &buffer) {
     queue_->Push(buffer);
 }
 
+void MediaSender::OnBuffersAvailable(const std::vector<video::Buffer::Ptr> &buffers) {
+    if (buffers.empty())
+        return;
+
+    // One lock round-trip and one wakeup for the whole run
+    queue_->PushAll(buffers);
+}
+
 void MediaSender::OnBufferWithCodecConfig(const video::Buffer::Ptr &buffer) {
     if (!packetizer_)
         return;
@@ -129,5 +295,13 @@ std::string MediaSender::Name() const {
     return kMediaSenderThreadName;
 }
 
+void MediaSender::SetQueueReport(const ac::video::BufferQueueReport::Ptr &report) {
+    queue_->SetReport(Name(), report);
+}
+
+void MediaSender::SetRecorder(const StreamRecorder::Ptr &recorder) {
+    recorder_ = recorder;
+}
+
 } // namespace streaming
 } // namespace ac
@@ -22,17 +22,21 @@
 #include <mutex>
 #include <thread>
 
+#include "ac/audio/pulseaudiocapture.h"
+
 #include "ac/video/baseencoder.h"
 #include "ac/video/bufferqueue.h"
 
 #include "ac/streaming/packetizer.h"
+#include "ac/streaming/streamrecorder.h"
 #include "ac/streaming/transportsender.h"
 
 namespace ac {
 namespace streaming {
 
 class MediaSender : public ac::common::Executable,
-                    public ac::video::BaseEncoder::Delegate {
+                    public ac::video::BaseEncoder::Delegate,
+                    public ac::audio::PulseAudioCapture::Delegate {
 public:
     typedef std::shared_ptr<MediaSender> Ptr;
 
@@ -42,6 +46,28 @@ public:
 
     uint16_t LocalRTPPort() const;
 
+    // Adds an audio elementary stream which gets muxed into the same
+    // transport stream as the video track. Returns false when the
+    // packetizer rejects the format or audio is already enabled.
+    bool EnableAudioTrack(const Packetizer::TrackFormat &format);
+
+    // Swaps in a fresh packetizer and rebuilds the tracks for a new
+    // video format mid-session; queued buffers from the old format are
+    // discarded. The transport sender keeps running throughout.
+    bool Reconfigure(const Packetizer::Ptr &packetizer,
+                     const ac::video::BaseEncoder::Config &config);
+
+    // From ac::audio::PulseAudioCapture::Delegate; takes audio access
+    // units from the capture thread
+    void OnAudioBufferAvailable(const ac::video::Buffer::Ptr &buffer) override;
+
+    // Enables depth/stall/drop telemetry on the internal buffer queue
+    void SetQueueReport(const ac::video::BufferQueueReport::Ptr &report);
+
+    // Tees every transport packet run into a local recording; the
+    // recorder's Queue() never blocks so the live path is unaffected.
+    void SetRecorder(const StreamRecorder::Ptr &recorder);
+
     // From ac::common::Executable
     bool Start() override;
     bool Stop() override;
@@ -50,19 +76,34 @@ public:
 
     // From ac::video::BaseEncoder::Delegate
     void OnBufferAvailable(const ac::video::Buffer::Ptr &buffer) override;
+    void OnBuffersAvailable(const std::vector<ac::video::Buffer::Ptr> &buffers) override;
     void OnBufferWithCodecConfig(const ac::video::Buffer::Ptr &buffer) override;
 
 private:
     void WorkerThread();
 
-    void ProcessBuffer(const ac::video::Buffer::Ptr &buffer);
+    void ProcessBuffer(const ac::video::Buffer::Ptr &buffer, Packetizer::TrackId track);
+
+    // Keeps PCR and the tables on schedule while no media buffers
+    // flow so gated capture doesn't break T-STD compliance
+    void MaybeEmitIdlePackets();
 
 private:
     Packetizer::Ptr packetizer_;
     TransportSender::Ptr sender_;
+    StreamRecorder::Ptr recorder_;
     Packetizer::TrackId video_track_;
+    Packetizer::TrackId audio_track_;
+    // Kept so a reconfigured packetizer can recreate the audio track
+    Packetizer::TrackFormat audio_format_;
+    // Gradual refresh streams carry no IDR frames to hang codec config
+    // off, so the parameter sets get resent on a timer instead
+    bool gdr_session_;
+    int64_t prev_csd_time_us_;
     int64_t prev_time_us_;
     ac::video::BufferQueue::Ptr queue_;
+    // Only exists once an audio track has been enabled
+    ac::video::BufferQueue::Ptr audio_queue_;
 };
 
 } // namespace streaming
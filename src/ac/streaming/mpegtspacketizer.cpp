@@ -24,8 +24,11 @@
 #include <arpa/inet.h>
 #include <memory.h>
 
+#include <algorithm>
+
 #include "ac/utils.h"
 #include "ac/logger.h"
+#include "ac/report/dispatch.h"
 
 #include "ac/video/utils.h"
 
@@ -39,14 +42,75 @@ static constexpr uint32_t kCSDSize{3};
 
 // See WiFi Display spec version 1.1 chapter D.4.2 PAT/PMT
 static constexpr unsigned int kPIDofPMT{0x100};
+// Longest PSI section the PMT may occupy (ISO 13818-1 limit)
+static constexpr size_t kMaxSectionLength{1021};
 static constexpr unsigned int kPIDofPCR{0x1000};
 static constexpr unsigned int kVideoPIDStart{0x1011};
+static constexpr unsigned int kAudioPIDStart{0x1100};
 
 static constexpr unsigned int kH264StreamType{0x1b};
+static constexpr unsigned int kHEVCStreamType{0x24};
 static constexpr unsigned int kVideoStreamIdStart{0xe0};
 static constexpr unsigned int kVideoStreamIdStop{0xef};
+static constexpr unsigned int kAACStreamType{0x0f};
+static constexpr unsigned int kLPCMStreamType{0x83};
+static constexpr unsigned int kAudioStreamIdStart{0xc0};
+static constexpr unsigned int kAudioStreamIdStop{0xdf};
+// LPCM travels in private_stream_1
+static constexpr unsigned int kLPCMPrivateStreamId{0xbd};
 static constexpr unsigned int kAVCVideoDescriptorTag{40};
 static constexpr unsigned int kAVCTimingAndHRDDescriptor{42};
+
+static constexpr uint8_t kTSSyncByte{0x47};
+
+// Tight packing flushes held back audio units once their combined
+// payload fills about this many bytes; seven TS packet payloads match
+// what one RTP packet carries.
+static constexpr size_t kCoalesceTargetBytes{7 * 184};
+// ...or once the oldest held back unit reaches this age, bounding the
+// extra audio latency the mode may introduce.
+static constexpr int64_t kCoalesceMaxDelayUs{10000ll};
+
+// The bit layout of the TS and PES headers lives in these few helpers
+// so every emission site shares the same (compile time evaluable)
+// twiddling instead of open coding shifts and masks.
+constexpr uint8_t TSHeaderPIDHigh(unsigned int pid, bool payload_unit_start) {
+    return (payload_unit_start ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+}
+
+constexpr uint8_t TSHeaderPIDLow(unsigned int pid) {
+    return pid & 0xff;
+}
+
+// adaptation_field_control = b11 (adaptation field and payload) or
+// b01 (payload only) with the continuity counter in the low nibble
+constexpr uint8_t TSHeaderAdaptationAndCounter(bool adaptation_field,
+                                               unsigned int counter) {
+    return (adaptation_field ? 0x30 : 0x10) | (counter & 0xf);
+}
+
+// reserved = b10, data_alignment_indicator = b1
+static constexpr uint8_t kPESHeaderMarkerAndAlignment{0x84};
+
+// PTS_DTS_flags = b10 (PTS only), optionally PES_private_data
+constexpr uint8_t PESHeaderFlags(bool has_private_data) {
+    return has_private_data ? 0x81 : 0x80;
+}
+
+static_assert(TSHeaderPIDHigh(kPIDofPCR, true) == 0x50,
+              "TS header layout broken");
+static_assert(TSHeaderAdaptationAndCounter(true, 5) == 0x35,
+              "TS header layout broken");
+
+// Serializes the 33 bit PTS into the five byte '0010' marker bit
+// layout of the PES header
+inline void WritePTS(uint8_t *ptr, uint64_t pts) {
+    ptr[0] = 0x20 | (((pts >> 30) & 7) << 1) | 1;
+    ptr[1] = (pts >> 22) & 0xff;
+    ptr[2] = (((pts >> 15) & 0x7f) << 1) | 1;
+    ptr[3] = (pts >> 7) & 0xff;
+    ptr[4] = ((pts & 0x7f) << 1) | 1;
+}
 }
 
 namespace ac {
@@ -55,26 +119,36 @@ namespace streaming {
 struct MPEGTSPacketizer::Track {
     typedef std::shared_ptr<Track> Ptr;
 
+    // Resolved once at creation so the per-frame dispatch in
+    // Packetize and the PMT build never re-parse the mime string;
+    // the string itself only matters during negotiation.
+    enum class Kind {
+        kAudio,
+        kVideo,
+        kH264Video,
+        kHEVCVideo,
+    };
+
     static Ptr Create(const TrackFormat &format, unsigned int pid,
                       unsigned int stream_type, unsigned int stream_id);
 
     unsigned int NextContinuityCounter();
 
-    bool IsAudio() const { return ac::Utils::StringStartsWith(format.mime, "audio/"); }
-    bool IsVideo() const { return ac::Utils::StringStartsWith(format.mime, "video/"); }
+    bool IsAudio() const { return kind == Kind::kAudio; }
+    bool IsVideo() const { return kind != Kind::kAudio; }
 
-    bool IsH264() const { return format.mime == "video/avc"; }
+    bool IsH264() const { return kind == Kind::kH264Video; }
+    bool IsHEVC() const { return kind == Kind::kHEVCVideo; }
 
     void SubmitCSD(const ac::video::Buffer::Ptr &buffer);
 
-    ac::video::Buffer::Ptr PrependCSD(const ac::video::Buffer::Ptr &buffer) const;
-
     void Finalize();
 
     Track(const TrackFormat &format, unsigned int pid,
           unsigned int stream_type, unsigned int stream_id);
 
     TrackFormat format;
+    Kind kind;
     unsigned int pid;
     unsigned int stream_type;
     unsigned int stream_id;
@@ -82,8 +156,27 @@ struct MPEGTSPacketizer::Track {
     bool finalized;
     std::vector<ac::video::Buffer::Ptr> csd;
     std::vector<ac::video::Buffer::Ptr> descriptors;
+    // Access units held back in tight packing mode until enough of
+    // them share one PES; the first unit's timestamp becomes the PTS
+    // of the coalesced packet as the spec prescribes.
+    std::vector<ac::video::Buffer::Ptr> pending;
+    size_t pending_length = 0;
+    int64_t pending_first_us = -1ll;
+
+private:
+    static Kind KindFromMime(const std::string &mime);
 };
 
+MPEGTSPacketizer::Track::Kind MPEGTSPacketizer::Track::KindFromMime(const std::string &mime) {
+    if (mime == "video/avc")
+        return Kind::kH264Video;
+    if (mime == "video/hevc")
+        return Kind::kHEVCVideo;
+    if (ac::Utils::StringStartsWith(mime, "video/"))
+        return Kind::kVideo;
+    return Kind::kAudio;
+}
+
 MPEGTSPacketizer::Track::Ptr MPEGTSPacketizer::Track::Create(const TrackFormat &format, unsigned int pid,
                                                              unsigned int stream_type, unsigned int stream_id) {
     return std::shared_ptr<Track>(new Track(format, pid, stream_type, stream_id));
@@ -92,6 +185,7 @@ MPEGTSPacketizer::Track::Ptr MPEGTSPacketizer::Track::Create(const TrackFormat &
 MPEGTSPacketizer::Track::Track(const TrackFormat &format, unsigned int pid,
                                unsigned int stream_type, unsigned int stream_id) :
     format(format),
+    kind(KindFromMime(format.mime)),
     pid(pid),
     stream_type(stream_type),
     stream_id(stream_id),
@@ -107,7 +201,9 @@ unsigned int MPEGTSPacketizer::Track::NextContinuityCounter() {
 }
 
 void MPEGTSPacketizer::Track::SubmitCSD(const video::Buffer::Ptr &buffer) {
-    if (!IsH264())
+    // HEVC parameter sets (VPS/SPS/PPS) use the same start code
+    // framing as H.264, so the split below serves both.
+    if (!IsH264() && !IsHEVC())
         return;
 
     const uint8_t *data = buffer->Data();
@@ -126,27 +222,19 @@ void MPEGTSPacketizer::Track::SubmitCSD(const video::Buffer::Ptr &buffer) {
     }
 }
 
-ac::video::Buffer::Ptr MPEGTSPacketizer::Track::PrependCSD(const ac::video::Buffer::Ptr &buffer) const {
-    size_t size = 0;
-    for (auto current : csd)
-        size += current->Length();
-
-    auto new_buffer = ac::video::Buffer::Create(buffer->Length() + size);
-    size_t offset = 0;
-    for (auto current : csd) {
-        ::memcpy(new_buffer->Data() + offset, current->Data(), current->Length());
-        offset += current->Length();
-    }
-
-    ::memcpy(new_buffer->Data() + offset, buffer->Data(), buffer->Length());
-
-    return new_buffer;
-}
-
 void MPEGTSPacketizer::Track::Finalize() {
     if (finalized)
         return;
 
+    if (IsHEVC()) {
+        // Stream type 0x24 is all a decoder needs to pick its codec;
+        // the HEVC video descriptor would repeat profile_tier_level
+        // fields we would have to parse out of the SPS first, and
+        // sinks accept streams without it.
+        finalized = true;
+        return;
+    }
+
     if(!IsH264())
         return;
 
@@ -212,31 +300,63 @@ Packetizer::Ptr MPEGTSPacketizer::Create(const ac::video::PacketizerReport::Ptr
 MPEGTSPacketizer::MPEGTSPacketizer(const ac::video::PacketizerReport::Ptr &report) :
     report_(report),
     pat_continuity_counter_(0),
-    pmt_continuity_counter_(0) {
-    InitCrcTable();
+    pmt_continuity_counter_(0),
+    last_pcr_us_(0ll),
+    buffer_pool_(ac::video::BufferPool::Create()),
+    tight_packing_(false),
+    stuffing_bytes_(0),
+    output_bytes_(0) {
 }
 
 MPEGTSPacketizer::~MPEGTSPacketizer() {
 }
 
-MPEGTSPacketizer::TrackId MPEGTSPacketizer::AddTrack(const TrackFormat &format) {
-    auto is_video = ac::Utils::StringStartsWith(format.mime, "video/");
+void MPEGTSPacketizer::SetTightPacking(bool enable) {
+    tight_packing_ = enable;
+}
 
-    if (!is_video) {
-        AC_ERROR("Audio tracks for MPEGTS are currently not supported");
-        return TrackId(-1);
-    }
+double MPEGTSPacketizer::MuxOverhead() const {
+    const auto output = output_bytes_.load(std::memory_order_relaxed);
+    if (output == 0)
+        return 0.0;
 
-    if (format.mime != "video/avc") {
-        AC_ERROR("Video formats other than video/avc are not supported");
+    return static_cast<double>(stuffing_bytes_.load(std::memory_order_relaxed))
+            / static_cast<double>(output);
+}
+
+MPEGTSPacketizer::TrackId MPEGTSPacketizer::AddTrack(const TrackFormat &format) {
+    // PID and stream id ranges as per WiFi Display spec
+    unsigned int pid_start = 0;
+    unsigned int stream_type = 0;
+    unsigned int stream_id_start = 0;
+    unsigned int stream_id_stop = 0;
+
+    if (format.mime == "video/avc") {
+        pid_start = kVideoPIDStart;
+        stream_type = kH264StreamType;
+        stream_id_start = kVideoStreamIdStart;
+        stream_id_stop = kVideoStreamIdStop;
+    } else if (format.mime == "video/hevc") {
+        pid_start = kVideoPIDStart;
+        stream_type = kHEVCStreamType;
+        stream_id_start = kVideoStreamIdStart;
+        stream_id_stop = kVideoStreamIdStop;
+    } else if (format.mime == "audio/aac") {
+        pid_start = kAudioPIDStart;
+        stream_type = kAACStreamType;
+        stream_id_start = kAudioStreamIdStart;
+        stream_id_stop = kAudioStreamIdStop;
+    } else if (format.mime == "audio/lpcm") {
+        pid_start = kAudioPIDStart;
+        stream_type = kLPCMStreamType;
+        stream_id_start = kLPCMPrivateStreamId;
+        stream_id_stop = kLPCMPrivateStreamId;
+    } else {
+        AC_ERROR("Media format %s is not supported", format.mime.c_str());
         return TrackId(-1);
     }
 
-    // First PID as per WiFi Display spec
-    unsigned int pid_start = kVideoPIDStart;
-    unsigned int stream_type = kH264StreamType;
-    unsigned int stream_id_start = kVideoStreamIdStart;
-    unsigned int stream_id_stop = kVideoStreamIdStop;
+    const auto is_video = ac::Utils::StringStartsWith(format.mime, "video/");
 
     unsigned int num_same_tracks = 0;
     unsigned int pid = pid_start;
@@ -245,7 +365,8 @@ MPEGTSPacketizer::TrackId MPEGTSPacketizer::AddTrack(const TrackFormat &format)
         if (track->stream_type == stream_type)
             num_same_tracks++;
 
-        if (track->IsAudio() || track->IsVideo())
+        // Video and audio draw their PIDs from separate ranges
+        if (track->IsVideo() == is_video)
             pid++;
     }
 
@@ -258,6 +379,9 @@ MPEGTSPacketizer::TrackId MPEGTSPacketizer::AddTrack(const TrackFormat &format)
     auto track = Track::Create(format, pid, stream_type, stream_id);
     tracks_.push_back(track);
 
+    // The cached PMT no longer describes the program
+    pmt_template_.reset();
+
     return tracks_.size() - 1;
 }
 
@@ -267,6 +391,128 @@ void MPEGTSPacketizer::SubmitCSD(TrackId track_index, const video::Buffer::Ptr &
 
     auto track = tracks_.at(track_index);
     track->SubmitCSD(buffer);
+
+    // The AVC video descriptor in the PMT derives from the CSD
+    pmt_template_.reset();
+}
+
+size_t MPEGTSPacketizer::CountSectionPackets(int flags) {
+    size_t count = 0;
+
+    if (flags & Flags::kEmitPATandPMT) {
+        // A PMT with rich descriptor sets can span several TS
+        // packets; the template knows the exact count.
+        if (!pat_template_ || !pmt_template_)
+            BuildSectionTemplates();
+
+        count += 1 + pmt_template_->Length() / 188;
+    }
+
+    if (flags & Flags::kEmitPCR)
+        ++count;
+
+    return count;
+}
+
+uint8_t* MPEGTSPacketizer::EmitSectionPackets(uint8_t *packetDataStart, int flags, int64_t time_us) {
+    if (flags & Flags::kEmitPATandPMT) {
+        // The tables only change when the tracks change, so both
+        // sections live as fully serialized 188 byte TS packets and
+        // emission boils down to a copy with the continuity counter
+        // nibbles patched in.
+        if (++pat_continuity_counter_ == 16)
+            pat_continuity_counter_ = 0;
+
+        ::memcpy(packetDataStart, pat_template_->Data(), 188);
+        packetDataStart[3] = 0x10 | pat_continuity_counter_;
+        packetDataStart += 188;
+
+        ::memcpy(packetDataStart, pmt_template_->Data(), pmt_template_->Length());
+        for (size_t n = 0; n < pmt_template_->Length() / 188; n++) {
+            if (++pmt_continuity_counter_ == 16)
+                pmt_continuity_counter_ = 0;
+            packetDataStart[n * 188 + 3] = 0x10 | pmt_continuity_counter_;
+        }
+        packetDataStart += pmt_template_->Length();
+    }
+
+    if (flags & Flags::kEmitPCR) {
+        // PCR stream
+        // 0x47
+        // transport_error_indicator = b0
+        // payload_unit_start_indicator = b1
+        // transport_priority = b0
+        // PID = kPCR_PID (13 bits)
+        // transport_scrambling_control = b00
+        // adaptation_field_control = b10 (adaptation field only, no payload)
+        // continuity_counter = b0000 (does not increment)
+        // adaptation_field_length = 183
+        // discontinuity_indicator = b0
+        // random_access_indicator = b0
+        // elementary_stream_priority_indicator = b0
+        // PCR_flag = b1
+        // OPCR_flag = b0
+        // splicing_point_flag = b0
+        // transport_private_data_flag = b0
+        // adaptation_field_extension_flag = b0
+        // program_clock_reference_base = b?????????????????????????????????
+        // reserved = b111111
+        // program_clock_reference_extension = b?????????
+
+        // PCR and PTS both derive from the capture timestamp so the
+        // two can't drift apart; the clamp keeps PCR monotonic in
+        // case timestamps ever step backwards.
+        int64_t pcrUs = time_us;
+        if (pcrUs < last_pcr_us_)
+            pcrUs = last_pcr_us_;
+        last_pcr_us_ = pcrUs;
+
+        uint64_t PCR = pcrUs * 27;  // PCR based on a 27MHz clock
+        uint64_t PCR_base = PCR / 300;
+        uint32_t PCR_ext = PCR % 300;
+
+        uint8_t *ptr = packetDataStart;
+        *ptr++ = kTSSyncByte;
+        *ptr++ = TSHeaderPIDHigh(kPIDofPCR, true);
+        *ptr++ = TSHeaderPIDLow(kPIDofPCR);
+        *ptr++ = 0x20;
+        *ptr++ = 0xb7;  // adaptation_field_length
+        *ptr++ = 0x10;
+        *ptr++ = (PCR_base >> 25) & 0xff;
+        *ptr++ = (PCR_base >> 17) & 0xff;
+        *ptr++ = (PCR_base >> 9) & 0xff;
+        *ptr++ = (PCR_base >> 1) & 0xff;
+        *ptr++ = ((PCR_base & 1) << 7) | 0x7e | ((PCR_ext >> 8) & 1);
+        *ptr++ = (PCR_ext & 0xff);
+
+        size_t sizeLeft = packetDataStart + 188 - ptr;
+        ::memset(ptr, 0xff, sizeLeft);
+
+        packetDataStart += 188;
+    }
+
+    return packetDataStart;
+}
+
+bool MPEGTSPacketizer::PacketizeIdle(int64_t timestamp, video::Buffer::Ptr *packets, int flags) {
+    packets->reset();
+
+    // Sections can only describe a program which exists
+    if (tracks_.size() == 0)
+        return false;
+
+    const auto numTSPackets = CountSectionPackets(flags);
+    if (numTSPackets == 0)
+        return false;
+
+    auto buffer = buffer_pool_->Acquire(numTSPackets * 188);
+    buffer->SetTimestamp(timestamp);
+
+    EmitSectionPackets(buffer->Data(), flags, timestamp);
+
+    *packets = buffer;
+
+    return true;
 }
 
 bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &_access_unit,
@@ -286,12 +532,76 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
 
     auto track = tracks_.at(track_index);
 
-    if (track->IsH264() && (flags & Flags::kPrependSPSandPPStoIDRFrames)
-            && ac::video::DoesBufferContainIDRFrame(access_unit)) {
-        // prepend codec specific data, i.e. SPS and PPS.
-        access_unit = track->PrependCSD(access_unit);
+    // The payload travels as a list of segments so codec specific
+    // data (SPS and PPS) gets injected in front of IDR frames through
+    // the scatter path below instead of merging everything into a
+    // freshly allocated access unit first. The segment list itself is
+    // a member so its storage survives across frames.
+    auto &payload_segments = payload_segments_;
+    payload_segments.clear();
+
+    if ((track->IsH264() || track->IsHEVC())
+            && ((flags & Flags::kForcePrependSPSandPPS)
+                || ((flags & Flags::kPrependSPSandPPStoIDRFrames)
+                    && ac::video::DoesBufferContainIDRFrame(access_unit,
+                            track->IsHEVC() ? ac::video::CodecType::kHEVC
+                                            : ac::video::CodecType::kH264)))) {
+        for (const auto &csd : track->csd)
+            payload_segments.push_back(csd);
+    }
+
+    if (tight_packing_ && track->IsAudio()) {
+        // An audio PES may legally carry several access units with the
+        // PTS describing the first one; briefly holding small frames
+        // back turns a stuffed partial TS packet per frame into one
+        // per coalesced group.
+        track->pending.push_back(access_unit);
+        track->pending_length += access_unit->Length();
+        if (track->pending_first_us < 0ll)
+            track->pending_first_us = timeUs;
+
+        if (track->pending_length < kCoalesceTargetBytes
+                && timeUs - track->pending_first_us < kCoalesceMaxDelayUs)
+            return true;  // Held back; *packets stays empty
+
+        for (auto &unit : track->pending)
+            payload_segments.push_back(std::move(unit));
+        timeUs = track->pending_first_us;
+
+        track->pending.clear();
+        track->pending_length = 0;
+        track->pending_first_us = -1ll;
+    } else {
+        payload_segments.push_back(access_unit);
     }
 
+    size_t payload_length = 0;
+    for (const auto &segment : payload_segments)
+        payload_length += segment->Length();
+
+    // Cursor over the payload segments; each call copies the next
+    // count bytes of payload into the current TS packet.
+    size_t segment_index = 0;
+    size_t segment_offset = 0;
+    const auto CopyPayload = [&](uint8_t *dst, size_t count) {
+        while (count > 0) {
+            const auto &segment = payload_segments.at(segment_index);
+            const size_t chunk = std::min<size_t>(
+                count, segment->Length() - segment_offset);
+
+            ::memcpy(dst, segment->Data() + segment_offset, chunk);
+
+            dst += chunk;
+            segment_offset += chunk;
+            count -= chunk;
+
+            if (segment_offset == segment->Length()) {
+                segment_index++;
+                segment_offset = 0;
+            }
+        }
+    };
+
     // 0x47
     // transport_error_indicator = b0
     // payload_unit_start_indicator = b1
@@ -350,7 +660,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
        followed by the payload
     */
 
-    size_t PES_packet_length = access_unit->Length() + 8 + numStuffingBytes;
+    size_t PES_packet_length = payload_length + 8 + numStuffingBytes;
     if (PES_private_data_len > 0)
         PES_packet_length += PES_private_data_len + 1;
 
@@ -367,7 +677,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
             AC_FATAL("Invalid header size");
 
         size_t sizeAvailableForPayload = 188 - 4 - PES_header_size;
-        size_t numBytesOfPayload = access_unit->Length();
+        size_t numBytesOfPayload = payload_length;
 
         if (numBytesOfPayload > sizeAvailableForPayload) {
             numBytesOfPayload = sizeAvailableForPayload;
@@ -377,7 +687,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
             }
         }
 
-        size_t numBytesOfPayloadRemaining = access_unit->Length() - numBytesOfPayload;
+        size_t numBytesOfPayloadRemaining = payload_length - numBytesOfPayload;
 
         // This is how many bytes of payload each subsequent TS packet
         // can contain at most.
@@ -413,242 +723,15 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
         }
     }
 
-    if (flags & Flags::kEmitPATandPMT)
-        numTSPackets += 2;
-
-    if (flags & Flags::kEmitPCR)
-        ++numTSPackets;
-
-    auto buffer = ac::video::Buffer::Create(numTSPackets * 188);
-    buffer->SetTimestamp(access_unit->Timestamp());
-
-    uint8_t *packetDataStart = buffer->Data();
-
-    if (flags & Flags::kEmitPATandPMT) {
-        // Program Association Table (PAT):
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = b0000000000000 (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b01 (no adaptation field, payload only)
-        // continuity_counter = b????
-        // skip = 0x00
-        // --- payload follows
-        // table_id = 0x00
-        // section_syntax_indicator = b1
-        // must_be_zero = b0
-        // reserved = b11
-        // section_length = 0x00d
-        // transport_stream_id = 0x0000
-        // reserved = b11
-        // version_number = b00001
-        // current_next_indicator = b1
-        // section_number = 0x00
-        // last_section_number = 0x00
-        //   one program follows:
-        //   program_number = 0x0001
-        //   reserved = b111
-        //   program_map_PID = kPID_PMT (13 bits!)
-        // CRC = 0x????????
-
-        if (++pat_continuity_counter_ == 16)
-            pat_continuity_counter_ = 0;
-
-        uint8_t *ptr = packetDataStart;
-        *ptr++ = 0x47;
-        *ptr++ = 0x40;
-        *ptr++ = 0x00;
-        *ptr++ = 0x10 | pat_continuity_counter_;
-        *ptr++ = 0x00;
-
-        uint8_t *crcDataStart = ptr;
-        *ptr++ = 0x00;
-        *ptr++ = 0xb0;
-        *ptr++ = 0x0d;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0xc3;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0x01;
-        *ptr++ = 0xe0 | (kPIDofPMT >> 8);
-        *ptr++ = kPIDofPMT & 0xff;
-
-        if (ptr - crcDataStart != 12)
-            AC_FATAL("Invalid position for ptr");
-
-        uint32_t crc = ::htonl(CalcCrc32(crcDataStart, ptr - crcDataStart));
-        ::memcpy(ptr, &crc, 4);
-        ptr += 4;
-
-        size_t sizeLeft = packetDataStart + 188 - ptr;
-        ::memset(ptr, 0xff, sizeLeft);
-
-        packetDataStart += 188;
-
-        // Program Map (PMT):
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = kPID_PMT (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b01 (no adaptation field, payload only)
-        // continuity_counter = b????
-        // skip = 0x00
-        // -- payload follows
-        // table_id = 0x02
-        // section_syntax_indicator = b1
-        // must_be_zero = b0
-        // reserved = b11
-        // section_length = 0x???
-        // program_number = 0x0001
-        // reserved = b11
-        // version_number = b00001
-        // current_next_indicator = b1
-        // section_number = 0x00
-        // last_section_number = 0x00
-        // reserved = b111
-        // PCR_PID = kPCR_PID (13 bits)
-        // reserved = b1111
-        // program_info_length = 0x???
-        //   program_info_descriptors follow
-        // one or more elementary stream descriptions follow:
-        //   stream_type = 0x??
-        //   reserved = b111
-        //   elementary_PID = b? ???? ???? ???? (13 bits)
-        //   reserved = b1111
-        //   ES_info_length = 0x000
-        // CRC = 0x????????
-
-        if (++pmt_continuity_counter_ == 16)
-            pmt_continuity_counter_ = 0;
-
-        ptr = packetDataStart;
-
-        *ptr++ = 0x47;
-        *ptr++ = 0x40 | (kPIDofPMT >> 8);
-        *ptr++ = kPIDofPMT & 0xff;
-        *ptr++ = 0x10 | pmt_continuity_counter_;
-        *ptr++ = 0x00;
-
-        crcDataStart = ptr;
-        *ptr++ = 0x02;
-
-        *ptr++ = 0x00;  // section_length to be filled in below.
-        *ptr++ = 0x00;
-
-        *ptr++ = 0x00;
-        *ptr++ = 0x01;
-        *ptr++ = 0xc3;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0xe0 | (kPIDofPCR >> 8);
-        *ptr++ = kPIDofPCR & 0xff;
-
-        size_t program_info_length = 0;
-        for (auto descriptor : program_info_descriptors_)
-            program_info_length += descriptor->Length();
-
-        if(program_info_length >= 0x400)
-            AC_FATAL("Invalid length for program info");
-
-        *ptr++ = 0xf0 | (program_info_length >> 8);
-        *ptr++ = (program_info_length & 0xff);
-
-        for (auto descriptor : program_info_descriptors_) {
-            ::memcpy(ptr, descriptor->Data(), descriptor->Length());
-            ptr += descriptor->Length();
-        }
-
-        for (auto track : tracks_) {
-            // Make sure all the decriptors have been added.
-            track->Finalize();
-
-            *ptr++ = track->stream_type;
-            *ptr++ = 0xe0 | (track->pid >> 8);
-            *ptr++ = track->pid & 0xff;
-
-            size_t ES_info_length = 0;
-            for (auto descriptor : track->descriptors)
-                ES_info_length += descriptor->Length();
-
-            if (ES_info_length > 0xfff)
-                AC_FATAL("Invalid ES length %d", ES_info_length);
-
-            *ptr++ = 0xf0 | (ES_info_length >> 8);
-            *ptr++ = (ES_info_length & 0xff);
-
-            for (auto descriptor : track->descriptors) {
-                memcpy(ptr, descriptor->Data(), descriptor->Length());
-                ptr += descriptor->Length();
-            }
-        }
-
-        size_t section_length = ptr - (crcDataStart + 3) + 4 /* CRC */;
-
-        crcDataStart[1] = 0xb0 | (section_length >> 8);
-        crcDataStart[2] = section_length & 0xff;
-
-        crc = ::htonl(CalcCrc32(crcDataStart, ptr - crcDataStart));
-        memcpy(ptr, &crc, 4);
-        ptr += 4;
-
-        sizeLeft = packetDataStart + 188 - ptr;
-        memset(ptr, 0xff, sizeLeft);
-
-        packetDataStart += 188;
-    }
-
-    if (flags & Flags::kEmitPCR) {
-        // PCR stream
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = kPCR_PID (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b10 (adaptation field only, no payload)
-        // continuity_counter = b0000 (does not increment)
-        // adaptation_field_length = 183
-        // discontinuity_indicator = b0
-        // random_access_indicator = b0
-        // elementary_stream_priority_indicator = b0
-        // PCR_flag = b1
-        // OPCR_flag = b0
-        // splicing_point_flag = b0
-        // transport_private_data_flag = b0
-        // adaptation_field_extension_flag = b0
-        // program_clock_reference_base = b?????????????????????????????????
-        // reserved = b111111
-        // program_clock_reference_extension = b?????????
-
-        int64_t nowUs = ac::Utils::GetNowUs();
-        uint64_t PCR = nowUs * 27;  // PCR based on a 27MHz clock
-        uint64_t PCR_base = PCR / 300;
-        uint32_t PCR_ext = PCR % 300;
-
-        uint8_t *ptr = packetDataStart;
-        *ptr++ = 0x47;
-        *ptr++ = 0x40 | (kPIDofPCR >> 8);
-        *ptr++ = kPIDofPCR & 0xff;
-        *ptr++ = 0x20;
-        *ptr++ = 0xb7;  // adaptation_field_length
-        *ptr++ = 0x10;
-        *ptr++ = (PCR_base >> 25) & 0xff;
-        *ptr++ = (PCR_base >> 17) & 0xff;
-        *ptr++ = (PCR_base >> 9) & 0xff;
-        *ptr++ = ((PCR_base & 1) << 7) | 0x7e | ((PCR_ext >> 8) & 1);
-        *ptr++ = (PCR_ext & 0xff);
+    numTSPackets += CountSectionPackets(flags);
 
-        size_t sizeLeft = packetDataStart + 188 - ptr;
-        ::memset(ptr, 0xff, sizeLeft);
+    auto buffer = buffer_pool_->Acquire(numTSPackets * 188);
+    // For a coalesced group this is the first held back unit's time,
+    // matching the PTS the PES below carries.
+    buffer->SetTimestamp(timeUs);
+    buffer->SetFrameId(access_unit->FrameId());
 
-        packetDataStart += 188;
-    }
+    uint8_t *packetDataStart = EmitSectionPackets(buffer->Data(), flags, timeUs);
 
     // Adjust time to 90kHz
     uint64_t PTS = (timeUs * 9ll) / 100ll;
@@ -670,7 +753,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
         sizeAvailableForPayload -= PES_private_data_len + 1;
     }
 
-    size_t copy = access_unit->Length();
+    size_t copy = payload_length;
 
     if (copy > sizeAvailableForPayload) {
         copy = sizeAvailableForPayload;
@@ -682,13 +765,17 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
 
     size_t numPaddingBytes = sizeAvailableForPayload - copy;
 
+    // Adaptation field and PES header stuffing emitted for this frame;
+    // feeds the mux overhead accounting.
+    size_t numStuffedBytes = numPaddingBytes + numStuffingBytes;
+
     uint8_t *ptr = packetDataStart;
-    *ptr++ = 0x47;
-    *ptr++ = 0x40 | (track->pid >> 8);
-    *ptr++ = track->pid & 0xff;
+    *ptr++ = kTSSyncByte;
+    *ptr++ = TSHeaderPIDHigh(track->pid, true);
+    *ptr++ = TSHeaderPIDLow(track->pid);
 
-    *ptr++ = (numPaddingBytes > 0 ? 0x30 : 0x10)
-                | track->NextContinuityCounter();
+    *ptr++ = TSHeaderAdaptationAndCounter(numPaddingBytes > 0,
+                                          track->NextContinuityCounter());
 
     if (numPaddingBytes > 0) {
         *ptr++ = numPaddingBytes - 1;
@@ -705,8 +792,8 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
     *ptr++ = track->stream_id;
     *ptr++ = PES_packet_length >> 8;
     *ptr++ = PES_packet_length & 0xff;
-    *ptr++ = 0x84;
-    *ptr++ = (PES_private_data_len > 0) ? 0x81 : 0x80;
+    *ptr++ = kPESHeaderMarkerAndAlignment;
+    *ptr++ = PESHeaderFlags(PES_private_data_len > 0);
 
     size_t headerLength = 0x05 + numStuffingBytes;
     if (PES_private_data_len > 0) {
@@ -715,11 +802,8 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
 
     *ptr++ = headerLength;
 
-    *ptr++ = 0x20 | (((PTS >> 30) & 7) << 1) | 1;
-    *ptr++ = (PTS >> 22) & 0xff;
-    *ptr++ = (((PTS >> 15) & 0x7f) << 1) | 1;
-    *ptr++ = (PTS >> 7) & 0xff;
-    *ptr++ = ((PTS & 0x7f) << 1) | 1;
+    WritePTS(ptr, PTS);
+    ptr += 5;
 
     if (PES_private_data_len > 0) {
         *ptr++ = 0x8e;  // PES_private_data_flag, reserved.
@@ -731,7 +815,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
         *ptr++ = 0xff;
     }
 
-    ::memcpy(ptr, access_unit->Data(), copy);
+    CopyPayload(ptr, copy);
     ptr += copy;
 
     if (ptr != packetDataStart + 188)
@@ -740,7 +824,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
     packetDataStart += 188;
 
     size_t offset = copy;
-    while (offset < access_unit->Length()) {
+    while (offset < payload_length) {
         // for subsequent fragments of "buffer":
         // 0x47
         // transport_error_indicator = b0
@@ -754,7 +838,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
 
         size_t sizeAvailableForPayload = 188 - 4;
 
-        size_t copy = access_unit->Length() - offset;
+        size_t copy = payload_length - offset;
 
         if (copy > sizeAvailableForPayload) {
             copy = sizeAvailableForPayload;
@@ -765,14 +849,15 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
         }
 
         size_t numPaddingBytes = sizeAvailableForPayload - copy;
+        numStuffedBytes += numPaddingBytes;
 
         uint8_t *ptr = packetDataStart;
-        *ptr++ = 0x47;
-        *ptr++ = 0x00 | (track->pid >> 8);
-        *ptr++ = track->pid & 0xff;
+        *ptr++ = kTSSyncByte;
+        *ptr++ = TSHeaderPIDHigh(track->pid, false);
+        *ptr++ = TSHeaderPIDLow(track->pid);
 
-        *ptr++ = (numPaddingBytes > 0 ? 0x30 : 0x10)
-                    | track->NextContinuityCounter();
+        *ptr++ = TSHeaderAdaptationAndCounter(numPaddingBytes > 0,
+                                              track->NextContinuityCounter());
 
         if (numPaddingBytes > 0) {
             *ptr++ = numPaddingBytes - 1;
@@ -783,7 +868,7 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
             }
         }
 
-        memcpy(ptr, access_unit->Data() + offset, copy);
+        CopyPayload(ptr, copy);
         ptr += copy;
         if (ptr != packetDataStart + 188)
             AC_FATAL("Invalid pointer position %p", ptr);
@@ -795,34 +880,225 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
     if (packetDataStart != buffer->Data() + buffer->Length())
         AC_FATAL("Invalid packet start position");
 
+    // Drop the references right away so the access unit can return to
+    // its pool without waiting for the next frame.
+    payload_segments.clear();
+
+    stuffing_bytes_.fetch_add(numStuffedBytes, std::memory_order_relaxed);
+    output_bytes_.fetch_add(buffer->Length(), std::memory_order_relaxed);
+
     *packets = buffer;
 
-    report_->PacketizedFrame(buffer->Timestamp());
+    AC_REPORT(report_->PacketizedFrame(buffer->Timestamp(), buffer->FrameId()));
 
     return true;
 }
 
-void MPEGTSPacketizer::InitCrcTable() {
-    uint32_t poly = 0x04C11DB7;
 
-    for (int i = 0; i < 256; i++) {
-        uint32_t crc = i << 24;
-        for (int j = 0; j < 8; j++) {
-            crc = (crc << 1) ^ ((crc & 0x80000000) ? (poly) : 0);
-        }
-        crc_table_[i] = crc;
+void MPEGTSPacketizer::BuildSectionTemplates() {
+    AC_DEBUG("");
+
+    // Program Association Table (PAT):
+    // 0x47
+    // transport_error_indicator = b0
+    // payload_unit_start_indicator = b1
+    // transport_priority = b0
+    // PID = b0000000000000 (13 bits)
+    // transport_scrambling_control = b00
+    // adaptation_field_control = b01 (no adaptation field, payload only)
+    // continuity_counter = b???? (patched per emission)
+    // skip = 0x00
+    // --- payload follows
+    // table_id = 0x00
+    // section_syntax_indicator = b1
+    // must_be_zero = b0
+    // reserved = b11
+    // section_length = 0x00d
+    // transport_stream_id = 0x0000
+    // reserved = b11
+    // version_number = b00001
+    // current_next_indicator = b1
+    // section_number = 0x00
+    // last_section_number = 0x00
+    //   one program follows:
+    //   program_number = 0x0001
+    //   reserved = b111
+    //   program_map_PID = kPID_PMT (13 bits!)
+    // CRC = 0x????????
+
+    pat_template_ = ac::video::Buffer::Create(188u);
+
+    uint8_t *packetDataStart = pat_template_->Data();
+    uint8_t *ptr = packetDataStart;
+    *ptr++ = kTSSyncByte;
+    *ptr++ = TSHeaderPIDHigh(0, true);
+    *ptr++ = TSHeaderPIDLow(0);
+    *ptr++ = TSHeaderAdaptationAndCounter(false, 0);
+    *ptr++ = 0x00;
+
+    uint8_t *crcDataStart = ptr;
+    *ptr++ = 0x00;
+    *ptr++ = 0xb0;
+    *ptr++ = 0x0d;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0xc3;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0x01;
+    *ptr++ = 0xe0 | (kPIDofPMT >> 8);
+    *ptr++ = kPIDofPMT & 0xff;
+
+    if (ptr - crcDataStart != 12)
+        AC_FATAL("Invalid position for ptr");
+
+    uint32_t crc = ::htonl(ac::Utils::CrcMpeg2(crcDataStart, ptr - crcDataStart));
+    ::memcpy(ptr, &crc, 4);
+    ptr += 4;
+
+    size_t sizeLeft = packetDataStart + 188 - ptr;
+    ::memset(ptr, 0xff, sizeLeft);
+
+    // Program Map (PMT):
+    // 0x47
+    // transport_error_indicator = b0
+    // payload_unit_start_indicator = b1
+    // transport_priority = b0
+    // PID = kPID_PMT (13 bits)
+    // transport_scrambling_control = b00
+    // adaptation_field_control = b01 (no adaptation field, payload only)
+    // continuity_counter = b???? (patched per emission)
+    // skip = 0x00
+    // -- payload follows
+    // table_id = 0x02
+    // section_syntax_indicator = b1
+    // must_be_zero = b0
+    // reserved = b11
+    // section_length = 0x???
+    // program_number = 0x0001
+    // reserved = b11
+    // version_number = b00001
+    // current_next_indicator = b1
+    // section_number = 0x00
+    // last_section_number = 0x00
+    // reserved = b111
+    // PCR_PID = kPCR_PID (13 bits)
+    // reserved = b1111
+    // program_info_length = 0x???
+    //   program_info_descriptors follow
+    // one or more elementary stream descriptions follow:
+    //   stream_type = 0x??
+    //   reserved = b111
+    //   elementary_PID = b? ???? ???? ???? (13 bits)
+    //   reserved = b1111
+    //   ES_info_length = 0x000
+    // CRC = 0x????????
+
+    // The section is assembled contiguously first; rich descriptor
+    // sets can push it past what a single TS packet carries, in which
+    // case it gets segmented over several packets below.
+    uint8_t section[3 + kMaxSectionLength];
+    ptr = section;
+
+    crcDataStart = ptr;
+    *ptr++ = 0x02;
+
+    *ptr++ = 0x00;  // section_length to be filled in below.
+    *ptr++ = 0x00;
+
+    *ptr++ = 0x00;
+    *ptr++ = 0x01;
+    *ptr++ = 0xc3;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0xe0 | (kPIDofPCR >> 8);
+    *ptr++ = kPIDofPCR & 0xff;
+
+    size_t program_info_length = 0;
+    for (auto descriptor : program_info_descriptors_)
+        program_info_length += descriptor->Length();
+
+    if(program_info_length >= 0x400)
+        AC_FATAL("Invalid length for program info");
+
+    *ptr++ = 0xf0 | (program_info_length >> 8);
+    *ptr++ = (program_info_length & 0xff);
+
+    for (auto descriptor : program_info_descriptors_) {
+        ::memcpy(ptr, descriptor->Data(), descriptor->Length());
+        ptr += descriptor->Length();
     }
-}
 
-uint32_t MPEGTSPacketizer::CalcCrc32(const uint8_t *start, size_t size) const {
-    uint32_t crc = 0xFFFFFFFF;
-    const uint8_t *p;
+    for (auto track : tracks_) {
+        // Make sure all the decriptors have been added.
+        track->Finalize();
+
+        *ptr++ = track->stream_type;
+        *ptr++ = 0xe0 | (track->pid >> 8);
+        *ptr++ = track->pid & 0xff;
+
+        size_t ES_info_length = 0;
+        for (auto descriptor : track->descriptors)
+            ES_info_length += descriptor->Length();
 
-    for (p = start; p < start + size; ++p) {
-        crc = (crc << 8) ^ crc_table_[((crc >> 24) ^ *p) & 0xFF];
+        if (ES_info_length > 0xfff)
+            AC_FATAL("Invalid ES length %d", ES_info_length);
+
+        *ptr++ = 0xf0 | (ES_info_length >> 8);
+        *ptr++ = (ES_info_length & 0xff);
+
+        for (auto descriptor : track->descriptors) {
+            memcpy(ptr, descriptor->Data(), descriptor->Length());
+            ptr += descriptor->Length();
+        }
     }
 
-    return crc;
+    size_t section_length = ptr - (crcDataStart + 3) + 4 /* CRC */;
+
+    if (section_length > kMaxSectionLength)
+        AC_FATAL("PMT section of %d bytes exceeds the allowed maximum", section_length);
+
+    crcDataStart[1] = 0xb0 | (section_length >> 8);
+    crcDataStart[2] = section_length & 0xff;
+
+    crc = ::htonl(ac::Utils::CrcMpeg2(crcDataStart, ptr - crcDataStart));
+    memcpy(ptr, &crc, 4);
+    ptr += 4;
+
+    // Segment the section across TS packets: the first one carries
+    // the pointer field and sets payload_unit_start, continuation
+    // packets just keep appending section bytes. The continuity
+    // counter nibble is patched per emission like for the PAT.
+    const size_t total = ptr - section;
+
+    size_t num_packets = 1;
+    if (total > 188 - 5)
+        num_packets += (total - (188 - 5) + (188 - 4) - 1) / (188 - 4);
+
+    pmt_template_ = ac::video::Buffer::Create(num_packets * 188);
+
+    const uint8_t *src = section;
+    size_t remaining = total;
+    uint8_t *packet = pmt_template_->Data();
+
+    for (size_t n = 0; n < num_packets; n++, packet += 188) {
+        ptr = packet;
+        *ptr++ = kTSSyncByte;
+        *ptr++ = TSHeaderPIDHigh(kPIDofPMT, n == 0);
+        *ptr++ = TSHeaderPIDLow(kPIDofPMT);
+        *ptr++ = TSHeaderAdaptationAndCounter(false, 0);
+        if (n == 0)
+            *ptr++ = 0x00;
+
+        const auto chunk = std::min<size_t>(remaining, packet + 188 - ptr);
+        ::memcpy(ptr, src, chunk);
+        ptr += chunk;
+        src += chunk;
+        remaining -= chunk;
+
+        ::memset(ptr, 0xff, packet + 188 - ptr);
+    }
 }
 
 } // namespace streaming
@@ -18,11 +18,14 @@
 #ifndef AC_STREAMING_MPEGTSPACKETIZER_H_
 #define AC_STREAMING_MPEGTSPACKETIZER_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
 #include "ac/video/packetizerreport.h"
 
+#include "ac/video/bufferpool.h"
+
 #include "ac/streaming/packetizer.h"
 
 namespace ac {
@@ -36,17 +39,31 @@ public:
 
     TrackId AddTrack(const TrackFormat &format) override;
 
+    void SetTightPacking(bool enable) override;
+
+    double MuxOverhead() const override;
+
     void SubmitCSD(TrackId track_index, const video::Buffer::Ptr &buffer) override;
 
     bool Packetize(TrackId track_index, const video::Buffer::Ptr &access_unit,
                    video::Buffer::Ptr *packets, int flags = 0) override;
 
+    bool PacketizeIdle(int64_t timestamp, video::Buffer::Ptr *packets, int flags = 0) override;
+
 private:
     MPEGTSPacketizer(const ac::video::PacketizerReport::Ptr &report);
 
 private:
-    void InitCrcTable();
-    uint32_t CalcCrc32(const uint8_t *start, size_t size) const;
+    // Serializes the PAT and PMT once into ready-made 188 byte TS
+    // packets (a rich PMT may span several); emission then only
+    // patches the continuity counters.
+    void BuildSectionTemplates();
+
+    // TS packets the PAT/PMT and PCR emissions selected through flags
+    // occupy in front of any payload
+    size_t CountSectionPackets(int flags);
+    // Writes those packets and returns the advanced write pointer
+    uint8_t* EmitSectionPackets(uint8_t *packetDataStart, int flags, int64_t time_us);
 
 private:
     struct Track;
@@ -55,9 +72,25 @@ private:
     ac::video::PacketizerReport::Ptr report_;
     unsigned int pat_continuity_counter_;
     unsigned int pmt_continuity_counter_;
-    uint32_t crc_table_[256];
+    // Timestamp the last PCR was emitted for; PCR must never run
+    // backwards.
+    int64_t last_pcr_us_;
     std::vector<std::shared_ptr<Track>> tracks_;
+    // Recycles the per-frame TS packet buffers
+    ac::video::BufferPool::Ptr buffer_pool_;
     std::vector<video::Buffer::Ptr> program_info_descriptors_;
+    // Cached PAT/PMT TS packets; the PMT template gets invalidated
+    // whenever the tracks or their descriptors change.
+    video::Buffer::Ptr pat_template_;
+    video::Buffer::Ptr pmt_template_;
+    // Scratch list of payload segments reused across Packetize calls
+    std::vector<video::Buffer::Ptr> payload_segments_;
+    bool tight_packing_;
+    // Stuffing vs total bytes emitted through Packetize; written on
+    // the packetizing thread and read from wherever the rate budget
+    // is adjusted.
+    std::atomic<uint64_t> stuffing_bytes_;
+    std::atomic<uint64_t> output_bytes_;
 };
 
 } // namespace streaming
@@ -42,13 +42,6 @@ public:
             constraint_set(constraint_set) {
         }
 
-        TrackFormat(const TrackFormat &other) :
-            mime(other.mime),
-            profile_idc(other.profile_idc),
-            level_idc(other.level_idc),
-            constraint_set(other.constraint_set) {
-        }
-
         bool operator==(const TrackFormat &rhs) const {
             return mime == rhs.mime &&
                     profile_idc == rhs.profile_idc &&
@@ -67,12 +60,32 @@ public:
         kEmitPCR = 2,
         kIsEncrypted = 4,
         kPrependSPSandPPStoIDRFrames = 8,
+        // Prepends the codec specific data regardless of the frame
+        // type; needed for gradual refresh streams which never carry
+        // a discrete IDR frame
+        kForcePrependSPSandPPS = 16,
     };
 
     virtual TrackId AddTrack(const TrackFormat &format) = 0;
+    // Optional low overhead packing mode: coalesces consecutive audio
+    // access units into shared PES packets where the spec allows it so
+    // fewer TS packets end in adaptation field stuffing. Video frames
+    // keep their one PES per access unit.
+    virtual void SetTightPacking(bool enable) { (void) enable; }
+    // Fraction of the emitted bytes spent on stuffing; lets the rate
+    // budget account for mux overhead instead of silently exceeding
+    // the negotiated bitrate with padding.
+    virtual double MuxOverhead() const { return 0.0; }
     virtual void SubmitCSD(TrackId track_index, const video::Buffer::Ptr &buffer) = 0;
+    // The output buffer carries the access unit's capture timestamp
+    // and frame id; senders and metrics downstream rely on that and
+    // must not have to restore timing through a side channel.
     virtual bool Packetize(TrackId track_index, const video::Buffer::Ptr &access_unit,
                            video::Buffer::Ptr *packets, int flags = 0) = 0;
+    // Emits only the table and clock packets selected through flags
+    // so the transport stream stays alive while no access units flow;
+    // fails when nothing was selected or no program exists yet.
+    virtual bool PacketizeIdle(int64_t timestamp, video::Buffer::Ptr *packets, int flags = 0) = 0;
 };
 
 } // namespace streaming
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <memory.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "ac/logger.h"
+
+#include "ac/common/clock.h"
+
+#include "ac/streaming/rtcpreceiver.h"
+
+namespace {
+static constexpr const char *kRTCPReceiverThreadName{"RTCPReceiver"};
+// Short poll so the executor loop can check for termination regularly
+static constexpr int kPollTimeoutMs = 1;
+static constexpr size_t kMaxRTCPPacketSize = 1500;
+// Feedback packets we drain from the socket with one recvmmsg() call
+static constexpr unsigned int kMaxBatchedPackets = 16;
+// RTCP packet types (RFC 3550/4585)
+static constexpr uint8_t kPacketTypeSenderReport = 200;
+static constexpr uint8_t kPacketTypeReceiverReport = 201;
+static constexpr uint8_t kPacketTypeTransportFeedback = 205;
+static constexpr uint8_t kPacketTypePayloadFeedback = 206;
+static constexpr uint8_t kFeedbackFormatGenericNACK = 1;
+static constexpr uint8_t kFeedbackFormatPLI = 1;
+static constexpr uint8_t kFeedbackFormatFIR = 4;
+// How often a sender report goes out; RFC 3550 suggests the order of
+// seconds and sinks only need the clock mapping refreshed, not traced.
+static constexpr int64_t kSenderReportIntervalUs = 1000000;
+// Seconds between the NTP epoch (1900) and the Unix epoch (1970)
+static constexpr uint32_t kNTPEpochOffset = 2208988800u;
+// A sender report without report blocks is exactly 7 words long
+static constexpr size_t kSenderReportSize = 28;
+
+static void WriteWord(uint8_t *ptr, uint32_t value) {
+    ptr[0] = value >> 24;
+    ptr[1] = (value >> 16) & 0xff;
+    ptr[2] = (value >> 8) & 0xff;
+    ptr[3] = value & 0xff;
+}
+}
+
+namespace ac {
+namespace streaming {
+
+RTCPReceiver::RTCPReceiver(const network::Port &port) :
+    port_(port),
+    socket_(-1),
+    report_pending_(false),
+    report_fraction_lost_(0),
+    report_jitter_(0),
+    sr_destination_valid_(false),
+    last_sr_time_(0) {
+    ::memset(&sr_destination_, 0, sizeof(sr_destination_));
+}
+
+RTCPReceiver::~RTCPReceiver() {
+    if (socket_ >= 0)
+        ::close(socket_);
+}
+
+void RTCPReceiver::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
+    delegate_ = delegate;
+}
+
+void RTCPReceiver::SetSenderStatsSource(const std::weak_ptr<SenderStatsSource> &source) {
+    stats_source_ = source;
+}
+
+void RTCPReceiver::SetSenderReportDestination(const std::string &address,
+                                              const network::Port &port) {
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+
+    if (::inet_aton(address.c_str(), &addr.sin_addr) == 0) {
+        AC_WARNING("Invalid sender report destination address %s", address.c_str());
+        return;
+    }
+
+    sr_destination_ = addr;
+    sr_destination_valid_ = true;
+}
+
+bool RTCPReceiver::Start() {
+    socket_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ < 0) {
+        AC_ERROR("Failed to create RTCP socket: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);
+
+    if (::bind(socket_, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_ERROR("Failed to bind RTCP socket: %s (%d)", ::strerror(errno), errno);
+        ::close(socket_);
+        socket_ = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool RTCPReceiver::Stop() {
+    return true;
+}
+
+void RTCPReceiver::ProcessPacket(const uint8_t *data, size_t size) {
+    // RTCP packets arrive as compound packets; walk all chunks
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+        const uint8_t *chunk = data + offset;
+
+        const auto version = chunk[0] >> 6;
+        if (version != 2)
+            break;
+
+        const unsigned int format = chunk[0] & 0x1f;
+        const auto packet_type = chunk[1];
+        const size_t length = ((chunk[2] << 8 | chunk[3]) + 1) * 4;
+
+        if (offset + length > size)
+            break;
+
+        if (packet_type == kPacketTypeReceiverReport) {
+            // Report blocks follow the reporter's SSRC; the format
+            // field carries their count.
+            size_t block_offset = 8;
+            for (unsigned int n = 0; n < format && block_offset + 24 <= length; n++) {
+                const uint8_t fraction_lost = chunk[block_offset + 4];
+                const uint32_t jitter = chunk[block_offset + 12] << 24 |
+                                        chunk[block_offset + 13] << 16 |
+                                        chunk[block_offset + 14] << 8 |
+                                        chunk[block_offset + 15];
+
+                // Collected here and flushed once per batch by
+                // Execute(); a sink spraying reports then costs the
+                // bitrate controller a single adjustment.
+                report_pending_ = true;
+                report_fraction_lost_ = std::max(report_fraction_lost_, fraction_lost);
+                report_jitter_ = jitter;
+
+                block_offset += 24;
+            }
+        }
+
+        if (packet_type == kPacketTypeTransportFeedback &&
+                format == kFeedbackFormatGenericNACK) {
+            // FCI entries follow the two SSRC fields; each carries a
+            // packet id and a bitmask of further lost packets.
+            size_t fci_offset = 12;
+            while (fci_offset + 4 <= length) {
+                const uint16_t packet_id = chunk[fci_offset] << 8 | chunk[fci_offset + 1];
+                const uint16_t bitmask = chunk[fci_offset + 2] << 8 | chunk[fci_offset + 3];
+
+                if (auto sp = delegate_.lock())
+                    sp->OnRetransmitRequested(packet_id, bitmask);
+
+                fci_offset += 4;
+            }
+        }
+
+        // Both PLI and FIR boil down to "send a decodable frame"; the
+        // FIR FCI entries carry nothing we need for a single stream.
+        if (packet_type == kPacketTypePayloadFeedback &&
+                (format == kFeedbackFormatPLI || format == kFeedbackFormatFIR)) {
+            if (auto sp = delegate_.lock())
+                sp->OnSinkRequestedIDRFrame();
+        }
+
+        offset += length;
+    }
+}
+
+void RTCPReceiver::MaybeSendSenderReport() {
+    if (!sr_destination_valid_)
+        return;
+
+    const auto now = static_cast<ac::TimestampUs>(common::Clock::NowUs());
+    if (last_sr_time_ != 0 && now - last_sr_time_ < kSenderReportIntervalUs)
+        return;
+
+    const auto source = stats_source_.lock();
+    if (!source)
+        return;
+
+    const auto stats = source->SenderStats();
+    // Before the first RTP packet there is no timestamp pair worth
+    // reporting and RFC 3550 reserves SRs for active senders anyway.
+    if (stats.packet_count == 0)
+        return;
+
+    // The NTP wall clock time and the RTP timestamp an RTP packet
+    // sent this very instant would carry; this pairing is what lets
+    // the sink place our stream on a common clock. The RTP timestamp
+    // derives from the same monotonic clock the sender stamps its
+    // packets with, converted to 90kHz the same way.
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    const uint32_t ntp_seconds = static_cast<uint32_t>(ts.tv_sec) + kNTPEpochOffset;
+    const uint32_t ntp_fraction = static_cast<uint32_t>(
+        (static_cast<uint64_t>(ts.tv_nsec) << 32) / 1000000000ull);
+    const uint32_t rtp_time = (now * 9) / 100ll;
+
+    uint8_t packet[kSenderReportSize];
+    packet[0] = 0x80; // Version 2, no padding, no report blocks
+    packet[1] = kPacketTypeSenderReport;
+    packet[2] = 0;
+    packet[3] = (kSenderReportSize / 4) - 1;
+    WriteWord(packet + 4, stats.source_id);
+    WriteWord(packet + 8, ntp_seconds);
+    WriteWord(packet + 12, ntp_fraction);
+    WriteWord(packet + 16, rtp_time);
+    WriteWord(packet + 20, stats.packet_count);
+    WriteWord(packet + 24, stats.octet_count);
+
+    if (::sendto(socket_, packet, sizeof(packet), MSG_DONTWAIT,
+                 reinterpret_cast<const struct sockaddr*>(&sr_destination_),
+                 sizeof(sr_destination_)) < 0) {
+        // A full socket buffer just delays the clock refresh by one
+        // interval; only log actual failures.
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            AC_WARNING("Failed to send RTCP sender report: %s (%d)",
+                       ::strerror(errno), errno);
+    }
+
+    last_sr_time_ = now;
+}
+
+bool RTCPReceiver::Execute() {
+    MaybeSendSenderReport();
+
+    struct pollfd fd;
+    fd.fd = socket_;
+    fd.events = POLLIN;
+    fd.revents = 0;
+
+    const auto ret = ::poll(&fd, 1, kPollTimeoutMs);
+    if (ret <= 0 || !(fd.revents & POLLIN))
+        return true;
+
+    // One wakeup drains a whole burst of feedback packets with a
+    // single syscall instead of paying one recv() per packet.
+    uint8_t packets[kMaxBatchedPackets][kMaxRTCPPacketSize];
+    struct mmsghdr messages[kMaxBatchedPackets];
+    struct iovec iovs[kMaxBatchedPackets];
+    struct sockaddr_in sources[kMaxBatchedPackets];
+    ::memset(messages, 0, sizeof(messages));
+
+    for (unsigned int n = 0; n < kMaxBatchedPackets; n++) {
+        iovs[n].iov_base = packets[n];
+        iovs[n].iov_len = kMaxRTCPPacketSize;
+        messages[n].msg_hdr.msg_iov = &iovs[n];
+        messages[n].msg_hdr.msg_iovlen = 1;
+        messages[n].msg_hdr.msg_name = &sources[n];
+        messages[n].msg_hdr.msg_namelen = sizeof(sources[n]);
+    }
+
+    const auto num_received = ::recvmmsg(socket_, messages, kMaxBatchedPackets,
+                                         MSG_DONTWAIT, nullptr);
+    if (num_received <= 0)
+        return true;
+
+    for (int n = 0; n < num_received; n++)
+        ProcessPacket(packets[n], messages[n].msg_len);
+
+    // Symmetric RTCP: whatever address the sink's feedback arrives
+    // from is where it expects our sender reports, NAT or not.
+    if (messages[num_received - 1].msg_hdr.msg_namelen >= sizeof(struct sockaddr_in)) {
+        sr_destination_ = sources[num_received - 1];
+        sr_destination_valid_ = true;
+    }
+
+    // Receiver reports from the batch collapse into one delivery;
+    // retransmit and IDR requests were already forwarded per packet
+    // as they are not meaningfully aggregatable.
+    if (report_pending_) {
+        if (auto sp = delegate_.lock())
+            sp->OnReceiverReport(report_fraction_lost_, report_jitter_);
+
+        report_pending_ = false;
+        report_fraction_lost_ = 0;
+        report_jitter_ = 0;
+    }
+
+    return true;
+}
+
+std::string RTCPReceiver::Name() const {
+    return kRTCPReceiverThreadName;
+}
+
+} // namespace streaming
+} // namespace ac
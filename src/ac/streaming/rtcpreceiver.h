@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_RTCPRECEIVER_H_
+#define AC_STREAMING_RTCPRECEIVER_H_
+
+#include <netinet/in.h>
+
+#include <memory>
+#include <string>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/common/executable.h"
+
+#include "ac/network/types.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Listens for RTCP feedback the sink sends back on the RTCP
+ * port paired with our RTP port.
+ *
+ * Currently generic NACK feedback (RFC 4585) is parsed and forwarded
+ * so lost datagrams can be retransmitted from the sender's cache, and
+ * picture loss indications (PLI/FIR) are turned into IDR requests.
+ *
+ * The receiver also answers with periodic sender reports built from
+ * the RTP sender's live statistics; without the NTP to RTP timestamp
+ * mapping they carry sinks cannot place our stream on a common clock
+ * and oversize their jitter buffers to compensate.
+ */
+class RTCPReceiver : public common::Executable {
+public:
+    typedef std::shared_ptr<RTCPReceiver> Ptr;
+
+    class Delegate : public ac::NonCopyable {
+    public:
+        // Sink reported the packet with first_sequence_number lost;
+        // each set bit n in bitmask marks first_sequence_number+n+1
+        // as lost too.
+        virtual void OnRetransmitRequested(uint16_t first_sequence_number,
+                                           uint16_t bitmask) = 0;
+
+        // Sink sent a receiver report; fraction_lost is the loss in
+        // 1/256 units since the last report, jitter the interarrival
+        // jitter estimate in RTP timestamp units.
+        virtual void OnReceiverReport(uint8_t, uint32_t) { }
+
+        // Sink asked for a picture refresh (PLI or FIR). Called
+        // straight from the RTCP receiver thread so implementations
+        // must only do lock-free work here; flipping the encoder's
+        // IDR request flag gets the refresh into the very next frame
+        // instead of bouncing through the GLib main loop first.
+        virtual void OnSinkRequestedIDRFrame() { }
+    };
+
+    /**
+     * @brief Live statistics of the outgoing RTP stream a sender
+     * report is built from.
+     */
+    class SenderStatsSource : public ac::NonCopyable {
+    public:
+        typedef std::shared_ptr<SenderStatsSource> Ptr;
+
+        struct Stats {
+            // SSRC the RTP stream is sent with
+            uint32_t source_id = 0;
+            // RTP packets and payload octets sent since the start of
+            // the session
+            uint32_t packet_count = 0;
+            uint32_t octet_count = 0;
+        };
+
+        virtual Stats SenderStats() const = 0;
+    };
+
+    RTCPReceiver(const network::Port &port);
+    ~RTCPReceiver();
+
+    void SetDelegate(const std::weak_ptr<Delegate> &delegate);
+
+    // Enables periodic sender report generation; without a source no
+    // reports are sent.
+    void SetSenderStatsSource(const std::weak_ptr<SenderStatsSource> &source);
+
+    // Where sender reports go until the sink's feedback reveals its
+    // actual RTCP address; by convention the port right above the
+    // sink's RTP port.
+    void SetSenderReportDestination(const std::string &address,
+                                    const network::Port &port);
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+
+private:
+    void ProcessPacket(const uint8_t *data, size_t size);
+    // Sends a sender report when one is due and the RTP stream has
+    // actually sent something; called once per Execute() iteration.
+    void MaybeSendSenderReport();
+
+private:
+    network::Port port_;
+    int socket_;
+    std::weak_ptr<Delegate> delegate_;
+    // Receiver reports seen while draining one batch collapse into a
+    // single delegate call carrying the worst loss and the latest
+    // jitter estimate; see Execute().
+    bool report_pending_;
+    uint8_t report_fraction_lost_;
+    uint32_t report_jitter_;
+    std::weak_ptr<SenderStatsSource> stats_source_;
+    // Sender reports leave through the feedback socket towards this
+    // address; seeded by convention and overridden by the source
+    // address of whatever the sink actually sends (symmetric RTCP).
+    struct sockaddr_in sr_destination_;
+    bool sr_destination_valid_;
+    ac::TimestampUs last_sr_time_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
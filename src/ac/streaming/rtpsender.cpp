@@ -28,8 +28,12 @@
 #include <error.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include "ac/logger.h"
 
+#include "ac/report/dispatch.h"
+
 #include "ac/streaming/rtpsender.h"
 
 namespace {
@@ -39,6 +43,23 @@ static constexpr unsigned int kMPEGTSPacketSize{188};
 static constexpr unsigned int kSourceID = 0xdeadbeef;
 // See http://www.iana.org/assignments/rtp-parameters/rtp-parameters.xhtml
 static constexpr unsigned int kRTPPayloadTypeMP2T = 33;
+// Minimum headroom between now and a datagram's kernel launch time
+static constexpr int64_t kLaunchTimeLeadUs = 500;
+// Number of recently sent packets kept for retransmission; must be a
+// power of two as the sequence number indexes the cache directly
+static constexpr unsigned int kRetransmitCacheSize = 512;
+// Number of RTP packets we pack into one buffer for streams with
+// segmentation offload; bounded by the maximum UDP datagram size.
+static constexpr unsigned int kMaxSegmentsPerSuperPacket = 48;
+// One-byte RTP header extensions per RFC 5285: the profile marker plus
+// one extension word carrying the 24 bit abs-send-time value.
+static constexpr unsigned int kSendTimeExtensionSize = 8;
+static constexpr unsigned int kExtensionProfileOneByte = 0xbede;
+// Id matching http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time;
+// without in-band negotiation the common default is the best bet.
+static constexpr unsigned int kSendTimeExtensionId = 3;
+// abs-send-time is 6.18 fixed point seconds and wraps every 64s
+static constexpr uint64_t kSendTimeWrapUs = 64000000ull;
 }
 
 namespace ac {
@@ -50,7 +71,17 @@ RTPSender::RTPSender(const network::Stream::Ptr &stream, const video::SenderRepo
     report_(report),
     rtp_sequence_number_(0),
     queue_(video::BufferQueue::Create()),
-    network_error_(false) {
+    buffer_pool_(video::BufferPool::Create()),
+    network_error_(false),
+    synchronous_(false),
+    send_time_extension_(false),
+    pacing_rate_bps_(0),
+    pacing_tokens_(0.0),
+    pacing_last_refill_us_(0),
+    next_launch_us_(0),
+    retransmit_cache_(kRetransmitCacheSize),
+    sent_packets_(0),
+    sent_octets_(0) {
 }
 
 RTPSender::~RTPSender() {
@@ -64,36 +95,396 @@ bool RTPSender::Stop() {
     return true;
 }
 
+void RTPSender::SetPacingRate(std::uint32_t bits_per_second) {
+    pacing_rate_bps_ = bits_per_second;
+}
+
+void RTPSender::EnableSynchronousSend() {
+    synchronous_ = true;
+}
+
+void RTPSender::EnableSendTimeExtension() {
+    send_time_extension_ = true;
+
+    // The larger header leaves room for fewer TS packets per datagram
+    max_ts_packets_ = std::max<std::uint32_t>(
+        1, (stream_->MaxUnitSize() - HeaderSize()) / kMPEGTSPacketSize);
+}
+
+std::uint32_t RTPSender::HeaderSize() const {
+    return kRTPHeaderSize + (send_time_extension_ ? kSendTimeExtensionSize : 0);
+}
+
+void RTPSender::UpdatePacketFactor() {
+    const auto max_ts_packets = std::max<std::uint32_t>(
+        1, (stream_->MaxUnitSize() - HeaderSize()) / kMPEGTSPacketSize);
+
+    if (max_ts_packets == max_ts_packets_)
+        return;
+
+    AC_INFO("Packing %u instead of %u TS packets per datagram after a unit size change",
+            max_ts_packets, max_ts_packets_);
+
+    max_ts_packets_ = max_ts_packets;
+}
+
+void RTPSender::SetQueueReport(const video::BufferQueueReport::Ptr &report) {
+    queue_->SetReport(Name(), report);
+}
+
+bool RTPSender::TakeTokens(std::uint32_t bytes) {
+    const auto rate = pacing_rate_bps_.load();
+    if (rate == 0)
+        return true;
+
+    // Bytes per microsecond the bucket refills with
+    const double refill_rate = static_cast<double>(rate) / 8. / 1000000.;
+    // Allow bursts worth roughly 10ms so a frame still goes out in a
+    // small number of batches instead of packet-by-packet.
+    const double capacity = std::max<double>(2. * stream_->MaxUnitSize(),
+                                             refill_rate * 10000.);
+
+    const auto now = static_cast<ac::TimestampUs>(ac::Utils::GetNowUs());
+    if (pacing_last_refill_us_ > 0)
+        pacing_tokens_ = std::min(capacity, pacing_tokens_ + (now - pacing_last_refill_us_) * refill_rate);
+    else
+        pacing_tokens_ = capacity;
+    pacing_last_refill_us_ = now;
+
+    if (pacing_tokens_ < bytes)
+        return false;
+
+    pacing_tokens_ -= bytes;
+    return true;
+}
+
+void RTPSender::WaitForTokens(std::uint32_t bytes) {
+    const auto rate = pacing_rate_bps_.load();
+    if (rate == 0)
+        return;
+
+    const double refill_rate = static_cast<double>(rate) / 8. / 1000000.;
+    const auto deficit_us = static_cast<int64_t>((bytes - pacing_tokens_) / refill_rate);
+
+    if (deficit_us > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(deficit_us));
+}
+
+void RTPSender::RecordSentPacket(const video::Buffer::Ptr &header,
+                                 const video::Buffer::Ptr &payload) {
+    // The sequence number lives in bytes 2 and 3 of the RTP header
+    const uint16_t sequence_number = header->Data()[2] << 8 | header->Data()[3];
+
+    std::lock_guard<std::mutex> g(retransmit_mutex_);
+
+    auto &slot = retransmit_cache_[sequence_number % kRetransmitCacheSize];
+    slot.valid = true;
+    slot.sequence_number = sequence_number;
+    slot.header = header;
+    slot.payload = payload;
+
+    // Retransmissions deliberately do not pass through here again;
+    // RFC 3550 counts every packet once.
+    sent_packets_.fetch_add(1, std::memory_order_relaxed);
+    sent_octets_.fetch_add(payload->Length(), std::memory_order_relaxed);
+}
+
+RTPSender::Stats RTPSender::SenderStats() const {
+    Stats stats;
+    stats.source_id = kSourceID;
+    stats.packet_count = sent_packets_.load(std::memory_order_relaxed);
+    stats.octet_count = sent_octets_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void RTPSender::ResumeTransport() {
+    // Sequence numbers, the RTP timestamp base, the retransmission
+    // cache and the RTCP totals all stay untouched, so after the
+    // stream has been retargeted the sink sees one contiguous RTP
+    // stream instead of a fresh session.
+    if (network_error_.exchange(false))
+        AC_INFO("Resuming RTP transport after network error");
+}
+
+bool RTPSender::Retransmit(uint16_t first_sequence_number, uint16_t bitmask) {
+    std::vector<network::Stream::Datagram> datagrams;
+    std::vector<video::Buffer::Ptr> alive;
+
+    {
+        std::lock_guard<std::mutex> g(retransmit_mutex_);
+
+        for (unsigned int n = 0; n < 17; n++) {
+            if (n > 0 && !(bitmask & (1 << (n - 1))))
+                continue;
+
+            const uint16_t sequence_number = (first_sequence_number + n) & 0xffff;
+
+            const auto &slot = retransmit_cache_[sequence_number % kRetransmitCacheSize];
+            if (!slot.valid || slot.sequence_number != sequence_number) {
+                AC_DEBUG("Packet %d already evicted from retransmission cache", sequence_number);
+                continue;
+            }
+
+            // A retransmission carries its own send time, not the
+            // original one; the sink's jitter estimate must not see
+            // the NACK round trip as network delay.
+            if (send_time_extension_)
+                StampSendTime(slot.header->Data());
+
+            datagrams.push_back(network::Stream::Datagram(
+                slot.header->Data(), slot.header->Length(),
+                slot.payload->Data(), slot.payload->Length(),
+                slot.header->Timestamp()));
+            alive.push_back(slot.header);
+            alive.push_back(slot.payload);
+        }
+    }
+
+    if (datagrams.empty())
+        return false;
+
+    return stream_->WriteBatch(datagrams) == network::Stream::Error::kNone;
+}
+
+void RTPSender::ScheduleLaunchTimes(std::vector<network::Stream::Datagram> &datagrams) {
+    const double refill_rate = static_cast<double>(pacing_rate_bps_.load()) / 8. / 1000000.;
+
+    auto launch_time = std::max<ac::TimestampUs>(
+        ac::Utils::GetNowUs() + kLaunchTimeLeadUs, next_launch_us_);
+
+    for (auto &datagram : datagrams) {
+        datagram.launch_time_us = launch_time;
+        launch_time += static_cast<int64_t>((datagram.header_size + datagram.size) / refill_rate);
+    }
+
+    next_launch_us_ = launch_time;
+}
+
+void RTPSender::StampSendTime(uint8_t *header) {
+    // 6.18 fixed point seconds; the truncation to 24 bits is the
+    // protocol's own wrap, sinks only ever look at differences.
+    const auto now_us = ac::Utils::GetNowUs() % kSendTimeWrapUs;
+    const auto send_time = static_cast<uint32_t>((now_us << 18) / 1000000ull);
+
+    header[17] = (send_time >> 16) & 0xff;
+    header[18] = (send_time >> 8) & 0xff;
+    header[19] = send_time & 0xff;
+}
+
+void RTPSender::FillRTPHeader(uint8_t *ptr, const ac::TimestampUs &timestamp) {
+    ptr[0] = send_time_extension_ ? 0x90 : 0x80;
+    ptr[1] = kRTPPayloadTypeMP2T;
+
+    ptr[2] = (rtp_sequence_number_ >> 8) & 0xff;
+    ptr[3] = rtp_sequence_number_ & 0xff;
+
+    rtp_sequence_number_ = (rtp_sequence_number_ + 1) & 0xffff;
+
+    // Adjust the buffer's capture time to 90kHz; deriving the RTP
+    // timestamp from capture instead of send time keeps receiver
+    // side jitter measurements honest and saves a clock read per
+    // packet.
+    uint32_t rtp_time = (timestamp * 9) / 100ll;
+
+    ptr[4] = rtp_time >> 24;
+    ptr[5] = (rtp_time >> 16) & 0xff;
+    ptr[6] = (rtp_time >> 8) & 0xff;
+    ptr[7] = rtp_time & 0xff;
+
+    ptr[8] = kSourceID >> 24;
+    ptr[9] = (kSourceID >> 16) & 0xff;
+    ptr[10] = (kSourceID >> 8) & 0xff;
+    ptr[11] = kSourceID & 0xff;
+
+    if (!send_time_extension_)
+        return;
+
+    // One extension word: the one-byte profile marker, a length of
+    // one, then id/length and the 24 bit send time. The time itself
+    // is stamped right before the wire, not here.
+    ptr[12] = (kExtensionProfileOneByte >> 8) & 0xff;
+    ptr[13] = kExtensionProfileOneByte & 0xff;
+    ptr[14] = 0x00;
+    ptr[15] = 0x01;
+    ptr[16] = (kSendTimeExtensionId << 4) | 0x02;
+    ptr[17] = ptr[18] = ptr[19] = 0x00;
+}
+
+network::Stream::Datagram RTPSender::BuildDatagram(const video::Buffer::Ptr &header,
+                                                   const video::Buffer::Ptr &payload,
+                                                   bool needs_completion) {
+    network::Stream::Datagram datagram(
+        header->Data(), header->Length(),
+        payload->Data(), payload->Length(),
+        header->Timestamp());
+    datagram.frame_id = header->FrameId();
+
+    // For zero-copy capable streams the kernel may still reference
+    // the data after WriteBatch returns; the guard keeps header and
+    // payload alive and hands the payload back to its owner once
+    // the stream signals completion.
+    if (needs_completion)
+        datagram.completion = std::shared_ptr<void>(
+            nullptr, [header, payload](void*) { payload->Release(); });
+
+    return datagram;
+}
+
+bool RTPSender::SendSuperPacket(const video::Buffer::Ptr &packet,
+                                std::uint32_t segment_size) {
+    while (!TakeTokens(packet->Length()))
+        WaitForTokens(packet->Length());
+
+    // An RTP header sits at the start of every segment
+    if (send_time_extension_) {
+        for (uint32_t offset = 0; offset < packet->Length(); offset += segment_size)
+            StampSendTime(packet->Data() + offset);
+    }
+
+    if (stream_->WriteSegmented(packet->Data(), packet->Length(),
+                                segment_size, packet->Timestamp())
+            != network::Stream::Error::kNone) {
+        network_error_.exchange(true);
+        return false;
+    }
+
+    AC_REPORT(report_->SentPacket(packet->Timestamp(), packet->Length(), packet->FrameId()));
+
+    return true;
+}
+
+bool RTPSender::SendDatagrams(std::vector<network::Stream::Datagram> &datagrams) {
+    if (datagrams.empty())
+        return true;
+
+    // Streams with launch time support get the whole burst at once
+    // with per-datagram deadlines; the kernel releases them on time
+    // without us burning CPU in sleeps.
+    if (pacing_rate_bps_.load() > 0 && stream_->SupportsScheduledSend()) {
+        ScheduleLaunchTimes(datagrams);
+
+        if (stream_->WriteBatch(datagrams) != network::Stream::Error::kNone) {
+            network_error_.exchange(true);
+            return false;
+        }
+
+        AC_REPORT(
+            for (const auto &datagram : datagrams)
+                report_->SentPacket(datagram.timestamp,
+                                    datagram.header_size + datagram.size,
+                                    datagram.frame_id));
+
+        return true;
+    }
+
+    // With pacing enabled a burst gets split into several smaller
+    // batches with short sleeps in between so the WiFi driver queue is
+    // never flooded with a whole frame at once.
+    size_t submitted = 0;
+    while (submitted < datagrams.size()) {
+        std::vector<network::Stream::Datagram> chunk;
+
+        while (submitted < datagrams.size()) {
+            const auto &datagram = datagrams.at(submitted);
+            if (!TakeTokens(datagram.header_size + datagram.size))
+                break;
+            chunk.push_back(datagram);
+            submitted++;
+        }
+
+        if (!chunk.empty() &&
+                stream_->WriteBatch(chunk) != network::Stream::Error::kNone) {
+            network_error_.exchange(true);
+            return false;
+        }
+
+        if (submitted < datagrams.size()) {
+            const auto &next = datagrams.at(submitted);
+            WaitForTokens(next.header_size + next.size);
+        }
+    }
+
+    AC_REPORT(
+        for (const auto &datagram : datagrams)
+            report_->SentPacket(datagram.timestamp,
+                                datagram.header_size + datagram.size,
+                                datagram.frame_id));
+
+    return !network_error_;
+}
+
 bool RTPSender::Execute() {
     if (!queue_->WaitToBeFilled())
         return true;
 
+    if (stream_->SupportsSegmentedWrite()) {
+        // Super-packets carry many RTP packets each and get segmented
+        // by the kernel; one syscall covers a whole frame. Each buffer
+        // travels with the segment size it was packed with so an MTU
+        // change never splits it at the wrong boundaries.
+        queue_->Lock();
+
+        std::vector<video::Buffer::Ptr> super_packets;
+        std::vector<std::uint32_t> segment_sizes;
+
+        while (true) {
+            const auto packet = queue_->PopUnlocked();
+            if (!packet)
+                break;
+
+            super_packets.push_back(packet);
+            segment_sizes.push_back(segment_sizes_.front());
+            segment_sizes_.pop();
+        }
+
+        queue_->Unlock();
+
+        for (size_t n = 0; n < super_packets.size(); n++) {
+            if (!SendSuperPacket(super_packets[n], segment_sizes[n]))
+                return false;
+        }
+
+        return true;
+    }
+
     queue_->Lock();
 
+    // Drain the whole queue into a single batch so the stream can
+    // submit all pending packets with as few syscalls as possible. The
+    // RTP header and TS payload travel as separate fragments so the
+    // payload never has to be copied out of the packetizer's buffer.
+    std::vector<video::Buffer::Ptr> packets;
+    std::vector<network::Stream::Datagram> datagrams;
+
+    const bool needs_completion = stream_->RequiresCompletionTracking();
+
     while(true) {
         const auto packet = queue_->PopUnlocked();
         if (!packet)
             break;
 
-        if (stream_->Write(packet->Data(), packet->Length(), packet->Timestamp())
-                != network::Stream::Error::kNone) {
-            network_error_.exchange(true);
-            break;
-        } else {
-            AC_DEBUG("Sent packet %lu", (unsigned long)packet->Length());
-        }
+        const auto payload = payloads_.front();
+        payloads_.pop();
+
+        if (send_time_extension_)
+            StampSendTime(packet->Data());
 
-        report_->SentPacket(packet->Timestamp(), packet->Length());
+        datagrams.push_back(BuildDatagram(packet, payload, needs_completion));
+        packets.push_back(packet);
+        packets.push_back(payload);
     }
 
     queue_->Unlock();
 
-    return !network_error_;
+    if (packets.empty())
+        return true;
+
+    return SendDatagrams(datagrams);
 }
 
 bool RTPSender::Queue(const video::Buffer::Ptr &packets) {
     if (packets->Length() % kMPEGTSPacketSize != 0) {
-        AC_WARNING("Packet buffer has an invalid length %d", packets->Length());
+        AC_WARNING_RATE_LIMITED("Packet buffer has an invalid length %d", packets->Length());
         return false;
     }
 
@@ -106,56 +497,70 @@ bool RTPSender::Queue(const video::Buffer::Ptr &packets) {
         return false;
     }
 
-    queue_->Lock();
+    UpdatePacketFactor();
+
+    if (stream_->SupportsSegmentedWrite())
+        return QueueSegmented(packets);
+
+    if (!synchronous_)
+        queue_->Lock();
+
+    // In synchronous mode the datagrams are assembled right here and
+    // put on the wire before returning; the buffers below keep the
+    // headers and payload views alive across the write.
+    std::vector<video::Buffer::Ptr> sync_buffers;
+    std::vector<network::Stream::Datagram> sync_datagrams;
+    const bool needs_completion = stream_->RequiresCompletionTracking();
 
     uint32_t offset = 0;
     while (offset < packets->Length()) {
-        const auto packet = ac::video::Buffer::Create(kRTPHeaderSize + max_ts_packets_ * kMPEGTSPacketSize);
+        // Only the RTP header is written freshly here; the TS payload
+        // stays in the packetizer's output buffer and is referenced in
+        // place through a view.
+        auto packet = buffer_pool_->Acquire(HeaderSize());
 
         if (!packet->Data())
             continue;
 
-        uint8_t *ptr = packet->Data();
-
-        ptr[0] = 0x80;
-        ptr[1] = kRTPPayloadTypeMP2T;
-
-        ptr[2] = (rtp_sequence_number_ >> 8) & 0xff;
-        ptr[3] = rtp_sequence_number_ & 0xff;
-
-        rtp_sequence_number_ = (rtp_sequence_number_ + 1) & 0xffff;
-
-        // Adjust time to 90kHz
-        uint32_t rtp_time = (ac::Utils::GetNowUs() * 9) / 100ll;
-
-        ptr[4] = rtp_time >> 24;
-        ptr[5] = (rtp_time >> 16) & 0xff;
-        ptr[6] = (rtp_time >> 8) & 0xff;
-        ptr[7] = rtp_time & 0xff;
-
-        ptr[8] = kSourceID >> 24;
-        ptr[9] = (kSourceID >> 16) & 0xff;
-        ptr[10] = (kSourceID >> 8) & 0xff;
-        ptr[11] = kSourceID & 0xff;
+        FillRTPHeader(packet->Data(), packets->Timestamp());
 
         size_t num_ts_packets = (packets->Length() - offset) / kMPEGTSPacketSize;
         if (num_ts_packets > max_ts_packets_)
             num_ts_packets = max_ts_packets_;
 
-        ::memcpy(&ptr[12], packets->Data() + offset, num_ts_packets * kMPEGTSPacketSize);
-
-        packet->SetRange(0, kRTPHeaderSize + num_ts_packets * kMPEGTSPacketSize);
+        auto payload = ac::video::Buffer::CreateView(
+            packets, offset, num_ts_packets * kMPEGTSPacketSize);
+        if (!payload)
+            break;
 
         // We're only setting the timestamp on the packet here for
         // statistically reasons we can check later on how late we
         // send a buffer out.
         packet->SetTimestamp(packets->Timestamp());
+        packet->SetFrameId(packets->FrameId());
 
         offset += num_ts_packets * kMPEGTSPacketSize;
 
-        queue_->PushUnlocked(packet);
+        RecordSentPacket(packet, payload);
+
+        if (synchronous_) {
+            if (send_time_extension_)
+                StampSendTime(packet->Data());
+            sync_datagrams.push_back(BuildDatagram(packet, payload, needs_completion));
+            sync_buffers.push_back(std::move(packet));
+            sync_buffers.push_back(std::move(payload));
+            continue;
+        }
+
+        // Both references move into their queues so the handoff costs
+        // no refcount round trip.
+        queue_->PushUnlocked(std::move(packet));
+        payloads_.push(std::move(payload));
     }
 
+    if (synchronous_)
+        return SendDatagrams(sync_datagrams);
+
     AC_DEBUG("QUeue unlockiing");
     queue_->Unlock();
     AC_DEBUG("Queue unlocked");
@@ -163,6 +568,72 @@ bool RTPSender::Queue(const video::Buffer::Ptr &packets) {
     return true;
 }
 
+bool RTPSender::QueueSegmented(const video::Buffer::Ptr &packets) {
+    if (!synchronous_)
+        queue_->Lock();
+
+    uint32_t offset = 0;
+    while (offset < packets->Length()) {
+        size_t num_datagrams = (packets->Length() - offset + max_ts_packets_ * kMPEGTSPacketSize - 1)
+                / (max_ts_packets_ * kMPEGTSPacketSize);
+        if (num_datagrams > kMaxSegmentsPerSuperPacket)
+            num_datagrams = kMaxSegmentsPerSuperPacket;
+
+        auto super_packet = buffer_pool_->Acquire(
+            num_datagrams * (HeaderSize() + max_ts_packets_ * kMPEGTSPacketSize));
+
+        if (!super_packet->Data())
+            continue;
+
+        uint32_t super_offset = 0;
+
+        // Interleave an RTP header in front of every run of TS packets
+        // so the kernel can split the buffer at segment boundaries into
+        // ready-made RTP datagrams.
+        for (size_t n = 0; n < num_datagrams; n++) {
+            uint8_t *ptr = super_packet->Data() + super_offset;
+
+            FillRTPHeader(ptr, packets->Timestamp());
+
+            size_t num_ts_packets = (packets->Length() - offset) / kMPEGTSPacketSize;
+            if (num_ts_packets > max_ts_packets_)
+                num_ts_packets = max_ts_packets_;
+
+            ::memcpy(ptr + HeaderSize(), packets->Data() + offset,
+                     num_ts_packets * kMPEGTSPacketSize);
+
+            // Views keep the super-packet alive so individual RTP
+            // packets can be retransmitted later on.
+            RecordSentPacket(
+                ac::video::Buffer::CreateView(super_packet, super_offset, HeaderSize()),
+                ac::video::Buffer::CreateView(super_packet, super_offset + HeaderSize(),
+                                              num_ts_packets * kMPEGTSPacketSize));
+
+            offset += num_ts_packets * kMPEGTSPacketSize;
+            super_offset += HeaderSize() + num_ts_packets * kMPEGTSPacketSize;
+        }
+
+        super_packet->SetRange(0, super_offset);
+        super_packet->SetTimestamp(packets->Timestamp());
+        super_packet->SetFrameId(packets->FrameId());
+
+        if (synchronous_) {
+            if (!SendSuperPacket(super_packet,
+                                 HeaderSize() + max_ts_packets_ * kMPEGTSPacketSize))
+                return false;
+            continue;
+        }
+
+        segment_sizes_.push(HeaderSize() + max_ts_packets_ * kMPEGTSPacketSize);
+        queue_->PushUnlocked(std::move(super_packet));
+    }
+
+    if (!synchronous_)
+        queue_->Unlock();
+
+    return true;
+}
+
 int32_t RTPSender::LocalPort() const {
     return stream_->LocalPort();
 }
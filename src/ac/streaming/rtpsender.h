@@ -30,16 +30,19 @@
 #include "ac/network/stream.h"
 
 #include "ac/video/buffer.h"
+#include "ac/video/bufferpool.h"
 #include "ac/video/bufferqueue.h"
 #include "ac/video/senderreport.h"
 
+#include "ac/streaming/rtcpreceiver.h"
 #include "ac/streaming/transportsender.h"
 
 namespace ac {
 namespace streaming {
 
 class RTPSender : public TransportSender,
-                  public common::Executable {
+                  public common::Executable,
+                  public RTCPReceiver::SenderStatsSource {
 public:
     RTPSender(const network::Stream::Ptr &stream, const video::SenderReport::Ptr &report);
     ~RTPSender();
@@ -48,19 +51,129 @@ public:
     bool Queue(const ac::video::Buffer::Ptr &packets) override;
     int32_t LocalPort() const override;
 
+    // Configures the token bucket used to space packet bursts out over
+    // time; a rate of 0 disables pacing and sends as fast as possible.
+    void SetPacingRate(std::uint32_t bits_per_second);
+
+    // Fuses the send stage into the caller: Queue() packs and writes
+    // the packets on the spot instead of handing them to the sender
+    // thread, removing a queue traversal and a thread handoff from the
+    // latency budget. The caller then pays for the pacing sleeps and
+    // syscalls itself, so this only makes sense where no core is free
+    // to overlap them anyway; the sender must not be added to an
+    // executor. Call before the first Queue().
+    void EnableSynchronousSend();
+
+    // Adds an abs-send-time RTP header extension to every outgoing
+    // packet, stamped on the sending thread right before the packet
+    // hits the socket. Sinks which understand it can split sender-side
+    // delay from real network jitter and converge on a tighter jitter
+    // buffer. Off by default: it costs 8 bytes per packet and confuses
+    // nothing, but buys nothing, on sinks that ignore extensions.
+    // Call before the first Queue().
+    void EnableSendTimeExtension();
+
+    // Enables depth/stall/drop telemetry on the packet queue
+    void SetQueueReport(const ac::video::BufferQueueReport::Ptr &report);
+
+    // Clears a latched network error so sending continues with the
+    // same sequence/timestamp state; called after the underlying
+    // stream has been retargeted at the (possibly moved) sink.
+    void ResumeTransport();
+
+    // Resends recently sent packets from the retransmission cache;
+    // sequence numbers follow RFC 4585 generic NACK semantics where
+    // each set bit n in bitmask marks first_sequence_number+n+1 lost.
+    bool Retransmit(uint16_t first_sequence_number, uint16_t bitmask);
+
+    // From ac::streaming::RTCPReceiver::SenderStatsSource; feeds the
+    // periodic RTCP sender reports.
+    Stats SenderStats() const override;
+
     // From ac::common::Executable
     bool Start() override;
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
 
+private:
+    // One slot of the fixed-size retransmission cache; header and
+    // payload buffers are reused via their reference counts so steady
+    // state stays allocation-free.
+    struct CachedPacket {
+        bool valid = false;
+        uint16_t sequence_number = 0;
+        ac::video::Buffer::Ptr header;
+        ac::video::Buffer::Ptr payload;
+    };
+
+    void FillRTPHeader(uint8_t *ptr, const ac::TimestampUs &timestamp);
+    // Size of the headers FillRTPHeader produces; grows beyond the
+    // fixed 12 bytes when the send time extension is enabled.
+    std::uint32_t HeaderSize() const;
+    // Rewrites the abs-send-time field of an already filled header
+    // with the current time; called right before the wire.
+    void StampSendTime(uint8_t *header);
+    // Wraps a header/payload pair for the stream; with completion
+    // tracking the datagram keeps both alive until the kernel is done
+    // with the data.
+    network::Stream::Datagram BuildDatagram(const ac::video::Buffer::Ptr &header,
+                                            const ac::video::Buffer::Ptr &payload,
+                                            bool needs_completion);
+    // The actual wire submission shared between the sender thread and
+    // the synchronous path: scheduled launch times when the stream
+    // supports them, token-bucket chunked batches otherwise.
+    bool SendDatagrams(std::vector<network::Stream::Datagram> &datagrams);
+    bool SendSuperPacket(const ac::video::Buffer::Ptr &packet,
+                         std::uint32_t segment_size);
+    // Re-derives the packing factor from the stream's current unit
+    // size so a path MTU change takes effect with the next queued
+    // buffer; only called from the queueing thread.
+    void UpdatePacketFactor();
+    void RecordSentPacket(const ac::video::Buffer::Ptr &header,
+                          const ac::video::Buffer::Ptr &payload);
+    bool QueueSegmented(const ac::video::Buffer::Ptr &packets);
+    // Refills the token bucket and tries to take bytes from it
+    bool TakeTokens(std::uint32_t bytes);
+    void WaitForTokens(std::uint32_t bytes);
+    // Assigns kernel launch times spreading the datagrams out at the
+    // pacing rate; used instead of sleeping when the stream supports
+    // scheduled sends.
+    void ScheduleLaunchTimes(std::vector<network::Stream::Datagram> &datagrams);
+
 private:
     network::Stream::Ptr stream_;
-    const std::uint32_t max_ts_packets_;
+    std::uint32_t max_ts_packets_;
     video::SenderReport::Ptr report_;
     uint16_t rtp_sequence_number_;
     ac::video::BufferQueue::Ptr queue_;
+    // Recycles the per-packet header and super-packet storage so the
+    // send path stays free of heap allocations in steady state.
+    ac::video::BufferPool::Ptr buffer_pool_;
+    // TS payload views queued in lockstep with the RTP headers in
+    // queue_; only touched while queue_ is locked.
+    std::queue<ac::video::Buffer::Ptr> payloads_;
+    // Segment size each queued super-packet was packed with, in
+    // lockstep with queue_ so a packing factor change can never split
+    // an already packed buffer at the wrong boundaries; only touched
+    // while queue_ is locked.
+    std::queue<std::uint32_t> segment_sizes_;
     std::atomic<bool> network_error_;
+    // In synchronous mode the queueing thread is the only one touching
+    // the pacing state and the stream, so no extra locking is needed;
+    // it just moved threads.
+    bool synchronous_;
+    bool send_time_extension_;
+    std::atomic<std::uint32_t> pacing_rate_bps_;
+    double pacing_tokens_;
+    ac::TimestampUs pacing_last_refill_us_;
+    ac::TimestampUs next_launch_us_;
+    std::vector<CachedPacket> retransmit_cache_;
+    std::mutex retransmit_mutex_;
+    // Totals since session start for the RTCP sender reports; written
+    // on the queueing thread and read from the RTCP receiver thread.
+    std::atomic<std::uint32_t> sent_packets_;
+    std::atomic<std::uint32_t> sent_octets_;
 };
 
 } // namespace streaming
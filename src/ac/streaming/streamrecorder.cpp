@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <memory.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "ac/logger.h"
+
+#include "ac/report/metrics/metricsregistry.h"
+
+#include "ac/streaming/streamrecorder.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define AC_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace {
+static constexpr const char *kStreamRecorderThreadName{"StreamRecorder"};
+// Large enough that a submission amortizes the per-write cost, small
+// enough that a chunk fills every few frames at typical bitrates.
+static constexpr size_t kChunkSize{256 * 1024};
+// Covers the logical block size of any disk we run on and satisfies
+// the O_DIRECT buffer, length and offset requirements.
+static constexpr size_t kChunkAlignment{4096};
+// Staging chunks and thereby the maximum number of writes in flight;
+// one chunk stays available for filling while the rest drain.
+static constexpr unsigned int kNumChunks{4};
+// Packet runs buffered towards the recorder thread; at one run per
+// frame this holds several seconds of backlog before drops start.
+static constexpr uint32_t kQueueDepth{256};
+}
+
+namespace ac {
+namespace streaming {
+
+StreamRecorder::Ptr StreamRecorder::Create(const std::string &path) {
+    auto recorder = std::shared_ptr<StreamRecorder>(new StreamRecorder(path));
+    if (!recorder->OpenFile())
+        return nullptr;
+
+    return recorder;
+}
+
+StreamRecorder::StreamRecorder(const std::string &path) :
+    path_(path),
+    fd_(-1),
+    direct_(false),
+    running_(false),
+    queue_(video::BufferQueue::Create(kQueueDepth)),
+    current_chunk_(0),
+    submit_offset_(0),
+    total_bytes_(0),
+    ring_available_(false),
+    ring_fd_(-1),
+    sq_ring_(nullptr),
+    sq_ring_size_(0),
+    cq_ring_(nullptr),
+    cq_ring_size_(0),
+    sqes_(nullptr),
+    sqes_size_(0),
+    sq_head_(nullptr),
+    sq_tail_(nullptr),
+    sq_mask_(0),
+    sq_array_(nullptr),
+    cq_head_(nullptr),
+    cq_tail_(nullptr),
+    cq_mask_(0),
+    cqes_(nullptr) {
+}
+
+StreamRecorder::~StreamRecorder() {
+    Stop();
+
+    for (auto &chunk : chunks_)
+        ::free(chunk.data);
+
+    TeardownRing();
+
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool StreamRecorder::OpenFile() {
+    // Session recordings carry whatever was on screen; no reason to
+    // make them world readable.
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0640);
+    if (fd_ >= 0) {
+        direct_ = true;
+    } else {
+        // tmpfs and a few other filesystems reject O_DIRECT; the
+        // batched aligned writes are still worth doing through the
+        // page cache then.
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0640);
+        if (fd_ < 0) {
+            AC_ERROR("Failed to open recording file %s: %s (%d)",
+                     path_.c_str(), ::strerror(errno), errno);
+            return false;
+        }
+    }
+
+    chunks_.resize(kNumChunks);
+    for (auto &chunk : chunks_) {
+        if (::posix_memalign(reinterpret_cast<void**>(&chunk.data),
+                             kChunkAlignment, kChunkSize) != 0) {
+            AC_ERROR("Failed to allocate recording chunks");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void StreamRecorder::Queue(const video::Buffer::Ptr &packets) {
+    if (!running_ || !packets)
+        return;
+
+    // Dropping the newest run keeps everything already queued
+    // contiguous, so the recording stays decodable right up to the
+    // gap. The live stream never sees any of this.
+    if (queue_->IsFull()) {
+        report::metrics::MetricsRegistry::Instance().Increment("recording_drops");
+        return;
+    }
+
+    queue_->Push(packets);
+}
+
+bool StreamRecorder::Start() {
+    if (fd_ < 0)
+        return false;
+
+    ring_available_ = SetupRing();
+    running_ = true;
+
+    return true;
+}
+
+bool StreamRecorder::Stop() {
+    if (!running_)
+        return true;
+
+    running_ = false;
+
+    // Whatever the sender queued up to this point still belongs into
+    // the recording.
+    for (const auto &packets : queue_->PopAll())
+        Append(packets);
+
+    FlushTail();
+
+    return true;
+}
+
+bool StreamRecorder::Execute() {
+    // Short timeout so a stop request is picked up promptly
+    if (!queue_->WaitToBeFilled())
+        return running_;
+
+    for (const auto &packets : queue_->PopAll())
+        Append(packets);
+
+    return running_;
+}
+
+void StreamRecorder::Append(const video::Buffer::Ptr &packets) {
+    size_t offset = 0;
+
+    while (offset < packets->Length()) {
+        auto &chunk = chunks_.at(current_chunk_);
+
+        const auto available = kChunkSize - chunk.filled;
+        const auto count = std::min<size_t>(available, packets->Length() - offset);
+
+        ::memcpy(chunk.data + chunk.filled, packets->Data() + offset, count);
+        chunk.filled += count;
+        offset += count;
+        total_bytes_ += count;
+
+        if (chunk.filled == kChunkSize && !SubmitChunk(chunk))
+            return;
+    }
+}
+
+std::string StreamRecorder::Name() const {
+    return kStreamRecorderThreadName;
+}
+
+#ifdef AC_HAVE_IO_URING
+
+namespace {
+int io_uring_setup(unsigned int entries, struct io_uring_params *params) {
+    return ::syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                   unsigned int flags) {
+    return ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+}
+
+bool StreamRecorder::SetupRing() {
+    struct io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+
+    ring_fd_ = io_uring_setup(kNumChunks, &params);
+    if (ring_fd_ < 0) {
+        AC_DEBUG("Kernel does not support io_uring; recording with plain writes");
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        AC_ERROR("Failed to map io_uring rings: %s (%d)", ::strerror(errno), errno);
+        TeardownRing();
+        return false;
+    }
+
+    auto sq_base = static_cast<uint8_t*>(sq_ring_);
+    sq_head_ = reinterpret_cast<uint32_t*>(sq_base + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq_base + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(sq_base + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32_t*>(sq_base + params.sq_off.array);
+
+    auto cq_base = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq_base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq_base + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(cq_base + params.cq_off.ring_mask);
+    cqes_ = cq_base + params.cq_off.cqes;
+
+    return true;
+}
+
+void StreamRecorder::TeardownRing() {
+    if (sq_ring_ && sq_ring_ != MAP_FAILED)
+        ::munmap(sq_ring_, sq_ring_size_);
+    if (cq_ring_ && cq_ring_ != MAP_FAILED)
+        ::munmap(cq_ring_, cq_ring_size_);
+    if (sqes_ && sqes_ != MAP_FAILED)
+        ::munmap(sqes_, sqes_size_);
+
+    sq_ring_ = cq_ring_ = sqes_ = nullptr;
+
+    if (ring_fd_ >= 0)
+        ::close(ring_fd_);
+
+    ring_fd_ = -1;
+    ring_available_ = false;
+}
+
+void StreamRecorder::ReapCompletions() {
+    auto head = __atomic_load_n(cq_head_, __ATOMIC_ACQUIRE);
+    const auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        const auto cqe = reinterpret_cast<struct io_uring_cqe*>(cqes_) + (head & cq_mask_);
+
+        if (cqe->res < 0)
+            AC_WARNING_RATE_LIMITED("Recording write failed: %s (%d)",
+                                    ::strerror(-cqe->res), -cqe->res);
+
+        auto &chunk = chunks_.at(cqe->user_data);
+        chunk.in_flight = false;
+        chunk.filled = 0;
+
+        head++;
+    }
+
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+bool StreamRecorder::WaitForCompletions() {
+    while (true) {
+        bool in_flight = false;
+        for (const auto &chunk : chunks_)
+            in_flight = in_flight || chunk.in_flight;
+        if (!in_flight)
+            return true;
+
+        if (io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+            AC_ERROR("Failed to wait for recording writes: %s (%d)",
+                     ::strerror(errno), errno);
+            return false;
+        }
+        ReapCompletions();
+    }
+}
+
+int StreamRecorder::FindFreeChunk() {
+    for (size_t n = 0; n < chunks_.size(); n++) {
+        if (!chunks_.at(n).in_flight && chunks_.at(n).filled == 0)
+            return n;
+    }
+    return -1;
+}
+
+bool StreamRecorder::SubmitChunk(Chunk &chunk) {
+    if (!ring_available_) {
+        size_t written = 0;
+        while (written < chunk.filled) {
+            const auto ret = ::write(fd_, chunk.data + written, chunk.filled - written);
+            if (ret < 0) {
+                AC_WARNING_RATE_LIMITED("Recording write failed: %s (%d)",
+                                        ::strerror(errno), errno);
+                return false;
+            }
+            written += ret;
+        }
+        submit_offset_ += chunk.filled;
+        chunk.filled = 0;
+        return true;
+    }
+
+    chunk.in_flight = true;
+
+    const auto tail = *sq_tail_;
+    const auto index = tail & sq_mask_;
+
+    auto sqe = reinterpret_cast<struct io_uring_sqe*>(sqes_) + index;
+    ::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(chunk.data);
+    sqe->len = chunk.filled;
+    sqe->off = submit_offset_;
+    sqe->user_data = &chunk - chunks_.data();
+
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    submit_offset_ += chunk.filled;
+
+    if (io_uring_enter(ring_fd_, 1, 0, 0) < 0) {
+        AC_ERROR("Failed to submit recording write: %s (%d)",
+                 ::strerror(errno), errno);
+        chunk.in_flight = false;
+        chunk.filled = 0;
+        return false;
+    }
+
+    ReapCompletions();
+
+    // Move filling over to a drained chunk; when the disk has all of
+    // them in flight recording (not streaming) waits right here.
+    auto next = FindFreeChunk();
+    if (next < 0) {
+        if (!WaitForCompletions())
+            return false;
+        next = FindFreeChunk();
+        if (next < 0)
+            return false;
+    }
+    current_chunk_ = next;
+
+    return true;
+}
+
+void StreamRecorder::FlushTail() {
+    auto &chunk = chunks_.at(current_chunk_);
+
+    if (chunk.filled > 0) {
+        if (direct_) {
+            // O_DIRECT insists on block sized writes; pad the tail up
+            // and truncate the padding away below.
+            const auto padded = (chunk.filled + kChunkAlignment - 1)
+                    & ~(kChunkAlignment - 1);
+            ::memset(chunk.data + chunk.filled, 0, padded - chunk.filled);
+            chunk.filled = padded;
+        }
+        SubmitChunk(chunk);
+    }
+
+    if (ring_available_)
+        WaitForCompletions();
+
+    if (::ftruncate(fd_, total_bytes_) < 0)
+        AC_WARNING("Failed to trim recording tail padding: %s (%d)",
+                   ::strerror(errno), errno);
+}
+
+#else // AC_HAVE_IO_URING
+
+bool StreamRecorder::SetupRing() {
+    return false;
+}
+
+void StreamRecorder::TeardownRing() {
+}
+
+void StreamRecorder::ReapCompletions() {
+}
+
+bool StreamRecorder::WaitForCompletions() {
+    return true;
+}
+
+int StreamRecorder::FindFreeChunk() {
+    return -1;
+}
+
+bool StreamRecorder::SubmitChunk(Chunk &chunk) {
+    size_t written = 0;
+    while (written < chunk.filled) {
+        const auto ret = ::write(fd_, chunk.data + written, chunk.filled - written);
+        if (ret < 0) {
+            AC_WARNING_RATE_LIMITED("Recording write failed: %s (%d)",
+                                    ::strerror(errno), errno);
+            return false;
+        }
+        written += ret;
+    }
+    submit_offset_ += chunk.filled;
+    chunk.filled = 0;
+    return true;
+}
+
+void StreamRecorder::FlushTail() {
+    auto &chunk = chunks_.at(current_chunk_);
+
+    if (chunk.filled > 0) {
+        if (direct_) {
+            const auto padded = (chunk.filled + kChunkAlignment - 1)
+                    & ~(kChunkAlignment - 1);
+            ::memset(chunk.data + chunk.filled, 0, padded - chunk.filled);
+            chunk.filled = padded;
+        }
+        SubmitChunk(chunk);
+    }
+
+    if (::ftruncate(fd_, total_bytes_) < 0)
+        AC_WARNING("Failed to trim recording tail padding: %s (%d)",
+                   ::strerror(errno), errno);
+}
+
+#endif
+
+} // namespace streaming
+} // namespace ac
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_STREAMRECORDER_H_
+#define AC_STREAMING_STREAMRECORDER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ac/common/executable.h"
+
+#include "ac/video/bufferqueue.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Tees the packetizer's transport stream output into a local
+ * file while the session streams.
+ *
+ * The media sender hands every transport packet run over via Queue()
+ * which only pushes into a bounded queue; all file I/O happens on this
+ * stage's own thread in large aligned chunks, batched through io_uring
+ * and O_DIRECT where the kernel and filesystem offer them. When the
+ * disk cannot keep up the queue drops the newest packets - the
+ * recording grows a gap but the live stream never waits.
+ */
+class StreamRecorder : public common::Executable {
+public:
+    typedef std::shared_ptr<StreamRecorder> Ptr;
+
+    // Creates a recorder writing to path; nullptr when the file
+    // cannot be opened.
+    static Ptr Create(const std::string &path);
+
+    ~StreamRecorder();
+
+    // Takes a run of transport packets from the sender thread. Never
+    // blocks; under I/O pressure the run is dropped and counted.
+    void Queue(const video::Buffer::Ptr &packets);
+
+    std::uint64_t BytesRecorded() const { return total_bytes_; }
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+    // Chunk submission can block on a saturated disk
+    bool PrefersDedicatedThread() const override { return true; }
+
+private:
+    struct Chunk {
+        uint8_t *data = nullptr;
+        size_t filled = 0;
+        bool in_flight = false;
+    };
+
+    explicit StreamRecorder(const std::string &path);
+
+    bool OpenFile();
+    void Append(const video::Buffer::Ptr &packets);
+    bool SubmitChunk(Chunk &chunk);
+    void FlushTail();
+
+    bool SetupRing();
+    void TeardownRing();
+    void ReapCompletions();
+    bool WaitForCompletions();
+    int FindFreeChunk();
+
+private:
+    std::string path_;
+    int fd_;
+    bool direct_;
+    bool running_;
+    video::BufferQueue::Ptr queue_;
+    std::vector<Chunk> chunks_;
+    int current_chunk_;
+    // Next file offset a chunk gets submitted at
+    std::uint64_t submit_offset_;
+    // Bytes actually recorded; the O_DIRECT tail padding gets
+    // truncated away so the file ends here
+    std::uint64_t total_bytes_;
+
+    bool ring_available_;
+    int ring_fd_;
+    // Mapped submission/completion ring state; see streamrecorder.cpp
+    void *sq_ring_;
+    size_t sq_ring_size_;
+    void *cq_ring_;
+    size_t cq_ring_size_;
+    void *sqes_;
+    size_t sqes_size_;
+    uint32_t *sq_head_;
+    uint32_t *sq_tail_;
+    uint32_t sq_mask_;
+    uint32_t *sq_array_;
+    uint32_t *cq_head_;
+    uint32_t *cq_tail_;
+    uint32_t cq_mask_;
+    void *cqes_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "ac/streaming/tsanalyzer.h"
+
+namespace {
+static constexpr std::size_t kTSPacketSize{188};
+static constexpr std::uint8_t kTSSyncByte{0x47};
+static constexpr unsigned int kPIDofPAT{0};
+static constexpr unsigned int kPIDofNullPackets{0x1fff};
+// The WiFi Display spec wants PCR and the tables at least every
+// 100ms; our mux keys their emission off the first access unit past
+// the deadline, so legitimate streams run up to one frame interval
+// late. The slack keeps those clean while a stalled cadence - the
+// regressions this analyzer exists for - still trips immediately.
+static constexpr ac::TimestampUs kMaxPCRIntervalUs{150000ll};
+static constexpr ac::TimestampUs kMaxTableIntervalUs{150000ll};
+}
+
+namespace ac {
+namespace streaming {
+
+TSAnalyzer::TSAnalyzer() :
+    pmt_pid_(-1),
+    last_pcr_us_(-1),
+    last_pat_arrival_us_(-1),
+    last_pmt_arrival_us_(-1) {
+    continuity_.fill(0xff);
+}
+
+void TSAnalyzer::Process(const std::uint8_t *data, std::size_t size,
+                         const ac::TimestampUs &arrival_us) {
+    std::size_t offset = 0;
+    while (offset + kTSPacketSize <= size) {
+        ProcessPacket(data + offset, arrival_us);
+        offset += kTSPacketSize;
+    }
+
+    // The mux only ever hands out whole packets; a ragged tail means
+    // something upstream sliced the stream at the wrong boundary.
+    if (offset != size)
+        counters_.sync_errors++;
+}
+
+void TSAnalyzer::ProcessPacket(const std::uint8_t *packet,
+                               const ac::TimestampUs &arrival_us) {
+    counters_.packets++;
+
+    if (packet[0] != kTSSyncByte) {
+        counters_.sync_errors++;
+        return;
+    }
+
+    const unsigned int pid = ((packet[1] & 0x1f) << 8) | packet[2];
+    const bool payload_unit_start = (packet[1] & 0x40) != 0;
+    const bool has_adaptation = (packet[3] & 0x20) != 0;
+    const bool has_payload = (packet[3] & 0x10) != 0;
+    const auto continuity = static_cast<std::uint8_t>(packet[3] & 0x0f);
+
+    // The counter only advances with payload-carrying packets and is
+    // undefined on null packets; an unchanged counter is a legal
+    // duplicate and neither advances the sequence nor counts against
+    // it.
+    if (has_payload && pid != kPIDofNullPackets) {
+        const auto last = continuity_[pid];
+        if (last != 0xff && continuity != last
+                && continuity != ((last + 1) & 0x0f))
+            counters_.continuity_errors++;
+        if (continuity != last)
+            continuity_[pid] = continuity;
+    }
+
+    std::size_t payload_offset = 4;
+    if (has_adaptation) {
+        const std::size_t adaptation_length = packet[4];
+        ProcessPCR(packet + 4, adaptation_length + 1);
+        payload_offset += adaptation_length + 1;
+    }
+
+    if (!has_payload || !payload_unit_start
+            || payload_offset >= kTSPacketSize)
+        return;
+
+    if (pid == kPIDofPAT) {
+        counters_.pat_count++;
+        if (last_pat_arrival_us_ >= 0
+                && arrival_us - last_pat_arrival_us_ > kMaxTableIntervalUs)
+            counters_.pat_interval_violations++;
+        last_pat_arrival_us_ = arrival_us;
+
+        ProcessPAT(packet + payload_offset, kTSPacketSize - payload_offset);
+    } else if (pmt_pid_ >= 0 && pid == static_cast<unsigned int>(pmt_pid_)) {
+        counters_.pmt_count++;
+        if (last_pmt_arrival_us_ >= 0
+                && arrival_us - last_pmt_arrival_us_ > kMaxTableIntervalUs)
+            counters_.pmt_interval_violations++;
+        last_pmt_arrival_us_ = arrival_us;
+    }
+}
+
+void TSAnalyzer::ProcessPAT(const std::uint8_t *payload, std::size_t size) {
+    // pointer_field, then the section; we only need the first real
+    // program's map PID so the PMT cadence can be tracked on the PID
+    // the mux actually announces.
+    if (size < 1)
+        return;
+
+    const std::size_t section_offset = 1 + payload[0];
+    if (section_offset + 8 > size)
+        return;
+
+    const std::uint8_t *section = payload + section_offset;
+    if (section[0] != 0x00) // table_id of a PAT
+        return;
+
+    const std::size_t section_length = ((section[1] & 0x0f) << 8) | section[2];
+    // Shorter than header plus CRC cannot be a valid section
+    if (section_length < 9)
+        return;
+
+    // Program loop between the fixed header and the trailing CRC
+    const std::size_t loop_end = std::min(size - section_offset,
+                                          3 + section_length - 4);
+
+    for (std::size_t n = 8; n + 4 <= loop_end; n += 4) {
+        const unsigned int program = (section[n] << 8) | section[n + 1];
+        if (program == 0) // network PID entry
+            continue;
+
+        pmt_pid_ = ((section[n + 2] & 0x1f) << 8) | section[n + 3];
+        break;
+    }
+}
+
+void TSAnalyzer::ProcessPCR(const std::uint8_t *adaptation, std::size_t size) {
+    // adaptation_field_length, flags, then the 48 bit PCR field
+    if (size < 8 || adaptation[0] < 7 || (adaptation[1] & 0x10) == 0)
+        return;
+
+    counters_.pcr_count++;
+
+    const std::uint64_t base =
+            (static_cast<std::uint64_t>(adaptation[2]) << 25) |
+            (static_cast<std::uint64_t>(adaptation[3]) << 17) |
+            (static_cast<std::uint64_t>(adaptation[4]) << 9) |
+            (static_cast<std::uint64_t>(adaptation[5]) << 1) |
+            (adaptation[6] >> 7);
+    const std::uint64_t extension = ((adaptation[6] & 0x01) << 8) | adaptation[7];
+
+    // Back to microseconds of the 27MHz clock the mux derives it from
+    const auto pcr_us = static_cast<std::int64_t>((base * 300 + extension) / 27);
+
+    if (last_pcr_us_ >= 0) {
+        const auto delta = pcr_us - last_pcr_us_;
+        const bool discontinuity = (adaptation[1] & 0x80) != 0;
+
+        if (delta < 0 && !discontinuity)
+            counters_.pcr_backward_jumps++;
+        else if (delta > kMaxPCRIntervalUs && !discontinuity)
+            counters_.pcr_interval_violations++;
+
+        counters_.max_pcr_interval_us = std::max(counters_.max_pcr_interval_us,
+                                                 static_cast<ac::TimestampUs>(delta));
+    }
+
+    last_pcr_us_ = pcr_us;
+}
+
+} // namespace streaming
+} // namespace ac
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_TSANALYZER_H_
+#define AC_STREAMING_TSANALYZER_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Checks a transport stream against the constraints our mux
+ * promises to uphold.
+ *
+ * Validates the invariants a sink's demuxer relies on: sync bytes,
+ * per-PID continuity counter sequences, monotonic PCR with the
+ * WiFi Display cadence, and PAT/PMT repetition. PIDs are learned from
+ * the tables rather than assumed, so the analyzer flags a mux that
+ * stops describing its own program.
+ *
+ * Designed for the receiving end of the loopback and soak harnesses:
+ * one pass per packet with a handful of table lookups, cheap enough
+ * to keep up with the stream in real time. Everything suspicious only
+ * bumps a counter; scoring and thresholds are the caller's business.
+ */
+class TSAnalyzer : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<TSAnalyzer> Ptr;
+
+    struct Counters {
+        std::uint64_t packets = 0;
+        std::uint64_t sync_errors = 0;
+        std::uint64_t continuity_errors = 0;
+        std::uint64_t pat_count = 0;
+        std::uint64_t pmt_count = 0;
+        std::uint64_t pcr_count = 0;
+        // PCR deltas beyond the allowed cadence or running backwards
+        // without a signalled discontinuity
+        std::uint64_t pcr_interval_violations = 0;
+        std::uint64_t pcr_backward_jumps = 0;
+        // Gaps between table repetitions beyond the allowed cadence,
+        // measured on packet arrival time
+        std::uint64_t pat_interval_violations = 0;
+        std::uint64_t pmt_interval_violations = 0;
+        ac::TimestampUs max_pcr_interval_us = 0;
+
+        bool Clean() const {
+            return sync_errors + continuity_errors
+                    + pcr_interval_violations + pcr_backward_jumps
+                    + pat_interval_violations + pmt_interval_violations == 0;
+        }
+    };
+
+    TSAnalyzer();
+
+    // Consumes one or more contiguous 188 byte TS packets, e.g. a
+    // whole RTP payload; arrival_us anchors the table repetition
+    // checks. A trailing partial packet counts as a sync error.
+    void Process(const std::uint8_t *data, std::size_t size,
+                 const ac::TimestampUs &arrival_us);
+
+    const Counters& Stats() const { return counters_; }
+
+    // Forgives the next continuity step on every PID. For callers
+    // which know the transport in front of the analyzer dropped
+    // something (an RTP sequence gap on a lossy harness link, say) so
+    // real mux regressions stay distinguishable from transport loss.
+    void SignalLoss() { continuity_.fill(0xff); }
+
+private:
+    void ProcessPacket(const std::uint8_t *packet,
+                       const ac::TimestampUs &arrival_us);
+    void ProcessPAT(const std::uint8_t *payload, std::size_t size);
+    void ProcessPCR(const std::uint8_t *adaptation, std::size_t size);
+
+private:
+    Counters counters_;
+    // Last continuity counter seen per PID; 0xff marks a PID not seen
+    // yet. The full 13 bit PID space is only 8k so a flat table beats
+    // any map on the hot path.
+    std::array<std::uint8_t, 8192> continuity_;
+    std::int32_t pmt_pid_;
+    std::int64_t last_pcr_us_;
+    ac::TimestampUs last_pat_arrival_us_;
+    ac::TimestampUs last_pmt_arrival_us_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
@@ -21,6 +21,31 @@
 #include "ac/ubuntu/unity.h"
 #include "ac/ubuntu/unitydisplaylock.h"
 
+namespace {
+// A session restart tears the last lock holder down and acquires
+// again well within this window; keeping the locks slightly longer is
+// free while dropping and re-taking them serializes pipeline start on
+// the platform services.
+static constexpr unsigned int kReleaseDebounceMs{1000};
+
+// Sleep inhibition goes through powerd; an active sys-state request
+// keeps the SoC from suspending while frames flow.
+constexpr const char *kPowerdBusName{"com.canonical.powerd"};
+constexpr const char *kPowerdPath{"/com/canonical/powerd"};
+constexpr const char *kPowerdInterfaceName{"com.canonical.powerd"};
+// POWERD_SYS_STATE_ACTIVE in powerd's state enumeration.
+constexpr int kPowerdStateActive{1};
+
+// The lock screen honors the freedesktop screensaver inhibition,
+// which lives on the session bus.
+constexpr const char *kScreenSaverBusName{"org.freedesktop.ScreenSaver"};
+constexpr const char *kScreenSaverPath{"/org/freedesktop/ScreenSaver"};
+constexpr const char *kScreenSaverInterfaceName{"org.freedesktop.ScreenSaver"};
+
+constexpr const char *kRequestorName{"aethercast"};
+constexpr const char *kInhibitReason{"Screen casting session active"};
+}
+
 namespace ac {
 namespace ubuntu {
 
@@ -30,7 +55,12 @@ UnityDisplayLock::Ptr UnityDisplayLock::Create() {
 
 UnityDisplayLock::UnityDisplayLock() :
     ref_count_(0),
-    cookie_(0) {
+    display_state_(LegState::kUnlocked),
+    sleep_state_(LegState::kUnlocked),
+    screensaver_state_(LegState::kUnlocked),
+    display_cookie_(0),
+    screensaver_cookie_(0),
+    release_timeout_(0) {
 
     GError *error = nullptr;
     connection_.reset(g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, &error));
@@ -39,89 +69,366 @@ UnityDisplayLock::UnityDisplayLock() :
         g_error_free(error);
         return;
     }
+
+    // Running as a system daemon there may simply be no session bus;
+    // the display and sleep legs still work without one.
+    error = nullptr;
+    session_connection_.reset(g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error));
+    if (!session_connection_) {
+        AC_WARNING("Failed to connect to session bus, screensaver will not be inhibited: %s",
+                   error->message);
+        g_error_free(error);
+    }
 }
 
 UnityDisplayLock::~UnityDisplayLock() {
-    ReleaseInternal();
+    if (release_timeout_ > 0)
+        g_source_remove(release_timeout_);
+
+    // Fire and forget; there is nobody left to hand the replies to.
+    // In-flight calls keep the object alive through their keep-alives
+    // so per leg we can only get here settled in a rest state.
+    if (connection_ && display_state_ == LegState::kLocked)
+        g_dbus_connection_call(connection_.get(),
+                               unity::screen::kBusName,
+                               unity::screen::kPath,
+                               unity::screen::kInterfaceName,
+                               "removeDisplayOnRequest",
+                               g_variant_new("(i)", display_cookie_),
+                               nullptr,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               nullptr,
+                               nullptr,
+                               nullptr);
+
+    if (connection_ && sleep_state_ == LegState::kLocked)
+        g_dbus_connection_call(connection_.get(),
+                               kPowerdBusName,
+                               kPowerdPath,
+                               kPowerdInterfaceName,
+                               "clearSysState",
+                               g_variant_new("(s)", sleep_cookie_.c_str()),
+                               nullptr,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               nullptr,
+                               nullptr,
+                               nullptr);
+
+    if (session_connection_ && screensaver_state_ == LegState::kLocked)
+        g_dbus_connection_call(session_connection_.get(),
+                               kScreenSaverBusName,
+                               kScreenSaverPath,
+                               kScreenSaverInterfaceName,
+                               "UnInhibit",
+                               g_variant_new("(u)", screensaver_cookie_),
+                               nullptr,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               nullptr,
+                               nullptr,
+                               nullptr);
 }
 
 void UnityDisplayLock::Acquire(DisplayState state) {
-    if (ref_count_ > 0) {
-        ref_count_++;
+    ref_count_++;
+    Sync();
+}
+
+void UnityDisplayLock::Release(DisplayState state) {
+    if (ref_count_ == 0)
+        return;
+
+    if (--ref_count_ > 0)
+        return;
+
+    // Don't drop the locks right away; a reconnecting session acquires
+    // again shortly and then nothing needs to hit the bus at all.
+    if (release_timeout_ > 0)
+        return;
+
+    release_timeout_ = g_timeout_add_full(G_PRIORITY_DEFAULT, kReleaseDebounceMs,
+                                          [](gpointer user_data) -> gboolean {
+        auto thiz = static_cast<WeakKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie().lock();
+        if (!thiz)
+            return FALSE;
+
+        thiz->release_timeout_ = 0;
+        thiz->Sync();
+        return FALSE;
+    }, new WeakKeepAlive<UnityDisplayLock>{shared_from_this()}, [](gpointer user_data) {
+        delete static_cast<WeakKeepAlive<UnityDisplayLock>*>(user_data);
+    });
+}
+
+void UnityDisplayLock::Sync() {
+    // Still inside the debounce window; the timeout re-syncs.
+    if (ref_count_ == 0 && release_timeout_ > 0)
+        return;
+
+    // The legs move independently; dispatching them back to back puts
+    // all three requests on the wire in the same main-loop iteration
+    // instead of serializing the round-trips.
+    SyncDisplay();
+    SyncSleep();
+    SyncScreenSaver();
+}
+
+void UnityDisplayLock::SyncDisplay() {
+    if (!connection_)
+        return;
+
+    // A call is already on its way; its completion callback comes
+    // back here and picks up whatever ref_count_ says by then.
+    if (display_state_ == LegState::kLocking || display_state_ == LegState::kUnlocking)
+        return;
+
+    if (ref_count_ > 0 && display_state_ == LegState::kUnlocked) {
+        display_state_ = LegState::kLocking;
+
+        g_dbus_connection_call(connection_.get(),
+                               unity::screen::kBusName,
+                               unity::screen::kPath,
+                               unity::screen::kInterfaceName,
+                               "keepDisplayOn",
+                               nullptr,
+                               G_VARIANT_TYPE("(i)"),
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1, // Make sure we wait for the service being started up
+                               nullptr,
+                               [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+            auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
+
+            GError *error = nullptr;
+            auto result = g_dbus_connection_call_finish(thiz->connection_.get(), res, &error);
+            if (!result) {
+                AC_ERROR("Failed to acquire display lock: %s", error->message);
+                g_error_free(error);
+                thiz->display_state_ = LegState::kUnlocked;
+                return;
+            }
+
+            thiz->display_cookie_ = g_variant_get_int32(g_variant_get_child_value(result, 0));
+            thiz->display_state_ = LegState::kLocked;
+
+            AC_DEBUG("Successfully locked display (cookie %d)", thiz->display_cookie_);
+
+            thiz->SyncDisplay();
+
+        }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+
         return;
     }
 
-    g_dbus_connection_call(connection_.get(),
-                           unity::screen::kBusName,
-                           unity::screen::kPath,
-                           unity::screen::kInterfaceName,
-                           "keepDisplayOn",
-                           nullptr,
-                           G_VARIANT_TYPE("(i)"),
-                           G_DBUS_CALL_FLAGS_NONE,
-                           -1, // Make sure we wait for the service being started up
-                           nullptr,
-                           [](GObject *source, GAsyncResult *res, gpointer user_data) {
-
-        auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
-
-        GError *error = nullptr;
-        auto result = g_dbus_connection_call_finish(thiz->connection_.get(), res, &error);
-        if (!result) {
-            AC_ERROR("Failed to acquire display lock: %s", error->message);
-            g_error_free(error);
-            return;
-        }
-
-        thiz->cookie_ = g_variant_get_int32(g_variant_get_child_value(result, 0));
-        thiz->ref_count_ = 1;
-
-        AC_DEBUG("Successfully locked display (cookie %d)", thiz->cookie_);
-
-    }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+    if (ref_count_ == 0 && display_state_ == LegState::kLocked) {
+        display_state_ = LegState::kUnlocking;
+
+        g_dbus_connection_call(connection_.get(),
+                               unity::screen::kBusName,
+                               unity::screen::kPath,
+                               unity::screen::kInterfaceName,
+                               "removeDisplayOnRequest",
+                               g_variant_new("(i)", display_cookie_),
+                               nullptr,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1, // Make sure we wait for the service being started up
+                               nullptr,
+                               [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+            auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
+
+            GError *error = nullptr;
+            auto result = g_dbus_connection_call_finish(thiz->connection_.get(), res, &error);
+            if (!result) {
+                AC_ERROR("Failed to release display lock: %s", error->message);
+                g_error_free(error);
+                // Unity still counts us as a holder; stay locked so a
+                // later acquire/release cycle retries the removal.
+                thiz->display_state_ = LegState::kLocked;
+                return;
+            }
+
+            thiz->display_cookie_ = 0;
+            thiz->display_state_ = LegState::kUnlocked;
+
+            AC_DEBUG("Successfully unlocked display");
+
+            thiz->SyncDisplay();
+
+        }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+    }
 }
 
-void UnityDisplayLock::ReleaseInternal() {
-    if (ref_count_ == 0)
+void UnityDisplayLock::SyncSleep() {
+    if (!connection_)
         return;
 
-    g_dbus_connection_call(connection_.get(),
-                           unity::screen::kBusName,
-                           unity::screen::kPath,
-                           unity::screen::kInterfaceName,
-                           "removeDisplayOnRequest",
-                           g_variant_new("(i)", cookie_),
-                          nullptr,
-                           G_DBUS_CALL_FLAGS_NONE,
-                           -1, // Make sure we wait for the service being started up
-                           nullptr,
-                           [](GObject *source, GAsyncResult *res, gpointer user_data) {
-
-        auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
-
-        GError *error = nullptr;
-        auto result = g_dbus_connection_call_finish(thiz->connection_.get(), res, &error);
-        if (!result) {
-            AC_ERROR("Failed to acquire display lock: %s", error->message);
-            g_error_free(error);
-            return;
-        }
-
-        thiz->cookie_ = 0;
-        thiz->ref_count_ = 0;
-
-        AC_DEBUG("Successfully unlocked display");
-
-    }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+    if (sleep_state_ == LegState::kLocking || sleep_state_ == LegState::kUnlocking)
+        return;
+
+    if (ref_count_ > 0 && sleep_state_ == LegState::kUnlocked) {
+        sleep_state_ = LegState::kLocking;
+
+        g_dbus_connection_call(connection_.get(),
+                               kPowerdBusName,
+                               kPowerdPath,
+                               kPowerdInterfaceName,
+                               "requestSysState",
+                               g_variant_new("(si)", kRequestorName, kPowerdStateActive),
+                               G_VARIANT_TYPE("(s)"),
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1, // Make sure we wait for the service being started up
+                               nullptr,
+                               [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+            auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
+
+            GError *error = nullptr;
+            auto result = g_dbus_connection_call_finish(thiz->connection_.get(), res, &error);
+            if (!result) {
+                AC_ERROR("Failed to acquire sleep inhibit: %s", error->message);
+                g_error_free(error);
+                thiz->sleep_state_ = LegState::kUnlocked;
+                return;
+            }
+
+            const gchar *cookie = nullptr;
+            g_variant_get(result, "(&s)", &cookie);
+            thiz->sleep_cookie_ = cookie ? cookie : "";
+            thiz->sleep_state_ = LegState::kLocked;
+
+            AC_DEBUG("Successfully inhibited suspend (cookie %s)", thiz->sleep_cookie_);
+
+            thiz->SyncSleep();
+
+        }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+
+        return;
+    }
+
+    if (ref_count_ == 0 && sleep_state_ == LegState::kLocked) {
+        sleep_state_ = LegState::kUnlocking;
+
+        g_dbus_connection_call(connection_.get(),
+                               kPowerdBusName,
+                               kPowerdPath,
+                               kPowerdInterfaceName,
+                               "clearSysState",
+                               g_variant_new("(s)", sleep_cookie_.c_str()),
+                               nullptr,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1, // Make sure we wait for the service being started up
+                               nullptr,
+                               [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+            auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
+
+            GError *error = nullptr;
+            auto result = g_dbus_connection_call_finish(thiz->connection_.get(), res, &error);
+            if (!result) {
+                AC_ERROR("Failed to release sleep inhibit: %s", error->message);
+                g_error_free(error);
+                // powerd still counts us as a holder; stay locked so a
+                // later acquire/release cycle retries the removal.
+                thiz->sleep_state_ = LegState::kLocked;
+                return;
+            }
+
+            thiz->sleep_cookie_.clear();
+            thiz->sleep_state_ = LegState::kUnlocked;
+
+            AC_DEBUG("Successfully released suspend inhibit");
+
+            thiz->SyncSleep();
+
+        }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+    }
 }
 
-void UnityDisplayLock::Release(DisplayState state) {
-    if (ref_count_ > 1) {
-        ref_count_--;
+void UnityDisplayLock::SyncScreenSaver() {
+    if (!session_connection_)
+        return;
+
+    if (screensaver_state_ == LegState::kLocking || screensaver_state_ == LegState::kUnlocking)
+        return;
+
+    if (ref_count_ > 0 && screensaver_state_ == LegState::kUnlocked) {
+        screensaver_state_ = LegState::kLocking;
+
+        g_dbus_connection_call(session_connection_.get(),
+                               kScreenSaverBusName,
+                               kScreenSaverPath,
+                               kScreenSaverInterfaceName,
+                               "Inhibit",
+                               g_variant_new("(ss)", kRequestorName, kInhibitReason),
+                               G_VARIANT_TYPE("(u)"),
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1, // Make sure we wait for the service being started up
+                               nullptr,
+                               [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+            auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
+
+            GError *error = nullptr;
+            auto result = g_dbus_connection_call_finish(thiz->session_connection_.get(), res, &error);
+            if (!result) {
+                AC_ERROR("Failed to inhibit screensaver: %s", error->message);
+                g_error_free(error);
+                thiz->screensaver_state_ = LegState::kUnlocked;
+                return;
+            }
+
+            thiz->screensaver_cookie_ = g_variant_get_uint32(g_variant_get_child_value(result, 0));
+            thiz->screensaver_state_ = LegState::kLocked;
+
+            AC_DEBUG("Successfully inhibited screensaver (cookie %u)", thiz->screensaver_cookie_);
+
+            thiz->SyncScreenSaver();
+
+        }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+
         return;
     }
 
-    ReleaseInternal();
+    if (ref_count_ == 0 && screensaver_state_ == LegState::kLocked) {
+        screensaver_state_ = LegState::kUnlocking;
+
+        g_dbus_connection_call(session_connection_.get(),
+                               kScreenSaverBusName,
+                               kScreenSaverPath,
+                               kScreenSaverInterfaceName,
+                               "UnInhibit",
+                               g_variant_new("(u)", screensaver_cookie_),
+                               nullptr,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1, // Make sure we wait for the service being started up
+                               nullptr,
+                               [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+            auto thiz = static_cast<ac::SharedKeepAlive<UnityDisplayLock>*>(user_data)->ShouldDie();
+
+            GError *error = nullptr;
+            auto result = g_dbus_connection_call_finish(thiz->session_connection_.get(), res, &error);
+            if (!result) {
+                AC_ERROR("Failed to release screensaver inhibit: %s", error->message);
+                g_error_free(error);
+                // The screensaver still counts us as a holder; stay
+                // locked so a later acquire/release cycle retries.
+                thiz->screensaver_state_ = LegState::kLocked;
+                return;
+            }
+
+            thiz->screensaver_cookie_ = 0;
+            thiz->screensaver_state_ = LegState::kUnlocked;
+
+            AC_DEBUG("Successfully released screensaver inhibit");
+
+            thiz->SyncScreenSaver();
+
+        }, new ac::SharedKeepAlive<UnityDisplayLock>{shared_from_this()});
+    }
 }
 
 } // namespace ubuntu
@@ -18,6 +18,8 @@
 #ifndef AC_UBUNTU_POWERDDISPLAYLOCK_H_
 #define AC_UBUNTU_POWERDDISPLAYLOCK_H_
 
+#include <string>
+
 #include "ac/glib_wrapper.h"
 
 #include "ac/scoped_gobject.h"
@@ -26,6 +28,13 @@
 namespace ac {
 namespace ubuntu {
 
+// One acquire covers everything a casting session needs from the
+// platform: the display stays on (Unity.Screen), the SoC stays awake
+// (powerd) and the lock screen stays out of the way (the freedesktop
+// screensaver inhibition). The three requests go out concurrently in
+// a single transaction rather than as serial round-trips, and the
+// cached per-leg state plus the release debounce keep redundant
+// acquire/release cycles off the bus entirely.
 class UnityDisplayLock : public SystemController::Lock<DisplayState>,
                          public std::enable_shared_from_this<UnityDisplayLock> {
 public:
@@ -39,14 +48,39 @@ public:
     void Release(DisplayState state);
 
 private:
+    // What the platform service believes right now for one leg of the
+    // transaction; transitions only ever happen from the main loop.
+    enum class LegState {
+        kUnlocked,
+        kLocking,
+        kLocked,
+        kUnlocking,
+    };
+
     UnityDisplayLock();
 
-    void ReleaseInternal();
+    // Issues at most one async D-Bus call per leg to move the actual
+    // platform state towards what ref_count_ asks for; completion
+    // callbacks call it again so overlapping acquire/release
+    // sequences coalesce into the minimum number of requests.
+    void Sync();
+    void SyncDisplay();
+    void SyncSleep();
+    void SyncScreenSaver();
 
 private:
     ac::ScopedGObject<GDBusConnection> connection_;
+    // The screensaver inhibition lives on the session bus; the other
+    // two legs talk to system services.
+    ac::ScopedGObject<GDBusConnection> session_connection_;
     unsigned int ref_count_;
-    int cookie_;
+    LegState display_state_;
+    LegState sleep_state_;
+    LegState screensaver_state_;
+    int display_cookie_;
+    std::string sleep_cookie_;
+    guint32 screensaver_cookie_;
+    guint release_timeout_;
 };
 
 } // namespace ubuntu
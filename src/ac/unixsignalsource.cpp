@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+
+#include <boost/concept_check.hpp>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include "ac/logger.h"
+
+#include "ac/unixsignalsource.h"
+
+namespace ac {
+
+UnixSignalSource::Ptr UnixSignalSource::Create(const std::vector<int> &signals,
+                                               const Handler &handler) {
+    auto sp = std::shared_ptr<UnixSignalSource>(new UnixSignalSource(handler));
+    if (!sp->Setup(signals))
+        return nullptr;
+    return sp;
+}
+
+UnixSignalSource::UnixSignalSource(const Handler &handler) :
+    handler_(handler),
+    fd_(-1),
+    watch_(0) {
+}
+
+UnixSignalSource::~UnixSignalSource() {
+    if (watch_ > 0)
+        g_source_remove(watch_);
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool UnixSignalSource::Setup(const std::vector<int> &signals) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (const auto signal : signals)
+        sigaddset(&mask, signal);
+
+    // Blocked process wide so every delivery ends up on the fd; the
+    // mask is inherited by all threads spawned afterwards.
+    if (::sigprocmask(SIG_BLOCK, &mask, nullptr) < 0) {
+        AC_ERROR("Failed to block signals: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    fd_ = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd_ < 0) {
+        AC_ERROR("Failed to create signalfd: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    watch_ = g_unix_fd_add(fd_, G_IO_IN, &UnixSignalSource::OnSignalReady, this);
+
+    return true;
+}
+
+gboolean UnixSignalSource::OnSignalReady(gint fd, GIOCondition condition, gpointer user_data) {
+    boost::ignore_unused_variable_warning(condition);
+
+    auto thiz = static_cast<UnixSignalSource*>(user_data);
+
+    // Drain everything pending; coalesced standard signals arrive as
+    // a single entry each, queued realtime signals one per delivery.
+    while (true) {
+        struct signalfd_siginfo info;
+        const auto bytes_read = ::read(fd, &info, sizeof(info));
+        if (bytes_read != sizeof(info))
+            break;
+
+        thiz->handler_(info.ssi_signo);
+    }
+
+    return TRUE;
+}
+
+void UnixSignalSource::RestoreDefaultAndRaise(int signal) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, signal);
+
+    ::signal(signal, SIG_DFL);
+    ::sigprocmask(SIG_UNBLOCK, &mask, nullptr);
+    ::raise(signal);
+}
+
+} // namespace ac
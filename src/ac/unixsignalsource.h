@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_UNIXSIGNALSOURCE_H_
+#define AC_UNIXSIGNALSOURCE_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "ac/glib_wrapper.h"
+#include "ac/non_copyable.h"
+
+namespace ac {
+
+/**
+ * @brief Delivers Unix signals through a single signalfd GSource.
+ *
+ * All handled signals are blocked process wide and read from one
+ * signalfd on the main loop instead of installing per-signal handlers
+ * with a self-pipe. The handler therefore runs in ordinary main loop
+ * context without any async-signal-safety constraints, every delivery
+ * costs one wakeup instead of two, and signals can never race a
+ * shutdown already in progress on the loop.
+ *
+ * Construct before spawning any threads so they inherit the blocked
+ * mask; a signal landing on a pipeline thread would otherwise bypass
+ * the fd.
+ */
+class UnixSignalSource : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<UnixSignalSource> Ptr;
+    typedef std::function<void(int)> Handler;
+
+    static Ptr Create(const std::vector<int> &signals, const Handler &handler);
+
+    ~UnixSignalSource();
+
+    // Restores the signal's default disposition and re-raises it;
+    // lets a repeated SIGTERM terminate the process immediately while
+    // a graceful shutdown is still draining.
+    static void RestoreDefaultAndRaise(int signal);
+
+private:
+    UnixSignalSource(const Handler &handler);
+
+    bool Setup(const std::vector<int> &signals);
+
+    static gboolean OnSignalReady(gint fd, GIOCondition condition, gpointer user_data);
+
+private:
+    Handler handler_;
+    int fd_;
+    guint watch_;
+};
+
+} // namespace ac
+
+#endif
@@ -27,8 +27,43 @@
 #include <cstdarg>
 #include <cstdio>
 
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
 #include "utils.h"
 
+namespace {
+static constexpr uint32_t kCrcMpeg2Polynomial{0x04C11DB7};
+
+#if !defined(__ARM_FEATURE_CRC32)
+// Slice-by-8 tables for the MSB-first MPEG-2 CRC32; table n advances
+// a byte followed by n zero bytes so eight input bytes fold into one
+// table lookup each instead of eight dependent single-byte steps.
+struct CrcMpeg2Tables {
+    CrcMpeg2Tables() {
+        for (unsigned int i = 0; i < 256; i++) {
+            uint32_t crc = i << 24;
+            for (unsigned int j = 0; j < 8; j++)
+                crc = (crc << 1) ^ ((crc & 0x80000000) ? kCrcMpeg2Polynomial : 0);
+            entries[0][i] = crc;
+        }
+
+        for (unsigned int n = 1; n < 8; n++)
+            for (unsigned int i = 0; i < 256; i++)
+                entries[n][i] = (entries[n - 1][i] << 8)
+                        ^ entries[0][entries[n - 1][i] >> 24];
+    }
+
+    uint32_t entries[8][256];
+};
+#endif
+}
+
 namespace ac {
 bool Utils::StringStartsWith(const std::string &text, const std::string &prefix) {
     return text.compare(0, prefix.size(), prefix) == 0;
@@ -68,6 +103,29 @@ bool Utils::CreateFile(const std::string &file_path) {
     return true;
 }
 
+std::string Utils::ReadFileContents(const std::string &file_path) {
+    std::ifstream file(file_path);
+    if (!file)
+        return "";
+
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+bool Utils::WriteFileContents(const std::string &file_path, const std::string &content) {
+    boost::filesystem::path p(file_path);
+    if (p.has_parent_path() && !boost::filesystem::is_directory(p.parent_path()))
+        boost::filesystem::create_directories(p.parent_path());
+
+    std::ofstream file(file_path, std::ofstream::trunc);
+    if (!file)
+        return false;
+
+    file << content;
+    return true;
+}
+
 bool Utils::RemoveFile(const std::string &file_path) {
     boost::filesystem::path p(file_path);
     if (!boost::filesystem::exists(p))
@@ -77,6 +135,61 @@ bool Utils::RemoveFile(const std::string &file_path) {
     return true;
 }
 
+uint32_t Utils::CrcMpeg2(const uint8_t *data, size_t size) {
+#if defined(__ARM_FEATURE_CRC32)
+    // The CRC32 instructions implement the bit-reflected variant of
+    // the polynomial, so the MSB-first MPEG-2 CRC falls out of them by
+    // bit-reversing the state and every input byte. RBIT+REV reverse
+    // the bits within each byte of a whole register at once.
+    uint32_t state = 0xffffffff;
+
+    while (size >= 8) {
+        uint64_t chunk;
+        ::memcpy(&chunk, data, sizeof(chunk));
+        state = __crc32d(state, __builtin_bswap64(__rbitll(chunk)));
+        data += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        state = __crc32b(state, __rbit(*data) >> 24);
+        data++;
+        size--;
+    }
+
+    return __rbit(state);
+#else
+    static const CrcMpeg2Tables tables;
+
+    uint32_t crc = 0xffffffff;
+
+    while (size >= 8) {
+        const uint32_t head = crc
+                ^ (data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3]);
+
+        crc = tables.entries[7][head >> 24]
+            ^ tables.entries[6][(head >> 16) & 0xff]
+            ^ tables.entries[5][(head >> 8) & 0xff]
+            ^ tables.entries[4][head & 0xff]
+            ^ tables.entries[3][data[4]]
+            ^ tables.entries[2][data[5]]
+            ^ tables.entries[1][data[6]]
+            ^ tables.entries[0][data[7]];
+
+        data += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc = (crc << 8) ^ tables.entries[0][((crc >> 24) ^ *data) & 0xff];
+        data++;
+        size--;
+    }
+
+    return crc;
+#endif
+}
+
 uint64_t Utils::GetNowNs() {
    struct timespec ts;
    memset(&ts, 0, sizeof(ts));
@@ -130,4 +243,10 @@ void Utils::SetThreadName(const std::string &name) {
     pthread_setname_np(pthread_self(), name.c_str());
 }
 
+void Utils::TrimMemory() {
+#if defined(__GLIBC__)
+    ::malloc_trim(0);
+#endif
+}
+
 } // namespace ac
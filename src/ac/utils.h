@@ -28,6 +28,9 @@
 namespace ac {
 typedef int64_t TimestampNs;
 typedef int64_t TimestampUs;
+// Session-unique id a captured frame keeps while it travels through
+// encoding and packetization; 0 marks "not assigned".
+typedef uint64_t FrameId;
 struct Utils
 {
     // Merely used as a namespace.
@@ -48,6 +51,12 @@ struct Utils
     static bool CreateFile(const std::string &file_path);
     // RemoveFile - remove a file at the specified path
     static bool RemoveFile(const std::string &file_path);
+    // ReadFileContents - read the whole file at the specified path; an
+    // unreadable or missing file yields an empty string
+    static std::string ReadFileContents(const std::string &file_path);
+    // WriteFileContents - replace the file at the specified path with
+    // the given content, creating missing parent directories
+    static bool WriteFileContents(const std::string &file_path, const std::string &content);
     // IsEnvSet - check if an environment variable is set or not
     static bool IsEnvSet(const std::string &name);
     // GetNowNs - get a timestamp in nanoseconds
@@ -56,8 +65,17 @@ struct Utils
     static uint64_t GetNowUs();
     // Hexdump - dump a byte array as string
     static std::string Hexdump(const uint8_t *data, uint32_t size);
+    // CrcMpeg2 - CRC32 as used for MPEG-2 PSI sections (polynomial
+    // 0x04C11DB7, MSB first, initial value 0xffffffff, no final xor).
+    // Uses the ARMv8 CRC32 instructions when the target supports them
+    // and a slice-by-8 table implementation otherwise.
+    static uint32_t CrcMpeg2(const uint8_t *data, size_t size);
     // SetThreadName - set the name thread this is running in
     static void SetThreadName(const std::string &name);
+    // TrimMemory - hand heap pages freed by a torn down session back
+    // to the kernel; the allocator otherwise keeps them cached and the
+    // resident set stays at session peak between casts
+    static void TrimMemory();
 
     // CreateUniquePtrWithDeleter - create a std::unique_ptr with a custom deleter
     template <typename Owned, typename Deleter>
@@ -0,0 +1,706 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+
+#include <chrono>
+
+#include "ac/config.h"
+#include "ac/encodercapabilitycache.h"
+#include "ac/logger.h"
+#include "ac/report/dispatch.h"
+
+#include "ac/v4l2/h264encoder.h"
+
+namespace {
+static constexpr const char *kEncoderThreadName{"V4L2H264Encoder"};
+// Supplying -1 as framerate means the encoder decides on which framerate
+// it provides.
+static constexpr int32_t kAnyFramerate = 30;
+// Default is a bitrate of 5 MBit/s
+static constexpr int32_t kDefaultBitrate = 5000000;
+// By default send an I frame every 15 seconds which is the
+// same Android currently configures in its WiFi Display code path.
+static constexpr std::chrono::seconds kDefaultIFrameInterval{15};
+// Device nodes to probe for a capable memory-to-memory encoder
+static constexpr unsigned int kMaxDeviceNodes{16};
+// The node found by the last successful probe is remembered in the
+// encoder capability cache so neither a reconnect nor a daemon
+// restart has to scan again
+static constexpr const char *kDeviceCacheKey{"v4l2-encoder-device"};
+// Queue depths; raw side matches the renderer's low-latency slot
+// count, the coded side gives the drain loop a bit of slack.
+static constexpr unsigned int kNumRawBuffers{2};
+static constexpr unsigned int kNumCodedBuffers{4};
+// An encoder not producing a frame within this window is stuck
+static constexpr int kPollTimeoutMs{2000};
+// Damage-steered quantization: a change counts as small when it covers
+// at most an eighth of the frame. Once small changes persisted for a
+// window of frames the QP ceiling drops to the sharp value; any larger
+// change lifts it back to the H.264 maximum immediately so the rate
+// control can hit the budget again.
+static constexpr unsigned int kSmallDamageShareDivisor{8};
+static constexpr uint32_t kSmallDamageWindowFrames{30};
+static constexpr int32_t kSharpMaxQP{30};
+static constexpr int32_t kDefaultMaxQP{51};
+
+bool BufferStartsWithParameterSets(const uint8_t *data, size_t size) {
+    if (size < 5)
+        return false;
+
+    if (data[0] != 0x00 || data[1] != 0x00)
+        return false;
+
+    // Both three and four byte start codes are seen in the wild
+    size_t offset = 2;
+    if (data[offset] == 0x00)
+        offset++;
+
+    if (data[offset] != 0x01)
+        return false;
+
+    return (data[offset + 1] & 0x1f) == 7;
+}
+}
+
+namespace ac {
+namespace v4l2 {
+
+video::BaseEncoder::Config H264Encoder::DefaultConfiguration() {
+    Config config;
+    config.framerate = kAnyFramerate;
+    config.bitrate = kDefaultBitrate;
+    config.i_frame_interval = kDefaultIFrameInterval.count();
+    return config;
+}
+
+video::BaseEncoder::Ptr H264Encoder::Create(const video::EncoderReport::Ptr &report) {
+    return std::shared_ptr<H264Encoder>(new H264Encoder(report));
+}
+
+H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report) :
+    report_(report),
+    running_(false),
+    fd_(-1),
+    input_queue_(ac::video::BufferQueue::CreateSPSC()),
+    damage_qp_active_(false),
+    small_damage_frames_(0) {
+}
+
+H264Encoder::~H264Encoder() {
+    Stop();
+
+    ReleaseQueues();
+
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+int H264Encoder::TryOpenDevice(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0)
+        return -1;
+
+    struct v4l2_capability cap;
+    ::memset(&cap, 0, sizeof(cap));
+    if (::ioctl(fd, VIDIOC_QUERYCAP, &cap) < 0 ||
+        !(cap.capabilities & V4L2_CAP_VIDEO_M2M_MPLANE)) {
+        ::close(fd);
+        return -1;
+    }
+
+    // Only a device which can hand out H.264 on its capture side
+    // is of any use for us
+    bool have_h264 = false;
+    for (unsigned int i = 0; ; i++) {
+        struct v4l2_fmtdesc desc;
+        ::memset(&desc, 0, sizeof(desc));
+        desc.index = i;
+        desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        if (::ioctl(fd, VIDIOC_ENUM_FMT, &desc) < 0)
+            break;
+        if (desc.pixelformat == V4L2_PIX_FMT_H264) {
+            have_h264 = true;
+            break;
+        }
+    }
+
+    if (!have_h264) {
+        ::close(fd);
+        return -1;
+    }
+
+    AC_DEBUG("Using V4L2 encoder device %s (%s)", path.c_str(), cap.card);
+
+    return fd;
+}
+
+bool H264Encoder::OpenDevice() {
+    // A node which worked once will almost always work again, so the
+    // probe result is kept in the capability cache and tried first
+    // which spares us scanning all device nodes on every connection
+    // and daemon run.
+    const auto cached_path = EncoderCapabilityCache::Instance().Lookup(kDeviceCacheKey);
+    if (cached_path.length() > 0) {
+        const int fd = TryOpenDevice(cached_path);
+        if (fd >= 0) {
+            fd_ = fd;
+            return true;
+        }
+    }
+
+    for (unsigned int n = 0; n < kMaxDeviceNodes; n++) {
+        const auto path = Utils::Sprintf("/dev/video%d", n);
+
+        const int fd = TryOpenDevice(path);
+        if (fd < 0)
+            continue;
+
+        EncoderCapabilityCache::Instance().Store(kDeviceCacheKey, path);
+
+        fd_ = fd;
+        return true;
+    }
+
+    AC_ERROR("Failed to find a V4L2 H.264 encoder device");
+    return false;
+}
+
+bool H264Encoder::SetControl(uint32_t id, int32_t value, bool required) {
+    struct v4l2_control ctrl;
+    ::memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.id = id;
+    ctrl.value = value;
+
+    if (::ioctl(fd_, VIDIOC_S_CTRL, &ctrl) < 0) {
+        if (required)
+            AC_ERROR("Failed to set control %u to %d: %s", id, value, strerror(errno));
+        else
+            AC_WARNING("Encoder does not support control %u; continuing without", id);
+        return false;
+    }
+
+    return true;
+}
+
+bool H264Encoder::Configure(const Config &config) {
+    if (fd_ >= 0)
+        return false;
+
+    AC_DEBUG("configuring with %dx%d@%d", config.width, config.height, config.framerate);
+
+    if (!OpenDevice())
+        return false;
+
+    // Raw side: the screencast hands us XBGR frames
+    struct v4l2_format fmt;
+    ::memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    fmt.fmt.pix_mp.width = config.width;
+    fmt.fmt.pix_mp.height = config.height;
+    fmt.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_XBGR32;
+    fmt.fmt.pix_mp.num_planes = 1;
+
+    if (::ioctl(fd_, VIDIOC_S_FMT, &fmt) < 0 ||
+        fmt.fmt.pix_mp.pixelformat != V4L2_PIX_FMT_XBGR32) {
+        AC_ERROR("Encoder does not accept XBGR input frames");
+        return false;
+    }
+
+    // Coded side: H.264 elementary stream
+    ::memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    fmt.fmt.pix_mp.width = config.width;
+    fmt.fmt.pix_mp.height = config.height;
+    fmt.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_H264;
+    fmt.fmt.pix_mp.num_planes = 1;
+    fmt.fmt.pix_mp.plane_fmt[0].sizeimage = config.width * config.height * 2;
+
+    if (::ioctl(fd_, VIDIOC_S_FMT, &fmt) < 0) {
+        AC_ERROR("Failed to configure encoder output format: %s", strerror(errno));
+        return false;
+    }
+
+    struct v4l2_streamparm parm;
+    ::memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    parm.parm.output.timeperframe.numerator = 1;
+    parm.parm.output.timeperframe.denominator = config.framerate;
+    if (::ioctl(fd_, VIDIOC_S_PARM, &parm) < 0)
+        AC_WARNING("Encoder does not take a framerate hint; continuing without");
+
+    if (!SetControl(V4L2_CID_MPEG_VIDEO_BITRATE, config.bitrate, true))
+        return false;
+
+    // Everything below improves the stream but no driver is required
+    // to offer it, so missing support only gets logged
+    SetControl(V4L2_CID_MPEG_VIDEO_BITRATE_MODE,
+               V4L2_MPEG_VIDEO_BITRATE_MODE_CBR, false);
+    SetControl(V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, 1, false);
+
+    if (config.slices > 1) {
+        // Multi-slice frames let encoder and sink decoder spread one
+        // frame over several cores; expressed as macroblocks per slice
+        const int32_t total_mbs = ((config.width + 15) / 16)
+                * ((config.height + 15) / 16);
+        SetControl(V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MODE,
+                   V4L2_MPEG_VIDEO_MULTI_SICE_MODE_MAX_MB, false);
+        SetControl(V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_MB,
+                   (total_mbs + config.slices - 1) / config.slices, false);
+    }
+
+    if (config.intra_refresh_frames > 0) {
+        // Spread a full intra refresh over the requested number of
+        // frames instead of paying for periodic IDR bursts; the GOP
+        // size control stays untouched so no IDR cadence kicks in.
+        const int32_t total_mbs = ((config.width + 15) / 16)
+                * ((config.height + 15) / 16);
+        SetControl(V4L2_CID_MPEG_VIDEO_CYCLIC_INTRA_REFRESH_MB,
+                   (total_mbs + config.intra_refresh_frames - 1)
+                       / config.intra_refresh_frames, false);
+    } else if (config.i_frame_interval > 0 && config.framerate > 0) {
+        SetControl(V4L2_CID_MPEG_VIDEO_GOP_SIZE,
+                   config.i_frame_interval * config.framerate, false);
+    }
+
+    if (!SetupQueues())
+        return false;
+
+    config_ = config;
+    damage_qp_active_ = false;
+    small_damage_frames_ = 0;
+
+    AC_DEBUG("Configured encoder succesfully");
+
+    return true;
+}
+
+bool H264Encoder::SetupQueues() {
+    struct v4l2_requestbuffers reqbufs;
+
+    const auto map_queue = [&](enum v4l2_buf_type type, unsigned int count,
+                               std::vector<MappedBuffer> &buffers) {
+        ::memset(&reqbufs, 0, sizeof(reqbufs));
+        reqbufs.type = type;
+        reqbufs.memory = V4L2_MEMORY_MMAP;
+        reqbufs.count = count;
+
+        if (::ioctl(fd_, VIDIOC_REQBUFS, &reqbufs) < 0 || reqbufs.count == 0) {
+            AC_ERROR("Failed to request encoder buffers: %s", strerror(errno));
+            return false;
+        }
+
+        for (unsigned int n = 0; n < reqbufs.count; n++) {
+            struct v4l2_buffer buf;
+            struct v4l2_plane plane;
+            ::memset(&buf, 0, sizeof(buf));
+            ::memset(&plane, 0, sizeof(plane));
+            buf.type = type;
+            buf.memory = V4L2_MEMORY_MMAP;
+            buf.index = n;
+            buf.m.planes = &plane;
+            buf.length = 1;
+
+            if (::ioctl(fd_, VIDIOC_QUERYBUF, &buf) < 0) {
+                AC_ERROR("Failed to query encoder buffer %u: %s", n, strerror(errno));
+                return false;
+            }
+
+            const auto data = ::mmap(nullptr, plane.length, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED, fd_, plane.m.mem_offset);
+            if (data == MAP_FAILED) {
+                AC_ERROR("Failed to map encoder buffer %u: %s", n, strerror(errno));
+                return false;
+            }
+
+            buffers.push_back(MappedBuffer{data, plane.length, false});
+        }
+
+        return true;
+    };
+
+    if (!map_queue(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, kNumRawBuffers, raw_buffers_))
+        return false;
+
+    if (!map_queue(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, kNumCodedBuffers, coded_buffers_))
+        return false;
+
+    // The coded buffers all start out with the driver so it always has
+    // somewhere to put the next encoded frame
+    for (unsigned int n = 0; n < coded_buffers_.size(); n++) {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        ::memset(&buf, 0, sizeof(buf));
+        ::memset(&plane, 0, sizeof(plane));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = n;
+        buf.m.planes = &plane;
+        buf.length = 1;
+
+        if (::ioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
+            AC_ERROR("Failed to queue encoder buffer %u: %s", n, strerror(errno));
+            return false;
+        }
+
+        coded_buffers_[n].queued = true;
+    }
+
+    return true;
+}
+
+void H264Encoder::ReleaseQueues() {
+    for (const auto &buffer : raw_buffers_)
+        ::munmap(buffer.data, buffer.length);
+    raw_buffers_.clear();
+
+    for (const auto &buffer : coded_buffers_)
+        ::munmap(buffer.data, buffer.length);
+    coded_buffers_.clear();
+}
+
+bool H264Encoder::Start() {
+    if (fd_ < 0 || running_)
+        return false;
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    if (::ioctl(fd_, VIDIOC_STREAMON, &type) < 0) {
+        AC_ERROR("Failed to start encoder input queue: %s", strerror(errno));
+        return false;
+    }
+
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    if (::ioctl(fd_, VIDIOC_STREAMON, &type) < 0) {
+        AC_ERROR("Failed to start encoder output queue: %s", strerror(errno));
+        return false;
+    }
+
+    running_ = true;
+
+    report_->Started();
+
+    return true;
+}
+
+bool H264Encoder::Stop() {
+    if (fd_ < 0 || !running_)
+        return false;
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    ::ioctl(fd_, VIDIOC_STREAMOFF, &type);
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    ::ioctl(fd_, VIDIOC_STREAMOFF, &type);
+
+    // STREAMOFF discarded everything the driver still held
+    pending_frame_ids_.clear();
+
+    running_ = false;
+
+    report_->Stopped();
+
+    return true;
+}
+
+void H264Encoder::QueueBuffer(const video::Buffer::Ptr &buffer) {
+    if (!running_)
+        return;
+
+    if (ConsumeIDRRequest())
+        SendIDRFrame();
+
+    input_queue_->Push(buffer);
+
+    AC_REPORT(report_->ReceivedInputBuffer(buffer->Timestamp()));
+}
+
+bool H264Encoder::DequeueRawBuffer() {
+    struct v4l2_buffer buf;
+    struct v4l2_plane plane;
+    ::memset(&buf, 0, sizeof(buf));
+    ::memset(&plane, 0, sizeof(plane));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.m.planes = &plane;
+    buf.length = 1;
+
+    if (::ioctl(fd_, VIDIOC_DQBUF, &buf) < 0)
+        return false;
+
+    raw_buffers_[buf.index].queued = false;
+    return true;
+}
+
+bool H264Encoder::FeedInputBuffer(const video::Buffer::Ptr &input_buffer) {
+    // Reclaim raw buffers the driver is done reading from
+    while (DequeueRawBuffer());
+
+    int index = -1;
+    for (unsigned int n = 0; n < raw_buffers_.size(); n++) {
+        if (!raw_buffers_[n].queued) {
+            index = n;
+            break;
+        }
+    }
+
+    if (index < 0) {
+        // The driver still owns all raw buffers; dropping the frame
+        // here is better than stalling the whole pipeline
+        AC_WARNING("No free encoder input buffer; dropping frame");
+        return true;
+    }
+
+    const auto size = std::min<size_t>(input_buffer->Length(),
+                                       raw_buffers_[index].length);
+    ::memcpy(raw_buffers_[index].data, input_buffer->Data(), size);
+
+    struct v4l2_buffer buf;
+    struct v4l2_plane plane;
+    ::memset(&buf, 0, sizeof(buf));
+    ::memset(&plane, 0, sizeof(plane));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    buf.m.planes = &plane;
+    buf.length = 1;
+    plane.bytesused = size;
+    buf.timestamp.tv_sec = input_buffer->Timestamp() / 1000000ll;
+    buf.timestamp.tv_usec = input_buffer->Timestamp() % 1000000ll;
+
+    if (::ioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
+        AC_ERROR("Failed to queue frame into encoder: %s", strerror(errno));
+        return false;
+    }
+
+    raw_buffers_[index].queued = true;
+    pending_frame_ids_.push_back(input_buffer->FrameId());
+    return true;
+}
+
+bool H264Encoder::DequeueCodedBuffer() {
+    // Drain every frame the driver has ready in one pass; the whole
+    // run then travels to the delegate with a single wakeup instead
+    // of one lock/notify round-trip per buffer
+    std::vector<video::Buffer::Ptr> output_buffers;
+
+    while (true) {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        ::memset(&buf, 0, sizeof(buf));
+        ::memset(&plane, 0, sizeof(plane));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.m.planes = &plane;
+        buf.length = 1;
+
+        if (::ioctl(fd_, VIDIOC_DQBUF, &buf) < 0) {
+            if (errno == EAGAIN)
+                break;
+            AC_ERROR("Failed to read encoded frame: %s", strerror(errno));
+            return false;
+        }
+
+        const auto &coded = coded_buffers_[buf.index];
+
+        auto output_buffer = video::Buffer::Create(plane.bytesused);
+        ::memcpy(output_buffer->Data(), coded.data, plane.bytesused);
+        output_buffer->SetTimestamp(buf.timestamp.tv_sec * 1000000ll +
+                                    buf.timestamp.tv_usec);
+
+        if (!pending_frame_ids_.empty()) {
+            output_buffer->SetFrameId(pending_frame_ids_.front());
+            pending_frame_ids_.pop_front();
+        }
+
+        AC_REPORT(report_->FinishedFrame(output_buffer->Timestamp(), output_buffer->FrameId()));
+
+        if (auto sp = delegate_.lock()) {
+            // With REPEAT_SEQ_HEADER set the parameter sets arrive glued
+            // to the front of the IDR frame they belong to
+            if (BufferStartsWithParameterSets(output_buffer->Data(), output_buffer->Length()))
+                sp->OnBufferWithCodecConfig(output_buffer);
+        }
+
+        output_buffers.push_back(output_buffer);
+
+        // Give the coded buffer straight back so the driver never runs dry
+        plane.bytesused = 0;
+        if (::ioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
+            AC_ERROR("Failed to requeue encoder buffer: %s", strerror(errno));
+            return false;
+        }
+    }
+
+    if (output_buffers.empty())
+        return true;
+
+    if (auto sp = delegate_.lock())
+        sp->OnBuffersAvailable(output_buffers);
+
+    return true;
+}
+
+bool H264Encoder::Execute() {
+    if (!running_) {
+        AC_ERROR("Tried to execute encoder while not started");
+        return false;
+    }
+
+    const auto input_buffer = input_queue_->Next();
+    if (!input_buffer)
+        return true;
+
+    AC_REPORT(report_->BeganFrame(input_buffer->Timestamp()));
+
+    if (!FeedInputBuffer(input_buffer))
+        return false;
+
+    struct pollfd fds;
+    fds.fd = fd_;
+    fds.events = POLLIN;
+    fds.revents = 0;
+
+    const int ret = ::poll(&fds, 1, kPollTimeoutMs);
+    if (ret < 0) {
+        AC_ERROR("Failed to wait for encoder: %s", strerror(errno));
+        return false;
+    }
+
+    // The encoder simply needs more input before it can produce the
+    // next frame; not an error
+    if (ret == 0)
+        return true;
+
+    return DequeueCodedBuffer();
+}
+
+video::BaseEncoder::Config H264Encoder::Configuration() const {
+    return config_;
+}
+
+void H264Encoder::SendIDRFrame() {
+    if (fd_ < 0)
+        return;
+
+    SetControl(V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 1, false);
+}
+
+bool H264Encoder::Reconfigure(const Config &config) {
+    if (fd_ < 0)
+        return Configure(config);
+
+    AC_DEBUG("reconfiguring with %dx%d@%d", config.width, config.height, config.framerate);
+
+    // A stateful m2m device does not allow changing the frame size on
+    // the fly, so give the device back and set it up from scratch;
+    // everything around the encoder stays wired up.
+    Stop();
+
+    ReleaseQueues();
+
+    ::close(fd_);
+    fd_ = -1;
+
+    // Frames captured at the old resolution are useless now
+    input_queue_->PopAll();
+
+    return Configure(config);
+}
+
+bool H264Encoder::SetTargetBitrate(unsigned int bitrate) {
+    if (fd_ < 0)
+        return false;
+
+    if (!SetControl(V4L2_CID_MPEG_VIDEO_BITRATE, bitrate, true))
+        return false;
+
+    config_.bitrate = bitrate;
+
+    AC_DEBUG("Changed encoder target bitrate to %d bit/s", bitrate);
+
+    return true;
+}
+
+bool H264Encoder::SetDamageHint(const video::Rect &region) {
+    if (fd_ < 0)
+        return false;
+
+    // The UAPI offers no per-region quantization map, so the hint
+    // steers the global QP ceiling instead: while changes stay small
+    // the budget trivially covers them and capping the QP low makes
+    // text and cursor updates come out sharp; an empty region means
+    // the extent is unknown and counts as whole-frame.
+    const auto frame_area = config_.width * config_.height;
+    const bool small = !region.Empty() &&
+            region.Area() * kSmallDamageShareDivisor <= frame_area;
+
+    if (!small) {
+        small_damage_frames_ = 0;
+        if (damage_qp_active_) {
+            damage_qp_active_ = false;
+            SetControl(V4L2_CID_MPEG_VIDEO_H264_MAX_QP, kDefaultMaxQP, false);
+        }
+        return true;
+    }
+
+    if (damage_qp_active_ || ++small_damage_frames_ < kSmallDamageWindowFrames)
+        return true;
+
+    // Only flips after a whole window of confined changes so scrolling
+    // with short pauses doesn't make the ceiling oscillate
+    damage_qp_active_ = true;
+    SetControl(V4L2_CID_MPEG_VIDEO_H264_MAX_QP, kSharpMaxQP, false);
+
+    return true;
+}
+
+bool H264Encoder::SetTargetFramerate(int framerate) {
+    if (fd_ < 0 || framerate <= 0)
+        return false;
+
+    struct v4l2_streamparm parm;
+    ::memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    parm.parm.output.timeperframe.numerator = 1;
+    parm.parm.output.timeperframe.denominator = framerate;
+
+    if (::ioctl(fd_, VIDIOC_S_PARM, &parm) < 0) {
+        AC_WARNING("Encoder does not allow changing the framerate");
+        return false;
+    }
+
+    config_.framerate = framerate;
+
+    AC_DEBUG("Changed encoder target framerate to %d fps", framerate);
+
+    return true;
+}
+
+std::string H264Encoder::Name() const {
+    return kEncoderThreadName;
+}
+
+} // namespace v4l2
+} // namespace ac
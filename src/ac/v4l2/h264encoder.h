@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_V4L2_ENCODER_H_
+#define AC_V4L2_ENCODER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/common/executable.h"
+
+#include "ac/video/baseencoder.h"
+#include "ac/video/encoderreport.h"
+#include "ac/video/bufferqueue.h"
+
+namespace ac {
+namespace v4l2 {
+
+// H.264 encoder talking to a V4L2 stateful memory-to-memory device
+// (/dev/video*) directly, without any framework in between. Raw frames
+// go in on the OUTPUT queue, encoded bitstream comes back on the
+// CAPTURE queue; both are driven from Execute() via poll.
+class H264Encoder : public video::BaseEncoder {
+public:
+    typedef std::shared_ptr<H264Encoder> Ptr;
+
+    static BaseEncoder::Ptr Create(const video::EncoderReport::Ptr &report);
+
+    ~H264Encoder();
+
+    BaseEncoder::Config DefaultConfiguration() override;
+
+    bool Configure(const BaseEncoder::Config &config) override;
+
+    void QueueBuffer(const ac::video::Buffer::Ptr &buffer) override;
+
+    bool Running() const override { return running_; }
+    BaseEncoder::Config Configuration() const override;
+
+    void SendIDRFrame() override;
+
+    bool Reconfigure(const BaseEncoder::Config &config) override;
+
+    bool SetTargetBitrate(unsigned int bitrate) override;
+    bool SetTargetFramerate(int framerate) override;
+    bool SetDamageHint(const video::Rect &region) override;
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+    // Execute() blocks on the input queue and the device until the
+    // next encoded frame and cannot share an executor loop
+    bool PrefersDedicatedThread() const override { return true; }
+
+private:
+    struct MappedBuffer {
+        void *data;
+        size_t length;
+        bool queued;
+    };
+
+    H264Encoder(const video::EncoderReport::Ptr &report);
+
+    int TryOpenDevice(const std::string &path);
+    bool OpenDevice();
+    bool SetupQueues();
+    void ReleaseQueues();
+
+    bool FeedInputBuffer(const ac::video::Buffer::Ptr &input_buffer);
+    bool DequeueRawBuffer();
+    bool DequeueCodedBuffer();
+
+    bool SetControl(uint32_t id, int32_t value, bool required);
+
+private:
+    video::EncoderReport::Ptr report_;
+    BaseEncoder::Config config_;
+    bool running_;
+    int fd_;
+    // Raw frames travel through V4L2's OUTPUT queue, the encoded
+    // bitstream through its CAPTURE queue
+    std::vector<MappedBuffer> raw_buffers_;
+    std::vector<MappedBuffer> coded_buffers_;
+    ac::video::BufferQueue::Ptr input_queue_;
+    // Frame ids of buffers the driver currently holds; the encoder
+    // emits frames in submission order so coded buffers pick their id
+    // up from the front.
+    std::deque<ac::FrameId> pending_frame_ids_;
+    // Damage-steered quantization: while changes stay confined to a
+    // small region the QP ceiling gets pulled down so text and cursor
+    // updates come out sharp; large-area motion lifts it again.
+    bool damage_qp_active_;
+    uint32_t small_damage_frames_;
+};
+
+} // namespace v4l2
+} // namespace ac
+
+#endif
@@ -0,0 +1,792 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <va/va_drm.h>
+
+#include <chrono>
+
+#include "ac/config.h"
+#include "ac/encodercapabilitycache.h"
+#include "ac/logger.h"
+#include "ac/report/dispatch.h"
+
+#include "ac/vaapi/h264encoder.h"
+
+namespace {
+static constexpr const char *kEncoderThreadName{"VAAPIH264Encoder"};
+// Supplying -1 as framerate means the encoder decides on which framerate
+// it provides.
+static constexpr int32_t kAnyFramerate = 30;
+// Default is a bitrate of 5 MBit/s
+static constexpr int32_t kDefaultBitrate = 5000000;
+// By default send an I frame every 15 seconds which is the
+// same Android currently configures in its WiFi Display code path.
+static constexpr std::chrono::seconds kDefaultIFrameInterval{15};
+// Render nodes to probe for a VAAPI capable GPU
+static constexpr unsigned int kMaxRenderNodes{8};
+static constexpr const char *kRenderNodePathTemplate{"/dev/dri/renderD%d"};
+static constexpr unsigned int kFirstRenderNodeMinor{128};
+// The node found by the last successful probe is remembered in the
+// encoder capability cache so a restart doesn't have to scan again
+static constexpr const char *kRenderNodeCacheKey{"vaapi-render-node"};
+static constexpr uint32_t kMacroBlockSize{16};
+static constexpr uint8_t kDefaultQP{26};
+
+// Minimal RBSP writer used to produce the packed SPS/PPS headers the
+// driver muxes into the coded stream.
+class BitWriter {
+public:
+    void PutBits(uint32_t value, unsigned int count) {
+        for (int n = count - 1; n >= 0; n--) {
+            const unsigned int byte = bit_count_ >> 3;
+            if (byte >= data_.size())
+                data_.push_back(0);
+            if ((value >> n) & 1)
+                data_[byte] |= 0x80 >> (bit_count_ & 7);
+            bit_count_++;
+        }
+    }
+
+    void PutUE(uint32_t value) {
+        unsigned int length = 0;
+        uint32_t v = value + 1;
+        while (v >> (length + 1))
+            length++;
+        PutBits(0, length);
+        PutBits(value + 1, length + 1);
+    }
+
+    void PutSE(int32_t value) {
+        PutUE(value <= 0 ? -2 * value : 2 * value - 1);
+    }
+
+    void WriteTrailingBits() {
+        PutBits(1, 1);
+        while (bit_count_ & 7)
+            PutBits(0, 1);
+    }
+
+    // Returns the RBSP with a NAL header and emulation prevention
+    // bytes applied, ready to be sent as a packed header.
+    std::vector<uint8_t> Finish(uint8_t nal_ref_idc, uint8_t nal_unit_type) const {
+        std::vector<uint8_t> nal{0x00, 0x00, 0x00, 0x01};
+        nal.push_back((nal_ref_idc << 5) | nal_unit_type);
+
+        unsigned int zeros = 0;
+        for (const auto byte : data_) {
+            if (zeros >= 2 && byte <= 0x03) {
+                nal.push_back(0x03);
+                zeros = 0;
+            }
+            nal.push_back(byte);
+            zeros = (byte == 0x00) ? zeros + 1 : 0;
+        }
+
+        return nal;
+    }
+
+private:
+    std::vector<uint8_t> data_;
+    unsigned int bit_count_ = 0;
+};
+
+VAProfile ProfileForIdc(unsigned int profile_idc) {
+    switch (profile_idc) {
+    case 100:
+        return VAProfileH264High;
+    case 77:
+        return VAProfileH264Main;
+    case 66:
+    default:
+        return VAProfileH264ConstrainedBaseline;
+    }
+}
+
+// The capture path hands us XBGR frames but the encoder surfaces are
+// NV12; same conversion matrix as the android backend uses.
+void XBGRToNV12(const uint8_t *rgb, uint8_t *luma, uint8_t *chroma,
+                unsigned int luma_stride, unsigned int chroma_stride,
+                unsigned int width, unsigned int height) {
+    for (unsigned int y = 0; y < height; y++) {
+        const uint8_t *src = rgb + y * width * 4;
+        uint8_t *dst = luma + y * luma_stride;
+        uint8_t *uv = chroma + (y / 2) * chroma_stride;
+
+        for (unsigned int x = 0; x < width; x++) {
+            const int r = src[0];
+            const int g = src[1];
+            const int b = src[2];
+
+            dst[x] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+
+            if ((y & 1) == 0 && (x & 1) == 0) {
+                uv[x] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+                uv[x + 1] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+            }
+
+            src += 4;
+        }
+    }
+}
+}
+
+namespace ac {
+namespace vaapi {
+
+video::BaseEncoder::Config H264Encoder::DefaultConfiguration() {
+    Config config;
+    config.framerate = kAnyFramerate;
+    config.bitrate = kDefaultBitrate;
+    config.i_frame_interval = kDefaultIFrameInterval.count();
+    return config;
+}
+
+video::BaseEncoder::Ptr H264Encoder::Create(const video::EncoderReport::Ptr &report) {
+    return std::shared_ptr<H264Encoder>(new H264Encoder(report));
+}
+
+H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report) :
+    report_(report),
+    running_(false),
+    drm_fd_(-1),
+    display_(nullptr),
+    va_config_(VA_INVALID_ID),
+    context_(VA_INVALID_ID),
+    source_surface_(VA_INVALID_SURFACE),
+    recon_surfaces_{VA_INVALID_SURFACE, VA_INVALID_SURFACE},
+    coded_buffer_(VA_INVALID_ID),
+    frame_count_(0),
+    idr_period_(0),
+    force_idr_(false),
+    pending_bitrate_(0),
+    input_queue_(ac::video::BufferQueue::CreateSPSC()) {
+}
+
+H264Encoder::~H264Encoder() {
+    Stop();
+
+    if (display_) {
+        if (coded_buffer_ != VA_INVALID_ID)
+            vaDestroyBuffer(display_, coded_buffer_);
+        if (context_ != VA_INVALID_ID)
+            vaDestroyContext(display_, context_);
+        if (source_surface_ != VA_INVALID_SURFACE)
+            vaDestroySurfaces(display_, &source_surface_, 1);
+        if (recon_surfaces_[0] != VA_INVALID_SURFACE)
+            vaDestroySurfaces(display_, recon_surfaces_, 2);
+        if (va_config_ != VA_INVALID_ID)
+            vaDestroyConfig(display_, va_config_);
+        vaTerminate(display_);
+    }
+
+    if (drm_fd_ >= 0)
+        ::close(drm_fd_);
+}
+
+bool H264Encoder::TryOpenNode(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0)
+        return false;
+
+    const auto display = vaGetDisplayDRM(fd);
+    if (!display) {
+        ::close(fd);
+        return false;
+    }
+
+    int major = 0, minor = 0;
+    if (vaInitialize(display, &major, &minor) != VA_STATUS_SUCCESS) {
+        ::close(fd);
+        return false;
+    }
+
+    AC_DEBUG("Using VAAPI %d.%d on %s (%s)", major, minor,
+             path.c_str(), vaQueryVendorString(display));
+
+    drm_fd_ = fd;
+    display_ = display;
+    return true;
+}
+
+bool H264Encoder::OpenDisplay() {
+    // The render node found by an earlier probe is kept in the
+    // capability cache so neither a reconnect nor a daemon restart
+    // has to walk all nodes again.
+    const auto cached_path = EncoderCapabilityCache::Instance().Lookup(kRenderNodeCacheKey);
+    if (cached_path.length() > 0 && TryOpenNode(cached_path))
+        return true;
+
+    for (unsigned int n = 0; n < kMaxRenderNodes; n++) {
+        const auto path = Utils::Sprintf(kRenderNodePathTemplate,
+                                         kFirstRenderNodeMinor + n);
+
+        if (!TryOpenNode(path))
+            continue;
+
+        EncoderCapabilityCache::Instance().Store(kRenderNodeCacheKey, path);
+        return true;
+    }
+
+    AC_ERROR("Failed to find a VAAPI capable render node");
+    return false;
+}
+
+bool H264Encoder::Configure(const Config &config) {
+    if (display_)
+        return false;
+
+    AC_DEBUG("configuring with %dx%d@%d", config.width, config.height, config.framerate);
+
+    if (!OpenDisplay())
+        return false;
+
+    const auto profile = ProfileForIdc(config.profile_idc);
+
+    VAConfigAttrib attribs[2];
+    attribs[0].type = VAConfigAttribRTFormat;
+    attribs[1].type = VAConfigAttribRateControl;
+    vaGetConfigAttributes(display_, profile, VAEntrypointEncSlice, attribs, 2);
+
+    if (!(attribs[0].value & VA_RT_FORMAT_YUV420)) {
+        AC_ERROR("Encoder does not support YUV420 surfaces");
+        return false;
+    }
+
+    if (!(attribs[1].value & VA_RC_CBR)) {
+        AC_ERROR("Encoder does not support constant bitrate control");
+        return false;
+    }
+
+    attribs[0].value = VA_RT_FORMAT_YUV420;
+    attribs[1].value = VA_RC_CBR;
+
+    if (vaCreateConfig(display_, profile, VAEntrypointEncSlice,
+                       attribs, 2, &va_config_) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to create encoder configuration");
+        return false;
+    }
+
+    VASurfaceID surfaces[3];
+    if (vaCreateSurfaces(display_, VA_RT_FORMAT_YUV420, config.width, config.height,
+                         surfaces, 3, nullptr, 0) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to create encoder surfaces");
+        return false;
+    }
+
+    source_surface_ = surfaces[0];
+    recon_surfaces_[0] = surfaces[1];
+    recon_surfaces_[1] = surfaces[2];
+
+    if (vaCreateContext(display_, va_config_, config.width, config.height,
+                        VA_PROGRESSIVE, surfaces, 3, &context_) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to create encoder context");
+        return false;
+    }
+
+    if (vaCreateBuffer(display_, context_, VAEncCodedBufferType,
+                       config.width * config.height * 2, 1, nullptr,
+                       &coded_buffer_) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to create coded buffer");
+        return false;
+    }
+
+    config_ = config;
+
+    if (config.i_frame_interval > 0 && config.framerate > 0)
+        idr_period_ = config.i_frame_interval * config.framerate;
+
+    const uint32_t width_in_mbs = (config.width + kMacroBlockSize - 1) / kMacroBlockSize;
+    const uint32_t height_in_mbs = (config.height + kMacroBlockSize - 1) / kMacroBlockSize;
+
+    // Sequence parameter set; pic_order_cnt_type 2 ties display to
+    // coding order which is exactly what an IPPP stream needs and
+    // spares us POC signalling in every slice.
+    BitWriter sps;
+    const unsigned int profile_idc = config.profile_idc > 0 ? config.profile_idc : 66;
+    sps.PutBits(profile_idc, 8);
+    sps.PutBits(config.constraint_set, 8);
+    sps.PutBits(config.level_idc > 0 ? config.level_idc : 31, 8);
+    sps.PutUE(0);       // seq_parameter_set_id
+    if (profile_idc == 100) {
+        sps.PutUE(1);   // chroma_format_idc
+        sps.PutUE(0);   // bit_depth_luma_minus8
+        sps.PutUE(0);   // bit_depth_chroma_minus8
+        sps.PutBits(0, 1); // qpprime_y_zero_transform_bypass_flag
+        sps.PutBits(0, 1); // seq_scaling_matrix_present_flag
+    }
+    sps.PutUE(4);       // log2_max_frame_num_minus4
+    sps.PutUE(2);       // pic_order_cnt_type
+    // We only ever keep the last reconstructed frame around
+    sps.PutUE(1);       // max_num_ref_frames
+    sps.PutBits(0, 1);  // gaps_in_frame_num_value_allowed_flag
+    sps.PutUE(width_in_mbs - 1);
+    sps.PutUE(height_in_mbs - 1);
+    sps.PutBits(1, 1);  // frame_mbs_only_flag
+    sps.PutBits(1, 1);  // direct_8x8_inference_flag
+    const bool cropping = (config.width % kMacroBlockSize) || (config.height % kMacroBlockSize);
+    sps.PutBits(cropping ? 1 : 0, 1);
+    if (cropping) {
+        sps.PutUE(0);
+        sps.PutUE((width_in_mbs * kMacroBlockSize - config.width) / 2);
+        sps.PutUE(0);
+        sps.PutUE((height_in_mbs * kMacroBlockSize - config.height) / 2);
+    }
+    sps.PutBits(0, 1);  // vui_parameters_present_flag
+    sps.WriteTrailingBits();
+    sps_ = sps.Finish(3, 7);
+
+    BitWriter pps;
+    pps.PutUE(0);       // pic_parameter_set_id
+    pps.PutUE(0);       // seq_parameter_set_id
+    pps.PutBits(0, 1);  // entropy_coding_mode_flag (CAVLC)
+    pps.PutBits(0, 1);  // bottom_field_pic_order_in_frame_present_flag
+    pps.PutUE(0);       // num_slice_groups_minus1
+    pps.PutUE(0);       // num_ref_idx_l0_default_active_minus1
+    pps.PutUE(0);       // num_ref_idx_l1_default_active_minus1
+    pps.PutBits(0, 1);  // weighted_pred_flag
+    pps.PutBits(0, 2);  // weighted_bipred_idc
+    pps.PutSE(kDefaultQP - 26); // pic_init_qp_minus26
+    pps.PutSE(0);       // pic_init_qs_minus26
+    pps.PutSE(0);       // chroma_qp_index_offset
+    pps.PutBits(1, 1);  // deblocking_filter_control_present_flag
+    pps.PutBits(0, 1);  // constrained_intra_pred_flag
+    pps.PutBits(0, 1);  // redundant_pic_cnt_present_flag
+    pps.WriteTrailingBits();
+    pps_ = pps.Finish(3, 8);
+
+    AC_DEBUG("Configured encoder succesfully");
+
+    return true;
+}
+
+VABufferID H264Encoder::CreateSequenceParameters() {
+    VAEncSequenceParameterBufferH264 seq;
+    ::memset(&seq, 0, sizeof(seq));
+
+    seq.seq_parameter_set_id = 0;
+    seq.level_idc = config_.level_idc > 0 ? config_.level_idc : 31;
+    seq.intra_period = idr_period_;
+    seq.intra_idr_period = idr_period_;
+    seq.ip_period = 1;
+    seq.bits_per_second = config_.bitrate;
+    seq.max_num_ref_frames = 1;
+    seq.picture_width_in_mbs = (config_.width + kMacroBlockSize - 1) / kMacroBlockSize;
+    seq.picture_height_in_mbs = (config_.height + kMacroBlockSize - 1) / kMacroBlockSize;
+    seq.seq_fields.bits.chroma_format_idc = 1;
+    seq.seq_fields.bits.frame_mbs_only_flag = 1;
+    seq.seq_fields.bits.log2_max_frame_num_minus4 = 4;
+    seq.seq_fields.bits.pic_order_cnt_type = 2;
+    seq.time_scale = config_.framerate * 2;
+    seq.num_units_in_tick = 1;
+
+    VABufferID buffer = VA_INVALID_ID;
+    vaCreateBuffer(display_, context_, VAEncSequenceParameterBufferType,
+                   sizeof(seq), 1, &seq, &buffer);
+    return buffer;
+}
+
+VABufferID H264Encoder::CreatePictureParameters(bool is_idr) {
+    VAEncPictureParameterBufferH264 pic;
+    ::memset(&pic, 0, sizeof(pic));
+
+    const auto current_recon = recon_surfaces_[frame_count_ & 1];
+    const auto last_recon = recon_surfaces_[(frame_count_ + 1) & 1];
+
+    pic.CurrPic.picture_id = current_recon;
+    pic.CurrPic.frame_idx = frame_count_;
+    pic.CurrPic.TopFieldOrderCnt = 2 * frame_count_;
+
+    for (auto &frame : pic.ReferenceFrames)
+        frame.picture_id = VA_INVALID_SURFACE;
+
+    if (!is_idr) {
+        pic.ReferenceFrames[0].picture_id = last_recon;
+        pic.ReferenceFrames[0].frame_idx = frame_count_ - 1;
+        pic.ReferenceFrames[0].flags = VA_PICTURE_H264_SHORT_TERM_REFERENCE;
+    }
+
+    pic.coded_buf = coded_buffer_;
+    pic.pic_parameter_set_id = 0;
+    pic.seq_parameter_set_id = 0;
+    pic.frame_num = is_idr ? 0 : (frame_count_ & 0xff);
+    pic.pic_init_qp = kDefaultQP;
+    pic.num_ref_idx_l0_active_minus1 = 0;
+    pic.pic_fields.bits.idr_pic_flag = is_idr ? 1 : 0;
+    pic.pic_fields.bits.reference_pic_flag = 1;
+    pic.pic_fields.bits.entropy_coding_mode_flag = 0;
+    pic.pic_fields.bits.deblocking_filter_control_present_flag = 1;
+
+    VABufferID buffer = VA_INVALID_ID;
+    vaCreateBuffer(display_, context_, VAEncPictureParameterBufferType,
+                   sizeof(pic), 1, &pic, &buffer);
+    return buffer;
+}
+
+VABufferID H264Encoder::CreateSliceParameters(bool is_idr) {
+    VAEncSliceParameterBufferH264 slice;
+    ::memset(&slice, 0, sizeof(slice));
+
+    const uint32_t width_in_mbs = (config_.width + kMacroBlockSize - 1) / kMacroBlockSize;
+    const uint32_t height_in_mbs = (config_.height + kMacroBlockSize - 1) / kMacroBlockSize;
+
+    slice.macroblock_address = 0;
+    slice.num_macroblocks = width_in_mbs * height_in_mbs;
+    slice.slice_type = is_idr ? 2 : 0;
+    slice.pic_parameter_set_id = 0;
+    slice.idr_pic_id = 0;
+    slice.pic_order_cnt_lsb = 0;
+
+    for (auto &frame : slice.RefPicList0)
+        frame.picture_id = VA_INVALID_SURFACE;
+    for (auto &frame : slice.RefPicList1)
+        frame.picture_id = VA_INVALID_SURFACE;
+
+    if (!is_idr) {
+        slice.RefPicList0[0].picture_id = recon_surfaces_[(frame_count_ + 1) & 1];
+        slice.RefPicList0[0].flags = VA_PICTURE_H264_SHORT_TERM_REFERENCE;
+    }
+
+    VABufferID buffer = VA_INVALID_ID;
+    vaCreateBuffer(display_, context_, VAEncSliceParameterBufferType,
+                   sizeof(slice), 1, &slice, &buffer);
+    return buffer;
+}
+
+VABufferID H264Encoder::CreateRateControlParameters() {
+    struct {
+        VAEncMiscParameterBuffer header;
+        VAEncMiscParameterRateControl rc;
+    } misc;
+    ::memset(&misc, 0, sizeof(misc));
+
+    misc.header.type = VAEncMiscParameterTypeRateControl;
+    misc.rc.bits_per_second = config_.bitrate;
+    misc.rc.target_percentage = 90;
+    // A short window keeps the controller reacting within a few frames
+    // which is what a live stream wants
+    misc.rc.window_size = 1000 / (config_.framerate > 0 ? config_.framerate : kAnyFramerate) * 2;
+    misc.rc.initial_qp = kDefaultQP;
+    misc.rc.min_qp = 1;
+
+    VABufferID buffer = VA_INVALID_ID;
+    vaCreateBuffer(display_, context_, VAEncMiscParameterBufferType,
+                   sizeof(misc), 1, &misc, &buffer);
+    return buffer;
+}
+
+bool H264Encoder::CreatePackedHeader(VAEncPackedHeaderType type,
+                                     const std::vector<uint8_t> &data,
+                                     std::vector<VABufferID> *buffers) {
+    VAEncPackedHeaderParameterBuffer param;
+    ::memset(&param, 0, sizeof(param));
+    param.type = type;
+    param.bit_length = data.size() * 8;
+    param.has_emulation_bytes = 1;
+
+    VABufferID param_buffer = VA_INVALID_ID;
+    if (vaCreateBuffer(display_, context_, VAEncPackedHeaderParameterBufferType,
+                       sizeof(param), 1, &param, &param_buffer) != VA_STATUS_SUCCESS)
+        return false;
+
+    VABufferID data_buffer = VA_INVALID_ID;
+    if (vaCreateBuffer(display_, context_, VAEncPackedHeaderDataBufferType,
+                       data.size(), 1, const_cast<uint8_t*>(data.data()),
+                       &data_buffer) != VA_STATUS_SUCCESS) {
+        vaDestroyBuffer(display_, param_buffer);
+        return false;
+    }
+
+    buffers->push_back(param_buffer);
+    buffers->push_back(data_buffer);
+    return true;
+}
+
+bool H264Encoder::UploadFrame(const video::Buffer::Ptr &input_buffer) {
+    VAImage image;
+    if (vaDeriveImage(display_, source_surface_, &image) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to derive image from input surface");
+        return false;
+    }
+
+    uint8_t *data = nullptr;
+    if (vaMapBuffer(display_, image.buf,
+                    reinterpret_cast<void**>(&data)) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to map input surface");
+        vaDestroyImage(display_, image);
+        return false;
+    }
+
+    XBGRToNV12(input_buffer->Data(),
+               data + image.offsets[0], data + image.offsets[1],
+               image.pitches[0], image.pitches[1],
+               config_.width, config_.height);
+
+    vaUnmapBuffer(display_, image.buf);
+    vaDestroyImage(display_, image);
+
+    return true;
+}
+
+bool H264Encoder::EncodeFrame(const video::Buffer::Ptr &input_buffer) {
+    const bool is_idr = frame_count_ == 0 || force_idr_ ||
+            (idr_period_ > 0 && (frame_count_ % idr_period_) == 0);
+    force_idr_ = false;
+
+    if (pending_bitrate_ > 0) {
+        config_.bitrate = pending_bitrate_;
+        pending_bitrate_ = 0;
+    }
+
+    if (!UploadFrame(input_buffer))
+        return false;
+
+    std::vector<VABufferID> buffers;
+
+    if (is_idr) {
+        buffers.push_back(CreateSequenceParameters());
+        buffers.push_back(CreateRateControlParameters());
+        if (!CreatePackedHeader(VAEncPackedHeaderSequence, sps_, &buffers) ||
+            !CreatePackedHeader(VAEncPackedHeaderPicture, pps_, &buffers)) {
+            AC_ERROR("Failed to create packed parameter sets");
+            return false;
+        }
+    }
+
+    buffers.push_back(CreatePictureParameters(is_idr));
+    buffers.push_back(CreateSliceParameters(is_idr));
+
+    for (const auto buffer : buffers) {
+        if (buffer == VA_INVALID_ID) {
+            AC_ERROR("Failed to create encode parameter buffers");
+            return false;
+        }
+    }
+
+    auto status = vaBeginPicture(display_, context_, source_surface_);
+    if (status == VA_STATUS_SUCCESS)
+        status = vaRenderPicture(display_, context_, buffers.data(), buffers.size());
+    if (status == VA_STATUS_SUCCESS)
+        status = vaEndPicture(display_, context_);
+
+    for (const auto buffer : buffers)
+        vaDestroyBuffer(display_, buffer);
+
+    if (status != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to encode frame: %s", vaErrorStr(status));
+        return false;
+    }
+
+    if (vaSyncSurface(display_, source_surface_) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to wait for encoded frame");
+        return false;
+    }
+
+    frame_count_++;
+
+    return DrainCodedBuffer(input_buffer->Timestamp(), input_buffer->FrameId(), is_idr);
+}
+
+bool H264Encoder::DrainCodedBuffer(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id, bool is_idr) {
+    VACodedBufferSegment *segment = nullptr;
+    if (vaMapBuffer(display_, coded_buffer_,
+                    reinterpret_cast<void**>(&segment)) != VA_STATUS_SUCCESS) {
+        AC_ERROR("Failed to map coded buffer");
+        return false;
+    }
+
+    size_t total = 0;
+    for (auto current = segment; current;
+         current = static_cast<VACodedBufferSegment*>(current->next))
+        total += current->size;
+
+    auto output_buffer = video::Buffer::Create(total);
+
+    size_t offset = 0;
+    for (auto current = segment; current;
+         current = static_cast<VACodedBufferSegment*>(current->next)) {
+        ::memcpy(output_buffer->Data() + offset, current->buf, current->size);
+        offset += current->size;
+    }
+
+    vaUnmapBuffer(display_, coded_buffer_);
+
+    output_buffer->SetTimestamp(timestamp);
+    output_buffer->SetFrameId(frame_id);
+
+    AC_REPORT(report_->FinishedFrame(output_buffer->Timestamp(), output_buffer->FrameId()));
+
+    if (auto sp = delegate_.lock()) {
+        // The packed parameter sets travel at the front of every IDR
+        // frame's coded buffer
+        if (is_idr)
+            sp->OnBufferWithCodecConfig(output_buffer);
+
+        sp->OnBufferAvailable(output_buffer);
+    }
+
+    return true;
+}
+
+bool H264Encoder::Start() {
+    if (!display_ || running_)
+        return false;
+
+    running_ = true;
+
+    report_->Started();
+
+    return true;
+}
+
+bool H264Encoder::Stop() {
+    if (!display_ || !running_)
+        return false;
+
+    running_ = false;
+
+    report_->Stopped();
+
+    return true;
+}
+
+bool H264Encoder::Execute() {
+    if (!running_) {
+        AC_ERROR("Tried to execute encoder while not started");
+        return false;
+    }
+
+    const auto input_buffer = input_queue_->Next();
+    if (!input_buffer)
+        return true;
+
+    AC_REPORT(report_->BeganFrame(input_buffer->Timestamp()));
+
+    return EncodeFrame(input_buffer);
+}
+
+void H264Encoder::QueueBuffer(const video::Buffer::Ptr &buffer) {
+    if (!running_)
+        return;
+
+    if (ConsumeIDRRequest())
+        SendIDRFrame();
+
+    input_queue_->Push(buffer);
+
+    AC_REPORT(report_->ReceivedInputBuffer(buffer->Timestamp()));
+}
+
+video::BaseEncoder::Config H264Encoder::Configuration() const {
+    return config_;
+}
+
+void H264Encoder::SendIDRFrame() {
+    if (!display_)
+        return;
+
+    force_idr_ = true;
+}
+
+bool H264Encoder::Reconfigure(const Config &config) {
+    if (!display_)
+        return Configure(config);
+
+    AC_DEBUG("reconfiguring with %dx%d@%d", config.width, config.height, config.framerate);
+
+    Stop();
+
+    // Surfaces and context are bound to the frame size, so the whole
+    // VA session gets torn down and rebuilt; the delegate wiring
+    // around the encoder stays in place.
+    if (coded_buffer_ != VA_INVALID_ID) {
+        vaDestroyBuffer(display_, coded_buffer_);
+        coded_buffer_ = VA_INVALID_ID;
+    }
+    if (context_ != VA_INVALID_ID) {
+        vaDestroyContext(display_, context_);
+        context_ = VA_INVALID_ID;
+    }
+    if (source_surface_ != VA_INVALID_SURFACE) {
+        vaDestroySurfaces(display_, &source_surface_, 1);
+        source_surface_ = VA_INVALID_SURFACE;
+    }
+    if (recon_surfaces_[0] != VA_INVALID_SURFACE) {
+        vaDestroySurfaces(display_, recon_surfaces_, 2);
+        recon_surfaces_[0] = recon_surfaces_[1] = VA_INVALID_SURFACE;
+    }
+    if (va_config_ != VA_INVALID_ID) {
+        vaDestroyConfig(display_, va_config_);
+        va_config_ = VA_INVALID_ID;
+    }
+    vaTerminate(display_);
+    display_ = nullptr;
+
+    ::close(drm_fd_);
+    drm_fd_ = -1;
+
+    // Frames captured at the old resolution are useless now
+    input_queue_->PopAll();
+
+    sps_.clear();
+    pps_.clear();
+    frame_count_ = 0;
+    idr_period_ = 0;
+    force_idr_ = false;
+    pending_bitrate_ = 0;
+
+    return Configure(config);
+}
+
+bool H264Encoder::SetTargetBitrate(unsigned int bitrate) {
+    if (!display_)
+        return false;
+
+    // Picked up by the encode loop which resends the rate control
+    // parameters with the next IDR frame
+    pending_bitrate_ = bitrate;
+    force_idr_ = true;
+
+    AC_DEBUG("Changed encoder target bitrate to %d bit/s", bitrate);
+
+    return true;
+}
+
+bool H264Encoder::SetTargetFramerate(int framerate) {
+    if (!display_ || framerate <= 0)
+        return false;
+
+    config_.framerate = framerate;
+
+    // The rate control window depends on the framerate; resend the
+    // controller parameters with a fresh IDR
+    force_idr_ = true;
+
+    AC_DEBUG("Changed encoder target framerate to %d fps", framerate);
+
+    return true;
+}
+
+std::string H264Encoder::Name() const {
+    return kEncoderThreadName;
+}
+
+} // namespace vaapi
+} // namespace ac
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VAAPI_ENCODER_H_
+#define AC_VAAPI_ENCODER_H_
+
+#include <memory>
+#include <vector>
+
+#include <va/va.h>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/common/executable.h"
+
+#include "ac/video/baseencoder.h"
+#include "ac/video/encoderreport.h"
+#include "ac/video/bufferqueue.h"
+
+namespace ac {
+namespace vaapi {
+
+// H.264 encoder on top of libva for x86 machines where neither the
+// hybris nor the V4L2 backends apply. Talks to the DRM render node
+// directly; frames are uploaded into NV12 surfaces and encoded with a
+// single-reference IPPP structure tuned for low latency.
+class H264Encoder : public video::BaseEncoder {
+public:
+    typedef std::shared_ptr<H264Encoder> Ptr;
+
+    static BaseEncoder::Ptr Create(const video::EncoderReport::Ptr &report);
+
+    ~H264Encoder();
+
+    BaseEncoder::Config DefaultConfiguration() override;
+
+    bool Configure(const BaseEncoder::Config &config) override;
+
+    void QueueBuffer(const ac::video::Buffer::Ptr &buffer) override;
+
+    bool Running() const override { return running_; }
+    BaseEncoder::Config Configuration() const override;
+
+    void SendIDRFrame() override;
+
+    bool Reconfigure(const BaseEncoder::Config &config) override;
+
+    bool SetTargetBitrate(unsigned int bitrate) override;
+    bool SetTargetFramerate(int framerate) override;
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+    // Execute() blocks on the input queue and inside the driver until
+    // the next encoded frame and cannot share an executor loop
+    bool PrefersDedicatedThread() const override { return true; }
+
+private:
+    H264Encoder(const video::EncoderReport::Ptr &report);
+
+    bool TryOpenNode(const std::string &path);
+    bool OpenDisplay();
+    bool UploadFrame(const ac::video::Buffer::Ptr &input_buffer);
+    bool EncodeFrame(const ac::video::Buffer::Ptr &input_buffer);
+    bool DrainCodedBuffer(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id, bool is_idr);
+
+    VABufferID CreateSequenceParameters();
+    VABufferID CreatePictureParameters(bool is_idr);
+    VABufferID CreateSliceParameters(bool is_idr);
+    VABufferID CreateRateControlParameters();
+    bool CreatePackedHeader(VAEncPackedHeaderType type,
+                            const std::vector<uint8_t> &data,
+                            std::vector<VABufferID> *buffers);
+
+private:
+    video::EncoderReport::Ptr report_;
+    BaseEncoder::Config config_;
+    bool running_;
+    int drm_fd_;
+    VADisplay display_;
+    VAConfigID va_config_;
+    VAContextID context_;
+    VASurfaceID source_surface_;
+    // Reconstructed frames alternate between two surfaces; the one not
+    // being written becomes the reference for the next P frame
+    VASurfaceID recon_surfaces_[2];
+    VABufferID coded_buffer_;
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+    uint32_t frame_count_;
+    uint32_t idr_period_;
+    bool force_idr_;
+    // Bitrate change requested while running; applied with the next frame
+    unsigned int pending_bitrate_;
+    ac::video::BufferQueue::Ptr input_queue_;
+};
+
+} // namespace vaapi
+} // namespace ac
+
+#endif
@@ -26,5 +26,13 @@ void BaseEncoder::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
     delegate_ = delegate;
 }
 
+void BaseEncoder::RequestIDRFrame() {
+    idr_requested_.store(true, std::memory_order_relaxed);
+}
+
+bool BaseEncoder::ConsumeIDRRequest() {
+    return idr_requested_.exchange(false, std::memory_order_relaxed);
+}
+
 } // namespace video
 } // namespace ac
@@ -18,13 +18,20 @@
 #ifndef AC_VIDEO_BASEENCODER_H_
 #define AC_VIDEO_BASEENCODER_H_
 
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/concept_check.hpp>
 
 #include "ac/non_copyable.h"
 
 #include "ac/common/executable.h"
 
 #include "ac/video/buffer.h"
+#include "ac/video/codectype.h"
+#include "ac/video/rect.h"
 
 namespace ac {
 namespace video {
@@ -36,6 +43,7 @@ public:
     class Config {
     public:
         Config() :
+            codec(CodecType::kH264),
             width(0),
             height(0),
             bitrate(0),
@@ -45,11 +53,16 @@ public:
             profile_idc(0),
             level_idc(0),
             constraint_set(0),
-            i_frame_interval(0) {
+            i_frame_interval(0),
+            intra_refresh_mode(0),
+            intra_refresh_frames(0),
+            slices(0),
+            send_pacing_rate(0) {
         }
 
         bool operator==(const Config& other) const {
-            return width == other.width &&
+            return codec == other.codec &&
+                    width == other.width &&
                     height == other.height &&
                     bitrate == other.bitrate &&
                     framerate == other.framerate &&
@@ -59,15 +72,20 @@ public:
                     level_idc == other.level_idc &&
                     constraint_set == other.constraint_set &&
                     i_frame_interval == other.i_frame_interval &&
-                    intra_refresh_mode == other.intra_refresh_mode;
+                    intra_refresh_mode == other.intra_refresh_mode &&
+                    intra_refresh_frames == other.intra_refresh_frames &&
+                    slices == other.slices &&
+                    send_pacing_rate == other.send_pacing_rate;
         }
 
+        CodecType codec;
         unsigned int width;
         unsigned int height;
         unsigned int bitrate;
         int framerate;
 
-        // H.264 specifics
+        // H.264 specifics; profile/level fields are ignored by
+        // backends when an HEVC codec is configured
         unsigned int profile;
         unsigned int level;
         unsigned int profile_idc;
@@ -75,11 +93,33 @@ public:
         unsigned int constraint_set;
         unsigned int i_frame_interval;
         unsigned int intra_refresh_mode;
+        // When non-zero a full intra refresh is spread over this many
+        // frames (gradual decoder refresh) and the encoder stops
+        // emitting periodic IDR frames, flattening the frame size
+        // distribution; 0 keeps the classic IDR cadence.
+        unsigned int intra_refresh_frames;
+        // Number of slices per frame; with more than one slice both
+        // encoder and sink-side decoder can work a frame with multiple
+        // cores, cutting per-frame latency at a small bitrate cost for
+        // the extra slice headers. 0 or 1 keeps one slice per frame;
+        // backends without slice control ignore it.
+        unsigned int slices;
+        // Token bucket rate in bit/s used to spread RTP packet bursts
+        // over the frame interval; 0 disables pacing.
+        unsigned int send_pacing_rate;
     };
 
     class Delegate : public ac::NonCopyable {
     public:
         virtual void OnBufferAvailable(const ac::video::Buffer::Ptr &buffer) = 0;
+        // Hands over a whole run of encoded buffers with a single
+        // call so the delegate pays for one wakeup instead of one per
+        // buffer. Backends which can dequeue several ready buffers at
+        // once use this; the default falls back to per-buffer delivery.
+        virtual void OnBuffersAvailable(const std::vector<ac::video::Buffer::Ptr> &buffers) {
+            for (const auto &buffer : buffers)
+                OnBufferAvailable(buffer);
+        }
         virtual void OnBufferWithCodecConfig(const ac::video::Buffer::Ptr &buffer) = 0;
         virtual void OnBufferReturned() { }
     };
@@ -92,19 +132,124 @@ public:
 
     virtual bool Configure(const Config &config) = 0;
 
+    /**
+     * @brief Whether the backend can produce the given codec.
+     *
+     * The media manager checks this before asking for anything but
+     * H.264 and falls back when the backend declines, so sessions
+     * never fail over an optional codec.
+     */
+    virtual bool SupportsCodec(CodecType codec) const {
+        return codec == CodecType::kH264;
+    }
+
+    /**
+     * @brief Pixel formats the encoder ingests without an extra
+     * conversion pass, best first.
+     *
+     * Names follow the producer-side convention ("RGBX", "RGBA", ...)
+     * so the media manager can negotiate the capture format directly
+     * against them. The default is the format the screencast always
+     * produced, so backends which don't override this keep their
+     * current behaviour.
+     */
+    virtual std::vector<std::string> SupportedInputFormats() const {
+        return {"RGBX"};
+    }
+
     virtual void QueueBuffer(const ac::video::Buffer::Ptr &buffer) = 0;
 
+    /**
+     * @brief Native input surface of the encoder, or nullptr.
+     *
+     * Backends which can let the codec own its input as a shared
+     * gralloc surface return the native window handle here after
+     * Configure(); producers able to render into it directly bypass
+     * the raw frame queue entirely and QueueBuffer() goes unused.
+     */
+    virtual void* InputSurface() const { return nullptr; }
+
     virtual Config Configuration() const = 0;
 
     virtual bool Running() const = 0;
 
     virtual void SendIDRFrame() = 0;
 
+    /**
+     * @brief Marks that the next queued frame should be an IDR frame.
+     *
+     * Lock-free and callable from any thread (the RTCP receiver uses
+     * it straight from its own thread); the request is picked up at
+     * the next frame boundary via ConsumeIDRRequest.
+     */
+    void RequestIDRFrame();
+
+    /**
+     * @brief Tears down the codec instance and applies a full new
+     * configuration while the encoder stays wired into the pipeline.
+     *
+     * Used for mid-session format renegotiations; the caller has to
+     * stop the pipeline first and restart it afterwards. Returns false
+     * when the backend cannot rebuild its codec in place.
+     */
+    virtual bool Reconfigure(const Config &config) {
+        boost::ignore_unused_variable_warning(config);
+        return false;
+    }
+
+    /**
+     * @brief Changes the target bitrate of a running encoder without
+     * a pipeline restart.
+     *
+     * Returns false when the backend cannot reconfigure the bitrate
+     * mid-session.
+     */
+    virtual bool SetTargetBitrate(unsigned int bitrate) {
+        boost::ignore_unused_variable_warning(bitrate);
+        return false;
+    }
+
+    /**
+     * @brief Changes the target framerate of a running encoder without
+     * a pipeline restart.
+     *
+     * Returns false when the backend cannot reconfigure the framerate
+     * mid-session.
+     */
+    virtual bool SetTargetFramerate(int framerate) {
+        boost::ignore_unused_variable_warning(framerate);
+        return false;
+    }
+
+    /**
+     * @brief Hints at the screen region the next queued frame actually
+     * changed, in frame pixel coordinates.
+     *
+     * Backends with per-region rate control spend the bit budget on
+     * the changed area; others may still steer global quantization by
+     * how much of the frame moves. An empty rectangle means the extent
+     * of the change is unknown and has to be read as the whole frame.
+     * Purely advisory; returns false when the backend ignores region
+     * hints entirely.
+     */
+    virtual bool SetDamageHint(const Rect &region) {
+        boost::ignore_unused_variable_warning(region);
+        return false;
+    }
+
 protected:
     BaseEncoder() = default;
 
+    // Backends call this once per queued frame and force an IDR frame
+    // when it comes back true; the flag resets atomically so a burst
+    // of feedback packets costs a single refresh.
+    bool ConsumeIDRRequest();
+
 protected:
     std::weak_ptr<Delegate> delegate_;
+
+private:
+    std::atomic<bool> idr_requested_{false};
 };
 
 } // namespace video
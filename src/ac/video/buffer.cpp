@@ -18,6 +18,7 @@
 #include <memory.h>
 
 #include "ac/video/buffer.h"
+#include "ac/video/bufferpool.h"
 
 namespace ac {
 namespace video {
@@ -41,27 +42,59 @@ Buffer::Ptr Buffer::Create(void *native_handle) {
     return buffer;
 }
 
+Buffer::Ptr Buffer::CreateView(const Buffer::Ptr &parent, uint32_t offset, uint32_t length) {
+    if (!parent || !parent->Data() || offset + length > parent->Length())
+        return nullptr;
+
+    auto buffer = std::shared_ptr<Buffer>(new Buffer(parent->Timestamp()));
+    buffer->frame_id_ = parent->FrameId();
+    buffer->parent_ = parent;
+    buffer->data_ = parent->Data();
+    buffer->capacity_ = parent->Length();
+    buffer->offset_ = offset;
+    buffer->length_ = length;
+    return buffer;
+}
+
 Buffer::Buffer() :
+    pool_size_class_(0),
     capacity_(0),
     length_(0),
     offset_(0),
     data_(nullptr),
     timestamp_(0),
+    frame_id_(0),
     native_handle_(nullptr) {
 }
 
 Buffer::Buffer(int64_t timestamp) :
+    pool_size_class_(0),
     capacity_(0),
     length_(0),
     offset_(0),
     data_(nullptr),
     timestamp_(timestamp),
+    frame_id_(0),
     native_handle_(nullptr) {
 }
 
 Buffer::~Buffer() {
-    if (data_)
-        free(data_);
+    // Views only reference their parent's data which stays owned by
+    // the parent buffer.
+    if (!data_ || parent_)
+        return;
+
+    // Pooled storage goes back on the freelist for reuse instead of
+    // to the allocator.
+    if (auto pool = pool_.lock()) {
+        pool->Recycle(data_, pool_size_class_);
+        return;
+    }
+
+    if (data_ == inline_storage_)
+        return;
+
+    delete[] data_;
 }
 
 void Buffer::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
@@ -85,11 +118,21 @@ void Buffer::SetTimestamp(int64_t timestamp) {
     timestamp_ = timestamp;
 }
 
+void Buffer::SetFrameId(const ac::FrameId &frame_id) {
+    frame_id_ = frame_id;
+}
+
 void Buffer::Allocate(uint32_t capacity) {
     if (data_)
         return;
 
-    data_ = new uint8_t[capacity];
+    // Small buffers live inside the object itself; only bigger ones
+    // pay for a separate allocation.
+    if (capacity <= kInlineCapacity)
+        data_ = inline_storage_;
+    else
+        data_ = new uint8_t[capacity];
+
     ::memset(data_, 0, capacity);
     capacity_ = capacity;
     length_ = capacity;
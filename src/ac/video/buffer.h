@@ -27,6 +27,7 @@ namespace ac {
 namespace video {
 
 class BufferOutputTarget;
+class BufferPool;
 
 class Buffer : public std::enable_shared_from_this<Buffer> {
 public:
@@ -39,12 +40,20 @@ public:
 
     virtual ~Buffer();
 
+    // Buffers up to this size keep their data in-object instead of in
+    // a separate heap allocation.
+    static constexpr uint32_t kInlineCapacity{256};
+
     static Buffer::Ptr Create(uint32_t capacity = 0, ac::TimestampUs timestamp = 0ll);
     static Buffer::Ptr Create(uint8_t *data, uint32_t length);
     static Buffer::Ptr Create(void *native_handle);
+    // Creates a view referencing a range of the parent buffer's data
+    // without copying; the parent is kept alive by the view.
+    static Buffer::Ptr CreateView(const Buffer::Ptr &parent, uint32_t offset, uint32_t length);
 
     void SetRange(uint32_t offset, uint32_t length);
     void SetTimestamp(int64_t timestamp);
+    void SetFrameId(const ac::FrameId &frame_id);
 
     virtual uint32_t Capacity() const { return capacity_; }
     virtual uint32_t Offset() const { return offset_; }
@@ -52,6 +61,9 @@ public:
     virtual uint8_t* Data() { return data_ + offset_; }
     // Timestamp of the buffer in micro-seconds
     virtual ac::TimestampUs Timestamp() const { return timestamp_; }
+    // Id of the captured frame this buffer's data originates from;
+    // 0 if it doesn't carry frame data
+    virtual ac::FrameId FrameId() const { return frame_id_; }
 
     virtual bool IsValid() const { return data_ != nullptr || native_handle_ != nullptr; }
 
@@ -69,14 +81,22 @@ protected:
 
 private:
     std::weak_ptr<Delegate> delegate_;
+    Buffer::Ptr parent_;
+    std::weak_ptr<BufferPool> pool_;
+    uint32_t pool_size_class_;
     uint32_t capacity_;
     uint32_t length_;
     uint32_t offset_;
     uint8_t *data_;
     int64_t timestamp_;
+    ac::FrameId frame_id_;
     void *native_handle_;
+    // Storage arm for small buffers (RTP headers, PSI sections, ...)
+    // so they never touch the allocator; data_ points here then.
+    uint8_t inline_storage_[kInlineCapacity];
 
     friend class BufferOutputTarget;
+    friend class BufferPool;
 };
 
 } // namespace video
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <memory.h>
+
+#include "ac/video/bufferpool.h"
+
+namespace {
+// Tiny buffers all share one class so header-sized allocations hit
+// the same freelist
+static constexpr uint32_t kMinSizeClass = 256;
+// Keep at most this many recycled arrays per size class around; the
+// steady state of a single stream needs far fewer
+static constexpr size_t kMaxFreeBuffersPerClass = 32;
+}
+
+namespace ac {
+namespace video {
+
+BufferPool::Ptr BufferPool::Create() {
+    return std::shared_ptr<BufferPool>(new BufferPool);
+}
+
+BufferPool::~BufferPool() {
+    for (auto &free_list : free_lists_) {
+        for (auto data : free_list.second)
+            delete[] data;
+    }
+}
+
+uint32_t BufferPool::SizeClassFor(uint32_t capacity) {
+    uint32_t size_class = kMinSizeClass;
+    while (size_class < capacity)
+        size_class <<= 1;
+    return size_class;
+}
+
+uint8_t* BufferPool::TakeFromFreelist(uint32_t size_class) {
+    std::lock_guard<std::mutex> l(mutex_);
+
+    auto it = free_lists_.find(size_class);
+    if (it == free_lists_.end() || it->second.empty())
+        return nullptr;
+
+    auto data = it->second.back();
+    it->second.pop_back();
+    return data;
+}
+
+void BufferPool::Recycle(uint8_t *data, uint32_t size_class) {
+    std::unique_lock<std::mutex> l(mutex_);
+
+    auto &free_list = free_lists_[size_class];
+    if (free_list.size() >= kMaxFreeBuffersPerClass) {
+        l.unlock();
+        delete[] data;
+        return;
+    }
+
+    free_list.push_back(data);
+}
+
+Buffer::Ptr BufferPool::Acquire(uint32_t capacity, ac::TimestampUs timestamp) {
+    const auto size_class = SizeClassFor(capacity);
+
+    auto data = TakeFromFreelist(size_class);
+    if (!data)
+        data = new uint8_t[size_class];
+
+    ::memset(data, 0, capacity);
+
+    auto buffer = std::shared_ptr<Buffer>(new Buffer(timestamp));
+    buffer->data_ = data;
+    buffer->capacity_ = capacity;
+    buffer->length_ = capacity;
+    buffer->offset_ = 0;
+    buffer->pool_ = shared_from_this();
+    buffer->pool_size_class_ = size_class;
+    return buffer;
+}
+
+} // namespace video
+} // namespace ac
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_BUFFERPOOL_H_
+#define AC_VIDEO_BUFFERPOOL_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ac/non_copyable.h"
+
+#include "ac/video/buffer.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Recycles the backing storage of video::Buffer instances.
+ *
+ * Buffers acquired from a pool return their data array to a
+ * size-classed freelist when the last reference goes away instead of
+ * handing it back to the allocator, so steady-state streaming does
+ * not allocate on the hot path at all.
+ */
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+public:
+    typedef std::shared_ptr<BufferPool> Ptr;
+
+    static BufferPool::Ptr Create();
+
+    ~BufferPool();
+
+    // Same contract as Buffer::Create(capacity, timestamp) but the
+    // storage is drawn from the pool when a recycled array is around.
+    Buffer::Ptr Acquire(uint32_t capacity, ac::TimestampUs timestamp = 0ll);
+
+private:
+    BufferPool() = default;
+
+    uint8_t* TakeFromFreelist(uint32_t size_class);
+    void Recycle(uint8_t *data, uint32_t size_class);
+
+    static uint32_t SizeClassFor(uint32_t capacity);
+
+private:
+    std::mutex mutex_;
+    std::map<uint32_t, std::vector<uint8_t*>> free_lists_;
+
+    friend class Buffer;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -19,11 +19,16 @@
 #define AC_VIDEO_BUFFERPRODUCER_H_
 
 #include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/concept_check.hpp>
 
 #include "ac/non_copyable.h"
 
 #include "ac/video/buffer.h"
 #include "ac/video/displayoutput.h"
+#include "ac/video/rect.h"
 
 namespace ac {
 namespace video {
@@ -35,8 +40,32 @@ public:
     virtual ~BufferProducer() { }
 
     virtual bool Setup(const video::DisplayOutput &output) = 0;
+    // Pixel formats the consumer ingests without a conversion pass,
+    // best first, named like pixel_format() reports them ("RGBX",
+    // "RGBA", ...). Called before Setup(); producers which cannot
+    // choose their format ignore it.
+    virtual void SetPreferredPixelFormats(const std::vector<std::string> &formats) {
+        boost::ignore_unused_variable_warning(formats);
+    }
     virtual void SwapBuffers() = 0;
+    // Whether the frame produced by the last SwapBuffers() call differs
+    // from the one before it. Producers which can't tell have to report
+    // every frame as damaged.
+    virtual bool LastFrameDamaged() const = 0;
+    // Coarse bounding box of what the last frame changed, in its own
+    // pixel coordinates. Producers which only know that something
+    // changed return an empty rectangle, which consumers have to read
+    // as "anywhere".
+    virtual Rect LastFrameDamageRegion() const { return Rect{}; }
+    // Capture time in microseconds of the frame returned by the last
+    // SwapBuffers() call, taken as close to the compositor finishing
+    // the frame as the platform allows. Producers without a precise
+    // source return 0 and the caller stamps the buffer itself.
+    virtual ac::TimestampUs LastFrameTimestamp() const = 0;
     virtual Buffer::Ptr CurrentBuffer() const = 0;
+    // Layout of the pixels in CurrentBuffer() when the producer reads
+    // them out to CPU memory; meaningless for zero-copy producers.
+    virtual std::string PixelFormat() const { return "RGBA"; }
     virtual DisplayOutput OutputMode() const = 0;
 };
 
@@ -15,15 +15,297 @@
  *
  */
 
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+#include "ac/utils.h"
 #include "ac/video/bufferqueue.h"
 
+namespace {
+// Enough slots for several frames worth of buffers on any of our
+// renderer/encoder/sender handoffs
+static constexpr uint32_t kDefaultRingSlots = 256;
+}
+
 namespace ac {
 namespace video {
 
+namespace {
+// Lock-free single-producer/single-consumer ring. Producer and
+// consumer only share the two free-running indices; an eventfd per
+// side is written only when the other side actually parked, so the
+// steady state does neither locking nor syscalls.
+class SPSCBufferQueue : public BufferQueue {
+public:
+    SPSCBufferQueue(uint32_t capacity) :
+        BufferQueue(capacity),
+        capacity_(capacity),
+        slots_(capacity),
+        head_(0),
+        tail_(0),
+        consumer_parked_(false),
+        producer_parked_(false),
+        consumer_event_(::eventfd(0, EFD_CLOEXEC)),
+        producer_event_(::eventfd(0, EFD_CLOEXEC)) {
+    }
+
+    ~SPSCBufferQueue() {
+        if (consumer_event_ >= 0)
+            ::close(consumer_event_);
+        if (producer_event_ >= 0)
+            ::close(producer_event_);
+    }
+
+    void Lock() override { }
+
+    void Unlock() override { }
+
+    void Push(const ac::video::Buffer::Ptr &buffer) override {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+            ReportDrop();
+            return;
+        }
+
+        slots_[tail % capacity_] = buffer;
+        tail_.store(tail + 1, std::memory_order_release);
+
+        ReportDepth(tail + 1 - head_.load(std::memory_order_acquire));
+
+        WakeConsumerIfParked();
+    }
+
+    void PushUnlocked(const ac::video::Buffer::Ptr &buffer) override {
+        Push(buffer);
+    }
+
+    void Push(ac::video::Buffer::Ptr &&buffer) override {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+            ReportDrop();
+            return;
+        }
+
+        slots_[tail % capacity_] = std::move(buffer);
+        tail_.store(tail + 1, std::memory_order_release);
+
+        ReportDepth(tail + 1 - head_.load(std::memory_order_acquire));
+
+        WakeConsumerIfParked();
+    }
+
+    void PushUnlocked(ac::video::Buffer::Ptr &&buffer) override {
+        Push(std::move(buffer));
+    }
+
+    ac::video::Buffer::Ptr Front() override {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (tail_.load(std::memory_order_acquire) == head)
+            return nullptr;
+
+        return slots_[head % capacity_];
+    }
+
+    ac::video::Buffer::Ptr Pop() override {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (tail_.load(std::memory_order_acquire) == head)
+            return nullptr;
+
+        // Moving out of the slot drops our reference before the slot
+        // is published as free again
+        auto buffer = std::move(slots_[head % capacity_]);
+        head_.store(head + 1, std::memory_order_release);
+
+        WakeProducerIfParked();
+
+        return buffer;
+    }
+
+    ac::video::Buffer::Ptr PopUnlocked() override {
+        return Pop();
+    }
+
+    ac::video::Buffer::Ptr RemoveOldest() override {
+        // Pop already is non-blocking here; the SPSC invariant makes
+        // this consumer-thread only
+        return Pop();
+    }
+
+    void PushAll(const std::vector<ac::video::Buffer::Ptr> &buffers) override {
+        auto tail = tail_.load(std::memory_order_relaxed);
+
+        size_t pushed = 0;
+        for (const auto &buffer : buffers) {
+            if (tail - head_.load(std::memory_order_acquire) >= capacity_)
+                break;
+            slots_[tail % capacity_] = buffer;
+            tail++;
+            pushed++;
+        }
+
+        tail_.store(tail, std::memory_order_release);
+
+        for (auto i = pushed; i < buffers.size(); i++)
+            ReportDrop();
+        ReportDepth(tail - head_.load(std::memory_order_acquire));
+
+        WakeConsumerIfParked();
+    }
+
+    std::vector<ac::video::Buffer::Ptr> PopAll() override {
+        std::vector<ac::video::Buffer::Ptr> buffers;
+
+        auto head = head_.load(std::memory_order_relaxed);
+        const auto tail = tail_.load(std::memory_order_acquire);
+
+        while (head != tail) {
+            buffers.push_back(std::move(slots_[head % capacity_]));
+            head++;
+        }
+
+        head_.store(head, std::memory_order_release);
+
+        WakeProducerIfParked();
+
+        return buffers;
+    }
+
+    ac::video::Buffer::Ptr Next() override {
+        if (!WaitToBeFilled(std::chrono::milliseconds{-1}))
+            return nullptr;
+
+        return Pop();
+    }
+
+    bool WaitToBeFilled(const std::chrono::milliseconds &timeout) override {
+        if (!IsEmpty())
+            return true;
+
+        const auto start = HasReport() ? Utils::GetNowUs() : 0ll;
+
+        consumer_parked_.store(true, std::memory_order_release);
+        // Pairs with the fence in WakeConsumerIfParked(): without it
+        // the store above and the recheck below could be reordered
+        // against the producer's publish and lose the wakeup.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // Recheck after announcing the park; the producer might have
+        // pushed in between and skipped the wakeup.
+        while (IsEmpty()) {
+            if (!WaitOnEvent(consumer_event_, timeout))
+                break;
+        }
+
+        consumer_parked_.store(false, std::memory_order_release);
+
+        if (start)
+            ReportStall(start);
+
+        return !IsEmpty();
+    }
+
+    bool WaitForSlots(const std::chrono::milliseconds &timeout) override {
+        if (!IsFull())
+            return true;
+
+        const auto start = HasReport() ? Utils::GetNowUs() : 0ll;
+
+        producer_parked_.store(true, std::memory_order_release);
+        // Same ordering requirement as on the consumer side
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        while (IsFull()) {
+            if (!WaitOnEvent(producer_event_, timeout))
+                break;
+        }
+
+        producer_parked_.store(false, std::memory_order_release);
+
+        if (start)
+            ReportStall(start);
+
+        return !IsFull();
+    }
+
+    bool IsFull() override {
+        return tail_.load(std::memory_order_acquire) -
+               head_.load(std::memory_order_acquire) >= capacity_;
+    }
+
+    bool IsEmpty() override {
+        return tail_.load(std::memory_order_acquire) ==
+               head_.load(std::memory_order_acquire);
+    }
+
+    int Size() override {
+        return tail_.load(std::memory_order_acquire) -
+               head_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Pairs with the fences in WaitToBeFilled()/WaitForSlots():
+    // without it the slot publish above the call and the parked check
+    // below could be reordered against the waiter raising its flag
+    // and the wakeup would be lost until the next push or pop.
+    void WakeConsumerIfParked() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer_parked_.load(std::memory_order_relaxed))
+            Signal(consumer_event_);
+    }
+
+    void WakeProducerIfParked() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (producer_parked_.load(std::memory_order_relaxed))
+            Signal(producer_event_);
+    }
+
+    static void Signal(int fd) {
+        const uint64_t value = 1;
+        if (::write(fd, &value, sizeof(value)) < 0) { }
+    }
+
+    static bool WaitOnEvent(int fd, const std::chrono::milliseconds &timeout) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        const auto ret = ::poll(&pfd, 1, timeout.count() >= 0 ? timeout.count() : -1);
+        if (ret <= 0)
+            return false;
+
+        uint64_t value = 0;
+        if (::read(fd, &value, sizeof(value)) < 0) { }
+
+        return true;
+    }
+
+private:
+    const uint32_t capacity_;
+    std::vector<ac::video::Buffer::Ptr> slots_;
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    std::atomic<bool> consumer_parked_;
+    std::atomic<bool> producer_parked_;
+    int consumer_event_;
+    int producer_event_;
+};
+}
+
 BufferQueue::Ptr BufferQueue::Create(uint32_t max_size) {
     return std::shared_ptr<BufferQueue>(new BufferQueue(max_size));
 }
 
+BufferQueue::Ptr BufferQueue::CreateSPSC(uint32_t capacity) {
+    if (capacity == 0)
+        capacity = kDefaultRingSlots;
+    return std::make_shared<SPSCBufferQueue>(capacity);
+}
+
 BufferQueue::BufferQueue(uint32_t max_size) :
     max_size_(max_size) {
 }
@@ -37,6 +319,12 @@ void BufferQueue::Lock() {
 
 void BufferQueue::PushUnlocked(const ac::video::Buffer::Ptr &buffer) {
     queue_.push(buffer);
+    ReportDepth(queue_.size());
+}
+
+void BufferQueue::PushUnlocked(ac::video::Buffer::Ptr &&buffer) {
+    queue_.push(std::move(buffer));
+    ReportDepth(queue_.size());
 }
 
 void BufferQueue::Unlock() {
@@ -56,22 +344,36 @@ ac::video::Buffer::Ptr BufferQueue::Next() {
         return nullptr;
 
     std::unique_lock<std::mutex> l(mutex_);
-    auto buffer = queue_.front();
+    auto buffer = std::move(queue_.front());
     queue_.pop();
     return buffer;
 }
 
 void BufferQueue::Push(const ac::video::Buffer::Ptr &buffer) {
     std::unique_lock<std::mutex> l(mutex_);
-    if (IsLimited() && queue_.size() >= max_size_)
+    if (IsLimited() && queue_.size() >= max_size_) {
+        ReportDrop();
         return;
+    }
     queue_.push(buffer);
+    ReportDepth(queue_.size());
+    lock_.notify_one();
+}
+
+void BufferQueue::Push(ac::video::Buffer::Ptr &&buffer) {
+    std::unique_lock<std::mutex> l(mutex_);
+    if (IsLimited() && queue_.size() >= max_size_) {
+        ReportDrop();
+        return;
+    }
+    queue_.push(std::move(buffer));
+    ReportDepth(queue_.size());
     lock_.notify_one();
 }
 
 ac::video::Buffer::Ptr BufferQueue::Pop() {
     std::unique_lock<std::mutex> l(mutex_);
-    auto buffer = queue_.front();
+    auto buffer = std::move(queue_.front());
     queue_.pop();
     lock_.notify_one();
     return buffer;
@@ -81,11 +383,54 @@ ac::video::Buffer::Ptr BufferQueue::PopUnlocked() {
     if (queue_.size() == 0)
         return nullptr;
 
-    auto buffer = queue_.front();
+    auto buffer = std::move(queue_.front());
     queue_.pop();
     return buffer;
 }
 
+void BufferQueue::PushAll(const std::vector<ac::video::Buffer::Ptr> &buffers) {
+    if (buffers.empty())
+        return;
+
+    std::unique_lock<std::mutex> l(mutex_);
+    size_t pushed = 0;
+    for (const auto &buffer : buffers) {
+        if (IsLimited() && queue_.size() >= max_size_)
+            break;
+        queue_.push(buffer);
+        pushed++;
+    }
+    for (auto i = pushed; i < buffers.size(); i++)
+        ReportDrop();
+    ReportDepth(queue_.size());
+    lock_.notify_one();
+}
+
+std::vector<ac::video::Buffer::Ptr> BufferQueue::PopAll() {
+    std::vector<ac::video::Buffer::Ptr> buffers;
+
+    std::unique_lock<std::mutex> l(mutex_);
+    while (!queue_.empty()) {
+        buffers.push_back(std::move(queue_.front()));
+        queue_.pop();
+    }
+    lock_.notify_one();
+
+    return buffers;
+}
+
+ac::video::Buffer::Ptr BufferQueue::RemoveOldest() {
+    std::unique_lock<std::mutex> l(mutex_);
+    if (queue_.empty())
+        return nullptr;
+
+    auto buffer = std::move(queue_.front());
+    queue_.pop();
+    ReportDepth(queue_.size());
+    lock_.notify_one();
+    return buffer;
+}
+
 bool BufferQueue::WaitFor(const std::function<bool()> &pred, const std::chrono::milliseconds &timeout) {
     std::unique_lock<std::mutex> l(mutex_);
 
@@ -105,6 +450,13 @@ bool BufferQueue::WaitToBeFilled(const std::chrono::milliseconds &timeout) {
     if (IsFull())
         return true;
 
+    if (HasReport() && IsEmpty()) {
+        const auto start = Utils::GetNowUs();
+        const auto filled = WaitFor([&]() { return !queue_.empty(); }, timeout);
+        ReportStall(start);
+        return filled;
+    }
+
     return WaitFor([&]() { return !queue_.empty(); }, timeout);
 }
 
@@ -112,6 +464,13 @@ bool BufferQueue::WaitForSlots(const std::chrono::milliseconds &timeout) {
     if (!IsLimited())
         return true;
 
+    if (HasReport() && IsFull()) {
+        const auto start = Utils::GetNowUs();
+        const auto freed = WaitFor([&]() { return queue_.size() < max_size_; }, timeout);
+        ReportStall(start);
+        return freed;
+    }
+
     return WaitFor([&]() { return queue_.size() < max_size_; }, timeout);
 }
 
@@ -133,5 +492,32 @@ int BufferQueue::Size() {
     return queue_.size();
 }
 
+void BufferQueue::SetReport(const std::string &name, const BufferQueueReport::Ptr &report) {
+    name_ = name;
+    report_ = report;
+}
+
+void BufferQueue::ReportDepth(int depth) {
+    if (!report_ || depth <= high_water_)
+        return;
+
+    high_water_ = depth;
+    report_->HighWaterMark(name_, depth);
+}
+
+void BufferQueue::ReportDrop() {
+    if (!report_)
+        return;
+
+    report_->DroppedBuffer(name_);
+}
+
+void BufferQueue::ReportStall(const ac::TimestampUs &start) {
+    if (!report_)
+        return;
+
+    report_->Stalled(name_, ac::Utils::GetNowUs() - start);
+}
+
 } // namespace video
 } // namespace ac
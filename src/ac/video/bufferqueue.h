@@ -23,8 +23,10 @@
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <vector>
 
 #include "ac/video/buffer.h"
+#include "ac/video/bufferqueuereport.h"
 
 namespace ac {
 namespace video {
@@ -34,33 +36,66 @@ public:
     typedef std::shared_ptr<BufferQueue> Ptr;
 
     static Ptr Create(uint32_t max_size = 0);
+    // Creates a lock-free single-producer/single-consumer ring variant
+    // behind the same interface; only safe when exactly one thread
+    // pushes and exactly one thread pops. Always limited; a capacity
+    // of 0 selects a sensible default.
+    static Ptr CreateSPSC(uint32_t capacity = 0);
 
-    ~BufferQueue();
+    virtual ~BufferQueue();
 
-    ac::video::Buffer::Ptr Next();
-    ac::video::Buffer::Ptr Front();
+    virtual ac::video::Buffer::Ptr Next();
+    virtual ac::video::Buffer::Ptr Front();
 
-    void Lock();
-    void Unlock();
+    virtual void Lock();
+    virtual void Unlock();
 
-    void Push(const ac::video::Buffer::Ptr &buffer);
-    void PushUnlocked(const ac::video::Buffer::Ptr &buffer);
+    virtual void Push(const ac::video::Buffer::Ptr &buffer);
+    virtual void PushUnlocked(const ac::video::Buffer::Ptr &buffer);
 
-    ac::video::Buffer::Ptr Pop();
-    ac::video::Buffer::Ptr PopUnlocked();
+    // Move-in variants for producers done with their reference; the
+    // handoff then costs no refcount round trip. The pipeline queues
+    // move multiple buffers per frame so the atomics add up.
+    virtual void Push(ac::video::Buffer::Ptr &&buffer);
+    virtual void PushUnlocked(ac::video::Buffer::Ptr &&buffer);
 
-    bool WaitForSlots(const std::chrono::milliseconds &timeout = std::chrono::milliseconds{1});
-    bool WaitToBeFilled(const std::chrono::milliseconds &timeout = std::chrono::milliseconds{1});
+    virtual ac::video::Buffer::Ptr Pop();
+    virtual ac::video::Buffer::Ptr PopUnlocked();
+
+    // Batch variants taking the lock (or issuing the wakeup) only once
+    // for a whole run of buffers.
+    virtual void PushAll(const std::vector<ac::video::Buffer::Ptr> &buffers);
+    virtual std::vector<ac::video::Buffer::Ptr> PopAll();
+
+    // Removes and returns the oldest queued buffer without blocking;
+    // nullptr when the queue is empty. Drop policies use this to trade
+    // the oldest frame for bounded latency. On the SPSC variant this
+    // is only safe from the consumer thread, like Pop().
+    virtual ac::video::Buffer::Ptr RemoveOldest();
+
+    virtual bool WaitForSlots(const std::chrono::milliseconds &timeout = std::chrono::milliseconds{1});
+    virtual bool WaitToBeFilled(const std::chrono::milliseconds &timeout = std::chrono::milliseconds{1});
 
     bool IsLimited() const { return max_size_ != 0; }
-    bool IsFull();
-    bool IsEmpty();
+    virtual bool IsFull();
+    virtual bool IsEmpty();
 
-    int Size();
+    virtual int Size();
 
-private:
+    // Enables depth/stall/drop telemetry for this queue. Needs to be
+    // called before the queue is handed to its producer and consumer;
+    // without a report all instrumentation stays disabled.
+    void SetReport(const std::string &name, const BufferQueueReport::Ptr &report);
+
+protected:
     BufferQueue(uint32_t max_size);
 
+    bool HasReport() const { return !!report_; }
+    void ReportDepth(int depth);
+    void ReportDrop();
+    void ReportStall(const ac::TimestampUs &start);
+
+private:
     bool WaitFor(const std::function<bool()> &pred, const std::chrono::milliseconds &timeout);
 
 private:
@@ -68,6 +103,9 @@ private:
     std::queue<ac::video::Buffer::Ptr> queue_;
     std::mutex mutex_;
     std::condition_variable lock_;
+    std::string name_;
+    BufferQueueReport::Ptr report_;
+    int high_water_ = 0;
 };
 
 } // namespace video
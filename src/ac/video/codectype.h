@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_CODECTYPE_H_
+#define AC_VIDEO_CODECTYPE_H_
+
+#include <string>
+
+namespace ac {
+namespace video {
+
+// Video codec the pipeline carries from the encoder through the
+// packetizer; kept in its own header so the streaming layer does not
+// have to pull in the wds format types.
+enum class CodecType {
+    kH264,
+    kHEVC,
+};
+
+inline std::string CodecTypeToString(CodecType codec) {
+    switch (codec) {
+    case CodecType::kH264:
+        return "H.264";
+    case CodecType::kHEVC:
+        return "HEVC";
+    default:
+        break;
+    }
+    return "unknown";
+}
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "ac/video/damagetracker.h"
+
+namespace {
+// Sampling steps; dense enough to catch cursor movement and text
+// updates but only touches a fraction of the pixels.
+static constexpr unsigned int kRowStep{8};
+static constexpr unsigned int kColumnStep{64};
+
+// FNV-1a mixing
+static constexpr std::uint64_t kHashBasis{0xcbf29ce484222325ull};
+static constexpr std::uint64_t kHashPrime{0x100000001b3ull};
+} // namespace
+
+namespace ac {
+namespace video {
+
+bool DamageTracker::Update(const std::uint8_t *data, unsigned int width, unsigned int height,
+                           unsigned int stride, unsigned int bytes_per_pixel) {
+    std::array<std::uint64_t, kBands> row_hashes;
+    std::array<std::uint64_t, kBands> column_hashes;
+    row_hashes.fill(kHashBasis);
+    column_hashes.fill(kHashBasis);
+
+    const unsigned int line_size = width * bytes_per_pixel;
+
+    for (unsigned int y = 0; y < height; y += kRowStep) {
+        const std::uint8_t *line = data + y * stride;
+        auto &row_hash = row_hashes[y * kBands / height];
+        for (unsigned int x = 0; x < line_size; x += kColumnStep) {
+            row_hash = (row_hash ^ line[x]) * kHashPrime;
+            auto &column_hash = column_hashes[x * kBands / line_size];
+            column_hash = (column_hash ^ line[x]) * kHashPrime;
+        }
+    }
+
+    // First and last band which changed in each direction; their
+    // intersection bounds everything that moved.
+    unsigned int first_row = kBands, last_row = 0;
+    unsigned int first_column = kBands, last_column = 0;
+    for (unsigned int n = 0; n < kBands; n++) {
+        if (row_hashes[n] != row_hashes_[n]) {
+            first_row = std::min(first_row, n);
+            last_row = n;
+        }
+        if (column_hashes[n] != column_hashes_[n]) {
+            first_column = std::min(first_column, n);
+            last_column = n;
+        }
+    }
+
+    row_hashes_ = row_hashes;
+    column_hashes_ = column_hashes;
+
+    if (!primed_) {
+        // Nothing to compare the first frame against
+        primed_ = true;
+        region_ = Rect{0, 0, width, height};
+        return true;
+    }
+
+    if (first_row == kBands && first_column == kBands) {
+        region_ = Rect{};
+        return false;
+    }
+
+    // A change only one direction noticed (possible since rows and
+    // columns sample different positions) still spans the full extent
+    // of the other.
+    if (first_row == kBands) {
+        first_row = 0;
+        last_row = kBands - 1;
+    }
+    if (first_column == kBands) {
+        first_column = 0;
+        last_column = kBands - 1;
+    }
+
+    // Column bands count bytes within a line, which map linearly onto
+    // pixels; band boundaries get rounded outwards.
+    const auto left = first_column * width / kBands;
+    const auto right = std::min(((last_column + 1) * width + kBands - 1) / kBands, width);
+    const auto top = first_row * height / kBands;
+    const auto bottom = std::min(((last_row + 1) * height + kBands - 1) / kBands, height);
+
+    region_ = Rect{left, top, right - left, bottom - top};
+
+    return true;
+}
+
+} // namespace video
+} // namespace ac
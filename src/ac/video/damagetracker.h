@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_DAMAGETRACKER_H_
+#define AC_VIDEO_DAMAGETRACKER_H_
+
+#include <array>
+#include <cstdint>
+
+#include "ac/video/rect.h"
+
+namespace ac {
+namespace video {
+
+// Tells whether and roughly where a frame changed against the previous
+// one by hashing a sparse sample of the pixels into per-band hashes,
+// one set across the rows and one across the columns. A changed band
+// pins the change to a stripe; the intersection of the changed row and
+// column stripes gives a coarse bounding box without ever touching
+// more than a fraction of the pixels.
+class DamageTracker {
+public:
+    // Granularity of the bounding box in both directions; 16 bands
+    // keep the per-frame state at two cache lines.
+    static constexpr unsigned int kBands{16};
+
+    // Feeds the next frame and returns whether it differs from the
+    // previous one. The first frame always counts as fully damaged.
+    bool Update(const std::uint8_t *data, unsigned int width, unsigned int height,
+                unsigned int stride, unsigned int bytes_per_pixel);
+
+    // Bounding box of the change found by the last Update() in pixel
+    // coordinates of the frame, band-granular; empty when the frame
+    // did not change.
+    Rect LastDamageRegion() const { return region_; }
+
+private:
+    std::array<std::uint64_t, kBands> row_hashes_{};
+    std::array<std::uint64_t, kBands> column_hashes_{};
+    Rect region_;
+    bool primed_ = false;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
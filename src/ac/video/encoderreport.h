@@ -34,7 +34,7 @@ public:
     virtual void Started() = 0;
     virtual void Stopped() = 0;
     virtual void BeganFrame(const ac::TimestampUs &timestamp) = 0;
-    virtual void FinishedFrame(const ac::TimestampUs &timestamp) = 0;
+    virtual void FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id = 0) = 0;
     virtual void ReceivedInputBuffer(const ac::TimestampUs &timestamp) = 0;
 };
 
@@ -28,6 +28,71 @@ enum {
     kNalTypeSPS = 7,
     kNalTypePPS = 8,
 };
+
+// HEVC NAL unit types; VCL types occupy 0..31 with the intra random
+// access pictures (BLA/IDR/CRA) at 16..21 and the two IDR types in
+// the middle of that range.
+enum {
+    kHevcNalTypeVclLast = 31,
+    kHevcNalTypeIrapFirst = 16,
+    kHevcNalTypeIrapLast = 21,
+    kHevcNalTypeIDRWithRADL = 19,
+    kHevcNalTypeIDRNoLeading = 20,
+    kHevcNalTypeVPS = 32,
+    kHevcNalTypeSPS = 33,
+    kHevcNalTypePPS = 34,
+};
+
+// Reads the slice_type of a coded slice NAL unit. Only the two leading
+// Exp-Golomb fields of the slice header are consumed; emulation
+// prevention bytes are stripped along the way.
+bool ParseSliceType(const uint8_t *data, size_t size, unsigned int *slice_type) {
+    uint8_t bytes[8];
+    size_t count = 0;
+    unsigned int zeros = 0;
+
+    for (size_t n = 0; n < size && count < sizeof(bytes); n++) {
+        if (zeros >= 2 && data[n] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        zeros = data[n] == 0x00 ? zeros + 1 : 0;
+        bytes[count++] = data[n];
+    }
+
+    size_t bit = 0;
+    const size_t total = count * 8;
+
+    auto read_ue = [&](unsigned int *value) {
+        unsigned int leading_zeros = 0;
+        while (bit < total && !(bytes[bit / 8] & (0x80 >> (bit % 8)))) {
+            leading_zeros++;
+            bit++;
+        }
+        if (bit + leading_zeros + 1 > total)
+            return false;
+        bit++;
+
+        unsigned int suffix = 0;
+        for (unsigned int n = 0; n < leading_zeros; n++) {
+            suffix = (suffix << 1) |
+                ((bytes[bit / 8] >> (7 - bit % 8)) & 0x1);
+            bit++;
+        }
+
+        *value = (1u << leading_zeros) - 1 + suffix;
+        return true;
+    };
+
+    unsigned int first_mb_in_slice = 0;
+    return read_ue(&first_mb_in_slice) && read_ue(slice_type);
+}
+
+// Start codes consist of at least two 0x00 bytes followed by 0x01
+bool PrecededByStartCode(const uint8_t *data, size_t offset) {
+    return offset >= 3 && data[offset - 1] == 0x01
+        && data[offset - 2] == 0x00 && data[offset - 3] == 0x00;
+}
 }
 
 namespace ac {
@@ -66,8 +131,46 @@ std::ostream& operator<<(std::ostream& out, const H264Analyzer::Result &rhs) {
                << " pps " << rhs.pps;
 }
 
-H264Analyzer::H264Analyzer(bool collect_statistics) :
-    collect_statistics_(collect_statistics) {
+H264Analyzer::Classification::Classification() :
+    frame_type(kFrameTypeUnknown),
+    has_sps(false),
+    has_pps(false) {
+}
+
+H264Analyzer::H264Analyzer(bool collect_statistics, CodecType codec) :
+    codec_(codec),
+    collect_statistics_(collect_statistics),
+    last_slice_offset_(0) {
+}
+
+unsigned int H264Analyzer::NalType(uint8_t header) const {
+    // HEVC keeps the type in the upper six bits of a two byte header;
+    // H.264 in the lower five bits of its single header byte.
+    return codec_ == CodecType::kHEVC ? (header >> 1) & 0x3f : header & 0x1f;
+}
+
+bool H264Analyzer::IsSliceNal(unsigned int type) const {
+    if (codec_ == CodecType::kHEVC)
+        return type <= kHevcNalTypeVclLast;
+    return type == kNalTypeSlice || type == kNalTypeIDR;
+}
+
+bool H264Analyzer::IsIDRNal(unsigned int type) const {
+    if (codec_ == CodecType::kHEVC)
+        return type == kHevcNalTypeIDRWithRADL || type == kHevcNalTypeIDRNoLeading;
+    return type == kNalTypeIDR;
+}
+
+bool H264Analyzer::IsSPSNal(unsigned int type) const {
+    if (codec_ == CodecType::kHEVC)
+        return type == kHevcNalTypeSPS;
+    return type == kNalTypeSPS;
+}
+
+bool H264Analyzer::IsPPSNal(unsigned int type) const {
+    if (codec_ == CodecType::kHEVC)
+        return type == kHevcNalTypePPS;
+    return type == kNalTypePPS;
 }
 
 H264Analyzer::~H264Analyzer() {
@@ -79,26 +182,18 @@ H264Analyzer::Result H264Analyzer::Process(const uint8_t *data, size_t size) {
     Result result;
 
     while (GetNextNALUnit(&data, &size, &nal_start, &nal_size, true)) {
-        unsigned nal_type = nal_start[0] & 0x1f;
+        const auto nal_type = NalType(nal_start[0]);
 
         result.units++;
 
-        switch (nal_type) {
-        case kNalTypeSlice:
-            result.slices++;
-            break;
-        case kNalTypeIDR:
+        if (IsIDRNal(nal_type))
             result.idr_frames++;
-            break;
-        case kNalTypeSPS:
+        else if (IsSliceNal(nal_type))
+            result.slices++;
+        else if (IsSPSNal(nal_type))
             result.sps++;
-            break;
-        case kNalTypePPS:
+        else if (IsPPSNal(nal_type))
             result.pps++;
-            break;
-        default:
-            break;
-        }
     }
 
     if (collect_statistics_)
@@ -107,6 +202,107 @@ H264Analyzer::Result H264Analyzer::Process(const uint8_t *data, size_t size) {
     return result;
 }
 
+H264Analyzer::Classification H264Analyzer::Classify(const uint8_t *data, size_t size) {
+    Classification classification;
+
+    // Fast path: when the access unit leads with the very same NAL
+    // layout as the previous one we can skip the scan and jump
+    // directly to the slice header.
+    if (last_slice_offset_ > 0 && last_slice_offset_ < size
+            && PrecededByStartCode(data, last_slice_offset_)) {
+        bool matches = true;
+
+        for (const auto &nal : last_prefix_) {
+            if (nal.offset >= size
+                    || NalType(data[nal.offset]) != nal.type
+                    || !PrecededByStartCode(data, nal.offset)) {
+                matches = false;
+                break;
+            }
+        }
+
+        const auto nal_type = NalType(data[last_slice_offset_]);
+
+        if (matches && IsSliceNal(nal_type)) {
+            for (const auto &nal : last_prefix_) {
+                if (IsSPSNal(nal.type))
+                    classification.has_sps = true;
+                else if (IsPPSNal(nal.type))
+                    classification.has_pps = true;
+            }
+
+            ClassifySlice(data, size, last_slice_offset_, &classification);
+            return classification;
+        }
+    }
+
+    last_prefix_.clear();
+    last_slice_offset_ = 0;
+
+    const uint8_t *remaining = data;
+    size_t remaining_size = size;
+    const uint8_t *nal_start = nullptr;
+    size_t nal_size = 0;
+
+    while (GetNextNALUnit(&remaining, &remaining_size, &nal_start, &nal_size, true)) {
+        const auto offset = static_cast<size_t>(nal_start - data);
+        const auto nal_type = NalType(nal_start[0]);
+
+        if (IsSliceNal(nal_type)) {
+            // Parameter sets have to precede the first coded slice of
+            // an access unit so there is nothing left to learn here.
+            last_slice_offset_ = offset;
+            ClassifySlice(data, size, offset, &classification);
+            return classification;
+        }
+
+        if (IsSPSNal(nal_type))
+            classification.has_sps = true;
+        else if (IsPPSNal(nal_type))
+            classification.has_pps = true;
+
+        last_prefix_.push_back(PrefixNAL{offset, nal_type});
+    }
+
+    // Without a slice there is no layout worth reusing
+    last_prefix_.clear();
+
+    return classification;
+}
+
+void H264Analyzer::ClassifySlice(const uint8_t *data, size_t size, size_t offset,
+                                 Classification *classification) const {
+    const auto nal_type = NalType(data[offset]);
+
+    if (IsIDRNal(nal_type)) {
+        classification->frame_type = kFrameTypeIDR;
+        return;
+    }
+
+    if (codec_ == CodecType::kHEVC) {
+        // The remaining IRAP types (BLA/CRA) decode without references
+        // like an I frame; everything below the IRAP range is inter
+        // predicted. The HEVC slice header layout differs from the
+        // H.264 Exp-Golomb parse below, so the NAL type is all we
+        // classify by.
+        classification->frame_type =
+                (nal_type >= kHevcNalTypeIrapFirst && nal_type <= kHevcNalTypeIrapLast)
+                    ? kFrameTypeI : kFrameTypeP;
+        return;
+    }
+
+    unsigned int slice_type = 0;
+    if (!ParseSliceType(data + offset + 1, size - offset - 1, &slice_type))
+        return;
+
+    // 2/7 are I and 4/9 SI slices; everything else is inter predicted
+    // and treated as P here.
+    if (slice_type % 5 == 2 || slice_type % 5 == 4)
+        classification->frame_type = kFrameTypeI;
+    else
+        classification->frame_type = kFrameTypeP;
+}
+
 H264Analyzer::Result H264Analyzer::Statistics() const {
     return statistics_;
 }
@@ -20,10 +20,16 @@
 
 #include <memory>
 #include <stdint.h>
+#include <vector>
+
+#include "ac/video/codectype.h"
 
 namespace ac {
 namespace video {
 
+// Despite the name the analyzer also handles HEVC access units when
+// constructed for them; the NAL framing is shared between the two
+// codecs and only header layout and type values differ.
 class H264Analyzer {
 public:
     class Result {
@@ -40,16 +46,61 @@ public:
         Result& operator+=(const Result& rhs);
     };
 
-    H264Analyzer(bool collect_stats = false);
+    enum FrameType {
+        kFrameTypeUnknown,
+        kFrameTypeIDR,
+        kFrameTypeI,
+        kFrameTypeP,
+    };
+
+    class Classification {
+    public:
+        Classification();
+
+        FrameType frame_type;
+        bool has_sps;
+        bool has_pps;
+    };
+
+    H264Analyzer(bool collect_stats = false, CodecType codec = CodecType::kH264);
     ~H264Analyzer();
 
     Result Process(const uint8_t *data, size_t size);
 
+    // Incrementally classifies an access unit and stops scanning as
+    // soon as the frame type and SPS/PPS presence are known, which is
+    // at the first coded slice: the spec requires parameter sets to
+    // precede the first VCL NAL unit of an access unit. When the unit
+    // leads with the same NAL layout as the previous one the scan is
+    // skipped entirely and we go straight to the slice header.
+    Classification Classify(const uint8_t *data, size_t size);
+
     Result Statistics() const;
 
 private:
+    struct PrefixNAL {
+        size_t offset;
+        unsigned int type;
+    };
+
+private:
+    void ClassifySlice(const uint8_t *data, size_t size, size_t offset,
+                       Classification *classification) const;
+
+    unsigned int NalType(uint8_t header) const;
+    bool IsSliceNal(unsigned int type) const;
+    bool IsIDRNal(unsigned int type) const;
+    bool IsSPSNal(unsigned int type) const;
+    bool IsPPSNal(unsigned int type) const;
+
+private:
+    CodecType codec_;
     bool collect_statistics_;
     Result statistics_;
+    // Leading non-VCL NAL layout of the previously classified access
+    // unit together with the offset of its first slice NAL unit
+    std::vector<PrefixNAL> last_prefix_;
+    size_t last_slice_offset_;
 };
 
 std::ostream& operator<<(std::ostream& out, const H264Analyzer::Result &rhs);
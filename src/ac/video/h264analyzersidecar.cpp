@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/report/metrics/metricsregistry.h"
+
+#include "ac/video/h264analyzersidecar.h"
+
+namespace {
+constexpr const char *kSidecarThreadName{"H264AnalyzerSidecar"};
+// One in this many access units gets the full bitstream scan
+constexpr std::uint64_t kSampleInterval{32};
+// Sampled units waiting for the pool; holding encoder output buffers
+// for long delays their return to the producer, so keep this small
+// and drop samples when the pool falls behind.
+constexpr std::uint32_t kMaxQueuedSamples{8};
+}
+
+namespace ac {
+namespace video {
+
+H264AnalyzerSidecar::Ptr H264AnalyzerSidecar::Create() {
+    return std::shared_ptr<H264AnalyzerSidecar>(new H264AnalyzerSidecar);
+}
+
+H264AnalyzerSidecar::H264AnalyzerSidecar() :
+    queue_(ac::video::BufferQueue::Create(kMaxQueuedSamples)),
+    analyzer_(true),
+    submitted_(0) {
+}
+
+H264AnalyzerSidecar::~H264AnalyzerSidecar() {
+}
+
+int H264AnalyzerSidecar::PeekFirstNALType(const std::uint8_t *data, std::size_t size) {
+    if (size >= 4 && data[0] == 0x00 && data[1] == 0x00
+            && data[2] == 0x00 && data[3] == 0x01)
+        return size >= 5 ? data[4] & 0x1f : -1;
+
+    if (size >= 3 && data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x01)
+        return size >= 4 ? data[3] & 0x1f : -1;
+
+    return -1;
+}
+
+void H264AnalyzerSidecar::Submit(const ac::video::Buffer::Ptr &buffer) {
+    if (!buffer || !buffer->Length())
+        return;
+
+    auto &registry = report::metrics::MetricsRegistry::Instance();
+
+    // The cheap inline part: nothing past the first NAL header
+    switch (PeekFirstNALType(buffer->Data(), buffer->Length())) {
+    case 5: // IDR slice
+        registry.Increment("bitstream_keyframes");
+        break;
+    case 7: // SPS; codecs lead IDR access units with the parameter sets
+        registry.Increment("bitstream_parameter_set_units");
+        break;
+    default:
+        break;
+    }
+
+    if (++submitted_ % kSampleInterval != 0)
+        return;
+
+    if (queue_->IsFull()) {
+        registry.Increment("bitstream_samples_dropped");
+        return;
+    }
+
+    queue_->Push(buffer);
+}
+
+bool H264AnalyzerSidecar::Start() {
+    return true;
+}
+
+bool H264AnalyzerSidecar::Stop() {
+    return true;
+}
+
+bool H264AnalyzerSidecar::Execute() {
+    if (!queue_->WaitToBeFilled())
+        return true;
+
+    auto &registry = report::metrics::MetricsRegistry::Instance();
+
+    for (const auto &buffer : queue_->PopAll()) {
+        const auto result = analyzer_.Process(buffer->Data(), buffer->Length());
+
+        registry.Increment("bitstream_sampled_frames");
+        registry.Increment("bitstream_sampled_units", result.units);
+        registry.Increment("bitstream_sampled_slices", result.slices);
+        registry.Increment("bitstream_sampled_idr_frames", result.idr_frames);
+        registry.Increment("bitstream_sampled_sps", result.sps);
+        registry.Increment("bitstream_sampled_pps", result.pps);
+    }
+
+    return true;
+}
+
+std::string H264AnalyzerSidecar::Name() const {
+    return kSidecarThreadName;
+}
+
+} // namespace video
+} // namespace ac
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_H264ANALYZERSIDECAR_H_
+#define AC_VIDEO_H264ANALYZERSIDECAR_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "ac/common/executable.h"
+
+#include "ac/video/buffer.h"
+#include "ac/video/bufferqueue.h"
+#include "ac/video/h264analyzer.h"
+
+namespace ac {
+namespace video {
+
+// Keeps bitstream inspection off the encoder delivery path. Submit()
+// only peeks at the first NAL header to count keyframes and hands
+// every kSampleInterval'th access unit to a queue; the full
+// H264Analyzer scan then runs whenever an executor (typically the
+// shared work stealing pool) gets around to it. Everything lands as
+// counters in the MetricsRegistry, so frame delivery never waits for
+// classification but the statistical picture stays available.
+class H264AnalyzerSidecar : public ac::common::Executable {
+public:
+    typedef std::shared_ptr<H264AnalyzerSidecar> Ptr;
+
+    static Ptr Create();
+
+    ~H264AnalyzerSidecar();
+
+    // Called on the delivery path with every encoded access unit
+    void Submit(const ac::video::Buffer::Ptr &buffer);
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+
+private:
+    H264AnalyzerSidecar();
+
+    // Type of the first NAL unit or a negative value when the buffer
+    // doesn't lead with a start code
+    static int PeekFirstNALType(const std::uint8_t *data, std::size_t size);
+
+private:
+    ac::video::BufferQueue::Ptr queue_;
+    H264Analyzer analyzer_;
+    std::uint64_t submitted_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
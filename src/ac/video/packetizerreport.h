@@ -31,7 +31,7 @@ class PacketizerReport : public ac::NonCopyable {
 public:
     typedef std::shared_ptr<PacketizerReport> Ptr;
 
-    virtual void PacketizedFrame(const ac::TimestampUs &timestamp) = 0;
+    virtual void PacketizedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id = 0) = 0;
 };
 
 } // namespace video
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "ac/video/qualitymetrics.h"
+
+namespace {
+static constexpr unsigned int kBytesPerPixel{4};
+// PSNR diverges for a zero error; a frame the codec reproduced
+// bit-exactly is reported at this cap instead.
+static constexpr double kIdenticalFramePSNR{100.};
+// The usual SSIM stabilizers, (K * dynamic range)^2 with K1 = 0.01
+// and K2 = 0.03 over 8 bit samples.
+static constexpr double kSSIMC1{6.5025};
+static constexpr double kSSIMC2{58.5225};
+// Non-overlapping windows instead of the sliding original; the score
+// is for trend lines across benchmark runs, not for per-pixel damage
+// maps, and this keeps the pass linear in the frame size.
+static constexpr unsigned int kSSIMWindowSize{8};
+
+// Integer BT.601 luma from an RGBX pixel
+static inline uint8_t Luma(const uint8_t *pixel) {
+    return static_cast<uint8_t>(
+        (299u * pixel[0] + 587u * pixel[1] + 114u * pixel[2]) / 1000u);
+}
+}
+
+namespace ac {
+namespace video {
+
+QualityScore CompareFrames(const uint8_t *reference, const uint8_t *distorted,
+                           unsigned int width, unsigned int height) {
+    QualityScore score;
+
+    if (!reference || !distorted || width == 0 || height == 0)
+        return score;
+
+    const auto pixel_count = width * height;
+
+    std::vector<uint8_t> reference_luma(pixel_count);
+    std::vector<uint8_t> distorted_luma(pixel_count);
+    for (unsigned int n = 0; n < pixel_count; n++) {
+        reference_luma[n] = Luma(reference + n * kBytesPerPixel);
+        distorted_luma[n] = Luma(distorted + n * kBytesPerPixel);
+    }
+
+    double squared_error = 0.;
+    for (unsigned int n = 0; n < pixel_count; n++) {
+        const double delta = static_cast<double>(reference_luma[n])
+                - static_cast<double>(distorted_luma[n]);
+        squared_error += delta * delta;
+    }
+
+    const double mse = squared_error / pixel_count;
+    score.psnr = mse > 0.
+            ? std::min(kIdenticalFramePSNR, 10. * std::log10(255. * 255. / mse))
+            : kIdenticalFramePSNR;
+
+    // Mean SSIM over the whole windows; a partial edge window would
+    // just repeat its neighbour's verdict at a different weight.
+    double ssim_sum = 0.;
+    unsigned int windows = 0;
+
+    for (unsigned int wy = 0; wy + kSSIMWindowSize <= height; wy += kSSIMWindowSize) {
+        for (unsigned int wx = 0; wx + kSSIMWindowSize <= width; wx += kSSIMWindowSize) {
+            double sum_x = 0., sum_y = 0.;
+            double sum_xx = 0., sum_yy = 0., sum_xy = 0.;
+
+            for (unsigned int y = wy; y < wy + kSSIMWindowSize; y++) {
+                for (unsigned int x = wx; x < wx + kSSIMWindowSize; x++) {
+                    const double vx = reference_luma[y * width + x];
+                    const double vy = distorted_luma[y * width + x];
+                    sum_x += vx;
+                    sum_y += vy;
+                    sum_xx += vx * vx;
+                    sum_yy += vy * vy;
+                    sum_xy += vx * vy;
+                }
+            }
+
+            const double samples = kSSIMWindowSize * kSSIMWindowSize;
+            const double mean_x = sum_x / samples;
+            const double mean_y = sum_y / samples;
+            const double var_x = sum_xx / samples - mean_x * mean_x;
+            const double var_y = sum_yy / samples - mean_y * mean_y;
+            const double covariance = sum_xy / samples - mean_x * mean_y;
+
+            ssim_sum += ((2. * mean_x * mean_y + kSSIMC1)
+                         * (2. * covariance + kSSIMC2))
+                    / ((mean_x * mean_x + mean_y * mean_y + kSSIMC1)
+                       * (var_x + var_y + kSSIMC2));
+            windows++;
+        }
+    }
+
+    if (windows > 0)
+        score.ssim = ssim_sum / windows;
+
+    return score;
+}
+
+} // video
+} // ac
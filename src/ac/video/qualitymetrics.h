@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_QUALITYMETRICS_H_
+#define AC_VIDEO_QUALITYMETRICS_H_
+
+#include <cstdint>
+
+namespace ac {
+namespace video {
+
+struct QualityScore {
+    // Peak signal-to-noise ratio in dB, capped for identical frames
+    double psnr = 0.;
+    // Structural similarity in [0, 1]
+    double ssim = 1.;
+};
+
+// Scores a decoded frame against the source it was encoded from. Both
+// frames are RGBX at the given mode; the metrics are computed on the
+// luma plane, which is where the encoders spend their bits and where
+// compression damage shows first.
+QualityScore CompareFrames(const uint8_t *reference, const uint8_t *distorted,
+                           unsigned int width, unsigned int height);
+
+} // video
+} // ac
+
+#endif
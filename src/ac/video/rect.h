@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_RECT_H_
+#define AC_VIDEO_RECT_H_
+
+namespace ac {
+namespace video {
+
+// Axis-aligned pixel rectangle; an empty one carries no information
+// and callers have to fall back to whole-frame semantics.
+struct Rect {
+    unsigned int x{0};
+    unsigned int y{0};
+    unsigned int width{0};
+    unsigned int height{0};
+
+    bool Empty() const { return width == 0 || height == 0; }
+    unsigned int Area() const { return width * height; }
+
+    bool operator==(const Rect &other) const {
+        return x == other.x && y == other.y &&
+                width == other.width && height == other.height;
+    }
+    bool operator!=(const Rect &other) const { return !(*this == other); }
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -32,7 +32,9 @@ public:
     typedef std::shared_ptr<RendererReport> Ptr;
 
     virtual void BeganFrame() = 0;
-    virtual void FinishedFrame(const ac::TimestampUs &timestamp) = 0;
+    virtual void FinishedFrame(const ac::TimestampUs &timestamp, const ac::FrameId &frame_id = 0) = 0;
+    virtual void MissedFrameDeadline(const ac::TimestampUs &deadline) = 0;
+    virtual void DroppedFrame(const ac::TimestampUs &timestamp) = 0;
 };
 
 } // namespace video
@@ -31,7 +31,7 @@ class SenderReport : public ac::NonCopyable {
 public:
     typedef std::shared_ptr<SenderReport> Ptr;
 
-    virtual void SentPacket(const ac::TimestampUs &timestamp, const size_t &size) = 0;
+    virtual void SentPacket(const ac::TimestampUs &timestamp, const size_t &size, const ac::FrameId &frame_id = 0) = 0;
 };
 
 } // namespace video
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <memory.h>
+
+#include "ac/video/snapshottap.h"
+
+namespace {
+static constexpr std::uint32_t kBytesPerPixel{4};
+}
+
+namespace ac {
+namespace video {
+
+SnapshotTap& SnapshotTap::Instance() {
+    static SnapshotTap instance;
+    return instance;
+}
+
+bool SnapshotTap::Requested() const {
+    return requested_.load(std::memory_order_relaxed);
+}
+
+void SnapshotTap::Publish(const std::uint8_t *pixels, std::uint32_t width,
+                          std::uint32_t height, const std::string &format) {
+    std::unique_lock<std::mutex> l(mutex_);
+
+    if (!requested_.load(std::memory_order_relaxed))
+        return;
+
+    pending_.width = width;
+    pending_.height = height;
+    pending_.format = format;
+    pending_.data.resize(width * height * kBytesPerPixel);
+    ::memcpy(pending_.data.data(), pixels, pending_.data.size());
+
+    have_image_ = true;
+    requested_.store(false, std::memory_order_relaxed);
+    delivered_.notify_all();
+}
+
+void SnapshotTap::MarkUnavailable() {
+    std::unique_lock<std::mutex> l(mutex_);
+
+    if (!requested_.load(std::memory_order_relaxed))
+        return;
+
+    unavailable_ = true;
+    requested_.store(false, std::memory_order_relaxed);
+    delivered_.notify_all();
+}
+
+bool SnapshotTap::Take(std::uint32_t max_width, Image *image,
+                       const std::chrono::milliseconds &timeout) {
+    if (!image)
+        return false;
+
+    std::unique_lock<std::mutex> l(mutex_);
+
+    have_image_ = false;
+    unavailable_ = false;
+    requested_.store(true, std::memory_order_relaxed);
+
+    delivered_.wait_for(l, timeout, [this]() {
+        return have_image_ || unavailable_;
+    });
+
+    // Nothing capturing right now, or no CPU pixels on this path
+    requested_.store(false, std::memory_order_relaxed);
+    if (!have_image_)
+        return false;
+
+    *image = Downscale(pending_, max_width);
+    pending_ = Image{};
+
+    return true;
+}
+
+SnapshotTap::Image SnapshotTap::Downscale(const Image &image, std::uint32_t max_width) {
+    if (max_width == 0 || image.width <= max_width)
+        return image;
+
+    // Integer box filter: averaging factor*factor source pixels per
+    // output pixel is plenty for a thumbnail and keeps this a simple
+    // single pass.
+    const auto factor = (image.width + max_width - 1) / max_width;
+    const auto out_width = image.width / factor;
+    const auto out_height = image.height / factor;
+
+    Image out;
+    out.width = out_width;
+    out.height = out_height;
+    out.format = image.format;
+    out.data.resize(out_width * out_height * kBytesPerPixel);
+
+    for (std::uint32_t y = 0; y < out_height; y++) {
+        for (std::uint32_t x = 0; x < out_width; x++) {
+            std::uint32_t sum[kBytesPerPixel] = {0, 0, 0, 0};
+
+            for (std::uint32_t sy = 0; sy < factor; sy++) {
+                const auto row = (y * factor + sy) * image.width;
+                for (std::uint32_t sx = 0; sx < factor; sx++) {
+                    const auto src = (row + x * factor + sx) * kBytesPerPixel;
+                    for (std::uint32_t c = 0; c < kBytesPerPixel; c++)
+                        sum[c] += image.data[src + c];
+                }
+            }
+
+            const auto dst = (y * out_width + x) * kBytesPerPixel;
+            for (std::uint32_t c = 0; c < kBytesPerPixel; c++)
+                out.data[dst + c] = sum[c] / (factor * factor);
+        }
+    }
+
+    return out;
+}
+
+} // namespace video
+} // namespace ac
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_SNAPSHOTTAP_H_
+#define AC_VIDEO_SNAPSHOTTAP_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace video {
+
+// Serves "what's being cast" previews from the very same readout the
+// encoder consumes, so a UI thumbnail never costs a second screencast.
+//
+// The D-Bus side arms a request and waits; the capture loop checks the
+// flag once per frame (a single relaxed atomic load while nobody is
+// waiting) and publishes a copy of the current readout. Downscaling
+// happens on the waiting caller's thread, never in the capture loop.
+// Zero-copy capture paths have no CPU pixels to hand out and mark the
+// request unavailable instead.
+class SnapshotTap : public ac::NonCopyable {
+public:
+    struct Image {
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        // Named like BufferProducer::PixelFormat() reports it
+        // ("RGBA", "BGRA", ...); always 4 bytes per pixel
+        std::string format;
+        std::vector<std::uint8_t> data;
+    };
+
+    static SnapshotTap& Instance();
+
+    // Capture side; cheap while no request is armed
+    bool Requested() const;
+    void Publish(const std::uint8_t *pixels, std::uint32_t width,
+                 std::uint32_t height, const std::string &format);
+    void MarkUnavailable();
+
+    // Arms a request and waits for the capture loop to serve it; the
+    // result is box-downscaled until its width fits max_width (0 keeps
+    // the full size). False when nothing is capturing within the
+    // timeout or the capture path has no CPU pixels.
+    bool Take(std::uint32_t max_width, Image *image,
+              const std::chrono::milliseconds &timeout = std::chrono::milliseconds{250});
+
+private:
+    SnapshotTap() = default;
+
+    static Image Downscale(const Image &image, std::uint32_t max_width);
+
+private:
+    std::atomic<bool> requested_{false};
+    std::mutex mutex_;
+    std::condition_variable delivered_;
+    Image pending_;
+    bool have_image_ = false;
+    bool unavailable_ = false;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "ac/logger.h"
+#include "ac/utils.h"
+
+#include "ac/common/clock.h"
+
+#include "ac/video/syntheticbufferproducer.h"
+
+namespace {
+// "WxH@FPS" override for the mode negotiated with the sink, e.g.
+// "1920x1080@60"; the rate part is optional.
+constexpr const char *kModeEnvName{"AETHERCAST_SYNTHETIC_MODE"};
+// One of "bars" (default), "noise", "static"
+constexpr const char *kPatternEnvName{"AETHERCAST_SYNTHETIC_PATTERN"};
+// Path to a raw RGBX frame dump to loop; setting it selects the
+// replay pattern.
+constexpr const char *kReplayEnvName{"AETHERCAST_SYNTHETIC_REPLAY"};
+constexpr unsigned int kBytesPerPixel{4};
+
+// R/G/B values of the classic 75% color bars; the X byte stays 0.
+constexpr uint8_t kBarColors[][3] = {
+    {191, 191, 191},  // white
+    {191, 191, 0},    // yellow
+    {0, 191, 191},    // cyan
+    {0, 191, 0},      // green
+    {191, 0, 191},    // magenta
+    {191, 0, 0},      // red
+    {0, 0, 191},      // blue
+    {0, 0, 0},        // black
+};
+constexpr unsigned int kBarCount{8};
+}
+
+namespace ac {
+namespace video {
+
+BufferProducer::Ptr SyntheticBufferProducer::Create() {
+    Config config;
+
+    const auto mode = Utils::GetEnvValue(kModeEnvName);
+    if (mode.length() > 0 &&
+            ::sscanf(mode.c_str(), "%ux%u@%lf", &config.width,
+                     &config.height, &config.refresh_rate) < 2)
+        AC_WARNING("Ignoring invalid synthetic mode '%s'", mode);
+
+    const auto pattern = Utils::GetEnvValue(kPatternEnvName);
+    if (pattern == "noise")
+        config.pattern = Pattern::kNoise;
+    else if (pattern == "static")
+        config.pattern = Pattern::kStatic;
+    else if (pattern.length() > 0 && pattern != "bars")
+        AC_WARNING("Ignoring unknown synthetic pattern '%s'", pattern);
+
+    config.replay_path = Utils::GetEnvValue(kReplayEnvName);
+    if (config.replay_path.length() > 0)
+        config.pattern = Pattern::kReplay;
+
+    return Create(config);
+}
+
+BufferProducer::Ptr SyntheticBufferProducer::Create(const Config &config) {
+    return std::shared_ptr<SyntheticBufferProducer>(new SyntheticBufferProducer(config));
+}
+
+SyntheticBufferProducer::SyntheticBufferProducer(const Config &config) :
+    config_(config),
+    // Arbitrary non-zero seed; the sequence just has to look random
+    // to the encoder, not be unpredictable.
+    noise_state_(0x12345678) {
+}
+
+SyntheticBufferProducer::~SyntheticBufferProducer() {
+}
+
+bool SyntheticBufferProducer::Setup(const DisplayOutput &output) {
+    output_ = output;
+
+    if (config_.width > 0 && config_.height > 0) {
+        output_.width = config_.width;
+        output_.height = config_.height;
+    }
+    if (config_.refresh_rate > 0.)
+        output_.refresh_rate = config_.refresh_rate;
+
+    if (output_.width == 0 || output_.height == 0) {
+        AC_ERROR("Invalid synthetic source dimensions %dx%d",
+                 output_.width, output_.height);
+        return false;
+    }
+
+    frame_size_ = output_.width * output_.height * kBytesPerPixel;
+    pool_ = BufferPool::Create();
+    frame_counter_ = 0;
+
+    if (config_.pattern == Pattern::kReplay && !LoadReplayFrames())
+        return false;
+
+    AC_DEBUG("Synthetic source is active: %dx%d@%.2f",
+             output_.width, output_.height, output_.refresh_rate);
+
+    return true;
+}
+
+bool SyntheticBufferProducer::LoadReplayFrames() {
+    std::ifstream file(config_.replay_path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        AC_ERROR("Failed to open replay file %s", config_.replay_path);
+        return false;
+    }
+
+    const auto size = static_cast<uint64_t>(file.tellg());
+    if (size == 0 || size % frame_size_ != 0) {
+        AC_ERROR("Replay file %s is not a multiple of the %d byte frame size",
+                 config_.replay_path, frame_size_);
+        return false;
+    }
+
+    file.seekg(0);
+    replay_frames_.resize(size / frame_size_);
+    for (auto &frame : replay_frames_) {
+        frame.resize(frame_size_);
+        file.read(reinterpret_cast<char*>(frame.data()), frame_size_);
+    }
+
+    if (!file) {
+        AC_ERROR("Failed to read replay file %s", config_.replay_path);
+        return false;
+    }
+
+    AC_DEBUG("Loaded %d replay frames from %s",
+             replay_frames_.size(), config_.replay_path);
+
+    return true;
+}
+
+void SyntheticBufferProducer::RenderBars(uint8_t *pixels, unsigned int shift) {
+    const unsigned int bar_width = (output_.width + kBarCount - 1) / kBarCount;
+
+    // Render one line and replicate it; the pattern has no vertical
+    // structure and the copies keep generation well below a frame
+    // interval even at large modes.
+    for (unsigned int x = 0; x < output_.width; x++) {
+        const auto &color = kBarColors[((x + shift) / bar_width) % kBarCount];
+        auto pixel = pixels + x * kBytesPerPixel;
+        pixel[0] = color[0];
+        pixel[1] = color[1];
+        pixel[2] = color[2];
+        pixel[3] = 0;
+    }
+
+    const unsigned int line_size = output_.width * kBytesPerPixel;
+    for (unsigned int y = 1; y < output_.height; y++)
+        ::memcpy(pixels + y * line_size, pixels, line_size);
+}
+
+void SyntheticBufferProducer::RenderNoise(uint8_t *pixels) {
+    // xorshift32; quality doesn't matter, staying far cheaper than the
+    // encoder work it provokes does.
+    auto state = noise_state_;
+    for (uint32_t n = 0; n < frame_size_; n += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        ::memcpy(pixels + n, &state, sizeof(uint32_t));
+    }
+    noise_state_ = state;
+}
+
+void SyntheticBufferProducer::SwapBuffers() {
+    // A frame handed out earlier may still sit in the encoder queue,
+    // so each swap renders into a fresh buffer; the pool makes that
+    // a recycle instead of an allocation in steady state.
+    auto buffer = pool_->Acquire(frame_size_);
+
+    switch (config_.pattern) {
+    case Pattern::kMovingBars:
+        RenderBars(buffer->Data(), frame_counter_ % output_.width);
+        break;
+    case Pattern::kStatic:
+        RenderBars(buffer->Data(), 0);
+        break;
+    case Pattern::kNoise:
+        RenderNoise(buffer->Data());
+        break;
+    case Pattern::kReplay:
+        ::memcpy(buffer->Data(),
+                 replay_frames_[frame_counter_ % replay_frames_.size()].data(),
+                 frame_size_);
+        break;
+    default:
+        break;
+    }
+
+    frame_counter_++;
+    current_buffer_ = buffer;
+    last_frame_time_ = ac::common::Clock::NowUs();
+}
+
+bool SyntheticBufferProducer::LastFrameDamaged() const {
+    // The static pattern repeats its first frame forever, which is
+    // exactly what an idle desktop looks like to the pipeline.
+    if (config_.pattern == Pattern::kStatic)
+        return frame_counter_ <= 1;
+    return true;
+}
+
+ac::TimestampUs SyntheticBufferProducer::LastFrameTimestamp() const {
+    return last_frame_time_;
+}
+
+Buffer::Ptr SyntheticBufferProducer::CurrentBuffer() const {
+    return current_buffer_;
+}
+
+DisplayOutput SyntheticBufferProducer::OutputMode() const {
+    return output_;
+}
+
+} // namespace video
+} // namespace ac
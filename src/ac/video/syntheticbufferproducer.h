@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_SYNTHETICBUFFERPRODUCER_H_
+#define AC_VIDEO_SYNTHETICBUFFERPRODUCER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ac/video/bufferpool.h"
+#include "ac/video/bufferproducer.h"
+
+namespace ac {
+namespace video {
+
+// Generates raw RGBX frames on the CPU instead of capturing a display,
+// so the encoder/packetizer/sender pipeline can run at a controlled and
+// repeatable load on machines without a compositor. It does not pace
+// itself; the renderer's capture clock drives SwapBuffers() exactly as
+// it does for a real screencast.
+class SyntheticBufferProducer : public BufferProducer {
+public:
+    // How each frame's pixels are filled:
+    //  - kMovingBars: color bars scrolling one pixel per frame; cheap
+    //    to generate, compresses like typical screen content and keeps
+    //    every frame damaged.
+    //  - kNoise: uncorrelated pseudo-random pixels; the encoder's
+    //    worst case, for soaking the pipeline at its rate ceiling.
+    //  - kStatic: bars that never move, so only the first frame is
+    //    damaged; exercises the skip path and idle-state costs.
+    //  - kReplay: loops raw frames recorded from a real session, for
+    //    benchmarks that need representative content.
+    enum class Pattern {
+        kMovingBars,
+        kNoise,
+        kStatic,
+        kReplay
+    };
+
+    struct Config {
+        Pattern pattern = Pattern::kMovingBars;
+        // 0 keeps the resolution/rate negotiated with the sink
+        unsigned int width = 0;
+        unsigned int height = 0;
+        double refresh_rate = 0.;
+        // Raw RGBX frame dump for Pattern::kReplay; its size must be
+        // a multiple of the configured frame size.
+        std::string replay_path;
+    };
+
+    // Builds the configuration from the AETHERCAST_SYNTHETIC_*
+    // environment variables; unset ones keep the defaults above.
+    static BufferProducer::Ptr Create();
+    static BufferProducer::Ptr Create(const Config &config);
+
+    ~SyntheticBufferProducer();
+
+    // From ac::video::BufferProducer
+    bool Setup(const DisplayOutput &output) override;
+    void SwapBuffers() override;
+    bool LastFrameDamaged() const override;
+    ac::TimestampUs LastFrameTimestamp() const override;
+    Buffer::Ptr CurrentBuffer() const override;
+    DisplayOutput OutputMode() const override;
+
+private:
+    explicit SyntheticBufferProducer(const Config &config);
+
+    bool LoadReplayFrames();
+    void RenderBars(uint8_t *pixels, unsigned int shift);
+    void RenderNoise(uint8_t *pixels);
+
+    Config config_;
+    DisplayOutput output_;
+    uint32_t frame_size_ = 0;
+    // Every frame gets a fresh pool buffer so a frame still queued at
+    // the encoder is never overwritten; the pool recycles the storage
+    // once the encoder lets go of it.
+    BufferPool::Ptr pool_;
+    Buffer::Ptr current_buffer_;
+    ac::TimestampUs last_frame_time_ = 0ll;
+    uint64_t frame_counter_ = 0;
+    uint32_t noise_state_ = 0;
+    std::vector<std::vector<uint8_t>> replay_frames_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
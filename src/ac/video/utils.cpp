@@ -30,6 +30,26 @@ bool DoesBufferContainIDRFrame(const ac::video::Buffer::Ptr &buffer) {
     return from_android::IsIDR(buffer);
 }
 
+bool DoesBufferContainIDRFrame(const ac::video::Buffer::Ptr &buffer, CodecType codec) {
+    if (codec == CodecType::kH264)
+        return from_android::IsIDR(buffer);
+
+    const uint8_t *data = buffer->Data();
+    size_t size = buffer->Length();
+    const uint8_t *nal_start = nullptr;
+    size_t nal_size = 0;
+
+    while (GetNextNALUnit(&data, &size, &nal_start, &nal_size, true)) {
+        // HEVC carries the NAL type in the upper six bits of the first
+        // header byte; 19 and 20 are the two IDR picture types.
+        const auto nal_type = (nal_start[0] >> 1) & 0x3f;
+        if (nal_type == 19 || nal_type == 20)
+            return true;
+    }
+
+    return false;
+}
+
 bool GetNextNALUnit(const uint8_t **_data, size_t *_size, const uint8_t **nalStart,
                     size_t *nalSize, bool startCodeFollows) {
     return from_android::GetNextNALUnit(_data, _size, nalStart, nalSize, startCodeFollows);
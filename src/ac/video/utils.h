@@ -19,11 +19,14 @@
 #define AC_VIDEO_UTILS_H_
 
 #include "ac/video/buffer.h"
+#include "ac/video/codectype.h"
 
 namespace ac {
 namespace video {
 
 bool DoesBufferContainIDRFrame(const ac::video::Buffer::Ptr &buffer);
+// Codec aware variant; the plain overload above keeps meaning H.264.
+bool DoesBufferContainIDRFrame(const ac::video::Buffer::Ptr &buffer, CodecType codec);
 bool GetNextNALUnit(const uint8_t **_data, size_t *_size, const uint8_t **nalStart,
                     size_t *nalSize, bool startCodeFollows);
 
@@ -16,8 +16,71 @@
 
 #include <stdlib.h>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "ac/video/buffer.h"
 
+namespace {
+// Returns the position of the 0x01 byte of the next 00 00 01 start
+// code at or after min_pos, or size if there is none. Candidate 0x01
+// bytes are located 16 bytes at a time with NEON/SSE2 where available;
+// the two preceding zero bytes are verified per candidate.
+size_t FindStartCode(const uint8_t *data, size_t size, size_t min_pos) {
+    size_t pos = min_pos < 2 ? 2 : min_pos;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t ones = vdupq_n_u8(0x01);
+
+    while (pos + 16 <= size) {
+        const uint8x16_t eq = vceqq_u8(vld1q_u8(data + pos), ones);
+        // Narrow the 128 bit comparison result down to a 64 bit mask
+        // with four bits per input byte.
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+
+        while (mask != 0) {
+            const int first = __builtin_ctzll(mask);
+            const size_t candidate = pos + (first >> 2);
+            if (data[candidate - 1] == 0x00 && data[candidate - 2] == 0x00)
+                return candidate;
+            // Clear the whole nibble belonging to this candidate
+            mask &= ~(0xfull << (first & ~3));
+        }
+
+        pos += 16;
+    }
+#elif defined(__SSE2__)
+    const __m128i ones = _mm_set1_epi8(0x01);
+
+    while (pos + 16 <= size) {
+        const __m128i chunk = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + pos));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, ones));
+
+        while (mask != 0) {
+            const size_t candidate = pos + __builtin_ctz(mask);
+            if (data[candidate - 1] == 0x00 && data[candidate - 2] == 0x00)
+                return candidate;
+            mask &= mask - 1;
+        }
+
+        pos += 16;
+    }
+#endif
+
+    for (; pos < size; pos++) {
+        if (data[pos] == 0x01 && data[pos - 1] == 0x00 && data[pos - 2] == 0x00)
+            return pos;
+    }
+
+    return size;
+}
+}
+
 namespace from_android {
 bool GetNextNALUnit(
         const uint8_t **_data, size_t *_size,
@@ -33,43 +96,24 @@ bool GetNextNALUnit(
         return false;
     }
 
-    size_t offset = 0;
-
     // A valid startcode consists of at least two 0x00 bytes followed by 0x01.
-    for (; offset + 2 < size; ++offset) {
-        if (data[offset + 2] == 0x01 && data[offset] == 0x00
-                && data[offset + 1] == 0x00) {
-            break;
-        }
-    }
-    if (offset + 2 >= size) {
-        *_data = &data[offset];
+    size_t offset = FindStartCode(data, size, 2);
+    if (offset == size) {
+        *_data = &data[size - 2];
         *_size = 2;
         return false;
     }
-    offset += 3;
+    offset += 1;
 
     size_t startOffset = offset;
 
-    for (;;) {
-        while (offset < size && data[offset] != 0x01) {
-            ++offset;
-        }
-
-        if (offset == size) {
-            if (startCodeFollows) {
-                offset = size + 2;
-                break;
-            }
-
+    offset = FindStartCode(data, size, startOffset);
+    if (offset == size) {
+        if (!startCodeFollows) {
             return false;
         }
 
-        if (data[offset - 1] == 0x00 && data[offset - 2] == 0x00) {
-            break;
-        }
-
-        ++offset;
+        offset = size + 2;
     }
 
     size_t endOffset = offset - 2;
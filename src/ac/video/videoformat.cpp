@@ -15,9 +15,165 @@
  *
  */
 
+#include <algorithm>
+#include <limits>
+
 #include "ac/video/videoformat.h"
 #include "ac/logger.h"
 
+namespace {
+// All wds enum translation happens through the tables below, indexed
+// directly by enum value. Rows are in wds/video_format.h declaration
+// order; the static_asserts catch the table which was not extended
+// when a new mode (4K etc.) shows up in wds.
+struct RateResolutionEntry {
+    const char *name;
+    unsigned int width;
+    unsigned int height;
+    double framerate;
+};
+
+constexpr RateResolutionEntry kCEATable[] = {
+    {"640x480p60", 640, 480, 60},
+    {"720x480p60", 720, 480, 60},
+    {"720x480i60", 720, 480, 60},
+    {"720x576p50", 720, 576, 50},
+    {"720x576i50", 720, 576, 50},
+    {"1280x720p30", 1280, 720, 30},
+    {"1280x720p60", 1280, 720, 60},
+    {"1920x1080p30", 1920, 1080, 30},
+    {"1920x1080p60", 1920, 1080, 60},
+    {"1920x1080i60", 1920, 1080, 60},
+    {"1280x720p25", 1280, 720, 25},
+    {"1280x720p50", 1280, 720, 50},
+    {"1920x1080p25", 1920, 1080, 25},
+    {"1920x1080p50", 1920, 1080, 50},
+    {"1920x1080i50", 1920, 1080, 50},
+    {"1280x720p24", 1280, 720, 24},
+    {"1920x1080p24", 1920, 1080, 24},
+};
+
+constexpr RateResolutionEntry kVESATable[] = {
+    {"800x600p30", 800, 600, 30},
+    {"800x600p60", 800, 600, 60},
+    {"1024x768p30", 1024, 768, 30},
+    {"1024x768p60", 1024, 768, 60},
+    {"1152x864p30", 1152, 864, 30},
+    {"1152x864p60", 1152, 864, 60},
+    {"1280x768p30", 1280, 768, 30},
+    {"1280x768p60", 1280, 768, 60},
+    {"1280x800p30", 1280, 800, 30},
+    {"1280x800p60", 1280, 800, 60},
+    {"1360x768p30", 1360, 768, 30},
+    {"1360x768p60", 1360, 768, 60},
+    {"1366x768p30", 1366, 768, 30},
+    {"1366x768p60", 1366, 768, 60},
+    {"1280x1024p30", 1280, 1024, 30},
+    {"1280x1024p60", 1280, 1024, 60},
+    {"1400x1050p30", 1400, 1050, 30},
+    {"1400x1050p60", 1400, 1050, 60},
+    {"1440x900p30", 1440, 900, 30},
+    {"1440x900p60", 1440, 900, 60},
+    {"1600x900p30", 1600, 900, 30},
+    {"1600x900p60", 1600, 900, 60},
+    {"1600x1200p30", 1600, 1200, 30},
+    {"1600x1200p60", 1600, 1200, 60},
+    {"1680x1024p30", 1680, 1024, 30},
+    {"1680x1024p60", 1680, 1024, 60},
+    {"1680x1050p30", 1680, 1050, 30},
+    {"1680x1050p60", 1680, 1050, 60},
+    {"1920x1200p30", 1920, 1200, 30},
+};
+
+constexpr RateResolutionEntry kHHTable[] = {
+    {"800x480p30", 800, 480, 30},
+    {"800x480p60", 800, 480, 60},
+    {"854x480p30", 854, 480, 30},
+    {"854x480p60", 854, 480, 60},
+    {"864x480p30", 864, 480, 30},
+    {"864x480p60", 864, 480, 60},
+    {"640x360p30", 640, 360, 30},
+    {"640x360p60", 640, 360, 60},
+    {"960x540p30", 960, 540, 30},
+    {"960x540p60", 960, 540, 60},
+    {"848x480p30", 848, 480, 30},
+    {"848x480p60", 848, 480, 60},
+};
+
+// 2160p modes have no wds enum values to index by, so unlike the
+// tables above this one never appears in the RTSP exchange; it backs
+// the local resolution override.
+constexpr RateResolutionEntry k2160pTable[] = {
+    {"3840x2160p24", 3840, 2160, 24},
+    {"3840x2160p25", 3840, 2160, 25},
+    {"3840x2160p30", 3840, 2160, 30},
+    {"3840x2160p60", 3840, 2160, 60},
+};
+
+static_assert(sizeof(kCEATable) / sizeof(kCEATable[0]) == wds::CEA1920x1080p24 + 1,
+              "CEA table out of sync with wds/video_format.h");
+static_assert(sizeof(kVESATable) / sizeof(kVESATable[0]) == wds::VESA1920x1200p30 + 1,
+              "VESA table out of sync with wds/video_format.h");
+static_assert(sizeof(kHHTable) / sizeof(kHHTable[0]) == wds::HH848x480p60 + 1,
+              "HH table out of sync with wds/video_format.h");
+
+struct ProfileEntry {
+    const char *name;
+    const char *rtsp_name;
+    int idc;
+    int constraint;
+};
+
+constexpr ProfileEntry kProfileTable[] = {
+    {"cbp", "constrained-baseline", 66, 0xc0},
+    {"chp", "high", 100, 0x0c},
+};
+
+struct LevelEntry {
+    const char *name;
+    int idc;
+};
+
+constexpr LevelEntry kLevelTable[] = {
+    {"3.1", 31},
+    {"3.2", 32},
+    {"4", 40},
+    {"4.1", 41},
+    {"4.2", 42},
+};
+
+static_assert(sizeof(kProfileTable) / sizeof(kProfileTable[0]) == wds::CHP + 1,
+              "profile table out of sync with wds/video_format.h");
+static_assert(sizeof(kLevelTable) / sizeof(kLevelTable[0]) == wds::k4_2 + 1,
+              "level table out of sync with wds/video_format.h");
+
+const RateResolutionEntry* LookupRateResolution(wds::ResolutionType type, unsigned int index) {
+    switch (type) {
+    case wds::CEA:
+        if (index < sizeof(kCEATable) / sizeof(kCEATable[0]))
+            return &kCEATable[index];
+        break;
+    case wds::VESA:
+        if (index < sizeof(kVESATable) / sizeof(kVESATable[0]))
+            return &kVESATable[index];
+        break;
+    case wds::HH:
+        if (index < sizeof(kHHTable) / sizeof(kHHTable[0]))
+            return &kHHTable[index];
+        break;
+    default:
+        break;
+    }
+    return nullptr;
+}
+
+std::string RateResolutionName(wds::ResolutionType type, unsigned int index) {
+    if (const auto entry = LookupRateResolution(type, index))
+        return entry->name;
+    return "unknown";
+}
+}
+
 namespace ac {
 namespace video {
 
@@ -36,382 +192,214 @@ std::string ResolutionTypeToString(wds::ResolutionType type) {
 }
 
 std::string CEARatesAndResolutionsToString(wds::CEARatesAndResolutions type) {
-    switch (type) {
-    case wds::CEA640x480p60:
-        return "640x480p60";
-    case wds::CEA720x480p60:
-        return "720x480p60";
-    case wds::CEA720x480i60:
-        return "720x480i60";
-    case wds::CEA720x576p50:
-        return "720x576p50";
-    case wds::CEA720x576i50:
-        return "720x576i50";
-    case wds::CEA1280x720p30:
-        return "1280x720p30";
-    case wds::CEA1280x720p60:
-        return "1280x720p60";
-    case wds::CEA1920x1080p30:
-        return "1920x1080p30";
-    case wds::CEA1920x1080p60:
-        return "1920x1080p60";
-    case wds::CEA1920x1080i60:
-        return "1920x1080i60";
-    case wds::CEA1280x720p25:
-        return "1280x720p25";
-    case wds::CEA1280x720p50:
-        return "1280x720p50";
-    case wds::CEA1920x1080p25:
-        return "1920x1080p25";
-    case wds::CEA1920x1080p50:
-        return "1920x1080p50";
-    case wds::CEA1920x1080i50:
-        return "1920x1080i50";
-    case wds::CEA1280x720p24:
-        return "1280x720p24";
-    case wds::CEA1920x1080p24:
-        return "1920x1080p24";
-    default:
-        break;
-    }
-    return "unknown";
+    return RateResolutionName(wds::CEA, type);
 }
 
 std::string VESARatesAndResolutionsToString(wds::VESARatesAndResolutions type) {
-    switch (type) {
-    case wds::VESA800x600p30:
-        return "800x600p30";
-    case wds::VESA800x600p60:
-        return "800x600p60";
-    case wds::VESA1024x768p30:
-        return "1024x768p30";
-    case wds::VESA1024x768p60:
-        return "1024x768p60";
-    case wds::VESA1152x864p30:
-        return "1152x864p30";
-    case wds::VESA1152x864p60:
-        return "1152x864p60";
-    case wds::VESA1280x768p30:
-        return "1280x768p30";
-    case wds::VESA1280x768p60:
-        return "1280x768p60";
-    case wds::VESA1280x800p30:
-        return "1280x800p30";
-    case wds::VESA1280x800p60:
-        return "1280x800p60";
-    case wds::VESA1360x768p30:
-        return "1360x768p30";
-    case wds::VESA1360x768p60:
-        return "1360x768p60";
-    case wds::VESA1366x768p30:
-        return "1366x768p30";
-    case wds::VESA1366x768p60:
-        return "1366x768p60";
-    case wds::VESA1280x1024p30:
-        return "1280x1024p30";
-    case wds::VESA1280x1024p60:
-        return "1280x1024p60";
-    case wds::VESA1400x1050p30:
-        return "1400x1050p30";
-    case wds::VESA1400x1050p60:
-        return "1400x1050p60";
-    case wds::VESA1440x900p30:
-        return "1440x900p30";
-    case wds::VESA1440x900p60:
-        return "1440x900p60";
-    case wds::VESA1600x900p30:
-        return "1600x900p30";
-    case wds::VESA1600x900p60:
-        return "1600x900p60";
-    case wds::VESA1600x1200p30:
-        return "1600x1200p30";
-    case wds::VESA1600x1200p60:
-        return "1600x1200p60";
-    case wds::VESA1680x1024p30:
-        return "1680x1024p30";
-    case wds::VESA1680x1024p60:
-        return "1680x1024p60";
-    case wds::VESA1680x1050p30:
-        return "1680x1050p30";
-    case wds::VESA1680x1050p60:
-        return "1680x1050p60";
-    case wds::VESA1920x1200p30:
-        return "1920x1200p30";
-    default:
-        break;
-    }
-    return "unknown";
+    return RateResolutionName(wds::VESA, type);
 }
 
 std::string HHRatesAndResolutionsToString(wds::HHRatesAndResolutions type) {
-    switch (type) {
-    case wds::HH800x480p30:
-      return "800x480p30";
-    case wds::HH800x480p60:
-      return "800x480p60";
-    case wds::HH854x480p30:
-      return "854x480p30";
-    case wds::HH854x480p60:
-      return "854x480p60";
-    case wds::HH864x480p30:
-      return "864x480p30";
-    case wds::HH864x480p60:
-      return "864x480p60";
-    case wds::HH640x360p30:
-      return "640x360p30";
-    case wds::HH640x360p60:
-      return "640x360p60";
-    case wds::HH960x540p30:
-      return "960x540p30";
-    case wds::HH960x540p60:
-      return "960x540p60";
-    case wds::HH848x480p30:
-      return "848x480p30";
-    case wds::HH848x480p60:
-      return "848x480p60";
-    default:
-        break;
-    }
-    return "unknown";
+    return RateResolutionName(wds::HH, type);
 }
 
 std::string LevelToString(wds::H264Level level) {
-    switch (level) {
-    case wds::k3_1:
-        return "3.1";
-    case wds::k3_2:
-        return "3.2";
-    case wds::k4:
-        return "4";
-    case wds::k4_1:
-        return "4.1";
-    case wds::k4_2:
-        return "4.2";
-    default:
-        break;
-    }
+    if (static_cast<unsigned int>(level) < sizeof(kLevelTable) / sizeof(kLevelTable[0]))
+        return kLevelTable[level].name;
     return "unknown";
 }
 
 std::string ProfileToString(wds::H264Profile profile) {
-    switch (profile) {
-    case wds::CBP:
-        return "cbp";
-    case wds::CHP:
-        return "chp";
-    default:
-        break;
-    }
+    if (static_cast<unsigned int>(profile) < sizeof(kProfileTable) / sizeof(kProfileTable[0]))
+        return kProfileTable[profile].name;
     return "unknown";
 }
 
 void DumpVideoCodec(const wds::H264VideoCodec &codec) {
-    int i = 0;
+    unsigned int i = 0;
 
     AC_DEBUG(" profile: %s", ProfileToString(codec.profile));
     AC_DEBUG(" level: %s", LevelToString(codec.level));
 
     AC_DEBUG(" CEA resolutions: ");
-    for (i = wds::CEA640x480p60; i <= wds::CEA1920x1080p24; ++i)
+    for (i = 0; i < sizeof(kCEATable) / sizeof(kCEATable[0]); ++i)
         if (codec.cea_rr.test(i))
-            AC_DEBUG("  %s", CEARatesAndResolutionsToString(static_cast<wds::CEARatesAndResolutions>(i)).c_str());
+            AC_DEBUG("  %s", kCEATable[i].name);
 
     AC_DEBUG(" VESA resolutions: ");
-    for (i = wds::VESA800x600p30; i <= wds::VESA1920x1200p30; ++i)
+    for (i = 0; i < sizeof(kVESATable) / sizeof(kVESATable[0]); ++i)
         if (codec.vesa_rr.test(i))
-            AC_DEBUG("  %s", VESARatesAndResolutionsToString(static_cast<wds::VESARatesAndResolutions>(i)).c_str());
+            AC_DEBUG("  %s", kVESATable[i].name);
 
     AC_DEBUG(" HH resolutions: ");
-    for (i = wds::HH800x480p30; i <= wds::HH848x480p60; ++i)
+    for (i = 0; i < sizeof(kHHTable) / sizeof(kHHTable[0]); ++i)
         if (codec.hh_rr.test(i))
-            AC_DEBUG("  %s", HHRatesAndResolutionsToString(static_cast<wds::HHRatesAndResolutions>(i)).c_str());
+            AC_DEBUG("  %s", kHHTable[i].name);
 }
 
 void DumpVideoFormat(const wds::H264VideoFormat &format) {
     AC_DEBUG(" profile: %s", ProfileToString(format.profile));
     AC_DEBUG(" level: %s", LevelToString(format.level));
     AC_DEBUG(" resolution type: %s", ResolutionTypeToString(format.type));
-
-    if (format.type == wds::CEA)
-        AC_DEBUG("resolution: %s", CEARatesAndResolutionsToString(static_cast<wds::CEARatesAndResolutions>(format.rate_resolution)));
-    if (format.type == wds::VESA)
-        AC_DEBUG("resolution: %s", VESARatesAndResolutionsToString(static_cast<wds::VESARatesAndResolutions>(format.rate_resolution)));
-    if (format.type == wds::HH)
-        AC_DEBUG("resolution: %s", HHRatesAndResolutionsToString(static_cast<wds::HHRatesAndResolutions>(format.rate_resolution)));
+    AC_DEBUG(" resolution: %s", RateResolutionName(format.type, format.rate_resolution));
 }
 
 void DumpNativeFormat(const wds::NativeVideoFormat &format) {
     AC_DEBUG(" resolution type: %s", ResolutionTypeToString(format.type));
-
-    if (format.type == wds::CEA)
-        AC_DEBUG("resolution: %s", CEARatesAndResolutionsToString((static_cast<wds::CEARatesAndResolutions>(format.rate_resolution))));
-    if (format.type == wds::VESA)
-        AC_DEBUG("resolution: %s", VESARatesAndResolutionsToString(static_cast<wds::VESARatesAndResolutions>(format.rate_resolution)));
-    if (format.type == wds::HH)
-        AC_DEBUG("resolution: %s", HHRatesAndResolutionsToString(static_cast<wds::HHRatesAndResolutions>(format.rate_resolution)));
+    AC_DEBUG(" resolution: %s", RateResolutionName(format.type, format.rate_resolution));
 }
 
 std::string ExtractH264Profile(const wds::H264VideoFormat &format) {
-    std::string profile;
-    switch (format.profile) {
-    case wds::CBP:
-        profile = "constrained-baseline";
-        break;
-    case wds::CHP:
-        profile = "high";
-        break;
+    if (static_cast<unsigned int>(format.profile) < sizeof(kProfileTable) / sizeof(kProfileTable[0]))
+        return kProfileTable[format.profile].rtsp_name;
+    return "";
+}
+
+std::string ExtractH264Level(const wds::H264VideoFormat &format) {
+    if (static_cast<unsigned int>(format.level) < sizeof(kLevelTable) / sizeof(kLevelTable[0]))
+        return kLevelTable[format.level].name;
+    return "";
+}
+
+RateAndResolution ExtractRateAndResolution(const wds::H264VideoFormat &format) {
+    if (const auto entry = LookupRateResolution(format.type, format.rate_resolution))
+        return RateAndResolution{entry->width, entry->height, entry->framerate};
+
+    // Safe fallback for an enum value we do not know yet
+    return RateAndResolution{640, 480, 30};
+}
+
+void ExtractProfileLevel(const wds::H264VideoFormat &format, int *profile,
+                            int *level, int *constraint) {
+
+    if (static_cast<unsigned int>(format.profile) < sizeof(kProfileTable) / sizeof(kProfileTable[0])) {
+        *profile = kProfileTable[format.profile].idc;
+        *constraint = kProfileTable[format.profile].constraint;
+    }
+
+    if (static_cast<unsigned int>(format.level) < sizeof(kLevelTable) / sizeof(kLevelTable[0]))
+        *level = kLevelTable[format.level].idc;
+}
+
+namespace {
+// Pixel throughput is what the rest of the pipeline has to sustain,
+// so that is the score we rank common modes by.
+double ScoreRateResolution(wds::ResolutionType type, unsigned int index) {
+    if (const auto entry = LookupRateResolution(type, index))
+        return entry->width * entry->height * entry->framerate;
+    return 0.0;
+}
+
+wds::H264VideoFormat MakeFormat(wds::H264Profile profile, wds::H264Level level,
+                                wds::ResolutionType type, unsigned int index) {
+    switch (type) {
+    case wds::VESA:
+        return wds::H264VideoFormat(profile, level,
+            static_cast<wds::VESARatesAndResolutions>(index));
+    case wds::HH:
+        return wds::H264VideoFormat(profile, level,
+            static_cast<wds::HHRatesAndResolutions>(index));
+    case wds::CEA:
     default:
-        break;
+        return wds::H264VideoFormat(profile, level,
+            static_cast<wds::CEARatesAndResolutions>(index));
     }
-    return profile;
 }
 
-std::string ExtractH264Level(const wds::H264VideoFormat &format) {
-    std::string level;
-    switch (format.level) {
-    case wds::k3_1:
-        level = "3.1";
-        break;
-    case wds::k3_2:
-        level = "3.2";
-        break;
-    case wds::k4:
-        level = "4";
-        break;
-    case wds::k4_1:
-        level = "4.1";
-        break;
-    case wds::k4_2:
-        level = "4.2";
-        break;
+const wds::RateAndResolutionsBitmap& BitmapForType(const wds::H264VideoCodec &codec,
+                                                   wds::ResolutionType type) {
+    switch (type) {
+    case wds::VESA:
+        return codec.vesa_rr;
+    case wds::HH:
+        return codec.hh_rr;
+    case wds::CEA:
     default:
-        break;
+        return codec.cea_rr;
     }
-    return level;
 }
 
-RateAndResolution ExtractRateAndResolution(const wds::H264VideoFormat &format) {
-    RateAndResolution rr;
-    switch (format.type) {
+unsigned int TableSizeForType(wds::ResolutionType type) {
+    switch (type) {
+    case wds::VESA:
+        return sizeof(kVESATable) / sizeof(kVESATable[0]);
+    case wds::HH:
+        return sizeof(kHHTable) / sizeof(kHHTable[0]);
     case wds::CEA:
-        switch (format.rate_resolution) {
-        case wds::CEA640x480p60:
-            rr.width = 640;
-            rr.height = 480;
-            rr.framerate = 60;
-            break;
-        case wds::CEA720x480p60:
-        case wds::CEA720x480i60:
-            rr.width = 720;
-            rr.height = 480;
-            rr.framerate = 60;
-            break;
-        case wds::CEA720x576p50:
-        case wds::CEA720x576i50:
-            rr.width = 720;
-            rr.height = 576;
-            rr.framerate = 50;
-            break;
-        case wds::CEA1280x720p30:
-            rr.width = 1280;
-            rr.height = 720;
-            rr.framerate = 30;
-            break;
-        case wds::CEA1280x720p60:
-            rr.width = 1280;
-            rr.height = 720;
-            rr.framerate = 60;
-            break;
-        case wds::CEA1920x1080p30:
-            rr.width = 1920;
-            rr.height = 1080;
-            rr.framerate = 30;
-            break;
-        case wds::CEA1920x1080p60:
-        case wds::CEA1920x1080i60:
-            rr.width = 1920;
-            rr.height = 1080;
-            rr.framerate = 60;
-            break;
-        case wds::CEA1280x720p25:
-            rr.width = 1280;
-            rr.height = 720;
-            rr.framerate = 25;
-            break;
-        case wds::CEA1280x720p50:
-            rr.width = 1280;
-            rr.height = 720;
-            rr.framerate = 50;
-            break;
-        case wds::CEA1280x720p24:
-            rr.width = 1280;
-            rr.height = 720;
-            rr.framerate = 24;
-            break;
-        case wds::CEA1920x1080p25:
-            rr.width = 1920;
-            rr.height = 1080;
-            rr.framerate = 25;
-            break;
-        case wds::CEA1920x1080p50:
-            rr.width = 1920;
-            rr.height = 1080;
-            rr.framerate = 50;
-            break;
-        case wds::CEA1920x1080i50:
-            rr.width = 1920;
-            rr.height = 1080;
-            rr.framerate = 50;
-            break;
-        case wds::CEA1920x1080p24:
-            rr.width = 1920;
-            rr.height = 1080;
-            rr.framerate = 24;
-            break;
-        default:
-            break;
-        }
-        break;
-    // FIXME Add support for VESA and HH
     default:
-        rr.width = 640;
-        rr.height = 480;
-        rr.framerate = 30;
-        break;
+        return sizeof(kCEATable) / sizeof(kCEATable[0]);
     }
-    return rr;
+}
 }
 
-void ExtractProfileLevel(const wds::H264VideoFormat &format, int *profile,
-                            int *level, int *constraint) {
+wds::H264VideoFormat FindOptimalVideoFormat(
+        const wds::NativeVideoFormat &native,
+        const std::vector<wds::H264VideoCodec> &local_codecs,
+        const std::vector<wds::H264VideoCodec> &remote_codecs,
+        bool *success) {
 
-    if (format.profile == wds::CBP) {
-        *profile = 66;
-        *constraint = 0xc0;
-    }
-    else if (format.profile == wds::CHP) {
-        *profile = 100;
-        *constraint = 0x0c;
+    bool found = false;
+    double best_score = -1.0;
+    wds::H264VideoFormat best = MakeFormat(wds::CBP, wds::k3_1, wds::CEA, wds::CEA640x480p60);
+
+    static const wds::ResolutionType kTypes[] = {wds::CEA, wds::VESA, wds::HH};
+
+    for (const auto &local : local_codecs) {
+        for (const auto &remote : remote_codecs) {
+            if (local.profile != remote.profile)
+                continue;
+
+            const auto level = std::min(local.level, remote.level);
+
+            for (const auto type : kTypes) {
+                const auto &ours = BitmapForType(local, type);
+                const auto &theirs = BitmapForType(remote, type);
+
+                for (unsigned int i = 0; i < TableSizeForType(type); i++) {
+                    if (!ours.test(i) || !theirs.test(i))
+                        continue;
+
+                    auto score = ScoreRateResolution(type, i);
+
+                    // The sink renders its native mode without
+                    // scaling, so prefer it over everything else
+                    // both sides can do.
+                    if (type == native.type && i == native.rate_resolution)
+                        score = std::numeric_limits<double>::max();
+
+                    if (score > best_score) {
+                        best_score = score;
+                        best = MakeFormat(local.profile, level, type, i);
+                        found = true;
+                    }
+                }
+            }
+        }
     }
 
-    switch (format.level) {
-    case wds::k3_1:
-        *level = 31;
-        break;
-    case wds::k3_2:
-        *level = 32;
-        break;
-    case wds::k4:
-        *level = 40;
-        break;
-    case wds::k4_1:
-        *level = 41;
-        break;
-    case wds::k4_2:
-        *level = 42;
-    default:
-        break;
+    if (success)
+        *success = found;
+
+    return best;
+}
+
+bool FindBest2160pMode(double max_pixel_rate, double max_framerate,
+                       RateAndResolution *mode) {
+    bool found = false;
+
+    for (const auto &entry : k2160pTable) {
+        if (entry.framerate > max_framerate)
+            continue;
+        if (entry.width * entry.height * entry.framerate > max_pixel_rate)
+            continue;
+
+        if (!found || entry.framerate > mode->framerate) {
+            *mode = RateAndResolution{entry.width, entry.height, entry.framerate};
+            found = true;
+        }
     }
+
+    return found;
 }
 
 } // namespace video
@@ -18,6 +18,8 @@
 #ifndef AC_VIDEOFORMAT_H_
 #define AC_VIDEOFORMAT_H_
 
+#include <vector>
+
 #include <wds/video_format.h>
 
 namespace ac {
@@ -40,6 +42,25 @@ std::string ExtractH264Level(const wds::H264VideoFormat &format);
 void ExtractProfileLevel(const wds::H264VideoFormat &format, int *profile,
                          int *level, int *constraint);
 
+// Table-driven replacement for wds::FindOptimalVideoFormat: picks the
+// highest pixel-throughput rate-resolution both sides advertise (the
+// sink's native mode wins outright when available), pairing matching
+// profiles with the lower of the two levels. Sets *success to false
+// when the capability sets do not intersect at all.
+wds::H264VideoFormat FindOptimalVideoFormat(
+        const wds::NativeVideoFormat &native,
+        const std::vector<wds::H264VideoCodec> &local_codecs,
+        const std::vector<wds::H264VideoCodec> &remote_codecs,
+        bool *success);
+
+// The wds tables stop at 1080p since WFD 1.x defines no 2160p
+// rate-resolution values; these modes exist as a local override on
+// top of the negotiated format. Picks the 2160p mode with the highest
+// framerate not above max_framerate whose pixel throughput fits into
+// max_pixel_rate; returns false when none does.
+bool FindBest2160pMode(double max_pixel_rate, double max_framerate,
+                       RateAndResolution *mode);
+
 } // namespace video
 } // namespace ac
 
@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -35,10 +36,14 @@ using namespace std::placeholders;
 namespace {
 const unsigned int kDBusTimeout = 120;
 
+// False in the scripting modes where no readline prompt is installed
+// and the PromptSaver must stay away from the readline state.
+bool prompt_enabled = true;
+
 class PromptSaver {
 public:
     PromptSaver() {
-        save_input_ = !RL_ISSTATE(RL_STATE_DONE);
+        save_input_ = prompt_enabled && !RL_ISSTATE(RL_STATE_DONE);
         if (save_input_) {
             saved_point_ = rl_point;
             saved_line_ = rl_copy_text(0, rl_end);
@@ -63,6 +68,59 @@ private:
     int saved_point_;
     char *saved_line_;
 };
+
+std::string JsonEscape(const std::string &value) {
+    std::stringstream out;
+    for (auto c : value) {
+        switch (c) {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                out << "\\u" << std::setw(4) << std::setfill('0')
+                    << std::hex << static_cast<int>(c);
+            else
+                out << c;
+        }
+    }
+    return out.str();
+}
+
+std::string VariantToJsonValue(GVariant *value) {
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN))
+        return g_variant_get_boolean(value) ? "true" : "false";
+
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+        return "\"" + JsonEscape(g_variant_get_string(value, nullptr)) + "\"";
+
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING_ARRAY)) {
+        std::stringstream out;
+        out << "[";
+        for (gsize n = 0; n < g_variant_n_children(value); n++) {
+            auto element = g_variant_get_child_value(value, n);
+            if (n > 0)
+                out << ",";
+            out << "\"" << JsonEscape(g_variant_get_string(element, nullptr)) << "\"";
+            g_variant_unref(element);
+        }
+        out << "]";
+        return out.str();
+    }
+
+    // Fall back to GVariant's own text form wrapped as a string so the
+    // output stays valid JSON for types we don't map explicitly.
+    auto printed = g_variant_print(value, FALSE);
+    const auto result = "\"" + JsonEscape(printed) + "\"";
+    g_free(printed);
+    return result;
+}
 }
 
 namespace ac {
@@ -72,8 +130,12 @@ GMainLoop *Application::main_loop_ = nullptr;
 std::map<std::string,Application::Command> Application::available_commands_ = { };
 
 Application::MainOptions Application::MainOptions::FromCommandLine(int argc, char** argv) {
+    static gboolean option_json{FALSE};
+    static gboolean option_watch{FALSE};
 
     static GOptionEntry options[] = {
+        { "json", 'j', 0, G_OPTION_ARG_NONE, &option_json, "Print status as JSON and exit", nullptr },
+        { "watch", 'w', 0, G_OPTION_ARG_NONE, &option_watch, "Print status and keep reporting changes", nullptr },
         { NULL },
     };
 
@@ -91,21 +153,30 @@ Application::MainOptions Application::MainOptions::FromCommandLine(int argc, cha
         exit(1);
     }
 
-    return MainOptions{};
+    return MainOptions{option_json == TRUE, option_watch == TRUE};
 }
 
 int Application::Main(const MainOptions &options) {
-    Application app;
+    Application app(options);
     return app.Run();
 }
 
-Application::Application() :
+Application::Application(const MainOptions &options) :
     bus_connection_(nullptr),
     manager_(nullptr),
     input_source_(0),
-    object_manager_(nullptr) {
-
-    rl_callback_handler_install("aethercastctl> ", &Application::OnReadlineMessage);
+    object_manager_(nullptr),
+    json_(options.json),
+    watch_(options.watch),
+    interactive_(!options.json && !options.watch),
+    manager_ready_(false),
+    objects_ready_(false),
+    exit_code_(0) {
+
+    if (interactive_)
+        rl_callback_handler_install("aethercastctl> ", &Application::OnReadlineMessage);
+    else
+        prompt_enabled = false;
 
     main_loop_ = g_main_loop_new(nullptr, FALSE);
 
@@ -114,6 +185,7 @@ Application::Application() :
     if (!bus_connection_) {
         std::cerr << "Failed to connect to system bus: " << error->message << std::endl;
         g_error_free(error);
+        exit_code_ = 1;
         return;
     }
 
@@ -123,8 +195,11 @@ Application::Application() :
                                    &Application::OnServiceLost,
                                    this, nullptr);
 
-    g_dbus_connection_signal_subscribe(bus_connection_, "org.aethercast", "org.freedesktop.DBus.Properties", "PropertiesChanged", "/org/aethercast", nullptr,
-                                       G_DBUS_SIGNAL_FLAGS_NONE, &Application::OnManagerPropertiesChanged, this, nullptr);
+    // The one-shot JSON mode only takes a single snapshot; the change
+    // subscription is for the interactive prompt and --watch.
+    if (interactive_ || watch_)
+        g_dbus_connection_signal_subscribe(bus_connection_, "org.aethercast", "org.freedesktop.DBus.Properties", "PropertiesChanged", "/org/aethercast", nullptr,
+                                           G_DBUS_SIGNAL_FLAGS_NONE, &Application::OnManagerPropertiesChanged, this, nullptr);
 
     RegisterCommand(Command { "enable", "", "Enable manager", std::bind(&Application::HandleEnableCommand, this, _1) });
     RegisterCommand(Command { "disable", "", "Disable manager", std::bind(&Application::HandleDisableCommand, this, _1) });
@@ -137,8 +212,10 @@ Application::Application() :
 }
 
 Application::~Application() {
-    rl_message();
-    rl_callback_handler_remove();
+    if (interactive_) {
+        rl_message();
+        rl_callback_handler_remove();
+    }
 
     g_object_unref(bus_connection_);
     g_main_loop_unref(main_loop_);
@@ -151,8 +228,9 @@ Application::~Application() {
 }
 
 int Application::Run() {
-    g_main_loop_run(main_loop_);
-    return 0;
+    if (exit_code_ == 0)
+        g_main_loop_run(main_loop_);
+    return exit_code_;
 }
 
 void Application::RegisterCommand(const Command &command) {
@@ -420,6 +498,15 @@ void Application::OnReadlineMessage(char *input) {
 void Application::OnServiceLost(GDBusConnection *connection, const gchar *name, gpointer user_data) {
     auto inst = static_cast<Application*>(user_data);
 
+    // For scripting callers a missing service is a hard error they
+    // need to see in the exit status instead of a hanging process.
+    if (!inst->interactive_) {
+        std::cerr << "aethercast service is not available" << std::endl;
+        inst->exit_code_ = 1;
+        g_main_loop_quit(inst->main_loop_);
+        return;
+    }
+
     if (inst->input_source_ > 0) {
         g_source_remove(inst->input_source_);
         inst->input_source_ = 0;
@@ -442,6 +529,14 @@ void Application::OnServiceFound(GDBusConnection *connection, const gchar *name,
     aethercast_interface_manager_proxy_new(inst->bus_connection_, G_DBUS_PROXY_FLAGS_NONE,
                                          "org.aethercast", "/org/aethercast", nullptr,
                                          &Application::OnManagerConnected, inst);
+
+    // The device inventory comes in via a single GetManagedObjects
+    // round-trip which can run in parallel with the manager proxy
+    // setup above instead of waiting for it to finish first.
+    aethercast_interface_object_manager_client_new(inst->bus_connection_,
+                             G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE,
+                             "org.aethercast", "/org/aethercast",
+                             nullptr, &Application::OnObjectManagerCreated, inst);
 }
 
 void Application::OnManagerConnected(GObject *object, GAsyncResult *res, gpointer user_data) {
@@ -463,10 +558,8 @@ void Application::OnManagerConnected(GObject *object, GAsyncResult *res, gpointe
     // factors.
     g_dbus_proxy_set_default_timeout(G_DBUS_PROXY(inst->manager_), kDBusTimeout * 1000);
 
-    aethercast_interface_object_manager_client_new(inst->bus_connection_,
-                             G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE,
-                             "org.aethercast", "/org/aethercast",
-                             nullptr, &Application::OnObjectManagerCreated, inst);
+    inst->manager_ready_ = true;
+    inst->MaybeEmitStatus();
 }
 
 void Application::OnManagerPropertiesChanged(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path,
@@ -474,6 +567,8 @@ void Application::OnManagerPropertiesChanged(GDBusConnection *connection, const
                                              gpointer user_data) {
     PromptSaver ps;
 
+    auto inst = static_cast<Application*>(user_data);
+
     if (g_variant_n_children(parameters) != 3)
         return;
 
@@ -485,6 +580,17 @@ void Application::OnManagerPropertiesChanged(GDBusConnection *connection, const
 
         auto key = std::string(g_variant_get_string(key_v, nullptr));
 
+        if (inst->json_) {
+            auto value = g_variant_get_variant(value_v);
+            std::cout << "{\"event\":\"manager-changed\",\"property\":\""
+                      << JsonEscape(key) << "\",\"value\":"
+                      << VariantToJsonValue(value) << "}" << std::endl;
+            g_variant_unref(value);
+            g_variant_unref(key_v);
+            g_variant_unref(value_v);
+            continue;
+        }
+
         std::cout << "[CHG] Manager " << key << " changed: ";
 
         if (key == "Enabled")
@@ -517,6 +623,8 @@ void Application::OnManagerPropertiesChanged(GDBusConnection *connection, const
 void Application::OnDeviceAdded(GDBusObjectManager *manager, GDBusObject *object, gpointer user_data) {
     PromptSaver ps;
 
+    auto inst = static_cast<Application*>(user_data);
+
     auto iface = g_dbus_object_get_interface(G_DBUS_OBJECT(object), "org.aethercast.Device");
     if (!iface)
         return;
@@ -526,12 +634,19 @@ void Application::OnDeviceAdded(GDBusObjectManager *manager, GDBusObject *object
     auto address = aethercast_interface_device_get_address(device);
     auto name = aethercast_interface_device_get_name(device);
 
-    std::cout << "Device " << address << " " << name << " added" << std::endl;
+    if (inst->json_)
+        std::cout << "{\"event\":\"device-added\",\"address\":\""
+                  << JsonEscape(address ?: "") << "\",\"name\":\""
+                  << JsonEscape(name ?: "") << "\"}" << std::endl;
+    else
+        std::cout << "Device " << address << " " << name << " added" << std::endl;
 }
 
 void Application::OnDeviceRemoved(GDBusObjectManager *manager, GDBusObject *object, gpointer user_data) {
     PromptSaver ps;
 
+    auto inst = static_cast<Application*>(user_data);
+
     auto iface = g_dbus_object_get_interface(G_DBUS_OBJECT(object), "org.aethercast.Device");
     if (!iface)
         return;
@@ -541,7 +656,12 @@ void Application::OnDeviceRemoved(GDBusObjectManager *manager, GDBusObject *obje
     auto address = aethercast_interface_device_get_address(device);
     auto name = aethercast_interface_device_get_name(device);
 
-    std::cout << "Device " << address << " " << name <<" removed" << std::endl;
+    if (inst->json_)
+        std::cout << "{\"event\":\"device-removed\",\"address\":\""
+                  << JsonEscape(address ?: "") << "\",\"name\":\""
+                  << JsonEscape(name ?: "") << "\"}" << std::endl;
+    else
+        std::cout << "Device " << address << " " << name <<" removed" << std::endl;
 }
 
 void Application::OnObjectManagerCreated(GObject *object, GAsyncResult *res, gpointer user_data) {
@@ -557,7 +677,126 @@ void Application::OnObjectManagerCreated(GObject *object, GAsyncResult *res, gpo
     g_signal_connect(inst->object_manager_, "object-added", G_CALLBACK(&Application::OnDeviceAdded), inst);
     g_signal_connect(inst->object_manager_, "object-removed", G_CALLBACK(&Application::OnDeviceRemoved), inst);
 
-    inst->SetupStandardInput();
+    if (inst->watch_)
+        // Device state changes arrive through the object manager's
+        // cached proxies, so watching needs no further round-trips.
+        g_signal_connect(inst->object_manager_, "interface-proxy-properties-changed",
+                         G_CALLBACK(&Application::OnDeviceProxyPropertiesChanged), inst);
+
+    if (inst->interactive_)
+        inst->SetupStandardInput();
+
+    inst->objects_ready_ = true;
+    inst->MaybeEmitStatus();
+}
+
+void Application::OnDeviceProxyPropertiesChanged(GDBusObjectManagerClient *manager,
+                                                 GDBusObjectProxy *object_proxy,
+                                                 GDBusProxy *interface_proxy,
+                                                 GVariant *changed_properties,
+                                                 const gchar* const *invalidated_properties,
+                                                 gpointer user_data) {
+    auto inst = static_cast<Application*>(user_data);
+
+    if (g_strcmp0(g_dbus_proxy_get_interface_name(interface_proxy), "org.aethercast.Device") != 0)
+        return;
+
+    auto device = AETHERCAST_INTERFACE_DEVICE(interface_proxy);
+    const std::string address = aethercast_interface_device_get_address(device) ?: "";
+
+    GVariantIter iter;
+    g_variant_iter_init(&iter, changed_properties);
+
+    const gchar *key = nullptr;
+    GVariant *value = nullptr;
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        if (inst->json_) {
+            std::cout << "{\"event\":\"device-changed\",\"address\":\""
+                      << JsonEscape(address) << "\",\"property\":\""
+                      << JsonEscape(key) << "\",\"value\":"
+                      << VariantToJsonValue(value) << "}" << std::endl;
+        } else {
+            std::cout << "[CHG] Device " << address << " " << key << " changed: ";
+            if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+                std::cout << g_variant_get_string(value, nullptr) << std::endl;
+            else if (g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN))
+                std::cout << std::boolalpha << (bool) g_variant_get_boolean(value) << std::endl;
+            else {
+                auto printed = g_variant_print(value, FALSE);
+                std::cout << printed << std::endl;
+                g_free(printed);
+            }
+        }
+        g_variant_unref(value);
+    }
+}
+
+void Application::MaybeEmitStatus() {
+    if (interactive_)
+        return;
+
+    if (!manager_ready_ || !objects_ready_)
+        return;
+
+    EmitStatus();
+
+    if (!watch_)
+        g_main_loop_quit(main_loop_);
+}
+
+void Application::EmitStatus() {
+    if (!json_) {
+        HandleShowCommand("");
+        HandleDevicesCommand("");
+        return;
+    }
+
+    std::stringstream out;
+
+    out << "{\"enabled\":"
+        << (aethercast_interface_manager_get_enabled(manager_) ? "true" : "false")
+        << ",\"state\":\""
+        << JsonEscape(aethercast_interface_manager_get_state(manager_) ?: "")
+        << "\",\"scanning\":"
+        << (aethercast_interface_manager_get_scanning(manager_) ? "true" : "false")
+        << ",\"capabilities\":[";
+
+    auto capabilities = aethercast_interface_manager_get_capabilities(manager_);
+    for (int n = 0; capabilities && capabilities[n] != nullptr; n++) {
+        if (n > 0)
+            out << ",";
+        out << "\"" << JsonEscape(capabilities[n]) << "\"";
+    }
+
+    out << "],\"devices\":[";
+
+    bool first = true;
+    ForeachDevice([&](AethercastInterfaceDevice *device) {
+        if (!first)
+            out << ",";
+        first = false;
+
+        out << "{\"address\":\""
+            << JsonEscape(aethercast_interface_device_get_address(device) ?: "")
+            << "\",\"name\":\""
+            << JsonEscape(aethercast_interface_device_get_name(device) ?: "")
+            << "\",\"state\":\""
+            << JsonEscape(aethercast_interface_device_get_state(device) ?: "")
+            << "\",\"capabilities\":[";
+
+        auto device_capabilities = aethercast_interface_device_get_capabilities(device);
+        for (int n = 0; device_capabilities && device_capabilities[n] != nullptr; n++) {
+            if (n > 0)
+                out << ",";
+            out << "\"" << JsonEscape(device_capabilities[n]) << "\"";
+        }
+
+        out << "]}";
+    });
+
+    out << "]}";
+
+    std::cout << out.str() << std::endl;
 }
 
 } // namespace client
@@ -42,11 +42,17 @@ class Application {
 public:
     struct MainOptions {
         static MainOptions FromCommandLine(int argc, char** argv);
+
+        // Print machine readable JSON instead of human readable text
+        bool json;
+        // Stay running and report changes from signal subscriptions
+        // instead of requiring callers to poll
+        bool watch;
     };
 
     static int Main(const MainOptions &options);
 
-    Application();
+    explicit Application(const MainOptions &options);
     ~Application();
 
     int Run();
@@ -91,15 +97,34 @@ private:
     static void OnScanDone(GObject *object, GAsyncResult *res, gpointer user_data);
     static void OnDeviceConnected(GObject *object, GAsyncResult *res, gpointer user_data);
     static void OnDeviceDisconnected(GObject *object, GAsyncResult *res, gpointer user_data);
+
+    static void OnDeviceProxyPropertiesChanged(GDBusObjectManagerClient *manager,
+                                               GDBusObjectProxy *object_proxy,
+                                               GDBusProxy *interface_proxy,
+                                               GVariant *changed_properties,
+                                               const gchar* const *invalidated_properties,
+                                               gpointer user_data);
 private:
     void SetupStandardInput();
     void ForeachDevice(std::function<void(AethercastInterfaceDevice*)> callback, const std::string &address_filter = "");
 
+    // One-shot status emission once both the manager proxy and the
+    // device inventory round-trip have come back
+    void MaybeEmitStatus();
+    void EmitStatus();
+
 private:
     GDBusConnection *bus_connection_;
     AethercastInterfaceManager *manager_;
     guint input_source_;
     GDBusObjectManager *object_manager_;
+    bool json_;
+    bool watch_;
+    // Readline command prompt; off for the scripting modes
+    bool interactive_;
+    bool manager_ready_;
+    bool objects_ready_;
+    int exit_code_;
 
 private:
     // Needs to be static otherwise we can't access it from the readline
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+
+#include <ac/logger.h>
+
+#include "mdnsbrowser.h"
+
+namespace {
+constexpr const char *kMulticastGroup{"224.0.0.251"};
+constexpr uint16_t kMDNSPort{5353};
+constexpr size_t kMaxMessageSize{9000};
+// DNS record types we care about (RFC 1035/2782)
+constexpr uint16_t kTypeA{1};
+constexpr uint16_t kTypePTR{12};
+constexpr uint16_t kTypeSRV{33};
+constexpr uint16_t kClassIN{1};
+// QR bit of the DNS header flags field
+constexpr uint16_t kFlagResponse{0x8000};
+// Upper bound on compression pointer hops; a valid message never
+// chains more names than it has bytes, so this only stops loops.
+constexpr unsigned int kMaxNameJumps{16};
+
+uint16_t ReadU16(const uint8_t *ptr) {
+    return ptr[0] << 8 | ptr[1];
+}
+
+// Reads a possibly compressed DNS name at *offset into name (labels
+// joined with dots, no trailing dot) and advances *offset past its
+// in-place representation. Returns false on malformed input.
+bool ReadName(const uint8_t *data, size_t size, size_t *offset, std::string *name) {
+    size_t pos = *offset;
+    bool jumped = false;
+    unsigned int jumps = 0;
+
+    name->clear();
+
+    while (true) {
+        if (pos >= size)
+            return false;
+
+        const uint8_t length = data[pos];
+
+        if (length == 0) {
+            if (!jumped)
+                *offset = pos + 1;
+            return true;
+        }
+
+        // Compression pointer; the remainder of the name lives at an
+        // earlier position in the message.
+        if ((length & 0xc0) == 0xc0) {
+            if (pos + 2 > size || ++jumps > kMaxNameJumps)
+                return false;
+
+            if (!jumped)
+                *offset = pos + 2;
+            jumped = true;
+
+            pos = ReadU16(data + pos) & 0x3fff;
+            continue;
+        }
+
+        if ((length & 0xc0) != 0 || pos + 1 + length > size)
+            return false;
+
+        if (!name->empty())
+            name->append(".");
+        name->append(reinterpret_cast<const char*>(data + pos + 1), length);
+
+        pos += 1 + length;
+    }
+}
+
+// The service instance's leading label is the sink's display name;
+// everything after it repeats the service type.
+std::string InstanceDisplayName(const std::string &instance) {
+    const auto dot = instance.find('.');
+    return dot == std::string::npos ? instance : instance.substr(0, dot);
+}
+}
+
+namespace infra {
+
+constexpr const char *MDNSBrowser::kDisplayServiceType;
+
+MDNSBrowser::Ptr MDNSBrowser::Create(const std::weak_ptr<Delegate> &delegate) {
+    return std::shared_ptr<MDNSBrowser>(new MDNSBrowser(delegate));
+}
+
+MDNSBrowser::MDNSBrowser(const std::weak_ptr<Delegate> &delegate) :
+    delegate_(delegate),
+    socket_(-1),
+    watch_(0) {
+}
+
+MDNSBrowser::~MDNSBrowser() {
+    Stop();
+}
+
+bool MDNSBrowser::Start() {
+    socket_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_ < 0) {
+        AC_ERROR("Failed to create mDNS socket: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    // Share the port with any resolver daemon already running
+    int value = 1;
+    ::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+#ifdef SO_REUSEPORT
+    ::setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value));
+#endif
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(kMDNSPort);
+
+    if (::bind(socket_, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_ERROR("Failed to bind mDNS socket: %s (%d)", ::strerror(errno), errno);
+        Stop();
+        return false;
+    }
+
+    struct ip_mreq mreq;
+    ::memset(&mreq, 0, sizeof(mreq));
+    ::inet_aton(kMulticastGroup, &mreq.imr_multiaddr);
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    if (::setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        AC_ERROR("Failed to join mDNS multicast group: %s (%d)", ::strerror(errno), errno);
+        Stop();
+        return false;
+    }
+
+    watch_ = g_unix_fd_add(socket_, G_IO_IN, &MDNSBrowser::OnReadable, this);
+
+    return true;
+}
+
+void MDNSBrowser::Stop() {
+    if (watch_ > 0) {
+        g_source_remove(watch_);
+        watch_ = 0;
+    }
+    if (socket_ >= 0) {
+        ::close(socket_);
+        socket_ = -1;
+    }
+}
+
+bool MDNSBrowser::Query() {
+    if (socket_ < 0)
+        return false;
+
+    uint8_t message[128];
+    size_t offset = 0;
+
+    // Header: zero id, standard query, one question
+    ::memset(message, 0, 12);
+    message[5] = 1;
+    offset = 12;
+
+    // QNAME from the dotted service type
+    const char *label = kDisplayServiceType;
+    while (*label != '\0') {
+        const char *end = ::strchrnul(label, '.');
+        const size_t length = end - label;
+
+        message[offset++] = static_cast<uint8_t>(length);
+        ::memcpy(message + offset, label, length);
+        offset += length;
+
+        label = *end == '.' ? end + 1 : end;
+    }
+    message[offset++] = 0;
+
+    // QTYPE PTR, QCLASS IN
+    message[offset++] = 0;
+    message[offset++] = kTypePTR;
+    message[offset++] = 0;
+    message[offset++] = kClassIN;
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    ::inet_aton(kMulticastGroup, &addr.sin_addr);
+    addr.sin_port = htons(kMDNSPort);
+
+    if (::sendto(socket_, message, offset, 0,
+                 reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_WARNING("Failed to send mDNS query: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<MDNSBrowser::Service> MDNSBrowser::ParseResponse(const uint8_t *data, size_t size) {
+    std::vector<Service> services;
+
+    if (size < 12)
+        return services;
+
+    const uint16_t flags = ReadU16(data + 2);
+    if (!(flags & kFlagResponse))
+        return services;
+
+    const uint16_t num_questions = ReadU16(data + 4);
+    // Answer, authority and additional records all may carry the SRV
+    // and A records completing a PTR answer
+    const unsigned int num_records = ReadU16(data + 6) + ReadU16(data + 8)
+            + ReadU16(data + 10);
+
+    size_t offset = 12;
+    std::string name;
+
+    for (unsigned int n = 0; n < num_questions; n++) {
+        if (!ReadName(data, size, &offset, &name) || offset + 4 > size)
+            return services;
+        offset += 4;
+    }
+
+    // Instance names the PTR records announced for our service type,
+    // plus what the SRV and A records resolve them to
+    std::vector<std::string> instances;
+    std::map<std::string, std::pair<std::string, uint16_t>> targets;
+    std::map<std::string, ac::IpV4Address> addresses;
+
+    for (unsigned int n = 0; n < num_records; n++) {
+        if (!ReadName(data, size, &offset, &name) || offset + 10 > size)
+            break;
+
+        const uint16_t type = ReadU16(data + offset);
+        const uint32_t ttl = ReadU16(data + offset + 4) << 16 | ReadU16(data + offset + 6);
+        const uint16_t rdlength = ReadU16(data + offset + 8);
+        offset += 10;
+
+        if (offset + rdlength > size)
+            break;
+
+        // A zero TTL is a goodbye announcement; the regular scan
+        // expiry takes care of forgetting the sink.
+        if (ttl == 0) {
+            offset += rdlength;
+            continue;
+        }
+
+        switch (type) {
+        case kTypePTR: {
+            size_t rdata_offset = offset;
+            std::string instance;
+            if (name == kDisplayServiceType
+                    && ReadName(data, size, &rdata_offset, &instance))
+                instances.push_back(instance);
+            break;
+        }
+        case kTypeSRV: {
+            if (rdlength < 7)
+                break;
+            const uint16_t port = ReadU16(data + offset + 4);
+            size_t rdata_offset = offset + 6;
+            std::string target;
+            if (ReadName(data, size, &rdata_offset, &target))
+                targets[name] = std::make_pair(target, port);
+            break;
+        }
+        case kTypeA: {
+            if (rdlength != 4)
+                break;
+            const uint32_t host = data[offset] << 24 | data[offset + 1] << 16
+                    | data[offset + 2] << 8 | data[offset + 3];
+            addresses[name] = ac::IpV4Address(host);
+            break;
+        }
+        default:
+            break;
+        }
+
+        offset += rdlength;
+    }
+
+    for (const auto &instance : instances) {
+        const auto target = targets.find(instance);
+        if (target == targets.end())
+            continue;
+
+        const auto address = addresses.find(target->second.first);
+        if (address == addresses.end())
+            continue;
+
+        Service service;
+        service.name = InstanceDisplayName(instance);
+        service.address = address->second;
+        service.port = target->second.second;
+        services.push_back(service);
+    }
+
+    return services;
+}
+
+gboolean MDNSBrowser::OnReadable(gint fd, GIOCondition condition, gpointer user_data) {
+    auto thiz = static_cast<MDNSBrowser*>(user_data);
+
+    if (!(condition & G_IO_IN))
+        return TRUE;
+
+    // The socket sees all mDNS traffic on the link; everything which
+    // is not a response describing a display sink falls out of the
+    // parser with an empty result.
+    uint8_t message[kMaxMessageSize];
+    while (true) {
+        const auto bytes_read = ::recv(fd, message, sizeof(message), MSG_DONTWAIT);
+        if (bytes_read <= 0)
+            break;
+
+        for (const auto &service : ParseResponse(message, bytes_read)) {
+            if (auto sp = thiz->delegate_.lock())
+                sp->OnServiceFound(service);
+        }
+    }
+
+    return TRUE;
+}
+
+} // namespace infra
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef INFRA_MDNSBROWSER_H_
+#define INFRA_MDNSBROWSER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ac/glib_wrapper.h>
+#include <ac/ip_v4_address.h>
+#include <ac/non_copyable.h>
+
+namespace infra {
+
+/**
+ * @brief Minimal mDNS-SD browser for display sinks on the local link.
+ *
+ * Multicasts PTR queries for the _display._tcp service Miracast over
+ * infrastructure sinks announce and flattens the PTR/SRV/A records of
+ * the responses into (name, address, port) tuples. Deliberately no
+ * avahi dependency: we only ever browse a single fixed service type
+ * on one socket, which is less code than the client library wiring
+ * and keeps the backend self-contained like the DHCP implementation
+ * on the P2P side.
+ */
+class MDNSBrowser : public std::enable_shared_from_this<MDNSBrowser>,
+                    public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<MDNSBrowser> Ptr;
+
+    // Service type Miracast over infrastructure sinks register
+    static constexpr const char *kDisplayServiceType{"_display._tcp.local"};
+
+    // One announced service instance flattened out of a response's
+    // PTR, SRV and A records
+    struct Service {
+        std::string name;
+        ac::IpV4Address address;
+        std::uint16_t port = 0;
+    };
+
+    class Delegate : public ac::NonCopyable {
+    public:
+        virtual void OnServiceFound(const Service &service) = 0;
+    };
+
+    static Ptr Create(const std::weak_ptr<Delegate> &delegate);
+
+    ~MDNSBrowser();
+
+    bool Start();
+    void Stop();
+
+    // Multicasts one PTR query for the display service; responses
+    // arrive asynchronously through the delegate.
+    bool Query();
+
+    // Extracts every service instance a single response message fully
+    // describes (PTR naming it, SRV with the port, A with the host
+    // address); exposed for the tests which feed canned packets.
+    static std::vector<Service> ParseResponse(const uint8_t *data, size_t size);
+
+private:
+    MDNSBrowser(const std::weak_ptr<Delegate> &delegate);
+
+    static gboolean OnReadable(gint fd, GIOCondition condition, gpointer user_data);
+
+private:
+    std::weak_ptr<Delegate> delegate_;
+    int socket_;
+    guint watch_;
+};
+
+} // namespace infra
+
+#endif
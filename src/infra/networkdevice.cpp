@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "networkdevice.h"
+
+namespace infra {
+
+NetworkDevice::Ptr NetworkDevice::Create(const std::string &name,
+                                         const ac::IpV4Address &address,
+                                         std::uint16_t ctrl_port) {
+    return std::shared_ptr<NetworkDevice>(new NetworkDevice(name, address, ctrl_port));
+}
+
+NetworkDevice::NetworkDevice(const std::string &name, const ac::IpV4Address &address,
+                             std::uint16_t ctrl_port) :
+    name_(name),
+    address_(address),
+    ctrl_port_(ctrl_port),
+    state_(ac::kIdle),
+    scan_generation_(0) {
+}
+
+void NetworkDevice::SetName(const std::string &name) {
+    name_ = name;
+}
+
+void NetworkDevice::SetIpV4Address(const ac::IpV4Address &address) {
+    address_ = address;
+}
+
+void NetworkDevice::SetState(ac::NetworkDeviceState state) {
+    state_ = state;
+}
+
+void NetworkDevice::SetCtrlPort(std::uint16_t port) {
+    ctrl_port_ = port;
+}
+
+void NetworkDevice::SetScanGeneration(std::uint64_t generation) {
+    scan_generation_ = generation;
+}
+
+std::uint64_t NetworkDevice::ScanGeneration() const {
+    return scan_generation_;
+}
+
+std::uint16_t NetworkDevice::CtrlPort() const {
+    return ctrl_port_;
+}
+
+ac::MacAddress NetworkDevice::Address() const {
+    // mDNS announcements carry no MAC; the IP is the stable identity
+    // a sink has on the infrastructure network.
+    return address_.to_string();
+}
+
+ac::IpV4Address NetworkDevice::IPv4Address() const {
+    return address_;
+}
+
+std::string NetworkDevice::Name() const {
+    return name_;
+}
+
+ac::NetworkDeviceState NetworkDevice::State() const {
+    return state_;
+}
+
+ac::NetworkDevice::RoleList NetworkDevice::SupportedRoles() const {
+    // Everything announced over mDNS is a sink; all devices share the
+    // same snapshot.
+    static const auto roles = MakeRoleList({ac::kSink});
+    return roles;
+}
+
+} // namespace infra
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef INFRA_NETWORKDEVICE_H_
+#define INFRA_NETWORKDEVICE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include <ac/networkdevice.h>
+
+namespace infra {
+
+/**
+ * @brief A sink reachable over the regular infrastructure network.
+ *
+ * Unlike the w11tng devices there is no wpa_supplicant object behind
+ * this; everything we know comes from the sink's mDNS announcement,
+ * so the device is a plain value holder the manager keeps up to date
+ * across scan cycles.
+ */
+class NetworkDevice : public ac::NetworkDevice {
+public:
+    typedef std::shared_ptr<NetworkDevice> Ptr;
+
+    static Ptr Create(const std::string &name, const ac::IpV4Address &address,
+                      std::uint16_t ctrl_port);
+
+    void SetName(const std::string &name);
+    void SetIpV4Address(const ac::IpV4Address &address);
+    void SetState(ac::NetworkDeviceState state);
+    void SetCtrlPort(std::uint16_t port);
+
+    // Scan cycle the sink last announced itself in; used to expire
+    // devices which stopped answering instead of rebuilding the set.
+    void SetScanGeneration(std::uint64_t generation);
+    std::uint64_t ScanGeneration() const;
+
+    std::uint16_t CtrlPort() const;
+
+    ac::MacAddress Address() const override;
+    ac::IpV4Address IPv4Address() const override;
+    std::string Name() const override;
+    ac::NetworkDeviceState State() const override;
+    RoleList SupportedRoles() const override;
+
+private:
+    NetworkDevice(const std::string &name, const ac::IpV4Address &address,
+                  std::uint16_t ctrl_port);
+
+private:
+    std::string name_;
+    ac::IpV4Address address_;
+    std::uint16_t ctrl_port_;
+    ac::NetworkDeviceState state_;
+    std::uint64_t scan_generation_;
+};
+
+} // namespace infra
+
+#endif
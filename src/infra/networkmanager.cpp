@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+
+#include <ac/keep_alive.h>
+#include <ac/logger.h>
+
+#include "networkmanager.h"
+
+namespace infra {
+
+ac::NetworkManager::Ptr NetworkManager::Create() {
+    return std::shared_ptr<NetworkManager>(new NetworkManager);
+}
+
+NetworkManager::NetworkManager() :
+    delegate_(nullptr),
+    scanning_(false),
+    scan_generation_(0),
+    scan_timeout_source_(0) {
+}
+
+NetworkManager::~NetworkManager() {
+    Release();
+}
+
+void NetworkManager::SetDelegate(ac::NetworkManager::Delegate *delegate) {
+    delegate_ = delegate;
+}
+
+void NetworkManager::SetCapabilities(const std::vector<Capability> &capabilities) {
+    capabilities_ = capabilities;
+}
+
+std::vector<ac::NetworkManager::Capability> NetworkManager::Capabilities() const {
+    return capabilities_;
+}
+
+bool NetworkManager::Setup() {
+    if (browser_)
+        return true;
+
+    browser_ = MDNSBrowser::Create(shared_from_this());
+    if (!browser_->Start()) {
+        AC_ERROR("Failed to start mDNS browser; infrastructure mode unavailable");
+        browser_.reset();
+        return false;
+    }
+
+    AC_INFO("Infrastructure network manager is up; browsing for %s",
+            MDNSBrowser::kDisplayServiceType);
+
+    // No firmware, rfkill or supplicant to wait for on this path
+    if (delegate_)
+        delegate_->OnReadyChanged();
+
+    return true;
+}
+
+void NetworkManager::Release() {
+    if (scan_timeout_source_ > 0) {
+        g_source_remove(scan_timeout_source_);
+        scan_timeout_source_ = 0;
+    }
+
+    if (browser_) {
+        browser_->Stop();
+        browser_.reset();
+    }
+
+    devices_.clear();
+    connected_device_.reset();
+    scanning_ = false;
+}
+
+void NetworkManager::Scan(const std::chrono::seconds &timeout) {
+    if (!browser_ || scanning_)
+        return;
+
+    scan_generation_++;
+    scanning_ = true;
+
+    browser_->Query();
+
+    if (delegate_)
+        delegate_->OnChanged();
+
+    scan_timeout_source_ = g_timeout_add_seconds_full(G_PRIORITY_DEFAULT, timeout.count(),
+        [](gpointer user_data) -> gboolean {
+            auto inst = static_cast<ac::WeakKeepAlive<NetworkManager>*>(user_data)->GetInstance().lock();
+            if (inst) {
+                inst->scan_timeout_source_ = 0;
+                inst->FinishScan();
+            }
+            return FALSE;
+        },
+        new ac::WeakKeepAlive<NetworkManager>(shared_from_this()),
+        [](gpointer data) { delete static_cast<ac::WeakKeepAlive<NetworkManager>*>(data); });
+}
+
+void NetworkManager::FinishScan() {
+    scanning_ = false;
+
+    ExpireLostDevices();
+
+    if (delegate_)
+        delegate_->OnChanged();
+}
+
+void NetworkManager::ExpireLostDevices() {
+    for (auto it = devices_.begin(); it != devices_.end();) {
+        const auto device = it->second;
+
+        if (device->ScanGeneration() == scan_generation_ || device == connected_device_) {
+            ++it;
+            continue;
+        }
+
+        AC_DEBUG("Sink %s stopped announcing itself", device->Name().c_str());
+
+        it = devices_.erase(it);
+        if (delegate_)
+            delegate_->OnDeviceLost(device);
+    }
+}
+
+void NetworkManager::OnServiceFound(const MDNSBrowser::Service &service) {
+    const auto key = service.address.to_string();
+
+    auto it = devices_.find(key);
+    if (it != devices_.end()) {
+        auto device = it->second;
+        device->SetScanGeneration(scan_generation_);
+
+        if (device->Name() != service.name || device->CtrlPort() != service.port) {
+            device->SetName(service.name);
+            device->SetCtrlPort(service.port);
+            if (delegate_)
+                delegate_->OnDeviceChanged(device);
+        }
+        return;
+    }
+
+    auto device = NetworkDevice::Create(service.name, service.address, service.port);
+    device->SetScanGeneration(scan_generation_);
+    devices_[key] = device;
+
+    AC_DEBUG("Found sink %s at %s:%d", service.name.c_str(), key.c_str(), service.port);
+
+    if (delegate_)
+        delegate_->OnDeviceFound(device);
+}
+
+bool NetworkManager::Connect(const ac::NetworkDevice::Ptr &device) {
+    if (connected_device_) {
+        AC_WARNING("Tried to connect while a connection is already active");
+        return false;
+    }
+
+    const auto key = device->Address();
+    auto it = devices_.find(key);
+    if (it == devices_.end()) {
+        AC_WARNING("Tried to connect unknown device %s", key.c_str());
+        return false;
+    }
+
+    auto sink = it->second;
+
+    // No group negotiation, no DHCP: the sink is already reachable,
+    // so the association states only exist to walk the service
+    // through bringing its RTSP listener up.
+    connected_device_ = sink;
+
+    sink->SetState(ac::kAssociation);
+    if (delegate_)
+        delegate_->OnDeviceStateChanged(sink);
+
+    sink->SetState(ac::kConfiguration);
+    if (delegate_)
+        delegate_->OnDeviceStateChanged(sink);
+
+    sink->SetState(ac::kConnected);
+    if (delegate_)
+        delegate_->OnDeviceStateChanged(sink);
+
+    return true;
+}
+
+bool NetworkManager::Disconnect(const ac::NetworkDevice::Ptr &device) {
+    if (!connected_device_ || device->Address() != connected_device_->Address()) {
+        AC_WARNING("Tried to disconnect a device which is not connected");
+        return false;
+    }
+
+    auto sink = connected_device_;
+    connected_device_.reset();
+
+    sink->SetState(ac::kDisconnected);
+    if (delegate_)
+        delegate_->OnDeviceStateChanged(sink);
+
+    return true;
+}
+
+std::vector<ac::NetworkDevice::Ptr> NetworkManager::Devices() const {
+    std::vector<ac::NetworkDevice::Ptr> devices;
+    for (const auto &entry : devices_)
+        devices.push_back(entry.second);
+    return devices;
+}
+
+ac::IpV4Address NetworkManager::LocalAddress() const {
+    struct ifaddrs *interfaces = nullptr;
+    if (::getifaddrs(&interfaces) < 0) {
+        AC_ERROR("Failed to enumerate network interfaces");
+        return ac::IpV4Address();
+    }
+
+    uint32_t fallback = 0;
+    uint32_t matched = 0;
+
+    const uint32_t sink = connected_device_
+            ? connected_device_->IPv4Address().to_ulong() : 0;
+
+    for (auto entry = interfaces; entry != nullptr; entry = entry->ifa_next) {
+        if (!entry->ifa_addr || entry->ifa_addr->sa_family != AF_INET)
+            continue;
+        if ((entry->ifa_flags & IFF_LOOPBACK) || !(entry->ifa_flags & IFF_UP))
+            continue;
+
+        const auto address = ntohl(reinterpret_cast<struct sockaddr_in*>(
+                                       entry->ifa_addr)->sin_addr.s_addr);
+
+        if (fallback == 0)
+            fallback = address;
+
+        // Prefer the interface which shares a subnet with the sink we
+        // are connected to; that is the one its RTSP connection will
+        // arrive on.
+        if (sink != 0 && entry->ifa_netmask) {
+            const auto netmask = ntohl(reinterpret_cast<struct sockaddr_in*>(
+                                           entry->ifa_netmask)->sin_addr.s_addr);
+            if ((address & netmask) == (sink & netmask))
+                matched = address;
+        }
+    }
+
+    ::freeifaddrs(interfaces);
+
+    return ac::IpV4Address(matched != 0 ? matched : fallback);
+}
+
+bool NetworkManager::Running() const {
+    return browser_ != nullptr;
+}
+
+bool NetworkManager::Scanning() const {
+    return scanning_;
+}
+
+bool NetworkManager::Ready() const {
+    return browser_ != nullptr;
+}
+
+} // namespace infra
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef INFRA_NETWORKMANAGER_H_
+#define INFRA_NETWORKMANAGER_H_
+
+#include <unordered_map>
+
+#include <ac/networkmanager.h>
+
+#include "mdnsbrowser.h"
+#include "networkdevice.h"
+
+namespace infra {
+
+/**
+ * @brief Streams to sinks over the existing infrastructure network.
+ *
+ * Instead of negotiating a P2P group through wpa_supplicant the sinks
+ * are discovered via mDNS on the regular interface and sessions ride
+ * the same RTSP machinery pointed at an address reachable through it.
+ * On 5GHz infrastructure the radio link is typically several times
+ * faster than P2P, connects skip the whole group negotiation and DHCP
+ * dance, and wired sinks become reachable at all.
+ *
+ * There is no link to manage here: Connect() only walks the device
+ * through the association states so the service brings the RTSP
+ * listener up; the sink then connects to it like over the P2P path.
+ */
+class NetworkManager : public std::enable_shared_from_this<NetworkManager>,
+                       public ac::NetworkManager,
+                       public MDNSBrowser::Delegate {
+public:
+    static ac::NetworkManager::Ptr Create();
+
+    ~NetworkManager();
+
+    void SetDelegate(ac::NetworkManager::Delegate *delegate) override;
+
+    void SetCapabilities(const std::vector<Capability> &capabilities) override;
+    std::vector<Capability> Capabilities() const override;
+
+    bool Setup() override;
+    void Release() override;
+
+    void Scan(const std::chrono::seconds &timeout) override;
+    bool Connect(const ac::NetworkDevice::Ptr &device) override;
+    bool Disconnect(const ac::NetworkDevice::Ptr &device) override;
+
+    std::vector<ac::NetworkDevice::Ptr> Devices() const override;
+    ac::IpV4Address LocalAddress() const override;
+    bool Running() const override;
+    bool Scanning() const override;
+    bool Ready() const override;
+
+    void OnServiceFound(const MDNSBrowser::Service &service) override;
+
+private:
+    NetworkManager();
+
+    void FinishScan();
+    // Drops every device which did not answer during the current scan
+    // cycle; the connected one is kept regardless.
+    void ExpireLostDevices();
+
+private:
+    ac::NetworkManager::Delegate *delegate_;
+    std::vector<Capability> capabilities_;
+    MDNSBrowser::Ptr browser_;
+    // Keyed by the sink's IP which doubles as its device address
+    std::unordered_map<std::string, NetworkDevice::Ptr> devices_;
+    NetworkDevice::Ptr connected_device_;
+    bool scanning_;
+    std::uint64_t scan_generation_;
+    guint scan_timeout_source_;
+};
+
+} // namespace infra
+
+#endif
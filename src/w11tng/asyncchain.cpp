@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <ac/logger.h>
+
+#include "asyncchain.h"
+
+namespace w11tng {
+AsyncChain::Ptr AsyncChain::Create() {
+    return Ptr{new AsyncChain{}};
+}
+
+AsyncChain::AsyncChain() :
+    next_group_(0),
+    pending_(0),
+    running_(false),
+    failed_(false) {
+}
+
+AsyncChain::~AsyncChain() {
+}
+
+AsyncChain::Ptr AsyncChain::Then(const Step &step) {
+    groups_.push_back(Group{{step}});
+    return shared_from_this();
+}
+
+AsyncChain::Ptr AsyncChain::ThenAll(const std::vector<Step> &steps) {
+    groups_.push_back(Group{steps});
+    return shared_from_this();
+}
+
+void AsyncChain::Start(const DoneHandler &done_handler) {
+    if (running_)
+        return;
+
+    running_ = true;
+    failed_ = false;
+    next_group_ = 0;
+    done_handler_ = done_handler;
+    self_ = shared_from_this();
+
+    // Pretend one step is outstanding so the Continue below moves us
+    // into the first group.
+    pending_ = 1;
+    Continue();
+}
+
+void AsyncChain::Continue() {
+    if (!running_ || pending_ == 0)
+        return;
+
+    if (--pending_ > 0)
+        return;
+
+    // All members of the current group reported in. A failure only
+    // takes effect here so every outstanding callback of the group
+    // still had a live frame to land on.
+    while (!failed_ && next_group_ < groups_.size()) {
+        const auto &group = groups_[next_group_++];
+        if (group.steps.empty())
+            continue;
+
+        // Hold an extra count while dispatching so a step completing
+        // synchronously cannot advance the chain before its siblings
+        // were started.
+        pending_ = group.steps.size() + 1;
+        for (const auto &step : group.steps)
+            step(self_);
+
+        if (--pending_ > 0)
+            return;
+    }
+
+    Finish();
+}
+
+void AsyncChain::Fail(const std::string &reason) {
+    if (!running_)
+        return;
+
+    AC_WARNING("Async operation failed: %s", reason);
+
+    failed_ = true;
+    Continue();
+}
+
+void AsyncChain::Finish() {
+    running_ = false;
+
+    const auto done_handler = done_handler_;
+    done_handler_ = DoneHandler{};
+
+    // Keeps the frame alive until the handler returned; the context
+    // goes away afterwards so finishing breaks any ownership loop
+    // between the chain and the object it works on.
+    const auto self = self_;
+    self_.reset();
+
+    if (done_handler)
+        done_handler(!failed_);
+
+    context_.reset();
+}
+
+void AsyncChain::SetContext(const std::shared_ptr<void> &context) {
+    context_ = context;
+}
+
+gpointer AsyncChain::AsUserData() {
+    return this;
+}
+
+AsyncChain::Ptr AsyncChain::FromUserData(gpointer user_data) {
+    return static_cast<AsyncChain*>(user_data)->shared_from_this();
+}
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef W11TNG_ASYNCCHAIN_H_
+#define W11TNG_ASYNCCHAIN_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ac/glib_wrapper.h>
+
+#include <ac/non_copyable.h>
+
+namespace w11tng {
+// Flattens a multi-hop asynchronous operation into an ordered list of
+// steps sharing a single heap-allocated frame. Coroutines would give
+// the same shape but need C++20; this is the closest the C++14/GLib
+// combination gets: the chain keeps itself alive from Start until the
+// last step finished, so the per-hop keep-alive allocation and its
+// refcount traffic go away — a GDBus callback just carries the frame
+// as plain user_data via AsUserData/FromUserData.
+//
+// A step runs when its predecessor called Continue and hands control
+// back through Continue or Fail, either directly or from a callback
+// it scheduled. Steps grouped with ThenAll start together and the
+// chain moves on once every member reported in, which is the shape
+// the parallel probe and property fetch paths want.
+class AsyncChain : public std::enable_shared_from_this<AsyncChain>,
+                   private ac::NonCopyable {
+public:
+    typedef std::shared_ptr<AsyncChain> Ptr;
+    typedef std::function<void(const Ptr&)> Step;
+    typedef std::function<void(bool)> DoneHandler;
+
+    static Ptr Create();
+
+    ~AsyncChain();
+
+    // Append a step running after all previously appended ones.
+    Ptr Then(const Step &step);
+    // Append a group of steps which all start at once; the chain
+    // continues when the last of them called Continue. A Fail from
+    // any member finishes the chain once the others reported in.
+    Ptr ThenAll(const std::vector<Step> &steps);
+
+    void Start(const DoneHandler &done_handler = DoneHandler{});
+
+    // Hand control back from a step; the next step (or the done
+    // handler) runs immediately from here.
+    void Continue();
+    // Like Continue but marks the operation failed; the remaining
+    // steps are skipped.
+    void Fail(const std::string &reason);
+
+    // The chain frame as callback context for an async hop. Valid
+    // until the done handler ran as the chain holds itself alive
+    // while running.
+    gpointer AsUserData();
+    static Ptr FromUserData(gpointer user_data);
+
+    // The object the operation belongs to; kept alive together with
+    // the frame so a callback reaching it through the chain never
+    // races its owner going away. Dropped when the chain finished.
+    void SetContext(const std::shared_ptr<void> &context);
+    template<typename T>
+    std::shared_ptr<T> ContextAs() const {
+        return std::static_pointer_cast<T>(context_);
+    }
+
+private:
+    AsyncChain();
+
+    void Finish();
+
+private:
+    struct Group {
+        std::vector<Step> steps;
+    };
+
+    std::vector<Group> groups_;
+    std::size_t next_group_;
+    std::size_t pending_;
+    bool running_;
+    bool failed_;
+    DoneHandler done_handler_;
+    Ptr self_;
+    std::shared_ptr<void> context_;
+};
+}
+
+#endif
@@ -19,20 +19,42 @@
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #include <sys/socket.h>
-#include <sys/prctl.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <unistd.h>
 
-#include <boost/filesystem.hpp>
+#include <cstring>
 
 #include <ac/logger.h>
 #include <ac/networkutils.h>
 #include <ac/keep_alive.h>
-#include <ac/scoped_gobject.h>
 
 #include <ac/config.h>
 #include <w11tng/config.h>
 
 #include "dhcpclient.h"
-#include "dhcpleaseparser.h"
+
+namespace {
+constexpr const char *kAnyAddress{"0.0.0.0"};
+constexpr const char *kLimitedBroadcastAddress{"255.255.255.255"};
+constexpr std::uint16_t kServerPort{67};
+constexpr std::uint16_t kClientPort{68};
+constexpr unsigned int kRetryIntervalSeconds{2};
+constexpr unsigned char kDefaultPrefixLength{24};
+
+unsigned char PrefixLengthFromMask(const ac::IpV4Address &mask) {
+    if (mask.to_ulong() == 0)
+        return kDefaultPrefixLength;
+
+    unsigned char length = 0;
+    auto value = mask.to_ulong();
+    while (value & 0x80000000ul) {
+        length++;
+        value <<= 1;
+    }
+    return length;
+}
+}
 
 namespace w11tng {
 
@@ -44,16 +66,18 @@ DhcpClient::Ptr DhcpClient::Create(const std::weak_ptr<Delegate> &delegate, cons
 
 DhcpClient::DhcpClient(const std::weak_ptr<Delegate> &delegate, const std::string &interface_name) :
     delegate_(delegate),
-    interface_name_(interface_name) {
-
-    lease_file_path_ = ac::Utils::Sprintf("%s/dhclient-%s-%s.leases",
-                                    ac::kRuntimePath,
-                                    boost::filesystem::unique_path().string(),
-                                    interface_name_);
+    interface_name_(interface_name),
+    socket_source_(0),
+    retry_source_(0),
+    transaction_id_(0),
+    lease_acquired_(false) {
 }
 
 DhcpClient::~DhcpClient() {
-    ::unlink(lease_file_path_.c_str());
+    if (socket_source_ > 0)
+        g_source_remove(socket_source_);
+
+    StopRetryTimeout();
 }
 
 ac::IpV4Address DhcpClient::LocalAddress() const {
@@ -65,48 +89,235 @@ ac::IpV4Address DhcpClient::RemoteAddress() const {
 }
 
 void DhcpClient::Start() {
-    if (!ac::Utils::CreateFile(lease_file_path_)) {
-        AC_ERROR("Failed to create database for DHCP leases at %s",
-                  lease_file_path_);
+    struct ifreq ifr;
+    ::memset(&ifr, 0, sizeof(ifr));
+    ::strncpy(ifr.ifr_name, interface_name_.c_str(), sizeof(ifr.ifr_name) - 1);
+
+    auto fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || ::ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+        AC_ERROR("Failed to determine hardware address of %s", interface_name_);
+        if (fd >= 0)
+            ::close(fd);
+        return;
+    }
+    ::close(fd);
+
+    hardware_address_.assign(ifr.ifr_hwaddr.sa_data, ifr.ifr_hwaddr.sa_data + 6);
+
+    GError *error = nullptr;
+    ac::ScopedGObject<GSocket> socket{g_socket_new(G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error)};
+    if (!socket) {
+        AC_ERROR("Failed to create DHCP client socket: %s", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    // We have no address on the interface yet so everything runs over
+    // the wildcard address with the socket tied to the P2P interface.
+    if (::setsockopt(g_socket_get_fd(socket.get()), SOL_SOCKET, SO_BINDTODEVICE,
+                     interface_name_.c_str(), interface_name_.length()) < 0) {
+        AC_ERROR("Failed to bind DHCP client socket to %s", interface_name_);
+        return;
+    }
+
+    g_socket_set_broadcast(socket.get(), TRUE);
+
+    auto addr = g_inet_socket_address_new_from_string(kAnyAddress, kClientPort);
+    if (!g_socket_bind(socket.get(), addr, TRUE, &error)) {
+        AC_ERROR("Failed to bind DHCP client socket: %s", error->message);
+        g_error_free(error);
+        g_object_unref(addr);
+        return;
+    }
+    g_object_unref(addr);
+
+    auto source = g_socket_create_source(socket.get(), G_IO_IN, nullptr);
+    if (!source) {
+        AC_ERROR("Failed to setup listener for DHCP replies");
+        return;
+    }
+
+    g_source_set_callback(source, (GSourceFunc) &DhcpClient::OnIncomingData,
+                          new ac::WeakKeepAlive<DhcpClient>(shared_from_this()),
+                          [](gpointer data) {
+                              delete static_cast<ac::WeakKeepAlive<DhcpClient>*>(data);
+                          });
+
+    socket_source_ = g_source_attach(source, nullptr);
+    if (socket_source_ == 0) {
+        AC_ERROR("Failed to attach source to mainloop");
+        g_source_unref(source);
         return;
     }
 
-    monitor_ = FileMonitor::Create(lease_file_path_, shared_from_this());
-
-    std::vector<std::string> argv = {
-        // Disable background on lease (let dhclient not fork)
-        "-d",
-        // Be verbose and not quiet on startup
-        "-v",
-        // Force us to be IPv4 no matter what the default is
-        "-4",
-        // Use the temporary lease file we used above to not interfere
-        // with any other parts in the system which are using dhclient
-        // as well. We also want a fresh lease file on every start.
-        "-lf", lease_file_path_,
-        // We only want dhclient to operate on the P2P interface an no other
-        interface_name_
-    };
-
-    executor_ = ProcessExecutor::Create(kDhcpClientPath, argv, shared_from_this());
+    g_source_unref(source);
+
+    socket_.swap(socket);
+
+    transaction_id_ = g_random_int();
+
+    SendDiscover();
+    StartRetryTimeout();
 }
 
-void DhcpClient::OnProcessTerminated() {
-    if (auto sp = delegate_.lock())
-        sp->OnDhcpTerminated();
+void DhcpClient::SendDiscover() {
+    DhcpPacket packet;
+    packet.SetType(DhcpPacket::MessageType::kDiscover);
+    packet.SetTransactionId(transaction_id_);
+    // Replies have to come back broadcasted as we can't receive
+    // unicasts for an address we don't have yet.
+    packet.SetFlags(DhcpPacket::kFlagBroadcast);
+    packet.SetHardwareAddress(hardware_address_);
+
+    const auto data = packet.Pack();
+
+    auto addr = g_inet_socket_address_new_from_string(kLimitedBroadcastAddress, kServerPort);
+
+    GError *error = nullptr;
+    if (g_socket_send_to(socket_.get(), addr, reinterpret_cast<const gchar*>(data.data()),
+                         data.size(), nullptr, &error) < 0) {
+        AC_WARNING("Failed to send DHCP discover: %s", error->message);
+        g_error_free(error);
+    }
+
+    g_object_unref(addr);
 }
 
-void DhcpClient::OnFileChanged(const std::string &path) {
-    auto leases = DhcpLeaseParser::FromFile(path);
-    if (leases.size() != 1)
+void DhcpClient::SendRequest(const DhcpPacket &offer) {
+    DhcpPacket packet;
+    packet.SetType(DhcpPacket::MessageType::kRequest);
+    packet.SetTransactionId(transaction_id_);
+    packet.SetFlags(DhcpPacket::kFlagBroadcast);
+    packet.SetHardwareAddress(hardware_address_);
+    packet.SetAddressOption(DhcpPacket::kOptionRequestedAddress, offer.YourAddress());
+    packet.SetAddressOption(DhcpPacket::kOptionServerIdentifier,
+                            offer.AddressOption(DhcpPacket::kOptionServerIdentifier));
+
+    const auto data = packet.Pack();
+
+    auto addr = g_inet_socket_address_new_from_string(kLimitedBroadcastAddress, kServerPort);
+
+    GError *error = nullptr;
+    if (g_socket_send_to(socket_.get(), addr, reinterpret_cast<const gchar*>(data.data()),
+                         data.size(), nullptr, &error) < 0) {
+        AC_WARNING("Failed to send DHCP request: %s", error->message);
+        g_error_free(error);
+    }
+
+    g_object_unref(addr);
+}
+
+gboolean DhcpClient::OnIncomingData(GSocket *socket, GIOCondition cond, gpointer user_data) {
+    auto inst = static_cast<ac::WeakKeepAlive<DhcpClient>*>(user_data)->GetInstance().lock();
+
+    if (not inst)
+        return FALSE;
+
+    guint8 buffer[1500] = { };
+    auto bytes_read = g_socket_receive(inst->socket_.get(), reinterpret_cast<gchar*>(buffer),
+                                       sizeof(buffer), nullptr, nullptr);
+    if (bytes_read <= 0)
+        return TRUE;
+
+    auto packet = DhcpPacket::Parse(buffer, bytes_read);
+    if (!packet.Valid() || packet.Op() != DhcpPacket::kBootReply ||
+            packet.TransactionId() != inst->transaction_id_)
+        return TRUE;
+
+    inst->ProcessPacket(packet);
+
+    return TRUE;
+}
+
+void DhcpClient::ProcessPacket(const DhcpPacket &packet) {
+    switch (packet.Type()) {
+    case DhcpPacket::MessageType::kOffer:
+        if (lease_acquired_)
+            break;
+
+        AC_DEBUG("Received offer for %s", packet.YourAddress().to_string());
+
+        SendRequest(packet);
+        break;
+    case DhcpPacket::MessageType::kAck:
+        if (lease_acquired_)
+            break;
+
+        ApplyLease(packet);
+        break;
+    case DhcpPacket::MessageType::kNak:
+        AC_WARNING("Server declined our lease request; starting over");
+
+        transaction_id_ = g_random_int();
+        SendDiscover();
+        break;
+    default:
+        break;
+    }
+}
+
+void DhcpClient::ApplyLease(const DhcpPacket &ack) {
+    const auto address = ack.YourAddress();
+    const auto prefix_length = PrefixLengthFromMask(ack.AddressOption(DhcpPacket::kOptionSubnetMask));
+
+    auto broadcast = ack.AddressOption(DhcpPacket::kOptionBroadcastAddress);
+
+    auto interface_index = ac::NetworkUtils::RetrieveInterfaceIndex(interface_name_.c_str());
+    if (interface_index < 0) {
+        AC_ERROR("Failed to determine index of network interface: %s", interface_name_);
         return;
+    }
 
-    auto actual_lease = leases[0];
+    if (ac::NetworkUtils::ModifyInterfaceAddress(RTM_NEWADDR, NLM_F_REPLACE | NLM_F_ACK, interface_index,
+                                    AF_INET, address.to_string().c_str(), NULL, prefix_length,
+                                    broadcast.to_ulong() != 0 ? broadcast.to_string().c_str() : nullptr) < 0) {
+        AC_ERROR("Failed to assign network address for %s", interface_name_);
+        return;
+    }
 
-    local_address_ = actual_lease.FixedAddress();
-    remote_address_ = actual_lease.Gateway();
+    local_address_ = address;
+
+    // The group owner is our gateway; fall back to the responding
+    // server when it doesn't announce itself as a router explicitly.
+    remote_address_ = ack.AddressOption(DhcpPacket::kOptionRouter);
+    if (remote_address_.to_ulong() == 0)
+        remote_address_ = ack.AddressOption(DhcpPacket::kOptionServerIdentifier);
+
+    lease_acquired_ = true;
+    StopRetryTimeout();
+
+    AC_DEBUG("Acquired lease %s with gateway %s",
+             local_address_.to_string(), remote_address_.to_string());
 
     if (auto sp = delegate_.lock())
         sp->OnDhcpAddressAssigned(local_address_, remote_address_);
 }
+
+void DhcpClient::StartRetryTimeout() {
+    retry_source_ = g_timeout_add_seconds(kRetryIntervalSeconds, [](gpointer user_data) {
+        auto inst = static_cast<ac::WeakKeepAlive<DhcpClient>*>(user_data)->GetInstance().lock();
+
+        if (not inst)
+            return FALSE;
+
+        if (inst->lease_acquired_) {
+            inst->retry_source_ = 0;
+            return FALSE;
+        }
+
+        // Discover and request datagrams can both get lost on the
+        // fresh link; simply restarting the exchange covers either.
+        inst->SendDiscover();
+
+        return TRUE;
+    }, new ac::WeakKeepAlive<DhcpClient>{shared_from_this()});
+}
+
+void DhcpClient::StopRetryTimeout() {
+    if (retry_source_ == 0)
+        return;
+
+    g_source_remove(retry_source_);
+    retry_source_ = 0;
+}
 } // namespace w11tng
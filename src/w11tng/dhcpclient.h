@@ -20,20 +20,25 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <ac/glib_wrapper.h>
 
 #include <ac/ip_v4_address.h>
 #include <ac/non_copyable.h>
+#include <ac/scoped_gobject.h>
 
-#include "processexecutor.h"
-#include "filemonitor.h"
+#include "dhcppacket.h"
 
 namespace w11tng {
-class DhcpClient : public std::enable_shared_from_this<DhcpClient>,
-                   public w11tng::ProcessExecutor::Delegate,
-                   public w11tng::FileMonitor::Delegate {
+// Acquires the single lease we need on a P2P link directly from our
+// process. The discover/request exchange runs event-driven on the
+// GLib loop which makes the lease available within a round-trip
+// instead of the seconds an external client plus lease-file polling
+// used to take.
+class DhcpClient : public std::enable_shared_from_this<DhcpClient> {
 public:
     typedef std::shared_ptr<DhcpClient> Ptr;
 
@@ -50,21 +55,32 @@ public:
     ac::IpV4Address RemoteAddress() const;
     ac::IpV4Address LocalAddress() const;
 
-    void OnProcessTerminated() override;
-    void OnFileChanged(const std::string &path) override;
-
 private:
+    static gboolean OnIncomingData(GSocket *socket, GIOCondition cond, gpointer user_data);
+
     DhcpClient(const std::weak_ptr<Delegate> &delegate, const std::string &interface_name);
+
     void Start();
 
+    void SendDiscover();
+    void SendRequest(const DhcpPacket &offer);
+    void ProcessPacket(const DhcpPacket &packet);
+    void ApplyLease(const DhcpPacket &ack);
+
+    void StartRetryTimeout();
+    void StopRetryTimeout();
+
 private:
     std::weak_ptr<Delegate> delegate_;
     std::string interface_name_;
     ac::IpV4Address local_address_;
     ac::IpV4Address remote_address_;
-    std::string lease_file_path_;
-    ProcessExecutor::Ptr executor_;
-    FileMonitor::Ptr monitor_;
+    ac::ScopedGObject<GSocket> socket_;
+    guint socket_source_;
+    guint retry_source_;
+    std::uint32_t transaction_id_;
+    std::vector<std::uint8_t> hardware_address_;
+    bool lease_acquired_;
 };
 }
 
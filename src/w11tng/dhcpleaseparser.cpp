@@ -32,12 +32,22 @@
 
 namespace w11tng {
 std::vector<DhcpLeaseInfo> DhcpLeaseParser::FromFile(const std::string &path) {
+    std::size_t offset = 0;
+    return FromFile(path, offset);
+}
+
+std::vector<DhcpLeaseInfo> DhcpLeaseParser::FromFile(const std::string &path, std::size_t &offset) {
     std::vector<DhcpLeaseInfo> leases;
 
     if (!boost::filesystem::is_regular_file(path))
         return {};
 
+    const auto file_size = boost::filesystem::file_size(path);
+    if (file_size < offset)
+        offset = 0;
+
     std::ifstream stream(path);
+    stream.seekg(offset);
     std::string line;
     DhcpLeaseInfo current_lease;
     bool in_lease = false;
@@ -66,6 +76,13 @@ std::vector<DhcpLeaseInfo> DhcpLeaseParser::FromFile(const std::string &path) {
             leases.push_back(current_lease);
             current_lease = DhcpLeaseInfo();
             in_lease = false;
+
+            // Remember where the last complete record ended so the next
+            // incremental call only has to look at appended data. A
+            // partially written trailing record is reconsidered then.
+            const auto pos = stream.tellg();
+            offset = pos >= 0 ? static_cast<std::size_t>(pos) : file_size;
+
             continue;
         }
 
@@ -76,6 +93,16 @@ std::vector<DhcpLeaseInfo> DhcpLeaseParser::FromFile(const std::string &path) {
         if (colon_pos != std::string::npos)
             line = line.substr(0, colon_pos);
 
+        // Not an option statement so the generic key/value tokenizer
+        // below would misparse it; the MAC is what the lease registry
+        // keys records on.
+        if (ac::Utils::StringStartsWith(line, "hardware ethernet")) {
+            auto parts = ac::Utils::StringSplit(line, ' ');
+            if (parts.size() == 3)
+                current_lease.hardware_address_ = boost::algorithm::to_lower_copy(parts[2]);
+            continue;
+        }
+
         std::map<std::string,std::string> options;
 
         try {
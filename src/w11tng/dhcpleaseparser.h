@@ -24,16 +24,32 @@
 #include <ac/glib_wrapper.h>
 
 #include <ac/ip_v4_address.h>
+#include <ac/mac_address.h>
 
 namespace w11tng {
 class DhcpLeaseInfo {
 public:
+    DhcpLeaseInfo() = default;
+    DhcpLeaseInfo(const std::string &interface,
+                  const ac::MacAddress &hardware_address,
+                  const ac::IpV4Address &fixed_address,
+                  const ac::IpV4Address &gateway) :
+        interface_(interface),
+        hardware_address_(hardware_address),
+        fixed_address_(fixed_address),
+        gateway_(gateway) {
+    }
+
     std::string Interface() const { return interface_; }
+    // Lowercased colon-separated MAC of the lease holder; empty when
+    // the record did not carry a hardware ethernet statement.
+    ac::MacAddress HardwareAddress() const { return hardware_address_; }
     ac::IpV4Address FixedAddress() const { return fixed_address_; }
     ac::IpV4Address Gateway() const { return gateway_; }
 
 private:
     std::string interface_;
+    ac::MacAddress hardware_address_;
     ac::IpV4Address fixed_address_;
     ac::IpV4Address gateway_;
 
@@ -45,6 +61,13 @@ std::ostream& operator<<(std::ostream& out, const DhcpLeaseInfo &lease);
 class DhcpLeaseParser {
 public:
     static std::vector<DhcpLeaseInfo> FromFile(const std::string &path);
+
+    // Incremental variant: starts parsing at offset and advances it to
+    // the end of the last complete lease record so a caller watching the
+    // file only ever parses appended records instead of the whole file.
+    // A file shrinking below the offset (rotation) resets the offset to
+    // zero and parses from the beginning again.
+    static std::vector<DhcpLeaseInfo> FromFile(const std::string &path, std::size_t &offset);
 };
 } // w11tng
 
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <ac/logger.h>
+
+#include "dhcpleaseregistry.h"
+
+namespace w11tng {
+DhcpLeaseRegistry::Ptr DhcpLeaseRegistry::Create() {
+    return Ptr{new DhcpLeaseRegistry{}};
+}
+
+void DhcpLeaseRegistry::Update(const DhcpLeaseInfo &lease) {
+    const auto address = lease.HardwareAddress();
+    if (address.empty()) {
+        AC_DEBUG("Dropping lease for %s without a hardware address",
+              lease.FixedAddress().to_string());
+        return;
+    }
+
+    leases_[boost::algorithm::to_lower_copy(address)] = lease;
+}
+
+void DhcpLeaseRegistry::Remove(const ac::MacAddress &address) {
+    leases_.erase(boost::algorithm::to_lower_copy(address));
+}
+
+boost::optional<DhcpLeaseInfo> DhcpLeaseRegistry::FindByHardwareAddress(const ac::MacAddress &address) const {
+    const auto iter = leases_.find(boost::algorithm::to_lower_copy(address));
+    if (iter == leases_.end())
+        return boost::optional<DhcpLeaseInfo>{};
+
+    return iter->second;
+}
+
+void DhcpLeaseRegistry::RefreshFromFile(const std::string &path) {
+    auto &offset = file_offsets_[path];
+
+    for (const auto &lease : DhcpLeaseParser::FromFile(path, offset))
+        Update(lease);
+}
+
+std::size_t DhcpLeaseRegistry::Size() const {
+    return leases_.size();
+}
+
+void DhcpLeaseRegistry::Clear() {
+    leases_.clear();
+    file_offsets_.clear();
+}
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef W11TNG_DHCPLEASEREGISTRY_H_
+#define W11TNG_DHCPLEASEREGISTRY_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <boost/optional.hpp>
+
+#include <ac/mac_address.h>
+#include <ac/non_copyable.h>
+
+#include "dhcpleaseparser.h"
+
+namespace w11tng {
+// Keeps the currently known DHCP leases in memory keyed by the MAC of
+// the lease holder. The in-process DHCP server and client feed it
+// directly when they hand out or acquire a lease; for an external
+// daemon it tails the lease file incrementally. Either way, resolving
+// the address of a peer during connect is a single hash lookup and
+// repeated queries during session setup never touch the filesystem.
+class DhcpLeaseRegistry : public std::enable_shared_from_this<DhcpLeaseRegistry>,
+                          private ac::NonCopyable {
+public:
+    typedef std::shared_ptr<DhcpLeaseRegistry> Ptr;
+
+    static Ptr Create();
+
+    // Insert or replace the lease for its hardware address; records
+    // without one are dropped as we could never look them up again.
+    void Update(const DhcpLeaseInfo &lease);
+
+    void Remove(const ac::MacAddress &address);
+
+    boost::optional<DhcpLeaseInfo> FindByHardwareAddress(const ac::MacAddress &address) const;
+
+    // Fold any records appended to the lease file since the last call
+    // into the registry; only the new data is parsed as the read
+    // offset is kept per file.
+    void RefreshFromFile(const std::string &path);
+
+    std::size_t Size() const;
+    void Clear();
+
+private:
+    DhcpLeaseRegistry() = default;
+
+private:
+    std::unordered_map<ac::MacAddress, DhcpLeaseInfo> leases_;
+    std::unordered_map<std::string, std::size_t> file_offsets_;
+};
+}
+
+#endif
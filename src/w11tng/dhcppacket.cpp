@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+
+#include <cstring>
+
+#include "dhcppacket.h"
+
+namespace {
+// Fixed-size BOOTP header up to and including the magic cookie.
+constexpr std::size_t kHeaderSize{240};
+// Several DHCP implementations drop anything shorter than the
+// historic BOOTP minimum, so packets are padded up to this size.
+constexpr std::size_t kMinPacketSize{300};
+constexpr std::size_t kHardwareAddressFieldSize{16};
+constexpr std::uint8_t kHardwareTypeEthernet{1};
+constexpr std::uint8_t kOptionPad{0};
+constexpr std::uint8_t kOptionEnd{255};
+const std::uint8_t kMagicCookie[4] = { 0x63, 0x82, 0x53, 0x63 };
+
+std::uint32_t ReadU32(const std::uint8_t *data) {
+    std::uint32_t value = 0;
+    ::memcpy(&value, data, sizeof(value));
+    return ntohl(value);
+}
+
+void WriteU32(std::uint8_t *data, std::uint32_t value) {
+    value = htonl(value);
+    ::memcpy(data, &value, sizeof(value));
+}
+}
+
+namespace w11tng {
+
+constexpr std::uint8_t DhcpPacket::kBootRequest;
+constexpr std::uint8_t DhcpPacket::kBootReply;
+constexpr std::uint8_t DhcpPacket::kOptionSubnetMask;
+constexpr std::uint8_t DhcpPacket::kOptionRouter;
+constexpr std::uint8_t DhcpPacket::kOptionBroadcastAddress;
+constexpr std::uint8_t DhcpPacket::kOptionRequestedAddress;
+constexpr std::uint8_t DhcpPacket::kOptionLeaseTime;
+constexpr std::uint8_t DhcpPacket::kOptionMessageType;
+constexpr std::uint8_t DhcpPacket::kOptionServerIdentifier;
+constexpr std::uint16_t DhcpPacket::kFlagBroadcast;
+
+DhcpPacket::DhcpPacket() :
+    valid_(true),
+    op_(kBootRequest),
+    xid_(0),
+    flags_(0) {
+}
+
+DhcpPacket DhcpPacket::Parse(const std::uint8_t *data, std::size_t size) {
+    DhcpPacket packet;
+
+    if (!data || size < kHeaderSize ||
+            ::memcmp(data + 236, kMagicCookie, sizeof(kMagicCookie)) != 0) {
+        packet.valid_ = false;
+        return packet;
+    }
+
+    packet.op_ = data[0];
+    packet.xid_ = ReadU32(data + 4);
+
+    std::uint16_t flags = 0;
+    ::memcpy(&flags, data + 10, sizeof(flags));
+    packet.flags_ = ntohs(flags);
+
+    packet.ciaddr_ = ac::IpV4Address(ReadU32(data + 12));
+    packet.yiaddr_ = ac::IpV4Address(ReadU32(data + 16));
+
+    auto hlen = data[2];
+    if (hlen > kHardwareAddressFieldSize)
+        hlen = kHardwareAddressFieldSize;
+    packet.chaddr_.assign(data + 28, data + 28 + hlen);
+
+    std::size_t offset = kHeaderSize;
+    while (offset < size) {
+        const auto code = data[offset++];
+        if (code == kOptionPad)
+            continue;
+        if (code == kOptionEnd)
+            break;
+
+        if (offset >= size)
+            break;
+        const std::size_t length = data[offset++];
+        if (offset + length > size)
+            break;
+
+        packet.options_[code].assign(data + offset, data + offset + length);
+        offset += length;
+    }
+
+    return packet;
+}
+
+std::vector<std::uint8_t> DhcpPacket::Pack() const {
+    std::vector<std::uint8_t> data(kHeaderSize, 0);
+
+    data[0] = op_;
+    data[1] = kHardwareTypeEthernet;
+    data[2] = static_cast<std::uint8_t>(chaddr_.size());
+    WriteU32(&data[4], xid_);
+
+    const std::uint16_t flags = htons(flags_);
+    ::memcpy(&data[10], &flags, sizeof(flags));
+
+    WriteU32(&data[12], ciaddr_.to_ulong());
+    WriteU32(&data[16], yiaddr_.to_ulong());
+
+    ::memcpy(&data[28], chaddr_.data(),
+             std::min(chaddr_.size(), kHardwareAddressFieldSize));
+
+    ::memcpy(&data[236], kMagicCookie, sizeof(kMagicCookie));
+
+    for (const auto &option : options_) {
+        data.push_back(option.first);
+        data.push_back(static_cast<std::uint8_t>(option.second.size()));
+        data.insert(data.end(), option.second.begin(), option.second.end());
+    }
+
+    data.push_back(kOptionEnd);
+
+    if (data.size() < kMinPacketSize)
+        data.resize(kMinPacketSize, 0);
+
+    return data;
+}
+
+bool DhcpPacket::Valid() const {
+    return valid_;
+}
+
+void DhcpPacket::SetOp(std::uint8_t op) {
+    op_ = op;
+}
+
+std::uint8_t DhcpPacket::Op() const {
+    return op_;
+}
+
+void DhcpPacket::SetTransactionId(std::uint32_t xid) {
+    xid_ = xid;
+}
+
+std::uint32_t DhcpPacket::TransactionId() const {
+    return xid_;
+}
+
+void DhcpPacket::SetFlags(std::uint16_t flags) {
+    flags_ = flags;
+}
+
+std::uint16_t DhcpPacket::Flags() const {
+    return flags_;
+}
+
+void DhcpPacket::SetClientAddress(const ac::IpV4Address &address) {
+    ciaddr_ = address;
+}
+
+ac::IpV4Address DhcpPacket::ClientAddress() const {
+    return ciaddr_;
+}
+
+void DhcpPacket::SetYourAddress(const ac::IpV4Address &address) {
+    yiaddr_ = address;
+}
+
+ac::IpV4Address DhcpPacket::YourAddress() const {
+    return yiaddr_;
+}
+
+void DhcpPacket::SetHardwareAddress(const std::vector<std::uint8_t> &address) {
+    chaddr_ = address;
+    if (chaddr_.size() > kHardwareAddressFieldSize)
+        chaddr_.resize(kHardwareAddressFieldSize);
+}
+
+std::vector<std::uint8_t> DhcpPacket::HardwareAddress() const {
+    return chaddr_;
+}
+
+void DhcpPacket::SetType(MessageType type) {
+    options_[kOptionMessageType] = { static_cast<std::uint8_t>(type) };
+}
+
+DhcpPacket::MessageType DhcpPacket::Type() const {
+    const auto it = options_.find(kOptionMessageType);
+    if (it == options_.end() || it->second.size() != 1)
+        return MessageType::kInvalid;
+    return static_cast<MessageType>(it->second[0]);
+}
+
+void DhcpPacket::SetAddressOption(std::uint8_t code, const ac::IpV4Address &address) {
+    SetU32Option(code, address.to_ulong());
+}
+
+ac::IpV4Address DhcpPacket::AddressOption(std::uint8_t code) const {
+    return ac::IpV4Address(U32Option(code));
+}
+
+void DhcpPacket::SetU32Option(std::uint8_t code, std::uint32_t value) {
+    std::vector<std::uint8_t> data(sizeof(value), 0);
+    WriteU32(data.data(), value);
+    options_[code] = data;
+}
+
+std::uint32_t DhcpPacket::U32Option(std::uint8_t code) const {
+    const auto it = options_.find(code);
+    if (it == options_.end() || it->second.size() != 4)
+        return 0;
+    return ReadU32(it->second.data());
+}
+
+bool DhcpPacket::HasOption(std::uint8_t code) const {
+    return options_.find(code) != options_.end();
+}
+
+} // namespace w11tng
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef W11TNG_DHCPPACKET_H_
+#define W11TNG_DHCPPACKET_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <ac/ip_v4_address.h>
+
+namespace w11tng {
+
+// Minimal DHCPv4 wire format (RFC 2131/2132); just enough for the
+// single-lease exchange we run on a P2P link. Everything we don't
+// need (relaying, sname/file overloading, client identifiers) is
+// left out on purpose.
+class DhcpPacket {
+public:
+    enum class MessageType : std::uint8_t {
+        kInvalid = 0,
+        kDiscover = 1,
+        kOffer = 2,
+        kRequest = 3,
+        kDecline = 4,
+        kAck = 5,
+        kNak = 6,
+        kRelease = 7
+    };
+
+    static constexpr std::uint8_t kBootRequest{1};
+    static constexpr std::uint8_t kBootReply{2};
+
+    static constexpr std::uint8_t kOptionSubnetMask{1};
+    static constexpr std::uint8_t kOptionRouter{3};
+    static constexpr std::uint8_t kOptionBroadcastAddress{28};
+    static constexpr std::uint8_t kOptionRequestedAddress{50};
+    static constexpr std::uint8_t kOptionLeaseTime{51};
+    static constexpr std::uint8_t kOptionMessageType{53};
+    static constexpr std::uint8_t kOptionServerIdentifier{54};
+
+    // Clients set this in their flags field when they want the reply
+    // broadcasted rather than unicasted to a not yet configured address.
+    static constexpr std::uint16_t kFlagBroadcast{0x8000};
+
+    DhcpPacket();
+
+    static DhcpPacket Parse(const std::uint8_t *data, std::size_t size);
+
+    std::vector<std::uint8_t> Pack() const;
+
+    bool Valid() const;
+
+    void SetOp(std::uint8_t op);
+    std::uint8_t Op() const;
+
+    void SetTransactionId(std::uint32_t xid);
+    std::uint32_t TransactionId() const;
+
+    void SetFlags(std::uint16_t flags);
+    std::uint16_t Flags() const;
+
+    void SetClientAddress(const ac::IpV4Address &address);
+    ac::IpV4Address ClientAddress() const;
+
+    void SetYourAddress(const ac::IpV4Address &address);
+    ac::IpV4Address YourAddress() const;
+
+    void SetHardwareAddress(const std::vector<std::uint8_t> &address);
+    std::vector<std::uint8_t> HardwareAddress() const;
+
+    void SetType(MessageType type);
+    MessageType Type() const;
+
+    void SetAddressOption(std::uint8_t code, const ac::IpV4Address &address);
+    // Returns 0.0.0.0 when the option isn't present.
+    ac::IpV4Address AddressOption(std::uint8_t code) const;
+
+    void SetU32Option(std::uint8_t code, std::uint32_t value);
+    std::uint32_t U32Option(std::uint8_t code) const;
+
+    bool HasOption(std::uint8_t code) const;
+
+private:
+    bool valid_;
+    std::uint8_t op_;
+    std::uint32_t xid_;
+    std::uint16_t flags_;
+    ac::IpV4Address ciaddr_;
+    ac::IpV4Address yiaddr_;
+    std::vector<std::uint8_t> chaddr_;
+    std::map<std::uint8_t, std::vector<std::uint8_t>> options_;
+};
+
+} // namespace w11tng
+
+#endif
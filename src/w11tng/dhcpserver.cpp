@@ -19,19 +19,40 @@
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #include <sys/socket.h>
-#include <sys/prctl.h>
-
-#include <boost/filesystem.hpp>
 
 #include <ac/config.h>
 #include <ac/logger.h>
 #include <ac/networkutils.h>
 #include <ac/keep_alive.h>
+#include <ac/utils.h>
 
 #include <w11tng/config.h>
 
 #include "dhcpserver.h"
-#include "dhcpleaseparser.h"
+
+namespace {
+// FIXME store those defaults somewhere else
+constexpr const char *kLocalAddress{"192.168.7.1"};
+constexpr const char *kLeaseAddress{"192.168.7.5"};
+constexpr const char *kSubnetMask{"255.255.255.0"};
+constexpr const char *kBroadcastAddress{"192.168.7.255"};
+constexpr unsigned char kPrefixLength{24};
+constexpr const char *kAnyAddress{"0.0.0.0"};
+constexpr std::uint32_t kLeaseTime{3600};
+constexpr const char *kLimitedBroadcastAddress{"255.255.255.255"};
+constexpr std::uint16_t kServerPort{67};
+constexpr std::uint16_t kClientPort{68};
+
+ac::MacAddress HardwareAddressToString(const std::vector<std::uint8_t> &address) {
+    std::string result;
+    for (const auto byte : address) {
+        if (!result.empty())
+            result += ":";
+        result += ac::Utils::Sprintf("%02x", static_cast<std::uint16_t>(byte));
+    }
+    return result;
+}
+}
 
 namespace w11tng {
 
@@ -43,87 +64,190 @@ DhcpServer::Ptr DhcpServer::Create(const std::weak_ptr<Delegate> &delegate, cons
 
 DhcpServer::DhcpServer(const std::weak_ptr<Delegate> &delegate, const std::string &interface_name) :
     delegate_(delegate),
-    interface_name_(interface_name) {
-
-    lease_file_path_ = ac::Utils::Sprintf("%s/dhcpd-%s-%s.leases",
-                                           ac::kRuntimePath,
-                                           boost::filesystem::unique_path().string(),
-                                           interface_name);
-
-    pid_file_path_ = ac::Utils::Sprintf("%s/dhcpd-%s.pid",
-                                         ac::kRuntimePath,
-                                         interface_name_);
+    interface_name_(interface_name),
+    socket_source_(0) {
 
-
-    local_address_ = ac::IpV4Address::from_string("192.168.7.1");
+    local_address_ = ac::IpV4Address::from_string(kLocalAddress);
+    lease_address_ = ac::IpV4Address::from_string(kLeaseAddress);
 }
 
 DhcpServer::~DhcpServer() {
-    ::unlink(lease_file_path_.c_str());
-    ::unlink(pid_file_path_.c_str());
+    if (socket_source_ > 0)
+        g_source_remove(socket_source_);
 }
 
 void DhcpServer::Start() {
-    if (boost::filesystem::is_regular(pid_file_path_)) {
-        AC_ERROR("DHCP server already running");
+    auto interface_index = ac::NetworkUtils::RetrieveInterfaceIndex(interface_name_.c_str());
+    if (interface_index < 0)
+        AC_ERROR("Failed to determine index of network interface: %s", interface_name_);
+
+    if (ac::NetworkUtils::ModifyInterfaceAddress(RTM_NEWADDR, NLM_F_REPLACE | NLM_F_ACK, interface_index,
+                                    AF_INET, local_address_.to_string().c_str(),
+                                    NULL, kPrefixLength, kBroadcastAddress) < 0) {
+        AC_ERROR("Failed to assign network address for %s", interface_name_);
         return;
     }
 
-    if (!ac::Utils::CreateFile(lease_file_path_)) {
-        AC_ERROR("Failed to create database for DHCP leases at %s",
-                  lease_file_path_);
+    AC_DEBUG("Assigned network address %s", local_address_.to_string());
+
+    GError *error = nullptr;
+    ac::ScopedGObject<GSocket> socket{g_socket_new(G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error)};
+    if (!socket) {
+        AC_ERROR("Failed to create DHCP server socket: %s", error->message);
+        g_error_free(error);
         return;
     }
 
-    monitor_ = FileMonitor::Create(lease_file_path_, shared_from_this());
+    // Discovery requests come in broadcasted from an unconfigured
+    // client so we have to listen on the wildcard address and tie the
+    // socket to the P2P interface instead.
+    if (::setsockopt(g_socket_get_fd(socket.get()), SOL_SOCKET, SO_BINDTODEVICE,
+                     interface_name_.c_str(), interface_name_.length()) < 0) {
+        AC_ERROR("Failed to bind DHCP server socket to %s", interface_name_);
+        return;
+    }
 
-    // FIXME store those defaults somewhere else
-    const char *broadcast = "192.168.7.255";
-    unsigned char prefixlen = 24;
+    g_socket_set_broadcast(socket.get(), TRUE);
 
-    auto interface_index = ac::NetworkUtils::RetrieveInterfaceIndex(interface_name_.c_str());
-    if (interface_index < 0)
-        AC_ERROR("Failed to determine index of network interface: %s", interface_name_);
+    auto addr = g_inet_socket_address_new_from_string(kAnyAddress, kServerPort);
+    if (!g_socket_bind(socket.get(), addr, TRUE, &error)) {
+        AC_ERROR("Failed to bind DHCP server socket: %s", error->message);
+        g_error_free(error);
+        g_object_unref(addr);
+        return;
+    }
+    g_object_unref(addr);
 
-    if (ac::NetworkUtils::ModifyInterfaceAddress(RTM_NEWADDR, NLM_F_REPLACE | NLM_F_ACK, interface_index,
-                                    AF_INET, local_address_.to_string().c_str(),
-                                    NULL, prefixlen, broadcast) < 0) {
-        AC_ERROR("Failed to assign network address for %s", interface_name_);
+    auto source = g_socket_create_source(socket.get(), G_IO_IN, nullptr);
+    if (!source) {
+        AC_ERROR("Failed to setup listener for DHCP requests");
         return;
     }
 
-    AC_DEBUG("Assigned network address %s", local_address_.to_string());
+    g_source_set_callback(source, (GSourceFunc) &DhcpServer::OnIncomingData,
+                          new ac::WeakKeepAlive<DhcpServer>(shared_from_this()),
+                          [](gpointer data) {
+                              delete static_cast<ac::WeakKeepAlive<DhcpServer>*>(data);
+                          });
 
-    std::vector<std::string> argv = {
-        "-f", "-4",
-        "-d",
-        "-cf", "/etc/aethercast/dhcpd.conf",
-        "-pf", pid_file_path_,
-        "-lf", lease_file_path_,
-        interface_name_
-    };
+    socket_source_ = g_source_attach(source, nullptr);
+    if (socket_source_ == 0) {
+        AC_ERROR("Failed to attach source to mainloop");
+        g_source_unref(source);
+        return;
+    }
 
-    executor_ = ProcessExecutor::Create(kDhcpServerPath, argv, shared_from_this());
+    g_source_unref(source);
+
+    socket_.swap(socket);
+
+    AC_DEBUG("DHCP server now waiting for requests on %s", interface_name_);
 }
 
-void DhcpServer::OnProcessTerminated() {
-    if (auto sp = delegate_.lock())
-        sp->OnDhcpTerminated();
+gboolean DhcpServer::OnIncomingData(GSocket *socket, GIOCondition cond, gpointer user_data) {
+    auto inst = static_cast<ac::WeakKeepAlive<DhcpServer>*>(user_data)->GetInstance().lock();
+
+    if (not inst)
+        return FALSE;
+
+    guint8 buffer[1500] = { };
+    auto bytes_read = g_socket_receive(inst->socket_.get(), reinterpret_cast<gchar*>(buffer),
+                                       sizeof(buffer), nullptr, nullptr);
+    if (bytes_read <= 0)
+        return TRUE;
+
+    auto packet = DhcpPacket::Parse(buffer, bytes_read);
+    if (!packet.Valid() || packet.Op() != DhcpPacket::kBootRequest)
+        return TRUE;
+
+    inst->ProcessPacket(packet);
+
+    return TRUE;
 }
 
-void DhcpServer::OnFileChanged(const std::string &path) {
-    auto leases = DhcpLeaseParser::FromFile(path);
-    if (leases.size() != 1)
-        return;
+void DhcpServer::ProcessPacket(const DhcpPacket &packet) {
+    switch (packet.Type()) {
+    case DhcpPacket::MessageType::kDiscover: {
+        AC_DEBUG("Offering %s to remote", lease_address_.to_string());
+
+        DhcpPacket reply;
+        reply.SetType(DhcpPacket::MessageType::kOffer);
+        reply.SetYourAddress(lease_address_);
+        SendReply(reply, packet);
+        break;
+    }
+    case DhcpPacket::MessageType::kRequest: {
+        auto requested = packet.AddressOption(DhcpPacket::kOptionRequestedAddress);
+        if (requested.to_ulong() == 0)
+            requested = packet.ClientAddress();
+
+        DhcpPacket reply;
+
+        // We only ever hand out the one lease the P2P link needs; a
+        // client insisting on anything else is told to start over.
+        if (requested != lease_address_) {
+            reply.SetType(DhcpPacket::MessageType::kNak);
+            SendReply(reply, packet);
+            break;
+        }
+
+        reply.SetType(DhcpPacket::MessageType::kAck);
+        reply.SetYourAddress(lease_address_);
+        SendReply(reply, packet);
+
+        AC_DEBUG("Assigned %s to remote", lease_address_.to_string());
+
+        if (lease_registry_)
+            lease_registry_->Update(DhcpLeaseInfo{interface_name_,
+                HardwareAddressToString(packet.HardwareAddress()),
+                lease_address_, local_address_});
+
+        if (auto sp = delegate_.lock())
+            sp->OnDhcpAddressAssigned(local_address_, lease_address_);
+        break;
+    }
+    default:
+        break;
+    }
+}
 
-    auto actual_lease = leases[0];
+void DhcpServer::SendReply(DhcpPacket reply, const DhcpPacket &request) {
+    reply.SetOp(DhcpPacket::kBootReply);
+    reply.SetTransactionId(request.TransactionId());
+    reply.SetFlags(request.Flags());
+    reply.SetHardwareAddress(request.HardwareAddress());
+
+    reply.SetAddressOption(DhcpPacket::kOptionServerIdentifier, local_address_);
+
+    if (reply.Type() != DhcpPacket::MessageType::kNak) {
+        reply.SetU32Option(DhcpPacket::kOptionLeaseTime, kLeaseTime);
+        reply.SetAddressOption(DhcpPacket::kOptionSubnetMask, ac::IpV4Address::from_string(kSubnetMask));
+        reply.SetAddressOption(DhcpPacket::kOptionBroadcastAddress, ac::IpV4Address::from_string(kBroadcastAddress));
+        reply.SetAddressOption(DhcpPacket::kOptionRouter, local_address_);
+    }
 
-    if (auto sp = delegate_.lock())
-        sp->OnDhcpAddressAssigned(local_address_, actual_lease.FixedAddress());
+    const auto data = reply.Pack();
+
+    // The client has no usable address until it processed our ACK so
+    // all replies go out broadcasted on the local link.
+    auto addr = g_inet_socket_address_new_from_string(kLimitedBroadcastAddress, kClientPort);
+
+    GError *error = nullptr;
+    if (g_socket_send_to(socket_.get(), addr, reinterpret_cast<const gchar*>(data.data()),
+                         data.size(), nullptr, &error) < 0) {
+        AC_WARNING("Failed to send DHCP reply: %s", error->message);
+        g_error_free(error);
+    }
+
+    g_object_unref(addr);
 }
 
 ac::IpV4Address DhcpServer::LocalAddress() const {
     return local_address_;
 }
 
+void DhcpServer::SetLeaseRegistry(const DhcpLeaseRegistry::Ptr &registry) {
+    lease_registry_ = registry;
+}
+
 }
@@ -26,14 +26,18 @@
 
 #include <ac/ip_v4_address.h>
 #include <ac/non_copyable.h>
+#include <ac/scoped_gobject.h>
 
-#include "processexecutor.h"
-#include "filemonitor.h"
+#include "dhcppacket.h"
+#include "dhcpleaseregistry.h"
 
 namespace w11tng {
-class DhcpServer : public std::enable_shared_from_this<DhcpServer>,
-                   public ProcessExecutor::Delegate,
-                   public FileMonitor::Delegate {
+// Hands out the single lease a P2P group owner needs directly from
+// our process. Running the exchange on the GLib loop instead of
+// forking an external DHCP daemon and polling its lease file cuts
+// the address assignment down to the two datagram round-trips the
+// protocol actually requires.
+class DhcpServer : public std::enable_shared_from_this<DhcpServer> {
 public:
     typedef std::shared_ptr<DhcpServer> Ptr;
 
@@ -49,22 +53,28 @@ public:
 
     ac::IpV4Address LocalAddress() const;
 
-    void OnProcessTerminated() override;
-    void OnFileChanged(const std::string &path) override;
+    // Every lease we assign is published to the registry keyed by the
+    // client MAC taken from the request packet.
+    void SetLeaseRegistry(const DhcpLeaseRegistry::Ptr &registry);
 
 private:
+    static gboolean OnIncomingData(GSocket *socket, GIOCondition cond, gpointer user_data);
+
     DhcpServer(const std::weak_ptr<Delegate> &delegate, const std::string &interface_name);
 
     void Start();
 
+    void ProcessPacket(const DhcpPacket &packet);
+    void SendReply(DhcpPacket reply, const DhcpPacket &request);
+
 private:
     std::weak_ptr<Delegate> delegate_;
     std::string interface_name_;
-    std::string lease_file_path_;
-    std::string pid_file_path_;
-    ProcessExecutor::Ptr executor_;
-    FileMonitor::Ptr monitor_;
+    ac::ScopedGObject<GSocket> socket_;
+    guint socket_source_;
     ac::IpV4Address local_address_;
+    ac::IpV4Address lease_address_;
+    DhcpLeaseRegistry::Ptr lease_registry_;
 };
 }
 #endif
@@ -15,6 +15,13 @@
  *
  */
 
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <ac/logger.h>
 #include <ac/keep_alive.h>
 
 #include "filemonitor.h"
@@ -27,48 +34,84 @@ FileMonitor::Ptr FileMonitor::Create(const std::string &path, const std::weak_pt
 FileMonitor::Ptr FileMonitor::FinalizeConstruction(const std::string &path) {
     auto sp = shared_from_this();
 
-    auto file_to_watch = g_file_new_for_path(path.c_str());
-    if (!file_to_watch) {
-        AC_ERROR("Failed to access file at path %s", path);
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        AC_ERROR("Failed to initialize inotify: %s", std::strerror(errno));
         return sp;
     }
 
-    GError *error = nullptr;
-    monitor_.reset(g_file_monitor_file(file_to_watch, G_FILE_MONITOR_NONE, nullptr, &error));
-    if (error) {
-        AC_ERROR("Failed to create monitor for file %s: %s", path, error->message);
-        g_error_free(error);
+    watch_ = ::inotify_add_watch(fd_, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE);
+    if (watch_ < 0) {
+        AC_ERROR("Failed to create watch for file %s: %s", path, std::strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
         return sp;
     }
 
-    g_signal_connect_data(monitor_.get(), "changed", G_CALLBACK(&FileMonitor::OnChanged),
-                          new ac::WeakKeepAlive<FileMonitor>(shared_from_this()),
-                          [](gpointer data, GClosure *) { delete static_cast<ac::WeakKeepAlive<FileMonitor>*>(data); },
-                          GConnectFlags(0));
+    path_ = path;
+
+    channel_ = g_io_channel_unix_new(fd_);
+    watch_source_ = g_io_add_watch_full(channel_, G_PRIORITY_DEFAULT,
+                        GIOCondition(G_IO_IN),
+                        &FileMonitor::OnMonitorEvent,
+                        new ac::WeakKeepAlive<FileMonitor>(shared_from_this()),
+                        [](gpointer data) { delete static_cast<ac::WeakKeepAlive<FileMonitor>*>(data); });
 
     return sp;
 }
 
 FileMonitor::FileMonitor(const std::weak_ptr<Delegate> &delegate) :
-    delegate_(delegate) {
+    delegate_(delegate),
+    fd_(-1),
+    watch_(-1),
+    watch_source_(0),
+    channel_(nullptr) {
 }
 
 FileMonitor::~FileMonitor() {
-    g_file_monitor_cancel(monitor_.get());
-}
+    if (watch_source_ > 0)
+        g_source_remove(watch_source_);
+
+    if (channel_)
+        g_io_channel_unref(channel_);
 
-void FileMonitor::OnChanged(GFileMonitor *monitor, GFile *file, GFile *other_file,
-                                GFileMonitorEvent event_type, gpointer user_data) {
+    if (fd_ >= 0) {
+        if (watch_ >= 0)
+            ::inotify_rm_watch(fd_, watch_);
+        ::close(fd_);
+    }
+}
 
+gboolean FileMonitor::OnMonitorEvent(GIOChannel *channel, GIOCondition condition, gpointer user_data) {
     auto thiz = static_cast<ac::WeakKeepAlive<FileMonitor>*>(user_data)->GetInstance().lock();
 
     if (not thiz)
-        return;
+        return FALSE;
+
+    // Drain all queued events; as we only watch a single file every
+    // event we get means the very same thing for our delegate.
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+
+    while (true) {
+        const auto length = ::read(thiz->fd_, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
 
-    if (event_type != G_FILE_MONITOR_EVENT_CHANGED)
-        return;
+        ssize_t pos = 0;
+        while (pos < length) {
+            const auto event = reinterpret_cast<struct inotify_event*>(buffer + pos);
+            if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE))
+                changed = true;
+            pos += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (changed) {
+        if (auto sp = thiz->delegate_.lock())
+            sp->OnFileChanged(thiz->path_);
+    }
 
-    if (auto sp = thiz->delegate_.lock())
-        sp->OnFileChanged(g_file_get_path(file));
+    return TRUE;
 }
 } // namespace w11tng
@@ -19,14 +19,17 @@
 #define W11TNG_FILEMONITOR_H_
 
 #include <memory>
-#include <map>
 #include <string>
 
+#include <ac/glib_wrapper.h>
 #include <ac/non_copyable.h>
-#include <ac/scoped_gobject.h>
 
 namespace w11tng {
 
+// Watches a single file through inotify and tells its delegate as soon
+// as the kernel reports a write. Unlike GFileMonitor this does not
+// coalesce or rate limit events so the notification arrives immediately
+// instead of on the next poll or flush interval.
 class FileMonitor : public std::enable_shared_from_this<FileMonitor> {
 public:
     typedef std::shared_ptr<FileMonitor> Ptr;
@@ -45,12 +48,15 @@ private:
     Ptr FinalizeConstruction(const std::string &path);
 
 private:
-    static void OnChanged(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event_type, gpointer user_data);
+    static gboolean OnMonitorEvent(GIOChannel *channel, GIOCondition condition, gpointer user_data);
 
 private:
     std::weak_ptr<Delegate> delegate_;
-    std::map<std::string,void*> watches_;
-    ac::ScopedGObject<GFileMonitor> monitor_;
+    std::string path_;
+    int fd_;
+    int watch_;
+    guint watch_source_;
+    GIOChannel *channel_;
 };
 
 } // namespace w11tng
@@ -22,6 +22,24 @@
 
 #include "hostname1stub.h"
 
+namespace {
+// The network manager tears this stub down and recreates it on every
+// enable cycle but the identity values it serves change about never.
+// Keeping the last parsed set for the lifetime of the process means
+// only the very first instance pays the GetAll round-trip to
+// systemd-hostnamed; later ones start from the cache and rely on the
+// PropertiesChanged subscription alone. Only ever touched from the
+// main loop.
+struct IdentityCache {
+    bool valid = false;
+    std::string hostname;
+    std::string static_hostname;
+    std::string pretty_hostname;
+    std::string chassis;
+};
+static IdentityCache identity_cache;
+}
+
 namespace w11tng {
 
 Hostname1Stub::Ptr Hostname1Stub::Create(const std::weak_ptr<Delegate> &delegate) {
@@ -50,7 +68,13 @@ Hostname1Stub::Ptr Hostname1Stub::FinalizeConstruction() {
                                        new ac::WeakKeepAlive<Hostname1Stub>(shared_from_this()),
                                        [](gpointer data) { delete static_cast<ac::WeakKeepAlive<Hostname1Stub>*>(data); });
 
-    SyncProperties();
+    if (identity_cache.valid) {
+        hostname_ = identity_cache.hostname;
+        static_hostname_ = identity_cache.static_hostname;
+        pretty_hostname_ = identity_cache.pretty_hostname;
+        chassis_ = identity_cache.chassis;
+    } else
+        SyncProperties();
 
     return sp;
 }
@@ -71,7 +95,11 @@ void Hostname1Stub::OnPropertiesChanged(GDBusConnection *connection, const gchar
     if (not thiz)
         return;
 
-    thiz->ParseProperties(parameters);
+    // hostnamed emits PropertiesChanged for plenty of properties we
+    // don't serve; only an actual identity change is worth having the
+    // manager re-derive the device configuration.
+    if (!thiz->ParseProperties(parameters))
+        return;
 
     if (auto sp = thiz->delegate_.lock())
         sp->OnHostnameChanged();
@@ -100,22 +128,47 @@ void Hostname1Stub::SyncProperties() {
             return;
         }
 
-        thiz->ParseProperties(g_variant_get_child_value(result, 0));
+        // The initial query races with the device bring-up; when it
+        // lands after the configuration was already derived from the
+        // fallbacks the delegate has to be told just like for a
+        // genuine change.
+        if (thiz->ParseProperties(g_variant_get_child_value(result, 0))) {
+            if (auto sp = thiz->delegate_.lock())
+                sp->OnHostnameChanged();
+        }
 
     }, new ac::SharedKeepAlive<Hostname1Stub>{shared_from_this()});
 }
 
-void Hostname1Stub::ParseProperties(GVariant *properties) {
+bool Hostname1Stub::ParseProperties(GVariant *properties) {
+    bool changed = false;
+
+    auto apply = [&](std::string &field, GVariant *value) {
+        const std::string parsed = g_variant_get_string(g_variant_get_variant(value), nullptr) ? : "";
+        if (parsed == field)
+            return;
+        field = parsed;
+        changed = true;
+    };
+
     ac::dbus::Helpers::ParseDictionary(properties, [&](const std::string &key, GVariant *value) {
         if (key == "Hostname")
-            hostname_ = g_variant_get_string(g_variant_get_variant(value), nullptr) ? : "";
+            apply(hostname_, value);
         else if (key == "StaticHostname")
-            static_hostname_ = g_variant_get_string(g_variant_get_variant(value), nullptr) ? : "";
+            apply(static_hostname_, value);
         else if (key == "PrettyHostname")
-            pretty_hostname_ = g_variant_get_string(g_variant_get_variant(value), nullptr) ? : "";
+            apply(pretty_hostname_, value);
         else if (key == "Chassis")
-            chassis_ = g_variant_get_string(g_variant_get_variant(value), nullptr) ? : "";
+            apply(chassis_, value);
     });
+
+    identity_cache.valid = true;
+    identity_cache.hostname = hostname_;
+    identity_cache.static_hostname = static_hostname_;
+    identity_cache.pretty_hostname = pretty_hostname_;
+    identity_cache.chassis = chassis_;
+
+    return changed;
 }
 
 std::string Hostname1Stub::Hostname() const {
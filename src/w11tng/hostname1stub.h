@@ -51,7 +51,7 @@ private:
     Hostname1Stub(const std::weak_ptr<Delegate> &delegate);
     Ptr FinalizeConstruction();
 
-    void ParseProperties(GVariant *properties);
+    bool ParseProperties(GVariant *properties);
     void SyncProperties();
 
 private:
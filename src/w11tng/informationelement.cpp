@@ -73,6 +73,60 @@ void InformationElement::delete_subelement (Subelement *element)
     }
 }
 
+InformationElementView::InformationElementView(const uint8_t *bytes, uint length) :
+    bytes_(bytes),
+    length_(length)
+{
+}
+
+const uint8_t* InformationElementView::find_subelement(SubelementId id) const
+{
+    uint pos = 0;
+
+    while (bytes_ && length_ >= pos + 3) {
+        uint8_t current = bytes_[pos];
+
+        /* Unknown subelement id; we can't know its size so we have to
+         * stop walking here. */
+        if (current > kAlternativeMAC)
+            break;
+
+        size_t subelement_size = SubelementSize[current];
+        if (pos + subelement_size > length_)
+            break;
+
+        if (current == id)
+            return bytes_ + pos;
+
+        pos += subelement_size;
+    }
+
+    return NULL;
+}
+
+bool InformationElementView::has_subelement(SubelementId id) const
+{
+    return find_subelement(id) != NULL;
+}
+
+DeviceType InformationElementView::get_device_type() const
+{
+    const auto dev_info = reinterpret_cast<const DeviceInformationSubelement*>(find_subelement(kDeviceInformation));
+    if (!dev_info)
+        return kDualRole;
+
+    return static_cast<DeviceType>(dev_info->field1.device_type);
+}
+
+int InformationElementView::get_rtsp_port() const
+{
+    const auto dev_info = reinterpret_cast<const DeviceInformationSubelement*>(find_subelement(kDeviceInformation));
+    if (!dev_info)
+        return -1;
+
+    return dev_info->session_management_control_port;
+}
+
 InformationElement::InformationElement(): length_(0) {}
 
 InformationElement::InformationElement(const std::unique_ptr<InformationElementArray> &array)
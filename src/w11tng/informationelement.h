@@ -140,6 +140,24 @@ struct InformationElementArray {
 
 Subelement* new_subelement (SubelementId id);
 
+// Non-owning view over raw WFD IE bytes which parses in place without
+// copying the buffer or allocating per subelement. The caller has to
+// keep the underlying buffer alive while the view is used.
+class InformationElementView {
+  public:
+    InformationElementView(const uint8_t *bytes, uint length);
+
+    bool has_subelement(SubelementId id) const;
+    DeviceType get_device_type() const;
+    int get_rtsp_port() const;
+
+  private:
+    const uint8_t* find_subelement(SubelementId id) const;
+
+    const uint8_t *bytes_;
+    uint length_;
+};
+
 class InformationElement {
   public:
     InformationElement();
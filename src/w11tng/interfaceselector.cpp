@@ -37,7 +37,8 @@ InterfaceSelector::Ptr InterfaceSelector::Create() {
     return std::shared_ptr<InterfaceSelector>(new InterfaceSelector)->FinalizeConstruction();
 }
 
-InterfaceSelector::InterfaceSelector() {
+InterfaceSelector::InterfaceSelector() :
+    selection_notified_(false) {
 }
 
 InterfaceSelector::~InterfaceSelector() {
@@ -66,24 +67,59 @@ void InterfaceSelector::ResetDelegate() {
 }
 
 void InterfaceSelector::Process(const InterfaceList &interfaces) {
-    if (interfaces_.size() > 0)
+    // A selection from an earlier probe round stays valid until rfkill
+    // or interface hotplug events invalidate it so repeated setups don't
+    // have to wait for another round trip to wpa.
+    if (selected_path_.length() > 0) {
+        if (auto sp = delegate_.lock())
+            sp->OnInterfaceSelectionDone(selected_path_);
         return;
+    }
 
-    interfaces_ = interfaces;
-
-    TryNextInterface();
-}
+    if (probe_chain_)
+        return;
 
-void InterfaceSelector::TryNextInterface() {
-    if (interfaces_.size() == 0) {
+    if (interfaces.size() == 0) {
         if (auto sp = delegate_.lock())
             sp->OnInterfaceSelectionDone("");
         return;
     }
 
-    auto object_path = interfaces_.back();
-    interfaces_.pop_back();
+    selection_notified_ = false;
+
+    // Probe all candidates in parallel and resolve the selection from
+    // the first satisfactory answer rather than walking the list one
+    // interface at a time which adds up on devices with multiple radios.
+    // The chain is the one frame shared by all probes; their GDBus
+    // callbacks land on it directly instead of each allocating a
+    // keep-alive of their own.
+    probe_chain_ = AsyncChain::Create();
+    probe_chain_->SetContext(shared_from_this());
+
+    std::vector<AsyncChain::Step> probes;
+    for (const auto &object_path : interfaces)
+        probes.push_back([object_path](const AsyncChain::Ptr &chain) {
+            chain->ContextAs<InterfaceSelector>()->ProbeInterface(object_path, chain);
+        });
+
+    probe_chain_->ThenAll(probes);
+    probe_chain_->Start([this](bool) {
+        // Only reached while the chain holds us through its context so
+        // capturing the raw pointer is safe here.
+        probe_chain_.reset();
+
+        if (!selection_notified_) {
+            if (auto sp = delegate_.lock())
+                sp->OnInterfaceSelectionDone("");
+        }
+    });
+}
+
+void InterfaceSelector::InvalidateSelection() {
+    selected_path_.clear();
+}
 
+void InterfaceSelector::ProbeInterface(const std::string &object_path, const AsyncChain::Ptr &chain) {
     AC_DEBUG("Looking at %s", object_path);
 
     wpa_supplicant_interface_proxy_new(connection_.get(),
@@ -92,13 +128,15 @@ void InterfaceSelector::TryNextInterface() {
                                        object_path.c_str(),
                                        nullptr, [](GObject *source, GAsyncResult *res, gpointer user_data) {
 
-            auto inst = static_cast<ac::SharedKeepAlive<InterfaceSelector>*>(user_data)->ShouldDie();
+            auto chain = AsyncChain::FromUserData(user_data);
+            auto inst = chain->ContextAs<InterfaceSelector>();
 
             GError *error = nullptr;
             auto proxy = wpa_supplicant_interface_proxy_new_finish(res, &error);
             if (!proxy) {
                 AC_ERROR("Failed to create proxy for interface: %s", error->message);
                 g_error_free(error);
+                chain->Continue();
                 return;
             }
 
@@ -112,24 +150,30 @@ void InterfaceSelector::TryNextInterface() {
                 });
             }, "Modes");
 
-            if (supports_p2p) {
-                AC_DEBUG("Found interface which supports P2P");
-                // We take the first interface which supports p2p here and ignore
-                // all others. That is really enough for now.
-                if (auto sp = inst->delegate_.lock())
-                    sp->OnInterfaceSelectionDone(g_dbus_proxy_get_object_path(G_DBUS_PROXY(proxy)));
-                return;
-            }
-            else {
-                AC_DEBUG("Interface %s does not support P2p, ignoring.",
-                         g_dbus_proxy_get_object_path(G_DBUS_PROXY(proxy)));
-            }
-
+            const std::string path = g_dbus_proxy_get_object_path(G_DBUS_PROXY(proxy));
             g_object_unref(proxy);
 
-            inst->TryNextInterface();
+            inst->RecordProbeResult(supports_p2p, path);
+            chain->Continue();
+
+    }, chain->AsUserData());
+}
+
+void InterfaceSelector::RecordProbeResult(bool supports_p2p, const std::string &object_path) {
+    if (supports_p2p && !selection_notified_) {
+        AC_DEBUG("Found interface which supports P2P");
+        // We take the first interface which supports p2p here and ignore
+        // all others. That is really enough for now; the chain still
+        // waits for the slower probes so their callbacks stay valid.
+        selection_notified_ = true;
+        selected_path_ = object_path;
+        if (auto sp = delegate_.lock())
+            sp->OnInterfaceSelectionDone(object_path);
+        return;
+    }
 
-    }, new ac::SharedKeepAlive<InterfaceSelector>{shared_from_this()});
+    if (!supports_p2p && object_path.length() > 0)
+        AC_DEBUG("Interface %s does not support P2p, ignoring.", object_path);
 }
 
 } // w11tng
@@ -25,6 +25,8 @@
 
 #include <ac/scoped_gobject.h>
 
+#include "asyncchain.h"
+
 namespace w11tng {
 
 typedef std::vector<std::string> InterfaceList;
@@ -48,17 +50,21 @@ public:
     void ResetDelegate();
 
     void Process(const InterfaceList &interfaces);
+    void InvalidateSelection();
 
 private:
     InterfaceSelector();
     Ptr FinalizeConstruction();
 
-    void TryNextInterface();
+    void ProbeInterface(const std::string &object_path, const AsyncChain::Ptr &chain);
+    void RecordProbeResult(bool supports_p2p, const std::string &object_path);
 
 private:
     std::weak_ptr<Delegate> delegate_;
     ac::ScopedGObject<GDBusConnection> connection_;
-    std::vector<std::string> interfaces_;
+    std::string selected_path_;
+    AsyncChain::Ptr probe_chain_;
+    bool selection_notified_;
 };
 
 } // namespace w11tng
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "w11tng/netlinkrfkillmanager.h"
+
+#include "ac/logger.h"
+#include "ac/keep_alive.h"
+
+#include <boost/optional.hpp>
+
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <fstream>
+
+namespace {
+constexpr const char *kRfkillSysfsPath{"/sys/class/rfkill"};
+// The kernel broadcasts kobject uevents on group 1; udev relays its
+// processed copies on group 2 which we don't need here.
+constexpr unsigned int kUeventGroupKernel{1};
+// A single uevent is a handful of short KEY=VALUE strings; the rfkill
+// ones comfortably fit well below this.
+constexpr std::size_t kUeventBufferSize{1024};
+// RFKILL_STATE in the uevent is 1 for unblocked; 0 (soft) and 2
+// (hard) both count as blocked, matching soft||hard on /dev/rfkill.
+constexpr const char *kStateUnblocked{"1"};
+
+boost::optional<w11tng::RfkillManager::Type> TypeFromName(const std::string &name) {
+    typedef w11tng::RfkillManager::Type Type;
+
+    // Names as the rfkill core reports them in sysfs and in the
+    // RFKILL_TYPE uevent variable.
+    if (name == "wlan")
+        return Type::kWLAN;
+    else if (name == "bluetooth")
+        return Type::kBluetooth;
+    else if (name == "ultrawideband")
+        return Type::kUWB;
+    else if (name == "wwan")
+        return Type::kWWAN;
+    else if (name == "gps")
+        return Type::kGPS;
+    else if (name == "fm")
+        return Type::kFM;
+
+    return boost::optional<w11tng::RfkillManager::Type>{};
+}
+
+std::string ReadSysfsValue(const std::string &path) {
+    std::ifstream file(path);
+    std::string value;
+    if (file.is_open())
+        std::getline(file, value);
+    return value;
+}
+}
+
+namespace w11tng {
+NetlinkRfkillManager::Ptr NetlinkRfkillManager::Create() {
+    return std::shared_ptr<NetlinkRfkillManager>(new NetlinkRfkillManager)->FinalizeConstruction();
+}
+
+NetlinkRfkillManager::NetlinkRfkillManager() :
+    watch_(0) {
+}
+
+NetlinkRfkillManager::~NetlinkRfkillManager() {
+    if (watch_)
+        g_source_remove(watch_);
+}
+
+NetlinkRfkillManager::Ptr NetlinkRfkillManager::FinalizeConstruction() {
+    auto sp = shared_from_this();
+
+    auto fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        AC_WARNING("Failed to create uevent netlink socket: %s", ::strerror(errno));
+        return nullptr;
+    }
+
+    struct sockaddr_nl addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = kUeventGroupKernel;
+
+    if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_WARNING("Failed to subscribe to kernel uevents: %s", ::strerror(errno));
+        ::close(fd);
+        return nullptr;
+    }
+
+    channel_.reset(g_io_channel_unix_new(fd));
+    g_io_channel_set_close_on_unref(channel_.get(), TRUE);
+    g_io_channel_set_encoding(channel_.get(), nullptr, nullptr);
+    g_io_channel_set_buffered(channel_.get(), FALSE);
+
+    // Events only tell us about changes from here on so the state of
+    // all switches present right now comes from sysfs.
+    PrimeFromSysfs();
+
+    watch_ = g_io_add_watch_full(channel_.get(), G_PRIORITY_DEFAULT,
+                GIOCondition(G_IO_IN | G_IO_NVAL | G_IO_HUP | G_IO_ERR),
+                OnUeventReceived,
+                new ac::WeakKeepAlive<NetlinkRfkillManager>(sp),
+                [](gpointer user_data) { delete static_cast<ac::WeakKeepAlive<NetlinkRfkillManager>*>(user_data); });
+
+    return sp;
+}
+
+void NetlinkRfkillManager::PrimeFromSysfs() {
+    auto dir = g_dir_open(kRfkillSysfsPath, 0, nullptr);
+    if (!dir)
+        return;
+
+    const gchar *name = nullptr;
+    while ((name = g_dir_read_name(dir))) {
+        const auto base = std::string(kRfkillSysfsPath) + "/" + name;
+
+        const auto type = TypeFromName(ReadSysfsValue(base + "/type"));
+        if (!type)
+            continue;
+
+        block_status_[*type] = ReadSysfsValue(base + "/soft") == "1" ||
+                               ReadSysfsValue(base + "/hard") == "1";
+    }
+
+    g_dir_close(dir);
+}
+
+bool NetlinkRfkillManager::ProcessUevents() {
+    char buf[kUeventBufferSize];
+
+    const auto len = ::recv(g_io_channel_unix_get_fd(channel_.get()),
+                            buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+        return false;
+
+    buf[len] = '\0';
+
+    // A uevent is a "action@devpath" line followed by a block of null
+    // separated KEY=VALUE strings.
+    std::string action, subsystem, type_name, state;
+    ssize_t offset = 0;
+    while (offset < len) {
+        const std::string entry(buf + offset);
+        offset += entry.length() + 1;
+
+        const auto pos = entry.find('=');
+        if (pos == std::string::npos)
+            continue;
+
+        const auto key = entry.substr(0, pos);
+        const auto value = entry.substr(pos + 1);
+
+        if (key == "ACTION")
+            action = value;
+        else if (key == "SUBSYSTEM")
+            subsystem = value;
+        else if (key == "RFKILL_TYPE")
+            type_name = value;
+        else if (key == "RFKILL_STATE")
+            state = value;
+    }
+
+    if (subsystem != "rfkill")
+        return true;
+
+    if (action != "add" && action != "change")
+        return true;
+
+    const auto type = TypeFromName(type_name);
+    if (!type)
+        return true;
+
+    block_status_[*type] = (state != kStateUnblocked);
+
+    AC_DEBUG("rfkill type %s is now %s",
+              type_name,
+              block_status_[*type] ? "blocked" : "not blocked");
+
+    if (auto sp = delegate_.lock())
+        sp->OnRfkillChanged(*type);
+
+    return true;
+}
+
+gboolean NetlinkRfkillManager::OnUeventReceived(GIOChannel *channel, GIOCondition cond, gpointer data) {
+    auto thiz = static_cast<ac::WeakKeepAlive<NetlinkRfkillManager>*>(data)->GetInstance().lock();
+    if (!thiz)
+        return FALSE;
+
+    if (cond & (G_IO_NVAL | G_IO_HUP | G_IO_ERR))
+        return FALSE;
+
+    return static_cast<gboolean>(thiz->ProcessUevents());
+}
+
+bool NetlinkRfkillManager::IsBlocked(const Type &type) const {
+    auto it = block_status_.find(type);
+    return it == block_status_.end() ? false : it->second;
+}
+} // namespace w11tng
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef W11TNG_NETLINK_RFKILL_MANAGER_H_
+#define W11TNG_NETLINK_RFKILL_MANAGER_H_
+
+// Pulls in GIOChannelDeleter which we share with the /dev/rfkill
+// based manager.
+#include "w11tng/kernelrfkillmanager.h"
+
+#include <map>
+
+namespace w11tng {
+// Tracks rfkill switch state over the kernel uevent netlink broadcast
+// instead of a /dev/rfkill reader. The current state of all switches
+// is primed once from sysfs; afterwards the only fd the manager owns
+// is the netlink socket which stays quiet until a switch actually
+// changes, and IsBlocked is always served from the cache.
+class NetlinkRfkillManager : public RfkillManager,
+                             public std::enable_shared_from_this<NetlinkRfkillManager> {
+public:
+    // Returns nullptr when the netlink socket could not be set up;
+    // callers are expected to fall back to the /dev/rfkill manager.
+    static Ptr Create();
+
+    ~NetlinkRfkillManager();
+
+    bool IsBlocked(const Type &type) const override;
+
+private:
+    NetlinkRfkillManager();
+
+    Ptr FinalizeConstruction();
+    void PrimeFromSysfs();
+    bool ProcessUevents();
+
+    static gboolean OnUeventReceived(GIOChannel *channel, GIOCondition cond, gpointer data);
+
+    std::unique_ptr<GIOChannel, GIOChannelDeleter<GIOChannel>> channel_;
+    guint watch_;
+    std::map<Type,bool> block_status_;
+};
+} // namespace w11tng
+
+#endif
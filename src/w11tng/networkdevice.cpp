@@ -36,7 +36,9 @@ NetworkDevice::Ptr NetworkDevice::FinalizeConstruction() {
 NetworkDevice::NetworkDevice(const std::string &object_path) :
     object_path_(object_path),
     peer_(PeerStub::Create(object_path)),
-    state_(ac::kIdle) {
+    state_(ac::kIdle),
+    supported_roles_(MakeRoleList({})),
+    scan_generation_(0) {
 }
 
 NetworkDevice::~NetworkDevice() {
@@ -57,9 +59,19 @@ void NetworkDevice::SyncWithPeer()
 }
 
 void NetworkDevice::OnPeerChanged() {
-    AC_DEBUG("Peer properties changed");
+    const auto old_address = address_;
+    const auto old_name = name_;
+
     SyncWithPeer();
 
+    // Peers get re-announced on every find cycle; only tell the upper
+    // layers when something actually differs so continuous background
+    // discovery does not cause redundant D-Bus traffic.
+    if (old_address == address_ && old_name == name_)
+        return;
+
+    AC_DEBUG("Peer properties changed");
+
     if (auto sp = delegate_.lock())
         sp->OnDeviceChanged(shared_from_this());
 }
@@ -87,8 +99,8 @@ void NetworkDevice::SetState(ac::NetworkDeviceState state) {
     state_ = state;
 }
 
-void NetworkDevice::SetSupportedRoles(const std::vector<ac::NetworkDeviceRole> roles) {
-    supported_roles_ = roles;
+void NetworkDevice::SetSupportedRoles(std::vector<ac::NetworkDeviceRole> roles) {
+    supported_roles_ = MakeRoleList(std::move(roles));
 }
 
 void NetworkDevice::SetRole(const std::string &role) {
@@ -111,7 +123,7 @@ ac::NetworkDeviceState NetworkDevice::State() const {
     return state_;
 }
 
-std::vector<ac::NetworkDeviceRole> NetworkDevice::SupportedRoles() const {
+ac::NetworkDevice::RoleList NetworkDevice::SupportedRoles() const {
     return supported_roles_;
 }
 
@@ -123,4 +135,20 @@ std::string NetworkDevice::Role() const {
     return role_;
 }
 
+void NetworkDevice::SetScanGeneration(std::uint64_t generation) {
+    scan_generation_ = generation;
+}
+
+std::uint64_t NetworkDevice::ScanGeneration() const {
+    return scan_generation_;
+}
+
+void NetworkDevice::SetPersistentGroupPath(const std::string &path) {
+    persistent_group_path_ = path;
+}
+
+std::string NetworkDevice::PersistentGroupPath() const {
+    return persistent_group_path_;
+}
+
 } // namespace w11tng
@@ -18,6 +18,7 @@
 #ifndef W11TNG_NETWORKDEVICE_H_
 #define W11TNG_NETWORKDEVICE_H_
 
+#include <cstdint>
 #include <memory>
 
 #include <ac/networkdevice.h>
@@ -60,13 +61,13 @@ public:
     void SetIpV4Address(const ac::IpV4Address &address);
     void SetName(const std::string &name);
     void SetState(ac::NetworkDeviceState state);
-    void SetSupportedRoles(const std::vector<ac::NetworkDeviceRole> roles);
+    void SetSupportedRoles(std::vector<ac::NetworkDeviceRole> roles);
 
     ac::MacAddress Address() const override;
     ac::IpV4Address IPv4Address() const override;
     std::string Name() const override;
     ac::NetworkDeviceState State() const override;
-    std::vector<ac::NetworkDeviceRole> SupportedRoles() const override;
+    RoleList SupportedRoles() const override;
 
     std::string ObjectPath() const;
 
@@ -76,6 +77,17 @@ public:
     void SetRole(const std::string &role);
     std::string Role() const;
 
+    // Find cycle in which this peer was last announced or updated;
+    // used to diff scan results instead of rebuilding the peer set.
+    void SetScanGeneration(std::uint64_t generation);
+    std::uint64_t ScanGeneration() const;
+
+    // Object path of the persistent group credentials wpa stored for
+    // this device; empty when no credentials are available and a full
+    // GO negotiation is needed.
+    void SetPersistentGroupPath(const std::string &path);
+    std::string PersistentGroupPath() const;
+
 private:
     NetworkDevice(const std::string &object_path);
     Ptr FinalizeConstruction();
@@ -87,10 +99,12 @@ private:
     ac::IpV4Address ip_address_;
     std::string name_;
     ac::NetworkDeviceState state_;
-    std::vector<ac::NetworkDeviceRole> supported_roles_;
+    RoleList supported_roles_;
     std::string object_path_;
     std::shared_ptr<PeerStub> peer_;
     std::string role_;
+    std::string persistent_group_path_;
+    std::uint64_t scan_generation_;
 };
 
 } // namespace w11tng
@@ -16,19 +16,26 @@
  */
 
 #include <boost/concept_check.hpp>
+#include <boost/filesystem.hpp>
 
 #include <algorithm>
+#include <fstream>
 #include <sstream>
 
+#include <ac/config.h>
 #include <ac/logger.h>
 #include <ac/keep_alive.h>
 #include <ac/networkutils.h>
+#include <ac/utils.h>
+#include <ac/report/reportfactory.h>
+#include <ac/report/startuptrace.h>
 
 #include <hybris/properties/properties.h>
 
 #include "w11tng/networkmanager.h"
 #include "w11tng/informationelement.h"
 #include "w11tng/kernelrfkillmanager.h"
+#include "w11tng/netlinkrfkillmanager.h"
 #include "w11tng/urfkillmanager.h"
 
 
@@ -39,6 +46,17 @@ static const std::chrono::seconds kConnectTimeout{120};
 // As we play the source role we don't intent to be the group owner
 // and therefor use the lowest intent possible.
 static constexpr std::int32_t kSourceGoIntent = 0;
+// Persistent group credentials per sink survive a daemon restart here
+// so known sinks can rejoin without a new GO negotiation.
+static constexpr const char *kPersistentGroupsStoreName{"persistent-groups"};
+// Last successful connect duration per sink lives here so known-fast
+// sinks can get a much more aggressive connect timeout next time.
+static constexpr const char *kConnectTimesStoreName{"connect-times"};
+// Learned timeouts get this much headroom over the observed duration
+// and never go below the floor; cheap dongles with no history keep the
+// conservative default above.
+static constexpr unsigned int kConnectTimeoutHeadroomFactor{4};
+static const std::chrono::seconds kMinConnectTimeout{10};
 }
 
 namespace w11tng {
@@ -50,6 +68,13 @@ ac::NetworkManager::Ptr NetworkManager::Create() {
 std::shared_ptr<NetworkManager> NetworkManager::FinalizeConstruction() {
     auto sp = shared_from_this();
 
+    // Records the P2P level milestones of the connection setup so they
+    // show up next to the coarser stages the service tracks.
+    connection_report_ = ac::report::ReportFactory::Create()->CreateConnectionReport();
+
+    LoadKnownPersistentGroups();
+    LoadKnownConnectTimes();
+
     GError *error = nullptr;
     connection_.reset(g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, &error));
     if (!connection_) {
@@ -74,8 +99,16 @@ std::shared_ptr<NetworkManager> NetworkManager::FinalizeConstruction() {
 
 NetworkManager::NetworkManager() :
     firmware_loader_("", this),
+    firmware_ready_(true),
+    interface_selection_pending_(false),
     dedicated_p2p_interface_(""),
     session_available_(true),
+    persistent_rejoin_(false),
+    scan_generation_(0),
+    was_scanning_(false),
+    connect_start_time_(0),
+    wfd_ies_device_type_(DeviceType::kSource),
+    wfd_ies_session_available_(false),
     urfkill_watch_(0) {
         char interface_prop[PROP_VALUE_MAX];
         const std::string interface_env = ac::Utils::GetEnvValue("AETHERCAST_DEDICATED_P2P_INTERFACE");
@@ -130,8 +163,12 @@ void NetworkManager::Initialize(bool firmware_loading) {
         firmware_loader_.SetInterfaceName(interface_name);
         if (firmware_loader_.IsNeeded()) {
             AC_DEBUG("Loading WiFi firmware for interface %s", interface_name);
+            // Only the wpa interface stage truly depends on the
+            // firmware; the stubs below come up concurrently while it
+            // loads and OnManagerReady defers just the interface
+            // selection until OnFirmwareLoaded.
+            firmware_ready_ = false;
             firmware_loader_.TryLoad();
-            return;
         }
     }
 
@@ -145,18 +182,22 @@ void NetworkManager::Initialize(bool firmware_loading) {
     manager_ = ManagerStub::Create();
     manager_->SetDelegate(sp);
 
+    // The new manager instance has not seen our WFD IEs yet so the
+    // cached encoding must not suppress the next announcement.
+    wfd_ies_.reset();
+
     AC_DEBUG("Successfully initialized");
 }
 
 void NetworkManager::Release() {
     AC_DEBUG("");
 
-    for (auto &iter : devices_) {
+    devices_.ForEach([this](const std::string&, const NetworkDevice::Ptr &device) {
         if (delegate_)
-            delegate_->OnDeviceLost(iter.second);
-    }
+            delegate_->OnDeviceLost(device);
+    });
 
-    devices_.clear();
+    devices_.Clear();
 
     ReleaseInternal();
 }
@@ -178,6 +219,11 @@ void NetworkManager::SetupInterface(const std::string &object_path) {
 
     p2p_device_ = P2PDeviceStub::Create(object_path, shared_from_this());
 
+    // A fresh wpa device starts out with default configuration so the
+    // memoized values no longer describe what it carries.
+    synced_device_name_.clear();
+    synced_device_type_.clear();
+
     ConfigureFromCapabilities();
 }
 
@@ -237,7 +283,12 @@ void NetworkManager::OnURfkillNotAvailable(GDBusConnection*, const gchar*, gpoin
 
     AC_DEBUG("URfkill is not available, falling back to kernel rfkill manager");
 
-    inst->rfkill_manager_ = KernelRfkillManager::Create();
+    // Prefer the uevent netlink stream; it serves all queries from
+    // cached state without keeping /dev/rfkill open. The reader on
+    // /dev/rfkill only remains for kernels without uevent access.
+    inst->rfkill_manager_ = NetlinkRfkillManager::Create();
+    if (!inst->rfkill_manager_)
+        inst->rfkill_manager_ = KernelRfkillManager::Create();
     inst->FinishRfkillInitialization();
 }
 
@@ -252,21 +303,100 @@ void NetworkManager::Scan(const std::chrono::seconds &timeout) {
     if (!p2p_device_)
         return;
 
+    // Every find cycle gets its own generation; peers announced or
+    // updated during the cycle are tagged with it so we can diff the
+    // result set afterwards instead of rebuilding it.
+    scan_generation_++;
+
     p2p_device_->Find(timeout);
 }
 
+void NetworkManager::LoadKnownPersistentGroups() {
+    boost::filesystem::path store_path(ac::kStateDir);
+    store_path /= kPersistentGroupsStoreName;
+
+    if (!boost::filesystem::is_regular_file(store_path))
+        return;
+
+    std::ifstream stream(store_path.string());
+    std::string address, group_path;
+    while (stream >> address >> group_path)
+        known_persistent_groups_[address] = group_path;
+
+    AC_DEBUG("Loaded %d known persistent groups", known_persistent_groups_.size());
+}
+
+void NetworkManager::SaveKnownPersistentGroups() {
+    boost::filesystem::path state_dir(ac::kStateDir);
+
+    if (!boost::filesystem::is_directory(state_dir))
+        boost::filesystem::create_directory(state_dir);
+
+    std::ofstream stream((state_dir / kPersistentGroupsStoreName).string());
+    for (auto iter : known_persistent_groups_)
+        stream << iter.first << " " << iter.second << std::endl;
+}
+
+void NetworkManager::LoadKnownConnectTimes() {
+    boost::filesystem::path store_path(ac::kStateDir);
+    store_path /= kConnectTimesStoreName;
+
+    if (!boost::filesystem::is_regular_file(store_path))
+        return;
+
+    std::ifstream stream(store_path.string());
+    std::string address;
+    std::uint32_t seconds = 0;
+    while (stream >> address >> seconds)
+        known_connect_times_[address] = seconds;
+
+    AC_DEBUG("Loaded %d known connect times", known_connect_times_.size());
+}
+
+void NetworkManager::SaveKnownConnectTimes() {
+    boost::filesystem::path state_dir(ac::kStateDir);
+
+    if (!boost::filesystem::is_directory(state_dir))
+        boost::filesystem::create_directory(state_dir);
+
+    std::ofstream stream((state_dir / kConnectTimesStoreName).string());
+    for (auto iter : known_connect_times_)
+        stream << iter.first << " " << iter.second << std::endl;
+}
+
+std::chrono::seconds NetworkManager::ConnectTimeoutFor(const NetworkDevice::Ptr &device) const {
+    auto known = known_connect_times_.find(device->Address());
+    if (known == known_connect_times_.end())
+        return kConnectTimeout;
+
+    const auto timeout = std::chrono::seconds{known->second * kConnectTimeoutHeadroomFactor};
+    return std::max(kMinConnectTimeout, std::min(kConnectTimeout, timeout));
+}
+
+void NetworkManager::RecordConnectTime(const std::string &address, const std::chrono::seconds &elapsed) {
+    known_connect_times_[address] = static_cast<std::uint32_t>(std::max<std::int64_t>(1, elapsed.count()));
+    SaveKnownConnectTimes();
+}
+
+void NetworkManager::ForgetConnectTime(const std::string &address) {
+    if (known_connect_times_.erase(address) == 0)
+        return;
+
+    SaveKnownConnectTimes();
+}
+
 NetworkDevice::Ptr NetworkManager::FindDevice(const std::string &address) {
-    for (auto iter : devices_) {
-        if (iter.second->Address() == address)
-            return iter.second;
-    }
-    return NetworkDevice::Ptr{};
+    return devices_.FindIf([&address](const NetworkDevice::Ptr &device) {
+        return device->Address() == address;
+    });
 }
 
 void NetworkManager::StartConnectTimeout() {
-    AC_DEBUG("");
+    const auto timeout = current_device_ ? ConnectTimeoutFor(current_device_) : kConnectTimeout;
 
-    connect_timeout_ = g_timeout_add_seconds(kConnectTimeout.count(), [](gpointer user_data) {
+    AC_DEBUG("timeout %lld seconds", timeout.count());
+
+    connect_timeout_ = g_timeout_add_seconds(timeout.count(), [](gpointer user_data) {
         auto inst = static_cast<ac::SharedKeepAlive<NetworkManager>*>(user_data)->ShouldDie();
         if (!inst)
             return FALSE;
@@ -282,6 +412,11 @@ void NetworkManager::StartConnectTimeout() {
 
         inst->connect_timeout_ = 0;
 
+        // If an aggressive learned timeout fired the sink may just
+        // have gotten slower; fall back to the conservative default
+        // for the next attempt.
+        inst->ForgetConnectTime(inst->current_device_->Address());
+
         // If the device is either already connected or trying to get an address
         // over DHCP we don't do anything. DHCP process will fail on its own after
         // some time and we will react on
@@ -333,9 +468,21 @@ bool NetworkManager::Connect(const ac::NetworkDevice::Ptr &device) {
 
     p2p_device_->StopFind();
 
-    if (!p2p_device_->Connect(d->ObjectPath(), kSourceGoIntent))
+    // When we still hold persistent group credentials for this device
+    // we rejoin the stored group directly which skips GO negotiation
+    // and WPS provisioning and cuts several seconds off the reconnect.
+    const auto persistent_group = d->PersistentGroupPath();
+    if (persistent_group.length() > 0) {
+        AC_DEBUG("Rejoining persistent group %s", persistent_group);
+        persistent_rejoin_ = p2p_device_->ConnectPersistent(persistent_group);
+    }
+
+    if (!persistent_rejoin_ && !p2p_device_->Connect(d->ObjectPath(), kSourceGoIntent))
         return false;
 
+    connect_start_time_ = ac::Utils::GetNowUs();
+    connection_report_->StageReached("p2p-connect-started", connect_start_time_);
+
     current_device_->SetState(ac::kAssociation);
     if (delegate_)
         delegate_->OnDeviceStateChanged(current_device_);
@@ -394,7 +541,16 @@ void NetworkManager::SyncDeviceConfiguration() {
     auto hostname = SelectHostname();
     auto device_type = SelectDeviceType();
 
+    // Discovery refreshes and readiness flaps end up here a lot; wpa
+    // only needs to hear about the configuration when it differs from
+    // what the device already carries.
+    if (hostname == synced_device_name_ && device_type == synced_device_type_)
+        return;
+
     p2p_device_->SetDeviceConfiguration(hostname, device_type);
+
+    synced_device_name_ = hostname;
+    synced_device_type_ = device_type;
 }
 
 bool NetworkManager::Disconnect(const ac::NetworkDevice::Ptr &device) {
@@ -415,10 +571,9 @@ bool NetworkManager::Disconnect(const ac::NetworkDevice::Ptr &device) {
 
 std::vector<ac::NetworkDevice::Ptr> NetworkManager::Devices() const {
     std::vector<ac::NetworkDevice::Ptr> values;
-    std::transform(devices_.begin(), devices_.end(),
-                   std::back_inserter(values),
-                   [=](const std::pair<std::string,w11tng::NetworkDevice::Ptr> &value) {
-        return value.second;
+    values.reserve(devices_.Size());
+    devices_.ForEach([&values](const std::string&, const w11tng::NetworkDevice::Ptr &device) {
+        values.push_back(device);
     });
     return values;
 }
@@ -452,38 +607,81 @@ bool NetworkManager::Ready() const {
 }
 
 void NetworkManager::OnP2PDeviceChanged() {
+    const auto scanning = Scanning();
+
+    // The end of a find cycle is the point where we know which peers
+    // did not show up again; sweep those out instead of rebuilding the
+    // whole set.
+    if (was_scanning_ && !scanning)
+        SweepStaleDevices();
+    was_scanning_ = scanning;
+
     if (delegate_)
         delegate_->OnChanged();
 }
 
+void NetworkManager::SweepStaleDevices() {
+    // Allow a peer to miss one full find cycle before we drop it; wpa
+    // keeps peers cached without re-announcing them so a single quiet
+    // cycle is not proof that the peer is gone.
+    if (scan_generation_ < 2)
+        return;
+
+    const auto cutoff = scan_generation_ - 1;
+
+    std::vector<std::string> stale;
+    devices_.ForEach([&](const std::string &path, const NetworkDevice::Ptr &device) {
+        if (device == current_device_ || device->ScanGeneration() >= cutoff)
+            return;
+        stale.push_back(path);
+    });
+
+    for (const auto &path : stale) {
+        AC_DEBUG("Dropping peer %s which was not seen for two find cycles", path);
+
+        const auto device = devices_.Take(path);
+
+        if (delegate_)
+            delegate_->OnDeviceLost(device);
+    }
+}
+
 void NetworkManager::OnP2PDeviceReady() {
     AC_DEBUG("");
+
+    // Manager, interface and P2P device stubs are all wired up now;
+    // everything past this point is radio state, not bring-up.
+    ac::report::StartupTrace::Instance().Mark(ac::report::kStartupMilestoneStubChainReady);
     // Bring the device into a well known state
     p2p_device_->Flush();
     SyncDeviceConfiguration();
 }
 
 void NetworkManager::OnDeviceFound(const std::string &path) {
-    if (devices_.find(path) != devices_.end())
+    if (const auto existing = devices_.Find(path)) {
+        // Just a re-announcement of a peer we already track; tag it as
+        // seen in this cycle but don't build a new stub or re-announce
+        // it to the upper layers.
+        existing->SetScanGeneration(scan_generation_);
         return;
+    }
 
     auto device = NetworkDevice::Create(path);
     device->SetDelegate(shared_from_this());
-    devices_[path] = device;
+    device->SetScanGeneration(scan_generation_);
+    devices_.Insert(path, device);
 
     // NOTE: OnDeviceFound will be send to delegate once the device
     // reports through OnDeviceReady that its ready for operation.
 }
 
 void NetworkManager::OnDeviceLost(const std::string &path) {
-    if (devices_.find(path) == devices_.end())
+    auto device = devices_.Take(path);
+    if (!device)
         return;
 
     AC_DEBUG("peer %s", path);
 
-    auto device = devices_[path];
-    devices_.erase(path);
-
     // If we're currently connecting with the lost device (which can
     // happen if we're the owner of the group and the remote disappears)
     // then we have to disconnect everything too.
@@ -517,6 +715,7 @@ void NetworkManager::AdvanceDeviceState(const NetworkDevice::Ptr &device, ac::Ne
 }
 
 void NetworkManager::HandleConnectFailed() {
+    persistent_rejoin_ = false;
     AdvanceDeviceState(current_device_, ac::kFailure);
     current_device_.reset();
     StopConnectTimeout();
@@ -528,6 +727,20 @@ void NetworkManager::OnPeerConnectFailed() {
 
     AC_DEBUG("");
 
+    // A failed rejoin means our stored credentials went stale (the sink
+    // may have dropped the group on its side) so throw them away and
+    // fall back to a full GO negotiation before we give up.
+    if (persistent_rejoin_) {
+        persistent_rejoin_ = false;
+        p2p_device_->RemovePersistentGroup(current_device_->PersistentGroupPath());
+        current_device_->SetPersistentGroupPath("");
+        known_persistent_groups_.erase(current_device_->Address());
+        SaveKnownPersistentGroups();
+
+        if (p2p_device_->Connect(current_device_->ObjectPath(), kSourceGoIntent))
+            return;
+    }
+
     HandleConnectFailed();
 }
 
@@ -556,6 +769,8 @@ void NetworkManager::OnGroupOwnerNegotiationSuccess(const std::string &peer_path
     AC_DEBUG("peer %s selected oper freq %d wps_method %s",
               peer_path, result.oper_freq, P2PDeviceStub::WpsMethodToString(result.wps_method));
     AC_DEBUG("intersect freqs [%s]", frequencies.str());
+
+    connection_report_->StageReached("go-negotiation-done", ac::Utils::GetNowUs());
 }
 
 void NetworkManager::OnGroupStarted(const std::string &group_path, const std::string &interface_path, const std::string &role) {
@@ -564,6 +779,10 @@ void NetworkManager::OnGroupStarted(const std::string &group_path, const std::st
 
     AC_DEBUG("group %s interface %s role %s", group_path, interface_path, role);
 
+    persistent_rejoin_ = false;
+
+    connection_report_->StageReached("group-started", ac::Utils::GetNowUs());
+
     AdvanceDeviceState(current_device_, ac::kConfiguration);
 
     current_device_->SetRole(role);
@@ -602,12 +821,60 @@ void NetworkManager::OnGroupRequest(const std::string &peer_path, int dev_passwd
     // respected as well
 }
 
+void NetworkManager::OnPersistentGroupAdded(const std::string &path) {
+    if (!current_device_)
+        return;
+
+    AC_DEBUG("Storing persistent group %s for device %s", path, current_device_->Address());
+
+    // Remember the credentials with the device we're currently
+    // connecting so the next connect to it can rejoin right away.
+    current_device_->SetPersistentGroupPath(path);
+
+    known_persistent_groups_[current_device_->Address()] = path;
+    SaveKnownPersistentGroups();
+}
+
+void NetworkManager::OnPersistentGroupRemoved(const std::string &path) {
+    devices_.ForEach([&path](const std::string&, const NetworkDevice::Ptr &device) {
+        if (device->PersistentGroupPath() != path)
+            return;
+
+        AC_DEBUG("Dropping persistent group %s for device %s", path, device->Address());
+        device->SetPersistentGroupPath("");
+    });
+
+    for (auto iter = known_persistent_groups_.begin(); iter != known_persistent_groups_.end();) {
+        if (iter->second == path)
+            iter = known_persistent_groups_.erase(iter);
+        else
+            ++iter;
+    }
+    SaveKnownPersistentGroups();
+}
+
 void NetworkManager::OnDeviceChanged(const NetworkDevice::Ptr &device) {
+    // A property update is proof the peer is still around so keep its
+    // generation current.
+    device->SetScanGeneration(scan_generation_);
+
     if (delegate_)
         delegate_->OnDeviceChanged(device);
 }
 
 void NetworkManager::OnDeviceReady(const NetworkDevice::Ptr &device) {
+    // If we've paired with this sink before, pre-stage the stored
+    // credentials now while the user is still looking at the picker so
+    // the actual connect is just a group rejoin.
+    if (device->PersistentGroupPath().length() == 0) {
+        auto known = known_persistent_groups_.find(device->Address());
+        if (known != known_persistent_groups_.end()) {
+            AC_DEBUG("Pre-staging persistent group %s for device %s",
+                     known->second, device->Address());
+            device->SetPersistentGroupPath(known->second);
+        }
+    }
+
     if (delegate_)
         delegate_->OnDeviceFound(device);
 }
@@ -620,8 +887,20 @@ void NetworkManager::OnDhcpAddressAssigned(const ac::IpV4Address &local_address,
 
     current_device_->SetIpV4Address(remote_address);
 
+    const auto now = ac::Utils::GetNowUs();
+    connection_report_->StageReached("dhcp-done", now);
+
     StopConnectTimeout();
 
+    // Remember how long this sink took from connect start to address
+    // assignment; the next connect to it times out accordingly.
+    if (connect_start_time_ > 0) {
+        RecordConnectTime(current_device_->Address(),
+                          std::chrono::duration_cast<std::chrono::seconds>(
+                              std::chrono::microseconds(now - connect_start_time_)));
+        connect_start_time_ = 0;
+    }
+
     AdvanceDeviceState(current_device_, ac::kConnected);
 }
 
@@ -636,9 +915,16 @@ void NetworkManager::OnDhcpTerminated() {
 }
 
 void NetworkManager::OnFirmwareLoaded() {
-    // Pass through when firmware was successfully loaded and
-    // do all other needed initialization stuff
-    Initialize();
+    firmware_ready_ = true;
+
+    // The stubs came up concurrently while the firmware was loading;
+    // run the interface stage they had to defer. When the manager stub
+    // is still on its way the dependency resolves the other way around
+    // and OnManagerReady finds firmware_ready_ already set.
+    if (interface_selection_pending_) {
+        interface_selection_pending_ = false;
+        OnManagerReady();
+    }
 }
 
 void NetworkManager::OnFirmwareUnloaded() {
@@ -649,6 +935,7 @@ void NetworkManager::OnInterfaceSelectionDone(const std::string &path) {
         return;
 
     AC_DEBUG("Found P2P interface %s", path);
+    connection_report_->StageReached("interface-selected", ac::Utils::GetNowUs());
     SetupInterface(path);
 }
 
@@ -689,12 +976,20 @@ void NetworkManager::ConfigureFromCapabilities() {
     if (!manager_)
         return;
 
+    auto device_type = GenerateWfdDeviceType();
+
+    // The encoded IE only depends on the device type and the session
+    // availability; re-encoding and re-announcing it on every state
+    // change is pointless D-Bus traffic so keep the last one around
+    // until one of its inputs changes.
+    if (wfd_ies_ && device_type == wfd_ies_device_type_ &&
+            session_available_ == wfd_ies_session_available_)
+        return;
+
     InformationElement ie;
     auto sub_element = new_subelement(kDeviceInformation);
     auto dev_info = (DeviceInformationSubelement*) sub_element;
 
-    auto device_type = GenerateWfdDeviceType();
-
     AC_DEBUG("device type %d session availability %d",
               device_type,
               session_available_);
@@ -705,12 +1000,22 @@ void NetworkManager::ConfigureFromCapabilities() {
     dev_info->field1.session_availability = session_available_;
     ie.add_subelement(sub_element);
 
-    auto ie_data = ie.serialize();
+    wfd_ies_ = ie.serialize();
+    wfd_ies_device_type_ = device_type;
+    wfd_ies_session_available_ = session_available_;
 
-    manager_->SetWFDIEs(ie_data->bytes, ie_data->length);
+    manager_->SetWFDIEs(wfd_ies_->bytes, wfd_ies_->length);
 }
 
 void NetworkManager::OnManagerReady() {
+    // Interface creation is the one stage which must wait for the
+    // firmware; until it finished loading the kernel side of the
+    // interface we would hand wpa a name that does not exist yet.
+    if (!firmware_ready_) {
+        interface_selection_pending_ = true;
+        return;
+    }
+
     // If we need to create an interface object at wpa first we
     // do that and continue in one of the delegate callbacks from
     // the manager stub.
@@ -723,15 +1028,24 @@ void NetworkManager::OnManagerReady() {
 }
 
 void NetworkManager::OnManagerInterfaceAdded(const std::string &path) {
+    interface_selector_->InvalidateSelection();
+
     if (p2p_device_)
         return;
 
+    if (!firmware_ready_) {
+        interface_selection_pending_ = true;
+        return;
+    }
+
     interface_selector_->Process(manager_->Interfaces());
 }
 
 void NetworkManager::OnManagerInterfaceRemoved(const std::string &path) {
     AC_DEBUG("path %s", path);
 
+    interface_selector_->InvalidateSelection();
+
     if (!p2p_device_)
         return;
 
@@ -781,9 +1095,18 @@ void NetworkManager::OnGroupInterfaceReady() {
 
     auto sp = shared_from_this();
 
-    if (current_device_->Role() == "GO")
+    connection_report_->StageReached("dhcp-started", ac::Utils::GetNowUs());
+
+    if (current_device_->Role() == "GO") {
         dhcp_server_ = w11tng::DhcpServer::Create(sp, ifname);
-    else
+
+        // Keyed by the peer MAC so any address resolution during the
+        // session setup that follows is a plain hash lookup instead of
+        // a trip through a lease file.
+        if (!lease_registry_)
+            lease_registry_ = DhcpLeaseRegistry::Create();
+        dhcp_server_->SetLeaseRegistry(lease_registry_);
+    } else
         dhcp_client_ = w11tng::DhcpClient::Create(sp, ifname);
 }
 
@@ -796,6 +1119,11 @@ void NetworkManager::OnRfkillChanged(const RfkillManager::Type &type) {
     if (type != RfkillManager::Type::kWLAN)
         return;
 
+    // Toggling rfkill may take interfaces down or bring different ones
+    // up so any interface selection we made is no longer trustworthy.
+    if (interface_selector_)
+        interface_selector_->InvalidateSelection();
+
     if (delegate_)
         delegate_->OnReadyChanged();
 }
@@ -20,13 +20,17 @@
 
 #include <unordered_map>
 
+#include <ac/deviceregistry.h>
 #include <ac/networkmanager.h>
+#include <ac/report/connectionreport.h>
+#include <ac/utils.h>
 
 #include "managerstub.h"
 #include "p2pdevicestub.h"
 #include "interfacestub.h"
 #include "interfaceselector.h"
 #include "dhcpserver.h"
+#include "dhcpleaseregistry.h"
 #include "dhcpclient.h"
 #include "wififirmwareloader.h"
 #include "informationelement.h"
@@ -82,6 +86,8 @@ public:
     void OnGroupStarted(const std::string &group_path, const std::string &interface_path, const std::string &role) override;
     void OnGroupFinished(const std::string &group_path, const std::string &interface_path) override;
     void OnGroupRequest(const std::string &peer_path, int dev_passwd_id) override;
+    void OnPersistentGroupAdded(const std::string &path) override;
+    void OnPersistentGroupRemoved(const std::string &path) override;
 
     void OnDeviceChanged(const NetworkDevice::Ptr &device) override;
     void OnDeviceReady(const NetworkDevice::Ptr &device) override;
@@ -137,6 +143,20 @@ private:
 
     void HandleConnectFailed();
 
+    void SweepStaleDevices();
+
+    void LoadKnownPersistentGroups();
+    void SaveKnownPersistentGroups();
+
+    void LoadKnownConnectTimes();
+    void SaveKnownConnectTimes();
+    // Timeout for connecting the given sink; aggressive for sinks
+    // which have proven to connect fast, the conservative default
+    // otherwise.
+    std::chrono::seconds ConnectTimeoutFor(const NetworkDevice::Ptr &device) const;
+    void RecordConnectTime(const std::string &address, const std::chrono::seconds &elapsed);
+    void ForgetConnectTime(const std::string &address);
+
     void OnGroupInterfaceReady();
     void OnManagementInterfaceReady();
 
@@ -155,21 +175,39 @@ private:
     std::shared_ptr<InterfaceStub> mgmt_interface_;
     std::string driver_cmd_iface_;
     std::shared_ptr<P2PDeviceStub> p2p_device_;
-    std::unordered_map<std::string,w11tng::NetworkDevice::Ptr> devices_;
+    ac::DeviceRegistry<w11tng::NetworkDevice::Ptr> devices_;
     NetworkDevice::Ptr current_device_;
     InterfaceStub::Ptr current_group_iface_;
     P2PDeviceStub::Ptr current_group_device_;
     std::shared_ptr<w11tng::DhcpClient> dhcp_client_;
     std::shared_ptr<w11tng::DhcpServer> dhcp_server_;
+    DhcpLeaseRegistry::Ptr lease_registry_;
     InterfaceSelector::Ptr interface_selector_;
     guint connect_timeout_;
     w11tng::WiFiFirmwareLoader firmware_loader_;
+    bool firmware_ready_;
+    bool interface_selection_pending_;
     std::string dedicated_p2p_interface_;
     bool session_available_;
+    bool persistent_rejoin_;
+    std::uint64_t scan_generation_;
+    bool was_scanning_;
+    std::unordered_map<std::string,std::string> known_persistent_groups_;
+    // Seconds the last successful connect took per sink address
+    std::unordered_map<std::string,std::uint32_t> known_connect_times_;
+    ac::TimestampUs connect_start_time_;
+    std::unique_ptr<InformationElementArray> wfd_ies_;
+    DeviceType wfd_ies_device_type_;
+    bool wfd_ies_session_available_;
+    // Device name and primary device type last pushed to wpa; identical
+    // values are not sent again.
+    std::string synced_device_name_;
+    std::string synced_device_type_;
     std::vector<Capability> capabilities_;
     Hostname1Stub::Ptr hostname_service_;
     RfkillManager::Ptr rfkill_manager_;
     guint urfkill_watch_;
+    ac::report::ConnectionReport::Ptr connection_report_;
 };
 
 } // namespace w11tng
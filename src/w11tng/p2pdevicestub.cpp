@@ -111,8 +111,12 @@ std::shared_ptr<P2PDeviceStub> P2PDeviceStub::FinalizeConstruction(const std::st
         return sp;
     }
 
+    // We only use the proxy for method calls and signals and never read
+    // any of its cached properties, so skip the GetAll round-trip the
+    // proxy would otherwise issue before it becomes ready.
     wpa_supplicant_interface_p2_pdevice_proxy_new(connection_.get(),
-                                                  G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                                  static_cast<GDBusProxyFlags>(G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START |
+                                                                               G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES),
                                                   kBusName,
                                                   object_path.c_str(),
                                                   nullptr,
@@ -293,6 +297,32 @@ void P2PDeviceStub::OnGroupRequest(WpaSupplicantInterfaceP2PDevice *device, cons
         sp->OnGroupRequest(peer_path, dev_passwd_id);
 }
 
+void P2PDeviceStub::OnPersistentGroupAdded(WpaSupplicantInterfaceP2PDevice *device, const gchar *path, GVariant *properties, gpointer user_data) {
+    boost::ignore_unused_variable_warning(properties);
+
+    auto inst = static_cast<ac::WeakKeepAlive<P2PDeviceStub>*>(user_data)->GetInstance().lock();
+
+    if (not inst)
+        return;
+
+    AC_DEBUG("Persistent group %s added", path);
+
+    if (auto sp = inst->delegate_.lock())
+        sp->OnPersistentGroupAdded(std::string(path));
+}
+
+void P2PDeviceStub::OnPersistentGroupRemoved(WpaSupplicantInterfaceP2PDevice *device, const gchar *path, gpointer user_data) {
+    auto inst = static_cast<ac::WeakKeepAlive<P2PDeviceStub>*>(user_data)->GetInstance().lock();
+
+    if (not inst)
+        return;
+
+    AC_DEBUG("Persistent group %s removed", path);
+
+    if (auto sp = inst->delegate_.lock())
+        sp->OnPersistentGroupRemoved(std::string(path));
+}
+
 void P2PDeviceStub::ConnectSignals() {
     auto sp = shared_from_this();
 
@@ -309,6 +339,8 @@ void P2PDeviceStub::ConnectSignals() {
     CONNECT_SIGNAL("group-started", OnGroupStarted);
     CONNECT_SIGNAL("group-finished", OnGroupFinished);
     CONNECT_SIGNAL("gonegotiation-request", OnGroupRequest);
+    CONNECT_SIGNAL("persistent-group-added", OnPersistentGroupAdded);
+    CONNECT_SIGNAL("persistent-group-removed", OnPersistentGroupRemoved);
 }
 
 void P2PDeviceStub::StartFindTimeout() {
@@ -416,6 +448,9 @@ bool P2PDeviceStub::Connect(const std::string &path, const std::int32_t intent)
     // We support only WPS PBC for now
     g_variant_builder_add(builder, "{sv}", "wps_method", g_variant_new_string(WpsMethodToString(WpsMethod::kPbc).c_str()));
     g_variant_builder_add(builder, "{sv}", "go_intent", g_variant_new_int32(intent));
+    // Ask wpa to store the group credentials so the next connection to
+    // the same peer can skip GO negotiation and provisioning entirely.
+    g_variant_builder_add(builder, "{sv}", "persistent", g_variant_new_boolean(TRUE));
 
     auto arguments = g_variant_builder_end(builder);
 
@@ -439,6 +474,58 @@ bool P2PDeviceStub::Connect(const std::string &path, const std::int32_t intent)
     return true;
 }
 
+bool P2PDeviceStub::ConnectPersistent(const std::string &group_path) {
+    if (!proxy_ || group_path.length() == 0)
+        return false;
+
+    AC_DEBUG("group %s", group_path);
+
+    auto builder = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+
+    g_variant_builder_add(builder, "{sv}", "persistent_group_object", g_variant_new_object_path(group_path.c_str()));
+
+    auto arguments = g_variant_builder_end(builder);
+
+    wpa_supplicant_interface_p2_pdevice_call_group_add(proxy_.get(), arguments, nullptr,
+                                                       [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+        auto inst = static_cast<ac::SharedKeepAlive<P2PDeviceStub>*>(user_data)->ShouldDie();
+
+        GError *error = nullptr;
+        if (!wpa_supplicant_interface_p2_pdevice_call_group_add_finish(inst->proxy_.get(), res, &error)) {
+            AC_ERROR("Failed to rejoin persistent group: %s", error->message);
+            g_error_free(error);
+
+            if (auto sp = inst->delegate_.lock())
+                sp->OnPeerConnectFailed();
+
+            return;
+        }
+    }, new ac::SharedKeepAlive<P2PDeviceStub>{shared_from_this()});
+
+    return true;
+}
+
+void P2PDeviceStub::RemovePersistentGroup(const std::string &path) {
+    if (!proxy_ || path.length() == 0)
+        return;
+
+    AC_DEBUG("group %s", path);
+
+    wpa_supplicant_interface_p2_pdevice_call_remove_persistent_group(proxy_.get(), path.c_str(), nullptr,
+                                                                     [](GObject *source, GAsyncResult *res, gpointer user_data) {
+
+        auto inst = static_cast<ac::SharedKeepAlive<P2PDeviceStub>*>(user_data)->ShouldDie();
+
+        GError *error = nullptr;
+        if (!wpa_supplicant_interface_p2_pdevice_call_remove_persistent_group_finish(inst->proxy_.get(), res, &error)) {
+            AC_ERROR("Failed to remove persistent group: %s", error->message);
+            g_error_free(error);
+            return;
+        }
+    }, new ac::SharedKeepAlive<P2PDeviceStub>{shared_from_this()});
+}
+
 bool P2PDeviceStub::Disconnect() {
     AC_DEBUG("");
 
@@ -115,6 +115,11 @@ public:
         virtual void OnGroupFinished(const std::string &group_path, const std::string &interface_path) = 0;
         virtual void OnGroupRequest(const std::string &peer_path, int dev_passwd_id) = 0;
 
+        // Emitted when wpa stored credentials for a newly formed group
+        // which we can reuse later to rejoin without renegotiation.
+        virtual void OnPersistentGroupAdded(const std::string &path) = 0;
+        virtual void OnPersistentGroupRemoved(const std::string &path) = 0;
+
         // Called whenver any of the exposed properties changes.
         virtual void OnP2PDeviceChanged() = 0;
 
@@ -130,6 +135,8 @@ public:
     void Find(const std::chrono::seconds &timeout);
     void StopFind();
     bool Connect(const std::string &path, const std::int32_t intent);
+    bool ConnectPersistent(const std::string &group_path);
+    void RemovePersistentGroup(const std::string &path);
     bool Disconnect();
     bool DisconnectSync();
     void Flush();
@@ -150,6 +157,8 @@ private:
     static void OnGroupStarted(WpaSupplicantInterfaceP2PDevice *device, GVariant *properties, gpointer user_data);
     static void OnGroupFinished(WpaSupplicantInterfaceP2PDevice *device, GVariant *properties, gpointer user_data);
     static void OnGroupRequest(WpaSupplicantInterfaceP2PDevice *device, const gchar *path, int dev_passwd_id, gpointer user_data);
+    static void OnPersistentGroupAdded(WpaSupplicantInterfaceP2PDevice *device, const gchar *path, GVariant *properties, gpointer user_data);
+    static void OnPersistentGroupRemoved(WpaSupplicantInterfaceP2PDevice *device, const gchar *path, gpointer user_data);
 
 private:
     P2PDeviceStub(const std::weak_ptr<P2PDeviceStub::Delegate> &delegate);
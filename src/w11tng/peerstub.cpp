@@ -20,6 +20,7 @@
 #include <ac/keep_alive.h>
 #include <ac/logger.h>
 #include <ac/utils.h>
+#include <ac/dbus/helpers.h>
 
 #include "peerstub.h"
 
@@ -32,6 +33,8 @@ PeerStub::Ptr PeerStub::Create(const std::string &object_path) {
 PeerStub::Ptr PeerStub::FinalizeConstruction(const std::string &object_path) {
     auto sp = shared_from_this();
 
+    object_path_ = object_path;
+
     GError *error = nullptr;
     connection_.reset(g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, &error));
     if (!connection_) {
@@ -40,53 +43,43 @@ PeerStub::Ptr PeerStub::FinalizeConstruction(const std::string &object_path) {
         return sp;
     }
 
-    wpa_supplicant_peer_proxy_new(connection_.get(), G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
-                                  kBusName,
-                                  object_path.c_str(),
-                                  nullptr,
-                                  [](GObject *source, GAsyncResult *res, gpointer user_data) {
-
-        auto inst = static_cast<ac::SharedKeepAlive<PeerStub>*>(user_data)->ShouldDie();
-
-        GError *error = nullptr;
-        inst->proxy_.reset(wpa_supplicant_peer_proxy_new_finish(res, &error));
-        if (!inst->proxy_) {
-            AC_ERROR("Failed to connect with Peer proxy: %s", error->message);
-            g_error_free(error);
-            return;
-        }
-
-        inst->ConnectSignals();
-        inst->SyncProperties(false);
-
-        if (auto sp = inst->delegate_.lock())
-            sp->OnPeerReady();
+    properties_changed_id_ = g_dbus_connection_signal_subscribe(connection_.get(),
+                                       kBusName,
+                                       "org.freedesktop.DBus.Properties",
+                                       "PropertiesChanged",
+                                       object_path_.c_str(),
+                                       nullptr,
+                                       G_DBUS_SIGNAL_FLAGS_NONE,
+                                       &PeerStub::OnPropertiesChanged,
+                                       new ac::WeakKeepAlive<PeerStub>(shared_from_this()),
+                                       [](gpointer data) { delete static_cast<ac::WeakKeepAlive<PeerStub>*>(data); });
 
-    }, new ac::SharedKeepAlive<PeerStub>{shared_from_this()});
+    SyncProperties();
 
     return sp;
 }
 
-void PeerStub::OnPropertyChanged(GObject *source, GParamSpec *spec, gpointer user_data) {
+PeerStub::~PeerStub() {
+    if (properties_changed_id_ > 0)
+        g_dbus_connection_signal_unsubscribe(connection_.get(), properties_changed_id_);
+}
+
+void PeerStub::OnPropertiesChanged(GDBusConnection *connection, const gchar *sender_name,
+                                   const gchar *object_path, const gchar *interface_name,
+                                   const gchar *signal_name, GVariant *parameters,
+                                   gpointer user_data) {
+
     auto inst = static_cast<ac::WeakKeepAlive<PeerStub>*>(user_data)->GetInstance().lock();
 
     if (not inst)
         return;
 
-    inst->SyncProperties();
-}
-
-void PeerStub::ConnectSignals() {
-    g_signal_connect_data(proxy_.get(), "notify::device-name",
-                          G_CALLBACK(&PeerStub::OnPropertyChanged), new ac::WeakKeepAlive<PeerStub>(shared_from_this()),
-                          [](gpointer data, GClosure *) { delete static_cast<ac::WeakKeepAlive<PeerStub>*>(data); },
-                          GConnectFlags(0));
-
-    g_signal_connect_data(proxy_.get(), "notify::device-address",
-                          G_CALLBACK(&PeerStub::OnPropertyChanged), new ac::WeakKeepAlive<PeerStub>(shared_from_this()),
-                          [](gpointer data, GClosure *) { delete static_cast<ac::WeakKeepAlive<PeerStub>*>(data); },
-                          GConnectFlags(0));
+    // The signal already carries the changed values so there is no
+    // need for another round-trip to the service here.
+    inst->ParseProperties(g_variant_get_child_value(parameters, 1));
 
+    if (auto sp = inst->delegate_.lock())
+        sp->OnPeerChanged();
 }
 
 std::string ByteArrayToMacAddress(const gchar *data) {
@@ -103,47 +96,70 @@ std::string ByteArrayToMacAddress(const gchar *data) {
     return ss.str();
 }
 
-std::string PeerStub::RetrieveAddressFromProxy() {
-    // NOTE We have to parse the 'DeviceAddress' property here manually as
-    // gdbus-codegen doesn't properly give us a value of type 'ay'. Or it
-    // could be still that I am to stupid using it but this now works
-    // perfectly.
+void PeerStub::SyncProperties() {
+    // A single GetAll replaces the per-property round-trips a proxy
+    // would do on construction; every peer found during a scan issues
+    // its fetch right away so they all run in parallel on the bus.
+    g_dbus_connection_call(connection_.get(),
+                           kBusName,
+                           object_path_.c_str(),
+                           "org.freedesktop.DBus.Properties",
+                           "GetAll",
+                           g_variant_new("(s)", kInterfaceName),
+                           G_VARIANT_TYPE("(a{sv})"),
+                           G_DBUS_CALL_FLAGS_NONE,
+                           -1,
+                           nullptr,
+                           [](GObject *source, GAsyncResult *res, gpointer user_data) {
 
-    WpaSupplicantPeerProxy *proxy = WPA_SUPPLICANT_PEER_PROXY(proxy_.get());
-    auto variant = g_dbus_proxy_get_cached_property (G_DBUS_PROXY (proxy), "DeviceAddress");
-
-    if (!variant)
-        return "";
+        auto inst = static_cast<ac::SharedKeepAlive<PeerStub>*>(user_data)->ShouldDie();
 
-    GVariantIter iter;
-    gchar raw_addr[6] = { 0x0 };
+        GError *error = nullptr;
+        auto result = g_dbus_connection_call_finish(inst->connection_.get(), res, &error);
+        if (!result) {
+            AC_ERROR("Failed to query properties for peer %s: %s",
+                     inst->object_path_, error->message);
+            g_error_free(error);
+            return;
+        }
 
-    g_variant_iter_init(&iter, variant);
+        inst->ParseProperties(g_variant_get_child_value(result, 0));
 
-    for (int n = 0; n < 6; n++) {
-        if (!g_variant_iter_next(&iter, "y", &raw_addr[n]))
-            break;
-    }
+        if (inst->ready_) {
+            if (auto sp = inst->delegate_.lock())
+                sp->OnPeerChanged();
+            return;
+        }
 
-    auto address = ByteArrayToMacAddress(raw_addr);
+        inst->ready_ = true;
 
-    g_variant_unref (variant);
+        if (auto sp = inst->delegate_.lock())
+            sp->OnPeerReady();
 
-    return address;
+    }, new ac::SharedKeepAlive<PeerStub>{shared_from_this()});
 }
 
-void PeerStub::SyncProperties(bool update_delegate) {
-    if (!proxy_)
-        return;
+void PeerStub::ParseProperties(GVariant *properties) {
+    ac::dbus::Helpers::ParseDictionary(properties, [&](const std::string &key, GVariant *value) {
+        if (key == "DeviceName") {
+            name_ = g_variant_get_string(g_variant_get_variant(value), nullptr) ? : "";
+        }
+        else if (key == "DeviceAddress") {
+            auto v = g_variant_get_variant(value);
 
-    name_ = wpa_supplicant_peer_get_device_name(proxy_.get()) ? : "";
-    address_ = RetrieveAddressFromProxy();
+            GVariantIter iter;
+            gchar raw_addr[6] = { 0x0 };
 
-    if (!update_delegate)
-        return;
+            g_variant_iter_init(&iter, v);
 
-    if (auto sp = delegate_.lock())
-        sp->OnPeerChanged();
+            for (int n = 0; n < 6; n++) {
+                if (!g_variant_iter_next(&iter, "y", &raw_addr[n]))
+                    break;
+            }
+
+            address_ = ByteArrayToMacAddress(raw_addr);
+        }
+    });
 }
 
 void PeerStub::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
@@ -20,26 +20,19 @@
 
 #include <string>
 
+#include <ac/glib_wrapper.h>
+
 #include <ac/shared_gobject.h>
 #include <ac/scoped_gobject.h>
 #include <ac/non_copyable.h>
 #include <ac/mac_address.h>
 
-extern "C" {
-// Ignore all warnings coming from the external headers as we don't
-// control them and also don't want to get any warnings from them
-// which will only pollute our build output.
-#pragma GCC diagnostic push
-#pragma GCC diagnostic warning "-w"
-#include "wpasupplicantinterface.h"
-#pragma GCC diagnostic pop
-}
-
 namespace w11tng {
 
 class PeerStub : public std::enable_shared_from_this<PeerStub> {
 public:
     static constexpr const char *kBusName{"fi.w1.wpa_supplicant1"};
+    static constexpr const char *kInterfaceName{"fi.w1.wpa_supplicant1.Peer"};
 
     typedef std::shared_ptr<PeerStub> Ptr;
 
@@ -51,6 +44,8 @@ public:
 
     static Ptr Create(const std::string &object_path);
 
+    ~PeerStub();
+
     void SetDelegate(const std::weak_ptr<Delegate> &delegate);
     void ResetDelegate();
 
@@ -58,22 +53,31 @@ public:
     std::string Name() const;
 
 private:
-    PeerStub() { }
+    PeerStub() :
+        properties_changed_id_(0),
+        ready_(false) {
+    }
 
     Ptr FinalizeConstruction(const std::string &object_path);
 
-    void ConnectSignals();
-    void SyncProperties(bool update_delegate = true);
-
-    std::string RetrieveAddressFromProxy();
+    // Pulls all peer properties with a single GetAll call on the bus
+    // connection; fetches for different peers run concurrently so a
+    // scan result populates in one round-trip time.
+    void SyncProperties();
+    void ParseProperties(GVariant *properties);
 
 private:
-    static void OnPropertyChanged(GObject *source, GParamSpec *spec, gpointer user_data);
+    static void OnPropertiesChanged(GDBusConnection *connection, const gchar *sender_name,
+                                    const gchar *object_path, const gchar *interface_name,
+                                    const gchar *signal_name, GVariant *parameters,
+                                    gpointer user_data);
 
 private:
     ac::ScopedGObject<GDBusConnection> connection_;
-    ac::ScopedGObject<WpaSupplicantPeer> proxy_;
     std::weak_ptr<Delegate> delegate_;
+    std::string object_path_;
+    guint properties_changed_id_;
+    bool ready_;
     ac::MacAddress address_;
     std::string name_;
 };
@@ -15,15 +15,42 @@
  *
  */
 
-#include <sys/prctl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
 
 #include <ac/logger.h>
 #include <ac/keep_alive.h>
 
 #include "processexecutor.h"
 
+extern char **environ;
+
 namespace w11tng {
 
+std::string ProcessExecutor::ResolveBinaryPath(const std::string &name) {
+    static std::unordered_map<std::string, std::string> cache;
+
+    auto iter = cache.find(name);
+    if (iter != cache.end())
+        return iter->second;
+
+    auto resolved = g_find_program_in_path(name.c_str());
+    if (!resolved) {
+        AC_WARNING("Could not find binary %s", name);
+        return "";
+    }
+
+    cache[name] = resolved;
+    g_free(resolved);
+
+    return cache[name];
+}
+
 ProcessExecutor::Ptr ProcessExecutor::Create(const std::string &path, const std::vector<std::string> &argv,
                                              const std::weak_ptr<Delegate> &delegate) {
     return std::shared_ptr<ProcessExecutor>(new ProcessExecutor(delegate))->FinalizeConstruction(path, argv);
@@ -32,37 +59,83 @@ ProcessExecutor::Ptr ProcessExecutor::Create(const std::string &path, const std:
 ProcessExecutor::Ptr ProcessExecutor::FinalizeConstruction(const std::string &path, const std::vector<std::string> &argv) {
     auto sp = shared_from_this();
 
-    auto arguments = g_ptr_array_new();
-    g_ptr_array_add(arguments, (gpointer) path.c_str());
-    for (auto arg : argv)
-        g_ptr_array_add(arguments, (gpointer) g_strdup(arg.c_str()));
-    g_ptr_array_add(arguments, nullptr);
+    // posix_spawn does not walk PATH for us so resolve relative names
+    // upfront; the lookup result is cached across invocations.
+    auto binary = path;
+    if (binary.length() > 0 && binary.at(0) != '/')
+        binary = ResolveBinaryPath(path);
+
+    if (binary.length() == 0) {
+        AC_ERROR("No valid binary to execute for %s", path);
+        return sp;
+    }
+
+    std::vector<char*> arguments;
+    arguments.push_back(const_cast<char*>(binary.c_str()));
+    for (const auto &arg : argv)
+        arguments.push_back(const_cast<char*>(arg.c_str()));
+    arguments.push_back(nullptr);
 
-    auto cmdline = g_strjoinv(" ", reinterpret_cast<gchar**>(arguments->pdata));
+    auto cmdline = g_strjoinv(" ", arguments.data());
     AC_DEBUG("Running with: %s", cmdline);
     g_free(cmdline);
 
-    GError *error = nullptr;
-    if (!g_spawn_async(nullptr, reinterpret_cast<gchar**>(arguments->pdata), nullptr,
-                       GSpawnFlags(G_SPAWN_DO_NOT_REAP_CHILD),
-                       [](gpointer user_data) { prctl(PR_SET_PDEATHSIG, SIGKILL); }, nullptr,
-                       &pid_, &error)) {
+    // The child's stdout/stderr are wired to a pipe via file actions so
+    // its output ends up in our own log rather than on our terminal.
+    int output_fds[2] = { -1, -1 };
+    if (::pipe(output_fds) < 0) {
+        AC_ERROR("Failed to create output pipe: %s", std::strerror(errno));
+        return sp;
+    }
 
-        AC_ERROR("Failed to spawn DHCP server: %s", error->message);
-        g_error_free(error);
-        g_ptr_array_free(arguments, FALSE);
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_adddup2(&file_actions, output_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&file_actions, output_fds[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&file_actions, output_fds[0]);
+    posix_spawn_file_actions_addclose(&file_actions, output_fds[1]);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    // Give the child a clean signal disposition; we inherit quite a
+    // few handlers from the glib main loop setup.
+    sigset_t default_signals;
+    sigfillset(&default_signals);
+    posix_spawnattr_setsigdefault(&attr, &default_signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid = -1;
+    const auto err = ::posix_spawn(&pid, binary.c_str(), &file_actions, &attr,
+                                   arguments.data(), environ);
+
+    posix_spawn_file_actions_destroy(&file_actions);
+    posix_spawnattr_destroy(&attr);
+    ::close(output_fds[1]);
+
+    if (err != 0) {
+        AC_ERROR("Failed to spawn %s: %s", binary, std::strerror(err));
+        ::close(output_fds[0]);
         return sp;
     }
 
-    g_ptr_array_free(arguments, FALSE);
+    pid_ = pid;
+
+    output_channel_ = g_io_channel_unix_new(output_fds[0]);
+    g_io_channel_set_close_on_unref(output_channel_, TRUE);
+    output_watch_ = g_io_add_watch_full(output_channel_, 0, GIOCondition(G_IO_IN | G_IO_HUP),
+        &ProcessExecutor::OnOutputAvailable,
+        new ac::WeakKeepAlive<ProcessExecutor>(shared_from_this()),
+        [](gpointer data) { delete static_cast<ac::WeakKeepAlive<ProcessExecutor>*>(data); });
 
     process_watch_ = g_child_watch_add_full(0, pid_, [](GPid pid, gint status, gpointer user_data) {
         auto thiz = static_cast<ac::WeakKeepAlive<ProcessExecutor>*>(user_data)->GetInstance().lock();
 
         if (!WIFEXITED(status))
-            AC_WARNING("DHCP server (pid %d) exited with status %d", pid, status);
+            AC_WARNING("Process (pid %d) exited with status %d", pid, status);
         else
-            AC_DEBUG("DHCP server successfully terminated");
+            AC_DEBUG("Process (pid %d) successfully terminated", pid);
+
+        g_spawn_close_pid(pid);
 
         if (not thiz)
             return;
@@ -76,17 +149,49 @@ ProcessExecutor::Ptr ProcessExecutor::FinalizeConstruction(const std::string &pa
     }, new ac::WeakKeepAlive<ProcessExecutor>(shared_from_this()),
     [](gpointer data) { delete static_cast<ac::WeakKeepAlive<ProcessExecutor>*>(data); });
 
-
     return sp;
 }
 
+gboolean ProcessExecutor::OnOutputAvailable(GIOChannel *channel, GIOCondition condition, gpointer user_data) {
+    auto thiz = static_cast<ac::WeakKeepAlive<ProcessExecutor>*>(user_data)->GetInstance().lock();
+
+    if (not thiz)
+        return FALSE;
+
+    if (condition & G_IO_IN) {
+        gchar *line = nullptr;
+        gsize length = 0;
+        while (g_io_channel_read_line(channel, &line, &length, nullptr, nullptr) == G_IO_STATUS_NORMAL) {
+            if (length > 0 && line[length - 1] == '\n')
+                line[length - 1] = 0;
+            AC_DEBUG("[pid %d] %s", thiz->pid_, line);
+            g_free(line);
+        }
+    }
+
+    if (condition & G_IO_HUP) {
+        thiz->output_watch_ = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 ProcessExecutor::ProcessExecutor(const std::weak_ptr<Delegate> &delegate) :
     delegate_(delegate),
     pid_(-1),
-    process_watch_(0) {
+    process_watch_(0),
+    output_watch_(0),
+    output_channel_(nullptr) {
 }
 
 ProcessExecutor::~ProcessExecutor() {
+    if (output_watch_ > 0)
+        g_source_remove(output_watch_);
+
+    if (output_channel_)
+        g_io_channel_unref(output_channel_);
+
     if (pid_ <= 0)
         return;
 
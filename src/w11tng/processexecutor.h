@@ -27,6 +27,12 @@
 #include <ac/non_copyable.h>
 
 namespace w11tng {
+// Launches helper binaries through posix_spawn rather than fork/exec.
+// The daemon's address space carries the whole media stack so a plain
+// fork would copy all its page tables and could dead-lock on allocator
+// locks held by other threads; posix_spawn shares the address space
+// until exec and avoids both. Binary locations are resolved against
+// PATH only once per binary and reused for repeated invocations.
 class ProcessExecutor : public std::enable_shared_from_this<ProcessExecutor> {
 public:
     typedef std::shared_ptr<ProcessExecutor> Ptr;
@@ -38,11 +44,17 @@ public:
 
     static Ptr Create(const std::string &path, const std::vector<std::string> &argv, const std::weak_ptr<Delegate> &delegate);
 
+    // Resolves a binary name to an absolute path against PATH; results
+    // are cached so repeated launches skip the directory walk.
+    static std::string ResolveBinaryPath(const std::string &name);
+
     ~ProcessExecutor();
 
     bool Running() const { return pid_ > 0; }
 
 private:
+    static gboolean OnOutputAvailable(GIOChannel *channel, GIOCondition condition, gpointer user_data);
+
     ProcessExecutor(const std::weak_ptr<Delegate> &delegate);
     Ptr FinalizeConstruction(const std::string &path, const std::vector<std::string> &argv);
 
@@ -50,6 +62,8 @@ private:
     std::weak_ptr<Delegate> delegate_;
     GPid pid_;
     guint process_watch_;
+    guint output_watch_;
+    GIOChannel *output_channel_;
 };
 } // namespace w11tng
 
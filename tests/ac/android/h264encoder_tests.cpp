@@ -736,7 +736,7 @@ TEST_F(H264EncoderFixture, ExecuteProvidesBuffers) {
     EXPECT_CALL(*encoder_delegate, OnBufferWithCodecConfig(_))
             .Times(0);
 
-    EXPECT_CALL(*mock_report, FinishedFrame(_))
+    EXPECT_CALL(*mock_report, FinishedFrame(_, _))
             .Times(1);
 
     EXPECT_TRUE(encoder->Execute());
@@ -800,7 +800,7 @@ TEST_F(H264EncoderFixture, HandsBuffersWithCodecSpecificDataBack) {
     EXPECT_CALL(*encoder_delegate, OnBufferAvailable(_))
             .Times(1);
 
-    EXPECT_CALL(*mock_report, FinishedFrame(_))
+    EXPECT_CALL(*mock_report, FinishedFrame(_, _))
             .Times(1);
 
     EXPECT_TRUE(encoder->Execute());
@@ -31,7 +31,7 @@ public:
     MOCK_METHOD0(Started, void());
     MOCK_METHOD0(Stopped, void());
     MOCK_METHOD1(BeganFrame, void(const ac::TimestampUs&));
-    MOCK_METHOD1(FinishedFrame, void(const ac::TimestampUs&));
+    MOCK_METHOD2(FinishedFrame, void(const ac::TimestampUs&, const ac::FrameId&));
     MOCK_METHOD1(ReceivedInputBuffer, void(const ac::TimestampUs&));
 };
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2015 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ac/asynclogger.h"
+
+namespace {
+struct CollectingLogger : public ac::Logger {
+    void Init(const ac::Logger::Severity&) override {
+    }
+
+    void Log(Severity severity, const std::string &message, const boost::optional<Location>&) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        records.push_back(std::make_pair(severity, message));
+    }
+
+    std::mutex mutex;
+    std::vector<std::pair<Severity, std::string>> records;
+};
+}
+
+TEST(AsyncLogger, DeliversRecordsInOrder) {
+    const auto target = std::make_shared<CollectingLogger>();
+
+    {
+        ac::AsyncLogger logger(target);
+        for (int n = 0; n < 100; n++)
+            logger.Log(ac::Logger::Severity::kInfo, std::to_string(n),
+                       boost::optional<ac::Logger::Location>{});
+        // The destructor drains everything still queued before the
+        // writer goes away.
+    }
+
+    ASSERT_EQ(100, target->records.size());
+    for (int n = 0; n < 100; n++)
+        EXPECT_EQ(std::to_string(n), target->records[n].second);
+}
+
+TEST(AsyncLogger, WakesParkedWriterAfterQuiescence) {
+    const auto target = std::make_shared<CollectingLogger>();
+
+    ac::AsyncLogger logger(target);
+    logger.Log(ac::Logger::Severity::kInfo, "first",
+               boost::optional<ac::Logger::Location>{});
+
+    // Give the writer time to drain the ring and park itself; it has
+    // no periodic poll anymore, so prompt delivery of the next record
+    // proves the producer-side wakeup works.
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    logger.Log(ac::Logger::Severity::kInfo, "second",
+               boost::optional<ac::Logger::Location>{});
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{2};
+    while (std::chrono::steady_clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> guard(target->mutex);
+            if (target->records.size() == 2)
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    std::lock_guard<std::mutex> guard(target->mutex);
+    ASSERT_EQ(2, target->records.size());
+    EXPECT_EQ("second", target->records[1].second);
+}
+
+TEST(AsyncLogger, ForwardsSeverity) {
+    const auto target = std::make_shared<CollectingLogger>();
+
+    {
+        ac::AsyncLogger logger(target);
+        logger.Log(ac::Logger::Severity::kError, "broken",
+                   boost::optional<ac::Logger::Location>{});
+    }
+
+    ASSERT_EQ(1, target->records.size());
+    EXPECT_EQ(ac::Logger::Severity::kError, target->records[0].first);
+    EXPECT_EQ("broken", target->records[0].second);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fstream>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <gmock/gmock.h>
+
+#include "ac/common/cachetopology.h"
+
+using namespace ::testing;
+
+namespace {
+void MakeDir(const std::string &path) {
+    ::mkdir(path.c_str(), 0755);
+}
+
+void WriteFile(const std::string &path, const std::string &content) {
+    std::ofstream file(path);
+    file << content << std::endl;
+}
+
+// A fresh fake sysfs cpu directory per test
+std::string MakeRoot() {
+    char path[] = "/tmp/cachetopology-XXXXXX";
+    return ::mkdtemp(path);
+}
+
+void AddCache(const std::string &cpu_dir, int index, const std::string &level,
+              const std::string &type, const std::string &shared_list) {
+    const auto cache_dir = cpu_dir + "/cache/index" + std::to_string(index);
+    MakeDir(cache_dir);
+    WriteFile(cache_dir + "/level", level);
+    WriteFile(cache_dir + "/type", type);
+    WriteFile(cache_dir + "/shared_cpu_list", shared_list);
+}
+
+void AddCpu(const std::string &root, int cpu, const std::string &l2_list,
+            const std::string &max_freq) {
+    const auto cpu_dir = root + "/cpu" + std::to_string(cpu);
+    MakeDir(cpu_dir);
+    MakeDir(cpu_dir + "/cache");
+
+    // Per-core L1 caches which placement has to skip over
+    AddCache(cpu_dir, 0, "1", "Data", std::to_string(cpu));
+    AddCache(cpu_dir, 1, "1", "Instruction", std::to_string(cpu));
+    AddCache(cpu_dir, 2, "2", "Unified", l2_list);
+
+    MakeDir(cpu_dir + "/cpufreq");
+    WriteFile(cpu_dir + "/cpufreq/cpuinfo_max_freq", max_freq);
+}
+
+typedef std::vector<std::vector<int>> Groups;
+}
+
+TEST(CacheTopology, GroupsClustersBySharedL2AndRanksByFrequency) {
+    const auto root = MakeRoot();
+
+    // Classic big.LITTLE: the slow cluster holds the low CPU numbers
+    AddCpu(root, 0, "0-1", "1400000");
+    AddCpu(root, 1, "0-1", "1400000");
+    AddCpu(root, 2, "2-3", "2100000");
+    AddCpu(root, 3, "2-3", "2100000");
+
+    EXPECT_EQ((Groups{{2, 3}, {0, 1}}), ac::common::CacheTopology::ReadGroups(root));
+}
+
+TEST(CacheTopology, ParsesCommaSeparatedSharedLists) {
+    const auto root = MakeRoot();
+
+    AddCpu(root, 0, "0,2", "1000000");
+    AddCpu(root, 1, "1,3", "1000000");
+    AddCpu(root, 2, "0,2", "1000000");
+    AddCpu(root, 3, "1,3", "1000000");
+
+    // Same frequency everywhere, so the lower first CPU wins the tie
+    EXPECT_EQ((Groups{{0, 2}, {1, 3}}), ac::common::CacheTopology::ReadGroups(root));
+}
+
+TEST(CacheTopology, CollapsesToOneGroupWithoutCacheInformation) {
+    const auto root = MakeRoot();
+
+    for (int cpu = 0; cpu < 4; cpu++)
+        MakeDir(root + "/cpu" + std::to_string(cpu));
+
+    EXPECT_EQ((Groups{{0, 1, 2, 3}}), ac::common::CacheTopology::ReadGroups(root));
+}
+
+TEST(CacheTopology, YieldsNothingForAnEmptyTree) {
+    EXPECT_EQ(Groups{}, ac::common::CacheTopology::ReadGroups(MakeRoot()));
+}
@@ -15,9 +15,16 @@
  *
  */
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <stdlib.h>
+
 #include <gmock/gmock.h>
 
 #include "ac/common/executorpool.h"
+#include "ac/common/threadedexecutorfactory.h"
 
 using namespace ::testing;
 
@@ -126,15 +133,16 @@ TEST(ExecutorPool, RecoversFromFailedExecutorStart) {
             .Times(0);
 
     ac::common::Executable::Ptr executable0 = std::make_shared<MockExecutable>();
-
-    EXPECT_CALL(*factory, Create(executable0))
-            .Times(1)
-            .WillOnce(Return(executor0));
-
     ac::common::Executable::Ptr executable1 = std::make_shared<MockExecutable>();
 
-    EXPECT_CALL(*factory, Create(executable1))
-            .Times(1)
+    // The pool hands its heartbeat wrapper to the factory, so the
+    // executables can only be paired with their executors by order.
+    Sequence create_order;
+    EXPECT_CALL(*factory, Create(_))
+            .InSequence(create_order)
+            .WillOnce(Return(executor0));
+    EXPECT_CALL(*factory, Create(_))
+            .InSequence(create_order)
             .WillOnce(Return(executor1));
 
     ac::common::ExecutorPool pool(factory, 2);
@@ -175,15 +183,14 @@ TEST(ExecutorPool, OnlyStopsWhenAllExecutorsAreStopped) {
             .WillOnce(Return(true));
 
     ac::common::Executable::Ptr executable0 = std::make_shared<MockExecutable>();
-
-    EXPECT_CALL(*factory, Create(executable0))
-            .Times(1)
-            .WillOnce(Return(executor0));
-
     ac::common::Executable::Ptr executable1 = std::make_shared<MockExecutable>();
 
-    EXPECT_CALL(*factory, Create(executable1))
-            .Times(1)
+    Sequence create_order;
+    EXPECT_CALL(*factory, Create(_))
+            .InSequence(create_order)
+            .WillOnce(Return(executor0));
+    EXPECT_CALL(*factory, Create(_))
+            .InSequence(create_order)
             .WillOnce(Return(executor1));
 
     ac::common::ExecutorPool pool(factory, 2);
@@ -195,3 +202,215 @@ TEST(ExecutorPool, OnlyStopsWhenAllExecutorsAreStopped) {
     EXPECT_FALSE(pool.Stop());
     EXPECT_TRUE(pool.Running());
 }
+
+namespace {
+// Simulates a deadlocked pipeline stage: Execute() only comes back
+// once Stop() releases it.
+class StallingExecutable : public ac::common::Executable {
+public:
+    bool Start() override { return true; }
+
+    bool Stop() override {
+        release_.store(true);
+        return true;
+    }
+
+    bool Execute() override {
+        while (!release_.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return false;
+    }
+
+    std::string Name() const override { return "StallingExecutable"; }
+
+private:
+    std::atomic<bool> release_{false};
+};
+
+// Wedges on its first iteration and unwedges when the watchdog
+// kicks it through RecoverFromStall()
+class SelfRecoveringExecutable : public ac::common::Executable {
+public:
+    bool Start() override { return true; }
+
+    bool Stop() override {
+        release_.store(true);
+        return true;
+    }
+
+    bool Execute() override {
+        if (!wedged_once_.exchange(true)) {
+            while (!release_.load())
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        return true;
+    }
+
+    bool RecoverFromStall() override {
+        recoveries_++;
+        release_.store(true);
+        return true;
+    }
+
+    std::string Name() const override { return "SelfRecoveringExecutable"; }
+
+    int Recoveries() const { return recoveries_.load(); }
+
+private:
+    std::atomic<bool> wedged_once_{false};
+    std::atomic<bool> release_{false};
+    std::atomic<int> recoveries_{0};
+};
+
+// Accepts the recovery kick but stays wedged anyway
+class UnrecoverableExecutable : public ac::common::Executable {
+public:
+    bool Start() override { return true; }
+
+    bool Stop() override {
+        release_.store(true);
+        return true;
+    }
+
+    bool Execute() override {
+        while (!release_.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return false;
+    }
+
+    bool RecoverFromStall() override {
+        recoveries_++;
+        return true;
+    }
+
+    std::string Name() const override { return "UnrecoverableExecutable"; }
+
+    int Recoveries() const { return recoveries_.load(); }
+
+private:
+    std::atomic<bool> release_{false};
+    std::atomic<int> recoveries_{0};
+};
+
+// A healthy stage which returns from every iteration right away
+class SpinningExecutable : public ac::common::Executable {
+public:
+    bool Start() override { return true; }
+    bool Stop() override { return true; }
+
+    bool Execute() override {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return true;
+    }
+
+    std::string Name() const override { return "SpinningExecutable"; }
+};
+}
+
+TEST(ExecutorPool, WatchdogReportsAStalledStage) {
+    ::setenv("AETHERCAST_PIPELINE_WATCHDOG", "50", 1);
+
+    auto factory = std::make_shared<ac::common::ThreadedExecutorFactory>();
+    ac::common::ExecutorPool pool(factory, 1);
+
+    EXPECT_TRUE(pool.Add(std::make_shared<StallingExecutable>()));
+
+    std::atomic<int> stalls{0};
+    pool.SetStallHandler([&]() { stalls++; });
+
+    EXPECT_TRUE(pool.Start());
+
+    // Threshold is 50ms and the watchdog looks every 100ms; two
+    // seconds is plenty even on a loaded builder
+    for (int n = 0; n < 200 && stalls.load() == 0; n++)
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+    EXPECT_EQ(1, stalls.load());
+
+    EXPECT_TRUE(pool.Stop());
+
+    // One stall reports exactly once, no matter how long it lasted
+    EXPECT_EQ(1, stalls.load());
+
+    ::unsetenv("AETHERCAST_PIPELINE_WATCHDOG");
+}
+
+TEST(ExecutorPool, WatchdogStaysQuietForAHealthyPipeline) {
+    ::setenv("AETHERCAST_PIPELINE_WATCHDOG", "50", 1);
+
+    auto factory = std::make_shared<ac::common::ThreadedExecutorFactory>();
+    ac::common::ExecutorPool pool(factory, 1);
+
+    EXPECT_TRUE(pool.Add(std::make_shared<SpinningExecutable>()));
+
+    std::atomic<int> stalls{0};
+    pool.SetStallHandler([&]() { stalls++; });
+
+    EXPECT_TRUE(pool.Start());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{400});
+
+    EXPECT_TRUE(pool.Stop());
+
+    EXPECT_EQ(0, stalls.load());
+
+    ::unsetenv("AETHERCAST_PIPELINE_WATCHDOG");
+}
+
+TEST(ExecutorPool, WatchdogLetsAStageUnwedgeItself) {
+    ::setenv("AETHERCAST_PIPELINE_WATCHDOG", "50", 1);
+
+    auto factory = std::make_shared<ac::common::ThreadedExecutorFactory>();
+    ac::common::ExecutorPool pool(factory, 1);
+
+    auto executable = std::make_shared<SelfRecoveringExecutable>();
+    EXPECT_TRUE(pool.Add(executable));
+
+    std::atomic<int> stalls{0};
+    pool.SetStallHandler([&]() { stalls++; });
+
+    EXPECT_TRUE(pool.Start());
+
+    for (int n = 0; n < 200 && executable->Recoveries() == 0; n++)
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+    // Leave the watchdog a few more rounds to make sure it does not
+    // escalate a stall the stage already recovered from
+    std::this_thread::sleep_for(std::chrono::milliseconds{300});
+
+    EXPECT_TRUE(pool.Stop());
+
+    EXPECT_EQ(1, executable->Recoveries());
+    EXPECT_EQ(0, stalls.load());
+
+    ::unsetenv("AETHERCAST_PIPELINE_WATCHDOG");
+}
+
+TEST(ExecutorPool, WatchdogEscalatesWhenRecoveryGoesNowhere) {
+    ::setenv("AETHERCAST_PIPELINE_WATCHDOG", "50", 1);
+
+    auto factory = std::make_shared<ac::common::ThreadedExecutorFactory>();
+    ac::common::ExecutorPool pool(factory, 1);
+
+    auto executable = std::make_shared<UnrecoverableExecutable>();
+    EXPECT_TRUE(pool.Add(executable));
+
+    std::atomic<int> stalls{0};
+    pool.SetStallHandler([&]() { stalls++; });
+
+    EXPECT_TRUE(pool.Start());
+
+    for (int n = 0; n < 200 && stalls.load() == 0; n++)
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+    EXPECT_TRUE(pool.Stop());
+
+    EXPECT_EQ(1, stalls.load());
+    // A stuck iteration gets exactly one recovery attempt before the
+    // session-wide handler takes over
+    EXPECT_EQ(1, executable->Recoveries());
+
+    ::unsetenv("AETHERCAST_PIPELINE_WATCHDOG");
+}
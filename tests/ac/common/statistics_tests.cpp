@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ac/common/statistics.h"
+
+namespace {
+double ExactQuantile(std::vector<double> values, double quantile) {
+    std::sort(values.begin(), values.end());
+    auto index = static_cast<int>(std::ceil(quantile * values.size())) - 1;
+    if (index < 0)
+        index = 0;
+    return values[index];
+}
+}
+
+TEST(PercentileEstimator, ExactForSmallSamples) {
+    ac::common::PercentileEstimator estimator(0.5);
+    estimator.Add(3.0);
+    estimator.Add(1.0);
+    estimator.Add(2.0);
+    EXPECT_DOUBLE_EQ(2.0, estimator.Estimate());
+}
+
+TEST(PercentileEstimator, EmptyEstimatorReportsZero) {
+    ac::common::PercentileEstimator estimator(0.99);
+    EXPECT_DOUBLE_EQ(0.0, estimator.Estimate());
+    EXPECT_EQ(0ull, estimator.Count());
+}
+
+TEST(PercentileEstimator, TracksQuantilesOfUniformData) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(0.0, 100.0);
+
+    ac::common::PercentileEstimator median(0.5);
+    ac::common::PercentileEstimator p99(0.99);
+    std::vector<double> values;
+
+    for (unsigned int n = 0; n < 10000; n++) {
+        const auto value = distribution(generator);
+        median.Add(value);
+        p99.Add(value);
+        values.push_back(value);
+    }
+
+    EXPECT_NEAR(ExactQuantile(values, 0.5), median.Estimate(), 2.0);
+    EXPECT_NEAR(ExactQuantile(values, 0.99), p99.Estimate(), 2.0);
+}
+
+TEST(PercentileEstimator, TracksTailOfSkewedData) {
+    std::mt19937 generator(7);
+    // Latency-shaped data: lots of small values, a long tail
+    std::exponential_distribution<double> distribution(1.0 / 5.0);
+
+    ac::common::PercentileEstimator p99(0.99);
+    std::vector<double> values;
+
+    for (unsigned int n = 0; n < 10000; n++) {
+        const auto value = distribution(generator);
+        p99.Add(value);
+        values.push_back(value);
+    }
+
+    const auto exact = ExactQuantile(values, 0.99);
+    EXPECT_NEAR(exact, p99.Estimate(), exact * 0.15);
+}
+
+TEST(Statistics, SummarizesMomentsExactly) {
+    ac::common::Statistics statistics;
+    for (const auto value : {2.0, 4.0, 4.0, 4.0, 5.0, 5.0, 7.0, 9.0})
+        statistics.Add(value);
+
+    EXPECT_EQ(8ull, statistics.Count());
+    EXPECT_DOUBLE_EQ(2.0, statistics.Min());
+    EXPECT_DOUBLE_EQ(9.0, statistics.Max());
+    EXPECT_DOUBLE_EQ(5.0, statistics.Mean());
+    EXPECT_NEAR(2.138, statistics.StdDev(), 0.001);
+}
+
+TEST(Statistics, ProvidesConfiguredQuantiles) {
+    ac::common::Statistics statistics(std::vector<double>{0.5, 0.95});
+
+    for (unsigned int n = 1; n <= 1000; n++)
+        statistics.Add(static_cast<double>(n));
+
+    EXPECT_NEAR(500.0, statistics.Quantile(0.5), 10.0);
+    EXPECT_NEAR(950.0, statistics.Quantile(0.95), 10.0);
+    // Quantiles that were not requested are not tracked
+    EXPECT_DOUBLE_EQ(0.0, statistics.Quantile(0.99));
+}
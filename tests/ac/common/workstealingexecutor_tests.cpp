@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <gmock/gmock.h>
+
+#include "ac/common/executable.h"
+#include "ac/common/workstealingexecutor.h"
+#include "ac/common/workstealingexecutorfactory.h"
+
+using namespace ::testing;
+
+namespace {
+class MockExecutable : public ac::common::Executable {
+public:
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Execute, bool());
+
+    std::string Name() const override {
+        return "MockExecutable";
+    }
+};
+
+class DedicatedExecutable : public MockExecutable {
+public:
+    bool PrefersDedicatedThread() const override { return true; }
+};
+
+// Records which threads ran it so tests can tell how work spread
+// over the pool.
+class ThreadRecordingExecutable : public ac::common::Executable {
+public:
+    bool Start() override { return true; }
+    bool Stop() override { return true; }
+
+    bool Execute() override {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            thread_ids_.insert(std::this_thread::get_id());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return true;
+    }
+
+    std::string Name() const override { return "ThreadRecording"; }
+
+    std::set<std::thread::id> ThreadIds() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return thread_ids_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::set<std::thread::id> thread_ids_;
+};
+}
+
+TEST(WorkStealingExecutor, CorrectStartAndStopBehaviour) {
+    auto executable = std::make_shared<MockExecutable>();
+
+    EXPECT_CALL(*executable, Start())
+            .Times(1)
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*executable, Stop())
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*executable, Execute())
+            .Times(AtLeast(0))
+            .WillRepeatedly(Return(true));
+
+    const auto pool = ac::common::WorkStealingExecutor::Create(2);
+    const auto executor = pool->CreateExecutor(executable);
+
+    EXPECT_FALSE(executor->Running());
+    EXPECT_FALSE(executor->Stop());
+    EXPECT_TRUE(executor->Start());
+    EXPECT_TRUE(executor->Running());
+    EXPECT_TRUE(executor->Stop());
+    EXPECT_FALSE(executor->Stop());
+}
+
+TEST(WorkStealingExecutor, SpreadsExecutablesOverMultipleWorkers) {
+    const auto pool = ac::common::WorkStealingExecutor::Create(4);
+    EXPECT_EQ(4u, pool->WorkerCount());
+
+    std::vector<std::shared_ptr<ThreadRecordingExecutable>> executables;
+    std::vector<ac::common::Executor::Ptr> executors;
+
+    for (int n = 0; n < 8; n++) {
+        auto executable = std::make_shared<ThreadRecordingExecutable>();
+        auto executor = pool->CreateExecutor(executable);
+        EXPECT_TRUE(executor->Start());
+        executables.push_back(executable);
+        executors.push_back(executor);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{200});
+
+    for (const auto &executor : executors)
+        EXPECT_TRUE(executor->Stop());
+
+    // Eight busy executables on four workers cannot all have stayed
+    // on one thread.
+    std::set<std::thread::id> all_threads;
+    for (const auto &executable : executables) {
+        EXPECT_FALSE(executable->ThreadIds().empty());
+        for (const auto &id : executable->ThreadIds())
+            all_threads.insert(id);
+    }
+    EXPECT_GT(all_threads.size(), 1u);
+}
+
+TEST(WorkStealingExecutor, NeverRunsOneExecutableConcurrently) {
+    const auto pool = ac::common::WorkStealingExecutor::Create(4);
+
+    std::atomic<int> active{0};
+    std::atomic<bool> overlapped{false};
+
+    auto executable = std::make_shared<MockExecutable>();
+    EXPECT_CALL(*executable, Start()).WillOnce(Return(true));
+    EXPECT_CALL(*executable, Stop()).WillOnce(Return(true));
+    EXPECT_CALL(*executable, Execute())
+            .Times(AtLeast(1))
+            .WillRepeatedly(Invoke([&]() {
+                if (++active > 1)
+                    overlapped.exchange(true);
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                --active;
+                return true;
+            }));
+
+    const auto executor = pool->CreateExecutor(executable);
+    EXPECT_TRUE(executor->Start());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+    EXPECT_TRUE(executor->Stop());
+    EXPECT_FALSE(overlapped);
+}
+
+TEST(WorkStealingExecutor, StopsExecutingWhenExecutableAsksForIt) {
+    auto executable = std::make_shared<MockExecutable>();
+
+    EXPECT_CALL(*executable, Start())
+            .Times(1)
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*executable, Stop())
+            .Times(1)
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*executable, Execute())
+            .Times(1)
+            .WillOnce(Return(false));
+
+    const auto pool = ac::common::WorkStealingExecutor::Create(2);
+    const auto executor = pool->CreateExecutor(executable);
+
+    EXPECT_TRUE(executor->Start());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+    EXPECT_TRUE(executor->Stop());
+}
+
+TEST(WorkStealingExecutor, ExecutableCanBeRescheduledAfterRemoval) {
+    auto executable = std::make_shared<MockExecutable>();
+
+    EXPECT_CALL(*executable, Start())
+            .Times(2)
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*executable, Stop())
+            .Times(2)
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*executable, Execute())
+            .Times(AtLeast(1))
+            .WillRepeatedly(Invoke([]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                return true;
+            }));
+
+    const auto pool = ac::common::WorkStealingExecutor::Create(2);
+    const auto executor = pool->CreateExecutor(executable);
+
+    EXPECT_TRUE(executor->Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    EXPECT_TRUE(executor->Stop());
+
+    EXPECT_TRUE(executor->Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    EXPECT_TRUE(executor->Stop());
+}
+
+TEST(WorkStealingExecutorFactory, HonorsDedicatedThreadPreference) {
+    auto pooled = std::make_shared<MockExecutable>();
+    auto dedicated = std::make_shared<DedicatedExecutable>();
+
+    const auto factory = std::make_shared<ac::common::WorkStealingExecutorFactory>();
+
+    const auto pooled_executor = factory->Create(pooled);
+    const auto dedicated_executor = factory->Create(dedicated);
+
+    EXPECT_NE(nullptr, pooled_executor);
+    EXPECT_NE(nullptr, dedicated_executor);
+    EXPECT_FALSE(pooled_executor->Running());
+    EXPECT_FALSE(dedicated_executor->Running());
+}
+
+TEST(WorkStealingExecutorFactory, InstancesShareOnePool) {
+    const auto first = ac::common::WorkStealingExecutor::SharedInstance();
+    const auto second = ac::common::WorkStealingExecutor::SharedInstance();
+
+    EXPECT_EQ(first.get(), second.get());
+}
@@ -20,6 +20,8 @@
 #include <ac/dbus/controllerskeleton.h>
 
 namespace {
+typedef std::map<std::string, std::uint64_t> RuntimeMetricsMap;
+
 struct MockController : public ac::Controller {
     MOCK_METHOD1(SetDelegate, void(const std::weak_ptr<ac::Controller::Delegate> &));
     MOCK_METHOD0(ResetDelegate, void());
@@ -32,6 +34,11 @@ struct MockController : public ac::Controller {
 
     MOCK_CONST_METHOD0(State, ac::NetworkDeviceState());
     MOCK_CONST_METHOD0(Capabilities, std::vector<ac::NetworkManager::Capability>());
+    MOCK_CONST_METHOD0(ConnectionTrace, std::vector<std::string>());
+    MOCK_CONST_METHOD0(RuntimeMetrics, RuntimeMetricsMap());
+    MOCK_METHOD0(OpenFrameTap, int());
+    MOCK_METHOD2(TakeSnapshot, bool(std::uint32_t, ac::video::SnapshotTap::Image*));
+    MOCK_CONST_METHOD0(Ready, bool());
     MOCK_CONST_METHOD0(Scanning, bool());
     MOCK_CONST_METHOD0(Enabled, bool());
 
@@ -60,6 +67,10 @@ TEST(ControllerSkeleton, ForwardsCallsToImpl) {
     EXPECT_CALL(*impl, Scan(_)).Times(1).WillRepeatedly(Return(ac::Error::kNone));
     EXPECT_CALL(*impl, State()).Times(1).WillRepeatedly(Return(ac::NetworkDeviceState::kConnected));
     EXPECT_CALL(*impl, Capabilities()).Times(1).WillRepeatedly(Return(std::vector<ac::NetworkManager::Capability>{ac::NetworkManager::Capability::kSource}));
+    EXPECT_CALL(*impl, ConnectionTrace()).Times(AtLeast(1)).WillRepeatedly(Return(std::vector<std::string>{}));
+    EXPECT_CALL(*impl, RuntimeMetrics()).Times(1).WillRepeatedly(Return(RuntimeMetricsMap{}));
+    EXPECT_CALL(*impl, OpenFrameTap()).Times(1).WillRepeatedly(Return(-1));
+    EXPECT_CALL(*impl, Ready()).Times(1).WillRepeatedly(Return(true));
     EXPECT_CALL(*impl, Scanning()).Times(1).WillRepeatedly(Return(true));
     EXPECT_CALL(*impl, Enabled()).Times(1).WillRepeatedly(Return(true));
     EXPECT_CALL(*impl, SetEnabled(false)).Times(1).WillRepeatedly(Return(ac::Error::kNone));
@@ -73,6 +84,10 @@ TEST(ControllerSkeleton, ForwardsCallsToImpl) {
     fmc->Scan(std::chrono::seconds{10});
     fmc->State();
     fmc->Capabilities();
+    fmc->ConnectionTrace();
+    fmc->RuntimeMetrics();
+    fmc->OpenFrameTap();
+    fmc->Ready();
     fmc->Scanning();
     fmc->Enabled();
     fmc->SetEnabled(false);
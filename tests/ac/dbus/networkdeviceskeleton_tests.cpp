@@ -32,7 +32,7 @@ TEST(NetworkDeviceSkeleton, ForwardsCallsToImpl) {
     const ac::IpV4Address ipV4Address = ac::IpV4Address::from_string("127.0.0.1");
     const std::string name{"MeMyselfAndI"};
     const ac::NetworkDeviceState state{ac::NetworkDeviceState::kDisconnected};
-    const std::vector<ac::NetworkDeviceRole> roles{ac::NetworkDeviceRole::kSource};
+    const auto roles = ac::NetworkDevice::MakeRoleList({ac::NetworkDeviceRole::kSource});
 
     auto impl = std::make_shared<MockNetworkDevice>();
 
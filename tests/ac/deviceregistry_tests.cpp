@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "ac/deviceregistry.h"
+
+namespace {
+typedef std::shared_ptr<int> Entry;
+typedef ac::DeviceRegistry<Entry> Registry;
+}
+
+TEST(DeviceRegistry, InsertFindAndTake) {
+    Registry registry;
+
+    const auto first = std::make_shared<int>(1);
+    registry.Insert("/peer/1", first);
+
+    EXPECT_EQ(registry.Find("/peer/1"), first);
+    EXPECT_FALSE(registry.Find("/peer/2"));
+    EXPECT_EQ(registry.Size(), 1u);
+
+    EXPECT_EQ(registry.Take("/peer/1"), first);
+    EXPECT_FALSE(registry.Find("/peer/1"));
+    EXPECT_EQ(registry.Size(), 0u);
+}
+
+TEST(DeviceRegistry, InsertReplacesInPlace) {
+    Registry registry;
+
+    registry.Insert("/peer/1", std::make_shared<int>(1));
+    const auto replacement = std::make_shared<int>(2);
+    registry.Insert("/peer/1", replacement);
+
+    EXPECT_EQ(registry.Size(), 1u);
+    EXPECT_EQ(registry.Find("/peer/1"), replacement);
+}
+
+TEST(DeviceRegistry, HandleOutlivesNeitherRemovalNorSlotReuse) {
+    Registry registry;
+
+    const auto first = std::make_shared<int>(1);
+    registry.Insert("/peer/1", first);
+
+    const auto handle = registry.HandleOf("/peer/1");
+    EXPECT_EQ(registry.Get(handle), first);
+
+    registry.Take("/peer/1");
+    EXPECT_FALSE(registry.Get(handle));
+
+    // The freed slot gets reused with a bumped generation so the old
+    // handle must not resolve to the new entry.
+    registry.Insert("/peer/2", std::make_shared<int>(2));
+    EXPECT_FALSE(registry.Get(handle));
+    EXPECT_TRUE(registry.Get(registry.HandleOf("/peer/2")));
+}
+
+TEST(DeviceRegistry, ForEachVisitsOnlyLiveEntries) {
+    Registry registry;
+
+    registry.Insert("/peer/1", std::make_shared<int>(1));
+    registry.Insert("/peer/2", std::make_shared<int>(2));
+    registry.Insert("/peer/3", std::make_shared<int>(3));
+    registry.Take("/peer/2");
+
+    int sum = 0;
+    registry.ForEach([&sum](const std::string&, const Entry &entry) {
+        sum += *entry;
+    });
+
+    EXPECT_EQ(sum, 4);
+
+    const auto three = registry.FindIf([](const Entry &entry) {
+        return *entry == 3;
+    });
+    ASSERT_TRUE(!!three);
+    EXPECT_EQ(*three, 3);
+}
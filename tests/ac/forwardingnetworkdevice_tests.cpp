@@ -32,7 +32,7 @@ TEST(ForwardingNetworkDevice, ForwardsCallsToImpl) {
     const ac::IpV4Address ipV4Address = ac::IpV4Address::from_string("127.0.0.1");
     const std::string name{"MeMyselfAndI"};
     const ac::NetworkDeviceState state{ac::NetworkDeviceState::kDisconnected};
-    const std::vector<ac::NetworkDeviceRole> roles{ac::NetworkDeviceRole::kSource};
+    const auto roles = ac::NetworkDevice::MakeRoleList({ac::NetworkDeviceRole::kSource});
 
     auto impl = std::make_shared<MockNetworkDevice>();
 
@@ -47,4 +47,6 @@ TEST(ForwardingNetworkDevice, ForwardsCallsToImpl) {
     EXPECT_EQ(ipV4Address, fmc.IPv4Address());
     EXPECT_EQ(name, fmc.Name());
     EXPECT_EQ(state, fmc.State());
+    // Same handle, not just equal content: the snapshot must be passed
+    // through without being copied.
     EXPECT_EQ(roles, fmc.SupportedRoles());}
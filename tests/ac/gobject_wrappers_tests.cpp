@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <utility>
+
+#include <glib-object.h>
+
+#include <gtest/gtest.h>
+
+#include "ac/borrowed_gobject.h"
+#include "ac/scoped_gobject.h"
+#include "ac/shared_gobject.h"
+
+#include "tests/common/gobjectreftracker.h"
+
+namespace {
+GObject* NewObject() {
+    return static_cast<GObject*>(g_object_new(G_TYPE_OBJECT, nullptr));
+}
+}
+
+TEST(GObjectWrappers, ScopedWrapperUnrefsExactlyOnce) {
+    auto object = NewObject();
+
+    ac::testing::GObjectRefTracker::Reset();
+    ac::testing::GObjectRefTracker::Enable();
+
+    {
+        ac::ScopedGObject<GObject> scoped{object};
+        // Wrapping adopts the caller's reference; no ref churn allowed.
+        EXPECT_EQ(0, ac::testing::GObjectRefTracker::RefCount());
+        EXPECT_EQ(0, ac::testing::GObjectRefTracker::UnrefCount());
+    }
+
+    ac::testing::GObjectRefTracker::Disable();
+
+    EXPECT_EQ(0, ac::testing::GObjectRefTracker::RefCount());
+    EXPECT_EQ(1, ac::testing::GObjectRefTracker::UnrefCount());
+}
+
+TEST(GObjectWrappers, MovingAScopedWrapperIsFree) {
+    ac::ScopedGObject<GObject> scoped{NewObject()};
+
+    ac::testing::GObjectRefTracker::Reset();
+    ac::testing::GObjectRefTracker::Enable();
+
+    auto moved_to = std::move(scoped);
+
+    ac::testing::GObjectRefTracker::Disable();
+
+    EXPECT_EQ(0, ac::testing::GObjectRefTracker::RefCount());
+    EXPECT_EQ(0, ac::testing::GObjectRefTracker::UnrefCount());
+    EXPECT_NE(nullptr, moved_to.get());
+}
+
+TEST(GObjectWrappers, CopyingASharedWrapperIsFree) {
+    auto shared = ac::make_shared_gobject(NewObject());
+
+    ac::testing::GObjectRefTracker::Reset();
+    ac::testing::GObjectRefTracker::Enable();
+
+    // Copies bump the shared_ptr control block, not the GObject.
+    auto copy = shared;
+    auto another = copy;
+
+    ac::testing::GObjectRefTracker::Disable();
+
+    EXPECT_EQ(0, ac::testing::GObjectRefTracker::RefCount());
+    EXPECT_EQ(0, ac::testing::GObjectRefTracker::UnrefCount());
+
+    ac::testing::GObjectRefTracker::Reset();
+    ac::testing::GObjectRefTracker::Enable();
+
+    copy.reset();
+    another.reset();
+    shared.reset();
+
+    ac::testing::GObjectRefTracker::Disable();
+
+    // Only the last owner touches the reference count.
+    EXPECT_EQ(1, ac::testing::GObjectRefTracker::UnrefCount());
+}
+
+TEST(GObjectWrappers, BorrowedViewsNeverTouchTheRefCount) {
+    auto shared = ac::make_shared_gobject(NewObject());
+    ac::ScopedGObject<GObject> scoped{NewObject()};
+
+    ac::testing::GObjectRefTracker::Reset();
+    ac::testing::GObjectRefTracker::Enable();
+
+    {
+        ac::BorrowedGObject<GObject> from_shared{shared};
+        ac::BorrowedGObject<GObject> from_scoped{scoped};
+        auto copy = from_shared;
+
+        EXPECT_EQ(shared.get(), from_shared.get());
+        EXPECT_EQ(scoped.get(), from_scoped.get());
+        EXPECT_TRUE(!!copy);
+    }
+
+    ac::testing::GObjectRefTracker::Disable();
+
+    EXPECT_EQ(0, ac::testing::GObjectRefTracker::RefCount());
+    EXPECT_EQ(0, ac::testing::GObjectRefTracker::UnrefCount());
+}
+
+TEST(GObjectWrappers, DefaultBorrowedViewIsEmpty) {
+    ac::BorrowedGObject<GObject> view;
+    EXPECT_FALSE(!!view);
+    EXPECT_EQ(nullptr, view.get());
+}
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ac/logger.h"
+#include "ac/utils.h"
+
+#include "ac/common/clock.h"
+#include "ac/common/threadedexecutor.h"
+
+#include "ac/network/udpstream.h"
+
+#include "ac/report/null/packetizerreport.h"
+#include "ac/report/null/senderreport.h"
+
+#include "ac/streaming/mediasender.h"
+#include "ac/streaming/mpegtspacketizer.h"
+#include "ac/streaming/rtpsender.h"
+
+#include "ac/video/buffer.h"
+#include "ac/video/syntheticbufferproducer.h"
+
+#include "tests/common/statistics.h"
+
+using namespace ::testing;
+
+namespace {
+constexpr unsigned int kFrameRate{30};
+// Stand-in access unit size; what a mid-bitrate 720p frame costs.
+constexpr std::size_t kFrameSize{20 * 1024};
+
+constexpr const char *kDurationEnvName{"AETHERCAST_LATENCY_DURATION_SECONDS"};
+constexpr const char *kMaxP99EnvName{"AETHERCAST_LATENCY_MAX_P99_MS"};
+constexpr const char *kMaxMeanEnvName{"AETHERCAST_LATENCY_MAX_MEAN_MS"};
+
+constexpr unsigned int kDefaultDurationSeconds{10};
+constexpr double kDefaultMaxP99LatencyMs{50.0};
+constexpr double kDefaultMaxMeanLatencyMs{20.0};
+
+// Wire constants shared with the packetizer and RTP sender; the
+// receiver parses real on-the-wire bytes so a header change shows up
+// here as a failure instead of silently skewed numbers.
+constexpr std::size_t kRTPHeaderSize{12};
+constexpr std::size_t kTSPacketSize{188};
+constexpr unsigned int kVideoPID{0x1011};
+// The 33 bit PES timestamps wrap; latencies are computed in 90 kHz
+// ticks modulo this.
+constexpr int64_t kPTSModulus{1ll << 33};
+
+double EnvOrDefault(const char *name, double default_value) {
+    const auto value = ac::Utils::GetEnvValue(name);
+    return value.empty() ? default_value : std::atof(value.c_str());
+}
+
+// Capture→receive latency observations exposed through the common
+// statistics interface so the standard tests can run against them.
+class LatencySample : public ac::testing::Sample {
+public:
+    void Record(double latency_ms) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        latencies_ms_.push_back(latency_ms);
+    }
+
+    SizeType get_size() const override {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return latencies_ms_.size();
+    }
+
+    ValueType get_mean() const override {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (latencies_ms_.empty())
+            return 0.0;
+        double sum = 0.0;
+        for (const auto value : latencies_ms_)
+            sum += value;
+        return sum / latencies_ms_.size();
+    }
+
+    ValueType get_variance() const override {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (latencies_ms_.size() < 2)
+            return 0.0;
+        double sum = 0.0;
+        for (const auto value : latencies_ms_)
+            sum += value;
+        const double mean = sum / latencies_ms_.size();
+        double squares = 0.0;
+        for (const auto value : latencies_ms_)
+            squares += (value - mean) * (value - mean);
+        return squares / (latencies_ms_.size() - 1);
+    }
+
+    void enumerate(const Enumerator& enumerator) const override {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto value : latencies_ms_)
+            enumerator(value);
+    }
+
+    ValueType GetPercentile(double percentile) const {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (latencies_ms_.empty())
+            return 0.0;
+        auto sorted = latencies_ms_;
+        std::sort(sorted.begin(), sorted.end());
+        const auto index = std::min(sorted.size() - 1,
+            static_cast<std::size_t>(sorted.size() * percentile));
+        return sorted.at(index);
+    }
+
+    ValueType GetMin() const { return GetPercentile(0.0); }
+    ValueType GetMax() const { return GetPercentile(1.0); }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<double> latencies_ms_;
+};
+
+// Receives the RTP stream on loopback, walks the transport packets
+// inside each datagram and turns every video PES timestamp back into
+// a capture→receive latency. The PTS carries the producer's capture
+// clock (the packetizer derives it from the buffer timestamp), so the
+// difference to the receive time covers the whole in-process path:
+// packetizer queue, mux, RTP queue, pacing and the kernel loopback.
+class DepacketizingReceiver {
+public:
+    explicit DepacketizingReceiver(const std::shared_ptr<LatencySample> &sample) :
+        sample_(sample),
+        running_(true) {
+        fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+        addr.sin_port = 0;
+        ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        struct timeval timeout{0, 100 * 1000};
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        thread_ = std::thread(&DepacketizingReceiver::Worker, this);
+    }
+
+    ~DepacketizingReceiver() {
+        running_.store(false);
+        if (thread_.joinable())
+            thread_.join();
+        ::close(fd_);
+    }
+
+    std::uint16_t Port() const { return port_; }
+
+private:
+    void Worker() {
+        std::vector<std::uint8_t> datagram(64 * 1024);
+        while (running_.load()) {
+            const auto bytes = ::recv(fd_, datagram.data(), datagram.size(), 0);
+            if (bytes <= static_cast<ssize_t>(kRTPHeaderSize))
+                continue;
+
+            const auto received_at = ac::common::Clock::NowUs();
+            for (std::size_t offset = kRTPHeaderSize;
+                    offset + kTSPacketSize <= static_cast<std::size_t>(bytes);
+                    offset += kTSPacketSize)
+                ParseTSPacket(datagram.data() + offset, received_at);
+        }
+    }
+
+    void ParseTSPacket(const std::uint8_t *packet, ac::TimestampUs received_at) {
+        if (packet[0] != 0x47)
+            return;
+
+        const unsigned int pid = ((packet[1] & 0x1f) << 8) | packet[2];
+        const bool payload_unit_start = (packet[1] & 0x40) != 0;
+        if (pid != kVideoPID || !payload_unit_start)
+            return;
+
+        std::size_t payload = 4;
+        // Skip the adaptation field when present
+        if (packet[3] & 0x20)
+            payload += 1 + packet[4];
+        if (payload + 14 > kTSPacketSize)
+            return;
+
+        const auto pes = packet + payload;
+        // PES start code followed by a video stream id
+        if (pes[0] != 0x00 || pes[1] != 0x00 || pes[2] != 0x01 ||
+                (pes[3] & 0xf0) != 0xe0)
+            return;
+        // PTS flag
+        if (!(pes[7] & 0x80))
+            return;
+
+        const int64_t pts =
+            (static_cast<int64_t>((pes[9] >> 1) & 0x7) << 30) |
+            (static_cast<int64_t>(pes[10]) << 22) |
+            (static_cast<int64_t>(pes[11] >> 1) << 15) |
+            (static_cast<int64_t>(pes[12]) << 7) |
+            (static_cast<int64_t>(pes[13]) >> 1);
+
+        const int64_t now_ticks = (received_at * 9ll) / 100ll;
+        const int64_t latency_ticks = (now_ticks - pts) & (kPTSModulus - 1);
+        sample_->Record((latency_ticks * 100ll) / 9ll / 1000.0);
+    }
+
+private:
+    std::shared_ptr<LatencySample> sample_;
+    int fd_;
+    std::uint16_t port_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+// Stands in for the encoder, which needs hardware this harness must
+// not depend on: wraps each captured frame into a fixed-size fake
+// access unit stamped with the producer's capture time, exactly like
+// the renderer stamps real encoder output.
+ac::video::Buffer::Ptr FakeAccessUnit(const ac::TimestampUs &capture_time) {
+    static const std::uint8_t kNalPrefix[] = {0x00, 0x00, 0x00, 0x01, 0x65};
+
+    auto buffer = ac::video::Buffer::Create(kFrameSize, capture_time);
+    std::memset(buffer->Data(), 0xd5, buffer->Length());
+    std::memcpy(buffer->Data(), kNalPrefix, sizeof(kNalPrefix));
+    return buffer;
+}
+
+ac::video::Buffer::Ptr FakeCodecConfig() {
+    static const std::uint8_t kCsd[] = {
+        // SPS
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1f,
+        0xd9, 0x00, 0x78, 0x02, 0x27, 0xe5, 0x84, 0x00,
+        // PPS
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xcb, 0x83, 0xcb,
+        0x20,
+    };
+
+    auto buffer = ac::video::Buffer::Create(sizeof(kCsd), ac::Utils::GetNowUs());
+    std::memcpy(buffer->Data(), kCsd, sizeof(kCsd));
+    return buffer;
+}
+}
+
+TEST(StreamLatency, CaptureToReceiveLatencyStaysWithinThresholds) {
+    const auto duration = std::chrono::seconds{
+        static_cast<long>(EnvOrDefault(kDurationEnvName, kDefaultDurationSeconds))};
+    const auto max_p99_latency_ms = EnvOrDefault(kMaxP99EnvName, kDefaultMaxP99LatencyMs);
+    const auto max_mean_latency_ms = EnvOrDefault(kMaxMeanEnvName, kDefaultMaxMeanLatencyMs);
+
+    const auto sample = std::make_shared<LatencySample>();
+    DepacketizingReceiver receiver(sample);
+
+    // A small mode keeps frame generation far below the frame interval
+    // so the producer never becomes the bottleneck being measured.
+    ac::video::SyntheticBufferProducer::Config producer_config;
+    producer_config.width = 320;
+    producer_config.height = 180;
+    producer_config.refresh_rate = kFrameRate;
+
+    const auto producer = ac::video::SyntheticBufferProducer::Create(producer_config);
+    ASSERT_TRUE(producer->Setup(ac::video::DisplayOutput{}));
+
+    const auto output_stream = std::make_shared<ac::network::UdpStream>();
+    ASSERT_TRUE(output_stream->Connect("127.0.0.1", receiver.Port()));
+
+    const auto rtp_sender = std::make_shared<ac::streaming::RTPSender>(
+        output_stream, std::make_shared<ac::report::null::SenderReport>());
+
+    const auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+        std::make_shared<ac::report::null::PacketizerReport>());
+
+    ac::video::BaseEncoder::Config config;
+    const auto media_sender = std::make_shared<ac::streaming::MediaSender>(
+        packetizer, rtp_sender, config);
+
+    ac::common::ThreadedExecutor sender_executor(rtp_sender);
+    ac::common::ThreadedExecutor media_executor(media_sender);
+
+    ASSERT_TRUE(sender_executor.Start());
+    ASSERT_TRUE(media_executor.Start());
+
+    media_sender->OnBufferWithCodecConfig(FakeCodecConfig());
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto frame_interval = std::chrono::microseconds{1000000 / kFrameRate};
+    std::uint64_t frames_sent = 0;
+
+    while (std::chrono::steady_clock::now() - start < duration) {
+        // Run the real producer so its generation cost is part of the
+        // measured path, then stand in for the encoder.
+        producer->SwapBuffers();
+        auto frame = FakeAccessUnit(producer->LastFrameTimestamp());
+
+        media_sender->OnBufferAvailable(frame);
+        frames_sent++;
+
+        std::this_thread::sleep_for(frame_interval);
+    }
+
+    media_executor.Stop();
+    sender_executor.Stop();
+
+    // Give the receiver a moment to drain what is still in flight.
+    std::this_thread::sleep_for(std::chrono::milliseconds{200});
+
+    const auto mean_ms = sample->get_mean();
+    const auto p50_ms = sample->GetPercentile(0.5);
+    const auto p99_ms = sample->GetPercentile(0.99);
+
+    AC_INFO("Latency over %lld frames (%zd observations): min %.2f ms, mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms, stddev %.2f ms",
+            frames_sent, sample->get_size(), sample->GetMin(), mean_ms,
+            p50_ms, p99_ms, sample->GetMax(), std::sqrt(sample->get_variance()));
+
+    ASSERT_GT(sample->get_size(), 0u);
+
+    EXPECT_LE(mean_ms, max_mean_latency_ms)
+        << "Mean capture-to-receive latency regressed";
+    EXPECT_LE(p99_ms, max_p99_latency_ms)
+        << "p99 capture-to-receive latency regressed";
+}
@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ac/logger.h"
+#include "ac/utils.h"
+
+#include "ac/common/threadedexecutor.h"
+
+#include "ac/network/udpstream.h"
+
+#include "ac/report/null/packetizerreport.h"
+
+#include "ac/streaming/mediasender.h"
+#include "ac/streaming/tsanalyzer.h"
+#include "ac/streaming/mpegtspacketizer.h"
+#include "ac/streaming/rtpsender.h"
+
+#include "ac/video/buffer.h"
+#include "ac/video/senderreport.h"
+
+using namespace ::testing;
+
+namespace {
+// Every global allocation in this binary bumps the counter so the
+// soak can tell whether the steady state pipeline still allocates per
+// frame; absolute numbers are meaningless across allocator versions
+// which is why the gate is expressed per processed frame.
+std::atomic<std::uint64_t> g_allocation_count{0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+constexpr unsigned int kFrameRate{30};
+// Roughly a 15 MBit/s stream, which is what a 1080p mirroring session
+// produces in practice.
+constexpr std::size_t kFrameSize{60 * 1024};
+
+// All thresholds and the duration come from the environment so the
+// perf rig can run the same binary for hours with tight gates while a
+// regular build keeps a short smoke configuration.
+constexpr const char *kDurationEnvName{"AETHERCAST_SOAK_DURATION_SECONDS"};
+constexpr const char *kMinThroughputEnvName{"AETHERCAST_SOAK_MIN_THROUGHPUT_MBPS"};
+constexpr const char *kMaxP99LatencyEnvName{"AETHERCAST_SOAK_MAX_P99_LATENCY_MS"};
+constexpr const char *kMaxRssGrowthEnvName{"AETHERCAST_SOAK_MAX_RSS_GROWTH_KB"};
+constexpr const char *kMaxAllocationsEnvName{"AETHERCAST_SOAK_MAX_ALLOCATIONS_PER_FRAME"};
+constexpr const char *kMaxRssAfterTeardownEnvName{"AETHERCAST_SOAK_MAX_RSS_AFTER_TEARDOWN_KB"};
+
+constexpr unsigned int kDefaultDurationSeconds{30};
+constexpr double kDefaultMinThroughputMbps{5.0};
+constexpr double kDefaultMaxP99LatencyMs{50.0};
+constexpr long kDefaultMaxRssGrowthKb{16 * 1024};
+constexpr double kDefaultMaxAllocationsPerFrame{512.0};
+constexpr long kDefaultMaxRssAfterTeardownKb{8 * 1024};
+
+// The first seconds cover pool warmup, socket buffer autotuning and
+// allocator arena growth and would drown the steady state signal.
+constexpr std::chrono::seconds kWarmupDuration{5};
+
+double EnvOrDefault(const char *name, double default_value) {
+    const auto value = ac::Utils::GetEnvValue(name);
+    return value.empty() ? default_value : std::atof(value.c_str());
+}
+
+long ResidentSetSizeKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") != 0)
+            continue;
+        std::istringstream fields(line.substr(6));
+        long kb = 0;
+        fields >> kb;
+        return kb;
+    }
+    return 0;
+}
+
+// Collects the wire latency of every packet relative to the capture
+// timestamp its payload carries.
+class LatencyCollectingReport : public ac::video::SenderReport {
+public:
+    void SentPacket(const ac::TimestampUs &timestamp, const size_t&, const ac::FrameId&) override {
+        if (timestamp <= 0ll)
+            return;
+
+        const auto diff = ac::Utils::GetNowUs() - timestamp;
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        latencies_us_.push_back(diff);
+    }
+
+    void Reset() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        latencies_us_.clear();
+    }
+
+    double PercentileMs(double percentile) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (latencies_us_.empty())
+            return 0.0;
+
+        std::sort(latencies_us_.begin(), latencies_us_.end());
+        const auto index = std::min(latencies_us_.size() - 1,
+            static_cast<std::size_t>(latencies_us_.size() * percentile));
+        return latencies_us_.at(index) / 1000.0;
+    }
+
+    std::size_t SampleCount() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return latencies_us_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<ac::TimestampUs> latencies_us_;
+};
+
+// Drains everything the pipeline pushes onto the loopback socket and
+// keeps score; throughput is measured on the receiving end so a stall
+// anywhere in the chain shows up. The payload additionally runs
+// through the TS conformance analyzer so continuity counter, PCR
+// cadence and table repetition regressions fail the soak instead of a
+// field deployment.
+class LoopbackReceiver {
+public:
+    LoopbackReceiver() :
+        bytes_received_(0),
+        packets_received_(0),
+        running_(true) {
+        fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+        addr.sin_port = 0;
+        ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        struct timeval timeout{0, 100 * 1000};
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        thread_ = std::thread(&LoopbackReceiver::Worker, this);
+    }
+
+    ~LoopbackReceiver() {
+        running_.store(false);
+        if (thread_.joinable())
+            thread_.join();
+        ::close(fd_);
+    }
+
+    std::uint16_t Port() const { return port_; }
+    std::uint64_t BytesReceived() const { return bytes_received_.load(); }
+    std::uint64_t PacketsReceived() const { return packets_received_.load(); }
+    std::uint64_t TransportGaps() const { return transport_gaps_; }
+
+    ac::streaming::TSAnalyzer::Counters TSStats() {
+        std::lock_guard<std::mutex> guard(analyzer_mutex_);
+        return analyzer_.Stats();
+    }
+
+    void ResetCounters() {
+        bytes_received_.store(0);
+        packets_received_.store(0);
+    }
+
+private:
+    void Worker() {
+        constexpr std::size_t kRTPHeaderSize{12};
+
+        std::vector<std::uint8_t> chunk(64 * 1024);
+        while (running_.load()) {
+            const auto bytes = ::recv(fd_, chunk.data(), chunk.size(), 0);
+            if (bytes <= 0)
+                continue;
+            bytes_received_.fetch_add(bytes);
+            packets_received_.fetch_add(1);
+
+            if (static_cast<std::size_t>(bytes) <= kRTPHeaderSize)
+                continue;
+
+            // A jump in the RTP sequence means the loopback link (not
+            // the mux) lost a datagram; told apart so continuity
+            // gates stay meaningful on a loaded rig.
+            const std::uint16_t sequence = (chunk[2] << 8) | chunk[3];
+            std::lock_guard<std::mutex> guard(analyzer_mutex_);
+            if (have_sequence_ && sequence != static_cast<std::uint16_t>(last_sequence_ + 1)) {
+                transport_gaps_++;
+                analyzer_.SignalLoss();
+            }
+            last_sequence_ = sequence;
+            have_sequence_ = true;
+
+            analyzer_.Process(chunk.data() + kRTPHeaderSize,
+                              bytes - kRTPHeaderSize, ac::Utils::GetNowUs());
+        }
+    }
+
+private:
+    int fd_;
+    std::uint16_t port_;
+    std::atomic<std::uint64_t> bytes_received_;
+    std::atomic<std::uint64_t> packets_received_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::mutex analyzer_mutex_;
+    ac::streaming::TSAnalyzer analyzer_;
+    std::uint16_t last_sequence_ = 0;
+    bool have_sequence_ = false;
+    std::uint64_t transport_gaps_ = 0;
+};
+
+// Stands in for the encoder: produces fixed-size fake H.264 access
+// units at the configured frame rate with fresh capture timestamps.
+ac::video::Buffer::Ptr NextFakeFrame() {
+    static const std::uint8_t kNalPrefix[] = {0x00, 0x00, 0x00, 0x01, 0x65};
+
+    auto buffer = ac::video::Buffer::Create(kFrameSize, ac::Utils::GetNowUs());
+    std::memset(buffer->Data(), 0xd5, buffer->Length());
+    std::memcpy(buffer->Data(), kNalPrefix, sizeof(kNalPrefix));
+    return buffer;
+}
+
+ac::video::Buffer::Ptr FakeCodecConfig() {
+    static const std::uint8_t kCsd[] = {
+        // SPS
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1f,
+        0xd9, 0x00, 0x78, 0x02, 0x27, 0xe5, 0x84, 0x00,
+        // PPS
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xcb, 0x83, 0xcb,
+        0x20,
+    };
+
+    auto buffer = ac::video::Buffer::Create(sizeof(kCsd), ac::Utils::GetNowUs());
+    std::memcpy(buffer->Data(), kCsd, sizeof(kCsd));
+    return buffer;
+}
+}
+
+TEST(StreamSoak, SustainedSessionStaysWithinThresholds) {
+    const auto duration = std::chrono::seconds{
+        static_cast<long>(EnvOrDefault(kDurationEnvName, kDefaultDurationSeconds))};
+    const auto min_throughput_mbps = EnvOrDefault(kMinThroughputEnvName, kDefaultMinThroughputMbps);
+    const auto max_p99_latency_ms = EnvOrDefault(kMaxP99LatencyEnvName, kDefaultMaxP99LatencyMs);
+    const auto max_rss_growth_kb = static_cast<long>(EnvOrDefault(kMaxRssGrowthEnvName, kDefaultMaxRssGrowthKb));
+    const auto max_allocations_per_frame = EnvOrDefault(kMaxAllocationsEnvName, kDefaultMaxAllocationsPerFrame);
+    const auto max_rss_after_teardown_kb = static_cast<long>(
+        EnvOrDefault(kMaxRssAfterTeardownEnvName, kDefaultMaxRssAfterTeardownKb));
+
+    LoopbackReceiver receiver;
+    const auto report = std::make_shared<LatencyCollectingReport>();
+
+    // What the process weighs before any session state exists; after
+    // teardown the resident set has to come back down into this
+    // neighbourhood instead of idling at session peak.
+    const auto pre_session_rss_kb = ResidentSetSizeKb();
+
+    std::uint64_t frames_sent = 0;
+    std::uint64_t measured_frames = 0;
+    std::uint64_t allocations = 0;
+    long rss_growth_kb = 0;
+
+    // Scoped so the session tears down - executors joined, pipeline
+    // objects destroyed - before the footprint check below, the same
+    // order the service runs through when a sink disconnects.
+    {
+        const auto output_stream = std::make_shared<ac::network::UdpStream>();
+        ASSERT_TRUE(output_stream->Connect("127.0.0.1", receiver.Port()));
+
+        const auto rtp_sender = std::make_shared<ac::streaming::RTPSender>(output_stream, report);
+
+        const auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+            std::make_shared<ac::report::null::PacketizerReport>());
+
+        ac::video::BaseEncoder::Config config;
+        const auto media_sender = std::make_shared<ac::streaming::MediaSender>(
+            packetizer, rtp_sender, config);
+
+        ac::common::ThreadedExecutor sender_executor(rtp_sender);
+        ac::common::ThreadedExecutor media_executor(media_sender);
+
+        ASSERT_TRUE(sender_executor.Start());
+        ASSERT_TRUE(media_executor.Start());
+
+        media_sender->OnBufferWithCodecConfig(FakeCodecConfig());
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto frame_interval = std::chrono::microseconds{1000000 / kFrameRate};
+
+        long baseline_rss_kb = 0;
+        std::uint64_t baseline_allocations = 0;
+        bool warmed_up = false;
+
+        while (std::chrono::steady_clock::now() - start < duration) {
+            media_sender->OnBufferAvailable(NextFakeFrame());
+            frames_sent++;
+
+            if (warmed_up)
+                measured_frames++;
+
+            if (!warmed_up && std::chrono::steady_clock::now() - start >= kWarmupDuration) {
+                // Start the scored section of the run with clean counters.
+                baseline_rss_kb = ResidentSetSizeKb();
+                baseline_allocations = g_allocation_count.load();
+                receiver.ResetCounters();
+                report->Reset();
+                warmed_up = true;
+            }
+
+            std::this_thread::sleep_for(frame_interval);
+    }
+
+    allocations = g_allocation_count.load() - baseline_allocations;
+    rss_growth_kb = ResidentSetSizeKb() - baseline_rss_kb;
+
+    media_executor.Stop();
+    sender_executor.Stop();
+    }
+
+    // Give the receiver a moment to drain what is still in flight.
+    std::this_thread::sleep_for(std::chrono::milliseconds{200});
+
+    const auto measured_seconds = std::chrono::duration_cast<std::chrono::seconds>(
+        duration - kWarmupDuration).count();
+    const auto throughput_mbps =
+        (receiver.BytesReceived() * 8.0) / (measured_seconds * 1000.0 * 1000.0);
+    const auto p99_latency_ms = report->PercentileMs(0.99);
+    const auto allocations_per_frame =
+        measured_frames > 0 ? static_cast<double>(allocations) / measured_frames : 0.0;
+
+    AC_INFO("Soak finished: %lld frames, %lld packets, %.2f MBit/s, p99 %.2f ms, RSS growth %ld kB, %.1f allocations/frame",
+            frames_sent, receiver.PacketsReceived(), throughput_mbps,
+            p99_latency_ms, rss_growth_kb, allocations_per_frame);
+
+    ASSERT_GT(report->SampleCount(), 0u);
+
+    EXPECT_GE(throughput_mbps, min_throughput_mbps)
+        << "Receiver-side throughput regressed";
+    EXPECT_LE(p99_latency_ms, max_p99_latency_ms)
+        << "p99 packet latency regressed";
+    EXPECT_LE(rss_growth_kb, max_rss_growth_kb)
+        << "Resident set keeps growing after warmup; likely a leak";
+    EXPECT_LE(allocations_per_frame, max_allocations_per_frame)
+        << "Steady state allocates more per frame than allowed";
+
+    // Everything the sink's demuxer would reject has to fail here
+    // first; the analyzer already discounts datagrams the loopback
+    // link itself dropped.
+    const auto ts = receiver.TSStats();
+
+    AC_INFO("TS conformance: %lld packets, %lld PAT, %lld PMT, %lld PCR, max PCR interval %lld us, %lld transport gaps",
+            ts.packets, ts.pat_count, ts.pmt_count, ts.pcr_count,
+            ts.max_pcr_interval_us, receiver.TransportGaps());
+
+    ASSERT_GT(ts.packets, 0u);
+    EXPECT_GT(ts.pat_count, 0u) << "Stream never carried a PAT";
+    EXPECT_GT(ts.pmt_count, 0u) << "Stream never carried a PMT";
+    EXPECT_GT(ts.pcr_count, 0u) << "Stream never carried a PCR";
+    EXPECT_EQ(0u, ts.sync_errors) << "TS packet framing broke";
+    EXPECT_EQ(0u, ts.continuity_errors) << "Continuity counter sequence broke";
+    EXPECT_EQ(0u, ts.pcr_backward_jumps) << "PCR ran backwards";
+    EXPECT_EQ(0u, ts.pcr_interval_violations) << "PCR cadence exceeded the spec limit";
+    EXPECT_EQ(0u, ts.pat_interval_violations) << "PAT repetition exceeded the spec limit";
+    EXPECT_EQ(0u, ts.pmt_interval_violations) << "PMT repetition exceeded the spec limit";
+
+    // Everything session-scoped is destroyed; after handing the freed
+    // pages back the process has to weigh roughly what it did before
+    // the session, or teardown is leaving dead weight behind.
+    ac::Utils::TrimMemory();
+    const auto rss_after_teardown_kb = ResidentSetSizeKb();
+
+    AC_INFO("RSS before session %ld kB, after teardown %ld kB",
+            pre_session_rss_kb, rss_after_teardown_kb);
+
+    EXPECT_LE(rss_after_teardown_kb - pre_session_rss_kb, max_rss_after_teardown_kb)
+        << "Torn down session left its footprint resident";
+}
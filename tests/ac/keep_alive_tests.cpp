@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "ac/keep_alive.h"
+
+#include "tests/common/allocationtracker.h"
+
+namespace {
+struct Target {
+    int value = 42;
+};
+
+constexpr unsigned int kWarmupTrampolines{32};
+constexpr unsigned int kMeasuredTrampolines{1000};
+}
+
+TEST(KeepAlive, ShouldDieHandsTheInstanceBack) {
+    const auto target = std::make_shared<Target>();
+
+    auto trampoline = new ac::SharedKeepAlive<Target>{target};
+    const auto inst = trampoline->ShouldDie();
+
+    ASSERT_EQ(inst, target);
+    EXPECT_EQ(inst->value, 42);
+}
+
+TEST(KeepAlive, WeakTrampolineSeesTargetDeath) {
+    auto target = std::make_shared<Target>();
+
+    auto trampoline = new ac::WeakKeepAlive<Target>{target};
+    ASSERT_TRUE(!!trampoline->GetInstance().lock());
+
+    target.reset();
+    EXPECT_FALSE(!!trampoline->GetInstance().lock());
+
+    delete trampoline;
+}
+
+TEST(KeepAlive, SteadyStateTrampolinesDoNotAllocate) {
+    const auto target = std::make_shared<Target>();
+
+    // The first rounds may grow the pool by a block; afterwards every
+    // trampoline must come out of recycled slots.
+    for (unsigned int n = 0; n < kWarmupTrampolines; n++)
+        (new ac::SharedKeepAlive<Target>{target})->ShouldDie();
+
+    ac::testing::AllocationTracker::Reset();
+    ac::testing::AllocationTracker::Enable();
+
+    for (unsigned int n = 0; n < kMeasuredTrampolines; n++)
+        (new ac::SharedKeepAlive<Target>{target})->ShouldDie();
+
+    ac::testing::AllocationTracker::Disable();
+
+    EXPECT_EQ(ac::testing::AllocationTracker::Count(), 0u)
+        << "One-shot trampolines allocated in steady state";
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2015 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <unistd.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ac/logger.h"
+
+namespace {
+struct CollectingLogger : public ac::Logger {
+    void Init(const ac::Logger::Severity&) override {
+    }
+
+    void Log(Severity severity, const std::string &message, const boost::optional<Location>&) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        records.push_back(std::make_pair(severity, message));
+    }
+
+    std::mutex mutex;
+    std::vector<std::pair<Severity, std::string>> records;
+};
+}
+
+TEST(LogRateLimiter, AllowsABurstThenBlocks) {
+    ac::LogRateLimiter limiter;
+
+    unsigned int allowed = 0;
+    std::uint64_t suppressed = 0;
+    for (int n = 0; n < 100; n++) {
+        if (limiter.Allow(&suppressed))
+            allowed++;
+    }
+
+    // The exact burst size is an implementation detail; what matters
+    // is that a storm does not get through wholesale
+    EXPECT_GE(allowed, 1u);
+    EXPECT_LE(allowed, 10u);
+}
+
+TEST(LogRateLimiter, ReportsSuppressedCountAfterRefill) {
+    ac::LogRateLimiter limiter;
+
+    unsigned int allowed = 0;
+    std::uint64_t suppressed = 0;
+    for (int n = 0; n < 100; n++) {
+        if (limiter.Allow(&suppressed))
+            allowed++;
+    }
+
+    // One refill interval later a message gets through again and
+    // carries the number of drops accumulated in the meantime
+    ::usleep(1100 * 1000);
+
+    ASSERT_TRUE(limiter.Allow(&suppressed));
+    EXPECT_EQ(100u - allowed, suppressed);
+
+    // The counter flushes with the summary; an immediately following
+    // allowed message must not report the same drops again
+    std::uint64_t again = 0;
+    if (limiter.Allow(&again))
+        EXPECT_EQ(0u, again);
+}
+
+TEST(LogRateLimiter, MacroCollapsesStormIntoSummary) {
+    const auto target = std::make_shared<CollectingLogger>();
+    ac::SetLogger(target);
+
+    // The limiter lives with the call site, so storm and follow-up
+    // have to run through the very same statement
+    std::size_t after_storm = 0;
+    for (int n = 0; n <= 50; n++) {
+        if (n == 50) {
+            after_storm = target->records.size();
+            ::usleep(1100 * 1000);
+        }
+        AC_ERROR_RATE_LIMITED("send failed (%d)", n);
+    }
+
+    EXPECT_GE(after_storm, 1u);
+    EXPECT_LE(after_storm, 10u);
+
+    // The refilled call site first accounts for the dropped lines,
+    // then logs the actual message
+    ASSERT_EQ(after_storm + 2, target->records.size());
+    EXPECT_NE(std::string::npos,
+              target->records[after_storm].second.find("similar messages suppressed"));
+    EXPECT_EQ("send failed (50)", target->records[after_storm + 1].second);
+}
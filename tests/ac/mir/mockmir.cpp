@@ -60,6 +60,15 @@ MirDisplayConfiguration* mir_connection_create_display_config(MirConnection *con
     return global_mock->mir_connection_create_display_config(connection);
 }
 
+void mir_display_config_destroy(MirDisplayConfiguration *display_configuration) {
+    global_mock->mir_display_config_destroy(display_configuration);
+}
+
+void mir_connection_set_display_config_change_callback(
+    MirConnection *connection, mir_display_config_callback callback, void *context) {
+    global_mock->mir_connection_set_display_config_change_callback(connection, callback, context);
+}
+
 void mir_connection_get_available_surface_formats(
     MirConnection* connection, MirPixelFormat* formats,
     unsigned const int format_size, unsigned int *num_valid_formats) {
@@ -118,6 +127,10 @@ MirBufferStream* mir_screencast_get_buffer_stream(MirScreencast *screencast) {
     return global_mock->mir_screencast_get_buffer_stream(screencast);
 }
 
+void mir_buffer_stream_get_graphics_region(MirBufferStream *buffer_stream, MirGraphicsRegion *region) {
+    global_mock->mir_buffer_stream_get_graphics_region(buffer_stream, region);
+}
+
 void mir_buffer_stream_get_current_buffer(MirBufferStream *buffer_stream,
     MirNativeBuffer **buffer_package) {
     global_mock->mir_buffer_stream_get_current_buffer(buffer_stream, buffer_package);
@@ -42,6 +42,9 @@ public:
     MOCK_METHOD1(mir_connection_release, void(MirConnection*));
     MOCK_METHOD1(mir_connection_get_error_message, char const*(MirConnection*));
     MOCK_METHOD1(mir_connection_create_display_config, MirDisplayConfiguration*(MirConnection*));
+    MOCK_METHOD1(mir_display_config_destroy, void(MirDisplayConfiguration*));
+    MOCK_METHOD3(mir_connection_set_display_config_change_callback,
+                 void(MirConnection*, mir_display_config_callback, void*));
     MOCK_METHOD4(mir_connection_get_available_surface_formats, void(MirConnection*, MirPixelFormat*,
                                                                     unsigned const int, unsigned int*));
 
@@ -61,6 +64,7 @@ public:
 
     MOCK_METHOD2(mir_buffer_stream_get_current_buffer, void(MirBufferStream*, MirNativeBuffer**));
     MOCK_METHOD1(mir_buffer_stream_swap_buffers_sync, void(MirBufferStream*));
+    MOCK_METHOD2(mir_buffer_stream_get_graphics_region, void(MirBufferStream*, MirGraphicsRegion*));
 };
 
 } // namespace mir
@@ -21,6 +21,7 @@
 
 #include "mockmir.h"
 
+#include "ac/mir/connectioncache.h"
 #include "ac/mir/screencast.h"
 
 using namespace ::testing;
@@ -28,19 +29,116 @@ using namespace ::testing;
 namespace {
 struct TestMirScreencastSpec {
 };
+
+// The connection cache is process wide; dropping it between the cases
+// keeps each one starting from a fresh, unconnected state.
+struct CacheCleaner {
+    ~CacheCleaner() { ac::mir::ConnectionCache::Instance().Reset(); }
+};
 }
 
-TEST(Screencast, DoesNotSupportMirrorMode) {
+TEST(Screencast, MirrorModeCapturesAtNativeResolution) {
+    auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
+
     ac::video::DisplayOutput output;
-    ::memset(&output, 0, sizeof(output));
     output.mode = ac::video::DisplayOutput::Mode::kMirror;
+    output.width = 640;
+    output.height = 480;
+
+    auto connection = reinterpret_cast<MirConnection*>(1);
+
+    EXPECT_CALL(*mir, mir_connect_sync(_, _))
+            .Times(1)
+            .WillRepeatedly(Return(connection));
+
+    EXPECT_CALL(*mir, mir_connection_release(connection))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_connection_is_valid(connection))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
+    MirDisplayConfiguration display_config;
+    display_config.num_outputs = 1;
+    display_config.outputs = new MirDisplayOutput[1];
+
+    display_config.outputs[0].connected = true;
+    display_config.outputs[0].used = true;
+    display_config.outputs[0].current_mode = 0;
+    display_config.outputs[0].num_modes = 1;
+    display_config.outputs[0].modes = new MirDisplayMode[1];
+    display_config.outputs[0].modes[0].horizontal_resolution = 1280;
+    display_config.outputs[0].modes[0].vertical_resolution = 720;
+    display_config.outputs[0].modes[0].refresh_rate = 30;
+
+    EXPECT_CALL(*mir, mir_connection_create_display_config(connection))
+            .Times(1)
+            .WillRepeatedly(Return(&display_config));
+
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
+            .Times(1)
+            .WillOnce(SetArgPointee<3>(1));
+
+    TestMirScreencastSpec spec;
+    auto mir_spec = reinterpret_cast<MirScreencastSpec*>(&spec);
+
+    EXPECT_CALL(*mir, mir_create_screencast_spec(connection))
+            .Times(1)
+            .WillRepeatedly(Return(mir_spec));
+
+    // The buffers stay at the negotiated stream size while the capture
+    // region covers the panel's full native mode; the compositor does
+    // the downscale.
+    EXPECT_CALL(*mir, mir_screencast_spec_set_width(mir_spec, output.width))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_height(mir_spec, output.height))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_capture_region(mir_spec, _))
+            .Times(1)
+            .WillRepeatedly(Invoke([&](MirScreencastSpec *spec, MirRectangle const *rect) {
+                boost::ignore_unused_variable_warning(spec);
+                EXPECT_EQ(0, rect->left);
+                EXPECT_EQ(0, rect->top);
+                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->width);
+                EXPECT_EQ(display_config.outputs[0].modes[0].vertical_resolution, rect->height);
+            }));
+    EXPECT_CALL(*mir, mir_screencast_spec_set_pixel_format(mir_spec, _))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_none))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_number_of_buffers(mir_spec, 2))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_screencast_create_sync(mir_spec))
+            .Times(1)
+            .WillRepeatedly(Return(nullptr));
+
+    EXPECT_CALL(*mir, mir_screencast_spec_release(mir_spec))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_screencast_is_valid(nullptr))
+            .Times(1)
+            .WillRepeatedly(Return(false));
+
+    EXPECT_CALL(*mir, mir_screencast_get_error_message(nullptr))
+            .Times(1)
+            .WillOnce(Return("Error message from mock"));
 
     const auto screencast = std::make_shared<ac::mir::Screencast>();
-    EXPECT_FALSE(screencast->Setup(output));
+    EXPECT_TRUE(screencast->Setup(output));
+    screencast->SwapBuffers();
 }
 
 TEST(Screencast, ConnectToMirFailsCorrectly) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     EXPECT_CALL(*mir, mir_connect_sync(_, _))
             .Times(1)
@@ -63,6 +161,7 @@ TEST(Screencast, ConnectToMirFailsCorrectly) {
 
 TEST(Screencast, DoesNotCrashOnInvalidDisplayConfig) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     auto connection = reinterpret_cast<MirConnection*>(1);
 
@@ -77,6 +176,9 @@ TEST(Screencast, DoesNotCrashOnInvalidDisplayConfig) {
             .Times(1)
             .WillOnce(Return(true));
 
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
     EXPECT_CALL(*mir, mir_connection_create_display_config(connection))
             .Times(1)
             .WillOnce(Return(nullptr));
@@ -94,6 +196,7 @@ TEST(Screencast, DoesNotCrashOnInvalidDisplayConfig) {
 
 TEST(Screencast, NoDisplayConfigurationAvailable) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     auto connection = reinterpret_cast<MirConnection*>(1);
 
@@ -108,6 +211,9 @@ TEST(Screencast, NoDisplayConfigurationAvailable) {
             .Times(1)
             .WillRepeatedly(Return(true));
 
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
     MirDisplayConfiguration display_config;
     ::memset(&display_config, 0, sizeof(display_config));
 
@@ -115,6 +221,9 @@ TEST(Screencast, NoDisplayConfigurationAvailable) {
             .Times(1)
             .WillRepeatedly(Return(&display_config));
 
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
+            .Times(1);
+
     ac::video::DisplayOutput output;
     output.mode = ac::video::DisplayOutput::Mode::kExtend;
     const auto screencast = std::make_shared<ac::mir::Screencast>();
@@ -123,6 +232,7 @@ TEST(Screencast, NoDisplayConfigurationAvailable) {
 
 TEST(Screencast, NoUsableDisplayConfigurationAvailable) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     auto connection = reinterpret_cast<MirConnection*>(1);
 
@@ -137,6 +247,9 @@ TEST(Screencast, NoUsableDisplayConfigurationAvailable) {
             .Times(1)
             .WillRepeatedly(Return(true));
 
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
     MirDisplayConfiguration display_config;
     display_config.num_outputs = 2;
     display_config.outputs = new MirDisplayOutput[2];
@@ -155,6 +268,9 @@ TEST(Screencast, NoUsableDisplayConfigurationAvailable) {
             .Times(1)
             .WillRepeatedly(Return(&display_config));
 
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
+            .Times(1);
+
     ac::video::DisplayOutput output;
     output.mode = ac::video::DisplayOutput::Mode::kExtend;
     const auto screencast = std::make_shared<ac::mir::Screencast>();
@@ -164,6 +280,7 @@ TEST(Screencast, NoUsableDisplayConfigurationAvailable) {
 
 TEST(Screencast, NoPixelFormatAvailable) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     ac::video::DisplayOutput output;
     output.mode = ac::video::DisplayOutput::Mode::kExtend;
@@ -183,6 +300,9 @@ TEST(Screencast, NoPixelFormatAvailable) {
             .Times(1)
             .WillRepeatedly(Return(true));
 
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
     MirDisplayConfiguration display_config;
     display_config.num_outputs = 1;
     display_config.outputs = new MirDisplayOutput[1];
@@ -200,28 +320,11 @@ TEST(Screencast, NoPixelFormatAvailable) {
             .Times(1)
             .WillRepeatedly(Return(&display_config));
 
-    TestMirScreencastSpec spec;
-    auto mir_spec = reinterpret_cast<MirScreencastSpec*>(&spec);
-
-    EXPECT_CALL(*mir, mir_create_screencast_spec(connection))
-            .Times(1)
-            .WillRepeatedly(Return(mir_spec));
-
-    EXPECT_CALL(*mir, mir_screencast_spec_set_width(mir_spec, output.width))
-            .Times(1);
-    EXPECT_CALL(*mir, mir_screencast_spec_set_height(mir_spec, output.height))
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
             .Times(1);
 
-    EXPECT_CALL(*mir, mir_screencast_spec_set_capture_region(mir_spec, _))
-            .Times(1)
-            .WillRepeatedly(Invoke([&](MirScreencastSpec *spec, MirRectangle const *rect) {
-                boost::ignore_unused_variable_warning(spec);
-                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->left);
-                EXPECT_EQ(0, rect->top);
-                EXPECT_EQ(display_config.outputs[0].modes[0].vertical_resolution, rect->width);
-                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->height);
-            }));
-
+    // Leaving the number of valid formats untouched reports zero
+    // available pixel formats
     EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
             .Times(1);
 
@@ -235,6 +338,7 @@ TEST(Screencast, NoPixelFormatAvailable) {
 
 TEST(Screencast, ScreencastCreationFails) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     ac::video::DisplayOutput output;
     output.mode = ac::video::DisplayOutput::Mode::kExtend;
@@ -254,6 +358,9 @@ TEST(Screencast, ScreencastCreationFails) {
             .Times(1)
             .WillRepeatedly(Return(true));
 
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
     MirDisplayConfiguration display_config;
     display_config.num_outputs = 1;
     display_config.outputs = new MirDisplayOutput[1];
@@ -271,6 +378,13 @@ TEST(Screencast, ScreencastCreationFails) {
             .Times(1)
             .WillRepeatedly(Return(&display_config));
 
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
+            .Times(1)
+            .WillOnce(SetArgPointee<3>(1));
+
     TestMirScreencastSpec spec;
     auto mir_spec = reinterpret_cast<MirScreencastSpec*>(&spec);
 
@@ -283,24 +397,22 @@ TEST(Screencast, ScreencastCreationFails) {
     EXPECT_CALL(*mir, mir_screencast_spec_set_height(mir_spec, output.height))
             .Times(1);
 
+    // The virtual output sits right of the panel at the negotiated
+    // stream size
     EXPECT_CALL(*mir, mir_screencast_spec_set_capture_region(mir_spec, _))
             .Times(1)
             .WillRepeatedly(Invoke([&](MirScreencastSpec *spec, MirRectangle const *rect) {
                 boost::ignore_unused_variable_warning(spec);
                 EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->left);
                 EXPECT_EQ(0, rect->top);
-                EXPECT_EQ(display_config.outputs[0].modes[0].vertical_resolution, rect->width);
-                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->height);
+                EXPECT_EQ(output.width, rect->width);
+                EXPECT_EQ(output.height, rect->height);
             }));
 
-    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
-            .Times(1)
-            .WillOnce(SetArgPointee<3>(mir_pixel_format_abgr_8888));
-
     EXPECT_CALL(*mir, mir_screencast_spec_set_pixel_format(mir_spec, _))
             .Times(1);
 
-    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_vertical))
+    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_none))
             .Times(1);
 
     EXPECT_CALL(*mir, mir_screencast_spec_set_number_of_buffers(mir_spec, 2))
@@ -322,11 +434,17 @@ TEST(Screencast, ScreencastCreationFails) {
             .WillOnce(Return("Error message from mock"));
 
     const auto screencast = std::make_shared<ac::mir::Screencast>();
-    EXPECT_FALSE(screencast->Setup(output));
+
+    // Creation happens in the background so setup itself succeeds and
+    // the failure surfaces when the first capture joins the result
+    EXPECT_TRUE(screencast->Setup(output));
+    screencast->SwapBuffers();
+    EXPECT_FALSE(screencast->CurrentBuffer()->IsValid());
 }
 
 TEST(Screencast, ScreencastDoesNotProvideBufferStream) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     ac::video::DisplayOutput output;
     output.mode = ac::video::DisplayOutput::Mode::kExtend;
@@ -346,6 +464,9 @@ TEST(Screencast, ScreencastDoesNotProvideBufferStream) {
             .Times(1)
             .WillRepeatedly(Return(true));
 
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
     MirDisplayConfiguration display_config;
     display_config.num_outputs = 1;
     display_config.outputs = new MirDisplayOutput[1];
@@ -363,6 +484,13 @@ TEST(Screencast, ScreencastDoesNotProvideBufferStream) {
             .Times(1)
             .WillRepeatedly(Return(&display_config));
 
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
+            .Times(1)
+            .WillOnce(SetArgPointee<3>(1));
+
     TestMirScreencastSpec spec;
     auto mir_spec = reinterpret_cast<MirScreencastSpec*>(&spec);
 
@@ -374,27 +502,12 @@ TEST(Screencast, ScreencastDoesNotProvideBufferStream) {
             .Times(1);
     EXPECT_CALL(*mir, mir_screencast_spec_set_height(mir_spec, output.height))
             .Times(1);
-
     EXPECT_CALL(*mir, mir_screencast_spec_set_capture_region(mir_spec, _))
-            .Times(1)
-            .WillRepeatedly(Invoke([&](MirScreencastSpec *spec, MirRectangle const *rect) {
-                boost::ignore_unused_variable_warning(spec);
-                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->left);
-                EXPECT_EQ(0, rect->top);
-                EXPECT_EQ(display_config.outputs[0].modes[0].vertical_resolution, rect->width);
-                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->height);
-            }));
-
-    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
-            .Times(1)
-            .WillOnce(SetArgPointee<3>(mir_pixel_format_abgr_8888));
-
+            .Times(1);
     EXPECT_CALL(*mir, mir_screencast_spec_set_pixel_format(mir_spec, _))
             .Times(1);
-
-    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_vertical))
+    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_none))
             .Times(1);
-
     EXPECT_CALL(*mir, mir_screencast_spec_set_number_of_buffers(mir_spec, 2))
             .Times(1);
 
@@ -422,17 +535,18 @@ TEST(Screencast, ScreencastDoesNotProvideBufferStream) {
             .Times(1);
 
     const auto screencast = std::make_shared<ac::mir::Screencast>();
-    EXPECT_FALSE(screencast->Setup(output));
+    EXPECT_TRUE(screencast->Setup(output));
 
     // Also make sure that swap buffers isn't called when we don't have
     // a buffer stream and the screencast doesn't return a valid buffer
     screencast->SwapBuffers();
-    EXPECT_EQ(nullptr, screencast->CurrentBuffer());
+    EXPECT_FALSE(screencast->CurrentBuffer()->IsValid());
 }
 
 
 TEST(Screencast, DoesSwapBuffersAndReturnsCurrentBuffer) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
 
     ac::video::DisplayOutput output;
     output.mode = ac::video::DisplayOutput::Mode::kExtend;
@@ -453,6 +567,9 @@ TEST(Screencast, DoesSwapBuffersAndReturnsCurrentBuffer) {
             .Times(1)
             .WillRepeatedly(Return(true));
 
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1);
+
     MirDisplayConfiguration display_config;
     display_config.num_outputs = 1;
     display_config.outputs = new MirDisplayOutput[1];
@@ -470,6 +587,13 @@ TEST(Screencast, DoesSwapBuffersAndReturnsCurrentBuffer) {
             .Times(1)
             .WillRepeatedly(Return(&display_config));
 
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
+            .Times(1)
+            .WillOnce(SetArgPointee<3>(1));
+
     TestMirScreencastSpec spec;
     auto mir_spec = reinterpret_cast<MirScreencastSpec*>(&spec);
 
@@ -481,27 +605,12 @@ TEST(Screencast, DoesSwapBuffersAndReturnsCurrentBuffer) {
             .Times(1);
     EXPECT_CALL(*mir, mir_screencast_spec_set_height(mir_spec, output.height))
             .Times(1);
-
     EXPECT_CALL(*mir, mir_screencast_spec_set_capture_region(mir_spec, _))
-            .Times(1)
-            .WillRepeatedly(Invoke([&](MirScreencastSpec *spec, MirRectangle const *rect) {
-                boost::ignore_unused_variable_warning(spec);
-                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->left);
-                EXPECT_EQ(0, rect->top);
-                EXPECT_EQ(display_config.outputs[0].modes[0].vertical_resolution, rect->width);
-                EXPECT_EQ(display_config.outputs[0].modes[0].horizontal_resolution, rect->height);
-            }));
-
-    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
-            .Times(1)
-            .WillOnce(SetArgPointee<3>(mir_pixel_format_abgr_8888));
-
+            .Times(1);
     EXPECT_CALL(*mir, mir_screencast_spec_set_pixel_format(mir_spec, _))
             .Times(1);
-
-    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_vertical))
+    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_none))
             .Times(1);
-
     EXPECT_CALL(*mir, mir_screencast_spec_set_number_of_buffers(mir_spec, 2))
             .Times(1);
 
@@ -524,6 +633,19 @@ TEST(Screencast, DoesSwapBuffersAndReturnsCurrentBuffer) {
             .Times(1)
             .WillOnce(Return(buffer_stream));
 
+    // Back the stream with a tiny mapped region so the buffer stream
+    // fetcher can hash and read it
+    static uint8_t pixels[2 * 2 * 4] = {0};
+    EXPECT_CALL(*mir, mir_buffer_stream_get_graphics_region(buffer_stream, _))
+            .Times(AtLeast(1))
+            .WillRepeatedly(Invoke([](MirBufferStream*, MirGraphicsRegion *region) {
+                region->width = 2;
+                region->height = 2;
+                region->stride = 8;
+                region->pixel_format = mir_pixel_format_abgr_8888;
+                region->vaddr = reinterpret_cast<char*>(pixels);
+            }));
+
     EXPECT_CALL(*mir, mir_buffer_stream_swap_buffers_sync(buffer_stream))
             .Times(1);
 
@@ -546,5 +668,140 @@ TEST(Screencast, DoesSwapBuffersAndReturnsCurrentBuffer) {
     EXPECT_EQ(output.mode, returned_output.mode);
 
     screencast->SwapBuffers();
-    EXPECT_EQ(expected_buffer, screencast->CurrentBuffer());
+    EXPECT_EQ(expected_buffer, screencast->CurrentBuffer()->NativeHandle());
+}
+
+TEST(Screencast, OrientationChangeBecomesLiveTransform) {
+    auto mir = std::make_shared<ac::test::mir::MockMir>();
+    CacheCleaner cleaner;
+
+    ac::video::DisplayOutput output;
+    output.mode = ac::video::DisplayOutput::Mode::kExtend;
+    output.width = 640;
+    output.height = 480;
+    output.refresh_rate = 30;
+
+    auto connection = reinterpret_cast<MirConnection*>(1);
+
+    EXPECT_CALL(*mir, mir_connect_sync(_, _))
+            .Times(1)
+            .WillRepeatedly(Return(connection));
+
+    EXPECT_CALL(*mir, mir_connection_release(connection))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_connection_is_valid(connection))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    // Capture the change callback so the test can play the server
+    mir_display_config_callback config_callback = nullptr;
+    void *config_callback_context = nullptr;
+
+    EXPECT_CALL(*mir, mir_connection_set_display_config_change_callback(connection, _, _))
+            .Times(1)
+            .WillOnce(Invoke([&](MirConnection*, mir_display_config_callback callback, void *context) {
+                config_callback = callback;
+                config_callback_context = context;
+            }));
+
+    MirDisplayConfiguration display_config;
+    display_config.num_outputs = 1;
+    display_config.outputs = new MirDisplayOutput[1];
+
+    display_config.outputs[0].connected = true;
+    display_config.outputs[0].used = true;
+    display_config.outputs[0].output_id = 42;
+    display_config.outputs[0].orientation = mir_orientation_normal;
+    display_config.outputs[0].current_mode = 0;
+    display_config.outputs[0].num_modes = 1;
+    display_config.outputs[0].modes = new MirDisplayMode[1];
+    display_config.outputs[0].modes[0].horizontal_resolution = 1280;
+    display_config.outputs[0].modes[0].vertical_resolution = 720;
+    display_config.outputs[0].modes[0].refresh_rate = 30;
+
+    // Once for the setup and once when the change gets picked up
+    EXPECT_CALL(*mir, mir_connection_create_display_config(connection))
+            .Times(2)
+            .WillRepeatedly(Return(&display_config));
+
+    EXPECT_CALL(*mir, mir_display_config_destroy(&display_config))
+            .Times(2);
+
+    EXPECT_CALL(*mir, mir_connection_get_available_surface_formats(connection, _, _, _))
+            .Times(1)
+            .WillOnce(SetArgPointee<3>(1));
+
+    TestMirScreencastSpec spec;
+    auto mir_spec = reinterpret_cast<MirScreencastSpec*>(&spec);
+
+    EXPECT_CALL(*mir, mir_create_screencast_spec(connection))
+            .Times(1)
+            .WillRepeatedly(Return(mir_spec));
+
+    EXPECT_CALL(*mir, mir_screencast_spec_set_width(mir_spec, output.width))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_height(mir_spec, output.height))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_capture_region(mir_spec, _))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_pixel_format(mir_spec, _))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_mirror_mode(mir_spec, mir_mirror_mode_none))
+            .Times(1);
+    EXPECT_CALL(*mir, mir_screencast_spec_set_number_of_buffers(mir_spec, 2))
+            .Times(1);
+
+    auto mir_screencast = reinterpret_cast<MirScreencast*>(2);
+
+    EXPECT_CALL(*mir, mir_screencast_create_sync(mir_spec))
+            .Times(1)
+            .WillRepeatedly(Return(mir_screencast));
+
+    EXPECT_CALL(*mir, mir_screencast_spec_release(mir_spec))
+            .Times(1);
+
+    EXPECT_CALL(*mir, mir_screencast_is_valid(mir_screencast))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    auto buffer_stream = reinterpret_cast<MirBufferStream*>(3);
+
+    EXPECT_CALL(*mir, mir_screencast_get_buffer_stream(mir_screencast))
+            .Times(1)
+            .WillOnce(Return(buffer_stream));
+
+    static uint8_t pixels[2 * 2 * 4] = {0};
+    EXPECT_CALL(*mir, mir_buffer_stream_get_graphics_region(buffer_stream, _))
+            .Times(AtLeast(1))
+            .WillRepeatedly(Invoke([](MirBufferStream*, MirGraphicsRegion *region) {
+                region->width = 2;
+                region->height = 2;
+                region->stride = 8;
+                region->pixel_format = mir_pixel_format_abgr_8888;
+                region->vaddr = reinterpret_cast<char*>(pixels);
+            }));
+
+    // Crucially the screencast is created and released exactly once;
+    // the rotation never costs a renegotiation.
+    EXPECT_CALL(*mir, mir_buffer_stream_swap_buffers_sync(buffer_stream))
+            .Times(2);
+
+    EXPECT_CALL(*mir, mir_screencast_release_sync(mir_screencast))
+            .Times(1);
+
+    const auto screencast = std::make_shared<ac::mir::Screencast>();
+    EXPECT_TRUE(screencast->Setup(output));
+
+    screencast->SwapBuffers();
+
+    // The server rotates the captured output and signals the change
+    ASSERT_NE(nullptr, config_callback);
+    display_config.outputs[0].orientation = mir_orientation_left;
+    config_callback(connection, config_callback_context);
+
+    // The next frame picks the new orientation up in place; the CPU
+    // fetcher cannot transform and keeps capturing as-is, which still
+    // must not tear anything down.
+    screencast->SwapBuffers();
 }
@@ -36,6 +36,8 @@ class MockBufferProducer : public ac::video::BufferProducer {
 public:
     MOCK_METHOD1(Setup, bool(const ac::video::DisplayOutput&));
     MOCK_METHOD0(SwapBuffers, void());
+    MOCK_CONST_METHOD0(LastFrameDamaged, bool());
+    MOCK_CONST_METHOD0(LastFrameTimestamp, ac::TimestampUs());
     MOCK_CONST_METHOD0(CurrentBuffer, void*());
     MOCK_CONST_METHOD0(OutputMode, ac::video::DisplayOutput());
 };
@@ -44,6 +46,7 @@ class MockEncoder : public ac::video::BaseEncoder {
 public:
     MOCK_METHOD0(DefaultConfiguration, ac::video::BaseEncoder::Config());
     MOCK_METHOD1(Configure, bool(const ac::video::BaseEncoder::Config&));
+    MOCK_METHOD1(Reconfigure, bool(const ac::video::BaseEncoder::Config&));
     MOCK_METHOD1(QueueBuffer, void(const ac::video::Buffer::Ptr&));
     MOCK_CONST_METHOD0(Configuration, ac::video::BaseEncoder::Config());
     MOCK_CONST_METHOD0(Running, bool());
@@ -60,6 +63,8 @@ public:
     MOCK_METHOD0(CreateRendererReport, ac::video::RendererReport::Ptr());
     MOCK_METHOD0(CreatePacketizerReport, ac::video::PacketizerReport::Ptr());
     MOCK_METHOD0(CreateSenderReport, ac::video::SenderReport::Ptr());
+    MOCK_METHOD0(CreateBufferQueueReport, ac::video::BufferQueueReport::Ptr());
+    MOCK_METHOD0(CreateConnectionReport, ac::report::ConnectionReport::Ptr());
 };
 
 class MockExecutorFactory : public ac::common::ExecutorFactory {
@@ -211,6 +216,63 @@ TEST_F(SourceMediaManagerFixture, ConfiugresAndSetsUpEverything) {
     EXPECT_TRUE(Configure(manager));
 }
 
+TEST_F(SourceMediaManagerFixture, RenegotiationReconfiguresInPlace) {
+    // The executors and the RTP sender are only created once; a second
+    // format negotiation reuses them and reconfigures the stages.
+    EXPECT_CALL(*mock_executor_factory, Create(_))
+            .Times(4)
+            .WillRepeatedly(Return(mock_executor));
+
+    EXPECT_CALL(*mock_output_stream, Connect(remote_address, _))
+            .Times(2)
+            .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*mock_output_stream, MaxUnitSize())
+            .WillOnce(Return(1000));
+
+    EXPECT_CALL(*mock_buffer_producer, Setup(_))
+            .Times(2)
+            .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*mock_buffer_producer, OutputMode())
+            .WillRepeatedly(Return(ac::video::DisplayOutput{}));
+
+    EXPECT_CALL(*mock_encoder, DefaultConfiguration())
+            .Times(2)
+            .WillRepeatedly(Return(ac::video::BaseEncoder::Config{}));
+
+    EXPECT_CALL(*mock_encoder, Configure(_))
+            .WillOnce(Return(true));
+
+    EXPECT_CALL(*mock_encoder, Reconfigure(_))
+            .WillOnce(Return(true));
+
+    EXPECT_CALL(*mock_encoder, Configuration())
+            .WillRepeatedly(Return(ac::video::BaseEncoder::Config{}));
+
+    EXPECT_CALL(*mock_report_factory, CreateRendererReport())
+            .WillOnce(Return(nullptr));
+
+    EXPECT_CALL(*mock_report_factory, CreateSenderReport())
+            .WillOnce(Return(nullptr));
+
+    // Each format change hands the media sender a fresh packetizer
+    EXPECT_CALL(*mock_report_factory, CreatePacketizerReport())
+            .Times(2)
+            .WillRepeatedly(Return(nullptr));
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory);
+
+    EXPECT_TRUE(Configure(manager));
+    EXPECT_TRUE(Configure(manager));
+}
+
 TEST_F(SourceMediaManagerFixture, StateSwitching) {
     ExpectCorrectConfiguration();
 
@@ -28,6 +28,8 @@ class MockBufferProducer : public ac::video::BufferProducer {
 public:
     MOCK_METHOD1(Setup, bool(const ac::video::DisplayOutput&));
     MOCK_METHOD0(SwapBuffers, void());
+    MOCK_CONST_METHOD0(LastFrameDamaged, bool());
+    MOCK_CONST_METHOD0(LastFrameTimestamp, ac::TimestampUs());
     MOCK_CONST_METHOD0(CurrentBuffer, void*());
     MOCK_CONST_METHOD0(OutputMode, ac::video::DisplayOutput());
 };
@@ -49,7 +51,9 @@ public:
 class MockRendererReport : public ac::video::RendererReport {
 public:
     MOCK_METHOD0(BeganFrame, void());
-    MOCK_METHOD1(FinishedFrame, void(const ac::TimestampUs&));
+    MOCK_METHOD2(FinishedFrame, void(const ac::TimestampUs&, const ac::FrameId&));
+    MOCK_METHOD1(MissedFrameDeadline, void(const ac::TimestampUs&));
+    MOCK_METHOD1(DroppedFrame, void(const ac::TimestampUs&));
 };
 
 class StreamRendererFixture : public ::testing::Test {
@@ -73,6 +77,15 @@ public:
 
         EXPECT_CALL(*mock_encoder, Configuration())
                 .WillRepeatedly(Return(encoder_config));
+
+        // Unless a test says otherwise every frame carries damage
+        EXPECT_CALL(*mock_buffer_producer, LastFrameDamaged())
+                .WillRepeatedly(Return(true));
+
+        // ... and has no precise capture time, so the renderer stamps
+        // it with the current clock
+        EXPECT_CALL(*mock_buffer_producer, LastFrameTimestamp())
+                .WillRepeatedly(Return(0ll));
     }
 
     std::shared_ptr<MockBufferProducer> mock_buffer_producer;
@@ -92,6 +105,37 @@ TEST_F(StreamRendererFixture, ValidExecutableName) {
     EXPECT_NE(0, renderer->Name().length());
 }
 
+TEST_F(StreamRendererFixture, BufferSlotsFollowSessionProfile) {
+    ExpectValidConfiguration();
+
+    const auto low_latency = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report,
+                ac::mir::SessionProfile::kLowLatency);
+    const auto balanced = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report,
+                ac::mir::SessionProfile::kBalanced);
+    const auto throughput = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report,
+                ac::mir::SessionProfile::kThroughput);
+
+    EXPECT_EQ(2u, low_latency->BufferSlots());
+    EXPECT_EQ(4u, balanced->BufferSlots());
+    EXPECT_EQ(8u, throughput->BufferSlots());
+
+    // Leaving the profile out keeps the previous low-latency depth
+    const auto default_profile = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report);
+    EXPECT_EQ(low_latency->BufferSlots(), default_profile->BufferSlots());
+}
+
 TEST_F(StreamRendererFixture, StartAndStopSucceed) {
     ExpectValidConfiguration();
 
@@ -117,7 +161,7 @@ TEST_F(StreamRendererFixture, TakesBufferFromProducerAndForwardsToEncoder) {
     EXPECT_CALL(*mock_renderer_report, BeganFrame())
             .Times(1);
 
-    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_))
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_, _))
             .Times(1);
 
     auto buffer_native_handle = reinterpret_cast<void*>(1);
@@ -142,6 +186,126 @@ TEST_F(StreamRendererFixture, TakesBufferFromProducerAndForwardsToEncoder) {
     EXPECT_EQ(buffer_native_handle, output_buffer->NativeHandle());
 }
 
+TEST_F(StreamRendererFixture, StampsBuffersWithProducerCaptureTime) {
+    ExpectValidConfiguration();
+
+    const auto renderer = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report);
+
+    EXPECT_TRUE(renderer->Start());
+
+    EXPECT_CALL(*mock_renderer_report, BeganFrame())
+            .Times(1);
+
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_, _))
+            .Times(1);
+
+    EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
+            .Times(1);
+
+    EXPECT_CALL(*mock_buffer_producer, CurrentBuffer())
+            .WillOnce(Return(reinterpret_cast<void*>(1)));
+
+    // A producer which knows the compositor's frame time wins over the
+    // renderer's own clock read
+    EXPECT_CALL(*mock_buffer_producer, LastFrameTimestamp())
+            .WillRepeatedly(Return(1234ll));
+
+    ac::video::Buffer::Ptr output_buffer;
+
+    EXPECT_CALL(*mock_encoder, QueueBuffer(_))
+            .WillOnce(SaveArg<0>(&output_buffer));
+
+    EXPECT_TRUE(renderer->Execute());
+
+    EXPECT_TRUE(renderer->Stop());
+
+    EXPECT_NE(nullptr, output_buffer.get());
+    EXPECT_EQ(1234ll, output_buffer->Timestamp());
+}
+
+TEST_F(StreamRendererFixture, SkipsFramesWithoutAnyDamage) {
+    ExpectValidConfiguration();
+
+    const auto renderer = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report);
+
+    EXPECT_TRUE(renderer->Start());
+
+    EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
+            .Times(3);
+
+    EXPECT_CALL(*mock_buffer_producer, LastFrameDamaged())
+            .WillOnce(Return(true))
+            .WillOnce(Return(false))
+            .WillOnce(Return(true));
+
+    auto buffer_native_handle = reinterpret_cast<uint8_t*>(1);
+
+    // Only the two damaged frames make it to the encoder
+    EXPECT_CALL(*mock_buffer_producer, CurrentBuffer())
+            .Times(2)
+            .WillRepeatedly(Return(reinterpret_cast<void*>(buffer_native_handle++)));
+
+    EXPECT_CALL(*mock_encoder, QueueBuffer(_))
+            .Times(2);
+
+    EXPECT_CALL(*mock_renderer_report, BeganFrame())
+            .Times(3);
+
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_, _))
+            .Times(3);
+
+    for (int n = 0; n < 3; n++)
+        EXPECT_TRUE(renderer->Execute());
+
+    EXPECT_TRUE(renderer->Stop());
+}
+
+TEST_F(StreamRendererFixture, DropsOldestFrameOnSustainedBacklog) {
+    ExpectValidConfiguration();
+
+    const auto renderer = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report);
+
+    EXPECT_TRUE(renderer->Start());
+
+    // Fill every slot without ever finishing a buffer; the encoder is
+    // effectively stalled from here on
+    EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
+            .Times(renderer->BufferSlots());
+    EXPECT_CALL(*mock_buffer_producer, CurrentBuffer())
+            .WillRepeatedly(Return(reinterpret_cast<void*>(1)));
+    EXPECT_CALL(*mock_encoder, QueueBuffer(_))
+            .Times(renderer->BufferSlots());
+    EXPECT_CALL(*mock_renderer_report, BeganFrame())
+            .Times(renderer->BufferSlots());
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_, _))
+            .Times(renderer->BufferSlots());
+
+    for (unsigned int n = 0; n < renderer->BufferSlots(); n++)
+        EXPECT_TRUE(renderer->Execute());
+
+    // Once the backlog outlives a whole queue's worth of frame
+    // intervals the oldest in-flight frame has to go
+    std::atomic<bool> dropped{false};
+    EXPECT_CALL(*mock_renderer_report, DroppedFrame(_))
+            .WillOnce(Invoke([&](const ac::TimestampUs&) { dropped = true; }));
+
+    for (int n = 0; n < 500 && !dropped; n++)
+        EXPECT_TRUE(renderer->Execute());
+
+    EXPECT_TRUE(dropped);
+
+    EXPECT_TRUE(renderer->Stop());
+}
+
 TEST_F(StreamRendererFixture, CorrectBufferManagement) {
     ExpectValidConfiguration();
 
@@ -165,7 +329,7 @@ TEST_F(StreamRendererFixture, CorrectBufferManagement) {
     EXPECT_CALL(*mock_renderer_report, BeganFrame())
             .Times(AtLeast(1));
 
-    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_))
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_, _))
             .Times(AtLeast(1));
 
     EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
@@ -217,7 +381,7 @@ TEST_F(StreamRendererFixture, KeepsExecutingWhenNoFreeSlots) {
     EXPECT_CALL(*mock_renderer_report, BeganFrame())
             .Times(2);
 
-    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_))
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_, _))
             .Times(2);
 
     EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
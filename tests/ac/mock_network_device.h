@@ -28,7 +28,7 @@ struct MockNetworkDevice : public ac::NetworkDevice {
     MOCK_CONST_METHOD0(IPv4Address, ac::IpV4Address());
     MOCK_CONST_METHOD0(Name, std::string());
     MOCK_CONST_METHOD0(State, ac::NetworkDeviceState());
-    MOCK_CONST_METHOD0(SupportedRoles, std::vector<ac::NetworkDeviceRole>());
+    MOCK_CONST_METHOD0(SupportedRoles, ac::NetworkDevice::RoleList());
 };
 }
 
@@ -19,7 +19,9 @@
 
 #include <sys/socket.h>
 #include <fcntl.h>
+#include <net/if.h>
 
+#include "ac/networkinterfacecache.h"
 #include "ac/networkutils.h"
 
 TEST(NetworkUtils_PickRandomPort, PicksPortsInRange) {
@@ -29,3 +31,18 @@ TEST(NetworkUtils_PickRandomPort, PicksPortsInRange) {
         EXPECT_GE(ac::NetworkUtils::kMaxUserPort, port);
     }
 }
+
+TEST(NetworkInterfaceCache, ResolvesLoopbackBothWays) {
+    const auto index = static_cast<int>(::if_nametoindex("lo"));
+    ASSERT_GT(index, 0);
+
+    EXPECT_EQ(ac::NetworkInterfaceCache::Instance().LookupIndex("lo"), index);
+    EXPECT_EQ(ac::NetworkInterfaceCache::Instance().LookupName(index), "lo");
+}
+
+TEST(NetworkUtils_RetrieveInterfaceIndex, RoundTripsTheLoopbackInterface) {
+    const auto index = ac::NetworkUtils::RetrieveInterfaceIndex("lo");
+    ASSERT_GT(index, 0);
+
+    EXPECT_EQ(ac::NetworkUtils::RetrieveInterfaceName(index), "lo");
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <ac/report/recorder/eventrecorder.h>
+
+TEST(EventRecorder, ChannelIdsAreStablePerName) {
+    auto &recorder = ac::report::recorder::EventRecorder::Instance();
+
+    const auto first = recorder.ChannelForName("test-queue-a");
+    const auto second = recorder.ChannelForName("test-queue-b");
+
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first, recorder.ChannelForName("test-queue-a"));
+    EXPECT_EQ(second, recorder.ChannelForName("test-queue-b"));
+}
+
+TEST(EventRecorder, RecordingSurvivesRingWraparound) {
+    auto &recorder = ac::report::recorder::EventRecorder::Instance();
+
+    // Far more events than the ring can hold; the recorder has to keep
+    // overwriting its oldest entries without any ill effect.
+    for (int n = 0; n < 100000; n++)
+        recorder.Record(ac::report::recorder::EventRecorder::Event::kEncoderFinishedFrame,
+                        0, 0, n);
+}
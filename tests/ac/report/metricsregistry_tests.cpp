@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <ac/report/metrics/metricsregistry.h>
+
+TEST(MetricsRegistry, CountersAccumulateAndShowUpInSnapshot) {
+    auto &registry = ac::report::metrics::MetricsRegistry::Instance();
+
+    registry.Increment("test_counter");
+    registry.Increment("test_counter", 9);
+
+    const auto snapshot = registry.Snapshot();
+    auto iter = snapshot.find("test_counter");
+    ASSERT_NE(snapshot.end(), iter);
+    EXPECT_EQ(10, iter->second);
+}
+
+TEST(MetricsRegistry, UpdateMaxKeepsTheLargestValue) {
+    auto &registry = ac::report::metrics::MetricsRegistry::Instance();
+
+    registry.UpdateMax("test_max", 5);
+    registry.UpdateMax("test_max", 42);
+    registry.UpdateMax("test_max", 7);
+
+    const auto snapshot = registry.Snapshot();
+    auto iter = snapshot.find("test_max");
+    ASSERT_NE(snapshot.end(), iter);
+    EXPECT_EQ(42, iter->second);
+}
+
+TEST(MetricsRegistry, GaugeKeepsOnlyTheLastValue) {
+    auto &registry = ac::report::metrics::MetricsRegistry::Instance();
+
+    registry.SetGauge("test_gauge", 42);
+    registry.SetGauge("test_gauge", 7);
+
+    const auto snapshot = registry.Snapshot();
+    auto iter = snapshot.find("test_gauge");
+    ASSERT_NE(snapshot.end(), iter);
+    EXPECT_EQ(7, iter->second);
+}
+
+TEST(MetricsRegistry, LatencyHistogramReportsCountAndPercentiles) {
+    auto &registry = ac::report::metrics::MetricsRegistry::Instance();
+
+    for (int n = 0; n < 100; n++)
+        registry.RecordLatency("test_latency", 1000);
+    registry.RecordLatency("test_latency", 1000000);
+
+    const auto snapshot = registry.Snapshot();
+    auto count = snapshot.find("test_latency_count");
+    ASSERT_NE(snapshot.end(), count);
+    EXPECT_EQ(101, count->second);
+
+    // The p50 has to land in the bucket covering 1000us while the
+    // single outlier must not drag it anywhere near a millisecond.
+    auto p50 = snapshot.find("test_latency_p50_us");
+    ASSERT_NE(snapshot.end(), p50);
+    EXPECT_LE(1000, p50->second);
+    EXPECT_GT(10000, p50->second);
+
+    auto p99 = snapshot.find("test_latency_p99_us");
+    ASSERT_NE(snapshot.end(), p99);
+}
+
+TEST(MetricsRegistry, SnapshotTextContainsOneLinePerMetric) {
+    auto &registry = ac::report::metrics::MetricsRegistry::Instance();
+
+    registry.Increment("test_text_counter", 3);
+
+    const auto text = registry.SnapshotText();
+    EXPECT_NE(std::string::npos, text.find("test_text_counter 3\n"));
+}
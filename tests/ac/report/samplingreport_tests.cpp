@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "ac/report/sampling/senderreport.h"
+#include "ac/report/sampling/samplingpolicy.h"
+
+namespace {
+struct CountingSenderReport : public ac::video::SenderReport {
+    void SentPacket(const ac::TimestampUs&, const size_t&, const ac::FrameId&) override {
+        count++;
+    }
+
+    unsigned int count = 0;
+};
+}
+
+TEST(SamplingReport, ForwardsOneInNCalls) {
+    const auto inner = std::make_shared<CountingSenderReport>();
+    ac::report::sampling::SenderReport report(inner);
+
+    ac::report::sampling::SamplingPolicy::SetInterval(4);
+
+    for (int n = 0; n < 8; n++)
+        report.SentPacket(1, 2, 3);
+
+    EXPECT_EQ(2, inner->count);
+
+    ac::report::sampling::SamplingPolicy::SetInterval(1);
+}
+
+TEST(SamplingReport, IntervalOfOneForwardsEverything) {
+    const auto inner = std::make_shared<CountingSenderReport>();
+    ac::report::sampling::SenderReport report(inner);
+
+    ac::report::sampling::SamplingPolicy::SetInterval(1);
+
+    for (int n = 0; n < 8; n++)
+        report.SentPacket(1, 2, 3);
+
+    EXPECT_EQ(8, inner->count);
+}
+
+TEST(SamplingReport, IntervalCanBeRaisedAtRuntime) {
+    const auto inner = std::make_shared<CountingSenderReport>();
+    ac::report::sampling::SenderReport report(inner);
+
+    ac::report::sampling::SamplingPolicy::SetInterval(1);
+    report.SentPacket(1, 2, 3);
+
+    ac::report::sampling::SamplingPolicy::SetInterval(2);
+    report.SentPacket(1, 2, 3);
+    report.SentPacket(1, 2, 3);
+
+    EXPECT_EQ(2, inner->count);
+
+    ac::report::sampling::SamplingPolicy::SetInterval(1);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "ac/report/startuptrace.h"
+#include "ac/report/metrics/metricsregistry.h"
+
+using ac::report::StartupTrace;
+
+TEST(StartupTrace, MilestoneLandsInTheMetricsRegistry) {
+    StartupTrace::Instance().Mark(ac::report::kStartupMilestoneMainEntry);
+
+    const auto snapshot = ac::report::metrics::MetricsRegistry::Instance().Snapshot();
+    ASSERT_NE(snapshot.end(), snapshot.find("startup_main_entry_us"));
+}
+
+TEST(StartupTrace, RepeatedMarksKeepTheFirstTimestamp) {
+    StartupTrace::Instance().Mark(ac::report::kStartupMilestoneStubChainReady);
+
+    auto snapshot = ac::report::metrics::MetricsRegistry::Instance().Snapshot();
+    const auto first = snapshot.at("startup_stub_chain_ready_us");
+
+    // A readiness flap marks again; the recorded time must not move.
+    StartupTrace::Instance().Mark(ac::report::kStartupMilestoneStubChainReady);
+
+    snapshot = ac::report::metrics::MetricsRegistry::Instance().Snapshot();
+    EXPECT_EQ(first, snapshot.at("startup_stub_chain_ready_us"));
+}
+
+TEST(StartupTrace, DumpWithPartialTraceDoesNotCrash) {
+    // Dump runs from the SIGUSR1 handler at any time, including before
+    // later milestones exist.
+    StartupTrace::Instance().Dump();
+}
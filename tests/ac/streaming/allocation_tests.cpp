@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "ac/report/null/packetizerreport.h"
+#include "ac/report/null/senderreport.h"
+#include "ac/streaming/mpegtspacketizer.h"
+#include "ac/streaming/rtpsender.h"
+#include "ac/video/buffer.h"
+
+#include "tests/common/allocationtracker.h"
+
+namespace {
+constexpr unsigned int kWarmupFrames{30};
+constexpr unsigned int kMeasuredFrames{100};
+constexpr std::size_t kFrameSize{16 * 1024};
+constexpr std::size_t kMPEGTSPacketSize{188};
+
+// Agreed steady-state budgets per frame. They are deliberately a bit
+// above the currently measured numbers so ordinary noise doesn't trip
+// the gate, but tight enough that an accidental per-frame copy or a
+// pool that stopped recycling shows up immediately. If a change moves
+// the needle on purpose, adjust the budget in the same commit and say
+// why in its message.
+constexpr double kPacketizerAllocationBudgetPerFrame{8.0};
+constexpr double kSenderAllocationBudgetPerFrame{120.0};
+
+class NullStream : public ac::network::Stream {
+public:
+    bool Connect(const std::string&, const ac::network::Port&) override {
+        return true;
+    }
+
+    Error Write(const uint8_t*, unsigned int, const ac::TimestampUs&) override {
+        return Error::kNone;
+    }
+
+    Error WriteBatch(const std::vector<Datagram>&) override {
+        return Error::kNone;
+    }
+
+    ac::network::Port LocalPort() const override { return 1234; }
+
+    std::uint32_t MaxUnitSize() const override { return 1472; }
+};
+
+ac::video::Buffer::Ptr CreateFakeFrame(std::size_t size, const ac::TimestampUs &timestamp) {
+    auto buffer = ac::video::Buffer::Create(size, timestamp);
+    std::memset(buffer->Data(), 0x42, buffer->Length());
+    buffer->Data()[0] = 0x00;
+    buffer->Data()[1] = 0x00;
+    buffer->Data()[2] = 0x00;
+    buffer->Data()[3] = 0x01;
+    buffer->Data()[4] = 0x65;
+    return buffer;
+}
+}
+
+TEST(AllocationBudget, PacketizerSteadyStateStaysWithinBudget) {
+    const auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+        std::make_shared<ac::report::null::PacketizerReport>());
+    const auto track = packetizer->AddTrack(
+        ac::streaming::Packetizer::TrackFormat{"video/avc"});
+
+    // The input frame is reused so only the packetizer's own behavior
+    // is measured; its output buffers go back to the pool when the
+    // local reference dies at the end of each round.
+    const auto frame = CreateFakeFrame(kFrameSize, 1000);
+
+    for (unsigned int n = 0; n < kWarmupFrames; n++) {
+        ac::video::Buffer::Ptr packets;
+        ASSERT_TRUE(packetizer->Packetize(track, frame, &packets, 0));
+    }
+
+    ac::testing::AllocationTracker::Reset();
+    ac::testing::AllocationTracker::Enable();
+
+    for (unsigned int n = 0; n < kMeasuredFrames; n++) {
+        ac::video::Buffer::Ptr packets;
+        ASSERT_TRUE(packetizer->Packetize(track, frame, &packets, 0));
+    }
+
+    ac::testing::AllocationTracker::Disable();
+
+    const auto per_frame =
+        static_cast<double>(ac::testing::AllocationTracker::Count()) / kMeasuredFrames;
+
+    EXPECT_LE(per_frame, kPacketizerAllocationBudgetPerFrame)
+        << "Packetizer steady state allocation churn grew beyond the agreed budget";
+}
+
+TEST(AllocationBudget, RTPSenderSteadyStateStaysWithinBudget) {
+    const auto sender = std::make_shared<ac::streaming::RTPSender>(
+        std::make_shared<NullStream>(),
+        std::make_shared<ac::report::null::SenderReport>());
+
+    // A frame's worth of TS packets as they come out of the packetizer
+    const auto packets = CreateFakeFrame(
+        (kFrameSize / kMPEGTSPacketSize) * kMPEGTSPacketSize, 1000);
+
+    for (unsigned int n = 0; n < kWarmupFrames; n++) {
+        ASSERT_TRUE(sender->Queue(packets));
+        ASSERT_TRUE(sender->Execute());
+    }
+
+    ac::testing::AllocationTracker::Reset();
+    ac::testing::AllocationTracker::Enable();
+
+    for (unsigned int n = 0; n < kMeasuredFrames; n++) {
+        ASSERT_TRUE(sender->Queue(packets));
+        ASSERT_TRUE(sender->Execute());
+    }
+
+    ac::testing::AllocationTracker::Disable();
+
+    const auto per_frame =
+        static_cast<double>(ac::testing::AllocationTracker::Count()) / kMeasuredFrames;
+
+    EXPECT_LE(per_frame, kSenderAllocationBudgetPerFrame)
+        << "RTPSender steady state allocation churn grew beyond the agreed budget";
+}
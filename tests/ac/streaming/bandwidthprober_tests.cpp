@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <future>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ac/networkutils.h"
+#include "ac/network/udpstream.h"
+#include "ac/streaming/bandwidthprober.h"
+
+namespace {
+static constexpr unsigned int kProbeBitrate{2000000};
+
+// Plays the sink's RTP side: swallows the probe burst on a local
+// port and lets the test count what arrived.
+int BindSinkSocket(const ac::network::Port &port) {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return fd;
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    // The burst ends without any in-band marker; a quiet socket for
+    // this long means the prober has moved on to waiting for feedback
+    struct timeval timeout{0, 200 * 1000};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    return fd;
+}
+
+// Receiver report with a single block claiming cumulative_lost
+// packets missing; sent to the port the prober listens on by the
+// symmetric RTCP convention (our RTP port + 1).
+void SendReceiverReport(const ac::network::Port &port, uint32_t cumulative_lost) {
+    std::vector<uint8_t> packet{0x81, 201, 0x00, 0x07};
+    packet.resize(4 + 4 + 24, 0x00);
+    packet[13] = (cumulative_lost >> 16) & 0xff;
+    packet[14] = (cumulative_lost >> 8) & 0xff;
+    packet[15] = cumulative_lost & 0xff;
+
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(fd, 0);
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+    addr.sin_port = htons(port);
+
+    ASSERT_EQ(static_cast<ssize_t>(packet.size()),
+              ::sendto(fd, packet.data(), packet.size(), 0,
+                       reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)));
+    ::close(fd);
+}
+}
+
+TEST(BandwidthProber, TimesOutWithoutFeedback) {
+    const auto port = ac::NetworkUtils::PickRandomPort();
+    const auto sink = BindSinkSocket(port);
+    ASSERT_GE(sink, 0);
+
+    auto stream = std::make_shared<ac::network::UdpStream>();
+    ASSERT_TRUE(stream->Connect("127.0.0.1", port));
+
+    ac::streaming::BandwidthProber prober(stream);
+    const auto result = prober.Probe(kProbeBitrate);
+
+    EXPECT_FALSE(result.valid);
+
+    ::close(sink);
+}
+
+TEST(BandwidthProber, EstimateScalesWithReportedLoss) {
+    const auto port = ac::NetworkUtils::PickRandomPort();
+    const auto sink = BindSinkSocket(port);
+    ASSERT_GE(sink, 0);
+
+    auto stream = std::make_shared<ac::network::UdpStream>();
+    ASSERT_TRUE(stream->Connect("127.0.0.1", port));
+
+    ac::streaming::BandwidthProber prober(stream);
+    auto probe = std::async(std::launch::async, [&]() {
+        return prober.Probe(kProbeBitrate);
+    });
+
+    // Drain the burst until the socket goes quiet; everything must be
+    // padding-only RTP so nothing of it could reach a TS demuxer
+    unsigned int received = 0;
+    uint8_t data[512];
+    ssize_t bytes = 0;
+    while ((bytes = ::recv(sink, data, sizeof(data), 0)) > 0) {
+        ASSERT_GE(bytes, 12);
+        EXPECT_EQ(0xa0, data[0]); // version 2, padding bit
+        EXPECT_EQ(33, data[1]); // MP2T payload type
+        received++;
+    }
+    ASSERT_GT(received, 0u);
+
+    // Claim half of it lost; the estimate has to scale down with it
+    SendReceiverReport(stream->LocalPort() + 1, received / 2);
+
+    const auto result = probe.get();
+    ASSERT_TRUE(result.valid);
+
+    const auto expected = static_cast<unsigned int>(
+                static_cast<uint64_t>(kProbeBitrate) * (received - received / 2) / received);
+    // Loopback may still drop a stray packet of the burst which
+    // shifts the prober's own sent count slightly
+    EXPECT_NEAR(expected, result.bitrate, kProbeBitrate / 20);
+    EXPECT_LT(result.bitrate, kProbeBitrate);
+
+    ::close(sink);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include "ac/streaming/bitratecontroller.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kMaxBitrate = 5000000;
+
+class MockEncoder : public ac::video::BaseEncoder {
+public:
+    MOCK_METHOD0(DefaultConfiguration, ac::video::BaseEncoder::Config());
+    MOCK_METHOD1(Configure, bool(const ac::video::BaseEncoder::Config&));
+    MOCK_METHOD1(QueueBuffer, void(const ac::video::Buffer::Ptr&));
+    MOCK_CONST_METHOD0(Configuration, ac::video::BaseEncoder::Config());
+    MOCK_CONST_METHOD0(Running, bool());
+    MOCK_METHOD0(SendIDRFrame, void());
+    MOCK_METHOD1(SetTargetBitrate, bool(unsigned int));
+
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD0(Execute, bool());
+
+    std::string Name() const override { return "MockEncoder"; }
+};
+}
+
+TEST(BitrateController, LinkCeilingDropClampsRightAway) {
+    auto encoder = std::make_shared<MockEncoder>();
+
+    EXPECT_CALL(*encoder, SetTargetBitrate(2000000))
+            .Times(1)
+            .WillOnce(Return(true));
+
+    ac::streaming::BitrateController controller(encoder, kMaxBitrate);
+    controller.SetStartingBitrate(4000000);
+
+    // No receiver report needed; the local radio already knows
+    controller.SetLinkCeiling(2000000);
+
+    EXPECT_EQ(2000000u, controller.CurrentBitrate());
+}
+
+TEST(BitrateController, LinkCeilingAboveCurrentChangesNothing) {
+    auto encoder = std::make_shared<MockEncoder>();
+
+    EXPECT_CALL(*encoder, SetTargetBitrate(_))
+            .Times(0);
+
+    ac::streaming::BitrateController controller(encoder, kMaxBitrate);
+    controller.SetStartingBitrate(2000000);
+
+    controller.SetLinkCeiling(4000000);
+    // Zero removes the cap and must not touch the encoder either
+    controller.SetLinkCeiling(0);
+
+    EXPECT_EQ(2000000u, controller.CurrentBitrate());
+}
+
+TEST(BitrateController, CleanReportsNeverRampPastTheLinkCeiling) {
+    auto encoder = std::make_shared<MockEncoder>();
+
+    // 1.05 * 2 MBit/s would be 2.1; the link ceiling cuts it short
+    EXPECT_CALL(*encoder, SetTargetBitrate(2050000))
+            .Times(1)
+            .WillOnce(Return(true));
+
+    ac::streaming::BitrateController controller(encoder, kMaxBitrate);
+    controller.SetStartingBitrate(2000000);
+    controller.SetLinkCeiling(2050000);
+
+    // Four consecutive clean reports trigger one upward probe
+    for (int n = 0; n < 4; n++)
+        controller.ProcessFeedback(0, 0);
+
+    EXPECT_EQ(2050000u, controller.CurrentBitrate());
+}
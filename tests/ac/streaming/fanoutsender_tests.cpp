@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include "ac/streaming/fanoutsender.h"
+
+using namespace ::testing;
+
+namespace {
+class MockTransportSender : public ac::streaming::TransportSender {
+public:
+    MOCK_METHOD1(Queue, bool(const ac::video::Buffer::Ptr&));
+    MOCK_CONST_METHOD0(LocalPort, int32_t());
+
+    // Fires the network error a real sender would report from its
+    // send path
+    void TriggerNetworkError() {
+        if (auto sp = delegate_.lock())
+            sp->OnTransportNetworkError();
+    }
+};
+
+class SessionDelegate : public ac::streaming::TransportSender::Delegate {
+public:
+    void OnTransportNetworkError() override { error_count++; }
+
+    unsigned int error_count = 0;
+};
+}
+
+TEST(FanoutSender, QueueFailsWithoutSinks) {
+    auto fanout = ac::streaming::FanoutSender::Create();
+
+    EXPECT_FALSE(fanout->Queue(ac::video::Buffer::Create(nullptr)));
+    EXPECT_EQ(0, fanout->LocalPort());
+    EXPECT_EQ(0u, fanout->SenderCount());
+}
+
+TEST(FanoutSender, QueueForwardsSameBufferToEverySink) {
+    auto first_sink = std::make_shared<MockTransportSender>();
+    auto second_sink = std::make_shared<MockTransportSender>();
+
+    auto packets = ac::video::Buffer::Create(10);
+
+    EXPECT_CALL(*first_sink, Queue(packets))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*second_sink, Queue(packets))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    auto fanout = ac::streaming::FanoutSender::Create();
+    EXPECT_TRUE(fanout->AddSender(first_sink));
+    EXPECT_TRUE(fanout->AddSender(second_sink));
+    // Adding the same sink twice isn't possible
+    EXPECT_FALSE(fanout->AddSender(first_sink));
+    EXPECT_EQ(2u, fanout->SenderCount());
+
+    EXPECT_TRUE(fanout->Queue(packets));
+}
+
+TEST(FanoutSender, LocalPortComesFromPrimarySink) {
+    auto first_sink = std::make_shared<MockTransportSender>();
+    auto second_sink = std::make_shared<MockTransportSender>();
+
+    EXPECT_CALL(*first_sink, LocalPort())
+            .WillRepeatedly(Return(4000));
+    EXPECT_CALL(*second_sink, LocalPort())
+            .Times(0);
+
+    auto fanout = ac::streaming::FanoutSender::Create();
+    EXPECT_TRUE(fanout->AddSender(first_sink));
+    EXPECT_TRUE(fanout->AddSender(second_sink));
+
+    EXPECT_EQ(4000, fanout->LocalPort());
+}
+
+TEST(FanoutSender, FailedSinkIsDroppedWithoutEndingTheSession) {
+    auto delegate = std::make_shared<SessionDelegate>();
+
+    auto first_sink = std::make_shared<MockTransportSender>();
+    auto second_sink = std::make_shared<MockTransportSender>();
+
+    auto packets = ac::video::Buffer::Create(10);
+
+    EXPECT_CALL(*first_sink, Queue(_))
+            .Times(0);
+    EXPECT_CALL(*second_sink, Queue(packets))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    auto fanout = ac::streaming::FanoutSender::Create();
+    fanout->SetDelegate(delegate);
+    EXPECT_TRUE(fanout->AddSender(first_sink));
+    EXPECT_TRUE(fanout->AddSender(second_sink));
+
+    first_sink->TriggerNetworkError();
+
+    EXPECT_EQ(1u, fanout->SenderCount());
+    EXPECT_EQ(0u, delegate->error_count);
+
+    // The remaining sink keeps streaming
+    EXPECT_TRUE(fanout->Queue(packets));
+}
+
+TEST(FanoutSender, ErrorEscalatesOnceTheLastSinkFails) {
+    auto delegate = std::make_shared<SessionDelegate>();
+
+    auto first_sink = std::make_shared<MockTransportSender>();
+    auto second_sink = std::make_shared<MockTransportSender>();
+
+    auto fanout = ac::streaming::FanoutSender::Create();
+    fanout->SetDelegate(delegate);
+    EXPECT_TRUE(fanout->AddSender(first_sink));
+    EXPECT_TRUE(fanout->AddSender(second_sink));
+
+    first_sink->TriggerNetworkError();
+    EXPECT_EQ(0u, delegate->error_count);
+
+    second_sink->TriggerNetworkError();
+    EXPECT_EQ(1u, delegate->error_count);
+    EXPECT_EQ(0u, fanout->SenderCount());
+}
+
+TEST(FanoutSender, RemovedSinkStopsReceivingPackets) {
+    auto first_sink = std::make_shared<MockTransportSender>();
+    auto second_sink = std::make_shared<MockTransportSender>();
+
+    auto packets = ac::video::Buffer::Create(10);
+
+    EXPECT_CALL(*first_sink, Queue(_))
+            .Times(0);
+    EXPECT_CALL(*second_sink, Queue(packets))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    auto fanout = ac::streaming::FanoutSender::Create();
+    EXPECT_TRUE(fanout->AddSender(first_sink));
+    EXPECT_TRUE(fanout->AddSender(second_sink));
+
+    EXPECT_TRUE(fanout->RemoveSender(first_sink));
+    // A sink which is already gone can't be removed again
+    EXPECT_FALSE(fanout->RemoveSender(first_sink));
+
+    EXPECT_TRUE(fanout->Queue(packets));
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "ac/streaming/fecsender.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kParityHeaderSize{20};
+
+class MockTransportSender : public ac::streaming::TransportSender {
+public:
+    MOCK_METHOD1(Queue, bool(const ac::video::Buffer::Ptr&));
+    MOCK_CONST_METHOD0(LocalPort, int32_t());
+};
+
+// Captures every datagram so tests can look at the parity bytes
+class RecordingStream : public ac::network::Stream {
+public:
+    bool Connect(const std::string&, const ac::network::Port&) override { return true; }
+
+    Error Write(const uint8_t *data, unsigned int size,
+                const ac::TimestampUs&) override {
+        packets.push_back(std::vector<uint8_t>(data, data + size));
+        return Error::kNone;
+    }
+
+    ac::network::Port LocalPort() const override { return 0; }
+    std::uint32_t MaxUnitSize() const override { return 1472; }
+
+    std::vector<std::vector<uint8_t>> packets;
+};
+
+ac::video::Buffer::Ptr MakeBuffer(const std::vector<uint8_t> &data) {
+    auto buffer = ac::video::Buffer::Create(data.size());
+    ::memcpy(buffer->Data(), data.data(), data.size());
+    return buffer;
+}
+}
+
+TEST(FECSender, ForwardsEveryBufferToMediaSender) {
+    auto media = std::make_shared<MockTransportSender>();
+    auto stream = std::make_shared<RecordingStream>();
+
+    EXPECT_CALL(*media, Queue(_))
+            .Times(3)
+            .WillRepeatedly(Return(true));
+
+    auto sender = ac::streaming::FECSender::Create(media, stream, 3);
+
+    for (int n = 0; n < 3; n++)
+        EXPECT_TRUE(sender->Queue(MakeBuffer({0x01, 0x02, 0x03})));
+}
+
+TEST(FECSender, EmitsOneParityPacketPerGroup) {
+    auto media = std::make_shared<MockTransportSender>();
+    auto stream = std::make_shared<RecordingStream>();
+
+    EXPECT_CALL(*media, Queue(_))
+            .WillRepeatedly(Return(true));
+
+    auto sender = ac::streaming::FECSender::Create(media, stream, 4);
+
+    for (int n = 0; n < 11; n++)
+        sender->Queue(MakeBuffer({static_cast<uint8_t>(n)}));
+
+    EXPECT_EQ(2u, stream->packets.size());
+}
+
+TEST(FECSender, ParityRecoversALostGroupMember) {
+    auto media = std::make_shared<MockTransportSender>();
+    auto stream = std::make_shared<RecordingStream>();
+
+    EXPECT_CALL(*media, Queue(_))
+            .WillRepeatedly(Return(true));
+
+    auto sender = ac::streaming::FECSender::Create(media, stream, 3);
+
+    const std::vector<uint8_t> first{0x11, 0x22, 0x33, 0x44};
+    const std::vector<uint8_t> second{0xaa, 0xbb};
+    const std::vector<uint8_t> third{0x01, 0x02, 0x03};
+
+    sender->Queue(MakeBuffer(first));
+    sender->Queue(MakeBuffer(second));
+    sender->Queue(MakeBuffer(third));
+
+    ASSERT_EQ(1u, stream->packets.size());
+    const auto &parity = stream->packets[0];
+    ASSERT_EQ(kParityHeaderSize + first.size(), parity.size());
+
+    // XOR the surviving members back out of the parity payload; what
+    // remains must be the lost one (zero padded to the longest).
+    std::vector<uint8_t> recovered(parity.begin() + kParityHeaderSize, parity.end());
+    for (std::size_t n = 0; n < first.size(); n++)
+        recovered[n] ^= first[n];
+    for (std::size_t n = 0; n < third.size(); n++)
+        recovered[n] ^= third[n];
+
+    EXPECT_EQ(0xaa, recovered[0]);
+    EXPECT_EQ(0xbb, recovered[1]);
+    EXPECT_EQ(0x00, recovered[2]);
+    EXPECT_EQ(0x00, recovered[3]);
+
+    // Length recovery XORs the member lengths the same way
+    const uint16_t length_recovery = (parity[16] << 8) | parity[17];
+    EXPECT_EQ(second.size(), length_recovery ^ first.size() ^ third.size());
+}
+
+TEST(FECSender, GroupsAreIndependent) {
+    auto media = std::make_shared<MockTransportSender>();
+    auto stream = std::make_shared<RecordingStream>();
+
+    EXPECT_CALL(*media, Queue(_))
+            .WillRepeatedly(Return(true));
+
+    auto sender = ac::streaming::FECSender::Create(media, stream, 1);
+
+    sender->Queue(MakeBuffer({0x55}));
+    sender->Queue(MakeBuffer({0x66}));
+
+    ASSERT_EQ(2u, stream->packets.size());
+    // With one member per group the parity payload is the member
+    EXPECT_EQ(0x55, stream->packets[0][kParityHeaderSize]);
+    EXPECT_EQ(0x66, stream->packets[1][kParityHeaderSize]);
+    // Parity sequence number advances per group
+    EXPECT_EQ(0, stream->packets[0][3]);
+    EXPECT_EQ(1, stream->packets[1][3]);
+}
+
+TEST(FECSender, LocalPortComesFromMediaSender) {
+    auto media = std::make_shared<MockTransportSender>();
+    auto stream = std::make_shared<RecordingStream>();
+
+    EXPECT_CALL(*media, LocalPort())
+            .WillRepeatedly(Return(4000));
+
+    auto sender = ac::streaming::FECSender::Create(media, stream, 3);
+
+    EXPECT_EQ(4000, sender->LocalPort());
+}
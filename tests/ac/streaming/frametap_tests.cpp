@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gmock/gmock.h>
+
+#include "ac/streaming/frametap.h"
+
+using namespace ::testing;
+
+namespace {
+typedef ac::streaming::FrameTap FrameTap;
+
+// Maps the ring the way an external consumer would and follows the
+// head counter from its own tail position.
+class TapReader {
+public:
+    explicit TapReader(int fd) : fd_(fd) {
+        struct stat info;
+        if (::fstat(fd_, &info) < 0)
+            return;
+
+        size_ = info.st_size;
+        mapped_ = static_cast<std::uint8_t*>(::mmap(nullptr, size_, PROT_READ,
+                                                    MAP_SHARED, fd_, 0));
+        if (mapped_ == MAP_FAILED) {
+            mapped_ = nullptr;
+            return;
+        }
+
+        header_ = reinterpret_cast<const FrameTap::RingHeader*>(mapped_);
+        data_ = mapped_ + sizeof(FrameTap::RingHeader);
+        tail_ = header_->head.load(std::memory_order_acquire);
+    }
+
+    ~TapReader() {
+        if (mapped_)
+            ::munmap(mapped_, size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    bool Valid() const { return !!header_; }
+
+    const FrameTap::RingHeader* Header() const { return header_; }
+
+    // Pops the next record relative to where this reader joined;
+    // returns false when the writer has not published anything new.
+    bool ReadRecord(FrameTap::RecordHeader *record, std::vector<std::uint8_t> *payload) {
+        const auto head = header_->head.load(std::memory_order_acquire);
+        if (head == tail_)
+            return false;
+
+        CopyOut(reinterpret_cast<std::uint8_t*>(record), sizeof(*record), tail_);
+
+        payload->resize(record->size);
+        CopyOut(payload->data(), record->size, tail_ + sizeof(*record));
+
+        tail_ += sizeof(*record) + record->size;
+        return true;
+    }
+
+private:
+    void CopyOut(std::uint8_t *dst, std::size_t size, std::uint64_t at) {
+        const auto offset = at % header_->ring_size;
+        const auto till_end = header_->ring_size - offset;
+
+        if (size <= till_end) {
+            ::memcpy(dst, data_ + offset, size);
+            return;
+        }
+
+        ::memcpy(dst, data_ + offset, till_end);
+        ::memcpy(dst + till_end, data_, size - till_end);
+    }
+
+private:
+    int fd_;
+    std::size_t size_ = 0;
+    std::uint8_t *mapped_ = nullptr;
+    const FrameTap::RingHeader *header_ = nullptr;
+    const std::uint8_t *data_ = nullptr;
+    std::uint64_t tail_ = 0;
+};
+
+ac::video::Buffer::Ptr CreateFrame(std::uint32_t size, ac::TimestampUs timestamp,
+                                   std::uint8_t fill) {
+    auto buffer = ac::video::Buffer::Create(size, timestamp);
+    ::memset(buffer->Data(), fill, size);
+    return buffer;
+}
+}
+
+TEST(FrameTap, InactiveUntilFirstReaderOpens) {
+    // The tap is a process wide singleton so this only holds while it
+    // runs before any test which opens a reader.
+    EXPECT_FALSE(FrameTap::Instance().Active());
+
+    FrameTap::Instance().Push(CreateFrame(16, 1ll, 0xaa));
+}
+
+TEST(FrameTap, ReaderGetsSealedReadOnlyRing) {
+    const auto fd = FrameTap::Instance().OpenReader();
+    ASSERT_LE(0, fd);
+    EXPECT_TRUE(FrameTap::Instance().Active());
+
+    std::uint8_t byte = 0;
+    EXPECT_GT(0, ::write(fd, &byte, 1));
+
+    TapReader reader(fd);
+    ASSERT_TRUE(reader.Valid());
+    EXPECT_EQ(FrameTap::kMagic, reader.Header()->magic);
+    EXPECT_EQ(FrameTap::kVersion, reader.Header()->version);
+}
+
+TEST(FrameTap, PushedFramesComeOutIntact) {
+    TapReader reader(FrameTap::Instance().OpenReader());
+    ASSERT_TRUE(reader.Valid());
+
+    FrameTap::Instance().Push(CreateFrame(100, 1000ll, 0x42));
+    FrameTap::Instance().Push(CreateFrame(50, 2000ll, 0x17));
+
+    FrameTap::RecordHeader record;
+    std::vector<std::uint8_t> payload;
+
+    ASSERT_TRUE(reader.ReadRecord(&record, &payload));
+    EXPECT_EQ(FrameTap::kRecordMarker, record.marker);
+    EXPECT_EQ(100u, record.size);
+    EXPECT_EQ(1000ll, record.timestamp_us);
+    EXPECT_THAT(payload, Each(0x42));
+
+    ASSERT_TRUE(reader.ReadRecord(&record, &payload));
+    EXPECT_EQ(50u, record.size);
+    EXPECT_EQ(2000ll, record.timestamp_us);
+    EXPECT_THAT(payload, Each(0x17));
+
+    EXPECT_FALSE(reader.ReadRecord(&record, &payload));
+}
+
+TEST(FrameTap, RecordsSurviveTheWrapAround) {
+    TapReader reader(FrameTap::Instance().OpenReader());
+    ASSERT_TRUE(reader.Valid());
+
+    // Large enough frames that a handful of them lap the ring at
+    // least once; a fast reader sees every one of them intact.
+    const std::uint32_t frame_size = reader.Header()->ring_size / 3;
+    const unsigned int frame_count = 5;
+
+    FrameTap::RecordHeader record;
+    std::vector<std::uint8_t> payload;
+
+    for (unsigned int n = 0; n < frame_count; n++) {
+        FrameTap::Instance().Push(CreateFrame(frame_size, n * 100ll,
+                                              static_cast<std::uint8_t>(n)));
+
+        ASSERT_TRUE(reader.ReadRecord(&record, &payload));
+        EXPECT_EQ(frame_size, record.size);
+        EXPECT_EQ(n * 100ll, record.timestamp_us);
+        EXPECT_THAT(payload, Each(static_cast<std::uint8_t>(n)));
+    }
+}
@@ -34,6 +34,7 @@ public:
     MOCK_METHOD2(SubmitCSD, void(TrackId, const ac::video::Buffer::Ptr&));
     MOCK_METHOD4(Packetize, bool(TrackId, const ac::video::Buffer::Ptr&,
                                  ac::video::Buffer::Ptr*, int));
+    MOCK_METHOD3(PacketizeIdle, bool(int64_t, ac::video::Buffer::Ptr*, int));
 };
 }
 
@@ -80,9 +81,18 @@ TEST(MediaSender, BufferGetsPacketizedAndSend) {
     EXPECT_CALL(*dummy_packetizer, AddTrack(_))
             .Times(1)
             .WillRepeatedly(Return(1));
+    // Per the Packetizer contract the output buffer carries the access
+    // unit's timing; the mock mimics that as MediaSender itself no
+    // longer restores timestamps on the side.
     EXPECT_CALL(*dummy_packetizer, Packetize(1, buffer, NotNull(), _))
             .Times(1)
-            .WillRepeatedly(DoAll(SetArgPointee<2>(packets), Return(true)));
+            .WillRepeatedly(DoAll(
+                InvokeWithoutArgs([buffer, packets]() {
+                    packets->SetTimestamp(buffer->Timestamp());
+                    packets->SetFrameId(buffer->FrameId());
+                }),
+                SetArgPointee<2>(packets),
+                Return(true)));
     EXPECT_CALL(*dummy_transport, Queue(packets))
             .Times(1)
             .WillRepeatedly(Return(true));
@@ -100,6 +110,42 @@ TEST(MediaSender, BufferGetsPacketizedAndSend) {
     EXPECT_TRUE(sender->Stop());
 }
 
+TEST(MediaSender, BatchedBuffersDrainInOnePass) {
+    auto encoder_config = ac::video::BaseEncoder::Config{};
+
+    auto dummy_packetizer = std::make_shared<MockPacketizer>();
+    auto dummy_transport = std::make_shared<MockTransportSender>();
+
+    auto first_buffer = ac::video::Buffer::Create(1);
+    auto second_buffer = ac::video::Buffer::Create(1);
+    auto packets = ac::video::Buffer::Create(10);
+
+    EXPECT_CALL(*dummy_packetizer, AddTrack(_))
+            .Times(1)
+            .WillRepeatedly(Return(1));
+    EXPECT_CALL(*dummy_packetizer, Packetize(1, first_buffer, NotNull(), _))
+            .Times(1)
+            .WillRepeatedly(DoAll(SetArgPointee<2>(packets), Return(true)));
+    EXPECT_CALL(*dummy_packetizer, Packetize(1, second_buffer, NotNull(), _))
+            .Times(1)
+            .WillRepeatedly(DoAll(SetArgPointee<2>(packets), Return(true)));
+    EXPECT_CALL(*dummy_transport, Queue(packets))
+            .Times(2)
+            .WillRepeatedly(Return(true));
+
+    auto sender = std::make_shared<ac::streaming::MediaSender>(dummy_packetizer, dummy_transport, encoder_config);
+
+    EXPECT_TRUE(sender->Start());
+
+    // Both buffers arrive with a single delegate call and have to be
+    // processed by a single Execute() iteration
+    sender->OnBuffersAvailable({first_buffer, second_buffer});
+
+    EXPECT_TRUE(sender->Execute());
+
+    EXPECT_TRUE(sender->Stop());
+}
+
 TEST(MediaSender, BufferPacketizingFails) {
     auto encoder_config = ac::video::BaseEncoder::Config{};
 
@@ -161,6 +207,147 @@ TEST(MediaSender, BufferWithCodecConfig) {
     EXPECT_TRUE(sender->Stop());
 }
 
+TEST(MediaSender, AudioBuffersGetInterleavedByTimestamp) {
+    auto encoder_config = ac::video::BaseEncoder::Config{};
+
+    auto dummy_packetizer = std::make_shared<MockPacketizer>();
+    auto dummy_transport = std::make_shared<MockTransportSender>();
+
+    auto audio_format = ac::streaming::Packetizer::TrackFormat{"audio/aac"};
+
+    auto now = ac::Utils::GetNowUs();
+    auto audio_buffer = ac::video::Buffer::Create(1, now);
+    auto video_buffer = ac::video::Buffer::Create(1, now + 10);
+    auto packets = ac::video::Buffer::Create(10);
+
+    EXPECT_CALL(*dummy_packetizer, AddTrack(_))
+            .Times(1)
+            .WillRepeatedly(Return(1));
+    EXPECT_CALL(*dummy_packetizer, AddTrack(audio_format))
+            .Times(1)
+            .WillRepeatedly(Return(2));
+
+    EXPECT_CALL(*dummy_transport, Queue(packets))
+            .Times(2)
+            .WillRepeatedly(Return(true));
+
+    {
+        // The older audio buffer has to reach the packetizer before
+        // the newer video one even though both are drained in the
+        // same pass.
+        InSequence seq;
+        EXPECT_CALL(*dummy_packetizer, Packetize(2, audio_buffer, NotNull(), _))
+                .Times(1)
+                .WillRepeatedly(DoAll(SetArgPointee<2>(packets), Return(true)));
+        EXPECT_CALL(*dummy_packetizer, Packetize(1, video_buffer, NotNull(), _))
+                .Times(1)
+                .WillRepeatedly(DoAll(SetArgPointee<2>(packets), Return(true)));
+    }
+
+    auto sender = std::make_shared<ac::streaming::MediaSender>(dummy_packetizer, dummy_transport, encoder_config);
+
+    EXPECT_TRUE(sender->EnableAudioTrack(audio_format));
+    // A second audio track isn't possible
+    EXPECT_FALSE(sender->EnableAudioTrack(audio_format));
+
+    EXPECT_TRUE(sender->Start());
+
+    sender->OnBufferAvailable(video_buffer);
+    sender->OnAudioBufferAvailable(audio_buffer);
+
+    EXPECT_TRUE(sender->Execute());
+
+    EXPECT_TRUE(sender->Stop());
+}
+
+TEST(MediaSender, ReconfigureSwapsPacketizerAndDropsStaleBuffers) {
+    auto encoder_config = ac::video::BaseEncoder::Config{};
+
+    auto old_packetizer = std::make_shared<MockPacketizer>();
+    auto new_packetizer = std::make_shared<MockPacketizer>();
+    auto dummy_transport = std::make_shared<MockTransportSender>();
+
+    auto audio_format = ac::streaming::Packetizer::TrackFormat{"audio/aac"};
+
+    auto stale_buffer = ac::video::Buffer::Create(1);
+    auto fresh_buffer = ac::video::Buffer::Create(1);
+    auto packets = ac::video::Buffer::Create(10);
+
+    EXPECT_CALL(*old_packetizer, AddTrack(_))
+            .Times(2)
+            .WillOnce(Return(1))
+            .WillOnce(Return(2));
+    // Buffers queued for the old format never reach a packetizer
+    EXPECT_CALL(*old_packetizer, Packetize(_, _, _, _))
+            .Times(0);
+
+    // Both tracks get recreated on the replacement packetizer
+    EXPECT_CALL(*new_packetizer, AddTrack(_))
+            .Times(2)
+            .WillOnce(Return(1))
+            .WillOnce(Return(2));
+    EXPECT_CALL(*new_packetizer, Packetize(1, fresh_buffer, NotNull(), _))
+            .Times(1)
+            .WillRepeatedly(DoAll(SetArgPointee<2>(packets), Return(true)));
+
+    EXPECT_CALL(*dummy_transport, Queue(packets))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    auto sender = std::make_shared<ac::streaming::MediaSender>(old_packetizer, dummy_transport, encoder_config);
+
+    EXPECT_TRUE(sender->EnableAudioTrack(audio_format));
+
+    EXPECT_TRUE(sender->Start());
+
+    sender->OnBufferAvailable(stale_buffer);
+
+    EXPECT_TRUE(sender->Reconfigure(new_packetizer, encoder_config));
+
+    sender->OnBufferAvailable(fresh_buffer);
+
+    EXPECT_TRUE(sender->Execute());
+
+    EXPECT_TRUE(sender->Stop());
+}
+
+TEST(MediaSender, KeepsClockAndTablesAliveWhileIdle) {
+    auto encoder_config = ac::video::BaseEncoder::Config{};
+
+    auto dummy_packetizer = std::make_shared<MockPacketizer>();
+    auto dummy_transport = std::make_shared<MockTransportSender>();
+
+    auto packets = ac::video::Buffer::Create(10);
+
+    auto expected_flags = ac::streaming::Packetizer::kEmitPATandPMT |
+            ac::streaming::Packetizer::kEmitPCR;
+
+    EXPECT_CALL(*dummy_packetizer, AddTrack(_))
+            .Times(1)
+            .WillRepeatedly(Return(1));
+    EXPECT_CALL(*dummy_packetizer, Packetize(_, _, _, _))
+            .Times(0);
+    // Exactly one idle emission; the second Execute() below falls
+    // into the 100ms window and must stay quiet
+    EXPECT_CALL(*dummy_packetizer, PacketizeIdle(_, NotNull(), expected_flags))
+            .Times(1)
+            .WillRepeatedly(DoAll(SetArgPointee<1>(packets), Return(true)));
+    EXPECT_CALL(*dummy_transport, Queue(packets))
+            .Times(1)
+            .WillRepeatedly(Return(true));
+
+    auto sender = std::make_shared<ac::streaming::MediaSender>(dummy_packetizer, dummy_transport, encoder_config);
+
+    EXPECT_TRUE(sender->Start());
+
+    // No buffers arrive, so both iterations run into the queue
+    // timeout as they would with capture gated on static content
+    EXPECT_TRUE(sender->Execute());
+    EXPECT_TRUE(sender->Execute());
+
+    EXPECT_TRUE(sender->Stop());
+}
+
 TEST(MediaSender, RequestsPCRandPATandPMTEvery100ms) {
     auto encoder_config = ac::video::BaseEncoder::Config{};
 
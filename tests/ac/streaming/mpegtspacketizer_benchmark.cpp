@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "ac/report/null/packetizerreport.h"
+#include "ac/streaming/mpegtspacketizer.h"
+
+#include "tests/common/allocationtracker.h"
+#include "tests/common/benchmark.h"
+
+namespace {
+// Frame sizes roughly match what our encoder emits for a 1080p
+// desktop session.
+static constexpr size_t kIDRFrameSize{256 * 1024};
+static constexpr size_t kPFrameSize{16 * 1024};
+static constexpr unsigned int kFramesPerCorpus{300};
+static constexpr unsigned int kGroupOfPicturesLength{30};
+
+static const uint8_t kCSD[] = {
+    // SPS
+    0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x80, 0x1f, 0xf8, 0x41, 0xa2,
+    // PPS
+    0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x38, 0x80
+};
+
+ac::video::Buffer::Ptr CreateAccessUnit(bool idr, size_t size, unsigned int *seed) {
+    auto buffer = ac::video::Buffer::Create(size);
+    uint8_t *data = buffer->Data();
+
+    data[0] = 0x00;
+    data[1] = 0x00;
+    data[2] = 0x00;
+    data[3] = 0x01;
+    data[4] = idr ? 0x65 : 0x41;
+
+    // Deterministic pseudo random payload which never forms a start
+    // code so every run packetizes the exact same corpus.
+    for (size_t n = 5; n < size; n++) {
+        *seed = *seed * 1103515245 + 12345;
+        uint8_t byte = (*seed >> 16) & 0xff;
+        if (byte == 0x00 || byte == 0x01)
+            byte = 0x42;
+        data[n] = byte;
+    }
+
+    return buffer;
+}
+
+struct Corpus {
+    std::string name;
+    std::vector<ac::video::Buffer::Ptr> frames;
+    bool submit_csd;
+    bool prepend_csd;
+};
+
+Corpus CreateCorpus(const std::string &name, unsigned int idr_interval,
+                    bool submit_csd, bool prepend_csd) {
+    Corpus corpus{name, {}, submit_csd, prepend_csd};
+    unsigned int seed = 12345;
+
+    for (unsigned int n = 0; n < kFramesPerCorpus; n++) {
+        const bool idr = (n % idr_interval) == 0;
+        auto frame = CreateAccessUnit(idr, idr ? kIDRFrameSize : kPFrameSize, &seed);
+        // 30 fps capture cadence
+        frame->SetTimestamp(n * 33333ll);
+        corpus.frames.push_back(frame);
+    }
+
+    return corpus;
+}
+
+struct RunResult {
+    ac::testing::Benchmark::Result benchmark;
+    double allocations_per_frame{0.0};
+};
+
+RunResult Run(const Corpus &corpus) {
+    const auto report = std::make_shared<ac::report::null::PacketizerReport>();
+    const auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    const auto track = packetizer->AddTrack(
+        ac::streaming::Packetizer::TrackFormat{"video/avc"});
+
+    if (corpus.submit_csd) {
+        auto csd = ac::video::Buffer::Create(sizeof(kCSD));
+        ::memcpy(csd->Data(), kCSD, sizeof(kCSD));
+        packetizer->SubmitCSD(track, csd);
+    }
+
+    ac::testing::Benchmark::Result result;
+    int64_t prev_section_time_us = -1ll;
+
+    ac::testing::AllocationTracker::Reset();
+
+    for (const auto &frame : corpus.frames) {
+        int flags = 0;
+
+        // Same cadence MediaSender requests in production
+        if (prev_section_time_us < 0ll
+                || prev_section_time_us + 100000ll <= frame->Timestamp()) {
+            flags |= ac::streaming::Packetizer::kEmitPATandPMT;
+            flags |= ac::streaming::Packetizer::kEmitPCR;
+            prev_section_time_us = frame->Timestamp();
+        }
+
+        if (corpus.prepend_csd)
+            flags |= ac::streaming::Packetizer::kPrependSPSandPPStoIDRFrames;
+
+        ac::video::Buffer::Ptr packets;
+
+        const auto start = std::chrono::steady_clock::now();
+        ac::testing::AllocationTracker::Enable();
+        if (!packetizer->Packetize(track, frame, &packets, flags)) {
+            std::cerr << "Failed to packetize frame" << std::endl;
+            ::exit(1);
+        }
+        ac::testing::AllocationTracker::Disable();
+        const auto stop = std::chrono::steady_clock::now();
+
+        result.timing.sample.push_back(
+            std::chrono::duration_cast<ac::testing::Benchmark::Result::Timing::Seconds>(
+                stop - start));
+    }
+
+    result.sample_size = result.timing.sample.size();
+
+    const auto minmax = std::minmax_element(
+        result.timing.sample.begin(), result.timing.sample.end());
+    result.timing.min = *minmax.first;
+    result.timing.max = *minmax.second;
+
+    double sum = 0.;
+    for (const auto &observation : result.timing.sample)
+        sum += observation.count();
+    const double mean = sum / result.sample_size;
+    result.timing.mean = ac::testing::Benchmark::Result::Timing::Seconds{mean};
+
+    double squares = 0.;
+    for (const auto &observation : result.timing.sample)
+        squares += (observation.count() - mean) * (observation.count() - mean);
+    result.timing.std_dev = ac::testing::Benchmark::Result::Timing::Seconds{
+        std::sqrt(squares / result.sample_size)};
+
+    return RunResult{result,
+        static_cast<double>(ac::testing::AllocationTracker::Count()) / corpus.frames.size()};
+}
+}
+
+int main(int, char**) {
+    // The corpora model the shapes the daemon actually sees: key frame
+    // storms on scene changes, long P frame runs on mostly static
+    // content and the CSD-per-IDR mode for encoders which don't
+    // inline SPS/PPS themselves.
+    const Corpus corpora[] = {
+        CreateCorpus("idr-heavy", 3, false, false),
+        CreateCorpus("p-heavy", kGroupOfPicturesLength, false, false),
+        CreateCorpus("csd-per-idr", kGroupOfPicturesLength, true, true),
+    };
+
+    for (const auto &corpus : corpora) {
+        const auto run = Run(corpus);
+        const auto &result = run.benchmark;
+
+        std::cout << corpus.name << ": "
+                  << "frames " << result.sample_size
+                  << " mean " << result.timing.mean.count() * 1000000. << "us"
+                  << " min " << result.timing.min.count() * 1000000. << "us"
+                  << " max " << result.timing.max.count() * 1000000. << "us"
+                  << " stddev " << result.timing.std_dev.count() * 1000000. << "us"
+                  << " allocations/frame " << run.allocations_per_frame
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -105,7 +105,7 @@ private:
 
 class MockPacketizerReport : public ac::video::PacketizerReport {
 public:
-    MOCK_METHOD1(PacketizedFrame, void(const ac::TimestampUs&));
+    MOCK_METHOD2(PacketizedFrame, void(const ac::TimestampUs&, const ac::FrameId&));
 };
 
 }
@@ -137,6 +137,72 @@ TEST(MPEGTSPacketizer, TryMoreThanOneValidTrack) {
     EXPECT_EQ(-1, id);
 }
 
+TEST(MPEGTSPacketizer, AddAudioTracks) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+
+    auto video_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+    EXPECT_EQ(0, video_id);
+
+    auto audio_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"audio/aac"});
+    EXPECT_EQ(1, audio_id);
+
+    auto lpcm_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"audio/lpcm"});
+    EXPECT_EQ(2, lpcm_id);
+
+    // private_stream_1 carries at most one LPCM stream
+    auto second_lpcm_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"audio/lpcm"});
+    EXPECT_EQ(-1, second_lpcm_id);
+
+    auto unknown_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"audio/vorbis"});
+    EXPECT_EQ(-1, unknown_id);
+}
+
+TEST(MPEGTSPacketizer, MuxesAudioIntoTheSameTransportStream) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+
+    auto video_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+    auto audio_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"audio/aac"});
+
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(2);
+
+    // The PMT has to describe both elementary streams
+    ac::video::Buffer::Ptr out;
+    auto frame = CreateFrame(100);
+    packetizer->Packetize(video_id, frame, &out,
+                          ac::streaming::Packetizer::kEmitPATandPMT);
+
+    MPEGTSPacketMatcher matcher(out);
+    matcher.ExpectPackets(3);
+
+    // PMT: stream_type/PID pairs follow the fixed 17 byte section
+    // header (4 bytes TS header, pointer and 12 bytes up to
+    // program_info_length) plus 10 bytes of AVC descriptors.
+    matcher.At(1).ExpectPID(0x100);
+    matcher.At(1).ExpectByte(17, 0x1b);             // stream_type H.264
+    matcher.At(1).ExpectByte(18, 0xe0 | 0x10);      // elementary_PID 0x1011
+    matcher.At(1).ExpectByte(19, 0x11);
+    matcher.At(1).ExpectByte(32, 0x0f);             // stream_type AAC
+    matcher.At(1).ExpectByte(33, 0xe0 | 0x11);      // elementary_PID 0x1100
+    matcher.At(1).ExpectByte(34, 0x00);
+
+    // Audio frames come out on their own PID within the same stream
+    uint8_t samples[32];
+    ::memset(samples, 0x5a, sizeof(samples));
+    auto audio_frame = ac::video::Buffer::Create(samples, sizeof(samples));
+
+    ac::video::Buffer::Ptr audio_out;
+    packetizer->Packetize(audio_id, audio_frame, &audio_out);
+
+    MPEGTSPacketMatcher audio_matcher(audio_out);
+    audio_matcher.ExpectPackets(1);
+    audio_matcher.At(0).ExpectValid();
+    audio_matcher.At(0).ExpectPID(0x1100);
+    audio_matcher.At(0).ExpectData(audio_frame->Data(), audio_frame->Length());
+}
+
 TEST(MPEGTSPacketizer, SubmitAndProcessCodecSpecificData) {
     auto report = std::make_shared<MockPacketizerReport>();
     auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
@@ -147,7 +213,7 @@ TEST(MPEGTSPacketizer, SubmitAndProcessCodecSpecificData) {
     ::memcpy(buffer->Data(), csd0, sizeof(csd0));
     buffer->SetTimestamp(now);
 
-    EXPECT_CALL(*report, PacketizedFrame(buffer->Timestamp()))
+    EXPECT_CALL(*report, PacketizedFrame(buffer->Timestamp(), _))
             .Times(1);
 
     ac::video::Buffer::Ptr out;
@@ -166,6 +232,42 @@ TEST(MPEGTSPacketizer, SubmitAndProcessCodecSpecificData) {
     EXPECT_GE(now, out->Timestamp());
 }
 
+TEST(MPEGTSPacketizer, LargePMTSpansMultipleTSPackets) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+
+    // Sixteen H.264 tracks each contribute 15 bytes of elementary
+    // stream description, pushing the PMT section well past a single
+    // TS packet payload.
+    ac::streaming::Packetizer::TrackId id = -1;
+    for (int n = 0; n < 16; n++)
+        id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+    ASSERT_NE(-1, id);
+
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(1);
+
+    ac::video::Buffer::Ptr out;
+    auto frame = CreateFrame(100);
+    packetizer->Packetize(id, frame, &out,
+                          ac::streaming::Packetizer::kEmitPATandPMT);
+
+    // PAT, two PMT packets and one payload packet
+    MPEGTSPacketMatcher matcher(out);
+    matcher.ExpectPackets(4);
+
+    // The first PMT packet starts the section
+    matcher.At(1).ExpectPID(0x100);
+    matcher.At(1).ExpectByte(1, 0x41);
+
+    // The continuation packet keeps appending section bytes on the
+    // same PID with payload_unit_start cleared and the continuity
+    // counter advanced.
+    matcher.At(2).ExpectByte(1, 0x01);
+    matcher.At(2).ExpectByte(2, 0x00);
+    matcher.At(2).ExpectNoPaddingBytesAndContinuityCounter(2);
+}
+
 TEST(MPEGTSPacketizer, EmitPCRandPATandPMT) {
     auto report = std::make_shared<MockPacketizerReport>();
     auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
@@ -174,7 +276,7 @@ TEST(MPEGTSPacketizer, EmitPCRandPATandPMT) {
     ac::video::Buffer::Ptr out;
     auto buffer = CreateFrame(100);
 
-    EXPECT_CALL(*report, PacketizedFrame(buffer->Timestamp()))
+    EXPECT_CALL(*report, PacketizedFrame(buffer->Timestamp(), _))
             .Times(1);
 
     packetizer->Packetize(id, buffer, &out, ac::streaming::Packetizer::kEmitPCR |
@@ -211,12 +313,55 @@ TEST(MPEGTSPacketizer, EmitPCRandPATandPMT) {
     EXPECT_GE(0, out->Timestamp());
 }
 
+TEST(MPEGTSPacketizer, PCRDerivedFromCaptureTimestamp) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(2);
+
+    const int64_t timestamp = 1234567ll;
+    const uint64_t pcr = timestamp * 27;
+    const uint64_t pcr_base = pcr / 300;
+    const uint32_t pcr_ext = pcr % 300;
+
+    auto buffer = CreateFrame(100);
+    buffer->SetTimestamp(timestamp);
+
+    ac::video::Buffer::Ptr out;
+    packetizer->Packetize(id, buffer, &out, ac::streaming::Packetizer::kEmitPCR);
+
+    MPEGTSPacketMatcher matcher(out);
+    matcher.ExpectPackets(2);
+
+    matcher.At(0).ExpectPID(0x1000);
+    matcher.At(0).ExpectByte(6, (pcr_base >> 25) & 0xff);
+    matcher.At(0).ExpectByte(7, (pcr_base >> 17) & 0xff);
+    matcher.At(0).ExpectByte(8, (pcr_base >> 9) & 0xff);
+    matcher.At(0).ExpectByte(9, (pcr_base >> 1) & 0xff);
+    matcher.At(0).ExpectByte(10, ((pcr_base & 1) << 7) | 0x7e | ((pcr_ext >> 8) & 1));
+    matcher.At(0).ExpectByte(11, pcr_ext & 0xff);
+
+    // A timestamp stepping backwards must not drag PCR along
+    auto earlier = CreateFrame(100);
+    earlier->SetTimestamp(timestamp - 1000ll);
+
+    packetizer->Packetize(id, earlier, &out, ac::streaming::Packetizer::kEmitPCR);
+
+    MPEGTSPacketMatcher clamped(out);
+    clamped.ExpectPackets(2);
+    clamped.At(0).ExpectByte(9, (pcr_base >> 1) & 0xff);
+    clamped.At(0).ExpectByte(10, ((pcr_base & 1) << 7) | 0x7e | ((pcr_ext >> 8) & 1));
+    clamped.At(0).ExpectByte(11, pcr_ext & 0xff);
+}
+
 TEST(MPEGTSPacketizer, IncreasingContinuityCounter) {
     auto report = std::make_shared<MockPacketizerReport>();
     auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
     auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
 
-    EXPECT_CALL(*report, PacketizedFrame(_))
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
             .Times(20);
 
     // Make sure we looper over 15 here as that is used for the continuity counter
@@ -254,3 +399,236 @@ TEST(MPEGTSPacketizer, IncreasingContinuityCounter) {
         matcher.At(3).ExpectData(buffer->Data(), buffer->Length());
     }
 }
+
+TEST(MPEGTSPacketizer, CachedSectionsStayStableAcrossEmissions) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(2);
+
+    ac::video::Buffer::Ptr first_out;
+    auto buffer = CreateFrame(100);
+    packetizer->Packetize(id, buffer, &first_out,
+                          ac::streaming::Packetizer::kEmitPATandPMT);
+
+    // Keep the first PAT/PMT around; the output buffer gets recycled
+    std::vector<uint8_t> first_sections(first_out->Data(),
+                                        first_out->Data() + 2 * kMPEGTSPacketLength);
+    first_out.reset();
+
+    ac::video::Buffer::Ptr second_out;
+    buffer = CreateFrame(100);
+    packetizer->Packetize(id, buffer, &second_out,
+                          ac::streaming::Packetizer::kEmitPATandPMT);
+
+    // Apart from the continuity counter nibble in byte 3 both emitted
+    // PAT and PMT packets have to be byte-identical.
+    for (unsigned int n = 0; n < 2 * kMPEGTSPacketLength; n++) {
+        if (n % kMPEGTSPacketLength == 3) {
+            EXPECT_EQ(first_sections[n] + 1, second_out->Data()[n]);
+            continue;
+        }
+        EXPECT_EQ(first_sections[n], second_out->Data()[n]) << "at offset " << n;
+    }
+}
+
+TEST(MPEGTSPacketizer, PrependsCSDToIDRFrames) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    auto csd_buffer = ac::video::Buffer::Create(sizeof(csd0));
+    ::memcpy(csd_buffer->Data(), csd0, sizeof(csd0));
+    packetizer->SubmitCSD(id, csd_buffer);
+
+    auto frame = CreateFrame(32);
+
+    EXPECT_CALL(*report, PacketizedFrame(frame->Timestamp(), _))
+            .Times(1);
+
+    ac::video::Buffer::Ptr out;
+    packetizer->Packetize(id, frame, &out,
+                          ac::streaming::Packetizer::kPrependSPSandPPStoIDRFrames);
+
+    // The payload has to come out as SPS/PPS followed by the frame,
+    // exactly as if both had been handed over as one access unit.
+    std::vector<uint8_t> expected(csd0, csd0 + sizeof(csd0));
+    expected.insert(expected.end(), frame->Data(), frame->Data() + frame->Length());
+
+    MPEGTSPacketMatcher matcher(out);
+    matcher.ExpectPackets(1);
+    matcher.At(0).ExpectValid();
+    matcher.At(0).ExpectPID(0x1011);
+    matcher.At(0).ExpectData(expected.data(), expected.size());
+}
+
+TEST(MPEGTSPacketizer, ForcedCSDPrependIgnoresFrameType) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    auto csd_buffer = ac::video::Buffer::Create(sizeof(csd0));
+    ::memcpy(csd_buffer->Data(), csd0, sizeof(csd0));
+    packetizer->SubmitCSD(id, csd_buffer);
+
+    // A plain P slice; gradual refresh streams consist of nothing else
+    auto frame = CreateFrame(32);
+    frame->Data()[4] = 0x41;
+
+    EXPECT_CALL(*report, PacketizedFrame(frame->Timestamp(), _))
+            .Times(2);
+
+    // Without the force flag a non-IDR frame travels bare ...
+    ac::video::Buffer::Ptr out;
+    packetizer->Packetize(id, frame, &out,
+                          ac::streaming::Packetizer::kPrependSPSandPPStoIDRFrames);
+
+    MPEGTSPacketMatcher bare(out);
+    bare.ExpectPackets(1);
+    bare.At(0).ExpectData(frame->Data(), frame->Length());
+
+    // ... with it the parameter sets come along anyway
+    packetizer->Packetize(id, frame, &out,
+                          ac::streaming::Packetizer::kForcePrependSPSandPPS);
+
+    std::vector<uint8_t> expected(csd0, csd0 + sizeof(csd0));
+    expected.insert(expected.end(), frame->Data(), frame->Data() + frame->Length());
+
+    MPEGTSPacketMatcher matcher(out);
+    matcher.ExpectPackets(1);
+    matcher.At(0).ExpectValid();
+    matcher.At(0).ExpectPID(0x1011);
+    matcher.At(0).ExpectData(expected.data(), expected.size());
+}
+
+TEST(MPEGTSPacketizer, OutputCarriesAccessUnitTimestampAndFrameId) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    auto now = ac::Utils::GetNowUs();
+    auto frame = CreateFrame(32);
+    frame->SetTimestamp(now);
+    frame->SetFrameId(42);
+
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(1);
+
+    // No side-channel restore anywhere downstream; the output buffer
+    // itself has to travel with the access unit's timing attached.
+    ac::video::Buffer::Ptr out;
+    ASSERT_TRUE(packetizer->Packetize(id, frame, &out));
+
+    EXPECT_EQ(now, out->Timestamp());
+    EXPECT_EQ(42, out->FrameId());
+}
+
+TEST(MPEGTSPacketizer, TightPackingCoalescesAudioUnits) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    packetizer->SetTightPacking(true);
+
+    packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+    auto audio_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"audio/aac"});
+
+    // Only the coalesced group reports a packetized frame
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(1);
+
+    uint8_t samples[300];
+    ::memset(samples, 0x5a, sizeof(samples));
+
+    const int64_t first_ts = 1000000ll;
+
+    // Small audio units get held back until about one RTP packet's
+    // worth of payload accumulated...
+    ac::video::Buffer::Ptr out;
+    for (int n = 0; n < 4; n++) {
+        auto unit = ac::video::Buffer::Create(samples, sizeof(samples));
+        unit->SetTimestamp(first_ts + n * 1000ll);
+        ASSERT_TRUE(packetizer->Packetize(audio_id, unit, &out));
+        EXPECT_EQ(nullptr, out.get());
+    }
+
+    // ...then come out as a single PES stamped with the first held
+    // back unit's time.
+    auto unit = ac::video::Buffer::Create(samples, sizeof(samples));
+    unit->SetTimestamp(first_ts + 4000ll);
+    ASSERT_TRUE(packetizer->Packetize(audio_id, unit, &out));
+    ASSERT_NE(nullptr, out.get());
+
+    EXPECT_EQ(first_ts, out->Timestamp());
+
+    MPEGTSPacketMatcher matcher(out);
+    // 5 * 300 bytes of payload plus the PES header needs 9 TS packets
+    matcher.ExpectPackets(9);
+    matcher.At(0).ExpectPID(0x1100);
+}
+
+TEST(MPEGTSPacketizer, TightPackingBoundsAudioDelay) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    packetizer->SetTightPacking(true);
+
+    packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+    auto audio_id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"audio/aac"});
+
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(1);
+
+    uint8_t samples[32];
+    ::memset(samples, 0x5a, sizeof(samples));
+
+    auto first = ac::video::Buffer::Create(samples, sizeof(samples));
+    first->SetTimestamp(1000000ll);
+
+    ac::video::Buffer::Ptr out;
+    ASSERT_TRUE(packetizer->Packetize(audio_id, first, &out));
+    EXPECT_EQ(nullptr, out.get());
+
+    // Far below the payload target, but the first unit aged past the
+    // latency bound and forces the flush.
+    auto second = ac::video::Buffer::Create(samples, sizeof(samples));
+    second->SetTimestamp(1010000ll);
+    ASSERT_TRUE(packetizer->Packetize(audio_id, second, &out));
+    ASSERT_NE(nullptr, out.get());
+
+    EXPECT_EQ(1000000ll, out->Timestamp());
+}
+
+TEST(MPEGTSPacketizer, ReportsMuxStuffingOverhead) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    EXPECT_CALL(*report, PacketizedFrame(_, _))
+            .Times(1);
+
+    EXPECT_EQ(0.0, packetizer->MuxOverhead());
+
+    // 100 bytes of payload in a 188 byte TS packet leaves a good
+    // chunk of adaptation field stuffing behind
+    ac::video::Buffer::Ptr out;
+    auto frame = CreateFrame(100);
+    ASSERT_TRUE(packetizer->Packetize(id, frame, &out));
+
+    EXPECT_GT(packetizer->MuxOverhead(), 0.0);
+    EXPECT_LT(packetizer->MuxOverhead(), 1.0);
+}
+
+TEST(MPEGTSPacketizer, IdleOutputCarriesTheRequestedTimestamp) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    const int64_t timestamp = 1234567ll;
+
+    ac::video::Buffer::Ptr out;
+    ASSERT_TRUE(packetizer->PacketizeIdle(timestamp, &out,
+                                          ac::streaming::Packetizer::kEmitPATandPMT |
+                                          ac::streaming::Packetizer::kEmitPCR));
+
+    EXPECT_EQ(timestamp, out->Timestamp());
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "ac/networkutils.h"
+#include "ac/streaming/rtcpreceiver.h"
+
+using namespace ::testing;
+
+namespace {
+struct MockDelegate : public ac::streaming::RTCPReceiver::Delegate {
+    MOCK_METHOD2(OnRetransmitRequested, void(uint16_t, uint16_t));
+    MOCK_METHOD2(OnReceiverReport, void(uint8_t, uint32_t));
+    MOCK_METHOD0(OnSinkRequestedIDRFrame, void());
+};
+
+// Builds one RTCP chunk: version 2, given format in the five low bits
+// of the first byte, length in 32 bit words minus one per RFC 3550.
+std::vector<uint8_t> BuildChunk(uint8_t format, uint8_t packet_type,
+                                const std::vector<uint8_t> &payload) {
+    std::vector<uint8_t> chunk{static_cast<uint8_t>(0x80 | format), packet_type, 0x00, 0x00};
+    chunk.insert(chunk.end(), payload.begin(), payload.end());
+    const auto words = chunk.size() / 4 - 1;
+    chunk[2] = (words >> 8) & 0xff;
+    chunk[3] = words & 0xff;
+    return chunk;
+}
+
+void SendPacket(const ac::network::Port &port, const std::vector<uint8_t> &packet) {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(fd, 0);
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+    addr.sin_port = htons(port);
+
+    ASSERT_EQ(static_cast<ssize_t>(packet.size()),
+              ::sendto(fd, packet.data(), packet.size(), 0,
+                       reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)));
+    ::close(fd);
+}
+
+// The receiver polls with a 1ms timeout; a few rounds are plenty for
+// a loopback datagram to arrive.
+void ReceiveOnce(const ac::streaming::RTCPReceiver::Ptr &receiver) {
+    for (int n = 0; n < 100; n++)
+        receiver->Execute();
+}
+}
+
+class RTCPReceiverFixture : public ::testing::Test {
+public:
+    void SetUp() override {
+        port = ac::NetworkUtils::PickRandomPort();
+        receiver = std::make_shared<ac::streaming::RTCPReceiver>(port);
+        delegate = std::make_shared<MockDelegate>();
+        receiver->SetDelegate(delegate);
+        ASSERT_TRUE(receiver->Start());
+    }
+
+    ac::network::Port port;
+    ac::streaming::RTCPReceiver::Ptr receiver;
+    std::shared_ptr<MockDelegate> delegate;
+};
+
+TEST_F(RTCPReceiverFixture, PictureLossIndicationRequestsIDRFrame) {
+    EXPECT_CALL(*delegate, OnSinkRequestedIDRFrame()).Times(1);
+
+    // PLI: sender SSRC + media SSRC, no FCI
+    SendPacket(port, BuildChunk(1, 206, {0x00, 0x00, 0x00, 0x01,
+                                         0x00, 0x00, 0x00, 0x02}));
+    ReceiveOnce(receiver);
+}
+
+TEST_F(RTCPReceiverFixture, FullIntraRequestRequestsIDRFrame) {
+    EXPECT_CALL(*delegate, OnSinkRequestedIDRFrame()).Times(1);
+
+    // FIR: both SSRCs plus one FCI entry (SSRC + seq nr + reserved)
+    SendPacket(port, BuildChunk(4, 206, {0x00, 0x00, 0x00, 0x01,
+                                         0x00, 0x00, 0x00, 0x02,
+                                         0x00, 0x00, 0x00, 0x02,
+                                         0x01, 0x00, 0x00, 0x00}));
+    ReceiveOnce(receiver);
+}
+
+TEST_F(RTCPReceiverFixture, GenericNACKReportsLostPackets) {
+    EXPECT_CALL(*delegate, OnRetransmitRequested(0x1234, 0x0003)).Times(1);
+    EXPECT_CALL(*delegate, OnSinkRequestedIDRFrame()).Times(0);
+
+    SendPacket(port, BuildChunk(1, 205, {0x00, 0x00, 0x00, 0x01,
+                                         0x00, 0x00, 0x00, 0x02,
+                                         0x12, 0x34, 0x00, 0x03}));
+    ReceiveOnce(receiver);
+}
+
+TEST_F(RTCPReceiverFixture, AggregatesReceiverReportsPerBatch) {
+    // Two reports queued up before a single receive wakeup collapse
+    // into one delivery carrying the worst loss and the latest
+    // jitter estimate.
+    EXPECT_CALL(*delegate, OnReceiverReport(0x50, 0x00000020)).Times(1);
+
+    std::vector<uint8_t> payload(4 + 24, 0x00);
+    payload[8] = 0x50; // fraction lost
+    payload[19] = 0x10; // interarrival jitter
+    SendPacket(port, BuildChunk(1, 201, payload));
+
+    payload[8] = 0x20;
+    payload[19] = 0x20;
+    SendPacket(port, BuildChunk(1, 201, payload));
+
+    // Give loopback a moment so both datagrams sit in the receive
+    // queue before the one wakeup drains them.
+    ::usleep(50 * 1000);
+    receiver->Execute();
+}
+
+TEST_F(RTCPReceiverFixture, ReceiverReportForwardsLossAndJitter) {
+    EXPECT_CALL(*delegate, OnReceiverReport(0x40, 0x00000080)).Times(1);
+
+    std::vector<uint8_t> payload(4 + 24, 0x00);
+    payload[3] = 0x01; // Reporter SSRC
+    payload[8] = 0x40; // fraction lost of the single report block
+    payload[19] = 0x80; // interarrival jitter
+    SendPacket(port, BuildChunk(1, 201, payload));
+    ReceiveOnce(receiver);
+}
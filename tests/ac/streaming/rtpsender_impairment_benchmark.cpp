@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ac/common/threadedexecutor.h"
+#include "ac/network/udpstream.h"
+#include "ac/report/null/senderreport.h"
+#include "ac/streaming/rtpsender.h"
+#include "ac/utils.h"
+#include "ac/video/buffer.h"
+
+#include "tests/common/virtualnetwork.h"
+
+namespace {
+constexpr const char *kSenderAddress{"10.211.55.1"};
+constexpr const char *kReceiverAddress{"10.211.55.2"};
+constexpr std::uint16_t kReceiverPort{5004};
+constexpr std::size_t kMPEGTSPacketSize{188};
+// One Queue() call per tick; sized to produce roughly 15 MBit/s at
+// the 10ms tick below, matching a busy 1080p session.
+constexpr std::size_t kTSPacketsPerTick{100};
+constexpr std::chrono::milliseconds kTickInterval{10};
+constexpr const char *kDurationEnvName{"AETHERCAST_IMPAIRMENT_BENCH_DURATION_SECONDS"};
+constexpr unsigned int kDefaultDurationSeconds{5};
+
+// Receives on the far side of the veth pair from within its own
+// network namespace (packets would otherwise short-circuit through
+// the loopback path and never see the impaired link). Tracks goodput
+// and, via the RTP sequence numbers, how much got lost or reordered.
+class NamespacedReceiver {
+public:
+    NamespacedReceiver(const std::string &device) :
+        device_(device),
+        bytes_received_(0),
+        packets_received_(0),
+        gaps_(0),
+        reordered_(0),
+        last_sequence_(-1),
+        tid_(0),
+        endpoint_moved_(false),
+        ready_(false),
+        running_(true) {
+        thread_ = std::thread(&NamespacedReceiver::Worker, this);
+    }
+
+    ~NamespacedReceiver() {
+        running_.store(false);
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    // Thread id the veth endpoint has to be moved to with
+    // 'ip link set <dev> netns <tid>'
+    pid_t WaitForTid() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return tid_ != 0; });
+        return tid_;
+    }
+
+    void EndpointMoved() {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            endpoint_moved_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    bool WaitUntilReady() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return ready_; });
+        return running_.load();
+    }
+
+    void ResetCounters() {
+        bytes_received_.store(0);
+        packets_received_.store(0);
+        gaps_.store(0);
+        reordered_.store(0);
+        last_sequence_ = -1;
+    }
+
+    std::uint64_t BytesReceived() const { return bytes_received_.load(); }
+    std::uint64_t PacketsReceived() const { return packets_received_.load(); }
+    std::uint64_t Gaps() const { return gaps_.load(); }
+    std::uint64_t Reordered() const { return reordered_.load(); }
+
+private:
+    void Worker() {
+        // Detaching only this thread into a fresh namespace keeps the
+        // sender side of the benchmark in the original one.
+        if (::unshare(CLONE_NEWNET) < 0) {
+            std::cerr << "Failed to create network namespace (need root)" << std::endl;
+            running_.store(false);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            tid_ = static_cast<pid_t>(::syscall(SYS_gettid));
+        }
+        cv_.notify_all();
+
+        if (!running_.load())
+            return;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return endpoint_moved_; });
+        }
+
+        // system() forks from this thread and therefore runs inside
+        // our namespace.
+        const auto setup = ac::Utils::Sprintf(
+            "ip link set lo up && ip addr add %s/24 dev %s && ip link set %s up",
+            kReceiverAddress, device_, device_);
+        if (std::system(setup.c_str()) != 0) {
+            std::cerr << "Failed to configure receiver endpoint" << std::endl;
+            running_.store(false);
+        }
+
+        const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = ::inet_addr(kReceiverAddress);
+        addr.sin_port = htons(kReceiverPort);
+        if (running_.load() && ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::cerr << "Failed to bind receiver socket" << std::endl;
+            running_.store(false);
+        }
+
+        struct timeval timeout{0, 100 * 1000};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            ready_ = true;
+        }
+        cv_.notify_all();
+
+        std::vector<std::uint8_t> packet(64 * 1024);
+        while (running_.load()) {
+            const auto bytes = ::recv(fd, packet.data(), packet.size(), 0);
+            if (bytes < 12)
+                continue;
+
+            bytes_received_.fetch_add(bytes);
+            packets_received_.fetch_add(1);
+
+            const int sequence = (packet[2] << 8) | packet[3];
+            if (last_sequence_ >= 0) {
+                const auto expected = (last_sequence_ + 1) & 0xffff;
+                if (sequence == expected) {
+                    // In order, nothing to score
+                } else if (((sequence - expected) & 0xffff) < 0x8000) {
+                    // Jumped ahead; everything in between is missing
+                    // until it possibly shows up late.
+                    gaps_.fetch_add((sequence - expected) & 0xffff);
+                } else {
+                    // A packet from the past closed an earlier gap
+                    reordered_.fetch_add(1);
+                    if (gaps_.load() > 0)
+                        gaps_.fetch_sub(1);
+                    continue;
+                }
+            }
+            last_sequence_ = sequence;
+        }
+
+        ::close(fd);
+    }
+
+private:
+    std::string device_;
+    std::atomic<std::uint64_t> bytes_received_;
+    std::atomic<std::uint64_t> packets_received_;
+    std::atomic<std::uint64_t> gaps_;
+    std::atomic<std::uint64_t> reordered_;
+    int last_sequence_;
+    pid_t tid_;
+    bool endpoint_moved_;
+    bool ready_;
+    std::atomic<bool> running_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+};
+
+struct Scenario {
+    std::string name;
+    ac::testing::VirtualNetwork::Impairments impairments;
+};
+
+void RunScenario(const Scenario &scenario, ac::testing::VirtualNetwork &network,
+                 NamespacedReceiver &receiver, const std::chrono::seconds &duration) {
+    if (!network.ApplyImpairments(scenario.impairments)) {
+        std::cerr << "Failed to apply impairments for scenario " << scenario.name << std::endl;
+        return;
+    }
+
+    const auto stream = std::make_shared<ac::network::UdpStream>();
+    if (!stream->Connect(kReceiverAddress, kReceiverPort)) {
+        std::cerr << "Failed to connect sender stream" << std::endl;
+        return;
+    }
+
+    const auto sender = std::make_shared<ac::streaming::RTPSender>(
+        stream, std::make_shared<ac::report::null::SenderReport>());
+
+    ac::common::ThreadedExecutor executor(sender);
+    executor.Start();
+
+    receiver.ResetCounters();
+
+    std::uint64_t bytes_queued = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    while (std::chrono::steady_clock::now() - start < duration) {
+        auto buffer = ac::video::Buffer::Create(
+            kTSPacketsPerTick * kMPEGTSPacketSize, ac::Utils::GetNowUs());
+        std::memset(buffer->Data(), 0x42, buffer->Length());
+
+        sender->Queue(buffer);
+        bytes_queued += buffer->Length();
+
+        std::this_thread::sleep_for(kTickInterval);
+    }
+
+    // Let delayed and rate-limited packets trickle in before scoring
+    std::this_thread::sleep_for(std::chrono::milliseconds{500});
+
+    executor.Stop();
+
+    const auto seconds = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 1000.0;
+    const auto goodput_mbps = (receiver.BytesReceived() * 8.0) / (seconds * 1000.0 * 1000.0);
+    const auto offered_mbps = (bytes_queued * 8.0) / (seconds * 1000.0 * 1000.0);
+
+    std::cout << scenario.name << ": offered " << offered_mbps << " MBit/s"
+              << " goodput " << goodput_mbps << " MBit/s"
+              << " packets " << receiver.PacketsReceived()
+              << " lost " << receiver.Gaps()
+              << " reordered " << receiver.Reordered()
+              << std::endl;
+}
+}
+
+int main(int, char**) {
+    if (::geteuid() != 0) {
+        std::cerr << "The impairment benchmark needs root for the veth pair and netem" << std::endl;
+        return 1;
+    }
+
+    const auto duration_env = ac::Utils::GetEnvValue(kDurationEnvName);
+    const auto duration = std::chrono::seconds{
+        duration_env.empty() ? kDefaultDurationSeconds
+                             : static_cast<unsigned int>(std::atoi(duration_env.c_str()))};
+
+    ac::testing::VirtualNetwork network;
+
+    NamespacedReceiver receiver(network.Endpoint2());
+    const auto tid = receiver.WaitForTid();
+
+    const auto sender_setup = ac::Utils::Sprintf(
+        "ip addr add %s/24 dev %s && ip link set %s netns %d",
+        kSenderAddress, network.Endpoint1(), network.Endpoint2(), tid);
+    if (std::system(sender_setup.c_str()) != 0) {
+        std::cerr << "Failed to set up the virtual link" << std::endl;
+        return 1;
+    }
+    receiver.EndpointMoved();
+
+    if (!receiver.WaitUntilReady()) {
+        std::cerr << "Receiver never came up" << std::endl;
+        return 1;
+    }
+
+    const std::vector<Scenario> scenarios{
+        {"clean", {}},
+        {"loss-1pct", {1.0, 0.0, 0, 0, 0}},
+        {"loss-5pct", {5.0, 0.0, 0, 0, 0}},
+        {"reorder-25pct", {0.0, 25.0, 10, 0, 0}},
+        {"jitter-20ms", {0.0, 0.0, 20, 10, 0}},
+        {"rate-10mbit", {0.0, 0.0, 0, 0, 10 * 1000}},
+    };
+
+    for (const auto &scenario : scenarios)
+        RunScenario(scenario, network, receiver, duration);
+
+    network.ClearImpairments();
+
+    return 0;
+}
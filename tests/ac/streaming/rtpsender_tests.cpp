@@ -39,11 +39,13 @@ public:
     MOCK_METHOD3(Write, ac::network::Stream::Error(const uint8_t*, unsigned int, const ac::TimestampUs&));
     MOCK_CONST_METHOD0(LocalPort, ac::network::Port());
     MOCK_CONST_METHOD0(MaxUnitSize, std::uint32_t());
+    MOCK_CONST_METHOD0(SupportsSegmentedWrite, bool());
+    MOCK_METHOD4(WriteSegmented, ac::network::Stream::Error(const uint8_t*, unsigned int, unsigned int, const ac::TimestampUs&));
 };
 
 class MockSenderReport : public ac::video::SenderReport {
 public:
-    MOCK_METHOD2(SentPacket, void(const ac::TimestampUs&, const size_t&));
+    MOCK_METHOD3(SentPacket, void(const ac::TimestampUs&, const size_t&, const ac::FrameId&));
 };
 }
 
@@ -123,7 +125,7 @@ TEST(RTPSender, QueuesUpPackagesAndSendsAll) {
 
     auto now = ac::Utils::GetNowUs();
 
-    EXPECT_CALL(*mock_report, SentPacket(now, _))
+    EXPECT_CALL(*mock_report, SentPacket(now, _, _))
             .Times(3);
 
     EXPECT_CALL(*mock_stream, MaxUnitSize())
@@ -142,6 +144,171 @@ TEST(RTPSender, QueuesUpPackagesAndSendsAll) {
     EXPECT_TRUE(sender->Execute());
 }
 
+TEST(RTPSender, DrainsWholeQueueIntoOneBatch) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _, _))
+            .Times(3);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    // Three queued RTP packets need to go out with a single batched
+    // write which translates into three individual writes through the
+    // default WriteBatch implementation.
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .Times(3)
+            .WillRepeatedly(Return(ac::network::Stream::Error::kNone));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 15);
+
+    EXPECT_TRUE(sender->Queue(packets));
+    EXPECT_TRUE(sender->Execute());
+}
+
+TEST(RTPSender, SegmentedWriteGetsOneSuperPacketPerFrame) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _, _))
+            .Times(1);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    EXPECT_CALL(*mock_stream, SupportsSegmentedWrite())
+            .WillRepeatedly(Return(true));
+
+    const unsigned int max_ts_packets = (kStreamMaxUnitSize - kRTPHeaderSize) / kMPEGTSPacketSize;
+    const unsigned int segment_size = kRTPHeaderSize + max_ts_packets * kMPEGTSPacketSize;
+
+    // 15 TS packets split into segments of 7 TS packets each which
+    // makes three RTP packets or one super-packet carrying three
+    // RTP headers.
+    const unsigned int expected_size = 15 * kMPEGTSPacketSize + 3 * kRTPHeaderSize;
+
+    EXPECT_CALL(*mock_stream, WriteSegmented(_, expected_size, segment_size, _))
+            .Times(1)
+            .WillOnce(Return(ac::network::Stream::Error::kNone));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 15);
+
+    EXPECT_TRUE(sender->Queue(packets));
+    EXPECT_TRUE(sender->Execute());
+}
+
+TEST(RTPSender, RepacksToNewUnitSizeAtQueueTime) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _, _))
+            .Times(2);
+
+    // The unit size drops between the two queued frames as it would
+    // after a path MTU change; 766 bytes leave room for four TS
+    // packets per datagram instead of seven.
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillOnce(Return(kStreamMaxUnitSize))
+            .WillOnce(Return(kStreamMaxUnitSize))
+            .WillRepeatedly(Return(766));
+
+    EXPECT_CALL(*mock_stream, SupportsSegmentedWrite())
+            .WillRepeatedly(Return(true));
+
+    const unsigned int old_segment_size = kRTPHeaderSize + 7 * kMPEGTSPacketSize;
+    const unsigned int new_segment_size = kRTPHeaderSize + 4 * kMPEGTSPacketSize;
+
+    // The first super-packet was packed before the change and has to
+    // go out split at the old boundaries; the second one picks up the
+    // new packing factor.
+    EXPECT_CALL(*mock_stream, WriteSegmented(_, _, old_segment_size, _))
+            .Times(1)
+            .WillOnce(Return(ac::network::Stream::Error::kNone));
+    EXPECT_CALL(*mock_stream, WriteSegmented(_, _, new_segment_size, _))
+            .Times(1)
+            .WillOnce(Return(ac::network::Stream::Error::kNone));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    EXPECT_TRUE(sender->Queue(ac::video::Buffer::Create(kMPEGTSPacketSize * 8)));
+    EXPECT_TRUE(sender->Queue(ac::video::Buffer::Create(kMPEGTSPacketSize * 8)));
+    EXPECT_TRUE(sender->Execute());
+}
+
+TEST(RTPSender, SynchronousModeSendsFromQueue) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _, _))
+            .Times(3);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    // The fused path puts the packets on the wire inside Queue();
+    // Execute() is never driven by anyone.
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .Times(3)
+            .WillRepeatedly(Return(ac::network::Stream::Error::kNone));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+    sender->EnableSynchronousSend();
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 15);
+
+    EXPECT_TRUE(sender->Queue(packets));
+}
+
+TEST(RTPSender, SynchronousModeKeepsSegmentedWrites) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _, _))
+            .Times(1);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    EXPECT_CALL(*mock_stream, SupportsSegmentedWrite())
+            .WillRepeatedly(Return(true));
+
+    // Same layout the queued variant produces, sent straight away
+    const unsigned int segment_size =
+            kRTPHeaderSize + 7 * kMPEGTSPacketSize;
+    const unsigned int expected_size = 15 * kMPEGTSPacketSize + 3 * kRTPHeaderSize;
+
+    EXPECT_CALL(*mock_stream, WriteSegmented(_, expected_size, segment_size, _))
+            .Times(1)
+            .WillOnce(Return(ac::network::Stream::Error::kNone));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+    sender->EnableSynchronousSend();
+
+    EXPECT_TRUE(sender->Queue(ac::video::Buffer::Create(kMPEGTSPacketSize * 15)));
+}
+
+TEST(RTPSender, SynchronousModeReportsWriteFailureToCaller) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .Times(1)
+            .WillOnce(Return(ac::network::Stream::Error::kRemoteClosedConnection));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+    sender->EnableSynchronousSend();
+
+    EXPECT_FALSE(sender->Queue(ac::video::Buffer::Create(kMPEGTSPacketSize)));
+}
+
 TEST(RTPSender, WritePackageFails) {
     auto mock_stream = std::make_shared<MockNetworkStream>();
     auto mock_report = std::make_shared<MockSenderReport>();
@@ -169,7 +336,7 @@ TEST(RTPSender, ConstructsCorrectRTPHeader) {
 
     uint32_t expected_output_size = kMPEGTSPacketSize + kRTPHeaderSize;
 
-    EXPECT_CALL(*mock_report, SentPacket(packet_timestamp, expected_output_size))
+    EXPECT_CALL(*mock_report, SentPacket(packet_timestamp, expected_output_size, _))
             .Times(1);
 
     EXPECT_CALL(*mock_stream, MaxUnitSize())
@@ -205,8 +372,8 @@ TEST(RTPSender, ConstructsCorrectRTPHeader) {
     EXPECT_EQ(0x00, output_data[2]);
     EXPECT_EQ(0x00, output_data[3]);
 
-    // We can't compare the actual RTP time here but we can make sure
-    // its between our start time and now.
+    // The RTP time is derived from the buffer's capture timestamp
+    // rather than the send time so we can compare it exactly.
     std::uint32_t rtp_time = 0;
     rtp_time |= (output_data[4] << 24);
     rtp_time |= (output_data[5] << 16);
@@ -214,10 +381,8 @@ TEST(RTPSender, ConstructsCorrectRTPHeader) {
     rtp_time |= (output_data[7] << 0);
 
     const uint32_t packet_timestamp_90khz = (packet_timestamp * 9) / 100ll;
-    const uint32_t now_rtp_time = (ac::Utils::GetNowUs() * 9) / 100ll;
 
-    EXPECT_LE(packet_timestamp_90khz, rtp_time);
-    EXPECT_GE(now_rtp_time, rtp_time);
+    EXPECT_EQ(packet_timestamp_90khz, rtp_time);
 
     std::uint32_t source_id = 0;
     source_id |= (output_data[8] << 24);
@@ -230,3 +395,64 @@ TEST(RTPSender, ConstructsCorrectRTPHeader) {
     if (output_data)
         delete output_data;
 }
+
+TEST(RTPSender, SendTimeExtensionGrowsAndStampsTheHeader) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    // Fixed header plus the one-byte extension block from RFC 5285
+    const uint32_t extended_header_size = kRTPHeaderSize + 8;
+    const uint32_t expected_output_size = kMPEGTSPacketSize + extended_header_size;
+
+    EXPECT_CALL(*mock_report, SentPacket(_, expected_output_size, _))
+            .Times(1);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    std::uint8_t *output_data = nullptr;
+
+    EXPECT_CALL(*mock_stream, Write(_, expected_output_size, _))
+            .WillOnce(DoAll(Invoke([&](const uint8_t *data, unsigned int size, const ac::TimestampUs &timestamp) {
+                                boost::ignore_unused_variable_warning(timestamp);
+
+                                output_data = new std::uint8_t[size];
+                                ::memcpy(output_data, data, size);
+                            }),
+                            Return(ac::network::Stream::Error::kNone)));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+    sender->EnableSendTimeExtension();
+
+    EXPECT_TRUE(sender->Queue(ac::video::Buffer::Create(kMPEGTSPacketSize)));
+    EXPECT_TRUE(sender->Execute());
+
+    ASSERT_NE(nullptr, output_data);
+
+    // Version 2 with the extension bit set
+    EXPECT_EQ(0x90, output_data[0]);
+
+    // One-byte extension profile marker and a length of one 32 bit word
+    EXPECT_EQ(0xbe, output_data[12]);
+    EXPECT_EQ(0xde, output_data[13]);
+    EXPECT_EQ(0x00, output_data[14]);
+    EXPECT_EQ(0x01, output_data[15]);
+    // Id 3, three data bytes
+    EXPECT_EQ((3 << 4) | 0x02, output_data[16]);
+
+    // The stamped time is 6.18 fixed point seconds wrapping every 64s;
+    // it has to land within a modest window before "now".
+    std::uint32_t wire_time = 0;
+    wire_time |= (output_data[17] << 16);
+    wire_time |= (output_data[18] << 8);
+    wire_time |= (output_data[19] << 0);
+
+    const auto now_us = ac::Utils::GetNowUs() % 64000000ull;
+    const auto now_6_18 = static_cast<uint32_t>((now_us << 18) / 1000000ull);
+
+    // 100ms expressed in 6.18 units, generous enough for a loaded CI box
+    const uint32_t tolerance = (100 << 18) / 1000;
+    EXPECT_LT((now_6_18 - wire_time) & 0xffffff, tolerance);
+
+    delete[] output_data;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>
+
+#include <gmock/gmock.h>
+
+#include <ac/streaming/mpegtspacketizer.h>
+#include <ac/streaming/tsanalyzer.h>
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::size_t kTSPacketSize{188};
+static constexpr ac::TimestampUs kFrameIntervalUs{33000ll};
+
+static const uint8_t kSliceHeader[] = {
+    0x00, 0x00, 0x00, 0x01, 0x05, 0x88, 0x84, 0x21, 0xa0,
+};
+
+class MockPacketizerReport : public ac::video::PacketizerReport {
+public:
+    MOCK_METHOD2(PacketizedFrame, void(const ac::TimestampUs&, const ac::FrameId&));
+};
+
+ac::video::Buffer::Ptr CreateFrame(int size, const ac::TimestampUs &timestamp) {
+    auto buffer = ac::video::Buffer::Create(size + sizeof(kSliceHeader), timestamp);
+    ::memcpy(buffer->Data(), kSliceHeader, sizeof(kSliceHeader));
+    return buffer;
+}
+
+// Runs a few frames through the real mux the way MediaSender would:
+// tables and PCR on the first frame and then again once the cadence
+// deadline passes.
+void FeedMuxOutput(ac::streaming::TSAnalyzer &analyzer, unsigned int frames,
+                   const ac::TimestampUs &start_us,
+                   ac::video::Buffer::Ptr *corrupt_me = nullptr) {
+    auto report = std::make_shared<NiceMock<MockPacketizerReport>>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    const auto video_id = packetizer->AddTrack(
+                ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+    ASSERT_EQ(0, video_id);
+
+    ac::TimestampUs last_tables_us = -1;
+    for (unsigned int n = 0; n < frames; n++) {
+        const auto now = start_us + n * kFrameIntervalUs;
+
+        int flags = 0;
+        if (last_tables_us < 0 || last_tables_us + 100000ll <= now) {
+            flags |= ac::streaming::Packetizer::kEmitPATandPMT;
+            flags |= ac::streaming::Packetizer::kEmitPCR;
+            last_tables_us = now;
+        }
+
+        ac::video::Buffer::Ptr out;
+        auto frame = CreateFrame(4000, now);
+        ASSERT_TRUE(packetizer->Packetize(video_id, frame, &out, flags));
+
+        if (corrupt_me && *corrupt_me == nullptr && n == frames / 2) {
+            *corrupt_me = out;
+            return;
+        }
+
+        analyzer.Process(out->Data(), out->Length(), now);
+    }
+}
+}
+
+TEST(TSAnalyzer, CleanMuxOutputPasses) {
+    ac::streaming::TSAnalyzer analyzer;
+
+    FeedMuxOutput(analyzer, 30, 0ll);
+
+    const auto &stats = analyzer.Stats();
+    EXPECT_GT(stats.packets, 0u);
+    EXPECT_GT(stats.pat_count, 1u);
+    EXPECT_GT(stats.pmt_count, 1u);
+    EXPECT_GT(stats.pcr_count, 1u);
+    EXPECT_TRUE(stats.Clean());
+}
+
+TEST(TSAnalyzer, DetectsContinuityCounterBreak) {
+    ac::streaming::TSAnalyzer analyzer;
+
+    ac::video::Buffer::Ptr victim;
+    FeedMuxOutput(analyzer, 30, 0ll, &victim);
+    ASSERT_NE(nullptr, victim.get());
+    ASSERT_GE(victim->Length(), 2 * kTSPacketSize);
+
+    // Dropping a whole mux packet from the middle of the buffer is
+    // exactly what a broken continuity counter looks like on the wire
+    ::memmove(victim->Data(), victim->Data() + kTSPacketSize,
+              victim->Length() - kTSPacketSize);
+    analyzer.Process(victim->Data(), victim->Length() - kTSPacketSize,
+                     15 * kFrameIntervalUs);
+
+    EXPECT_GT(analyzer.Stats().continuity_errors, 0u);
+}
+
+TEST(TSAnalyzer, SignalledTransportLossIsNotAMuxError) {
+    ac::streaming::TSAnalyzer analyzer;
+
+    ac::video::Buffer::Ptr victim;
+    FeedMuxOutput(analyzer, 30, 0ll, &victim);
+    ASSERT_NE(nullptr, victim.get());
+
+    // The same gap with the transport owning up to the loss leaves
+    // the mux gates untouched
+    analyzer.SignalLoss();
+    analyzer.Process(victim->Data() + kTSPacketSize,
+                     victim->Length() - kTSPacketSize, 15 * kFrameIntervalUs);
+
+    EXPECT_EQ(0u, analyzer.Stats().continuity_errors);
+}
+
+TEST(TSAnalyzer, DetectsStalledTableCadence) {
+    ac::streaming::TSAnalyzer analyzer;
+
+    // Two bursts of well-formed output with a silent half second in
+    // between; the tables and the PCR all miss their deadline.
+    FeedMuxOutput(analyzer, 5, 0ll);
+    FeedMuxOutput(analyzer, 5, 500000ll);
+
+    const auto &stats = analyzer.Stats();
+    EXPECT_GT(stats.pat_interval_violations, 0u);
+    EXPECT_GT(stats.pmt_interval_violations, 0u);
+    EXPECT_GT(stats.pcr_interval_violations, 0u);
+    EXPECT_EQ(0u, stats.sync_errors);
+}
+
+TEST(TSAnalyzer, DetectsBrokenFraming) {
+    ac::streaming::TSAnalyzer analyzer;
+
+    std::uint8_t garbage[kTSPacketSize + 7];
+    ::memset(garbage, 0xaa, sizeof(garbage));
+
+    analyzer.Process(garbage, sizeof(garbage), 0ll);
+
+    // One bad sync byte plus one ragged tail
+    EXPECT_EQ(2u, analyzer.Stats().sync_errors);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "ac/utils.h"
+
+namespace {
+// Straightforward bit-by-bit MPEG-2 CRC32 as reference
+uint32_t ReferenceCrcMpeg2(const uint8_t *data, size_t size) {
+    uint32_t crc = 0xffffffff;
+
+    for (size_t n = 0; n < size; n++) {
+        crc ^= data[n] << 24;
+        for (unsigned int bit = 0; bit < 8; bit++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04C11DB7 : 0);
+    }
+
+    return crc;
+}
+}
+
+TEST(Utils, CrcMpeg2MatchesKnownCheckValue) {
+    // Check value for CRC-32/MPEG-2 from the usual catalogues
+    const uint8_t input[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    EXPECT_EQ(0x0376e6e7u, ac::Utils::CrcMpeg2(input, sizeof(input)));
+}
+
+TEST(Utils, CrcMpeg2OfNothingIsInitialValue) {
+    EXPECT_EQ(0xffffffffu, ac::Utils::CrcMpeg2(nullptr, 0));
+}
+
+TEST(Utils, CrcMpeg2MatchesReferenceForAllAlignments) {
+    // Cover sizes around the eight byte fast-path boundary so both
+    // the sliced and the tail loop get exercised.
+    uint8_t data[64];
+    for (unsigned int n = 0; n < sizeof(data); n++)
+        data[n] = (n * 131) & 0xff;
+
+    for (size_t size = 1; size <= sizeof(data); size++)
+        EXPECT_EQ(ReferenceCrcMpeg2(data, size), ac::Utils::CrcMpeg2(data, size))
+                << "for size " << size;
+}
@@ -78,6 +78,25 @@ TEST(Buffer, ConstructWithNativeHandle) {
     EXPECT_TRUE(buffer->IsValid());
 }
 
+TEST(Buffer, SmallBuffersUseInlineStorage) {
+    auto buffer = Buffer::Create(Buffer::kInlineCapacity);
+
+    // Data has to live inside the object itself, not in a separate
+    // allocation
+    const auto start = reinterpret_cast<uintptr_t>(buffer.get());
+    const auto data = reinterpret_cast<uintptr_t>(buffer->Data());
+    EXPECT_GE(data, start);
+    EXPECT_LT(data, start + sizeof(Buffer));
+}
+
+TEST(Buffer, LargeBuffersUseSeparateStorage) {
+    auto buffer = Buffer::Create(Buffer::kInlineCapacity + 1);
+
+    const auto start = reinterpret_cast<uintptr_t>(buffer.get());
+    const auto data = reinterpret_cast<uintptr_t>(buffer->Data());
+    EXPECT_TRUE(data < start || data >= start + sizeof(Buffer));
+}
+
 TEST(Buffer, DelegateCalledOnRelease) {
     auto buffer = Buffer::Create(nullptr);
 
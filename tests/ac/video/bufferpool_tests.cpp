@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <ac/utils.h>
+
+#include <ac/video/bufferpool.h>
+
+using namespace ac::video;
+
+TEST(BufferPool, AcquireBehavesLikeCreate) {
+    uint32_t capacity = 10;
+    auto now = ac::Utils::GetNowUs();
+    auto pool = BufferPool::Create();
+
+    auto buffer = pool->Acquire(capacity, now);
+
+    EXPECT_EQ(now, buffer->Timestamp());
+    EXPECT_NE(nullptr, buffer->Data());
+    EXPECT_EQ(capacity, buffer->Length());
+    EXPECT_EQ(capacity, buffer->Capacity());
+    EXPECT_EQ(0, buffer->Data()[0]);
+    EXPECT_EQ(0, buffer->Offset());
+    EXPECT_TRUE(buffer->IsValid());
+}
+
+TEST(BufferPool, StorageIsRecycled) {
+    auto pool = BufferPool::Create();
+
+    auto buffer = pool->Acquire(12);
+    const auto data = buffer->Data();
+    buffer->Data()[0] = 0xff;
+    buffer.reset();
+
+    // Same size class so the freshly released array must come back,
+    // zeroed out again like a newly created buffer.
+    buffer = pool->Acquire(12);
+    EXPECT_EQ(data, buffer->Data());
+    EXPECT_EQ(0, buffer->Data()[0]);
+}
+
+TEST(BufferPool, SizeClassesDontMix) {
+    auto pool = BufferPool::Create();
+
+    auto buffer = pool->Acquire(12);
+    const auto data = buffer->Data();
+    buffer.reset();
+
+    buffer = pool->Acquire(1000);
+    EXPECT_NE(data, buffer->Data());
+}
+
+TEST(BufferPool, BuffersOutliveThePool) {
+    auto pool = BufferPool::Create();
+
+    auto buffer = pool->Acquire(12);
+    pool.reset();
+
+    // With the pool gone the storage is simply freed on release
+    EXPECT_NE(nullptr, buffer->Data());
+    buffer->Data()[0] = 0xff;
+    buffer.reset();
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include "ac/video/bufferqueue.h"
+
+using namespace ::testing;
+
+namespace {
+class MockBufferQueueReport : public ac::video::BufferQueueReport {
+public:
+    MOCK_METHOD2(HighWaterMark, void(const std::string&, int));
+    MOCK_METHOD2(Stalled, void(const std::string&, const ac::TimestampUs&));
+    MOCK_METHOD1(DroppedBuffer, void(const std::string&));
+};
+}
+
+TEST(BufferQueue, ReportsNewHighWaterMarksOnly) {
+    auto report = std::make_shared<MockBufferQueueReport>();
+    auto queue = ac::video::BufferQueue::Create();
+    queue->SetReport("test", report);
+
+    EXPECT_CALL(*report, HighWaterMark("test", 1)).Times(1);
+    EXPECT_CALL(*report, HighWaterMark("test", 2)).Times(1);
+
+    queue->Push(ac::video::Buffer::Create(1));
+    queue->Push(ac::video::Buffer::Create(1));
+
+    // Draining and refilling to the same depth is not a new maximum
+    queue->PopAll();
+    queue->Push(ac::video::Buffer::Create(1));
+    queue->Push(ac::video::Buffer::Create(1));
+}
+
+TEST(BufferQueue, ReportsDroppedBuffersWhenFull) {
+    auto report = std::make_shared<MockBufferQueueReport>();
+    auto queue = ac::video::BufferQueue::Create(1);
+    queue->SetReport("test", report);
+
+    EXPECT_CALL(*report, HighWaterMark("test", 1)).Times(1);
+    EXPECT_CALL(*report, DroppedBuffer("test")).Times(2);
+
+    queue->Push(ac::video::Buffer::Create(1));
+    queue->Push(ac::video::Buffer::Create(1));
+    queue->PushAll({ac::video::Buffer::Create(1)});
+}
+
+TEST(BufferQueue, ReportsConsumerStalls) {
+    auto report = std::make_shared<MockBufferQueueReport>();
+    auto queue = ac::video::BufferQueue::Create();
+    queue->SetReport("test", report);
+
+    EXPECT_CALL(*report, Stalled("test", Ge(0ll))).Times(1);
+
+    EXPECT_FALSE(queue->WaitToBeFilled(std::chrono::milliseconds{1}));
+}
+
+TEST(BufferQueue, RemoveOldestTakesTheHead) {
+    auto queue = ac::video::BufferQueue::Create(2);
+
+    auto first = ac::video::Buffer::Create(1);
+    auto second = ac::video::Buffer::Create(1);
+
+    queue->Push(first);
+    queue->Push(second);
+
+    EXPECT_EQ(first, queue->RemoveOldest());
+    EXPECT_EQ(1, queue->Size());
+    EXPECT_EQ(second, queue->RemoveOldest());
+
+    // Unlike Pop() an empty queue is fine and yields nothing
+    EXPECT_EQ(nullptr, queue->RemoveOldest());
+}
+
+TEST(BufferQueue, SPSCVariantReportsDropsAndStalls) {
+    auto report = std::make_shared<MockBufferQueueReport>();
+    auto queue = ac::video::BufferQueue::CreateSPSC(1);
+    queue->SetReport("test", report);
+
+    EXPECT_CALL(*report, HighWaterMark("test", 1)).Times(1);
+    EXPECT_CALL(*report, DroppedBuffer("test")).Times(1);
+    EXPECT_CALL(*report, Stalled("test", Ge(0ll))).Times(1);
+
+    queue->Push(ac::video::Buffer::Create(1));
+    queue->Push(ac::video::Buffer::Create(1));
+
+    EXPECT_FALSE(queue->WaitForSlots(std::chrono::milliseconds{1}));
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ac/video/damagetracker.h>
+
+namespace {
+constexpr unsigned int kWidth{256};
+constexpr unsigned int kHeight{128};
+constexpr unsigned int kBytesPerPixel{4};
+
+std::vector<uint8_t> MakeFrame(uint8_t fill) {
+    return std::vector<uint8_t>(kWidth * kHeight * kBytesPerPixel, fill);
+}
+
+bool Update(ac::video::DamageTracker &tracker, const std::vector<uint8_t> &frame) {
+    return tracker.Update(frame.data(), kWidth, kHeight,
+                          kWidth * kBytesPerPixel, kBytesPerPixel);
+}
+}
+
+TEST(DamageTracker, FirstFrameIsFullyDamaged) {
+    ac::video::DamageTracker tracker;
+
+    const auto frame = MakeFrame(0x10);
+    EXPECT_TRUE(Update(tracker, frame));
+
+    const auto region = tracker.LastDamageRegion();
+    EXPECT_EQ(0u, region.x);
+    EXPECT_EQ(0u, region.y);
+    EXPECT_EQ(kWidth, region.width);
+    EXPECT_EQ(kHeight, region.height);
+}
+
+TEST(DamageTracker, UnchangedFrameReportsNoDamage) {
+    ac::video::DamageTracker tracker;
+
+    const auto frame = MakeFrame(0x10);
+    Update(tracker, frame);
+
+    EXPECT_FALSE(Update(tracker, frame));
+    EXPECT_TRUE(tracker.LastDamageRegion().Empty());
+}
+
+TEST(DamageTracker, LocalChangeYieldsConfinedRegion) {
+    ac::video::DamageTracker tracker;
+
+    auto frame = MakeFrame(0x10);
+    Update(tracker, frame);
+
+    // Flip a block near the top-left corner on positions the sparse
+    // sampling is guaranteed to visit (row step 8, column step 64)
+    for (unsigned int y = 0; y < 16; y += 8)
+        for (unsigned int x = 0; x < 256; x += 64)
+            frame[y * kWidth * kBytesPerPixel + x] = 0xff;
+
+    EXPECT_TRUE(Update(tracker, frame));
+
+    const auto region = tracker.LastDamageRegion();
+    EXPECT_FALSE(region.Empty());
+
+    // The bounding box has to cover the change ...
+    EXPECT_EQ(0u, region.x);
+    EXPECT_EQ(0u, region.y);
+    EXPECT_GE(region.width, 256u / kBytesPerPixel);
+    EXPECT_GE(region.height, 16u);
+
+    // ... but stay well away from whole-frame: the change sits in the
+    // top rows so the region must not span all row bands.
+    EXPECT_LT(region.height, kHeight);
+}
@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ac/common/threadedexecutor.h"
+#include "ac/report/null/encoderreport.h"
+
+#include "ac/android/h264encoder.h"
+#include "ac/gst/h264decoder.h"
+#include "ac/gst/h264encoder.h"
+#include "ac/v4l2/h264encoder.h"
+#include "ac/vaapi/h264encoder.h"
+
+#include "ac/video/qualitymetrics.h"
+
+#include "tests/common/benchmark.h"
+
+namespace {
+// A 720p30 session at our default bitrate; small enough that even a
+// software fallback backend finishes the corpus in a few seconds.
+static constexpr unsigned int kWidth{1280};
+static constexpr unsigned int kHeight{720};
+static constexpr int kFramerate{30};
+static constexpr unsigned int kBitrate{5000000};
+static constexpr unsigned int kFrameCount{120};
+static constexpr std::chrono::seconds kOutputTimeout{2};
+// Every Nth source frame is retained and its decoded counterpart
+// scored for PSNR/SSIM; sampling keeps both the memory for retained
+// raw frames and the decode pass small against the encode run itself.
+static constexpr unsigned int kQualitySampleInterval{8};
+
+// Collects everything a backend emits; frames are matched back to
+// their submission by timestamp since some backends deliver codec
+// config as an extra buffer.
+class CollectingDelegate : public ac::video::BaseEncoder::Delegate {
+public:
+    typedef std::shared_ptr<CollectingDelegate> Ptr;
+
+    void OnBufferAvailable(const ac::video::Buffer::Ptr &buffer) override {
+        std::unique_lock<std::mutex> l(mutex_);
+        total_bytes_ += buffer->Length();
+        arrivals_.push_back({buffer->Timestamp(), std::chrono::steady_clock::now()});
+        stream_.push_back(buffer);
+        delivered_++;
+        wait_.notify_all();
+    }
+
+    void OnBufferWithCodecConfig(const ac::video::Buffer::Ptr &buffer) override {
+        // Parameter sets ride in front of the frame they belong to;
+        // they count towards the stream and the quality decode pass
+        // needs them, but they are not an arrival of their own
+        std::unique_lock<std::mutex> l(mutex_);
+        stream_.push_back(buffer);
+    }
+
+    bool WaitForDelivery(unsigned int count) {
+        std::unique_lock<std::mutex> l(mutex_);
+        return wait_.wait_for(l, kOutputTimeout,
+                              [&]() { return delivered_ >= count; });
+    }
+
+    struct Arrival {
+        ac::TimestampUs timestamp;
+        std::chrono::steady_clock::time_point when;
+    };
+
+    std::vector<Arrival> Arrivals() {
+        std::unique_lock<std::mutex> l(mutex_);
+        return arrivals_;
+    }
+
+    // Everything the backend emitted in arrival order, codec config
+    // included: exactly what a decoder needs to replay the stream.
+    std::vector<ac::video::Buffer::Ptr> Stream() {
+        std::unique_lock<std::mutex> l(mutex_);
+        return stream_;
+    }
+
+    size_t TotalBytes() {
+        std::unique_lock<std::mutex> l(mutex_);
+        return total_bytes_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wait_;
+    std::vector<Arrival> arrivals_;
+    std::vector<ac::video::Buffer::Ptr> stream_;
+    size_t total_bytes_{0};
+    unsigned int delivered_{0};
+};
+
+ac::video::Buffer::Ptr CreateRawFrame(unsigned int index) {
+    auto buffer = ac::video::Buffer::Create(kWidth * kHeight * 4);
+    uint8_t *data = buffer->Data();
+
+    // Deterministic pseudo random pixels; every backend sees the exact
+    // same corpus so the numbers stay comparable across runs.
+    unsigned int seed = 1 + index;
+    for (unsigned int n = 0; n < kWidth * kHeight * 4; n++) {
+        seed = seed * 1103515245 + 12345;
+        data[n] = (seed >> 16) & 0xff;
+    }
+
+    // 30 fps capture cadence
+    buffer->SetTimestamp(index * 33333ll);
+
+    return buffer;
+}
+
+// Quality scores as a statistics.h sample so they can ride the same
+// machinery as the timing figures - saved runs compare via the t-test
+// helpers instead of eyeballing two console lines.
+class QualitySample : public ac::testing::Sample {
+public:
+    void Add(double observation) {
+        observations_.push_back(observation);
+    }
+
+    SizeType get_size() const override {
+        return observations_.size();
+    }
+
+    ValueType get_mean() const override {
+        double sum = 0.;
+        for (const auto &observation : observations_)
+            sum += observation;
+        return observations_.empty() ? 0. : sum / observations_.size();
+    }
+
+    ValueType get_variance() const override {
+        const auto mean = get_mean();
+        double squares = 0.;
+        for (const auto &observation : observations_)
+            squares += (observation - mean) * (observation - mean);
+        return observations_.empty() ? 0. : squares / observations_.size();
+    }
+
+    void enumerate(const Enumerator& enumerator) const override {
+        for (const auto &observation : observations_)
+            enumerator(observation);
+    }
+
+    ValueType get_min() const {
+        return observations_.empty() ? 0.
+            : *std::min_element(observations_.begin(), observations_.end());
+    }
+
+private:
+    std::vector<double> observations_;
+};
+
+// Decodes the collected stream and scores every decoded frame we
+// retained the source for. Timestamps survive the decoder, so frames
+// match up even when a backend reorders or drops some.
+void ScoreQuality(const std::string &name,
+                  const std::map<ac::TimestampUs, ac::video::Buffer::Ptr> &retained,
+                  const std::vector<ac::video::Buffer::Ptr> &stream,
+                  double measured_bitrate) {
+    const auto decoder = ac::gst::H264Decoder::Create();
+    if (!decoder) {
+        std::cout << name << ": no H.264 decoder available; skipping quality scores" << std::endl;
+        return;
+    }
+
+    QualitySample psnr;
+    QualitySample ssim;
+
+    for (const auto &frame : decoder->DecodeAll(stream)) {
+        const auto source = retained.find(frame->Timestamp());
+        if (source == retained.end())
+            continue;
+        if (frame->Length() < source->second->Length())
+            continue;
+
+        const auto score = ac::video::CompareFrames(
+            source->second->Data(), frame->Data(), kWidth, kHeight);
+        psnr.Add(score.psnr);
+        ssim.Add(score.ssim);
+    }
+
+    if (psnr.get_size() == 0) {
+        // Backends that rewrite timestamps leave nothing to match;
+        // better no score than a score against the wrong source frame
+        std::cout << name << ": no decoded frames matched a retained source; skipping quality scores" << std::endl;
+        return;
+    }
+
+    std::cout << name << ": "
+              << "quality over " << psnr.get_size() << " sampled frames"
+              << " psnr mean " << psnr.get_mean() << "dB"
+              << " min " << psnr.get_min() << "dB"
+              << " stddev " << std::sqrt(psnr.get_variance()) << "dB"
+              << " ssim mean " << ssim.get_mean()
+              << " (" << psnr.get_mean() / (measured_bitrate / 1000000.)
+              << "dB per Mbit/s)"
+              << std::endl;
+}
+
+struct Backend {
+    std::string name;
+    std::function<ac::video::BaseEncoder::Ptr(const ac::video::EncoderReport::Ptr&)> create;
+};
+
+void Run(const Backend &backend) {
+    const auto report = std::make_shared<ac::report::null::EncoderReport>();
+
+    ac::video::BaseEncoder::Ptr encoder;
+    try {
+        encoder = backend.create(report);
+    } catch (...) {
+        encoder = nullptr;
+    }
+
+    if (!encoder) {
+        std::cout << backend.name << ": not available on this machine" << std::endl;
+        return;
+    }
+
+    auto config = encoder->DefaultConfiguration();
+    config.width = kWidth;
+    config.height = kHeight;
+    config.framerate = kFramerate;
+    config.bitrate = kBitrate;
+
+    if (!encoder->Configure(config)) {
+        std::cout << backend.name << ": not available on this machine" << std::endl;
+        return;
+    }
+
+    const auto delegate = std::make_shared<CollectingDelegate>();
+    encoder->SetDelegate(delegate);
+
+    ac::common::ThreadedExecutor executor(encoder);
+    if (!executor.Start()) {
+        std::cout << backend.name << ": failed to start" << std::endl;
+        return;
+    }
+
+    struct rusage usage_before;
+    ::getrusage(RUSAGE_SELF, &usage_before);
+
+    // One frame in flight at a time: the arrival delta then really is
+    // the per-frame encode latency and not queueing delay.
+    std::map<ac::TimestampUs, std::chrono::steady_clock::time_point> submissions;
+    std::map<ac::TimestampUs, ac::video::Buffer::Ptr> retained;
+    unsigned int delivered = 0;
+
+    const auto started = std::chrono::steady_clock::now();
+
+    for (unsigned int n = 0; n < kFrameCount; n++) {
+        const auto frame = CreateRawFrame(n);
+        submissions[frame->Timestamp()] = std::chrono::steady_clock::now();
+        // Sampled sources for the quality pass after the run
+        if (n % kQualitySampleInterval == 0)
+            retained[frame->Timestamp()] = frame;
+        encoder->QueueBuffer(frame);
+
+        if (!delegate->WaitForDelivery(++delivered)) {
+            // Encoders are allowed to hold a few frames of lookahead;
+            // only a completely silent backend is treated as broken
+            if (delivered > 4 && delegate->Arrivals().empty()) {
+                std::cout << backend.name << ": produced no output; skipping" << std::endl;
+                executor.Stop();
+                encoder->Stop();
+                return;
+            }
+            delivered--;
+        }
+    }
+
+    // Give the pipeline a moment to flush what is still in flight
+    delegate->WaitForDelivery(kFrameCount);
+
+    const auto stopped = std::chrono::steady_clock::now();
+
+    struct rusage usage_after;
+    ::getrusage(RUSAGE_SELF, &usage_after);
+
+    executor.Stop();
+    encoder->Stop();
+
+    ac::testing::Benchmark::Result result;
+
+    for (const auto &arrival : delegate->Arrivals()) {
+        const auto submission = submissions.find(arrival.timestamp);
+        // Buffers we can't match (rewritten timestamps, separate codec
+        // config) still count towards the bitrate but not the latency
+        if (submission == submissions.end())
+            continue;
+
+        result.timing.sample.push_back(
+            std::chrono::duration_cast<ac::testing::Benchmark::Result::Timing::Seconds>(
+                arrival.when - submission->second));
+    }
+
+    result.sample_size = result.timing.sample.size();
+
+    if (result.sample_size == 0) {
+        std::cout << backend.name << ": produced no output; skipping" << std::endl;
+        return;
+    }
+
+    const auto minmax = std::minmax_element(
+        result.timing.sample.begin(), result.timing.sample.end());
+    result.timing.min = *minmax.first;
+    result.timing.max = *minmax.second;
+
+    double sum = 0.;
+    for (const auto &observation : result.timing.sample)
+        sum += observation.count();
+    const double mean = sum / result.sample_size;
+    result.timing.mean = ac::testing::Benchmark::Result::Timing::Seconds{mean};
+
+    double squares = 0.;
+    for (const auto &observation : result.timing.sample)
+        squares += (observation.count() - mean) * (observation.count() - mean);
+    result.timing.std_dev = ac::testing::Benchmark::Result::Timing::Seconds{
+        std::sqrt(squares / result.sample_size)};
+
+    const double wall_seconds =
+        std::chrono::duration<double>(stopped - started).count();
+    const double measured_bitrate =
+        delegate->TotalBytes() * 8. / (static_cast<double>(kFrameCount) / kFramerate);
+
+    const auto CpuSeconds = [](const struct timeval &tv) {
+        return tv.tv_sec + tv.tv_usec / 1000000.;
+    };
+    const double cpu_seconds =
+        (CpuSeconds(usage_after.ru_utime) - CpuSeconds(usage_before.ru_utime))
+        + (CpuSeconds(usage_after.ru_stime) - CpuSeconds(usage_before.ru_stime));
+
+    std::cout << backend.name << ": "
+              << "frames " << result.sample_size << "/" << kFrameCount
+              << " latency mean " << result.timing.mean.count() * 1000. << "ms"
+              << " min " << result.timing.min.count() * 1000. << "ms"
+              << " max " << result.timing.max.count() * 1000. << "ms"
+              << " stddev " << result.timing.std_dev.count() * 1000. << "ms"
+              << " bitrate " << measured_bitrate / 1000000. << "Mbit/s"
+              << " (target " << kBitrate / 1000000. << ")"
+              << " cpu " << cpu_seconds << "s"
+              << " of " << wall_seconds << "s wall"
+              << std::endl;
+
+    // The quality decode pass runs after the timing window so it
+    // cannot disturb the latency and CPU figures above.
+    ScoreQuality(backend.name, retained, delegate->Stream(), measured_bitrate);
+}
+}
+
+int main(int, char**) {
+    // Every shipped backend gets a try; the ones whose hardware or
+    // plugins are missing on this machine report themselves as
+    // unavailable instead of failing the run.
+    const Backend backends[] = {
+        {"android", [](const ac::video::EncoderReport::Ptr &report) {
+            return ac::android::H264Encoder::Create(report, true);
+        }},
+        {"gst", [](const ac::video::EncoderReport::Ptr &report) {
+            return ac::gst::H264Encoder::Create(report);
+        }},
+        {"v4l2", [](const ac::video::EncoderReport::Ptr &report) {
+            return ac::v4l2::H264Encoder::Create(report);
+        }},
+        {"vaapi", [](const ac::video::EncoderReport::Ptr &report) {
+            return ac::vaapi::H264Encoder::Create(report);
+        }},
+    };
+
+    for (const auto &backend : backends)
+        Run(backend);
+
+    return 0;
+}
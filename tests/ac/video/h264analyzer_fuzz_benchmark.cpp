@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "ac/utils.h"
+#include "ac/video/h264analyzer.h"
+#include "ac/video/utils.h"
+
+namespace {
+constexpr const char *kCorpusDirEnvName{"AETHERCAST_FUZZ_CORPUS_DIR"};
+constexpr const char *kIterationsEnvName{"AETHERCAST_FUZZ_ITERATIONS"};
+constexpr unsigned int kDefaultIterations{50000};
+// An input which takes this much longer per byte than the corpus
+// baseline is reported as a CPU spike; that is the malformed-stream
+// failure mode we have seen from vendor codecs in the field. The
+// fixed allowance covers per-call overhead which dominates for the
+// tiny degenerate inputs.
+constexpr double kSpikeFactor{50.0};
+constexpr std::int64_t kSpikeOverheadNs{100 * 1000};
+constexpr std::size_t kBenchmarkRounds{200};
+
+// Synthetic access units shaped like real encoder output, including
+// emulation prevention bytes and trailing start-code edge cases.
+// Recorded streams dropped into AETHERCAST_FUZZ_CORPUS_DIR (one
+// access unit per file) are added on top of these.
+std::vector<std::vector<std::uint8_t>> SeedCorpus() {
+    std::vector<std::vector<std::uint8_t>> corpus;
+
+    // SPS + PPS + IDR, the layout every session starts with
+    corpus.push_back({
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x0a, 0xf8, 0x41, 0xa2,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x38, 0x80,
+        0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x21, 0xa0
+    });
+
+    // Plain P frame with a three-byte start code
+    corpus.push_back({ 0x00, 0x00, 0x01, 0x41, 0xe0, 0x20, 0x42 });
+
+    // Slice data containing an emulation prevention byte sequence
+    corpus.push_back({
+        0x00, 0x00, 0x00, 0x01, 0x41, 0xe0, 0x00, 0x00, 0x03, 0x01, 0x42
+    });
+
+    // Degenerate inputs the parser has to survive: bare start codes,
+    // a truncated NAL header, trailing zeros
+    corpus.push_back({ 0x00, 0x00, 0x00, 0x01 });
+    corpus.push_back({ 0x00, 0x00, 0x01 });
+    corpus.push_back({ 0x00, 0x00, 0x00, 0x01, 0x65 });
+    corpus.push_back({ 0x00, 0x00, 0x00, 0x01, 0x41, 0xe0, 0x00, 0x00, 0x00 });
+
+    // A bigger IDR so the throughput numbers aren't dominated by
+    // per-call overhead
+    std::vector<std::uint8_t> large{0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84};
+    std::mt19937 generator(1234);
+    for (unsigned int n = 0; n < 64 * 1024; n++)
+        large.push_back(static_cast<std::uint8_t>(generator() & 0xff));
+    corpus.push_back(large);
+
+    const auto corpus_dir = ac::Utils::GetEnvValue(kCorpusDirEnvName);
+    if (!corpus_dir.empty()) {
+        for (boost::filesystem::directory_iterator it(corpus_dir), end; it != end; ++it) {
+            std::ifstream file(it->path().string(), std::ios::binary);
+            corpus.push_back(std::vector<std::uint8_t>(
+                std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>()));
+        }
+    }
+
+    return corpus;
+}
+
+// libFuzzer-style structure-unaware mutations plus a couple which
+// know about start codes, since those drive the parser's state.
+std::vector<std::uint8_t> Mutate(const std::vector<std::uint8_t> &input, std::mt19937 &generator) {
+    auto data = input;
+    if (data.empty())
+        data.push_back(0x00);
+
+    switch (generator() % 6) {
+    case 0: // Flip a bit
+        data[generator() % data.size()] ^= 1 << (generator() % 8);
+        break;
+    case 1: // Overwrite a byte
+        data[generator() % data.size()] = static_cast<std::uint8_t>(generator() & 0xff);
+        break;
+    case 2: // Truncate
+        data.resize(1 + generator() % data.size());
+        break;
+    case 3: // Duplicate a chunk
+        {
+            const auto offset = generator() % data.size();
+            const auto length = std::min<std::size_t>(
+                1 + generator() % 32, data.size() - offset);
+            data.insert(data.begin() + offset,
+                        data.begin() + offset, data.begin() + offset + length);
+        }
+        break;
+    case 4: // Inject a start code at a random offset
+        {
+            static const std::uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+            const auto offset = generator() % data.size();
+            data.insert(data.begin() + offset, start_code, start_code + sizeof(start_code));
+        }
+        break;
+    case 5: // Zero-run, which interacts with start code scanning
+        {
+            const auto offset = generator() % data.size();
+            const auto length = std::min<std::size_t>(
+                1 + generator() % 64, data.size() - offset);
+            std::memset(data.data() + offset, 0x00, length);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return data;
+}
+
+// Runs every parser entry point which sees untrusted encoder output
+// over one input. Returns the consumed checksum so the compiler can't
+// drop the work.
+std::uint64_t Exercise(ac::video::H264Analyzer &analyzer, const std::vector<std::uint8_t> &data) {
+    std::uint64_t checksum = 0;
+
+    const auto result = analyzer.Process(data.data(), data.size());
+    checksum += result.units + result.slices + result.idr_frames;
+
+    const auto classification = analyzer.Classify(data.data(), data.size());
+    checksum += static_cast<std::uint64_t>(classification.frame_type);
+
+    const std::uint8_t *nal_data = data.data();
+    std::size_t nal_size = data.size();
+    const std::uint8_t *nal_start = nullptr;
+    std::size_t nal_length = 0;
+    while (ac::video::GetNextNALUnit(&nal_data, &nal_size, &nal_start, &nal_length, true))
+        checksum += nal_length;
+
+    return checksum;
+}
+
+int RunFuzzer(const std::vector<std::vector<std::uint8_t>> &corpus, unsigned int iterations) {
+    std::mt19937 generator(std::random_device{}());
+    ac::video::H264Analyzer analyzer;
+
+    // Establish what "normal" cost per byte looks like from the
+    // unmutated corpus so CPU spikes on mutated input stand out.
+    double baseline_ns_per_byte = 0.0;
+    std::size_t baseline_bytes = 0;
+    const auto baseline_start = std::chrono::steady_clock::now();
+    for (const auto &input : corpus) {
+        Exercise(analyzer, input);
+        baseline_bytes += input.size();
+    }
+    baseline_ns_per_byte = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - baseline_start).count() /
+        static_cast<double>(baseline_bytes);
+
+    unsigned int spikes = 0;
+    std::uint64_t checksum = 0;
+
+    for (unsigned int n = 0; n < iterations; n++) {
+        auto input = Mutate(corpus[generator() % corpus.size()], generator);
+        // Stack a few rounds of mutation on some inputs
+        while (generator() % 4 == 0)
+            input = Mutate(input, generator);
+
+        auto start = std::chrono::steady_clock::now();
+        checksum += Exercise(analyzer, input);
+        auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        const auto budget_ns = kSpikeOverheadNs +
+            static_cast<std::int64_t>(baseline_ns_per_byte * kSpikeFactor * input.size());
+
+        // Re-measure before crying wolf; a single slow run is usually
+        // just the scheduler
+        if (elapsed_ns > budget_ns) {
+            start = std::chrono::steady_clock::now();
+            checksum += Exercise(analyzer, input);
+            elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+
+        if (elapsed_ns > budget_ns) {
+            spikes++;
+            const auto path = ac::Utils::Sprintf("/tmp/aethercast-fuzz-spike-%d.bin", spikes);
+            std::ofstream file(path, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(input.data()), input.size());
+            std::cout << "CPU spike (" << elapsed_ns / 1000 << "us for "
+                      << input.size() << " bytes) saved to " << path << std::endl;
+        }
+    }
+
+    std::cout << "fuzz: " << iterations << " iterations, "
+              << spikes << " CPU spikes, checksum " << checksum << std::endl;
+
+    return spikes == 0 ? 0 : 1;
+}
+
+void RunBenchmark(const std::vector<std::vector<std::uint8_t>> &corpus) {
+    ac::video::H264Analyzer analyzer;
+
+    std::size_t corpus_bytes = 0;
+    for (const auto &input : corpus)
+        corpus_bytes += input.size();
+
+    std::uint64_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t round = 0; round < kBenchmarkRounds; round++) {
+        for (const auto &input : corpus)
+            checksum += Exercise(analyzer, input);
+    }
+    const auto seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count() / (1000. * 1000. * 1000.);
+
+    const auto total_bytes = corpus_bytes * kBenchmarkRounds;
+    std::cout << "benchmark: " << (total_bytes / (1024. * 1024.)) / seconds
+              << " MB/s over " << corpus.size() << " corpus entries"
+              << " (checksum " << checksum << ")" << std::endl;
+}
+}
+
+int main(int, char**) {
+    const auto corpus = SeedCorpus();
+
+    const auto iterations_env = ac::Utils::GetEnvValue(kIterationsEnvName);
+    const auto iterations = iterations_env.empty()
+        ? kDefaultIterations
+        : static_cast<unsigned int>(std::atoi(iterations_env.c_str()));
+
+    // Throughput first so the numbers come from a process which
+    // hasn't churned through mutated garbage yet
+    RunBenchmark(corpus);
+
+    return RunFuzzer(corpus, iterations);
+}
@@ -65,6 +65,125 @@ TEST(H264Analyzer, DetectMultipleUnits) {
     EXPECT_EQ(1, result.pps);
 }
 
+TEST(H264Analyzer, ClassifiesIDRFrameWithParameterSets) {
+    ac::video::H264Analyzer analyzer;
+
+    uint8_t frame[] {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x0a, 0xf8, 0x41, 0xa2,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x38, 0x80,
+        0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x21, 0xa0
+    };
+
+    auto classification = analyzer.Classify(frame, sizeof(frame));
+
+    EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeIDR, classification.frame_type);
+    EXPECT_TRUE(classification.has_sps);
+    EXPECT_TRUE(classification.has_pps);
+}
+
+TEST(H264Analyzer, ClassifiesSliceTypes) {
+    ac::video::H264Analyzer analyzer;
+
+    // first_mb_in_slice 0 and slice_type 0 (P)
+    uint8_t p_frame[] { 0x00, 0x00, 0x00, 0x01, 0x41, 0xe0, 0x20, 0x42 };
+    // first_mb_in_slice 0 and slice_type 2 (I)
+    uint8_t i_frame[] { 0x00, 0x00, 0x00, 0x01, 0x41, 0xb0, 0x20, 0x42 };
+
+    auto classification = analyzer.Classify(p_frame, sizeof(p_frame));
+    EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeP, classification.frame_type);
+    EXPECT_FALSE(classification.has_sps);
+    EXPECT_FALSE(classification.has_pps);
+
+    classification = analyzer.Classify(i_frame, sizeof(i_frame));
+    EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeI, classification.frame_type);
+}
+
+TEST(H264Analyzer, ClassificationStopsAtTheFirstSlice) {
+    ac::video::H264Analyzer analyzer;
+
+    // The SPS trailing the slice must not be picked up; anything past
+    // the first coded slice is left unparsed.
+    uint8_t frame[] {
+        0x00, 0x00, 0x00, 0x01, 0x41, 0xe0, 0x20, 0x42,
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x0a, 0xf8, 0x41, 0xa2
+    };
+
+    auto classification = analyzer.Classify(frame, sizeof(frame));
+
+    EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeP, classification.frame_type);
+    EXPECT_FALSE(classification.has_sps);
+}
+
+TEST(H264Analyzer, ClassificationReusesThePreviousLayout) {
+    ac::video::H264Analyzer analyzer;
+
+    uint8_t idr_frame[] {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x0a, 0xf8, 0x41, 0xa2,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x38, 0x80,
+        0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x21, 0xa0
+    };
+    uint8_t p_frame[] { 0x00, 0x00, 0x00, 0x01, 0x41, 0xe0, 0x20, 0x42 };
+
+    // Same layout twice hits the reuse path; the layout change
+    // afterwards has to fall back to a full scan and vice versa.
+    for (unsigned int round = 0; round < 2; round++) {
+        auto classification = analyzer.Classify(idr_frame, sizeof(idr_frame));
+        EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeIDR, classification.frame_type);
+        EXPECT_TRUE(classification.has_sps);
+        EXPECT_TRUE(classification.has_pps);
+
+        classification = analyzer.Classify(p_frame, sizeof(p_frame));
+        EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeP, classification.frame_type);
+        EXPECT_FALSE(classification.has_sps);
+        EXPECT_FALSE(classification.has_pps);
+    }
+}
+
+TEST(H264Analyzer, ProcessCountsHEVCUnits) {
+    ac::video::H264Analyzer analyzer(false, ac::video::CodecType::kHEVC);
+
+    // VPS, SPS, PPS and an IDR_W_RADL slice with two byte NAL headers
+    uint8_t frame[] {
+        0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+        0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+        0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0x73,
+        0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x08
+    };
+
+    auto result = analyzer.Process(frame, sizeof(frame));
+
+    EXPECT_EQ(4, result.units);
+    EXPECT_EQ(0, result.slices);
+    EXPECT_EQ(1, result.idr_frames);
+    EXPECT_EQ(1, result.sps);
+    EXPECT_EQ(1, result.pps);
+}
+
+TEST(H264Analyzer, ClassifiesHEVCFrames) {
+    ac::video::H264Analyzer analyzer(false, ac::video::CodecType::kHEVC);
+
+    uint8_t idr_frame[] {
+        0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+        0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0x73,
+        0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x08
+    };
+    // CRA (type 21) decodes standalone but is no IDR
+    uint8_t cra_frame[] { 0x00, 0x00, 0x00, 0x01, 0x2a, 0x01, 0xaf, 0x08 };
+    // TRAIL_R (type 1) is inter predicted
+    uint8_t p_frame[] { 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x09 };
+
+    auto classification = analyzer.Classify(idr_frame, sizeof(idr_frame));
+    EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeIDR, classification.frame_type);
+    EXPECT_TRUE(classification.has_sps);
+    EXPECT_TRUE(classification.has_pps);
+
+    classification = analyzer.Classify(cra_frame, sizeof(cra_frame));
+    EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeI, classification.frame_type);
+
+    classification = analyzer.Classify(p_frame, sizeof(p_frame));
+    EXPECT_EQ(ac::video::H264Analyzer::kFrameTypeP, classification.frame_type);
+}
+
 TEST(H264Analyzer, CollectStatistics) {
     ac::video::H264Analyzer analyzer(true);
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>
+
+#include <gmock/gmock.h>
+
+#include "ac/report/metrics/metricsregistry.h"
+
+#include "ac/video/h264analyzersidecar.h"
+
+using namespace ::testing;
+
+namespace {
+// The registry is process wide, so all checks work on deltas
+std::uint64_t CounterValue(const std::string &name) {
+    const auto snapshot = ac::report::metrics::MetricsRegistry::Instance().Snapshot();
+    const auto iter = snapshot.find(name);
+    return iter != snapshot.end() ? iter->second : 0;
+}
+
+ac::video::Buffer::Ptr CreateAccessUnit(std::uint8_t nal_type) {
+    static const std::uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+
+    auto buffer = ac::video::Buffer::Create(std::uint32_t(sizeof(start_code) + 8));
+    ::memcpy(buffer->Data(), start_code, sizeof(start_code));
+    buffer->Data()[sizeof(start_code)] = nal_type & 0x1f;
+    ::memset(buffer->Data() + sizeof(start_code) + 1, 0xaa, 7);
+    return buffer;
+}
+}
+
+TEST(H264AnalyzerSidecar, CountsKeyframesInlineWithoutExecuting) {
+    auto sidecar = ac::video::H264AnalyzerSidecar::Create();
+
+    const auto keyframes_before = CounterValue("bitstream_keyframes");
+
+    sidecar->Submit(CreateAccessUnit(5));
+    sidecar->Submit(CreateAccessUnit(1));
+    sidecar->Submit(CreateAccessUnit(5));
+
+    EXPECT_EQ(keyframes_before + 2, CounterValue("bitstream_keyframes"));
+}
+
+TEST(H264AnalyzerSidecar, IgnoresBuffersWithoutAStartCode) {
+    auto sidecar = ac::video::H264AnalyzerSidecar::Create();
+
+    const auto keyframes_before = CounterValue("bitstream_keyframes");
+
+    auto garbage = ac::video::Buffer::Create(std::uint32_t(8));
+    ::memset(garbage->Data(), 0xff, 8);
+
+    sidecar->Submit(garbage);
+    sidecar->Submit(ac::video::Buffer::Ptr{});
+
+    EXPECT_EQ(keyframes_before, CounterValue("bitstream_keyframes"));
+}
+
+TEST(H264AnalyzerSidecar, FullAnalysisOnlyRunsOnTheSample) {
+    auto sidecar = ac::video::H264AnalyzerSidecar::Create();
+
+    const auto sampled_before = CounterValue("bitstream_sampled_frames");
+
+    // Far more units than the sampling interval; only a subset may
+    // ever reach the full scan
+    const unsigned int submitted = 320;
+    for (unsigned int n = 0; n < submitted; n++)
+        sidecar->Submit(CreateAccessUnit(1));
+
+    EXPECT_TRUE(sidecar->Start());
+    while (sidecar->Execute() && CounterValue("bitstream_sampled_frames") == sampled_before)
+        ;
+    EXPECT_TRUE(sidecar->Stop());
+
+    const auto sampled = CounterValue("bitstream_sampled_frames") - sampled_before;
+    EXPECT_GE(sampled, 1u);
+    EXPECT_LT(sampled, submitted / 2);
+}
+
+TEST(H264AnalyzerSidecar, DropsSamplesWhenTheScannerFallsBehind) {
+    auto sidecar = ac::video::H264AnalyzerSidecar::Create();
+
+    const auto dropped_before = CounterValue("bitstream_samples_dropped");
+
+    // Nothing drains the queue here, so the bounded sample queue has
+    // to run full and shed the overflow instead of holding on to
+    // every encoder buffer
+    for (unsigned int n = 0; n < 1000; n++)
+        sidecar->Submit(CreateAccessUnit(1));
+
+    EXPECT_GT(CounterValue("bitstream_samples_dropped"), dropped_before);
+}
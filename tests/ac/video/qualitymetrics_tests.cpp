@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include <ac/video/qualitymetrics.h>
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kWidth{64};
+static constexpr unsigned int kHeight{48};
+static constexpr unsigned int kBytesPerPixel{4};
+
+std::vector<uint8_t> CreateFrame(unsigned int seed) {
+    std::vector<uint8_t> frame(kWidth * kHeight * kBytesPerPixel);
+    for (auto &byte : frame) {
+        seed = seed * 1103515245 + 12345;
+        byte = (seed >> 16) & 0xff;
+    }
+    return frame;
+}
+
+// Adds a bounded per-channel offset, alternating in sign so the
+// damage has structure instead of being a plain brightness shift.
+std::vector<uint8_t> Distort(const std::vector<uint8_t> &frame, int amount) {
+    auto distorted = frame;
+    for (std::size_t n = 0; n < distorted.size(); n++) {
+        const int offset = (n % 2 == 0) ? amount : -amount;
+        const int value = static_cast<int>(distorted[n]) + offset;
+        distorted[n] = static_cast<uint8_t>(std::min(255, std::max(0, value)));
+    }
+    return distorted;
+}
+}
+
+TEST(QualityMetrics, IdenticalFramesScorePerfect) {
+    const auto frame = CreateFrame(1);
+
+    const auto score = ac::video::CompareFrames(
+        frame.data(), frame.data(), kWidth, kHeight);
+
+    EXPECT_DOUBLE_EQ(100., score.psnr);
+    EXPECT_NEAR(1., score.ssim, 1e-6);
+}
+
+TEST(QualityMetrics, KnownLumaErrorMatchesPSNR) {
+    const auto reference = CreateFrame(1);
+
+    // Lifting every channel by the same amount moves the luma by
+    // exactly that amount, so the expected MSE is known in closed form
+    auto distorted = reference;
+    for (auto &byte : distorted)
+        byte = static_cast<uint8_t>(std::min(251, static_cast<int>(byte)) + 4);
+
+    const auto score = ac::video::CompareFrames(
+        reference.data(), distorted.data(), kWidth, kHeight);
+
+    // A uniform luma delta of 4 gives an MSE of 16; clipped channels
+    // only ever shrink the error, hence the one-sided tolerance
+    const auto expected = 10. * std::log10(255. * 255. / 16.);
+    EXPECT_GE(score.psnr, expected - 0.01);
+    EXPECT_LE(score.psnr, expected + 1.);
+}
+
+TEST(QualityMetrics, HeavierDamageScoresLower) {
+    const auto reference = CreateFrame(1);
+    const auto lightly = Distort(reference, 4);
+    const auto heavily = Distort(reference, 32);
+
+    const auto light_score = ac::video::CompareFrames(
+        reference.data(), lightly.data(), kWidth, kHeight);
+    const auto heavy_score = ac::video::CompareFrames(
+        reference.data(), heavily.data(), kWidth, kHeight);
+
+    EXPECT_GT(light_score.psnr, heavy_score.psnr);
+    EXPECT_GT(light_score.ssim, heavy_score.ssim);
+    EXPECT_LT(heavy_score.ssim, 1.);
+}
+
+TEST(QualityMetrics, SSIMPunishesStructuralLoss) {
+    const auto reference = CreateFrame(1);
+
+    // A flat frame at the reference's mean brightness: small per-pixel
+    // error on average but none of the structure survives
+    auto flattened = reference;
+    for (std::size_t n = 0; n < flattened.size(); n += kBytesPerPixel)
+        flattened[n] = flattened[n + 1] = flattened[n + 2] = 128;
+
+    const auto score = ac::video::CompareFrames(
+        reference.data(), flattened.data(), kWidth, kHeight);
+
+    EXPECT_LT(score.ssim, 0.2);
+}
+
+TEST(QualityMetrics, RejectsDegenerateInput) {
+    const auto frame = CreateFrame(1);
+
+    const auto score = ac::video::CompareFrames(
+        frame.data(), frame.data(), 0, 0);
+
+    EXPECT_DOUBLE_EQ(0., score.psnr);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <thread>
+
+#include <gmock/gmock.h>
+
+#include "ac/video/snapshottap.h"
+
+using namespace ::testing;
+
+TEST(SnapshotTap, TimesOutWithNobodyCapturing) {
+    ac::video::SnapshotTap::Image image;
+    EXPECT_FALSE(ac::video::SnapshotTap::Instance().Take(
+                     0, &image, std::chrono::milliseconds{10}));
+}
+
+TEST(SnapshotTap, DeliversThePublishedFrame) {
+    auto &tap = ac::video::SnapshotTap::Instance();
+
+    // Stands in for the capture loop: polls the request flag and
+    // serves it like the renderer does once per frame.
+    std::vector<std::uint8_t> pixels(4 * 2 * 4, 0x7f);
+    std::thread capture([&]() {
+        while (!tap.Requested())
+            std::this_thread::yield();
+        tap.Publish(pixels.data(), 4, 2, "RGBA");
+    });
+
+    ac::video::SnapshotTap::Image image;
+    EXPECT_TRUE(tap.Take(0, &image, std::chrono::seconds{5}));
+    capture.join();
+
+    EXPECT_EQ(4u, image.width);
+    EXPECT_EQ(2u, image.height);
+    EXPECT_EQ("RGBA", image.format);
+    EXPECT_EQ(pixels, image.data);
+}
+
+TEST(SnapshotTap, DownscalesWithABoxFilter) {
+    auto &tap = ac::video::SnapshotTap::Instance();
+
+    // 4x4 frame whose left half is black and right half white; at
+    // max_width 2 each output pixel averages a uniform 2x2 box.
+    std::vector<std::uint8_t> pixels(4 * 4 * 4);
+    for (unsigned int y = 0; y < 4; y++)
+        for (unsigned int x = 0; x < 4; x++)
+            for (unsigned int c = 0; c < 4; c++)
+                pixels[(y * 4 + x) * 4 + c] = x < 2 ? 0x00 : 0xff;
+
+    std::thread capture([&]() {
+        while (!tap.Requested())
+            std::this_thread::yield();
+        tap.Publish(pixels.data(), 4, 4, "BGRA");
+    });
+
+    ac::video::SnapshotTap::Image image;
+    EXPECT_TRUE(tap.Take(2, &image, std::chrono::seconds{5}));
+    capture.join();
+
+    EXPECT_EQ(2u, image.width);
+    EXPECT_EQ(2u, image.height);
+    EXPECT_EQ("BGRA", image.format);
+    ASSERT_EQ(2u * 2u * 4u, image.data.size());
+    for (unsigned int y = 0; y < 2; y++) {
+        for (unsigned int c = 0; c < 4; c++) {
+            EXPECT_EQ(0x00, image.data[(y * 2 + 0) * 4 + c]);
+            EXPECT_EQ(0xff, image.data[(y * 2 + 1) * 4 + c]);
+        }
+    }
+}
+
+TEST(SnapshotTap, ReportsAnUnavailableCapturePath) {
+    auto &tap = ac::video::SnapshotTap::Instance();
+
+    // Zero-copy capture has no CPU pixels and declines the request
+    std::thread capture([&]() {
+        while (!tap.Requested())
+            std::this_thread::yield();
+        tap.MarkUnavailable();
+    });
+
+    ac::video::SnapshotTap::Image image;
+    EXPECT_FALSE(tap.Take(0, &image, std::chrono::seconds{5}));
+    capture.join();
+}
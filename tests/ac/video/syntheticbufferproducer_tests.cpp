@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include <ac/video/syntheticbufferproducer.h>
+
+using namespace ac::video;
+
+namespace {
+DisplayOutput TestOutput() {
+    return DisplayOutput{DisplayOutput::Mode::kMirror, 64, 32, 30.};
+}
+
+std::vector<uint8_t> FrameContents(const Buffer::Ptr &buffer) {
+    return std::vector<uint8_t>(buffer->Data(), buffer->Data() + buffer->Length());
+}
+
+class TemporaryReplayFile {
+public:
+    explicit TemporaryReplayFile(const std::vector<uint8_t> &contents) {
+        char path[] = "/tmp/replay-XXXXXX";
+        ::close(::mkstemp(path));
+        path_ = path;
+        std::ofstream file(path_, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+    }
+
+    ~TemporaryReplayFile() { ::unlink(path_.c_str()); }
+
+    std::string Path() const { return path_; }
+
+private:
+    std::string path_;
+};
+}
+
+TEST(SyntheticBufferProducer, ProducesFramesOfTheConfiguredMode) {
+    SyntheticBufferProducer::Config config;
+    config.width = 128;
+    config.height = 64;
+    config.refresh_rate = 60.;
+
+    auto producer = SyntheticBufferProducer::Create(config);
+
+    EXPECT_TRUE(producer->Setup(TestOutput()));
+    EXPECT_EQ(128, producer->OutputMode().width);
+    EXPECT_EQ(64, producer->OutputMode().height);
+    EXPECT_EQ(60., producer->OutputMode().refresh_rate);
+
+    producer->SwapBuffers();
+
+    EXPECT_EQ(128 * 64 * 4, producer->CurrentBuffer()->Length());
+    EXPECT_TRUE(producer->LastFrameDamaged());
+    EXPECT_NE(0, producer->LastFrameTimestamp());
+}
+
+TEST(SyntheticBufferProducer, DefaultsToTheNegotiatedMode) {
+    auto producer = SyntheticBufferProducer::Create(SyntheticBufferProducer::Config{});
+
+    EXPECT_TRUE(producer->Setup(TestOutput()));
+    EXPECT_EQ(64, producer->OutputMode().width);
+    EXPECT_EQ(32, producer->OutputMode().height);
+}
+
+TEST(SyntheticBufferProducer, MovingBarsChangeEveryFrame) {
+    auto producer = SyntheticBufferProducer::Create(SyntheticBufferProducer::Config{});
+    ASSERT_TRUE(producer->Setup(TestOutput()));
+
+    producer->SwapBuffers();
+    const auto first = FrameContents(producer->CurrentBuffer());
+    producer->SwapBuffers();
+    const auto second = FrameContents(producer->CurrentBuffer());
+
+    EXPECT_NE(first, second);
+    EXPECT_TRUE(producer->LastFrameDamaged());
+}
+
+TEST(SyntheticBufferProducer, StaticPatternOnlyDamagesTheFirstFrame) {
+    SyntheticBufferProducer::Config config;
+    config.pattern = SyntheticBufferProducer::Pattern::kStatic;
+
+    auto producer = SyntheticBufferProducer::Create(config);
+    ASSERT_TRUE(producer->Setup(TestOutput()));
+
+    producer->SwapBuffers();
+    EXPECT_TRUE(producer->LastFrameDamaged());
+    const auto first = FrameContents(producer->CurrentBuffer());
+
+    producer->SwapBuffers();
+    EXPECT_FALSE(producer->LastFrameDamaged());
+    EXPECT_EQ(first, FrameContents(producer->CurrentBuffer()));
+}
+
+TEST(SyntheticBufferProducer, SwapDoesNotOverwriteTheFrameStillHandedOut) {
+    auto producer = SyntheticBufferProducer::Create(SyntheticBufferProducer::Config{});
+    ASSERT_TRUE(producer->Setup(TestOutput()));
+
+    producer->SwapBuffers();
+    const auto held = producer->CurrentBuffer();
+    const auto held_contents = FrameContents(held);
+
+    producer->SwapBuffers();
+
+    EXPECT_NE(held, producer->CurrentBuffer());
+    EXPECT_EQ(held_contents, FrameContents(held));
+}
+
+TEST(SyntheticBufferProducer, ReplayLoopsTheRecordedFrames) {
+    const auto output = TestOutput();
+    const uint32_t frame_size = output.width * output.height * 4;
+    std::vector<uint8_t> recording(2 * frame_size);
+    std::fill(recording.begin(), recording.begin() + frame_size, 0x11);
+    std::fill(recording.begin() + frame_size, recording.end(), 0x22);
+    TemporaryReplayFile file(recording);
+
+    SyntheticBufferProducer::Config config;
+    config.pattern = SyntheticBufferProducer::Pattern::kReplay;
+    config.replay_path = file.Path();
+
+    auto producer = SyntheticBufferProducer::Create(config);
+    ASSERT_TRUE(producer->Setup(output));
+
+    for (int n = 0; n < 2; n++) {
+        producer->SwapBuffers();
+        EXPECT_EQ(0x11, producer->CurrentBuffer()->Data()[0]);
+        producer->SwapBuffers();
+        EXPECT_EQ(0x22, producer->CurrentBuffer()->Data()[0]);
+    }
+}
+
+TEST(SyntheticBufferProducer, SetupFailsOnMisalignedReplayFiles) {
+    TemporaryReplayFile file(std::vector<uint8_t>(100, 0x11));
+
+    SyntheticBufferProducer::Config config;
+    config.pattern = SyntheticBufferProducer::Pattern::kReplay;
+    config.replay_path = file.Path();
+
+    auto producer = SyntheticBufferProducer::Create(config);
+
+    EXPECT_FALSE(producer->Setup(TestOutput()));
+}
+
+TEST(SyntheticBufferProducer, SetupFailsOnMissingReplayFiles) {
+    SyntheticBufferProducer::Config config;
+    config.pattern = SyntheticBufferProducer::Pattern::kReplay;
+    config.replay_path = "/nonexistent/recording.raw";
+
+    auto producer = SyntheticBufferProducer::Create(config);
+
+    EXPECT_FALSE(producer->Setup(TestOutput()));
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ac/video/utils.h"
+
+namespace {
+// Byte-by-byte NAL unit scan as it looked before the scan got
+// vectorized; serves as the reference the fast path has to match.
+bool ReferenceGetNextNALUnit(
+        const uint8_t **_data, size_t *_size,
+        const uint8_t **nalStart, size_t *nalSize,
+        bool startCodeFollows) {
+    const uint8_t *data = *_data;
+    size_t size = *_size;
+
+    *nalStart = NULL;
+    *nalSize = 0;
+
+    if (size < 3)
+        return false;
+
+    size_t offset = 0;
+    for (; offset + 2 < size; ++offset) {
+        if (data[offset + 2] == 0x01 && data[offset] == 0x00
+                && data[offset + 1] == 0x00)
+            break;
+    }
+    if (offset + 2 >= size) {
+        *_data = &data[offset];
+        *_size = 2;
+        return false;
+    }
+    offset += 3;
+
+    size_t startOffset = offset;
+
+    for (;;) {
+        while (offset < size && data[offset] != 0x01)
+            ++offset;
+
+        if (offset == size) {
+            if (startCodeFollows) {
+                offset = size + 2;
+                break;
+            }
+
+            return false;
+        }
+
+        if (data[offset - 1] == 0x00 && data[offset - 2] == 0x00)
+            break;
+
+        ++offset;
+    }
+
+    size_t endOffset = offset - 2;
+    while (endOffset > startOffset + 1 && data[endOffset - 1] == 0x00)
+        --endOffset;
+
+    *nalStart = &data[startOffset];
+    *nalSize = endOffset - startOffset;
+
+    if (offset + 2 < size) {
+        *_data = &data[offset - 2];
+        *_size = size - offset + 2;
+    } else {
+        *_data = NULL;
+        *_size = 0;
+    }
+
+    return true;
+}
+
+void ExpectSameParse(const std::vector<uint8_t> &stream, bool startCodeFollows) {
+    const uint8_t *data = stream.data();
+    size_t size = stream.size();
+    const uint8_t *ref_data = stream.data();
+    size_t ref_size = stream.size();
+
+    for (;;) {
+        const uint8_t *nal_start = NULL, *ref_nal_start = NULL;
+        size_t nal_size = 0, ref_nal_size = 0;
+
+        const auto found = ac::video::GetNextNALUnit(
+            &data, &size, &nal_start, &nal_size, startCodeFollows);
+        const auto ref_found = ReferenceGetNextNALUnit(
+            &ref_data, &ref_size, &ref_nal_start, &ref_nal_size, startCodeFollows);
+
+        ASSERT_EQ(ref_found, found);
+        ASSERT_EQ(ref_nal_start, nal_start);
+        ASSERT_EQ(ref_nal_size, nal_size);
+        ASSERT_EQ(ref_data, data);
+        ASSERT_EQ(ref_size, size);
+
+        if (!found)
+            break;
+    }
+}
+}
+
+TEST(VideoUtils, GetNextNALUnitMatchesReferenceForSimpleStream) {
+    std::vector<uint8_t> stream{0x00, 0x00, 0x01, 0x67, 0x42, 0x00,
+                                0x00, 0x00, 0x01, 0x68, 0xce,
+                                0x00, 0x00, 0x01, 0x65, 0x88, 0x84};
+    ExpectSameParse(stream, true);
+    ExpectSameParse(stream, false);
+}
+
+TEST(VideoUtils, GetNextNALUnitMatchesReferenceForAllAlignments) {
+    // Slide the start codes across all positions within a vector
+    // chunk so candidates fall onto every lane at least once.
+    for (unsigned int shift = 0; shift < 20; shift++) {
+        std::vector<uint8_t> stream(shift, 0xaa);
+
+        const uint8_t first[] = {0x00, 0x00, 0x01, 0x67, 0x42, 0x80, 0x1f};
+        const uint8_t second[] = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x26};
+        stream.insert(stream.end(), first, first + sizeof(first));
+        stream.insert(stream.end(), second, second + sizeof(second));
+        // Trailing zeros right before the next start code get trimmed
+        stream.push_back(0x00);
+        stream.push_back(0x00);
+        const uint8_t third[] = {0x00, 0x00, 0x01, 0x65, 0x88};
+        stream.insert(stream.end(), third, third + sizeof(third));
+
+        ExpectSameParse(stream, true);
+        ExpectSameParse(stream, false);
+    }
+}
+
+TEST(VideoUtils, GetNextNALUnitMatchesReferenceWithoutAnyStartCode) {
+    std::vector<uint8_t> stream(64, 0x42);
+    ExpectSameParse(stream, true);
+    ExpectSameParse(stream, false);
+
+    // 0x01 bytes without the two leading zeros are no start codes
+    std::vector<uint8_t> fake(64, 0x01);
+    ExpectSameParse(fake, true);
+    ExpectSameParse(fake, false);
+}
+
+TEST(VideoUtils, GetNextNALUnitMatchesReferenceForLargeStream) {
+    // Pseudo random payload with a start code every few hundred bytes,
+    // large enough to keep the vectorized scan on its fast path.
+    std::vector<uint8_t> stream;
+    unsigned int seed = 12345;
+    for (unsigned int n = 0; n < 100; n++) {
+        stream.push_back(0x00);
+        stream.push_back(0x00);
+        stream.push_back(0x01);
+        stream.push_back(n % 2 ? 0x41 : 0x65);
+        for (unsigned int m = 0; m < 200 + (n * 7) % 100; m++) {
+            seed = seed * 1103515245 + 12345;
+            uint8_t byte = (seed >> 16) & 0xff;
+            // Avoid accidentally forming a start code inside the payload
+            if (byte == 0x00 || byte == 0x01)
+                byte = 0x42;
+            stream.push_back(byte);
+        }
+    }
+
+    ExpectSameParse(stream, true);
+    ExpectSameParse(stream, false);
+}
+
+TEST(VideoUtils, DoesBufferContainIDRFrameFindsIDR) {
+    std::vector<uint8_t> with_idr{0x00, 0x00, 0x01, 0x41, 0x9a,
+                                  0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+    std::vector<uint8_t> without_idr{0x00, 0x00, 0x01, 0x41, 0x9a,
+                                     0x00, 0x00, 0x00, 0x01, 0x41, 0x26};
+
+    EXPECT_TRUE(ac::video::DoesBufferContainIDRFrame(
+        ac::video::Buffer::Create(with_idr.data(), with_idr.size())));
+    EXPECT_FALSE(ac::video::DoesBufferContainIDRFrame(
+        ac::video::Buffer::Create(without_idr.data(), without_idr.size())));
+}
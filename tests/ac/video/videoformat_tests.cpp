@@ -49,7 +49,8 @@ TEST(VideoFormat, ExtractRateAndResolution) {
     ExtractAndVerifyRateResolution<wds::CEARatesAndResolutions>(wds::CEA1280x720p24, 1280, 720, 24);
     ExtractAndVerifyRateResolution<wds::CEARatesAndResolutions>(wds::CEA1920x1080p24, 1920, 1080, 24);
 
-#if 0
+    // VESA and HH modes resolve through the same tables since the
+    // constexpr rework
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA800x600p30, 800, 600, 30);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA800x600p60, 800, 600, 60);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1024x768p30, 1024, 768, 30);
@@ -65,13 +66,13 @@ TEST(VideoFormat, ExtractRateAndResolution) {
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1366x768p30, 1366, 768, 30);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1366x768p60, 1366, 768, 60);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1280x1024p30, 1280, 1024, 30);
-    ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1280x1024p60, 1280, 1024, 30);
+    ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1280x1024p60, 1280, 1024, 60);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1400x1050p30, 1400, 1050, 30);
-    ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1400x1050p60, 1400, 1050, 30);
+    ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1400x1050p60, 1400, 1050, 60);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1440x900p30, 1440, 900, 30);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1440x900p60, 1440, 900, 60);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1600x900p30, 1600, 900, 30);
-    ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1600x900p60, 1600, 900, 30);
+    ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1600x900p60, 1600, 900, 60);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1600x1200p30, 1600, 1200, 30);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1600x1200p60, 1600, 1200, 60);
     ExtractAndVerifyRateResolution<wds::VESARatesAndResolutions>(wds::VESA1680x1024p30, 1680, 1024, 30);
@@ -92,7 +93,6 @@ TEST(VideoFormat, ExtractRateAndResolution) {
     ExtractAndVerifyRateResolution<wds::HHRatesAndResolutions>(wds::HH960x540p60, 960, 540, 60);
     ExtractAndVerifyRateResolution<wds::HHRatesAndResolutions>(wds::HH848x480p30, 848, 480, 30);
     ExtractAndVerifyRateResolution<wds::HHRatesAndResolutions>(wds::HH848x480p60, 848, 480, 60);
-#endif
 }
 
 TEST(VideoFormat, ExtractH264Profile) {
@@ -171,3 +171,86 @@ TEST(VideoFormat, ExtractProfileLevel) {
     EXPECT_EQ(0x0c, constraint);
     EXPECT_EQ(42, level);
 }
+
+namespace {
+wds::H264VideoCodec MakeCodec(wds::H264Profile profile, wds::H264Level level,
+                              const std::vector<wds::CEARatesAndResolutions> &cea_modes) {
+    wds::RateAndResolutionsBitmap cea_rr;
+    wds::RateAndResolutionsBitmap vesa_rr;
+    wds::RateAndResolutionsBitmap hh_rr;
+    for (const auto mode : cea_modes)
+        cea_rr.set(mode);
+    return wds::H264VideoCodec(profile, level, cea_rr, vesa_rr, hh_rr);
+}
+}
+
+TEST(VideoFormat, FindOptimalVideoFormatPicksHighestCommonMode) {
+    const auto local = MakeCodec(wds::CBP, wds::k3_1,
+        {wds::CEA1280x720p30, wds::CEA1280x720p25, wds::CEA1280x720p24});
+    const auto remote = MakeCodec(wds::CBP, wds::k4,
+        {wds::CEA640x480p60, wds::CEA1280x720p25, wds::CEA1280x720p30});
+
+    bool success = false;
+    const auto format = ac::video::FindOptimalVideoFormat(
+        wds::NativeVideoFormat{wds::CEA1920x1080p60}, {local}, {remote}, &success);
+
+    EXPECT_TRUE(success);
+    EXPECT_EQ(wds::CEA, format.type);
+    EXPECT_EQ(wds::CEA1280x720p30, format.rate_resolution);
+    EXPECT_EQ(wds::CBP, format.profile);
+    // Level is capped by the weaker side
+    EXPECT_EQ(wds::k3_1, format.level);
+}
+
+TEST(VideoFormat, FindOptimalVideoFormatPrefersSinkNativeMode) {
+    const auto local = MakeCodec(wds::CBP, wds::k3_1,
+        {wds::CEA1280x720p25, wds::CEA1280x720p30});
+    const auto remote = MakeCodec(wds::CBP, wds::k3_1,
+        {wds::CEA1280x720p25, wds::CEA1280x720p30});
+
+    bool success = false;
+    const auto format = ac::video::FindOptimalVideoFormat(
+        wds::NativeVideoFormat{wds::CEA1280x720p25}, {local}, {remote}, &success);
+
+    EXPECT_TRUE(success);
+    EXPECT_EQ(wds::CEA1280x720p25, format.rate_resolution);
+}
+
+TEST(VideoFormat, FindOptimalVideoFormatFailsWithoutIntersection) {
+    const auto local = MakeCodec(wds::CBP, wds::k3_1, {wds::CEA1280x720p30});
+    const auto remote = MakeCodec(wds::CBP, wds::k3_1, {wds::CEA640x480p60});
+
+    bool success = true;
+    ac::video::FindOptimalVideoFormat(
+        wds::NativeVideoFormat{wds::CEA640x480p60}, {local}, {remote}, &success);
+
+    EXPECT_FALSE(success);
+}
+
+TEST(VideoFormat, FindBest2160pModeHonoursPixelRateAndFramerate) {
+    ac::video::RateAndResolution mode{0, 0, 0};
+
+    // 2160p60 fits the budget but the negotiated mode runs at 30
+    EXPECT_TRUE(ac::video::FindBest2160pMode(3840 * 2160 * 60.0, 30, &mode));
+    EXPECT_EQ(3840, mode.width);
+    EXPECT_EQ(2160, mode.height);
+    EXPECT_EQ(30, mode.framerate);
+
+    // The budget caps the framerate below the negotiated 60
+    EXPECT_TRUE(ac::video::FindBest2160pMode(3840 * 2160 * 30.0, 60, &mode));
+    EXPECT_EQ(30, mode.framerate);
+
+    // Nothing fits into a 1080p-class budget
+    EXPECT_FALSE(ac::video::FindBest2160pMode(1920 * 1080 * 60.0, 60, &mode));
+}
+
+TEST(VideoFormat, FindOptimalVideoFormatRequiresMatchingProfiles) {
+    const auto local = MakeCodec(wds::CBP, wds::k3_1, {wds::CEA1280x720p30});
+    const auto remote = MakeCodec(wds::CHP, wds::k3_1, {wds::CEA1280x720p30});
+
+    bool success = true;
+    ac::video::FindOptimalVideoFormat(
+        wds::NativeVideoFormat{wds::CEA1280x720p30}, {local}, {remote}, &success);
+
+    EXPECT_FALSE(success);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+#include <cstddef>
+
+#include "tests/common/allocationtracker.h"
+
+// The glibc-internal entry points let us interpose without the dlsym
+// bootstrapping dance an LD_PRELOAD shim would need.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+namespace {
+std::atomic<bool> g_enabled{false};
+std::atomic<std::uint64_t> g_count{0};
+
+inline void CountAllocation() {
+    if (g_enabled.load(std::memory_order_relaxed))
+        g_count.fetch_add(1, std::memory_order_relaxed);
+}
+}
+
+extern "C" void* malloc(size_t size) {
+    CountAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t nmemb, size_t size) {
+    CountAllocation();
+    return __libc_calloc(nmemb, size);
+}
+
+extern "C" void* realloc(void *ptr, size_t size) {
+    CountAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+namespace ac {
+namespace testing {
+
+void AllocationTracker::Enable() {
+    g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void AllocationTracker::Disable() {
+    g_enabled.store(false, std::memory_order_relaxed);
+}
+
+void AllocationTracker::Reset() {
+    g_count.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t AllocationTracker::Count() {
+    return g_count.load(std::memory_order_relaxed);
+}
+
+} // namespace testing
+} // namespace ac
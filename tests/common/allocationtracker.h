@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_TESTING_ALLOCATION_TRACKER_H_
+#define AC_TESTING_ALLOCATION_TRACKER_H_
+
+#include <cstdint>
+
+namespace ac {
+namespace testing {
+
+// Counts heap allocations while enabled by interposing the glibc
+// allocator entry points; referencing the tracker anywhere in a test
+// binary is enough to pull the interposed symbols in. Disabled it
+// costs a single relaxed load per allocation, so linking it into
+// binaries which never enable it is harmless.
+class AllocationTracker {
+public:
+    static void Enable();
+    static void Disable();
+    static void Reset();
+    // Allocations (malloc/calloc/realloc and everything layered on
+    // top, including operator new) observed while enabled.
+    static std::uint64_t Count();
+};
+
+} // namespace testing
+} // namespace ac
+
+#endif
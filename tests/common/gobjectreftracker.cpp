@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+
+#include <dlfcn.h>
+
+#include <glib-object.h>
+
+#include "tests/common/gobjectreftracker.h"
+
+namespace {
+std::atomic<bool> g_enabled{false};
+std::atomic<std::uint64_t> g_ref_count{0};
+std::atomic<std::uint64_t> g_unref_count{0};
+
+inline void CountOperation(std::atomic<std::uint64_t> &counter) {
+    if (g_enabled.load(std::memory_order_relaxed))
+        counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Resolved lazily on first use; dlsym may allocate, so doing this at
+// static-initialization time would race the allocation tracker's
+// interposers in binaries linking both.
+typedef gpointer (*RefFunc)(gpointer);
+typedef void (*UnrefFunc)(gpointer);
+
+RefFunc NextRef() {
+    static RefFunc next = reinterpret_cast<RefFunc>(
+        dlsym(RTLD_NEXT, "g_object_ref"));
+    return next;
+}
+
+UnrefFunc NextUnref() {
+    static UnrefFunc next = reinterpret_cast<UnrefFunc>(
+        dlsym(RTLD_NEXT, "g_object_unref"));
+    return next;
+}
+}
+
+extern "C" gpointer g_object_ref(gpointer object) {
+    CountOperation(g_ref_count);
+    return NextRef()(object);
+}
+
+extern "C" void g_object_unref(gpointer object) {
+    CountOperation(g_unref_count);
+    NextUnref()(object);
+}
+
+namespace ac {
+namespace testing {
+
+void GObjectRefTracker::Enable() {
+    g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void GObjectRefTracker::Disable() {
+    g_enabled.store(false, std::memory_order_relaxed);
+}
+
+void GObjectRefTracker::Reset() {
+    g_ref_count.store(0, std::memory_order_relaxed);
+    g_unref_count.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t GObjectRefTracker::RefCount() {
+    return g_ref_count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t GObjectRefTracker::UnrefCount() {
+    return g_unref_count.load(std::memory_order_relaxed);
+}
+
+} // namespace testing
+} // namespace ac
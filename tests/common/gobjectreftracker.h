@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_TESTING_GOBJECT_REF_TRACKER_H_
+#define AC_TESTING_GOBJECT_REF_TRACKER_H_
+
+#include <cstdint>
+
+namespace ac {
+namespace testing {
+
+// Counts GObject reference-count operations while enabled by
+// interposing g_object_ref/g_object_unref; referencing the tracker
+// anywhere in a test binary is enough to pull the interposed symbols
+// in. Unlike glibc, GLib exposes no internal entry points, so the
+// interposers forward through dlsym(RTLD_NEXT, ...). Disabled it
+// costs a single relaxed load per operation.
+class GObjectRefTracker {
+public:
+    static void Enable();
+    static void Disable();
+    static void Reset();
+    // g_object_ref calls observed while enabled.
+    static std::uint64_t RefCount();
+    // g_object_unref calls observed while enabled.
+    static std::uint64_t UnrefCount();
+};
+
+} // namespace testing
+} // namespace ac
+
+#endif
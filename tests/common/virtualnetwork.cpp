@@ -16,10 +16,14 @@
  */
 
 
+#include <cstdlib>
+
 extern "C" {
 #include "3rd_party/lxc-nl/network.h"
 }
 
+#include "ac/utils.h"
+
 #include "virtualnetwork.h"
 
 namespace {
@@ -51,6 +55,41 @@ std::string VirtualNetwork::Endpoint2() const {
     return endpoint2_;
 }
 
+bool VirtualNetwork::ApplyImpairments(const Impairments &impairments) {
+    // An all-zero set means a clean link; get rid of any leftover
+    // netem instead of installing an empty one.
+    if (impairments.loss_percent <= 0.0 && impairments.reorder_percent <= 0.0 &&
+            impairments.delay_ms == 0 && impairments.jitter_ms == 0 &&
+            impairments.rate_kbit == 0) {
+        ClearImpairments();
+        return true;
+    }
+
+    // There is no netlink helper for qdiscs in our bundled lxc bits
+    // so this goes through the tc binary; fine for a test harness
+    // which already requires CAP_NET_ADMIN for the veth pair itself.
+    auto command = ac::Utils::Sprintf("tc qdisc replace dev %s root netem", endpoint1_);
+
+    if (impairments.loss_percent > 0.0)
+        command += ac::Utils::Sprintf(" loss %.2f%%", impairments.loss_percent);
+
+    if (impairments.delay_ms > 0 || impairments.jitter_ms > 0)
+        command += ac::Utils::Sprintf(" delay %dms %dms", impairments.delay_ms, impairments.jitter_ms);
+
+    if (impairments.reorder_percent > 0.0)
+        command += ac::Utils::Sprintf(" reorder %.2f%%", impairments.reorder_percent);
+
+    if (impairments.rate_kbit > 0)
+        command += ac::Utils::Sprintf(" rate %dkbit", impairments.rate_kbit);
+
+    return std::system(command.c_str()) == 0;
+}
+
+bool VirtualNetwork::ClearImpairments() {
+    const auto command = ac::Utils::Sprintf("tc qdisc del dev %s root", endpoint1_);
+    return std::system(command.c_str()) == 0;
+}
+
 } // namespace testing
 } // namespace ac
 
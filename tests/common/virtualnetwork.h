@@ -25,12 +25,34 @@ namespace testing {
 
 class VirtualNetwork {
 public:
+    // Link impairments applied to the egress side of endpoint 1 with
+    // netem; zeroed fields leave the respective property untouched.
+    struct Impairments {
+        // Percentage of packets dropped at random
+        double loss_percent = 0.0;
+        // Percentage of packets which skip the configured delay and
+        // therefore arrive out of order; requires delay_ms > 0 to
+        // have an effect.
+        double reorder_percent = 0.0;
+        // Base one-way delay added to every packet
+        unsigned int delay_ms = 0;
+        // Random variation applied on top of the base delay
+        unsigned int jitter_ms = 0;
+        // Hard rate cap; 0 leaves the link uncapped
+        unsigned int rate_kbit = 0;
+    };
+
     VirtualNetwork();
     ~VirtualNetwork();
 
     std::string Endpoint1() const;
     std::string Endpoint2() const;
 
+    // Both return false when the tc invocation fails, typically due to
+    // missing privileges or a kernel without netem support.
+    bool ApplyImpairments(const Impairments &impairments);
+    bool ClearImpairments();
+
 private:
     std::string endpoint1_;
     std::string endpoint2_;
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <infra/mdnsbrowser.h>
+
+using namespace ::testing;
+
+namespace {
+class MessageBuilder {
+public:
+    void AppendU16(uint16_t value) {
+        data_.push_back(value >> 8);
+        data_.push_back(value & 0xff);
+    }
+
+    void AppendU32(uint32_t value) {
+        AppendU16(value >> 16);
+        AppendU16(value & 0xffff);
+    }
+
+    void AppendName(const std::string &name) {
+        size_t start = 0;
+        while (start < name.size()) {
+            auto end = name.find('.', start);
+            if (end == std::string::npos)
+                end = name.size();
+            data_.push_back(static_cast<uint8_t>(end - start));
+            for (size_t n = start; n < end; n++)
+                data_.push_back(static_cast<uint8_t>(name.at(n)));
+            start = end + 1;
+        }
+        data_.push_back(0);
+    }
+
+    void AppendHeader(uint16_t num_answers) {
+        AppendU16(0);       // id
+        AppendU16(0x8400);  // authoritative response
+        AppendU16(0);       // no questions
+        AppendU16(num_answers);
+        AppendU16(0);       // no authority records
+        AppendU16(0);       // no additional records
+    }
+
+    void AppendPTR(const std::string &name, const std::string &instance, uint32_t ttl = 120) {
+        AppendName(name);
+        AppendU16(12);  // PTR
+        AppendU16(1);   // IN
+        AppendU32(ttl);
+        MessageBuilder rdata;
+        rdata.AppendName(instance);
+        AppendU16(rdata.data_.size());
+        data_.insert(data_.end(), rdata.data_.begin(), rdata.data_.end());
+    }
+
+    void AppendSRV(const std::string &instance, const std::string &target, uint16_t port) {
+        AppendName(instance);
+        AppendU16(33);  // SRV
+        AppendU16(1);   // IN
+        AppendU32(120);
+        MessageBuilder rdata;
+        rdata.AppendU16(0);  // priority
+        rdata.AppendU16(0);  // weight
+        rdata.AppendU16(port);
+        rdata.AppendName(target);
+        AppendU16(rdata.data_.size());
+        data_.insert(data_.end(), rdata.data_.begin(), rdata.data_.end());
+    }
+
+    void AppendA(const std::string &target, uint32_t address) {
+        AppendName(target);
+        AppendU16(1);  // A
+        AppendU16(1);  // IN
+        AppendU32(120);
+        AppendU16(4);
+        AppendU32(address);
+    }
+
+    const uint8_t* Data() const { return data_.data(); }
+    size_t Size() const { return data_.size(); }
+
+    std::vector<uint8_t> data_;
+};
+}
+
+TEST(MDNSBrowser, ParsesACompleteAnnouncement) {
+    MessageBuilder message;
+    message.AppendHeader(3);
+    message.AppendPTR("_display._tcp.local", "Office TV._display._tcp.local");
+    message.AppendSRV("Office TV._display._tcp.local", "office-tv.local", 7236);
+    message.AppendA("office-tv.local", 0xc0a80142);  // 192.168.1.66
+
+    const auto services = infra::MDNSBrowser::ParseResponse(message.Data(), message.Size());
+
+    ASSERT_EQ(1, services.size());
+    EXPECT_EQ("Office TV", services.at(0).name);
+    EXPECT_EQ("192.168.1.66", services.at(0).address.to_string());
+    EXPECT_EQ(7236, services.at(0).port);
+}
+
+TEST(MDNSBrowser, FollowsCompressionPointers) {
+    MessageBuilder message;
+    message.AppendHeader(3);
+    message.AppendPTR("_display._tcp.local", "Office TV._display._tcp.local");
+
+    // SRV record whose name points back at the PTR rdata instead of
+    // spelling the instance out again
+    const uint16_t instance_offset = 12 + 19 + 2 + 10;
+    message.AppendU16(0xc000 | instance_offset);
+    message.AppendU16(33);
+    message.AppendU16(1);
+    message.AppendU32(120);
+    MessageBuilder rdata;
+    rdata.AppendU16(0);
+    rdata.AppendU16(0);
+    rdata.AppendU16(7236);
+    rdata.AppendName("office-tv.local");
+    message.AppendU16(rdata.Size());
+    message.data_.insert(message.data_.end(), rdata.data_.begin(), rdata.data_.end());
+
+    message.AppendA("office-tv.local", 0xc0a80142);
+
+    const auto services = infra::MDNSBrowser::ParseResponse(message.Data(), message.Size());
+
+    ASSERT_EQ(1, services.size());
+    EXPECT_EQ("Office TV", services.at(0).name);
+    EXPECT_EQ(7236, services.at(0).port);
+}
+
+TEST(MDNSBrowser, IgnoresOtherServiceTypes) {
+    MessageBuilder message;
+    message.AppendHeader(3);
+    message.AppendPTR("_ipp._tcp.local", "Printer._ipp._tcp.local");
+    message.AppendSRV("Printer._ipp._tcp.local", "printer.local", 631);
+    message.AppendA("printer.local", 0xc0a80107);
+
+    EXPECT_TRUE(infra::MDNSBrowser::ParseResponse(message.Data(), message.Size()).empty());
+}
+
+TEST(MDNSBrowser, IgnoresGoodbyeAnnouncements) {
+    MessageBuilder message;
+    message.AppendHeader(3);
+    message.AppendPTR("_display._tcp.local", "Office TV._display._tcp.local", 0);
+    message.AppendSRV("Office TV._display._tcp.local", "office-tv.local", 7236);
+    message.AppendA("office-tv.local", 0xc0a80142);
+
+    EXPECT_TRUE(infra::MDNSBrowser::ParseResponse(message.Data(), message.Size()).empty());
+}
+
+TEST(MDNSBrowser, IncompleteRecordsYieldNoService) {
+    // PTR and SRV but no A record resolving the target
+    MessageBuilder message;
+    message.AppendHeader(2);
+    message.AppendPTR("_display._tcp.local", "Office TV._display._tcp.local");
+    message.AppendSRV("Office TV._display._tcp.local", "office-tv.local", 7236);
+
+    EXPECT_TRUE(infra::MDNSBrowser::ParseResponse(message.Data(), message.Size()).empty());
+}
+
+TEST(MDNSBrowser, SurvivesTruncatedMessages) {
+    MessageBuilder message;
+    message.AppendHeader(3);
+    message.AppendPTR("_display._tcp.local", "Office TV._display._tcp.local");
+    message.AppendSRV("Office TV._display._tcp.local", "office-tv.local", 7236);
+    message.AppendA("office-tv.local", 0xc0a80142);
+
+    // No prefix of the message may crash the parser or invent services
+    for (size_t size = 0; size < message.Size(); size++)
+        EXPECT_TRUE(infra::MDNSBrowser::ParseResponse(message.Data(), size).empty());
+}
+
+TEST(MDNSBrowser, IgnoresQueries) {
+    MessageBuilder message;
+    message.AppendU16(0);
+    message.AppendU16(0);  // plain query, not a response
+    message.AppendU16(1);
+    message.AppendU16(0);
+    message.AppendU16(0);
+    message.AppendU16(0);
+    message.AppendName("_display._tcp.local");
+    message.AppendU16(12);
+    message.AppendU16(1);
+
+    EXPECT_TRUE(infra::MDNSBrowser::ParseResponse(message.Data(), message.Size()).empty());
+}
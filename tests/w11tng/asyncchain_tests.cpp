@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "w11tng/asyncchain.h"
+
+TEST(AsyncChain, RunsStepsInOrder) {
+    std::vector<int> order;
+
+    auto chain = w11tng::AsyncChain::Create();
+    chain->Then([&](const w11tng::AsyncChain::Ptr &chain) {
+        order.push_back(1);
+        chain->Continue();
+    });
+    chain->Then([&](const w11tng::AsyncChain::Ptr &chain) {
+        order.push_back(2);
+        chain->Continue();
+    });
+
+    bool done = false;
+    bool success = false;
+    chain->Start([&](bool result) { done = true; success = result; });
+
+    EXPECT_TRUE(done);
+    EXPECT_TRUE(success);
+    EXPECT_EQ(order, std::vector<int>({1, 2}));
+}
+
+TEST(AsyncChain, WaitsForDeferredSteps) {
+    // Stands in for a pending GDBus callback holding the frame.
+    w11tng::AsyncChain::Ptr pending;
+
+    auto chain = w11tng::AsyncChain::Create();
+    chain->Then([&](const w11tng::AsyncChain::Ptr &chain) { pending = chain; });
+
+    bool done = false;
+    chain->Start([&](bool) { done = true; });
+
+    EXPECT_FALSE(done);
+
+    pending->Continue();
+
+    EXPECT_TRUE(done);
+}
+
+TEST(AsyncChain, ParallelGroupFinishesWithItsLastMember) {
+    std::vector<w11tng::AsyncChain::Ptr> pending;
+
+    auto chain = w11tng::AsyncChain::Create();
+    chain->ThenAll({
+        [&](const w11tng::AsyncChain::Ptr &chain) { pending.push_back(chain); },
+        [&](const w11tng::AsyncChain::Ptr &chain) { pending.push_back(chain); },
+        [&](const w11tng::AsyncChain::Ptr &chain) { pending.push_back(chain); },
+    });
+
+    bool after_group = false;
+    chain->Then([&](const w11tng::AsyncChain::Ptr &chain) {
+        after_group = true;
+        chain->Continue();
+    });
+
+    bool done = false;
+    chain->Start([&](bool) { done = true; });
+
+    EXPECT_EQ(pending.size(), 3);
+    EXPECT_FALSE(after_group);
+
+    pending[0]->Continue();
+    pending[2]->Continue();
+    EXPECT_FALSE(after_group);
+
+    pending[1]->Continue();
+    EXPECT_TRUE(after_group);
+    EXPECT_TRUE(done);
+}
+
+TEST(AsyncChain, MixedSynchronousAndDeferredGroupMembers) {
+    w11tng::AsyncChain::Ptr pending;
+
+    auto chain = w11tng::AsyncChain::Create();
+    chain->ThenAll({
+        // Completing synchronously before the second member was even
+        // started must not advance the chain early.
+        [&](const w11tng::AsyncChain::Ptr &chain) { chain->Continue(); },
+        [&](const w11tng::AsyncChain::Ptr &chain) { pending = chain; },
+    });
+
+    bool done = false;
+    chain->Start([&](bool) { done = true; });
+
+    EXPECT_FALSE(done);
+    pending->Continue();
+    EXPECT_TRUE(done);
+}
+
+TEST(AsyncChain, FailureSkipsRemainingSteps) {
+    bool second_ran = false;
+
+    auto chain = w11tng::AsyncChain::Create();
+    chain->Then([](const w11tng::AsyncChain::Ptr &chain) { chain->Fail("no luck"); });
+    chain->Then([&](const w11tng::AsyncChain::Ptr &chain) {
+        second_ran = true;
+        chain->Continue();
+    });
+
+    bool done = false;
+    bool success = true;
+    chain->Start([&](bool result) { done = true; success = result; });
+
+    EXPECT_TRUE(done);
+    EXPECT_FALSE(success);
+    EXPECT_FALSE(second_ran);
+}
+
+TEST(AsyncChain, FailureWaitsForOutstandingGroupMembers) {
+    w11tng::AsyncChain::Ptr pending;
+
+    auto chain = w11tng::AsyncChain::Create();
+    chain->ThenAll({
+        [](const w11tng::AsyncChain::Ptr &chain) { chain->Fail("no luck"); },
+        [&](const w11tng::AsyncChain::Ptr &chain) { pending = chain; },
+    });
+
+    bool done = false;
+    chain->Start([&](bool) { done = true; });
+
+    // The outstanding member still holds a callback on the frame so
+    // the chain must not finish under it.
+    EXPECT_FALSE(done);
+
+    pending->Continue();
+    EXPECT_TRUE(done);
+}
+
+TEST(AsyncChain, KeepsContextAliveWhileRunning) {
+    auto context = std::make_shared<int>(42);
+    std::weak_ptr<int> observer = context;
+
+    w11tng::AsyncChain::Ptr pending;
+
+    auto chain = w11tng::AsyncChain::Create();
+    chain->SetContext(context);
+    chain->Then([&](const w11tng::AsyncChain::Ptr &chain) { pending = chain; });
+    chain->Start();
+
+    context.reset();
+    EXPECT_FALSE(observer.expired());
+    EXPECT_EQ(*pending->ContextAs<int>(), 42);
+
+    pending->Continue();
+    pending.reset();
+    EXPECT_TRUE(observer.expired());
+}
+
+TEST(AsyncChain, SurvivesCallbackOutlivingTheOwner) {
+    // The frame as raw user_data round-trips through FromUserData and
+    // stays valid while a callback is outstanding even if the owner
+    // dropped its reference.
+    w11tng::AsyncChain::Ptr pending;
+
+    {
+        auto chain = w11tng::AsyncChain::Create();
+        chain->Then([&](const w11tng::AsyncChain::Ptr &chain) {
+            pending = w11tng::AsyncChain::FromUserData(chain->AsUserData());
+        });
+        chain->Start();
+    }
+
+    ASSERT_TRUE(!!pending);
+    pending->Continue();
+}
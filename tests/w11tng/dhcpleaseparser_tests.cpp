@@ -29,6 +29,7 @@ std::vector<std::string> leases_multiple_entries = {
     "# Test comment",
     "lease {",
     "    interface p2p0;",
+    "    hardware ethernet 4E:74:A0:B1:C2:D3;",
     "    fixed-address 192.168.7.5;",
     "    option routers 192.168.7.1;",
     "    option host-name \"Test Host\";",
@@ -73,16 +74,63 @@ TEST(DhcpLeaseParser, ReadMultipleLeases) {
     EXPECT_EQ(leases.size(), 2);
 
     EXPECT_EQ(leases[0].Interface(), "p2p0");
+    EXPECT_EQ(leases[0].HardwareAddress(), "4e:74:a0:b1:c2:d3");
     EXPECT_EQ(leases[0].FixedAddress().to_string(), "192.168.7.5");
     EXPECT_EQ(leases[0].Gateway().to_string(), "192.168.7.1");
 
     EXPECT_EQ(leases[1].Interface(), "wlan0");
+    EXPECT_EQ(leases[1].HardwareAddress(), "");
     EXPECT_EQ(leases[1].FixedAddress().to_string(), "10.10.7.5");
     EXPECT_EQ(leases[1].Gateway().to_string(), "10.10.7.1");
 
     ::unlink(lease_path.c_str());
 }
 
+TEST(DhcpLeaseParser, IncrementalParsingOnlyReadsAppendedRecords) {
+    auto lease_path = CreateLeaseFile(leases_multiple_entries);
+
+    std::size_t offset = 0;
+    auto leases = w11tng::DhcpLeaseParser::FromFile(lease_path, offset);
+
+    EXPECT_EQ(leases.size(), 2);
+    EXPECT_GT(offset, 0);
+
+    // Nothing was appended so another call must not report old records.
+    leases = w11tng::DhcpLeaseParser::FromFile(lease_path, offset);
+    EXPECT_EQ(leases.size(), 0);
+
+    std::ofstream appender(lease_path, std::ios_base::app);
+    appender << "lease {" << std::endl
+             << "    interface p2p1;" << std::endl
+             << "    fixed-address 192.168.9.5;" << std::endl
+             << "    option routers 192.168.9.1;" << std::endl
+             << "}" << std::endl;
+    appender.close();
+
+    leases = w11tng::DhcpLeaseParser::FromFile(lease_path, offset);
+
+    EXPECT_EQ(leases.size(), 1);
+    EXPECT_EQ(leases[0].Interface(), "p2p1");
+    EXPECT_EQ(leases[0].FixedAddress().to_string(), "192.168.9.5");
+    EXPECT_EQ(leases[0].Gateway().to_string(), "192.168.9.1");
+
+    // A rotated (smaller) file resets the offset and is parsed fully.
+    std::ofstream truncator(lease_path, std::ios_base::trunc);
+    truncator << "lease {" << std::endl
+              << "    interface wlan1;" << std::endl
+              << "    fixed-address 10.10.9.5;" << std::endl
+              << "    option routers 10.10.9.1;" << std::endl
+              << "}" << std::endl;
+    truncator.close();
+
+    leases = w11tng::DhcpLeaseParser::FromFile(lease_path, offset);
+
+    EXPECT_EQ(leases.size(), 1);
+    EXPECT_EQ(leases[0].Interface(), "wlan1");
+
+    ::unlink(lease_path.c_str());
+}
+
 TEST(DhcpLeaseParser, InvalidIpAddresses) {
     auto lease_path = CreateLeaseFile(leases_with_invalid_ip);
     auto leases = w11tng::DhcpLeaseParser::FromFile(lease_path);
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "ac/utils.h"
+#include "w11tng/dhcpleaseregistry.h"
+
+namespace {
+std::string CreateLeaseFile(const std::vector<std::string> &content) {
+    auto path = ac::Utils::Sprintf("%s/test-leases-%s",
+                                    boost::filesystem::temp_directory_path().string(),
+                                    boost::filesystem::unique_path().string());
+    ac::Utils::CreateFile(path);
+
+    std::fstream file(path);
+    for (auto line : content)
+        file << line << std::endl;
+    file.close();
+
+    return path;
+}
+
+w11tng::DhcpLeaseInfo MakeLease(const std::string &interface,
+                                const ac::MacAddress &hardware_address,
+                                const std::string &fixed_address) {
+    return w11tng::DhcpLeaseInfo{interface, hardware_address,
+        ac::IpV4Address::from_string(fixed_address),
+        ac::IpV4Address::from_string("192.168.7.1")};
+}
+}
+
+TEST(DhcpLeaseRegistry, LooksUpLeasesByHardwareAddress) {
+    auto registry = w11tng::DhcpLeaseRegistry::Create();
+
+    registry->Update(MakeLease("p2p0", "4e:74:00:00:00:01", "192.168.7.5"));
+    registry->Update(MakeLease("p2p1", "4e:74:00:00:00:02", "192.168.8.5"));
+
+    EXPECT_EQ(registry->Size(), 2);
+
+    auto lease = registry->FindByHardwareAddress("4e:74:00:00:00:02");
+    ASSERT_TRUE(!!lease);
+    EXPECT_EQ(lease->Interface(), "p2p1");
+    EXPECT_EQ(lease->FixedAddress().to_string(), "192.168.8.5");
+
+    EXPECT_FALSE(!!registry->FindByHardwareAddress("4e:74:00:00:00:03"));
+}
+
+TEST(DhcpLeaseRegistry, LookupIgnoresAddressCase) {
+    auto registry = w11tng::DhcpLeaseRegistry::Create();
+
+    registry->Update(MakeLease("p2p0", "4E:74:00:00:00:01", "192.168.7.5"));
+
+    EXPECT_TRUE(!!registry->FindByHardwareAddress("4e:74:00:00:00:01"));
+    EXPECT_TRUE(!!registry->FindByHardwareAddress("4E:74:00:00:00:01"));
+}
+
+TEST(DhcpLeaseRegistry, NewerLeaseReplacesOlderOne) {
+    auto registry = w11tng::DhcpLeaseRegistry::Create();
+
+    registry->Update(MakeLease("p2p0", "4e:74:00:00:00:01", "192.168.7.5"));
+    registry->Update(MakeLease("p2p0", "4e:74:00:00:00:01", "192.168.7.9"));
+
+    EXPECT_EQ(registry->Size(), 1);
+
+    auto lease = registry->FindByHardwareAddress("4e:74:00:00:00:01");
+    ASSERT_TRUE(!!lease);
+    EXPECT_EQ(lease->FixedAddress().to_string(), "192.168.7.9");
+}
+
+TEST(DhcpLeaseRegistry, DropsLeasesWithoutHardwareAddress) {
+    auto registry = w11tng::DhcpLeaseRegistry::Create();
+
+    registry->Update(MakeLease("p2p0", "", "192.168.7.5"));
+
+    EXPECT_EQ(registry->Size(), 0);
+}
+
+TEST(DhcpLeaseRegistry, RemovesLeases) {
+    auto registry = w11tng::DhcpLeaseRegistry::Create();
+
+    registry->Update(MakeLease("p2p0", "4e:74:00:00:00:01", "192.168.7.5"));
+    registry->Remove("4e:74:00:00:00:01");
+
+    EXPECT_EQ(registry->Size(), 0);
+}
+
+TEST(DhcpLeaseRegistry, RefreshOnlyParsesAppendedRecords) {
+    auto lease_path = CreateLeaseFile({
+        "lease {",
+        "    interface p2p0;",
+        "    hardware ethernet 4e:74:00:00:00:01;",
+        "    fixed-address 192.168.7.5;",
+        "    option routers 192.168.7.1;",
+        "}",
+    });
+
+    auto registry = w11tng::DhcpLeaseRegistry::Create();
+    registry->RefreshFromFile(lease_path);
+
+    EXPECT_EQ(registry->Size(), 1);
+    EXPECT_TRUE(!!registry->FindByHardwareAddress("4e:74:00:00:00:01"));
+
+    std::ofstream appender(lease_path, std::ios_base::app);
+    appender << "lease {" << std::endl
+             << "    interface p2p0;" << std::endl
+             << "    hardware ethernet 4e:74:00:00:00:02;" << std::endl
+             << "    fixed-address 192.168.7.6;" << std::endl
+             << "}" << std::endl;
+    appender.close();
+
+    registry->RefreshFromFile(lease_path);
+
+    EXPECT_EQ(registry->Size(), 2);
+
+    auto lease = registry->FindByHardwareAddress("4e:74:00:00:00:02");
+    ASSERT_TRUE(!!lease);
+    EXPECT_EQ(lease->FixedAddress().to_string(), "192.168.7.6");
+
+    ::unlink(lease_path.c_str());
+}
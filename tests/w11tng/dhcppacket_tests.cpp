@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "w11tng/dhcppacket.h"
+
+using w11tng::DhcpPacket;
+
+TEST(DhcpPacket, PackedRequestSurvivesRoundTrip) {
+    DhcpPacket packet;
+    packet.SetOp(DhcpPacket::kBootRequest);
+    packet.SetType(DhcpPacket::MessageType::kRequest);
+    packet.SetTransactionId(0xdeadbeef);
+    packet.SetFlags(DhcpPacket::kFlagBroadcast);
+    packet.SetHardwareAddress({ 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff });
+    packet.SetAddressOption(DhcpPacket::kOptionRequestedAddress,
+                            ac::IpV4Address::from_string("192.168.7.5"));
+    packet.SetAddressOption(DhcpPacket::kOptionServerIdentifier,
+                            ac::IpV4Address::from_string("192.168.7.1"));
+
+    const auto data = packet.Pack();
+
+    auto parsed = DhcpPacket::Parse(data.data(), data.size());
+    EXPECT_TRUE(parsed.Valid());
+    EXPECT_EQ(parsed.Op(), DhcpPacket::kBootRequest);
+    EXPECT_EQ(parsed.Type(), DhcpPacket::MessageType::kRequest);
+    EXPECT_EQ(parsed.TransactionId(), 0xdeadbeef);
+    EXPECT_EQ(parsed.Flags(), DhcpPacket::kFlagBroadcast);
+    EXPECT_EQ(parsed.HardwareAddress(),
+              std::vector<std::uint8_t>({ 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff }));
+    EXPECT_EQ(parsed.AddressOption(DhcpPacket::kOptionRequestedAddress).to_string(), "192.168.7.5");
+    EXPECT_EQ(parsed.AddressOption(DhcpPacket::kOptionServerIdentifier).to_string(), "192.168.7.1");
+}
+
+TEST(DhcpPacket, PackedReplyCarriesLeaseDetails) {
+    DhcpPacket packet;
+    packet.SetOp(DhcpPacket::kBootReply);
+    packet.SetType(DhcpPacket::MessageType::kAck);
+    packet.SetYourAddress(ac::IpV4Address::from_string("192.168.7.5"));
+    packet.SetU32Option(DhcpPacket::kOptionLeaseTime, 3600);
+    packet.SetAddressOption(DhcpPacket::kOptionSubnetMask,
+                            ac::IpV4Address::from_string("255.255.255.0"));
+    packet.SetAddressOption(DhcpPacket::kOptionRouter,
+                            ac::IpV4Address::from_string("192.168.7.1"));
+
+    const auto data = packet.Pack();
+
+    // Some implementations drop anything below the historic BOOTP
+    // minimum packet size.
+    EXPECT_GE(data.size(), 300);
+
+    auto parsed = DhcpPacket::Parse(data.data(), data.size());
+    EXPECT_TRUE(parsed.Valid());
+    EXPECT_EQ(parsed.Type(), DhcpPacket::MessageType::kAck);
+    EXPECT_EQ(parsed.YourAddress().to_string(), "192.168.7.5");
+    EXPECT_EQ(parsed.U32Option(DhcpPacket::kOptionLeaseTime), 3600);
+    EXPECT_EQ(parsed.AddressOption(DhcpPacket::kOptionSubnetMask).to_string(), "255.255.255.0");
+    EXPECT_EQ(parsed.AddressOption(DhcpPacket::kOptionRouter).to_string(), "192.168.7.1");
+    EXPECT_FALSE(parsed.HasOption(DhcpPacket::kOptionBroadcastAddress));
+}
+
+TEST(DhcpPacket, RejectsTruncatedOrForeignData) {
+    const std::uint8_t garbage[] = { 0x01, 0x02, 0x03, 0x04 };
+    EXPECT_FALSE(DhcpPacket::Parse(garbage, sizeof(garbage)).Valid());
+    EXPECT_FALSE(DhcpPacket::Parse(nullptr, 0).Valid());
+
+    // A full-size packet without the magic cookie isn't DHCP either.
+    std::vector<std::uint8_t> no_cookie(300, 0);
+    EXPECT_FALSE(DhcpPacket::Parse(no_cookie.data(), no_cookie.size()).Valid());
+}
+
+TEST(DhcpPacket, MissingOptionsHaveNeutralValues) {
+    DhcpPacket packet;
+    const auto data = packet.Pack();
+
+    auto parsed = DhcpPacket::Parse(data.data(), data.size());
+    EXPECT_TRUE(parsed.Valid());
+    EXPECT_EQ(parsed.Type(), DhcpPacket::MessageType::kInvalid);
+    EXPECT_EQ(parsed.AddressOption(DhcpPacket::kOptionRouter).to_ulong(), 0);
+    EXPECT_EQ(parsed.U32Option(DhcpPacket::kOptionLeaseTime), 0);
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <ac/utils.h>
+
+#include <common/dbusfixture.h>
+#include <common/dbusnameowner.h>
+#include <common/glibhelpers.h>
+
+#include <w11tng/networkdevice.h>
+#include <w11tng/p2pdevicestub.h>
+
+#include "p2pdeviceskeleton.h"
+#include "peerskeleton.h"
+
+namespace {
+constexpr const char *kPeerCountEnvName{"AETHERCAST_DISCOVERY_BENCH_PEERS"};
+constexpr const char *kAnnounceDelayEnvName{"AETHERCAST_DISCOVERY_BENCH_ANNOUNCE_DELAY_MS"};
+
+constexpr unsigned int kDefaultPeerCount{20};
+constexpr unsigned int kDefaultAnnounceDelayMs{50};
+
+// Upper bound on how long we wait for the last peer to become
+// visible before the run counts as stuck.
+constexpr std::chrono::seconds kSettleTimeout{30};
+
+unsigned int EnvOrDefault(const char *name, unsigned int default_value) {
+    const auto value = ac::Utils::GetEnvValue(name);
+    return value.empty() ? default_value
+                         : static_cast<unsigned int>(std::atoi(value.c_str()));
+}
+
+// Like ac::testing::RunMainLoop but with millisecond granularity;
+// announce delays are well below a second and a blocking single
+// iteration would stall on an idle bus.
+void RunMainLoopMs(const std::chrono::milliseconds &duration) {
+    std::shared_ptr<GMainLoop> loop(
+        g_main_loop_new(g_main_context_default(), false), &g_main_loop_unref);
+    g_timeout_add(duration.count(), [](gpointer user_data) {
+        g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+        return FALSE;
+    }, loop.get());
+    g_main_loop_run(loop.get());
+}
+
+// Replays what NetworkManager does for every peer the supplicant
+// announces: build a NetworkDevice stub for the path and wait for the
+// peer property fetch to complete. A device counts as visible at the
+// moment OnDeviceReady fires, which is also when the real manager
+// first reports it through the Controller skeleton.
+class DiscoveryObserver : public std::enable_shared_from_this<DiscoveryObserver>,
+                          public w11tng::P2PDeviceStub::Delegate,
+                          public w11tng::NetworkDevice::Delegate {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    void MarkAnnounced(const std::string &path) {
+        announce_times_[path] = Clock::now();
+    }
+
+    void OnDeviceFound(const std::string &path) override {
+        if (devices_.find(path) != devices_.end())
+            return;
+
+        auto device = w11tng::NetworkDevice::Create(path);
+        device->SetDelegate(shared_from_this());
+        devices_[path] = device;
+    }
+
+    void OnDeviceLost(const std::string &path) override {
+        devices_.erase(path);
+    }
+
+    void OnDeviceReady(const w11tng::NetworkDevice::Ptr &device) override {
+        const auto iter = announce_times_.find(device->ObjectPath());
+        if (iter == announce_times_.end())
+            return;
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - iter->second);
+        visibility_latencies_ms_.push_back(elapsed.count() / 1000.0);
+    }
+
+    void OnDeviceChanged(const w11tng::NetworkDevice::Ptr&) override {}
+
+    void OnPeerConnectFailed() override {}
+    void OnGroupOwnerNegotiationSuccess(const std::string&,
+        const w11tng::P2PDeviceStub::GroupOwnerNegotiationResult&) override {}
+    void OnGroupOwnerNegotiationFailure(const std::string&,
+        const w11tng::P2PDeviceStub::GroupOwnerNegotiationResult&) override {}
+    void OnGroupStarted(const std::string&, const std::string&, const std::string&) override {}
+    void OnGroupFinished(const std::string&, const std::string&) override {}
+    void OnGroupRequest(const std::string&, int) override {}
+    void OnPersistentGroupAdded(const std::string&) override {}
+    void OnPersistentGroupRemoved(const std::string&) override {}
+    void OnP2PDeviceChanged() override {}
+    void OnP2PDeviceReady() override { ready_ = true; }
+
+    bool Ready() const { return ready_; }
+    std::size_t VisibleCount() const { return visibility_latencies_ms_.size(); }
+    const std::vector<double>& Latencies() const { return visibility_latencies_ms_; }
+
+private:
+    bool ready_ = false;
+    std::map<std::string, Clock::time_point> announce_times_;
+    std::map<std::string, w11tng::NetworkDevice::Ptr> devices_;
+    std::vector<double> visibility_latencies_ms_;
+};
+
+double Percentile(std::vector<double> values, double percentile) {
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    const auto index = std::min(values.size() - 1,
+        static_cast<std::size_t>(values.size() * percentile));
+    return values.at(index);
+}
+}
+
+int main(int, char**) {
+    const auto peer_count = EnvOrDefault(kPeerCountEnvName, kDefaultPeerCount);
+    const auto announce_delay = std::chrono::milliseconds{
+        EnvOrDefault(kAnnounceDelayEnvName, kDefaultAnnounceDelayMs)};
+
+    // Private bus with a scripted supplicant; nothing here touches the
+    // real system services.
+    ac::testing::DBusFixture dbus_fixture;
+    ac::testing::DBusNameOwner name_owner("fi.w1.wpa_supplicant1");
+
+    auto device_skeleton = w11tng::testing::P2PDeviceSkeleton::Create("/device_1");
+
+    std::vector<std::shared_ptr<w11tng::testing::PeerSkeleton>> peer_skeletons;
+    for (unsigned int n = 0; n < peer_count; n++) {
+        auto peer = std::make_shared<w11tng::testing::PeerSkeleton>(
+            ac::Utils::Sprintf("/peer_%d", n));
+        peer->SetAddress(std::vector<uint8_t>{
+            0x4e, 0x74, 0x00,
+            static_cast<uint8_t>(n >> 16),
+            static_cast<uint8_t>(n >> 8),
+            static_cast<uint8_t>(n)});
+        peer->SetName(ac::Utils::Sprintf("Sink %d", n));
+        peer_skeletons.push_back(peer);
+    }
+
+    auto observer = std::make_shared<DiscoveryObserver>();
+    auto stub = w11tng::P2PDeviceStub::Create("/device_1", observer);
+
+    const auto setup_start = DiscoveryObserver::Clock::now();
+    while (!observer->Ready() &&
+            DiscoveryObserver::Clock::now() - setup_start < kSettleTimeout)
+        RunMainLoopMs(std::chrono::milliseconds{10});
+
+    if (!observer->Ready()) {
+        std::cerr << "P2P device stub never became ready" << std::endl;
+        return 1;
+    }
+
+    const auto scan_start = DiscoveryObserver::Clock::now();
+
+    // Announce the peers one by one like a real supplicant drips them
+    // in during a find cycle; the loop keeps spinning in between so
+    // property fetches for earlier peers overlap with later
+    // announcements, just as they do live.
+    for (unsigned int n = 0; n < peer_count; n++) {
+        const auto path = ac::Utils::Sprintf("/peer_%d", n);
+        observer->MarkAnnounced(path);
+        device_skeleton->EmitDeviceFound(path);
+
+        RunMainLoopMs(announce_delay);
+    }
+
+    while (observer->VisibleCount() < peer_count &&
+            DiscoveryObserver::Clock::now() - scan_start < kSettleTimeout)
+        RunMainLoopMs(std::chrono::milliseconds{10});
+
+    const auto total_ms = std::chrono::duration_cast<std::chrono::microseconds>(
+        DiscoveryObserver::Clock::now() - scan_start).count() / 1000.0;
+
+    const auto &latencies = observer->Latencies();
+    double sum = 0.0;
+    for (const auto value : latencies)
+        sum += value;
+    const auto mean = latencies.empty() ? 0.0 : sum / latencies.size();
+
+    std::cout << "peers " << peer_count
+              << " announce-delay " << announce_delay.count() << " ms"
+              << " visible " << observer->VisibleCount()
+              << " total " << total_ms << " ms"
+              << " per-device mean " << mean << " ms"
+              << " p50 " << Percentile(latencies, 0.5) << " ms"
+              << " p99 " << Percentile(latencies, 0.99) << " ms"
+              << " max " << Percentile(latencies, 1.0) << " ms"
+              << std::endl;
+
+    return observer->VisibleCount() == peer_count ? 0 : 1;
+}
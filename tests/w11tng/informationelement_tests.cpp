@@ -60,3 +60,42 @@ TEST(InformationElement, DualRole) {
     for (unsigned int n = 0; n < ie_data->length; n++)
         EXPECT_EQ(ie_data->bytes[n], expected_bytes[n]);
 }
+
+TEST(InformationElementView, ParsesWithoutCopyingTheBuffer) {
+    w11tng::InformationElement ie;
+    auto sub_element = new_subelement(w11tng::kDeviceInformation);
+    const auto dev_info = reinterpret_cast<w11tng::DeviceInformationSubelement*>(sub_element);
+
+    dev_info->session_management_control_port = htons(7236);
+    dev_info->maximum_throughput = htons(50);
+    dev_info->field1.device_type = w11tng::kPrimarySink;
+    dev_info->field1.session_availability = true;
+    ie.add_subelement(sub_element);
+
+    auto ie_data = ie.serialize();
+
+    w11tng::InformationElementView view(ie_data->bytes, ie_data->length);
+
+    EXPECT_TRUE(view.has_subelement(w11tng::kDeviceInformation));
+    EXPECT_FALSE(view.has_subelement(w11tng::kAssociatedBssid));
+    EXPECT_EQ(w11tng::kPrimarySink, view.get_device_type());
+    EXPECT_EQ(htons(7236), view.get_rtsp_port());
+}
+
+TEST(InformationElementView, HandlesTruncatedAndForeignData) {
+    uint8_t garbage[] = { 0xff, 0xab, 0x13 };
+
+    w11tng::InformationElementView view(garbage, sizeof(garbage));
+    EXPECT_FALSE(view.has_subelement(w11tng::kDeviceInformation));
+    EXPECT_EQ(w11tng::kDualRole, view.get_device_type());
+    EXPECT_EQ(-1, view.get_rtsp_port());
+
+    // A device information subelement header without its payload
+    // must not be walked over.
+    uint8_t truncated[] = { 0x0, 0x0, 0x6 };
+    w11tng::InformationElementView truncated_view(truncated, sizeof(truncated));
+    EXPECT_FALSE(truncated_view.has_subelement(w11tng::kDeviceInformation));
+
+    w11tng::InformationElementView empty_view(nullptr, 0);
+    EXPECT_FALSE(empty_view.has_subelement(w11tng::kDeviceInformation));
+}
@@ -50,6 +50,8 @@ public:
     MOCK_METHOD3(OnGroupStarted, void(const std::string&, const std::string&, const std::string&));
     MOCK_METHOD2(OnGroupFinished, void(const std::string&, const std::string&));
     MOCK_METHOD2(OnGroupRequest, void(const std::string&, int));
+    MOCK_METHOD1(OnPersistentGroupAdded, void(const std::string&));
+    MOCK_METHOD1(OnPersistentGroupRemoved, void(const std::string&));
     MOCK_METHOD0(OnP2PDeviceChanged, void());
     MOCK_METHOD0(OnP2PDeviceReady, void());
 };